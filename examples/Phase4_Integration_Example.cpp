@@ -163,8 +163,9 @@ void checkTemperatureThreshold(float temperature, float humidity) {
         emotionLibrary.drawEmotion(EmotionState::HOT_WARNING, 48, 24);
         
         // 语音播报
-        String feedback = multimodalFeedback.generateThermalFeedback(temperature, humidity);
-        asrproModule.speak(feedback.c_str());
+        char feedback[PHRASE_BUFFER_SIZE];
+        multimodalFeedback.generateThermalFeedback(temperature, humidity, feedback, sizeof(feedback));
+        asrproModule.speak(feedback);
         
         lastAlertTime = currentTime;
         
@@ -3,37 +3,68 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "ASRPRO_Protocol.h"
+#include "Voice_Command_Queue.h"
+#include "Speech_Output.h"
 
 /**
- * 语音识别指令类型
+ * 语音关键词匹配器
+ * 基于编译期生成的 Aho-Corasick 自动机，逐字节消费串口数据
+ * 每个字节只做一次查表，不缓存整行文本
  */
-enum class VoiceCommand {
-    UNKNOWN,      // 未知命令
-    HAPPY,        // "开心"
-    SAD,          // "伤心"
-    ANGRY,        // "生气"
-    SLEEPY,       // "困倦"
-    SURPRISED,    // "惊讶"
-    SHAKE,        // "摇头"
-    NOD,          // "点头"
-    QUERY_WEATHER,// "天气"
-    QUERY_TEMP,   // "温度"
-    HELP          // "帮助"
+class VoiceKeywordMatcher {
+private:
+    uint8_t state;          // 自动机当前状态
+    uint8_t bestPriority;   // 本行已命中关键词的最高优先级
+    
+public:
+    VoiceKeywordMatcher() : state(0), bestPriority(0) {}
+    
+    /**
+     * 输入一个字节
+     * @return 关键词刚好结束且优先级高于本行已命中的关键词时返回对应指令，
+     *         否则返回 VoiceCommand::UNKNOWN
+     */
+    VoiceCommand feed(uint8_t c);
+    
+    /**
+     * 行结束，复位自动机
+     */
+    void reset() {
+        state = 0;
+        bestPriority = 0;
+    }
 };
 
 /**
  * ASRPRO 语音识别模块管理类
+ * 同时支持文本行与二进制帧（见 ASRPRO_Protocol.h），由 ASRPRO_LINK_MODE 选择
  */
 class ASRPROModule {
 private:
-    String inputBuffer;
+    VoiceKeywordMatcher matcher;
+    ASRPROFrameDecoder decoder;
+    VoiceCommandQueue commandQueue;
+    SpeechOutputQueue speechQueue;
     unsigned long lastCommandTime;
-    VoiceCommand lastCommand;
+    unsigned long lastByteTime;
+    uint16_t lineEntryId;       // 当前文本行已入队的条目序号，0 表示无
+    bool binaryDetected;
+    
+    // 延迟追踪：当前行/帧首字节到达的周期计数
+    uint32_t lineStartCycles;
+    uint32_t frameStartCycles;
+    bool lineStarted;
     
     /**
-     * 解析语音指令
+     * 处理文本通道的一个字节
      */
-    VoiceCommand parseCommand(const String& cmd);
+    void handleTextByte(uint8_t c, uint32_t rxCycles);
+    
+    /**
+     * 处理串口收到的一个字节（文本或二进制帧）
+     */
+    void handleRxByte(uint8_t c);
     
 public:
     ASRPROModule();
@@ -44,29 +75,77 @@ public:
     void begin();
     
     /**
-     * 处理语音数据
+     * 处理语音数据并推进播报发送
      * 应在主循环中定期调用
      */
     void update();
     
     /**
-     * 获取最后一条指令
+     * 取出优先级最高的待处理指令
+     * @return false 没有待处理指令
+     */
+    bool nextCommand(VoiceCommandEntry& entry) {
+        return commandQueue.pop(entry, millis());
+    }
+    
+    /**
+     * 获取下一条指令（仅指令类型）
      */
     VoiceCommand getLastCommand() { 
-        VoiceCommand cmd = lastCommand;
-        lastCommand = VoiceCommand::UNKNOWN;  // 读取后清除
-        return cmd;
+        VoiceCommandEntry entry;
+        return nextCommand(entry) ? entry.command : VoiceCommand::UNKNOWN;
+    }
+    
+    /**
+     * 获取最近一次收到指令的时间
+     */
+    unsigned long getLastCommandTime() const { return lastCommandTime; }
+    
+    /**
+     * 获取指令队列统计
+     */
+    const VoiceQueueStats& getQueueStats() const { return commandQueue.getStats(); }
+    
+    /**
+     * 语音播报（非阻塞）
+     * 文本被复制进播报队列，由 update() 在串口发送缓冲区有空位时逐步写出
+     * @return 播报序号，可与 pollSpeechEvent() 返回的事件对应；入队失败返回 0
+     */
+    uint16_t speak(const char* text, 
+                   SpeechPriority priority = SpeechPriority::NORMAL,
+                   unsigned long ttl = SPEECH_DEFAULT_TTL) {
+        return speechQueue.speak(text, priority, millis(), ttl);
+    }
+    
+    /**
+     * 取出一个播报完成/取消事件
+     */
+    bool pollSpeechEvent(SpeechEvent& event) { return speechQueue.pollEvent(event); }
+    
+    /**
+     * 是否仍有播报未发送完
+     */
+    bool isSpeaking() const { return speechQueue.isBusy(); }
+    
+    /**
+     * 丢弃当前行已接收的数据
+     * 之后收到的关键词作为新的一行入队，不再替换本行已入队的条目
+     */
+    void clearBuffer() {
+        matcher.reset();
+        lineEntryId = 0;
+        lineStarted = false;
     }
     
     /**
-     * 获取原始文本数据
+     * 是否已检测到 ASRPRO 使用二进制帧
      */
-    String getRawData() const { return inputBuffer; }
+    bool isBinaryLink() const { return binaryDetected; }
     
     /**
-     * 清空输入缓冲区
+     * 获取二进制链路统计
      */
-    void clearBuffer() { inputBuffer = ""; }
+    const ASRPROLinkStats& getLinkStats() const { return decoder.getStats(); }
 };
 
 #endif
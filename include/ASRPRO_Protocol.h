@@ -0,0 +1,115 @@
+#ifndef ASRPRO_PROTOCOL_H
+#define ASRPRO_PROTOCOL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * ASRPRO 二进制帧协议
+ * 帧格式（4 字节）：
+ *   [0] 同步字节 0xA5
+ *   [1] 指令 ID（与 VoiceCommand 枚举值一致）
+ *   [2] 序号（每帧递增，重发时保持不变）
+ *   [3] CRC-8（多项式 0x07，初值 0x00，覆盖 ID 与序号）
+ *
+ * 同一串口上仍可发送文本行，解码器把不属于有效帧的字节原样交还给文本通道
+ */
+
+#define ASRPRO_FRAME_SYNC 0xA5
+#define ASRPRO_FRAME_SIZE 4
+
+/**
+ * 链路统计信息
+ */
+struct ASRPROLinkStats {
+    uint32_t framesDecoded;   // 有效帧数
+    uint32_t badFrames;       // 同步字节后校验失败的候选帧数
+    uint32_t duplicates;      // 重复序号（重发）帧数
+    uint32_t sequenceResets;  // 间隔超过 ASRPRO_DUPLICATE_WINDOW 后重新起算序号的次数
+    uint32_t lostFrames;      // 根据序号跳变推算的丢帧数
+    uint32_t timeouts;        // 帧未收完即超时的次数
+};
+
+/**
+ * 计算 CRC-8（多项式 0x07）
+ */
+uint8_t asrproCrc8(const uint8_t* data, uint8_t length);
+
+/**
+ * 二进制帧解码器
+ * 逐字节输入；校验失败时从候选帧内下一个同步字节处重新同步，
+ * 可容忍噪声字节与丢字节，最多只损失受影响的那一帧
+ * 同序号帧只在 ASRPRO_DUPLICATE_WINDOW 内视为重发；静默更久后对端可能已复位，序号重新起算
+ * 每次 feed() 之后应调用 popTextByte() 取空交还的字节
+ */
+class ASRPROFrameDecoder {
+private:
+    uint8_t frame[ASRPRO_FRAME_SIZE];
+    uint8_t frameLength;
+
+    // 交还给文本通道的字节（环形队列）
+    uint8_t released[ASRPRO_FRAME_SIZE];
+    uint8_t releasedHead;
+    uint8_t releasedCount;
+
+    uint8_t maxCommandId;
+    uint8_t commandId;
+    uint8_t sequence;
+    bool hasSequence;
+    unsigned long sequenceTime;   // 最近一次收到当前序号的时刻
+
+    ASRPROLinkStats stats;
+
+    void release(uint8_t b);
+
+    /**
+     * 校验失败后，从 frame[1] 起寻找下一个同步字节重新对齐
+     */
+    void resync();
+
+public:
+    /**
+     * @param maxId 合法指令 ID 上限，超出范围的候选帧视为噪声
+     */
+    explicit ASRPROFrameDecoder(uint8_t maxId);
+
+    /**
+     * 输入一个字节
+     * @param now 字节到达时刻（毫秒），用于判断重发
+     * @return true 收到一帧新的有效指令，通过 getCommandId() 读取
+     */
+    bool feed(uint8_t b, unsigned long now);
+
+    /**
+     * 取出一个交还给文本通道的字节
+     * @return false 没有待取字节
+     */
+    bool popTextByte(uint8_t& b);
+
+    /**
+     * 放弃未收完的帧（超时），已缓存字节交还给文本通道
+     */
+    void flush();
+
+    /**
+     * 是否有未收完的帧
+     */
+    bool isPending() const { return frameLength > 0; }
+
+    /**
+     * 最近一帧的指令 ID
+     */
+    uint8_t getCommandId() const { return commandId; }
+
+    /**
+     * 最近一帧的序号
+     */
+    uint8_t getSequence() const { return sequence; }
+
+    /**
+     * 获取链路统计
+     */
+    const ASRPROLinkStats& getStats() const { return stats; }
+};
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef CHOREOGRAPHY_H
+#define CHOREOGRAPHY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "OLED_Display.h"
+#include "Motion_Arbiter.h"
+
+class ASRPROModule;
+class DHTManager;
+
+/**
+ * 编舞字节码
+ * 新的舞蹈与反应不必重新编译固件：主机上用 tools/choreo_compiler.py 把文本/JSON 编译成
+ * 字节码，经 MQTT 分块下载到 Flash（见 Choreography_Store.h），由 ChoreographyPlayer 就地解释执行
+ *
+ * 脚本格式（小端）：
+ *   [0..1] 魔数 'C' 'B'
+ *   [2]    版本 CHOREO_VERSION
+ *   [3]    字符串条数
+ *   [4..5] 指令区长度
+ *   [6..7] 脚本总长度
+ *   [8..9] CRC-16/CCITT（初值 0xFFFF，覆盖头部之后的全部字节）
+ *   [10..] 指令区，随后是以 '\0' 结尾的播报文本
+ *
+ * 指令（操作码 + 操作数）：
+ *   END                                   结束
+ *   MOVE    head u8, nod u8, ms u16       两轴运动段（255 表示该轴保持），脚本时间前进 ms
+ *   WAIT    ms u16                        保持姿态，脚本时间前进 ms
+ *   EMOTION e u8                          切换表情
+ *   SAY     index u8                      播报第 index 条文本
+ *   LOOP    count u8                      循环开始，循环体执行 count 次
+ *   ENDLOOP                               循环结束
+ *   JUMP    target u16                    跳转（只能向前）
+ *   BRANCH  sensor u8, cmp u8, value i16, target u16
+ *                                         传感器读数满足条件时跳转（只能向前）
+ *
+ * 校验器在播放前检查全部操作数、跳转目标与循环配对，只允许向前跳转与有限次数循环，
+ * 因此任何通过校验的脚本都在有限时间内结束；解释器每次 update() 最多执行
+ * CHOREO_OPS_PER_TICK 条指令，单次耗时有上界
+ */
+
+#define CHOREO_MAGIC_0      'C'
+#define CHOREO_MAGIC_1      'B'
+#define CHOREO_VERSION      1
+#define CHOREO_HEADER_SIZE  10
+#define CHOREO_ANGLE_HOLD   255     // MOVE 中该轴保持当前角度
+
+/**
+ * 操作码
+ */
+enum class ChoreoOp : uint8_t {
+    END,
+    MOVE,
+    WAIT,
+    EMOTION,
+    SAY,
+    LOOP,
+    ENDLOOP,
+    JUMP,
+    BRANCH,
+    COUNT
+};
+
+/**
+ * BRANCH 的传感器（温湿度以 0.1 为单位）
+ */
+enum class ChoreoSensor : uint8_t {
+    TEMPERATURE,     // 温度 ×10
+    HUMIDITY,        // 湿度 ×10
+    COUNT
+};
+
+/**
+ * BRANCH 的比较方式（读数 cmp 常量）
+ */
+enum class ChoreoCompare : uint8_t {
+    LESS,
+    GREATER,
+    EQUAL,
+    NOT_EQUAL,
+    COUNT
+};
+
+/**
+ * 校验结果
+ */
+enum class ChoreoVerifyError : uint8_t {
+    NONE,
+    HEADER,          // 魔数、版本或长度不符
+    CRC,             // 校验和不符
+    OPCODE,          // 未知操作码或指令越过指令区末尾
+    OPERAND,         // 操作数超出范围
+    TARGET,          // 跳转目标不是指令起点、向后跳转或跨越循环
+    LOOP,            // 循环不配对或嵌套过深
+    STRINGS,         // 文本表与条数不符或单条过长
+    DURATION,        // 总时长超过 CHOREO_MAX_DURATION_MS
+    NO_END           // 指令区不以 END 结束
+};
+
+/**
+ * 校验得到的脚本信息
+ */
+struct ChoreoScriptInfo {
+    uint16_t codeLength;
+    uint8_t stringCount;
+    uint16_t stringOffset[CHOREO_STRING_MAX];   // 各条文本相对脚本起点的偏移
+    uint32_t maxDuration;                       // 全部分支都执行时的总时长（毫秒）
+    bool moves;                                 // 是否包含 MOVE
+};
+
+/**
+ * CRC-16/CCITT（多项式 0x1021，初值 0xFFFF）
+ */
+uint16_t choreoCrc16(const uint8_t* data, size_t length);
+
+/**
+ * 校验脚本
+ */
+ChoreoVerifyError choreoVerify(const uint8_t* script, size_t length, ChoreoScriptInfo& info);
+
+const char* choreoVerifyErrorText(ChoreoVerifyError error);
+
+/**
+ * 解释器统计
+ */
+struct ChoreoPlayerStats {
+    uint32_t ticks;              // 播放期间 update() 次数
+    uint32_t ops;                // 执行的指令数
+    uint32_t totalCycles;        // update() 累计周期数（主机构建为微秒）
+    uint32_t maxTickCycles;      // 单次 update() 最大周期数
+    uint32_t maxLateness;        // 表情/播报最大迟到（毫秒）
+    uint32_t lateArms;           // 舵机段装入晚于上一段结束的次数
+    uint32_t rejectedSegments;   // 被更高优先级动作拒绝的舵机段
+    uint32_t budgetStalls;       // 因 CHOREO_OPS_PER_TICK 用完而推迟到下次 update() 的次数
+};
+
+/**
+ * 编舞解释器
+ * 与 MultimodalFeedbackSystem 的时间线对齐方式相同：指令按脚本时间提前执行，
+ * 舵机段提前 SERVO_OUTPUT_LATENCY_MS + FEEDBACK_LOOKAHEAD_MS 装入舵机时间线，
+ * 表情提前预绘制、到点发送，播报到点加入队列；传感器分支在指令执行时求值
+ */
+class ChoreographyPlayer {
+private:
+    /**
+     * 已执行、等待到点的表情/播报
+     */
+    struct Event {
+        uint32_t time;           // 脚本时间（毫秒）
+        ChoreoOp op;             // EMOTION 或 SAY
+        uint8_t arg;
+    };
+
+    /**
+     * 循环栈帧
+     */
+    struct LoopFrame {
+        uint16_t body;           // 循环体第一条指令
+        uint8_t remaining;       // 剩余次数（含本次）
+    };
+
+    OLEDDisplay* display;
+    MotionArbiter* motion;
+    ASRPROModule* voice;
+    const DHTManager* sensors;
+
+    const uint8_t* script;       // 播放期间必须保持有效（Flash 中的脚本就地执行）
+    ChoreoScriptInfo info;
+    uint16_t pc;
+    uint32_t scriptTime;         // 已执行指令的脚本时间
+    unsigned long startTime;     // 脚本时间 0 对应的 millis()，含舵机唤醒与输出延迟
+    uint16_t servoLead;          // 舵机段提前装入的时长（唤醒保持 + 输出延迟）
+    bool running;                // 还有指令未执行
+    bool playing;                // 还有指令或事件未完成
+
+    LoopFrame loops[CHOREO_LOOP_DEPTH];
+    uint8_t loopDepth;
+
+    Event events[CHOREO_EVENT_CAPACITY];
+    uint8_t eventHead;
+    uint8_t eventCount;
+    uint8_t pendingEmotions;     // 队列中的表情事件数（只有第一帧已预绘制）
+    EmotionState lastEmotion;
+    bool hasEmotion;
+
+    bool headEnabled;            // 舵机段被拒绝后该轴静音，其余照常
+    bool nodEnabled;
+    bool servoClaimed;           // 已提交过舵机段（WAIT 需要装入保持段）
+
+    ChoreoPlayerStats stats;
+
+    /**
+     * 执行 pc 处的一条指令
+     * @return false 事件队列已满，指令未执行
+     */
+    bool step(long elapsed);
+
+    /**
+     * 向两轴时间线装入一段（WAIT 为两轴保持）
+     */
+    void submitServo(int16_t head, int16_t nod, uint16_t duration, long elapsed);
+
+    bool pushEvent(ChoreoOp op, uint8_t arg);
+    void fireEvent(const Event& e, long elapsed);
+    bool readSensor(ChoreoSensor sensor, int16_t& value) const;
+
+public:
+    ChoreographyPlayer();
+
+    /**
+     * @param asr 语音播报，nullptr 时 SAY 静音
+     * @param dht 传感器，nullptr 时分支条件一律不成立
+     */
+    void begin(OLEDDisplay* disp, MotionArbiter* arbiter, ASRPROModule* asr = nullptr,
+               const DHTManager* dht = nullptr);
+
+    /**
+     * 校验并开始播放（打断正在播放的脚本）
+     */
+    ChoreoVerifyError play(const uint8_t* data, size_t length);
+
+    /**
+     * 停止播放，舵机回中
+     */
+    void stop();
+
+    /**
+     * 推进解释器（非阻塞），应在主循环中调用
+     */
+    void update();
+
+    bool isPlaying() const { return playing; }
+
+    /**
+     * 脚本是否位于 [begin, end) 内（存储擦除前检查是否正在就地执行）
+     */
+    bool isPlayingFrom(const uint8_t* begin, const uint8_t* end) const {
+        return playing && script >= begin && script < end;
+    }
+
+    const ChoreoPlayerStats& getStats() const { return stats; }
+    void resetStats() { stats = ChoreoPlayerStats{}; }
+};
+
+#endif
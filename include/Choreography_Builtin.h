@@ -0,0 +1,32 @@
+#ifndef CHOREOGRAPHY_BUILTIN_H
+#define CHOREOGRAPHY_BUILTIN_H
+
+#include <Arduino.h>
+
+/**
+ * 内置编舞脚本（随固件存放在 Flash 中，由 ChoreographyPlayer 就地执行）
+ * 修改 tools/choreo/ 下的源文件后重新生成：
+ *   python3 tools/choreo_compiler.py tools/choreo/dance.txt --c-array CHOREO_DANCE
+ */
+
+// 由 tools/choreo_compiler.py 从 tools/choreo/dance.txt 生成
+static const uint8_t CHOREO_DANCE[] = {
+    0x43, 0x42, 0x01, 0x01, 0x23, 0x00, 0x36, 0x00, 0xcb, 0xa2, 0x03, 0x00,
+    0x04, 0x00, 0x01, 0x2d, 0xff, 0x2c, 0x01, 0x01, 0x87, 0xff, 0x2c, 0x01,
+    0x01, 0xff, 0x1e, 0x2c, 0x01, 0x01, 0x2d, 0xff, 0x2c, 0x01, 0x01, 0x87,
+    0xff, 0x2c, 0x01, 0x01, 0x5a, 0x5a, 0xc8, 0x00, 0x00, 0x44, 0x61, 0x6e,
+    0x63, 0x69, 0x6e, 0x67, 0x21, 0x00,
+};
+
+// 由 tools/choreo_compiler.py 从 tools/choreo/weather_reaction.json 生成
+static const uint8_t CHOREO_WEATHER_REACTION[] = {
+    0x43, 0x42, 0x01, 0x02, 0x31, 0x00, 0x52, 0x00, 0xa8, 0x18, 0x08, 0x00,
+    0x01, 0x2c, 0x01, 0x18, 0x00, 0x03, 0x00, 0x04, 0x00, 0x01, 0xff, 0x3c,
+    0x2c, 0x01, 0x01, 0xff, 0x78, 0x2c, 0x01, 0x07, 0x29, 0x00, 0x03, 0x06,
+    0x04, 0x01, 0x05, 0x02, 0x01, 0x3c, 0xff, 0xfa, 0x00, 0x01, 0x78, 0xff,
+    0xfa, 0x00, 0x06, 0x01, 0x5a, 0x5a, 0x2c, 0x01, 0x03, 0x05, 0x00, 0x4e,
+    0x69, 0x63, 0x65, 0x20, 0x77, 0x65, 0x61, 0x74, 0x68, 0x65, 0x72, 0x21,
+    0x00, 0x54, 0x6f, 0x6f, 0x20, 0x68, 0x6f, 0x74, 0x21, 0x00,
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef CHOREOGRAPHY_STORE_H
+#define CHOREOGRAPHY_STORE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "Choreography.h"
+
+/**
+ * 编舞脚本存储与 MQTT 下载
+ *
+ * 脚本存放在键值存储中（键 KV_KEY_CHOREO + 槽位，见 Kv_Store.h），直接在 Flash 中就地执行
+ * 存储回收擦除扇区前，若正在播放其中的脚本须先停止（由 main.cpp 的擦除回调处理）
+ *
+ * MQTT 消息（MQTT_TOPIC_CHOREO，二进制，小端）：
+ *   [CHUNK][槽位][偏移 u16][总长 u16][数据...]   按顺序分块下载，收齐后校验并写入 Flash
+ *   [PLAY][槽位]                                 播放槽位中的脚本
+ *   [STOP]                                       停止播放
+ * 每条消息回复 {"choreo":{"slot":n,"received":m,"result":"..."}}，发送端按 received 续传
+ *
+ * 存储正在回收（KvResult::BUSY）时收齐的脚本留在下载缓冲区中，回复 pending，
+ * 由 update() 在回收完成后写入；写入之前新的下载回复 busy，发送端稍后从头重发
+ */
+
+#define CHOREO_CHUNK_HEADER   6
+
+/**
+ * 消息类型
+ */
+enum class ChoreoMessage : uint8_t {
+    CHUNK = 1,
+    PLAY,
+    STOP
+};
+
+/**
+ * 消息处理结果
+ */
+enum class ChoreoStoreResult : uint8_t {
+    ACCEPTED,        // 分块已收下，等待后续分块
+    STORED,          // 脚本收齐、校验通过并写入 Flash
+    PLAYING,         // 开始播放
+    STOPPED,         // 已停止
+    OUT_OF_ORDER,    // 偏移与已收到的字节数不符（回复中的 received 为续传位置）
+    TOO_LARGE,       // 总长超过 CHOREO_SCRIPT_MAX
+    BAD_MESSAGE,     // 消息格式错误
+    INVALID,         // 脚本未通过校验
+    FLASH_ERROR,     // 存储已满，或编程失败
+    NOT_FOUND,       // 槽位中没有脚本
+    PENDING,         // 校验通过，存储回收完成后写入 Flash
+    BUSY             // 上一个脚本尚未写入，不能开始新的下载
+};
+
+class ChoreographyStore {
+private:
+    ChoreographyPlayer* player;
+
+    // 正在下载的脚本
+    uint8_t buffer[CHOREO_SCRIPT_MAX];
+    uint8_t downloadSlot;
+    uint16_t downloadTotal;
+    uint16_t received;
+    bool downloading;
+
+    // 等待写入的脚本（在 buffer 中）
+    uint8_t pendingSlot;
+    uint16_t pendingLength;
+    bool storePending;
+
+    ChoreoVerifyError lastError;
+
+    ChoreoStoreResult handleChunk(const uint8_t* payload, unsigned int length);
+
+    static const char* resultText(ChoreoStoreResult result);
+
+public:
+    ChoreographyStore();
+
+    /**
+     * @param target 下载的脚本由它播放
+     */
+    void begin(ChoreographyPlayer* target);
+
+    /**
+     * 槽位中最新的有效脚本（指向 Flash），没有时返回 nullptr
+     */
+    const uint8_t* find(uint8_t slot, size_t& length) const;
+
+    /**
+     * 校验并写入一个脚本（替换槽位中原有的脚本）
+     */
+    ChoreoStoreResult write(uint8_t slot, const uint8_t* script, size_t length);
+
+    /**
+     * 主循环调用（g_kvStore.update() 之后）：写入等待中的脚本
+     */
+    void update();
+
+    bool isStorePending() const { return storePending; }
+
+    /**
+     * 播放槽位中的脚本
+     */
+    ChoreoStoreResult play(uint8_t slot);
+
+    /**
+     * 处理 MQTT_TOPIC_CHOREO 上的消息
+     * @param reply 回复 JSON，reply 为 nullptr 时不生成
+     */
+    ChoreoStoreResult handleMessage(const uint8_t* payload, unsigned int length,
+                                    char* reply, size_t replySize);
+};
+
+#endif
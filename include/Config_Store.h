@@ -0,0 +1,174 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "MQTT_Manager.h"
+
+/**
+ * 运行时配置
+ * config.h 中的阈值、周期与服务器设置只作为默认值；实际使用的值在 g_config 中，
+ * 启动时从 Flash 载入，可经 MQTT 或串口控制台修改，无需重新烧录
+ *
+ * 存放在键值存储的 KV_KEY_CONFIG 中（见 Kv_Store.h，CRC 与掉电安全由其保证）：
+ *   [序号 u32][模式版本 u16][字段...]
+ *   字段为 [ID u8][长度 u8][值，小端]，只存与默认值不同的字段
+ * 写入中途断电时仍使用上一次提交的配置；没有记录时使用默认值
+ * 字段 ID 一经发布不再改变：旧记录中不认识的 ID 跳过，缺少的字段取默认值
+ *
+ * 修改是原子的：beginUpdate() 复制当前配置，stage() 逐项修改副本，commit() 整体校验、
+ * 写入 Flash 成功后才替换 g_config 并通知监听者
+ * 存储正在回收（KvResult::BUSY）时先生效并返回 PENDING，由 update() 在回收完成后写入；
+ * 写入前断电则恢复上一次写入的配置
+ *
+ * MQTT（MQTT_TOPIC_CONFIG）：
+ *   {"set":{"temp_high":31.5,"sensor_interval":5000}}   原子修改
+ *   {"reset":true}                                     恢复默认值
+ *   {"get":true}                                       发布全部配置
+ * 回复（MQTT_TOPIC_STATUS）{"config":{"result":"ok","seq":12}}，失败时带出错字段 "field"；
+ * "pending" 表示已生效、尚未写入 Flash，seq 仍为上一次写入的序号
+ *
+ * 串口控制台（USART1 RX，一行一条）：
+ *   config                      列出全部配置
+ *   config set k=v [k=v ...]    原子修改
+ *   config reset                恢复默认值
+ */
+
+#define CONFIG_VALUE_HEADER   6
+#define CONFIG_SCHEMA_VERSION 1
+#define CONFIG_TEXT_MAX       40            // 文本字段最大长度（含结尾 '\0'）
+#define CONFIG_VALUE_MAX      160           // 存储值的最大字节数（全部字段都不同于默认值时）
+
+/**
+ * 配置内容（字段的含义与单位见 config.h 中对应的默认值）
+ */
+struct RuntimeConfig {
+    float tempHigh;                   // ℃
+    float tempLow;
+    float humidHigh;                  // %RH
+    float humidLow;
+    uint32_t sensorReadInterval;      // 毫秒
+    uint32_t mqttHeartbeatInterval;
+    uint32_t weatherUpdateInterval;
+    char mqttBroker[CONFIG_TEXT_MAX];
+    uint16_t mqttPort;
+    uint8_t logLevel;
+};
+
+/**
+ * 当前生效的配置，启动前为默认值
+ */
+extern RuntimeConfig g_config;
+
+/**
+ * 修改结果
+ */
+enum class ConfigResult : uint8_t {
+    OK,
+    UNKNOWN_FIELD,        // 没有这个字段
+    BAD_VALUE,            // 类型不符或无法解析
+    OUT_OF_RANGE,         // 超出字段范围
+    INCONSISTENT,         // 低阈值不小于高阈值
+    PARSE_ERROR,          // 消息格式错误
+    FLASH_ERROR,          // 写入存储失败（Flash 错误或存储已满），配置未改变
+    PENDING               // 已生效，存储回收完成后由 update() 写入 Flash
+};
+
+/**
+ * 配置变化回调（载入与每次成功提交后调用）
+ */
+typedef void (*ConfigListener)(const RuntimeConfig& config);
+
+/**
+ * 载入与提交统计（Flash 写入见 KvStats）
+ */
+struct ConfigStats {
+    uint16_t commits;
+    uint16_t deferred;            // 因存储忙推迟写入的次数
+    uint16_t loadedLength;        // 载入记录的字段字节数，0 表示使用默认值
+    uint32_t loadedSeq;
+};
+
+class ConfigStore {
+private:
+    uint32_t seq;                 // 最后一次提交的序号
+    RuntimeConfig staging;        // beginUpdate() 后的待提交副本
+    ConfigListener listener;
+    ConfigStats stats;
+    int8_t lastField;             // 最近一次失败涉及的字段，-1 表示无
+    bool unsaved;                 // g_config 已生效但尚未写入 Flash
+
+    bool load(const uint8_t* fields, uint16_t length, RuntimeConfig& out) const;
+    uint16_t encode(const RuntimeConfig& config, uint8_t* fields) const;
+    ConfigResult write(const RuntimeConfig& config);
+
+    void writeReply(char* reply, size_t replySize, ConfigResult result) const;
+
+public:
+    ConfigStore();
+
+    /**
+     * 从键值存储载入配置到 g_config（没有记录时使用默认值），须在 g_kvStore.begin() 之后调用
+     */
+    void begin();
+
+    void setListener(ConfigListener configListener) { listener = configListener; }
+
+    /**
+     * 开始一次原子修改：复制当前配置
+     */
+    void beginUpdate();
+
+    /**
+     * 修改副本中的一个字段
+     * @param name/value 不要求 '\0' 结尾
+     */
+    ConfigResult stage(const char* name, size_t nameLength, const char* value, size_t valueLength);
+
+    /**
+     * 校验副本、写入 Flash 并生效
+     */
+    ConfigResult commit();
+
+    /**
+     * 恢复默认值（写入一条空记录）
+     */
+    ConfigResult reset();
+
+    /**
+     * 主循环调用（g_kvStore.update() 之后）：写入推迟的配置
+     */
+    void update();
+
+    bool isUnsaved() const { return unsaved; }
+
+    /**
+     * 处理 MQTT_TOPIC_CONFIG 上的消息
+     * @param publishAll 收到 get 时置为 true，由调用方 publish()
+     */
+    ConfigResult handleMessage(const uint8_t* payload, unsigned int length,
+                               char* reply, size_t replySize, bool& publishAll);
+
+    /**
+     * 处理一行控制台命令，结果以文本写入 out
+     * @return false 不是 config 命令
+     */
+    bool handleConsole(const char* line, size_t length, Print& out);
+
+    /**
+     * 写出全部配置 {"config":{"seq":12,"temp_high":30.0,...}}
+     */
+    size_t writeJSON(Print& out) const;
+
+    /**
+     * 流式发布全部配置（MQTT_TOPIC_STATUS）
+     */
+    bool publish(MQTTManager& mqtt) const;
+
+    uint32_t getSeq() const { return seq; }
+    const ConfigStats& getStats() const { return stats; }
+
+    static const char* resultText(ConfigResult result);
+};
+
+#endif
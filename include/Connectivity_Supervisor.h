@@ -0,0 +1,126 @@
+#ifndef CONNECTIVITY_SUPERVISOR_H
+#define CONNECTIVITY_SUPERVISOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "WiFi_Manager.h"
+#include "MQTT_Manager.h"
+
+/**
+ * 连接监管
+ * 统一决定何时重试各层连接，按依赖分层：
+ *   LINK     WiFi 链路
+ *   BROKER   MQTT 服务器（依赖链路）
+ *   WEATHER  天气请求（HTTP，只依赖链路）
+ * 下层断开时上层挂起，不再重试；下层恢复后上层在 [0, CONN_RESUME_JITTER) 内随机延迟后首次尝试，
+ * 避免大量设备在路由器或服务器恢复的同一秒一起重连
+ *
+ * 失败后按去相关抖动退避：delay = min(上限, random(CONN_BACKOFF_BASE, 上次 delay × 3))，
+ * 从第一次重试起就相互错开，且永不放弃；连接保持 CONN_STABLE_TIME 以上才清零，
+ * 连上即断的情况不会退回最短间隔
+ *
+ * 随机数以芯片 UID 为种子：同一批设备同时上电也各自错开；各层用独立的随机数序列，
+ * 回放时 MQTT 不连接也不影响链路与天气层的重试时刻
+ */
+
+/**
+ * 连接层（按依赖顺序）
+ */
+enum class ConnLayer : uint8_t {
+    LINK,
+    BROKER,
+    WEATHER,
+    COUNT
+};
+
+/**
+ * 层状态
+ */
+enum class ConnState : uint8_t {
+    SUSPENDED,            // 下层未连接，不尝试
+    BACKOFF,              // 等待下一次尝试
+    CONNECTING,           // 已发起，等待结果（只有链路是异步的）
+    UP
+};
+
+/**
+ * 每层的统计
+ */
+struct ConnLayerStats {
+    uint32_t attempts;
+    uint32_t failures;
+    uint16_t ups;                 // 连上（或服务请求成功）的次数
+    uint16_t losses;              // 连上后断开的次数
+    uint32_t longestOutage;       // 最长断开时间（毫秒）
+};
+
+class ConnectivitySupervisor {
+private:
+    struct Layer {
+        ConnState state;
+        uint8_t failures;         // 连续失败次数
+        uint32_t delay;           // 上次退避间隔（去相关抖动的基数）
+        uint32_t wait;            // 从 waitFrom 起等待多久再尝试
+        unsigned long waitFrom;   // 进入退避（或发起链路连接）的时刻
+        unsigned long since;      // 连上或断开的时刻
+        uint32_t rng;             // 本层的随机数状态
+        ConnLayerStats stats;
+    };
+
+    Layer layers[(uint8_t)ConnLayer::COUNT];
+    WiFiManager* wifi;
+    MQTTManager* mqtt;
+
+    static uint32_t randomBelow(Layer& l, uint32_t bound);
+
+    Layer& layer(ConnLayer id) { return layers[(uint8_t)id]; }
+    const Layer& layer(ConnLayer id) const { return layers[(uint8_t)id]; }
+
+    void markUp(ConnLayer id, unsigned long now);
+    void markDown(ConnLayer id, unsigned long now, bool failed);
+    void suspendAbove(ConnLayer id, unsigned long now);
+    void resumeAbove(ConnLayer id, unsigned long now);
+    bool parentUp(ConnLayer id) const;
+
+    static uint32_t backoffCap(ConnLayer id);
+    static const char* layerName(ConnLayer id);
+
+public:
+    ConnectivitySupervisor();
+
+    /**
+     * @param wifiManager/mqttManager 由本类决定何时调用它们的 connect()
+     */
+    void begin(WiFiManager* wifiManager, MQTTManager* mqttManager);
+
+    /**
+     * 随机数种子（begin() 时取芯片 UID，主机仿真可另行指定）
+     */
+    void setSeed(uint32_t seed);
+
+    /**
+     * 推进链路与 MQTT 层，应在主循环中调用（每次只读一次链路状态）
+     */
+    void update();
+
+    /**
+     * 服务层是否可以发起请求（下层已连接且退避已到期）
+     */
+    bool isReady(ConnLayer id) const;
+
+    /**
+     * 服务层报告请求结果：失败进入退避
+     */
+    void report(ConnLayer id, bool succeeded);
+
+    bool isUp(ConnLayer id) const { return layer(id).state == ConnState::UP; }
+    ConnState getState(ConnLayer id) const { return layer(id).state; }
+    const ConnLayerStats& getStats(ConnLayer id) const { return layer(id).stats; }
+
+    /**
+     * 下一次尝试还要等多久（毫秒），挂起或已连接时为 0
+     */
+    unsigned long getRetryIn(ConnLayer id) const;
+};
+
+#endif
@@ -16,6 +16,10 @@ private:
     float lastHumidity;
     unsigned long lastReadTime;
     bool isValid;
+    float tempHigh;           // 运行时阈值，默认取 config.h，可由设备影子下发
+    float tempLow;
+    float humidHigh;
+    float humidLow;
     
 public:
     DHTManager();
@@ -46,22 +50,32 @@ public:
     /**
      * 检查温度是否超过高阈值
      */
-    bool isTempHigh() const { return lastTemp > TEMP_HIGH_THRESHOLD; }
+    bool isTempHigh() const { return lastTemp > tempHigh; }
     
     /**
      * 检查温度是否低于低阈值
      */
-    bool isTempLow() const { return lastTemp < TEMP_LOW_THRESHOLD; }
+    bool isTempLow() const { return lastTemp < tempLow; }
     
     /**
      * 检查湿度是否超过高阈值
      */
-    bool isHumidityHigh() const { return lastHumidity > HUMID_HIGH_THRESHOLD; }
+    bool isHumidityHigh() const { return lastHumidity > humidHigh; }
     
     /**
      * 检查湿度是否低于低阈值
      */
-    bool isHumidityLow() const { return lastHumidity < HUMID_LOW_THRESHOLD; }
+    bool isHumidityLow() const { return lastHumidity < humidLow; }
+    
+    /**
+     * 设置温湿度阈值（低阈值须小于高阈值，否则忽略）
+     */
+    bool setThresholds(float tHigh, float tLow, float hHigh, float hLow);
+
+    float getTempHigh() const { return tempHigh; }
+    float getTempLow() const { return tempLow; }
+    float getHumidHigh() const { return humidHigh; }
+    float getHumidLow() const { return humidLow; }
     
     /**
      * 获取最后一次读取状态
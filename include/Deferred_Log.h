@@ -0,0 +1,273 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+#include <type_traits>
+#include "config.h"
+
+/**
+ * 延迟二进制日志
+ * 格式串在编译期哈希为 32 位 ID，固件中不保存格式串；日志调用只把
+ * [级别][ID][时间戳][原始参数] 编码成一帧写入环形缓冲区，由 DMA 经 USART1 在后台发出
+ * 主机端用 tools/log_decoder.py 扫描源码重建 ID -> 格式串字典，把二进制流还原为文本
+ *
+ * 帧格式（COBS 编码，0x00 分隔）：
+ *   [0]    级别
+ *   [1..4] 格式串 ID（小端）
+ *   [5..8] millis()（小端）
+ *   [9..]  参数：整数/枚举一律 4 字节，浮点为 4 字节 float，字符串为 1 字节长度 + 内容
+ *
+ * 格式串必须是字符串字面量（可由相邻字面量拼接），不能含宏
+ * 只能在主循环中调用；中断里不要写日志
+ *
+ * 非 STM32 编译时 USART/DMA 寄存器由内存中的模型代替，hostTransmit() 模拟一次 DMA 传输完成
+ */
+
+#define LOG_FRAME_MAX    64         // 单帧编码前最大字节数
+#define LOG_STRING_MAX   40         // 单个字符串参数最大字节数
+#define LOG_TEXT_MAX     48         // Print 接口单个文本帧最大字节数
+
+// 保留 ID
+#define LOG_ID_TEXT      0          // Print 接口写入的原始文本
+#define LOG_ID_DROPPED   1          // 缓冲区满丢弃的帧数
+#define LOG_ID_INPUT     2          // 输入录制记录（见 Input_Trace.h），不受级别过滤
+#define LOG_ID_RESERVED  3
+
+/**
+ * 格式串 ID：FNV-1a 32 位哈希，避开保留 ID
+ * 与 tools/log_decoder.py 中的算法保持一致
+ */
+constexpr uint32_t logFormatId(const char* fmt) {
+    uint32_t hash = 2166136261UL;
+    for (const char* p = fmt; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619UL;
+    }
+    return hash < LOG_ID_RESERVED ? hash + LOG_ID_RESERVED : hash;
+}
+
+/**
+ * 非零结尾的字节串参数（如 MQTT 负载）
+ */
+struct LogBytes {
+    const uint8_t* data;
+    uint16_t length;
+};
+
+inline LogBytes logBytes(const void* data, uint16_t length) {
+    return LogBytes{(const uint8_t*)data, length};
+}
+
+/**
+ * 单帧编码缓冲区，超出 LOG_FRAME_MAX 的参数被截断
+ */
+struct LogFrame {
+    uint8_t data[LOG_FRAME_MAX];
+    uint8_t length;
+
+    void put(const void* src, uint8_t n);
+    void putU32(uint32_t v);
+    void putString(const uint8_t* s, size_t n);
+};
+
+template <class T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+logArg(LogFrame& f, T v) {
+    f.putU32((uint32_t)(int32_t)v);
+}
+
+template <class T>
+inline typename std::enable_if<std::is_floating_point<T>::value>::type
+logArg(LogFrame& f, T v) {
+    float x = (float)v;
+    f.put(&x, sizeof(x));
+}
+
+inline void logArg(LogFrame& f, const char* s) {
+    f.putString((const uint8_t*)s, s ? strlen(s) : 0);
+}
+
+inline void logArg(LogFrame& f, const String& s) {
+    f.putString((const uint8_t*)s.c_str(), s.length());
+}
+
+inline void logArg(LogFrame& f, const LogBytes& b) {
+    f.putString(b.data, b.length);
+}
+
+#if !defined(ARDUINO_ARCH_STM32)
+/**
+ * 主机寄存器模型（字段名与 CMSIS 一致，只保留驱动用到的寄存器）
+ */
+struct LogUartModel {
+    uint32_t SR, DR, BRR, CR1, CR3;
+};
+
+struct LogDmaStreamModel {
+    uint32_t CR, NDTR, FCR;
+    uintptr_t PAR, M0AR;
+};
+
+struct LogDmaModel {
+    uint32_t HISR, HIFCR;
+};
+
+struct LogGpioModel {
+    uint32_t MODER, OSPEEDR;
+    uint32_t AFR[2];
+};
+#endif
+
+/**
+ * 日志统计
+ */
+struct LogStats {
+    uint32_t frames;          // 写入缓冲区的帧数
+    uint32_t bytes;           // 写入缓冲区的字节数（编码后）
+    uint32_t dropped;         // 缓冲区满丢弃的帧数
+    uint16_t highWater;       // 缓冲区最高占用（字节）
+};
+
+/**
+ * 延迟日志
+ * 单生产者（主循环）单消费者（DMA 完成中断）环形缓冲区，读写索引各由一方独占修改，无需关中断
+ * 同时实现 Print 接口，printReport() 之类的文本输出写成文本帧，同样走 DMA
+ */
+class DeferredLog : public Print {
+private:
+    uint8_t ring[LOG_BUFFER_SIZE];
+    volatile uint16_t head;           // 生产者写入位置（自由增长，取模得下标）
+    volatile uint16_t tail;           // 消费者读取位置
+    volatile uint16_t inFlight;       // 正在由 DMA 发送的字节数，0 表示 DMA 空闲
+
+    uint8_t level;                    // 运行时级别
+    uint32_t pendingDrops;            // 尚未报告的丢帧数
+
+    uint8_t text[LOG_TEXT_MAX];       // Print 接口的行缓冲
+    uint8_t textLength;
+
+    uint8_t console[LOG_CONSOLE_BUFFER];  // 控制台接收缓冲区，由 DMA 循环写入
+    uint16_t consoleTail;             // 下一个未读字节的下标
+
+    LogStats stats;
+
+    static DeferredLog* instance;
+
+    void beginFrame(LogFrame& f, uint8_t frameLevel, uint32_t id);
+
+    /**
+     * COBS 编码后写入环形缓冲区
+     * @return false 空间不足
+     */
+    bool store(const LogFrame& f);
+
+    /**
+     * 写入一帧，空间不足时整帧丢弃并在下一帧之前补报丢帧数
+     */
+    bool commit(const LogFrame& f);
+
+    void flushText();
+
+    /**
+     * DMA 空闲时发送环形缓冲区中连续的一段
+     */
+    void startTransfer();
+
+public:
+    DeferredLog();
+
+    /**
+     * 初始化 USART1（PA9 TX、PA10 RX）与 DMA2 数据流 7（发送）、数据流 5（接收）
+     */
+    void begin(uint32_t baud = LOG_UART_BAUD);
+
+    /**
+     * 读取控制台收到的字节（USART1 RX 由 DMA 循环接收，两次读取之间超过
+     * LOG_CONSOLE_BUFFER 字节时旧数据被覆盖）
+     * @return 读出的字节数
+     */
+    size_t readConsole(uint8_t* out, size_t capacity);
+
+    /**
+     * 主循环空闲时调用：DMA 空闲且缓冲区有数据时启动发送
+     */
+    void update();
+
+    /**
+     * 运行时级别，低于该级别的日志不写入缓冲区
+     */
+    void setLevel(uint8_t newLevel) { level = newLevel; }
+    uint8_t getLevel() const { return level; }
+    bool enabled(uint8_t frameLevel) const { return frameLevel >= level; }
+
+    /**
+     * 写一帧日志（通常经由 LOG_* 宏调用）
+     */
+    template <class... Args>
+    void emit(uint8_t frameLevel, uint32_t id, const Args&... args) {
+        if (!enabled(frameLevel)) {
+            return;
+        }
+        LogFrame f;
+        beginFrame(f, frameLevel, id);
+        int expand[] = {0, (logArg(f, args), 0)...};
+        (void)expand;
+        commit(f);
+    }
+
+    /**
+     * 写一帧输入录制记录，不受运行时级别影响
+     * @return false 缓冲区满被丢弃
+     */
+    bool record(const uint8_t* data, uint8_t length);
+
+    // Print 接口：按行打包成文本帧
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    /**
+     * DMA 传输完成中断
+     */
+    void handleDmaInterrupt();
+
+    uint16_t getPending() const { return (uint16_t)(head - tail); }
+    const LogStats& getStats() const { return stats; }
+
+    static DeferredLog* getInstance() { return instance; }
+
+#if !defined(ARDUINO_ARCH_STM32)
+    /**
+     * 主机模型：完成当前 DMA 传输，把发出的字节追加到 out
+     * @return 发出的字节数
+     */
+    static size_t hostTransmit(uint8_t* out, size_t capacity);
+
+    static const LogUartModel& hostUart();
+    static const LogDmaStreamModel& hostDmaStream();
+
+    /**
+     * 主机模型：控制台收到字节，按循环 DMA 写入接收缓冲区
+     */
+    static void hostReceive(const uint8_t* data, size_t length);
+#endif
+};
+
+extern DeferredLog g_log;
+
+/**
+ * 日志宏：编译期级别过滤，格式串在编译期换算为 ID，参数仅在级别开启时求值
+ */
+#define LOG_AT(lvl, fmt, ...)                                                         \
+    do {                                                                              \
+        if ((lvl) >= LOG_COMPILE_LEVEL && g_log.enabled(lvl)) {                       \
+            g_log.emit((lvl), std::integral_constant<uint32_t, logFormatId(fmt)>::value,  \
+                       ##__VA_ARGS__);                                                \
+        }                                                                             \
+    } while (0)
+
+#define LOG_DEBUG(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)  LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)  LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef DEVICE_SHADOW_H
+#define DEVICE_SHADOW_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "MQTT_Manager.h"
+#include "Json_Writer.h"
+
+/**
+ * 设备影子
+ * 后端保存期望状态（desired），设备上报实际状态（reported），两边各带一个递增版本号：
+ *   d  期望版本：后端每改一次期望状态加一，设备记录已应用到的版本
+ *   r  报告版本：设备每次有字段变化加一，每个字段记下最后变化时的版本
+ *
+ * 重连握手只交换版本号，之后只传变化的字段：
+ *   设备 -> 后端  {"d":5,"r":12}
+ *   后端 -> 设备  {"d":7,"base":5,"r":10,"set":{"mode":"quiet"}}
+ *                 set 为版本 base 之后改过的期望字段（base 缺省为 0，即全部），r 为后端已有的报告版本
+ *   设备 -> 后端  {"d":7,"r":12,"base":10,"set":{"emotion":"happy"}}
+ *                 set 为版本 base 之后变化的实际字段；期望与报告都已一致时不发任何消息
+ *
+ * 平时后端改期望状态时按同样格式推送增量，设备应用后回一条带新 d 的消息作确认；
+ * 实际状态变化时按 SHADOW_REPORT_INTERVAL 合并上报增量。后端收到的 base 与自己的
+ * 报告版本对不上（丢了消息）时，回一条只带 d/r 的消息，设备从该版本起重发
+ *
+ * 期望版本出现空洞（base 大于已应用版本）时，设备重新握手；
+ * 后端的 r 大于设备的报告版本（设备重启过）时，设备跳到其后并上报全部字段
+ */
+
+/**
+ * 影子字段（值统一存为 int16：枚举存序号，阈值存 0.1 单位的定点数）
+ */
+enum class ShadowField : uint8_t {
+    EMOTION,
+    MODE,
+    TEMP_HIGH,            // 温度高阈值（0.1℃）
+    TEMP_LOW,
+    HUMID_HIGH,           // 湿度高阈值（0.1%RH）
+    HUMID_LOW,
+    COUNT
+};
+
+struct ShadowState {
+    int16_t value[(uint8_t)ShadowField::COUNT];
+
+    int16_t get(ShadowField field) const { return value[(uint8_t)field]; }
+    void set(ShadowField field, int16_t v) { value[(uint8_t)field] = v; }
+};
+
+/**
+ * 期望状态回调
+ * @param changed 本次改变的字段位图（第 i 位对应 ShadowField 第 i 项）
+ */
+typedef void (*ShadowDesiredHandler)(const ShadowState& desired, uint8_t changed);
+
+/**
+ * 流量统计（主题与 MQTT 报文头不计入）
+ */
+struct ShadowStats {
+    uint32_t bytesSent;
+    uint32_t bytesReceived;
+    uint16_t messagesSent;
+    uint16_t messagesReceived;
+    uint16_t syncs;               // 完成的握手次数
+    uint16_t rejected;            // 被拒绝的下行消息数
+};
+
+class DeviceShadow {
+private:
+    // 待发送的消息
+    enum class Pending : uint8_t {
+        NONE,
+        HELLO,                    // 握手：只带版本号
+        DELTA                     // 实际状态增量（或期望版本确认）
+    };
+
+    ShadowState reported;                                   // 最近一次上报时采集的实际状态
+    uint32_t fieldVersion[(uint8_t)ShadowField::COUNT];     // 各字段最后变化时的报告版本
+    uint32_t reportedVersion;
+    uint32_t backendVersion;      // 后端已有的报告版本（发出增量后按已送达估计）
+    ShadowState desired;
+    uint8_t desiredMask;          // 后端设置过的字段
+    uint32_t desiredVersion;      // 已应用的期望版本
+
+    bool online;
+    bool synced;                  // 本次连接已完成握手
+    bool fresh;                   // 启动后尚未握手：后端的报告版本可能来自上次启动
+    bool replyDue;                // 立即回复：已应用新的期望版本，或后端要求报告增量
+    bool helloDue;                // 立即握手（刚连上或期望版本有空洞）
+    Pending pending;
+    unsigned long lastHello;
+    unsigned long lastReport;
+
+    ShadowDesiredHandler handler;
+    ShadowStats stats;
+
+    void writeFields(JsonWriter& json, uint32_t since) const;
+
+public:
+    DeviceShadow();
+
+    /**
+     * 以当前实际状态初始化（期望状态初始与之相同）
+     */
+    void begin(const ShadowState& actual);
+
+    void setDesiredHandler(ShadowDesiredHandler desiredHandler) { handler = desiredHandler; }
+
+    /**
+     * 周期调用：比较实际状态、跟踪连接，决定是否有消息要发
+     */
+    void update(const ShadowState& actual, bool connected, unsigned long now);
+
+    /**
+     * 处理后端消息（MQTT_TOPIC_SHADOW_DESIRED）
+     * 整条消息校验通过后才应用，有字段改变时调用期望状态回调
+     * @return false 消息格式或取值无效
+     */
+    bool handleMessage(const uint8_t* payload, unsigned int length);
+
+    bool hasPending() const { return pending != Pending::NONE; }
+
+    /**
+     * 写出待发送的消息；不改变状态，可写两遍（先求长度再写报文）
+     * @return 写出的字节数
+     */
+    size_t writePending(Print& out) const;
+
+    /**
+     * 待发送的消息已送出
+     * @param bytes 消息字节数（计入统计）
+     */
+    void markSent(unsigned long now, size_t bytes);
+
+    /**
+     * 流式发布待发送的消息（MQTT_TOPIC_SHADOW_REPORTED）
+     */
+    bool publish(MQTTManager& mqtt, unsigned long now);
+
+    const ShadowState& getDesired() const { return desired; }
+    uint32_t getReportedVersion() const { return reportedVersion; }
+    uint32_t getDesiredVersion() const { return desiredVersion; }
+    bool isSynced() const { return synced; }
+    const ShadowStats& getStats() const { return stats; }
+
+    /**
+     * 字段名（JSON 键）
+     */
+    static const char* fieldName(ShadowField field);
+};
+
+#endif
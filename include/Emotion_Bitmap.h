@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <U8g2lib.h>
+#include "Weather_Codes.h"
 
 /**
  * 表情库 - 像素级表情绘制
@@ -302,6 +303,18 @@ static const unsigned char BITMAP_CLOUD[] PROGMEM = {
     0x00, 0x07, 0xFE, 0x00,
 };
 
+// 天气类型 -> 图标（按 WeatherType 顺序，nullptr 表示不绘制）
+static const unsigned char* const WEATHER_ICON_TABLE[WEATHER_TYPE_COUNT] = {
+    BITMAP_SUN,     // SUNNY
+    BITMAP_CLOUD,   // CLOUDY
+    BITMAP_RAIN,    // RAINY
+    nullptr,        // SNOWY
+    BITMAP_RAIN,    // STORMY
+    BITMAP_CLOUD,   // FOGGY
+    nullptr,        // WINDY
+    nullptr         // UNKNOWN
+};
+
 // ==================== 表情管理类 ====================
 
 class EmotionBitmapLibrary {
@@ -338,15 +351,10 @@ public:
     /**
      * 绘制天气图标
      */
-    void drawWeatherIcon(const char* weather, uint8_t x, uint8_t y) {
-        if (strstr(weather, "晴") || strstr(weather, "sunny")) {
-            drawEmotionBitmap(BITMAP_SUN, x, y, 32, 16);
-        } 
-        else if (strstr(weather, "雨") || strstr(weather, "rain")) {
-            drawEmotionBitmap(BITMAP_RAIN, x, y, 32, 16);
-        }
-        else if (strstr(weather, "云") || strstr(weather, "cloud")) {
-            drawEmotionBitmap(BITMAP_CLOUD, x, y, 32, 16);
+    void drawWeatherIcon(WeatherType type, uint8_t x, uint8_t y) {
+        const unsigned char* icon = WEATHER_ICON_TABLE[(uint8_t)type];
+        if (icon) {
+            drawEmotionBitmap(icon, x, y, 32, 16);
         }
     }
     
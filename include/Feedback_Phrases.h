@@ -0,0 +1,88 @@
+#ifndef FEEDBACK_PHRASES_H
+#define FEEDBACK_PHRASES_H
+
+#include <Arduino.h>
+#include "Weather_Codes.h"
+
+/**
+ * 反馈短语表
+ * 播报与建议文本全部存放在闪存短语表中；选词函数只根据读数返回短语下标，
+ * 不分配内存、不触发反馈动作，由调用方把下标拼入自备的缓冲区
+ */
+
+#define PHRASE_MAX_LEN      24      // 单条短语最大长度（含结尾 '\0'）
+#define PHRASE_LIST_MAX     2       // 一句话最多由几条短语组成
+#define PHRASE_BUFFER_SIZE  (PHRASE_LIST_MAX * PHRASE_MAX_LEN)  // 可容纳任意组合的缓冲区大小
+
+/**
+ * 短语下标（与短语表顺序一致）
+ */
+enum class Phrase : uint8_t {
+    // 温度播报
+    TOO_HOT,            // Too hot! Stay cool!
+    SO_COLD,            // So cold! Keep warm!
+    FEELING_WARM,       // Feeling warm today
+    CHILLY,             // It's chilly outside
+    TEMP_PERFECT,       // Temperature is perfect
+    // 湿度播报
+    HUMIDITY_HIGH,      // Humidity is high
+    AIR_DRY,            // Air is dry
+    // 天气建议
+    ADVICE_HOT,         // Hot! Stay cool
+    ADVICE_COLD,        // Cold! Keep warm
+    ADVICE_HUMID,       // Humid, bring umbrella
+    ADVICE_COMFORTABLE, // Comfortable weather
+    ADVICE_RAINY,       // Bring an umbrella
+    ADVICE_SNOWY,       // Snowy, dress warmly
+    ADVICE_STORMY,      // Storm! Stay indoors
+    ADVICE_FOGGY,       // Poor air, wear a mask
+    ADVICE_WINDY,       // Windy, hold your hat
+    COUNT
+};
+
+/**
+ * 温度档位
+ */
+enum class ThermalLevel : uint8_t {
+    HOT,                // > 32°C
+    WARM,               // > 28°C
+    COMFORTABLE,
+    CHILLY,             // < 15°C
+    COLD                // < 10°C
+};
+
+/**
+ * 一句话的短语组成
+ */
+struct PhraseList {
+    Phrase items[PHRASE_LIST_MAX];
+    uint8_t count;
+};
+
+/**
+ * 温度 -> 档位
+ */
+ThermalLevel thermalLevel(float temp);
+
+/**
+ * 温湿度播报的短语组成：温度档位一条，湿度偏高/偏低时再加一条
+ */
+PhraseList thermalPhrases(float temp, float humidity);
+
+/**
+ * 天气建议短语：极端温度与高湿度优先，否则按天气类型
+ */
+Phrase weatherAdvicePhrase(WeatherType type, float temp, float humidity);
+
+/**
+ * 短语文字（存放于闪存）
+ */
+const char* phraseText(Phrase phrase);
+
+/**
+ * 把短语以空格连接写入 buffer，超出部分截断，结果总以 '\0' 结尾
+ * @return 写入的字符数（不含 '\0'）
+ */
+size_t composePhrases(const PhraseList& list, char* buffer, size_t size);
+
+#endif
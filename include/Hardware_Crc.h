@@ -0,0 +1,22 @@
+#ifndef HARDWARE_CRC_H
+#define HARDWARE_CRC_H
+
+#include <Arduino.h>
+
+/**
+ * STM32 硬件 CRC 单元
+ * CRC-32/MPEG-2：多项式 0x04C11DB7，初值 0xFFFFFFFF，不反射，不异或输出
+ * 按 32 位字输入：字节按小端拼成字，末尾不足一字的部分补 0xFF
+ * （与 Flash 中补齐到 4 字节的记录一致，补齐前后的 CRC 相同）
+ * hwCrc32() 从复位值开始；前一段长度为 4 的整数倍时可用 hwCrc32Append() 接着算下一段
+ *
+ * 非 STM32 编译时用逐位计算的软件模型代替，结果与硬件一致
+ */
+uint32_t hwCrc32(const uint8_t* data, size_t length);
+
+/**
+ * 接着上一次 hwCrc32()/hwCrc32Append() 的结果继续计算（中间不能插入其他 CRC 计算）
+ */
+uint32_t hwCrc32Append(const uint8_t* data, size_t length);
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef INPUT_TRACE_H
+#define INPUT_TRACE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "Deferred_Log.h"
+#include "Weather_Service.h"
+
+/**
+ * 外部输入录制与回放
+ * 所有外部输入（loop() 时刻、DHT 读数、ASRPRO 串口字节、WiFi 连接状态、MQTT 消息、
+ * 天气结果、控制台字节、启动时从 Flash 载入的配置）都在读取处经过 g_inputTrace：
+ *   录制：原样返回实时值，同时写成一条记录，经延迟日志的输入帧发出
+ *   回放：忽略实时值，按记录顺序返回录制时的值
+ * 各模块调用顺序固定，因此记录按顺序消费即可与录制时一一对应
+ *
+ * 记录格式：[类型][内容]，时间取自日志帧头
+ * 用 tools/log_decoder.py --extract-inputs 从日志流中提取为回放文件（[长度][帧] 序列）
+ * 主机回放驱动在 test/test_replay（pio test -e native_replay），耗时报告用 tools/replay_report.py
+ *
+ * 录制时定期写入输出摘要检查点，回放到同一 loop() 时比较，用于发现行为偏差
+ */
+
+#define INPUT_RECORD_MAX  (LOG_FRAME_MAX - 9)  // 单条记录最大字节数（扣除日志帧头）
+#define INPUT_TOPIC_MAX   64                   // 回放 MQTT 主题缓冲区
+#define INPUT_MESSAGE_MAX 256                  // 回放 MQTT 负载缓冲区
+
+enum class InputTraceMode : uint8_t {
+    OFF,
+    RECORD,
+    REPLAY
+};
+
+enum class InputRecordKind : uint8_t {
+    LOOP,          // [首次时刻 u32][此后各次 loop() 与上一次的间隔 u8 ...]
+    CLOCK,         // [millis u32]：loop() 内耗时步骤之后的时间同步点
+    DHT,           // [温度 f32][湿度 f32]，读取失败为 NaN
+    VOICE,         // ASRPRO 串口收到的原始字节
+    LINK,          // [是否连接 u8]：WiFi 连接状态变化
+    MQTT_TOPIC,    // MQTT 消息主题
+    MQTT_DATA,     // MQTT 消息负载分段
+    MQTT_END,      // MQTT 消息结束
+    WEATHER,       // [是否更新 u8][WeatherData]
+    CHECKPOINT,    // [输出摘要 u32]
+    CONSOLE,       // 控制台（USART1 RX）收到的原始字节
+    CONFIG         // 启动时载入的配置记录分段，以空记录结束
+};
+
+/**
+ * 回放统计
+ */
+struct InputReplayStats {
+    uint32_t loops;               // 回放的 loop() 次数
+    uint32_t records;             // 消费的记录数
+    uint32_t mismatches;          // 调用处期望的记录不存在
+    uint32_t skipped;             // 未被任何调用处消费、被跳过的记录
+    uint32_t checkpoints;         // 比较过的检查点
+    uint32_t checkpointFailures;  // 输出摘要不一致的检查点
+    uint32_t firstFailureTime;    // 第一次摘要不一致时的 millis()
+    uint32_t simulatedMs;         // 回放覆盖的设备时间
+    uint32_t wallUs;              // 回放实际耗时（微秒）
+    bool finished;
+};
+
+/**
+ * 回放时设置 millis() 的回调（主机构建提供）
+ */
+typedef void (*InputClockSetter)(uint32_t now);
+
+/**
+ * 输出摘要：由 main.cpp 根据各模块状态计算
+ */
+typedef uint32_t (*InputDigestFn)();
+
+class InputTrace {
+private:
+    InputTraceMode mode;
+    InputDigestFn digest;
+    bool linkState;
+
+    // 录制
+    uint8_t loopRecord[INPUT_RECORD_MAX];
+    uint8_t loopLength;           // 0 表示没有未发出的 LOOP 记录
+    uint32_t lastLoopTime;
+    uint32_t lastClock;
+    uint32_t lastCheckpoint;
+
+    // 回放
+    const uint8_t* trace;
+    size_t traceLength;
+    size_t cursor;                // 下一帧的偏移
+    const uint8_t* loopDeltas;    // 当前 LOOP 记录中尚未回放的间隔
+    uint8_t loopPending;          // 当前 LOOP 记录中尚未回放的 loop() 次数
+    uint32_t loopTime;
+    uint32_t firstLoopTime;
+    uint32_t replayStartUs;
+    InputClockSetter setClock;
+    InputReplayStats stats;
+
+    void record(InputRecordKind kind, const void* data, uint8_t length);
+
+    /**
+     * 单条记录即可容纳的字节流输入（ASRPRO、控制台）
+     */
+    size_t traceBytes(InputRecordKind kind, uint8_t* buffer, size_t length, size_t capacity);
+    void flushLoops();
+
+    /**
+     * 回放：读取 cursor 处的记录（不移动 cursor）
+     */
+    bool nextRecord(InputRecordKind& kind, const uint8_t*& payload, uint8_t& length);
+
+    /**
+     * 回放：当前 loop() 的下一条记录是否为 kind
+     * 只有 LOOP 记录的最后一次 loop() 之后才跟有输入记录
+     */
+    bool peek(InputRecordKind kind, const uint8_t*& payload, uint8_t& length);
+    void consume();
+    void finishReplay();
+
+public:
+    InputTrace();
+
+    /**
+     * 开始录制（setup() 最早处调用，需先初始化 g_log）
+     */
+    void beginRecording();
+
+    /**
+     * 开始回放，在 setup() 之前调用
+     * @param data   --extract-inputs 产生的回放文件内容
+     * @param clock  设置 millis() 的回调
+     */
+    void beginReplay(const uint8_t* data, size_t length, InputClockSetter clock);
+
+    void setDigest(InputDigestFn fn) { digest = fn; }
+
+    bool isRecording() const { return mode == InputTraceMode::RECORD; }
+    bool isReplaying() const { return mode == InputTraceMode::REPLAY; }
+
+    /**
+     * 每次 loop() 开头调用
+     * 回放时把 millis() 设为录制时的时刻，并比较检查点
+     * @return false 回放结束
+     */
+    bool beginLoop();
+
+    /**
+     * loop() 内可能耗时的步骤之后调用，同步 millis()
+     */
+    void syncClock();
+
+    void traceDht(float& temperature, float& humidity);
+
+    /**
+     * @param buffer   实时读到的字节，回放时被录制内容替换
+     * @param length   实时字节数
+     * @return 实际字节数
+     */
+    size_t traceVoice(uint8_t* buffer, size_t length, size_t capacity);
+
+    /**
+     * 控制台字节，参数同 traceVoice
+     */
+    size_t traceConsole(uint8_t* buffer, size_t length, size_t capacity);
+
+    /**
+     * 启动时载入的配置记录（Flash 内容不随录制保存，回放时替换为录制的内容）
+     * @return 实际字节数
+     */
+    size_t traceConfig(uint8_t* buffer, size_t length, size_t capacity);
+
+    bool traceLink(bool connected);
+
+    void recordMessage(const char* topic, const uint8_t* payload, unsigned int length);
+
+    /**
+     * 回放：取出当前位置的一条 MQTT 消息
+     * @return false 当前位置没有消息
+     */
+    bool replayMessage(char* topic, size_t topicCapacity,
+                       uint8_t* payload, size_t payloadCapacity, unsigned int& length);
+
+    /**
+     * @param updated 实时获取是否成功，回放时被录制结果替换
+     * @param weather 获取后的天气数据，回放时被录制内容替换
+     */
+    bool traceWeather(bool updated, WeatherData& weather);
+
+    const InputReplayStats& getReplayStats() const { return stats; }
+};
+
+extern InputTrace g_inputTrace;
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef JSON_TOKENIZER_H
+#define JSON_TOKENIZER_H
+
+#include <Arduino.h>
+
+/**
+ * 就地 JSON 分词器
+ * 直接扫描 MQTT 负载（不要求 '\0' 结尾），把每个值记录为指向原缓冲区的
+ * [起点, 长度] 词元，写入调用方提供的定长数组；不复制、不分配内存
+ * 字符串词元不含引号，转义序列只做语法检查、不解码
+ *
+ * 对象的词元之后依次是 键、值、键、值 ...；每个词元的 next 指向其子树之后的
+ * 第一个词元，遍历时可直接跳过嵌套的对象与数组
+ */
+
+#define JSON_MAX_DEPTH 8        // 对象/数组最大嵌套层数
+
+/**
+ * 词元类型
+ */
+enum class JsonType : uint8_t {
+    OBJECT,
+    ARRAY,
+    STRING,
+    PRIMITIVE       // 数字、true、false、null
+};
+
+/**
+ * 分词结果
+ */
+enum class JsonError : uint8_t {
+    NONE,
+    NO_MEMORY,      // 词元数组已满
+    INVALID,        // 语法错误
+    PARTIAL,        // 负载在值中途结束
+    TOO_DEEP        // 嵌套超过 JSON_MAX_DEPTH
+};
+
+struct JsonToken {
+    JsonType type;
+    uint16_t start;         // 在负载中的起点（字符串不含引号）
+    uint16_t length;
+    uint16_t size;          // 对象为键数，数组为元素数
+    uint16_t next;          // 子树之后的第一个词元下标
+};
+
+/**
+ * 分词
+ * @param count 成功时为词元数，第 0 个词元是顶层值
+ */
+JsonError jsonTokenize(const char* json, size_t length, JsonToken* tokens, uint16_t capacity,
+                       uint16_t& count);
+
+/**
+ * 在对象词元 object 中查找键 key（区分大小写）
+ * @return 值词元下标，找不到时返回 -1
+ */
+int16_t jsonFind(const char* json, const JsonToken* tokens, uint16_t object, const char* key);
+
+/**
+ * 字符串词元与 text 是否相同
+ */
+bool jsonEquals(const char* json, const JsonToken& token, const char* text);
+
+/**
+ * 把整数词元转换为 int32_t，不是整数或超出范围时返回 false
+ */
+bool jsonToInt(const char* json, const JsonToken& token, int32_t& value);
+
+/**
+ * 把数字词元转换为定点整数（乘以 10^decimals），多余的小数位四舍五入
+ * 带指数、不是数字或超出 int32 范围时返回 false
+ */
+bool jsonToFixed(const char* json, const JsonToken& token, uint8_t decimals, int32_t& value);
+
+const char* jsonErrorText(JsonError error);
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+
+/**
+ * 流式 JSON 写出
+ * 直接写入任意 Print（如 PubSubClient 的报文流），不建文档、不经中间缓冲、不分配内存
+ * 小数以定点整数格式化，不依赖 printf 的浮点支持
+ *
+ * MQTT 报文头需要事先知道长度：先把同一内容写入 PrintCounter 求出长度，
+ * 再 beginPublish(长度) 后写入报文，两次写出的内容必须完全相同
+ */
+
+#define JSON_MAX_NESTING 8      // 对象/数组最大嵌套层数，更深的对象/数组写为 null
+#define JSON_NUMBER_MAX  13     // 格式化一个 int32 定点数所需的最大字节数（含 '\0'）
+
+static_assert(JSON_MAX_NESTING <= 8, "JsonWriter tracks members per level in a uint8_t bitmap");
+
+/**
+ * 只计数、不输出的 Print
+ */
+class PrintCounter : public Print {
+private:
+    size_t count;
+
+public:
+    PrintCounter() : count(0) {}
+
+    size_t write(uint8_t) override {
+        count++;
+        return 1;
+    }
+
+    size_t write(const uint8_t*, size_t size) override {
+        count += size;
+        return size;
+    }
+
+    using Print::write;
+
+    size_t getCount() const { return count; }
+};
+
+/**
+ * 浮点 -> 定点整数（乘以 10^decimals 后四舍五入）
+ */
+int32_t jsonFixedFromFloat(float value, uint8_t decimals);
+
+/**
+ * 定点整数 -> 十进制文本，如 (-235, 1) -> "-23.5"；decimals 最大为 9
+ * @param out 至少 JSON_NUMBER_MAX 字节
+ * @return 文本长度
+ */
+size_t jsonFormatFixed(int32_t value, uint8_t decimals, char* out);
+
+class JsonWriter {
+private:
+    Print& out;
+    size_t written;
+    uint8_t depth;
+    uint8_t hasMember;        // 按层的位图：该层已有成员，下一个成员前需要逗号
+    uint16_t overflow;        // 超过 JSON_MAX_NESTING 的层数，其中的内容全部丢弃
+    bool afterKey;            // 刚写完键，下一个值前不加逗号
+    bool truncatedOutput;
+
+    void raw(const char* text, size_t length);
+    void separator();
+    void quoted(const char* text);
+    void beginNested(char bracket);
+    bool endNested();
+
+public:
+    explicit JsonWriter(Print& target);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    /**
+     * 对象成员的键，其后必须紧跟一个值
+     */
+    void key(const char* name);
+
+    void string(const char* text);
+    void integer(int32_t value);
+    void unsignedInteger(uint32_t value);
+    void fixed(int32_t value, uint8_t decimals);
+
+    /**
+     * 浮点按 decimals 位小数输出，NaN 与无穷写为 null
+     */
+    void number(float value, uint8_t decimals);
+
+    void boolean(bool value);
+    void null();
+
+    /**
+     * 已写出的字节数
+     */
+    size_t size() const { return written; }
+
+    /**
+     * 是否有对象/数组因超过 JSON_MAX_NESTING 被写为 null
+     */
+    bool truncated() const { return truncatedOutput; }
+};
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef KV_STORE_H
+#define KV_STORE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Flash 键值存储
+ * 从 KV_FLASH_SECTOR 起的 KV_SECTOR_COUNT 个扇区组成一个环形日志，写入只追加，不原地改写：
+ *   扇区头  [魔数 'KVS1' u32][序号 u32][~序号 u32]      序号按打开顺序递增，决定扇区的先后
+ *   记录    [键 u16][长度 u16][CRC u32][值，补齐到 4 字节]
+ *           CRC 为硬件 CRC（见 Hardware_Crc.h），覆盖键、长度与值；长度 KV_LENGTH_DELETED 表示删除
+ * 同一个键以日志中最后一条 CRC 正确的记录为准；启动时按序号遍历全部扇区，在 RAM 中建立
+ * 键 -> 位置的索引，之后的读取直接返回指向 Flash 的指针
+ *
+ * 掉电安全：记录按地址顺序编程，写到一半断电只会留下 CRC 不符的记录，启动时按长度跳过，
+ * 该键仍取上一条；长度字段本身损坏时向后逐字搜索下一条 CRC 正确的记录
+ *
+ * 回收：最后一个空扇区被打开后，最旧的扇区进入回收——其中仍是最新的记录在空闲时
+ * （update(true)）逐条复制到当前扇区，复制完后擦除，成为新的空扇区。各扇区轮流擦除，磨损均匀
+ * 复制与擦除都可在任意时刻断电：复制出的是相同内容的较新记录；擦除前先把扇区头编程为 0，
+ * 未擦完的扇区启动时没有有效扇区头，之后重新擦除
+ * 写入从不擦除（128KB 扇区约 1~2 秒，单 Bank Flash 擦除期间 CPU 取指停顿，串口接收中断也被推迟）：
+ * 当前扇区放不下、而回收还没复制完或下一个空扇区还没擦除时返回 BUSY，
+ * 调用方在 update(true) 完成回收之后重试；打开一个已擦除的空扇区只编程扇区头，可在写入中完成
+ *
+ * 有效数据总量不超过一个扇区（减去一条最大记录的余量），更多扇区只减少回收次数
+ *
+ * 非 STM32 编译时 Flash 由内存中的模型代替：擦除为 0xFF，编程只能把 1 写成 0，
+ * 按数据手册的典型时间计时，并可在任意一次编程/擦除中途模拟断电
+ */
+
+#define KV_SECTOR_MAGIC    0x3153564BUL  // "KVS1"
+#define KV_SECTOR_HEADER   12
+#define KV_RECORD_HEADER   8
+#define KV_LENGTH_DELETED  0xFFFE
+#define KV_KEY_NONE        0xFFFF        // 擦除后的 Flash
+
+// 键分配（发布后不再改变）
+#define KV_KEY_CONFIG       0x0001       // 运行时配置（Config_Store.h）
+#define KV_KEY_CHOREO       0x0100       // 编舞脚本，+ 槽位（Choreography_Store.h）
+
+/**
+ * 操作结果
+ */
+enum class KvResult : uint8_t {
+    OK,
+    NOT_FOUND,
+    TOO_LARGE,            // 值超过 KV_VALUE_MAX
+    FULL,                 // 有效数据已达容量，或键数达到 KV_MAX_KEYS
+    BUSY,                 // 需要先完成回收（复制或擦除），空闲时 update(true) 之后重试
+    FLASH_ERROR           // 擦除或编程失败
+};
+
+/**
+ * 擦除扇区前的回调（就地使用 Flash 中数据的模块在此停止使用 [begin, end)）
+ */
+typedef void (*KvEraseHandler)(const uint8_t* begin, const uint8_t* end);
+
+/**
+ * 统计
+ */
+struct KvStats {
+    uint32_t wordsProgrammed;     // 编程的字数（含回收复制）
+    uint32_t wordsCopied;         // 其中回收复制的字数
+    uint32_t flashMicros;         // 编程与擦除累计耗时
+    uint32_t maxStallMicros;      // 单次 put()/remove() 的最长耗时（不含擦除）
+    uint16_t erases;
+    uint16_t reclaims;            // 完成回收的扇区数
+    uint16_t busy;                // 因回收未完成返回 BUSY 的写入次数
+    uint16_t copyFailures;        // 回收复制失败（编程或校验出错）后重试的次数
+    uint16_t corruptRecords;      // 启动时跳过的损坏记录（断电留下的半条记录）
+    uint16_t recordsScanned;      // 启动时遍历的记录数
+    uint32_t bootMicros;          // 启动扫描耗时
+    uint32_t headSeq;             // 当前扇区序号（每打开一个扇区加一，约等于总擦除次数）
+};
+
+class KvStore {
+private:
+    // 索引：每个键最新记录的位置
+    struct Entry {
+        uint16_t key;
+        uint16_t length;
+        uint32_t offset;          // 记录在整个区域中的偏移
+    };
+
+    Entry entries[KV_MAX_KEYS];
+    uint8_t entryCount;
+
+    uint32_t sectorSeq[KV_SECTOR_COUNT];    // 0 表示空扇区（或待擦除）
+    bool sectorDirty[KV_SECTOR_COUNT];      // 内容无效、需要擦除
+    uint8_t head;                 // 当前写入的扇区
+    uint32_t writeOffset;         // 当前扇区中第一个空闲字节
+
+    int8_t reclaimSector;         // 正在回收的扇区，-1 表示没有
+    uint32_t reclaimOffset;       // 回收进度（扇区内偏移）
+    uint32_t liveBytes;           // 全部有效记录（含头部）的字节数
+
+    KvEraseHandler eraseHandler;
+    KvStats stats;
+
+    Entry* findEntry(uint16_t key);
+    const Entry* findEntry(uint16_t key) const;
+    bool nextRecord(uint8_t sector, uint32_t& offset, bool countCorrupt);
+    void scanSector(uint8_t sector);
+    void applyRecord(uint16_t key, uint16_t length, uint32_t offset);
+
+    bool eraseSector(uint8_t sector);
+    bool programWord(uint32_t offset, uint32_t word);
+    bool openSector();
+    KvResult makeRoom(uint32_t size);
+    KvResult append(uint16_t key, const uint8_t* value, uint16_t length, uint32_t& offset);
+    bool reclaimStep(uint32_t budget);
+    uint32_t pendingCopyBytes() const;
+    void finishStall(uint32_t start);
+    void reportFailure(uint16_t key, KvResult result);
+
+public:
+    KvStore();
+
+    /**
+     * 扫描 Flash 建立索引（可重复调用，相当于重启）
+     */
+    void begin();
+
+    void setEraseHandler(KvEraseHandler handler) { eraseHandler = handler; }
+
+    /**
+     * 查找键
+     * @return 指向 Flash 中值的指针，下一次擦除前有效；没有时返回 nullptr
+     */
+    const uint8_t* find(uint16_t key, size_t& length) const;
+
+    /**
+     * 写入（值与现有值相同时不写 Flash）；不擦除，需要擦除或成批复制时返回 BUSY
+     */
+    KvResult put(uint16_t key, const void* value, size_t length);
+
+    KvResult remove(uint16_t key);
+
+    /**
+     * 主循环调用：空闲时推进回收（每次最多复制 KV_RECLAIM_WORDS 字）并擦除回收完的扇区
+     * @param idle 没有动作与脚本在执行、串口没有待读的数据，允许擦除停顿
+     */
+    void update(bool idle);
+
+    uint32_t getLiveBytes() const { return liveBytes; }
+    uint8_t getKeyCount() const { return entryCount; }
+    bool isReclaiming() const { return reclaimSector >= 0; }
+    const KvStats& getStats() const { return stats; }
+
+    static const char* resultText(KvResult result);
+
+#if !defined(ARDUINO_ARCH_STM32)
+    /**
+     * 主机测试：再进行 operations 次编程/擦除后断电，这一次只完成一部分，之后的操作全部失败
+     * @param seed 决定未完成的那次操作写入了哪些位
+     */
+    static void hostPowerCut(uint32_t operations, uint32_t seed);
+
+    /**
+     * 主机测试：恢复供电（之后调用 begin() 相当于重启）
+     */
+    static void hostPowerOn();
+
+    static bool hostPoweredOff();
+
+    /**
+     * 主机测试：擦除整个区域（恢复出厂）
+     */
+    static void hostFormat();
+#endif
+};
+
+extern KvStore g_kvStore;
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "Voice_Command_Queue.h"
+
+/**
+ * 语音到动作的端到端延迟追踪
+ * 路径：ASRPRO 首字节 -> 关键词命中 -> 状态机分发 -> 舵机写入 -> OLED 刷新
+ * 时间戳使用 Cortex-M4 DWT 周期计数器，主机构建下退化为 micros()
+ * 舵机写入点在 PWM 中断中打点并结束追踪（见 commit()），主循环一侧的调用都在临界区内完成
+ */
+
+/**
+ * 追踪点
+ */
+enum class TraceHop : uint8_t {
+    UART_RX,        // 该行/帧的第一个字节到达
+    KEYWORD_MATCH,  // 关键词命中或帧校验通过，指令入队
+    FSM_DISPATCH,   // 状态机取出指令开始处理
+    SERVO_WRITE,    // 运动首次提交到 PWM 输出（DMA 缓冲区或舵机比较值）
+    OLED_FLUSH,     // 第一次刷新 OLED
+    COUNT
+};
+
+#define TRACE_HOP_COUNT ((uint8_t)TraceHop::COUNT)
+#define TRACE_COMMAND_COUNT ((uint8_t)VoiceCommand::HELP + 1)
+
+/**
+ * 对数-线性直方图（每个 2 的幂区间再分 4 格，相对误差 < 25%）
+ * 单位：微秒
+ */
+struct LatencyHistogram {
+    uint16_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t count;
+    uint32_t maxUs;
+
+    void record(uint32_t us);
+
+    /**
+     * 百分位（如 50、99），返回所在区间上界（微秒）
+     */
+    uint32_t percentile(uint8_t p) const;
+};
+
+/**
+ * 延迟追踪器
+ */
+class LatencyTracer {
+private:
+    LatencyHistogram commandHistograms[TRACE_COMMAND_COUNT];  // 各指令端到端延迟
+    LatencyHistogram hopHistograms[TRACE_HOP_COUNT];          // 首字节到各追踪点的延迟
+
+    uint32_t stamps[TRACE_HOP_COUNT];
+    uint8_t stampedMask;
+    VoiceCommand activeCommand;
+    bool active;
+
+    uint32_t cyclesPerMicro;
+
+    /**
+     * 写入直方图（调用方已屏蔽中断或处于中断中）
+     */
+    void finish();
+
+public:
+    LatencyTracer();
+
+    /**
+     * 初始化周期计数器
+     */
+    void begin();
+
+    /**
+     * 读取当前周期计数
+     */
+    static uint32_t now();
+
+    /**
+     * 开始追踪一条指令
+     */
+    void beginTrace(VoiceCommand cmd, uint32_t rxCycles, uint32_t matchCycles);
+
+    /**
+     * 只记录第一次到达的时间（调用方已屏蔽中断或处于中断中）
+     */
+    void stamp(TraceHop hop) {
+        if (active && !(stampedMask & (1 << (uint8_t)hop))) {
+            stamps[(uint8_t)hop] = now();
+            stampedMask |= 1 << (uint8_t)hop;
+        }
+    }
+
+    /**
+     * 记录追踪点（每条追踪只记录第一次到达的时间）
+     */
+    void mark(TraceHop hop) {
+        noInterrupts();
+        stamp(hop);
+        interrupts();
+    }
+
+    /**
+     * 记录追踪点并结束追踪（中断中调用，追踪已结束时忽略）
+     */
+    void commit(TraceHop hop) {
+        stamp(hop);
+        finish();
+    }
+
+    /**
+     * 结束追踪并写入直方图
+     */
+    void endTrace();
+
+    /**
+     * 输出 p50/p99 文本报告
+     */
+    void printReport(Print& out) const;
+
+    /**
+     * 生成 JSON 报告（用于 MQTT 发布）
+     * @return 写入长度，缓冲区不足时返回 0
+     */
+    size_t formatReportJSON(char* buffer, size_t size) const;
+
+    /**
+     * 清空统计
+     */
+    void reset();
+};
+
+extern LatencyTracer g_latencyTracer;
+
+#if LATENCY_TRACE_ENABLED
+#define LATENCY_TRACE(hop) g_latencyTracer.mark(hop)
+#define LATENCY_TRACE_COMMIT(hop) g_latencyTracer.commit(hop)
+#else
+#define LATENCY_TRACE(hop) ((void)0)
+#define LATENCY_TRACE_COMMIT(hop) ((void)0)
+#endif
+
+#endif
@@ -8,6 +8,11 @@
 // 前向声明
 class WiFiClient;
 
+/**
+ * 消息回调（在 update() 中调用，可以在回调里发布回复）
+ */
+typedef void (*MQTTMessageHandler)(const char* topic, const uint8_t* payload, unsigned int length);
+
 /**
  * MQTT 通信管理类
  * 对接 OneNet 云平台
@@ -19,6 +24,7 @@ private:
     
     unsigned long lastHeartbeat;
     bool isConnected;
+    MQTTMessageHandler messageHandler;
     
     /**
      * MQTT 消息回调函数（静态）
@@ -34,7 +40,7 @@ public:
     void begin(const char* broker, uint16_t port);
     
     /**
-     * 连接到 MQTT Broker
+     * 连接到 MQTT Broker（阻塞；何时重连由 ConnectivitySupervisor 决定，回放时不连接）
      */
     bool connect();
     
@@ -44,7 +50,7 @@ public:
     void disconnect();
     
     /**
-     * 保持连接活跃
+     * 保持连接活跃、发送心跳（不重连）
      * 应在主循环中定期调用
      */
     void update();
@@ -64,6 +70,28 @@ public:
      */
     bool publishStatus(const char* status);
     
+    /**
+     * 发布已格式化的JSON数据
+     */
+    bool publishJSON(const char* payload);
+    
+    /**
+     * 流式发布：写报文头后返回报文流，调用方写入恰好 length 字节后调用 endPublish()
+     * 内容直接写入网络连接，不经 PubSubClient 的报文缓冲区，长度不受其限制
+     * @return 未连接或写头失败时返回 nullptr
+     */
+    Print* beginPublish(const char* topic, size_t length);
+    
+    /**
+     * 结束流式发布
+     */
+    bool endPublish();
+    
+    /**
+     * 设置收到消息时的回调
+     */
+    void setMessageHandler(MQTTMessageHandler handler) { messageHandler = handler; }
+    
     /**
      * 订阅主题
      */
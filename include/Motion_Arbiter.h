@@ -0,0 +1,138 @@
+#ifndef MOTION_ARBITER_H
+#define MOTION_ARBITER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "Servo_Controller.h"
+
+/**
+ * 舵机动作仲裁
+ * 状态机警告、语音、云端指令等来源都通过 submit() 提交动作，
+ * 由优先级、抢占策略与有效期决定执行顺序，避免先到者独占舵机
+ */
+
+/**
+ * 动作来源
+ */
+enum class MotionSource : uint8_t {
+    AMBIENT,      // 反馈序列、待机动画
+    WARNING,      // 状态机温湿度警告
+    VOICE,        // 语音指令
+    REMOTE,       // 云端指令
+    COUNT
+};
+
+/**
+ * 抢占策略：请求优先级高于正在执行的动作时如何切换
+ */
+enum class MotionPreempt : uint8_t {
+    NONE,         // 不抢占，排队等待
+    BLEND,        // 丢弃对方排队的关键帧，正在运动的段走完后衔接（起点速度连续）
+    CUT           // 立即停在当前位置并开始新动作
+};
+
+/**
+ * 仲裁统计
+ */
+struct MotionArbiterStats {
+    uint32_t submitted;       // 提交次数
+    uint32_t started;         // 开始执行次数（含抢占）
+    uint32_t preemptions;     // 抢占次数
+    uint32_t superseded;      // 排队中被同来源新请求替换的次数
+    uint32_t dropped;         // 因忙或队列满被丢弃的次数
+    uint32_t expired;         // 排队超过有效期被丢弃的次数
+};
+
+/**
+ * 来源的默认优先级（数值越大越优先）
+ */
+uint8_t motionSourcePriority(MotionSource source);
+
+class MotionArbiter {
+private:
+    /**
+     * 排队中的请求
+     */
+    struct Request {
+        ServoAction action;
+        MotionSource source;
+        uint8_t priority;
+        uint16_t ttl;
+        unsigned long submitTime;
+    };
+
+    ServoController* servo;
+
+    Request pending[MOTION_ARBITER_CAPACITY];
+    uint8_t pendingCount;
+
+    bool hasOwner;            // 正在执行的动作是否由仲裁器发起
+    MotionSource owner;
+    uint8_t ownerPriority;
+
+    MotionArbiterStats stats;
+
+    /**
+     * 开始执行动作并记录归属
+     */
+    bool start(ServoAction action, MotionSource source, uint8_t priority,
+               MotionQueuePolicy policy);
+
+    void removePending(uint8_t index);
+
+public:
+    MotionArbiter();
+
+    void begin(ServoController* srv);
+
+    /**
+     * 提交动作请求
+     * @param preempt  优先级高于当前动作时的抢占策略
+     * @param ttl      无法立即执行时的最长等待（毫秒），0 表示不排队，忙则丢弃
+     * @param priority 优先级，默认取来源的默认优先级
+     * @return true 已执行或已排队
+     */
+    bool submit(ServoAction action, MotionSource source,
+                MotionPreempt preempt = MotionPreempt::BLEND,
+                uint16_t ttl = MOTION_REQUEST_TTL);
+    bool submit(ServoAction action, MotionSource source, MotionPreempt preempt,
+                uint16_t ttl, uint8_t priority);
+
+    /**
+     * 提交单轴运动段（供按时长编排的反馈时间线使用，不排队）
+     * 当前动作同来源时按 ownPolicy 入队；来源优先级更低时丢弃其排队部分后衔接；否则拒绝
+     * 目标在 duration 内到不了时截到可达角度，使各段严格按时长首尾相接
+     * @return false 被拒绝或队列已满
+     */
+    bool submitSegment(ServoAxis axis, int16_t angle, uint16_t duration, MotionSource source,
+                       MotionQueuePolicy ownPolicy = MotionQueuePolicy::ENQUEUE);
+
+    /**
+     * 下一次运动开始前的唤醒保持时长：PWM 已关闭时为 SERVO_WAKE_LEAD_MS
+     */
+    uint16_t wakeDelay() const { 
+        return (servo && !servo->isPowered()) ? SERVO_WAKE_LEAD_MS : 0; 
+    }
+
+    /**
+     * 清理过期请求，舵机空闲时开始优先级最高的排队请求
+     * 应在主循环中定期调用
+     */
+    void update();
+
+    /**
+     * 舵机空闲且没有排队请求
+     */
+    bool isIdle() const { return pendingCount == 0 && !servo->isPerforming(); }
+
+    /**
+     * 当前动作来源；舵机空闲或动作不是经由仲裁器发起时返回 false
+     */
+    bool getOwner(MotionSource& source) const;
+
+    uint8_t getPendingCount() const { return pendingCount; }
+
+    const MotionArbiterStats& getStats() const { return stats; }
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef MOTION_QUEUE_H
+#define MOTION_QUEUE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "Servo_Trajectory.h"
+
+/**
+ * 舵机关键帧队列
+ * 每个轴拥有独立的时间线：上一段结束的同一节拍立即开始下一段，段与段之间没有空档
+ */
+
+#define MOTION_AXIS_HOLD -1     // 关键帧中该轴保持当前角度
+
+/**
+ * 舵机轴
+ */
+enum class ServoAxis : uint8_t {
+    HEAD,   // 摇头
+    NOD     // 点头
+};
+
+/**
+ * 入队策略
+ */
+enum class MotionQueuePolicy : uint8_t {
+    ENQUEUE,    // 追加到队尾，空间不足时拒绝
+    REPLACE,    // 丢弃排队中的关键帧，正在运动的段走完后执行新关键帧（两轴都静止时立即执行）
+    FLUSH       // 丢弃排队中的关键帧并打断当前段，从当前位置立即执行
+};
+
+/**
+ * 关键帧（两轴）
+ */
+struct MotionKeyframe {
+    int16_t headAngle;        // 摇头目标角度，MOTION_AXIS_HOLD 表示保持
+    int16_t nodAngle;         // 点头目标角度，MOTION_AXIS_HOLD 表示保持
+    uint16_t duration;        // 期望时长（毫秒），0 表示在速度限制内尽快到达
+    MotionProfile easing;     // 速度曲线
+};
+
+/**
+ * 单轴运动段
+ */
+struct MotionSegment {
+    int16_t target;           // 目标角度，MOTION_AXIS_HOLD 表示保持
+    uint16_t duration;        // 期望时长（毫秒）
+    MotionProfile easing;
+};
+
+/**
+ * 单轴时间线
+ * push()/clear()/interrupt() 在主循环中调用（需屏蔽中断），tick() 在定时器中断中调用
+ */
+class MotionTimeline {
+private:
+    ServoTrajectory trajectory;
+    AxisLimits limits;
+
+    MotionSegment segments[MOTION_QUEUE_CAPACITY];
+    uint8_t head;
+    uint8_t count;
+
+    /**
+     * 取出下一段并从 nowTick 开始规划
+     */
+    void startNext(uint32_t nowTick);
+
+public:
+    MotionTimeline();
+
+    /**
+     * 设定速度、加速度限制（对之后开始的段生效）
+     */
+    void setLimits(const AxisLimits& axisLimits) { limits = axisLimits; }
+
+    /**
+     * 立即设定当前位置并清空队列
+     */
+    void reset(float pos);
+
+    /**
+     * 追加一段
+     * @return false 队列已满
+     */
+    bool push(const MotionSegment& segment);
+
+    /**
+     * 丢弃排队中的段（不影响正在执行的段）
+     */
+    void clear() { count = 0; }
+
+    /**
+     * 停在当前位置，放弃正在执行的段
+     */
+    void interrupt() { trajectory.reset(trajectory.getPosition()); }
+
+    /**
+     * 推进一个节拍
+     * @param angle 输出角度
+     * @return true 本节拍需要写入舵机
+     */
+    bool tick(uint32_t nowTick, float& angle);
+
+    /**
+     * 队尾位置：最后一个排队段的目标角度，队列为空时为当前段目标
+     */
+    float tailPosition() const;
+
+    /**
+     * 从队尾位置走到 target 所需的最短时长（毫秒，向上取整）
+     */
+    uint16_t minimumDuration(int16_t target, MotionProfile easing) const;
+
+    /**
+     * 剩余空间
+     */
+    uint8_t space() const { return MOTION_QUEUE_CAPACITY - count; }
+
+    /**
+     * 排队中的段数（不含正在执行的段）
+     */
+    uint8_t pending() const { return count; }
+
+    /**
+     * 当前段是否在改变角度（保持段不算）
+     */
+    bool isInMotion() const { return trajectory.isMoving() && !trajectory.isHolding(); }
+
+    /**
+     * 是否有正在执行或排队中的段
+     */
+    bool isBusy() const { return trajectory.isMoving() || count > 0; }
+
+    /**
+     * 当前角度
+     */
+    float getPosition() const { return trajectory.getPosition(); }
+};
+
+#endif
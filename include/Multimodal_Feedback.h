@@ -5,11 +5,20 @@
 #include "config.h"
 #include "OLED_Display.h"
 #include "Servo_Controller.h"
+#include "Motion_Arbiter.h"
+#include "Feedback_Phrases.h"
+
+class ASRPROModule;
 
 /**
  * 多模态反馈系统
  * 实现表情+动作+语音的完整反馈链
  * 支持: 视觉(OLED) + 运动(舵机) + 声音(ASRPRO播报)
+ *
+ * 反馈序列按时间线播放：每一步按 duration 排定起始时刻，表情、摇头、点头、语音各为一个轨道
+ *   表情轨道：提前 FEEDBACK_LOOKAHEAD_MS 预绘制，到点只剩 I2C 传输
+ *   舵机轨道：每步一段运动（不动的轴为保持段），提前装入时间线，由定时器中断按节拍首尾衔接
+ *   语音轨道：到点加入播报队列
  */
 
 // 反馈动作类型
@@ -52,46 +61,83 @@ struct FeedbackSequence {
     uint16_t totalDuration;
 };
 
+/**
+ * 时间线轨道
+ */
+enum class FeedbackTrack : uint8_t {
+    EMOTION,         // OLED 表情
+    HEAD,            // 摇头舵机
+    NOD,             // 点头舵机
+    VOICE,           // 语音播报
+    COUNT
+};
+
+/**
+ * 单个轨道的播放进度
+ */
+struct FeedbackTrackState {
+    uint8_t armed;               // 已预装（预绘制/装入舵机时间线）的步数
+    uint8_t fired;               // 已到点执行的步数
+    bool enabled;                // 本次反馈是否包含该轨道
+};
+
+/**
+ * 时间线调度统计
+ */
+struct FeedbackTimingStats {
+    uint32_t events;             // 到点执行的事件数
+    uint32_t maxLateness;        // 最大迟到（毫秒）
+    uint32_t lateArms;           // 预装晚于上一段结束（舵机时间线出现空档）的次数
+    uint32_t rejectedSegments;   // 被更高优先级动作拒绝的舵机段
+    uint32_t updates;            // 播放期间 update() 次数
+    uint32_t totalCycles;        // update() 累计周期数（主机构建为微秒）
+    uint32_t maxUpdateCycles;    // 单次 update() 最大周期数
+};
+
 /**
  * 多模态反馈管理类
  */
 class MultimodalFeedbackSystem {
 private:
     OLEDDisplay* display;
-    ServoController* servo;
+    MotionArbiter* motion;      // 舵机动作经由仲裁器提交（AMBIENT 来源）
+    ASRPROModule* voice;
     
-    unsigned long sequenceStartTime;
-    uint8_t currentMotionIndex;
+    FeedbackSequence sequence;
+    uint32_t stepStart[FEEDBACK_MAX_STEPS + 1];  // 各步相对序列起点的起始时刻，末项为总时长
+    unsigned long sequenceStartTime;             // 含舵机唤醒保持与输出延迟，晚于调用时刻
+    uint16_t servoLead;                          // 舵机段提前装入的时长（唤醒保持 + 输出延迟）
     bool isSequencePlaying;
     FeedbackScenario currentScenario;
     
-    // 反馈场景库
-    const FeedbackSequence* danceSequence;
-    const FeedbackSequence* excitedSequence;
-    const FeedbackSequence* tiredSequence;
+    FeedbackTrackState tracks[(uint8_t)FeedbackTrack::COUNT];
+    FeedbackTimingStats timingStats;
+    
+    FeedbackTrackState& track(FeedbackTrack t) { return tracks[(uint8_t)t]; }
     
     /**
-     * 创建舞蹈序列
+     * 预装第 step 步：预绘制表情 / 向舵机时间线装入运动段
      */
-    void createDanceSequence();
+    void armStep(FeedbackTrack t, uint8_t step, long elapsed);
     
     /**
-     * 创建兴奋序列
+     * 到点执行第 step 步：显示表情 / 加入播报
      */
-    void createExcitedSequence();
+    void fireStep(FeedbackTrack t, uint8_t step, long elapsed);
     
     /**
-     * 创建疲劳序列
+     * 舵机动作在某一轴上的目标角度，不涉及该轴时为 MOTION_AXIS_HOLD
      */
-    void createTiredSequence();
+    static int16_t axisTarget(ServoAction action, ServoAxis axis);
     
 public:
     MultimodalFeedbackSystem();
     
     /**
      * 初始化系统
+     * @param asr 语音播报，nullptr 时语音轨道静音
      */
-    void begin(OLEDDisplay* disp, ServoController* srv);
+    void begin(OLEDDisplay* disp, MotionArbiter* arbiter, ASRPROModule* asr = nullptr);
     
     /**
      * 执行反馈场景
@@ -100,12 +146,13 @@ public:
                                FeedbackAction actionType = FeedbackAction::FULL_FEEDBACK);
     
     /**
-     * 执行自定义反馈序列
+     * 执行自定义反馈序列（motions 在播放期间必须保持有效，超出 FEEDBACK_MAX_STEPS 的步被忽略）
      */
-    void executeCustomSequence(const FeedbackMotion* motions, uint8_t count);
+    void executeCustomSequence(const FeedbackMotion* motions, uint8_t count,
+                               FeedbackAction actionType = FeedbackAction::FULL_FEEDBACK);
     
     /**
-     * 更新反馈状态（用于非阻塞控制）
+     * 推进时间线（非阻塞），应在主循环中调用
      */
     void update();
     
@@ -120,14 +167,23 @@ public:
     void stopSequence();
     
     /**
-     * 生成语音文本（热反馈）
+     * 生成语音文本（热反馈），写入 buffer（PHRASE_BUFFER_SIZE 可容纳任意组合）
+     * 只生成文本，高温/低温场景由调用方按 thermalLevel() 触发
+     * @return 写入的字符数
      */
-    String generateThermalFeedback(float temp, float humidity);
+    size_t generateThermalFeedback(float temp, float humidity, char* buffer, size_t size) const;
     
     /**
      * 生成表情反馈（基于表情库）
      */
     void applyEmotionFeedback(EmotionState emotion);
+    
+    /**
+     * 当前序列已播放的步数（以最慢的轨道计）
+     */
+    uint8_t getCurrentStep() const;
+    
+    const FeedbackTimingStats& getTimingStats() const { return timingStats; }
 };
 
 // ==================== 预定义反馈序列 ====================
@@ -165,4 +221,35 @@ static const FeedbackMotion HOT_MOTIONS[] = {
     {ServoAction::RESET, EmotionState::HOT_WARNING, 200, nullptr, false}
 };
 
+// 冷反馈序列：哆嗦
+static const FeedbackMotion COLD_MOTIONS[] = {
+    {ServoAction::SHAKE_LEFT, EmotionState::COLD_WARNING, 150, "So cold!", true},
+    {ServoAction::SHAKE_RIGHT, EmotionState::COLD_WARNING, 150, nullptr, false},
+    {ServoAction::SHAKE_LEFT, EmotionState::COLD_WARNING, 150, nullptr, false},
+    {ServoAction::SHAKE_RIGHT, EmotionState::COLD_WARNING, 150, nullptr, false},
+    {ServoAction::RESET, EmotionState::COLD_WARNING, 200, nullptr, false}
+};
+
+// 困惑反馈序列：歪头
+static const FeedbackMotion CONFUSED_MOTIONS[] = {
+    {ServoAction::SHAKE_LEFT, EmotionState::SURPRISED, 400, "Hmm?", true},
+    {ServoAction::NOD_DOWN, EmotionState::SURPRISED, 400, nullptr, false},
+    {ServoAction::RESET, EmotionState::NORMAL, 300, nullptr, false}
+};
+
+// 庆祝反馈序列
+static const FeedbackMotion CELEBRATE_MOTIONS[] = {
+    {ServoAction::NOD_UP, EmotionState::HAPPY, 300, "Hooray!", true},
+    {ServoAction::NOD_DOWN, EmotionState::HAPPY, 300, nullptr, false},
+    {ServoAction::NOD_UP, EmotionState::SURPRISED, 300, nullptr, false},
+    {ServoAction::RESET, EmotionState::HAPPY, 200, nullptr, false}
+};
+
+// 警告反馈序列
+static const FeedbackMotion ALERT_MOTIONS[] = {
+    {ServoAction::SHAKE_LEFT, EmotionState::ANGRY, 250, "Attention!", true},
+    {ServoAction::SHAKE_RIGHT, EmotionState::ANGRY, 250, nullptr, false},
+    {ServoAction::RESET, EmotionState::ANGRY, 200, nullptr, false}
+};
+
 #endif
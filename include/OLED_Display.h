@@ -28,6 +28,8 @@ class OLEDDisplay {
 private:
     U8G2_SSD1315_128X64_1_HW_I2C u8g2;
     EmotionState currentEmotion;
+    EmotionState preparedEmotion;   // 缓冲区中已画好、尚未发送的表情
+    bool hasPrepared;
     
     /**
      * 绘制开心表情
@@ -74,11 +76,21 @@ private:
      */
     void drawHumidityWarning();
     
+    /**
+     * 在缓冲区中绘制表情（不发送）
+     */
+    void renderEmotion(EmotionState emotion);
+    
     /**
      * 显示文字信息（如温湿度、天气等）
      */
     void drawTextInfo(const char* text);
     
+    /**
+     * 将缓冲区发送到屏幕（同时作废预绘制的表情）
+     */
+    void sendBuffer();
+    
 public:
     OLEDDisplay();
     
@@ -97,6 +109,17 @@ public:
      */
     void setEmotion(EmotionState emotion);
     
+    /**
+     * 预绘制表情：只画进缓冲区，presentEmotion() 时只剩 I2C 传输
+     * 期间有其他绘制时预绘制作废，presentEmotion() 重新绘制
+     */
+    void prepareEmotion(EmotionState emotion);
+    
+    /**
+     * 显示表情，已预绘制时直接发送缓冲区
+     */
+    void presentEmotion(EmotionState emotion);
+    
     /**
      * 获取当前表情
      */
@@ -121,6 +144,27 @@ public:
      * 显示MQTT连接状态
      */
     void displayMQTTStatus(bool connected);
+    
+    /**
+     * 开始绘制自定义页面：清空缓冲区（预绘制的表情作废）
+     */
+    void beginPage();
+    
+    /**
+     * 在缓冲区中绘制一行文字
+     * @param font U8g2 字体
+     */
+    void drawText(uint8_t x, uint8_t y, const char* text, const uint8_t* font);
+    
+    /**
+     * 在缓冲区中绘制直线
+     */
+    void drawLine(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+    
+    /**
+     * 发送自定义页面并恢复默认字体
+     */
+    void endPage();
 };
 
 #endif
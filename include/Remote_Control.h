@@ -2,17 +2,37 @@
 #define REMOTE_CONTROL_H
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
 #include "config.h"
+#include "OLED_Display.h"
+#include "Servo_Controller.h"
+#include "Json_Tokenizer.h"
+
+class MQTTManager;
 
 /**
  * 远程控制模块
  * 处理来自微信小程序的MQTT命令
  * 支持: 表情切换、舵机动作、参数查询等
+ *
+ * 单条命令：{"cmd":"servo","action":"shake_left","angle":90}
+ * 指令包：  {"id":"a17","cmds":[{"cmd":"emotion","emotion":"happy"},{"cmd":"servo","action":"nod_up"}]}
+ * 负载在 MQTT 接收缓冲区中就地分词，指令、表情、动作与模式名称经编译期生成的
+ * 完美哈希表解析为枚举（不区分大小写），解析结果是不含指针的定长结构体
+ *
+ * 指令包整包校验：任何一条无效则整包不执行；全部有效时在同一次调用中依次执行
+ * 带 ID 的指令包执行后回复
+ *   {"ack":"a17","result":"ok","count":2,"failed":0}    failed 为被拒绝指令的位图
+ *   {"ack":"a17","result":"invalid","index":1}          index 为第一条无效指令
+ * 最近 REMOTE_ID_HISTORY 个已执行的 ID 被记住，同一 ID 重发时不再执行，
+ * 按首次执行的结果回复 "duplicate"，发送端可以放心超时重发
  */
 
+#define REMOTE_ANGLE_NONE   0xFFFF      // 未指定舵机角度
+
+static_assert(REMOTE_BATCH_MAX <= 8, "failed commands are recorded in a uint8_t bitmap");
+
 // 远程指令类型
-enum class RemoteCommand {
+enum class RemoteCommand : uint8_t {
     INVALID,              // 无效指令
     SET_EMOTION,          // 设置表情
     MOVE_SERVO,           // 舵机动作
@@ -21,16 +41,76 @@ enum class RemoteCommand {
     CALIBRATE,            // 校准
 };
 
+// 工作模式
+enum class RemoteMode : uint8_t {
+    AUTO,                 // 按温湿度自动切换（默认）
+    MONITOR,              // 常驻环境监测
+    WEATHER,              // 常驻天气显示
+    QUIET                 // 静音：不播报、不动作
+};
+
 // 远程指令数据结构
 struct RemoteControlData {
     RemoteCommand command;
-    String emotionName;           // 表情名称
-    String servoAction;           // 舵机动作名称
-    uint16_t servoAngle;          // 舵机角度
-    String mode;                  // 工作模式
+    EmotionState emotion;         // 表情（SET_EMOTION）
+    ServoAction servoAction;      // 舵机动作（MOVE_SERVO）
+    uint16_t servoAngle;          // 舵机角度 0~180，REMOTE_ANGLE_NONE 表示未指定
+    RemoteMode mode;              // 工作模式（SET_MODE）
     bool isValid;
 };
 
+/**
+ * 表情/模式的命令名称（状态上报用）
+ */
+const char* remoteEmotionName(EmotionState emotion);
+const char* remoteModeName(RemoteMode mode);
+
+/**
+ * 名称 -> 表情/模式（不区分大小写，text 不要求 '\0' 结尾）
+ */
+bool remoteEmotionFromName(const char* text, size_t length, EmotionState& emotion);
+bool remoteModeFromName(const char* text, size_t length, RemoteMode& mode);
+
+/**
+ * 指令包处理结果
+ */
+enum class RemoteResult : uint8_t {
+    OK,                   // 全部指令已执行（个别指令可能被拒绝，见 failed）
+    DUPLICATE,            // ID 已执行过，本次未执行
+    PARSE_ERROR,          // JSON 语法错误或词元过多
+    INVALID,              // 某条指令无效，整包未执行
+    TOO_MANY,             // 指令数超过 REMOTE_BATCH_MAX
+    BAD_ID                // ID 不是字符串或非负整数，或含 [0-9A-Za-z_.:-] 以外的字符，或过长
+};
+
+/**
+ * 指令执行回调
+ * @return false 指令被拒绝（如舵机被更高优先级的动作占用）
+ */
+typedef bool (*RemoteCommandHandler)(const RemoteControlData& cmd);
+
+/**
+ * 已执行的指令包
+ */
+struct RemoteEnvelopeRecord {
+    char id[REMOTE_ID_MAX_LEN];
+    uint8_t count;                // 指令数
+    uint8_t failed;               // 被拒绝指令的位图
+};
+
+/**
+ * 状态文档内容
+ * 流式发布要写出两遍（先求长度再写报文），字段先取好快照保证两遍一致
+ */
+struct RemoteStatus {
+    const char* emotion;
+    float temperature;
+    float humidity;
+    const char* weather;
+    uint32_t timestamp;
+    uint16_t commandsReceived;
+};
+
 /**
  * 远程控制模块类
  */
@@ -39,11 +119,25 @@ private:
     RemoteControlData lastCommand;
     unsigned long lastCommandTime;
     uint16_t commandCount;
+    RemoteCommandHandler handler;
+    
+    // 最近执行的指令包 ID（环形）
+    RemoteEnvelopeRecord history[REMOTE_ID_HISTORY];
+    uint8_t historyHead;
+    uint8_t historyCount;
     
     /**
-     * 解析JSON命令
+     * 解析对象词元 object 中的一条命令
      */
-    RemoteControlData parseRemoteCommand(const char* jsonStr);
+    static RemoteControlData parseRemoteCommand(const char* json, const JsonToken* tokens,
+                                                uint16_t object);
+    
+    const RemoteEnvelopeRecord* findEnvelope(const char* id) const;
+    
+    static void formatReply(char* reply, size_t replySize, const char* id, RemoteResult result,
+                            uint8_t count, uint8_t failed, uint8_t index);
+    
+    static const char* resultText(RemoteResult result);
     
 public:
     RemoteControlModule();
@@ -54,9 +148,17 @@ public:
     void begin();
     
     /**
-     * 处理MQTT接收到的消息
+     * 设置指令执行回调（未设置时指令只记录为 lastCommand）
      */
-    void handleMQTTMessage(const char* topic, const char* payload, unsigned int length);
+    void setCommandHandler(RemoteCommandHandler cmdHandler) { handler = cmdHandler; }
+    
+    /**
+     * 处理MQTT接收到的消息（单条命令或指令包）
+     * 先解析出全部指令再执行：回调中可以发布消息（会覆盖 MQTT 接收缓冲区）
+     * @param reply 回复 JSON；无需回复时（没有 ID 且执行成功）为空串，reply 为 nullptr 时不生成
+     */
+    RemoteResult handleMQTTMessage(const uint8_t* payload, unsigned int length,
+                                   char* reply = nullptr, size_t replySize = 0);
     
     /**
      * 获取最后接收的命令
@@ -78,10 +180,17 @@ public:
     unsigned long getLastCommandTime() const { return lastCommandTime; }
     
     /**
-     * 生成状态JSON响应
+     * 写出状态JSON：
+     * {"emotion":"happy","temperature":23.5,"humidity":45.0,"weather":"Sunny","timestamp":1234,"commands_received":3}
+     * @return 写出的字节数
+     */
+    static size_t writeStatusJSON(Print& out, const RemoteStatus& status);
+    
+    /**
+     * 发布状态JSON：长度预先算出，内容直接写入 MQTT 报文，不经中间缓冲
      */
-    String generateStatusJSON(const char* emotion, float temp, float humidity, 
-                            const char* weather);
+    bool publishStatus(MQTTManager& mqtt, const char* emotion, float temp, float humidity,
+                       const char* weather);
 };
 
 #endif
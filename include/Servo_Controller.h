@@ -2,8 +2,24 @@
 #define SERVO_CONTROLLER_H
 
 #include <Arduino.h>
-#include <Servo.h>
 #include "config.h"
+#include "Servo_Trajectory.h"
+#include "Motion_Queue.h"
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+#include "Servo_PWM.h"
+#else
+#include <Servo.h>
+#endif
+
+/**
+ * 运动段入队到舵机实际输出的平均延迟（毫秒），按时长编排多个输出时用来对齐
+ * DMA 后端：平均等半个半缓冲区才被计算，算好后等另一半播放完，比较值预装载再晚一帧
+ */
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+#define SERVO_OUTPUT_LATENCY_MS ((SERVO_DMA_HALF_FRAMES * 3 / 2 + 1) * 1000 / SERVO_PWM_FRAME_HZ)
+#else
+#define SERVO_OUTPUT_LATENCY_MS (1000 / SERVO_UPDATE_RATE_HZ)
+#endif
 
 /**
  * 舵机动作类型
@@ -17,21 +33,99 @@ enum class ServoAction {
     IDLE           // 空闲
 };
 
+/**
+ * 舵机功耗统计（电流为模型估算值）
+ */
+struct ServoPowerStats {
+    uint32_t activeTime;            // PWM 输出累计时长（毫秒）
+    uint32_t detachCount;           // 空闲关闭 PWM 次数
+    float totalEnergy;              // 累计能耗（毫焦）
+    float lastActionEnergy;         // 最近一次动作能耗（毫焦）
+    float lastActionPeakCurrent;    // 最近一次动作两轴合计峰值电流（毫安）
+    uint32_t lastActionTime;        // 最近一次动作时长（毫秒，含唤醒保持）
+};
+
 /**
  * 舵机控制类
  * 管理两个SG90舵机：摇头（180°）和点头（180°）
+ * 动作以关键帧排队，两轴各自按时间线执行，时间线以 SERVO_UPDATE_RATE_HZ 推进
+ * 输出后端由 SERVO_BACKEND 选择：
+ *   SERVO_BACKEND_ARDUINO   Servo 库输出，TIM14 中断推进时间线
+ *   SERVO_BACKEND_TIMER_DMA 硬件 PWM 输出，DMA 半缓冲区中断时批量推进时间线
+ * 空闲 SERVO_IDLE_DETACH_MS 后关闭 PWM，下一次动作入队时提前 SERVO_WAKE_LEAD_MS 恢复
  */
 class ServoController {
 private:
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+    ServoPWMBackend pwm;
+#else
     Servo headServo;    // 摇头舵机
     Servo nodServo;     // 点头舵机
+#endif
     
-    uint16_t headPos;   // 摇头当前位置
-    uint16_t nodPos;    // 点头当前位置
+    MotionTimeline headTimeline;
+    MotionTimeline nodTimeline;
+    MotionProfile motionProfile;
     
+    volatile uint32_t tickCount;    // 时间线节拍计数
+    volatile bool tracePending;     // 已入队的运动还未提交到 PWM 输出，提交时结束延迟追踪
+    uint16_t headPulse;             // 摇头当前脉宽（微秒）
+    uint16_t nodPulse;              // 点头当前脉宽（微秒）
+    
+    // 功耗管理
+    bool attached;                  // PWM 是否在输出
+    bool wasBusy;
+    unsigned long lastUpdateTime;
+    unsigned long lastBusyTime;
     unsigned long actionStartTime;
-    ServoAction currentAction;
-    bool isActing;
+    float actionEnergy;             // 当前动作累计能耗（毫焦，中断中累加）
+    float actionPeakCurrent;        // 当前动作峰值电流（毫安）
+    float lastHeadAngle, lastNodAngle;
+    float lastHeadVelocity, lastNodVelocity;
+    ServoPowerStats powerStats;
+    
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+    /**
+     * DMA 半缓冲区回调：每帧推进若干节拍并写入比较值
+     */
+    static void fillFrames(void* context, uint32_t* head, uint32_t* nod, uint8_t count);
+#else
+#if defined(ARDUINO_ARCH_STM32)
+    HardwareTimer* trajectoryTimer;
+#endif
+    static ServoController* instance;
+    
+    /**
+     * 定时器中断入口
+     */
+    static void onTimerInterrupt();
+#endif
+    
+    /**
+     * 角度转脉宽（微秒），保留小数部分以获得亚度级分辨率
+     */
+    static uint16_t angleToMicros(float angle);
+    
+    /**
+     * 按策略整理时间线（调用方已屏蔽中断）
+     * @param resting 相关各轴都没有在改变角度
+     */
+    static void applyPolicy(MotionTimeline& timeline, MotionQueuePolicy policy, bool resting);
+    
+    /**
+     * 新运动入队前调用：重置动作能耗统计，PWM 关闭时恢复并插入唤醒保持段
+     */
+    void beginMotion();
+    
+    /**
+     * 打开/关闭 PWM 输出
+     */
+    void setPowered(bool on);
+    
+    /**
+     * 按电流模型累加本节拍能耗（中断中调用）
+     */
+    void accumulatePower();
     
 public:
     ServoController();
@@ -42,21 +136,69 @@ public:
     void begin();
     
     /**
-     * 执行舵机动作
+     * 执行舵机动作：到位、保持 SERVO_ACTION_DURATION、回到中点
+     * 动作按策略排队，执行中收到的动作不再被丢弃
      * @param action 要执行的动作类型
+     * @return false 队列空间不足
      */
-    void performAction(ServoAction action);
+    bool performAction(ServoAction action, 
+                       MotionQueuePolicy policy = MotionQueuePolicy::ENQUEUE);
     
     /**
-     * 更新舵机状态（用于非阻塞控制）
+     * 批量加入关键帧（全部加入或全部拒绝）
+     * @return false 队列空间不足
+     */
+    bool enqueueKeyframes(const MotionKeyframe* frames, uint8_t count,
+                          MotionQueuePolicy policy = MotionQueuePolicy::ENQUEUE);
+    
+    /**
+     * 加入单个关键帧
+     */
+    bool enqueueKeyframe(const MotionKeyframe& frame,
+                         MotionQueuePolicy policy = MotionQueuePolicy::ENQUEUE) {
+        return enqueueKeyframes(&frame, 1, policy);
+    }
+    
+    /**
+     * 只向一个轴加入运动段，另一轴的时间线不受影响
+     */
+    bool enqueueAxis(ServoAxis axis, int16_t angle, uint16_t duration,
+                     MotionProfile easing, 
+                     MotionQueuePolicy policy = MotionQueuePolicy::ENQUEUE);
+    
+    /**
+     * 从该轴队尾位置出发、duration 内朝 angle 能到达的最远角度（速度、加速度限制内）
+     * 按时长编排的调用方用它截短目标，使运动段不被拉长
+     */
+    int16_t reachableAngle(ServoAxis axis, int16_t angle, uint16_t duration, 
+                           MotionProfile easing) const;
+    
+    /**
+     * 更新舵机状态：统计 PWM 输出时长与动作能耗，空闲超时后关闭 PWM
      * 应该在主循环中定期调用
      */
     void update();
     
     /**
-     * 检查是否正在执行动作
+     * 推进一个节拍：两轴时间线采样并更新脉宽
+     * Arduino 后端由定时器中断调用并直接写舵机；DMA 后端由 fillFrames() 调用
+     */
+    void tick();
+    
+    /**
+     * 检查是否正在执行动作（含排队中的关键帧）
+     */
+    bool isPerforming() const { return headTimeline.isBusy() || nodTimeline.isBusy(); }
+    
+    /**
+     * 最近入队的运动是否还未提交到 PWM 输出（此时延迟追踪由 PWM 中断结束）
      */
-    bool isPerforming() const { return isActing; }
+    bool isTracePending() const { return tracePending; }
+    
+    /**
+     * 排队中的关键帧数（取两轴较大值）
+     */
+    uint8_t getQueuedFrames() const;
     
     /**
      * 立即停止所有舵机动作并复位
@@ -64,24 +206,51 @@ public:
     void stop();
     
     /**
-     * 设置摇头舵机位置（0-180）
+     * 设置摇头舵机位置（0-180），打断该轴当前动作并平滑过渡
      */
     void setHeadPosition(uint16_t angle);
     
     /**
-     * 设置点头舵机位置（0-180）
+     * 设置点头舵机位置（0-180），打断该轴当前动作并平滑过渡
      */
     void setNodPosition(uint16_t angle);
     
+    /**
+     * 选择速度曲线（performAction 与 setXxxPosition 使用）
+     */
+    void setMotionProfile(MotionProfile profile) { motionProfile = profile; }
+    MotionProfile getMotionProfile() const { return motionProfile; }
+    
+    /**
+     * 设置两轴的速度、加速度限制
+     */
+    void setAxisLimits(const AxisLimits& head, const AxisLimits& nod);
+    
+    /**
+     * PWM 是否在输出
+     */
+    bool isPowered() const { return attached; }
+    
+    /**
+     * 获取功耗统计
+     */
+    const ServoPowerStats& getPowerStats() const { return powerStats; }
+    
+    /**
+     * 当前输出脉宽（微秒）
+     */
+    uint16_t getHeadPulse() const { return headPulse; }
+    uint16_t getNodPulse() const { return nodPulse; }
+    
     /**
      * 获取摇头舵机当前位置
      */
-    uint16_t getHeadPosition() const { return headPos; }
+    uint16_t getHeadPosition() const { return (uint16_t)(headTimeline.getPosition() + 0.5f); }
     
     /**
      * 获取点头舵机当前位置
      */
-    uint16_t getNodPosition() const { return nodPos; }
+    uint16_t getNodPosition() const { return (uint16_t)(nodTimeline.getPosition() + 0.5f); }
 };
 
 #endif
@@ -0,0 +1,119 @@
+#ifndef SERVO_PWM_H
+#define SERVO_PWM_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * 舵机硬件 PWM 输出
+ * 摇头 PA0 -> TIM5_CH1（AF2），点头 PA5 -> TIM2_CH1（AF1）
+ * 两个定时器以 1MHz 计数、SERVO_PWM_FRAME_HZ 为周期，比较值即脉宽（微秒）
+ * 每个更新事件由 DMA 从环形缓冲区搬运下一帧比较值到 CCR1，脉冲时序不再依赖 CPU
+ * 缓冲区分为两半，DMA 半传输/传输完成中断时回调填充刚播放完的一半
+ *
+ * 非 STM32 编译时寄存器由内存中的模型代替，hostUpdateEvent() 模拟一个 PWM 周期，
+ * 可在主机上检查写入的寄存器与输出脉宽
+ */
+
+#define SERVO_DMA_BUFFER_FRAMES (SERVO_DMA_HALF_FRAMES * 2)
+
+/**
+ * 帧填充回调
+ * @param context  begin() 传入的上下文
+ * @param head     摇头比较值（微秒）
+ * @param nod      点头比较值（微秒）
+ * @param count    帧数
+ */
+#if !defined(ARDUINO_ARCH_STM32)
+/**
+ * 主机寄存器模型（字段名与 CMSIS 一致，只保留驱动用到的寄存器）
+ */
+struct ServoTimerModel {
+    uint32_t CR1, DIER, SR, EGR, CCMR1, CCER, PSC, ARR, CCR1;
+};
+
+struct ServoDmaStreamModel {
+    uint32_t CR, NDTR, FCR;
+    uintptr_t PAR, M0AR;
+};
+
+struct ServoDmaModel {
+    uint32_t LISR, LIFCR;
+};
+
+struct ServoGpioModel {
+    uint32_t MODER, OSPEEDR;
+    uint32_t AFR[2];
+};
+#endif
+
+typedef void (*ServoFrameCallback)(void* context, uint32_t* head, uint32_t* nod, uint8_t count);
+
+class ServoPWMBackend {
+private:
+    uint32_t headFrames[SERVO_DMA_BUFFER_FRAMES];
+    uint32_t nodFrames[SERVO_DMA_BUFFER_FRAMES];
+
+    ServoFrameCallback frameCallback;
+    void* callbackContext;
+
+    uint32_t refills;       // 已填充的半缓冲区次数
+    uint32_t dmaErrors;     // DMA 传输错误次数
+    bool running;
+
+    static ServoPWMBackend* instance;
+
+    /**
+     * 配置一路：GPIO 复用、定时器 PWM 模式 1、DMA 循环搬运到 CCR1
+     */
+    void setupChannel(uint8_t axis, uint32_t timerClock);
+
+public:
+    ServoPWMBackend();
+
+    /**
+     * 以初始脉宽填满缓冲区并启动两路 PWM
+     */
+    void begin(uint16_t headPulse, uint16_t nodPulse,
+               ServoFrameCallback callback, void* context);
+
+    /**
+     * 以给定脉宽重新填满缓冲区并启动输出（begin() 之后用于从 stop() 恢复）
+     */
+    void start(uint16_t headPulse, uint16_t nodPulse);
+
+    /**
+     * 停止定时器与 DMA，引脚不再输出脉冲，DMA 中断随之停止
+     */
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    /**
+     * DMA 中断处理（由 DMA1_Stream0_IRQHandler 调用）
+     */
+    void handleDmaInterrupt();
+
+    uint32_t getRefillCount() const { return refills; }
+    uint32_t getDmaErrorCount() const { return dmaErrors; }
+
+    static ServoPWMBackend* getInstance() { return instance; }
+
+#if !defined(ARDUINO_ARCH_STM32)
+    /**
+     * 主机模型：模拟一次定时器更新事件（一个 PWM 周期）
+     * 预装载比较值生效 -> DMA 搬运下一帧 -> 必要时触发 DMA 中断
+     */
+    static void hostUpdateEvent();
+
+    /**
+     * 主机模型：当前周期输出的脉宽（微秒），axis 0 为摇头，1 为点头
+     */
+    static uint32_t hostActivePulse(uint8_t axis);
+
+    static const ServoTimerModel& hostTimer(uint8_t axis);
+    static const ServoDmaStreamModel& hostDmaStream(uint8_t axis);
+#endif
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef SERVO_TRAJECTORY_H
+#define SERVO_TRAJECTORY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * 舵机轨迹规划
+ * 以固定频率（SERVO_UPDATE_RATE_HZ）采样，避免目标角度突变带来的电流尖峰
+ */
+
+/**
+ * 速度曲线类型
+ */
+enum class MotionProfile : uint8_t {
+    TRAPEZOIDAL,    // 梯形速度：匀加速 - 匀速 - 匀减速
+    MINIMUM_JERK    // 最小加加速度：五次多项式，起止速度与加速度均为 0
+};
+
+/**
+ * 单轴运动限制
+ */
+struct AxisLimits {
+    float maxVelocity;        // 最大角速度（度/秒）
+    float maxAcceleration;    // 最大角加速度（度/秒²）
+};
+
+/**
+ * 单轴轨迹
+ * plan() 在主循环中调用，sample() 在定时器中断中调用
+ */
+class ServoTrajectory {
+private:
+    float startPos;           // 起点角度
+    float distance;           // 位移（带符号）
+    float duration;           // 总时长（秒）
+    float accelTime;          // 梯形曲线加速段时长（秒）
+    float cruiseVelocity;     // 梯形曲线匀速段速度（度/秒）
+    float position;           // 最近一次采样的角度
+    uint32_t startTick;
+    MotionProfile profile;
+    bool moving;
+
+public:
+    ServoTrajectory();
+
+    /**
+     * 立即设定当前位置（不产生运动）
+     */
+    void reset(float pos);
+
+    /**
+     * 从当前位置规划到目标角度
+     * @param minDuration 期望时长（秒），0 表示在限制内尽快到达；
+     *                    小于限制允许的最短时长时自动延长
+     * @return 实际时长（秒）
+     */
+    float plan(float target, MotionProfile type, const AxisLimits& limits,
+               float minDuration, uint32_t nowTick);
+
+    /**
+     * 在限制内走完 distance 所需的最短时长（秒）
+     */
+    static float minimumDuration(float distance, MotionProfile type, const AxisLimits& limits);
+
+    /**
+     * 采样当前时刻的角度
+     */
+    float sample(uint32_t nowTick);
+
+    /**
+     * 是否仍在运动
+     */
+    bool isMoving() const { return moving; }
+
+    /**
+     * 是否为原地保持段（角度不变，只占用时间）
+     */
+    bool isHolding() const { return moving && distance == 0; }
+
+    /**
+     * 最近一次采样的角度
+     */
+    float getPosition() const { return position; }
+
+    /**
+     * 目标角度
+     */
+    float getTarget() const { return startPos + distance; }
+
+    /**
+     * 轨迹总时长（秒）
+     */
+    float getDuration() const { return duration; }
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef SPEECH_OUTPUT_H
+#define SPEECH_OUTPUT_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * 播报优先级
+ */
+enum class SpeechPriority : uint8_t {
+    CHATTER,      // 闲聊、动作伴随语音
+    NORMAL,       // 查询结果等普通播报
+    ALERT         // 温湿度警告等，优先于其它播报且不受限流约束
+};
+
+/**
+ * 播报结果
+ */
+enum class SpeechStatus : uint8_t {
+    COMPLETED,    // 已全部写入串口
+    CANCELLED,    // 等待超过有效期被取消
+    DROPPED       // 队列已满被挤出
+};
+
+/**
+ * 播报完成事件
+ */
+struct SpeechEvent {
+    uint16_t id;
+    SpeechStatus status;
+};
+
+/**
+ * 播报统计
+ */
+struct SpeechStats {
+    uint32_t queued;
+    uint32_t completed;
+    uint32_t cancelled;
+    uint32_t dropped;
+};
+
+/**
+ * 非阻塞语音播报发送队列
+ * speak() 只把文本复制进定长槽位；update() 每次只写入串口发送缓冲区
+ * 当前空闲的字节数（availableForWrite），由串口中断在后台发送，主循环不会阻塞
+ */
+class SpeechOutputQueue {
+private:
+    struct Utterance {
+        char text[SPEECH_TEXT_MAX_LEN];
+        uint8_t length;
+        SpeechPriority priority;
+        uint16_t id;
+        unsigned long queuedTime;
+        unsigned long deadline;
+        bool used;
+    };
+
+    Utterance slots[SPEECH_QUEUE_CAPACITY];
+    int8_t current;               // 正在发送的槽位，-1 表示空闲
+    uint8_t sentBytes;            // 当前播报已写入的字节数（含结尾换行）
+    uint16_t nextId;
+    unsigned long lastStartTime;
+
+    SpeechEvent events[SPEECH_EVENT_CAPACITY];
+    uint8_t eventHead;
+    uint8_t eventCount;
+
+    SpeechStats stats;
+
+    void postEvent(uint16_t id, SpeechStatus status);
+
+    /**
+     * 挑选下一条要发送的播报（优先级高者先，同级先到先发），顺带取消过期播报
+     */
+    int8_t selectNext(unsigned long now);
+
+public:
+    SpeechOutputQueue();
+
+    /**
+     * 播报入队（只做定长拷贝，不访问串口）
+     * 超过 SPEECH_TEXT_MAX_LEN - 1 字节的文本在 UTF-8 字符边界截断
+     * @param ttl 有效期（毫秒），超时仍未开始发送则取消
+     * @return 播报序号，入队失败返回 0
+     */
+    uint16_t speak(const char* text, SpeechPriority priority, 
+                   unsigned long now, unsigned long ttl);
+
+    /**
+     * 推进发送，应在主循环中定期调用
+     */
+    void update(unsigned long now);
+
+    /**
+     * 取出一个完成事件
+     * @return false 没有事件
+     */
+    bool pollEvent(SpeechEvent& event);
+
+    /**
+     * 是否正在发送或有待发送的播报
+     */
+    bool isBusy() const;
+
+    /**
+     * 获取统计信息
+     */
+    const SpeechStats& getStats() const { return stats; }
+};
+
+#endif
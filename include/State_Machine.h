@@ -7,48 +7,148 @@
 #include "Servo_Controller.h"
 #include "DHT_Manager.h"
 #include "ASRPRO_Module.h"
+#include "Motion_Arbiter.h"
 
 /**
  * 系统状态
+ * 前六个为叶子状态（当前状态总是叶子），其后为复合状态
  */
-enum class SystemState {
+enum class SystemState : uint8_t {
     IDLE,              // 空闲状态
     MONITORING,        // 监测环境
     VOICE_TRIGGERED,   // 语音触发
     TEMP_WARNING,      // 温度警告
     HUMID_WARNING,     // 湿度警告
     WEATHER_DISPLAY,   // 显示天气
+    WARNING,           // 复合状态：温湿度警告的父状态
+    TOP,               // 复合状态：根
+    COUNT
+};
+
+/**
+ * 状态机事件
+ */
+enum class FsmEvent : uint8_t {
+    VOICE,             // 收到语音指令（参数为 VoiceCommand）
+    TEMP_HIGH,         // 温度过高
+    TEMP_LOW,          // 温度过低
+    HUMID_ABNORMAL,    // 湿度异常
+    ENV_NORMAL,        // 温湿度正常
+    TIMEOUT,           // 状态定时器到期（进入状态时按该状态的超时时间装载）
+    REFRESH,           // 读数刷新定时器到期（周期定时器，仅在监测状态运行）
+    COUNT
+};
+
+/**
+ * 状态机定时器
+ */
+enum class FsmTimerId : uint8_t {
+    STATE,             // 单次：状态超时，产生 TIMEOUT
+    REFRESH,           // 周期：读数刷新，产生 REFRESH
+    COUNT
+};
+
+struct FsmTimer {
+    unsigned long deadline;
+    uint16_t period;          // 0 表示单次定时器
+    bool armed;
+};
+
+/**
+ * 转移记录
+ */
+struct FsmTraceEntry {
+    uint32_t time;            // millis()
+    SystemState from;
+    SystemState to;           // 内部转移时与 from 相同
+    FsmEvent event;
+    uint8_t arg;              // 事件参数（语音指令等）
 };
 
 /**
  * 状态机类
- * 管理系统的状态转移和动作触发
+ * 状态图（父状态、超时、进入/退出动作、转移表）在 State_Machine.cpp 中以
+ * constexpr 表定义，编译期展开继承关系，运行时按 [状态][事件] 直接查表分发
+ * 转移不再打印串口，而是写入环形记录，需要时调用 printTrace()
+ * 超时与周期刷新由定时器驱动，到期时只投递一次事件；屏幕只在内容变化时重绘
  */
 class StateMachine {
 private:
+    typedef bool (StateMachine::*Guard)(uint8_t arg);
+    typedef void (StateMachine::*Action)(uint8_t arg);
+    friend struct StateChart;
+
     SystemState currentState;
     SystemState previousState;
     unsigned long stateChangeTime;
-    unsigned long lastActionTime;
+    
+    // 定时器到期时各投递一次事件，不再每个周期比较经过时间
+    FsmTimer timers[(uint8_t)FsmTimerId::COUNT];
+    
+    // 屏幕上当前的内容，内容不变时不重绘
+    bool emotionShown;          // 屏幕显示的是表情（而非读数）
+    int16_t shownTemp;          // 屏幕上的温度（0.1℃），FSM_READING_NONE 表示未显示读数
+    int16_t shownHumidity;      // 屏幕上的湿度（0.1%）
+    uint32_t redrawCount;
     
     // 引用到各个模块
     OLEDDisplay* display;
     ServoController* servo;
     DHTManager* dhtManager;
     ASRPROModule* asrModule;
+    MotionArbiter* motion;      // 舵机动作统一经由仲裁器提交
+    
+    // 转移记录环形缓冲区
+    FsmTraceEntry trace[FSM_TRACE_CAPACITY];
+    uint8_t traceHead;
+    uint8_t traceCount;
     
-    // 状态转移函数
-    void handleIdleState();
-    void handleMonitoringState();
-    void handleVoiceTriggeredState();
-    void handleTempWarningState();
-    void handleHumidWarningState();
-    void handleWeatherDisplayState();
+    // 守卫
+    bool guardMotionIdle(uint8_t arg);
+    bool guardReadingsChanged(uint8_t arg);
     
-    // 辅助函数
-    void transitionTo(SystemState newState);
-    void processVoiceCommand(VoiceCommand cmd);
-    void checkEnvironmentalThresholds();
+    // 动作
+    void actVoiceCommand(uint8_t arg);
+    void actShowHot(uint8_t arg);
+    void actShowCold(uint8_t arg);
+    void actShowHumid(uint8_t arg);
+    void actShowNormal(uint8_t arg);
+    void actRefreshReadings(uint8_t arg);
+    void actStartRefresh(uint8_t arg);
+    void actStopRefresh(uint8_t arg);
+    void actWarnShakeLeft(uint8_t arg);
+    void actWarnShakeRight(uint8_t arg);
+    
+    void armTimer(FsmTimerId id, uint16_t delay, uint16_t period);
+    void cancelTimer(FsmTimerId id);
+    
+    /**
+     * 进入新状态后按状态表装载状态定时器
+     */
+    void armStateTimer();
+    
+    /**
+     * 定时器是否到期；周期定时器到期后自动装载下一周期
+     */
+    bool timerExpired(FsmTimerId id, unsigned long now);
+    
+    /**
+     * 显示表情，与屏幕上已有表情相同时跳过
+     */
+    void showEmotion(EmotionState emotion);
+    
+    /**
+     * 显示温湿度读数并记录屏幕内容
+     */
+    void showReadings();
+    
+    void recordTrace(SystemState from, SystemState to, FsmEvent event, uint8_t arg);
+    
+    /**
+     * 根据温湿度读数得出环境事件
+     * @return false 读数无效，不产生事件
+     */
+    bool evaluateEnvironment(FsmEvent& event);
     
 public:
     StateMachine();
@@ -57,7 +157,7 @@ public:
      * 初始化状态机
      */
     void begin(OLEDDisplay* disp, ServoController* srv, 
-               DHTManager* dht, ASRPROModule* asr);
+               DHTManager* dht, ASRPROModule* asr, MotionArbiter* arbiter);
     
     /**
      * 更新状态机
@@ -65,17 +165,49 @@ public:
      */
     void update();
     
+    /**
+     * 分发一个事件
+     * 目标为当前状态或其祖先时按内部转移处理：只执行动作，不退出/进入、不重置计时
+     * @return true 有转移被触发
+     */
+    bool dispatch(FsmEvent event, uint8_t arg = 0);
+    
     /**
      * 获取当前状态
      */
     SystemState getCurrentState() const { return currentState; }
     
+    /**
+     * 获取上一个状态
+     */
+    SystemState getPreviousState() const { return previousState; }
+    
+    /**
+     * 屏幕重绘次数（表情与读数）
+     */
+    uint32_t getRedrawCount() const { return redrawCount; }
+    
     /**
      * 获取状态持续时间
      */
     unsigned long getStateElapsedTime() const {
         return millis() - stateChangeTime;
     }
+    
+    /**
+     * 转移记录条数
+     */
+    uint8_t getTraceCount() const { return traceCount; }
+    
+    /**
+     * 读取转移记录，index 0 为最早的一条
+     */
+    bool getTrace(uint8_t index, FsmTraceEntry& entry) const;
+    
+    /**
+     * 打印全部转移记录（调试用）
+     */
+    void printTrace(Print& out) const;
 };
 
 #endif
@@ -0,0 +1,122 @@
+#ifndef VOICE_COMMAND_QUEUE_H
+#define VOICE_COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * 语音识别指令类型
+ */
+enum class VoiceCommand {
+    UNKNOWN,      // 未知命令
+    HAPPY,        // "开心"
+    SAD,          // "伤心"
+    ANGRY,        // "生气"
+    SLEEPY,       // "困倦"
+    SURPRISED,    // "惊讶"
+    SHAKE,        // "摇头"
+    NOD,          // "点头"
+    QUERY_WEATHER,// "天气"
+    QUERY_TEMP,   // "温度"
+    HELP          // "帮助"
+};
+
+/**
+ * 指令来源
+ */
+enum class VoiceSource : uint8_t {
+    TEXT,         // 文本行关键词
+    BINARY        // 二进制帧
+};
+
+/**
+ * 队列中的一条语音指令
+ */
+struct VoiceCommandEntry {
+    VoiceCommand command;
+    VoiceSource source;
+    uint8_t confidence;       // 置信度 0~100
+    uint8_t repeats;          // 被合并的重复次数
+    uint16_t id;              // 入队序号
+    unsigned long timestamp;  // 首次到达时间
+    unsigned long lastSeen;   // 最近一次重复到达时间（只用于合并窗口）
+    uint32_t rxCycles;        // 首字节到达的周期计数（延迟追踪用）
+    uint32_t matchCycles;     // 关键词命中的周期计数（延迟追踪用）
+};
+
+/**
+ * 队列统计
+ */
+struct VoiceQueueStats {
+    uint32_t enqueued;        // 新入队条数
+    uint32_t coalesced;       // 被合并的重复指令数
+    uint32_t dropped;         // 队列满被丢弃的指令数
+    uint32_t expired;         // 超龄未处理被丢弃的指令数
+};
+
+/**
+ * 获取指令的处理优先级（数值越大越先处理）
+ */
+uint8_t voiceCommandPriority(VoiceCommand cmd);
+
+/**
+ * 定长语音指令队列
+ * - 合并窗口内重复的相同指令只保留一条
+ * - 首次到达后超过 VOICE_COMMAND_MAX_AGE 未处理的指令被丢弃，重复到达不延长
+ * - 出队按优先级，同优先级先到先出
+ */
+class VoiceCommandQueue {
+private:
+    VoiceCommandEntry entries[VOICE_QUEUE_CAPACITY];   // 按到达顺序存放
+    uint8_t count;
+    uint16_t nextId;
+    VoiceQueueStats stats;
+
+    void removeAt(uint8_t index);
+
+    /**
+     * 丢弃超龄指令
+     */
+    void expire(unsigned long now);
+
+public:
+    VoiceCommandQueue();
+
+    /**
+     * 指令入队
+     * @return 入队或合并后的条目序号，被丢弃时返回 0
+     */
+    uint16_t push(VoiceCommand cmd, VoiceSource source, uint8_t confidence, unsigned long now,
+                  uint32_t rxCycles = 0, uint32_t matchCycles = 0);
+
+    /**
+     * 用新指令替换尚未处理的条目（同一行文本命中更高优先级关键词时使用）
+     * @return 新条目序号；原条目已被处理时按新指令入队
+     */
+    uint16_t replace(uint16_t id, VoiceCommand cmd, VoiceSource source, 
+                     uint8_t confidence, unsigned long now,
+                     uint32_t rxCycles = 0, uint32_t matchCycles = 0);
+
+    /**
+     * 取出优先级最高的指令
+     * @return false 队列为空
+     */
+    bool pop(VoiceCommandEntry& out, unsigned long now);
+
+    /**
+     * 队列中的指令数
+     */
+    uint8_t size() const { return count; }
+
+    /**
+     * 清空队列
+     */
+    void clear() { count = 0; }
+
+    /**
+     * 获取统计信息
+     */
+    const VoiceQueueStats& getStats() const { return stats; }
+};
+
+#endif
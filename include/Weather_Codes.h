@@ -0,0 +1,38 @@
+#ifndef WEATHER_CODES_H
+#define WEATHER_CODES_H
+
+#include <Arduino.h>
+
+/**
+ * 心知天气现象代码表
+ * 天气以 API 返回的数字 code 存储，文字与类型均由闪存常量表查得
+ * 参考：https://docs.seniverse.com/api/start/code.html
+ */
+
+enum class WeatherType : uint8_t {
+    SUNNY,          // 晴天
+    CLOUDY,         // 阴天
+    RAINY,          // 下雨
+    SNOWY,          // 下雪
+    STORMY,         // 暴风雨
+    FOGGY,          // 雾/霾/沙尘
+    WINDY,          // 大风
+    UNKNOWN         // 未知
+};
+
+#define WEATHER_TYPE_COUNT   8      // WeatherType 枚举个数
+#define WEATHER_CODE_MAX     38     // 心知天气已定义的最大代码
+#define WEATHER_CODE_UNKNOWN 99     // 心知天气"未知"代码
+#define WEATHER_TEXT_MAX_LEN 16     // 天气文字最大长度（含结尾 '\0'）
+
+/**
+ * 天气代码 -> 天气类型
+ */
+WeatherType weatherTypeFromCode(uint8_t code);
+
+/**
+ * 天气代码 -> 天气文字（英文，存放于闪存，OLED 字库可直接显示）
+ */
+const char* weatherConditionText(uint8_t code);
+
+#endif
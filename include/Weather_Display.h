@@ -5,6 +5,7 @@
 #include "config.h"
 #include "OLED_Display.h"
 #include "Emotion_Bitmap.h"
+#include "Weather_Service.h"
 
 /**
  * 天气显示模块
@@ -12,15 +13,6 @@
  * 支持图形化天气表示
  */
 
-enum class WeatherType {
-    SUNNY,          // 晴天
-    CLOUDY,         // 阴天
-    RAINY,          // 下雨
-    SNOWY,          // 下雪
-    STORMY,         // 暴风雨
-    UNKNOWN         // 未知
-};
-
 /**
  * 天气显示管理类
  */
@@ -29,23 +21,18 @@ private:
     OLEDDisplay* display;
     EmotionBitmapLibrary* bitmapLib;
     WeatherType currentWeatherType;
-    String lastWeatherText;
-    float lastTempMax, lastTempMin;
-    
-    /**
-     * 字符串转天气类型
-     */
-    WeatherType parseWeatherType(const String& weatherText);
+    uint8_t lastWeatherCode;
+    int8_t lastTempMax, lastTempMin;
     
     /**
      * 绘制详细天气界面
      */
-    void drawDetailedWeatherUI(const char* weather, float tempMax, float tempMin);
+    void drawDetailedWeatherUI(const WeatherData& weather);
     
     /**
      * 绘制紧凑天气界面
      */
-    void drawCompactWeatherUI(const char* weather, float tempMax, float tempMin);
+    void drawCompactWeatherUI(const WeatherData& weather);
     
 public:
     WeatherDisplay();
@@ -58,12 +45,12 @@ public:
     /**
      * 显示天气信息（完整版）
      */
-    void displayWeatherFull(const char* weather, float tempMax, float tempMin);
+    void displayWeatherFull(const WeatherData& weather);
     
     /**
      * 显示天气信息（紧凑版）
      */
-    void displayWeatherCompact(const char* weather, float tempMax, float tempMin);
+    void displayWeatherCompact(const WeatherData& weather);
     
     /**
      * 显示天气趋势（温度变化）
@@ -72,8 +59,9 @@ public:
     
     /**
      * 生成天气建议文本
+     * @return 指向闪存建议表的字符串，无需释放
      */
-    String generateWeatherAdvice(const char* weather, float temp, float humidity);
+    const char* generateWeatherAdvice(WeatherType type, float temp, float humidity);
     
     /**
      * 获取当前天气类型
@@ -2,18 +2,22 @@
 #define WEATHER_SERVICE_H
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
 #include "config.h"
+#include "Weather_Codes.h"
+#include "Config_Store.h"
 
 /**
  * 天气数据结构
+ * 纯 POD，可直接按值拷贝，不含任何堆上字符串
+ * 天气文字通过 weatherConditionText(code) 从闪存表获取
  */
 struct WeatherData {
-    String weather;        // 天气描述
-    float temperature;     // 当前温度
-    float tempMax;         // 最高温度
-    float tempMin;         // 最低温度
-    String updateTime;     // 更新时间
+    uint8_t code;          // 心知天气现象代码
+    WeatherType type;      // 代码映射后的天气类型
+    int8_t temperature;    // 当前温度（摄氏度）
+    int8_t tempMax;        // 最高温度
+    int8_t tempMin;        // 最低温度
+    uint32_t updateTime;   // 数据更新时间（UTC 秒级时间戳）
     bool isValid;          // 数据是否有效
 };
 
@@ -36,14 +40,14 @@ public:
     
     /**
      * 从心知天气 API 获取数据
-     * 需要先调用 WiFiManager 的连接方法确保网络可用
+     * 调用前由 ConnectivitySupervisor::isReady(ConnLayer::WEATHER) 判断网络可用、退避已到期
      */
     bool updateWeather();
     
     /**
      * 获取当前天气数据
      */
-    WeatherData getWeather() const { return currentWeather; }
+    const WeatherData& getWeather() const { return currentWeather; }
     
     /**
      * 获取最后一次更新时间
@@ -54,11 +58,17 @@ public:
      * 检查是否需要更新（根据时间间隔）
      */
     bool needsUpdate() const {
-        return (millis() - lastUpdateTime) > WEATHER_UPDATE_INTERVAL;
+        return (millis() - lastUpdateTime) > g_config.weatherUpdateInterval;
     }
     
+    /**
+     * 请求并解析天气数据（阻塞，最长约 5 秒）
+     */
+    bool fetchWeather();
+    
     /**
      * 解析JSON天气数据
+     * 直接在响应缓冲区上按字段扫描，不构建 JSON 文档
      */
     bool parseWeatherJSON(const char* jsonStr);
 };
@@ -4,18 +4,16 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include "config.h"
+#include "Input_Trace.h"
 
 /**
  * WiFi 连接管理类
- * 处理 ESP8266 的 WiFi 连接和重连
+ * 处理 ESP8266 的 WiFi 连接；何时重连由 ConnectivitySupervisor 决定
  */
 class WiFiManager {
 private:
     String ssid;
     String password;
-    unsigned long lastConnectAttempt;
-    uint16_t reconnectAttempts;
-    const uint16_t maxReconnectAttempts = 10;
     
 public:
     WiFiManager();
@@ -26,21 +24,15 @@ public:
     void begin(const char* ssid, const char* password);
     
     /**
-     * 连接到WiFi
+     * 发起一次连接（异步，结果由 isConnected() 反映）
      */
-    bool connect();
+    void connect();
     
     /**
-     * 检查连接状态并进行必要的重连
-     * 应在主循环中定期调用
-     */
-    void update();
-    
-    /**
-     * 获取连接状态
+     * 获取连接状态（经输入录制，回放时返回录制的状态）
      */
     bool isConnected() const { 
-        return WiFi.status() == WL_CONNECTED; 
+        return g_inputTrace.traceLink(WiFi.status() == WL_CONNECTED); 
     }
     
     /**
@@ -21,6 +21,14 @@
 #define UART_BAUD_ASRPRO 9600
 #define UART_BAUD_ESP8266 115200
 
+// ASRPRO 链路模式
+#define ASRPRO_LINK_TEXT 0      // 仅文本行
+#define ASRPRO_LINK_AUTO 1      // 自动识别文本行与二进制帧
+#define ASRPRO_LINK_BINARY 2    // 仅二进制帧
+#define ASRPRO_LINK_MODE ASRPRO_LINK_AUTO
+#define ASRPRO_FRAME_TIMEOUT 20 // 二进制帧字节间超时（毫秒）
+#define ASRPRO_DUPLICATE_WINDOW 1000 // 距上次收到不超过该时间的同序号帧视为重发（毫秒）
+
 // ==================== 温湿度阈值 ====================
 #define TEMP_HIGH_THRESHOLD 30.0f   // 温度过高警告值
 #define TEMP_LOW_THRESHOLD 15.0f    // 温度过低警告值
@@ -39,15 +47,143 @@
 // MQTT 主题
 #define MQTT_TOPIC_STATUS "$dp/post/your_device_id"
 #define MQTT_TOPIC_CONTROL "$dp/cmd/your_device_id"
+#define MQTT_TOPIC_CHOREO "smartdesk/your_device_id/choreo"   // 编舞脚本下载
+#define MQTT_TOPIC_SHADOW_DESIRED "smartdesk/your_device_id/shadow/desired"     // 设备影子：期望状态（下行）
+#define MQTT_TOPIC_SHADOW_REPORTED "smartdesk/your_device_id/shadow/reported"   // 设备影子：实际状态（上行）
+#define MQTT_TOPIC_CONFIG "smartdesk/your_device_id/config"   // 运行时配置修改
+
+// ==================== 连接监管 ====================
+#define CONN_BACKOFF_BASE 1000          // 重试间隔下限
+#define CONN_LINK_BACKOFF_MAX 60000     // WiFi 重试间隔上限 1分钟
+#define CONN_BROKER_BACKOFF_MAX 120000  // MQTT 重试间隔上限 2分钟
+#define CONN_SERVICE_BACKOFF_MAX 600000 // 天气请求重试间隔上限 10分钟
+#define CONN_LINK_TIMEOUT 15000         // 发起 WiFi 连接后多久未连上算失败
+#define CONN_RESUME_JITTER 5000         // 下层恢复后上层首次尝试的随机延迟上限
+#define CONN_STABLE_TIME 60000          // 连接保持多久后失败计数清零
 
 // ==================== 心知天气 API ====================
 #define WEATHER_API_URL "api.seniverse.com"
 #define WEATHER_API_PATH "/v3/weather/now.json?key=YOUR_API_KEY&location=auto&lang=zh-Hans"
 #define WEATHER_UPDATE_INTERVAL 600000  // 10分钟更新一次
+#define WEATHER_RESPONSE_BUFFER_SIZE 1024 // 天气响应体缓冲区大小（字节）
 
 // ==================== 时间配置 ====================
 #define SENSOR_READ_INTERVAL 2000       // 传感器读取间隔 2秒
 #define MQTT_HEARTBEAT_INTERVAL 30000   // MQTT心跳 30秒
 #define SERVO_ACTION_DURATION 500       // 舵机动作持续时间 500ms
 
+// ==================== 舵机轨迹 ====================
+#define SERVO_TRAJECTORY_TIMER TIM14    // 轨迹更新定时器，仅 Arduino 后端使用（TIM6/TIM7 已被 Tone/Servo 库占用）
+#define SERVO_UPDATE_RATE_HZ 100        // 轨迹更新频率 100Hz
+#define SERVO_PULSE_MIN 500             // 0° 对应脉宽（微秒）
+#define SERVO_PULSE_MAX 2500            // 180° 对应脉宽（微秒）
+#define SERVO_HEAD_MAX_VELOCITY 240.0f  // 摇头最大角速度（度/秒）
+#define SERVO_HEAD_MAX_ACCEL 1200.0f    // 摇头最大角加速度（度/秒²）
+#define SERVO_NOD_MAX_VELOCITY 180.0f   // 点头最大角速度（度/秒），带动整个头部，取小一些
+#define SERVO_NOD_MAX_ACCEL 900.0f      // 点头最大角加速度（度/秒²）
+#define MOTION_QUEUE_CAPACITY 16        // 每轴关键帧队列容量
+
+#define MOTION_ARBITER_CAPACITY 4       // 动作仲裁排队请求数
+#define MOTION_REQUEST_TTL 3000         // 动作请求默认有效期 3秒
+
+// ==================== 舵机输出 ====================
+#define SERVO_BACKEND_ARDUINO 0         // Arduino Servo 库（软件中断产生脉冲）
+#define SERVO_BACKEND_TIMER_DMA 1       // TIM5/TIM2 硬件 PWM，DMA 更新比较值
+#define SERVO_BACKEND SERVO_BACKEND_TIMER_DMA
+#define SERVO_PWM_FRAME_HZ 50           // PWM 周期 20ms
+#define SERVO_DMA_HALF_FRAMES 2         // DMA 半缓冲区帧数（每 40ms 填充一次）
+
+// ==================== 舵机功耗 ====================
+#define SERVO_IDLE_DETACH_MS 2000       // 空闲 2秒后关闭 PWM
+#define SERVO_WAKE_LEAD_MS 60           // 恢复 PWM 后先保持 60ms 再运动
+#define SERVO_STAGGER_MS 120            // 两轴同时运动时点头轴推迟起步，0 表示不错峰
+#define SERVO_SUPPLY_VOLTAGE 5.0f       // 舵机供电电压（伏）
+#define SERVO_HOLD_CURRENT_MA 10.0f     // 单轴保持电流（毫安）
+#define SERVO_VELOCITY_CURRENT 0.6f     // 每 度/秒 对应电流（毫安）
+#define SERVO_ACCEL_CURRENT 0.08f       // 每 度/秒² 对应电流（毫安）
+
+// ==================== 语音指令队列 ====================
+#define VOICE_QUEUE_CAPACITY 8          // 队列容量
+#define VOICE_COALESCE_WINDOW 1500      // 相同指令合并窗口 1.5秒
+#define VOICE_COMMAND_MAX_AGE 8000      // 指令最长等待时间 8秒
+#define VOICE_CONFIDENCE_TEXT 80        // 文本关键词置信度
+#define VOICE_CONFIDENCE_BINARY 100     // 二进制帧（CRC 校验）置信度
+
+// ==================== 语音播报队列 ====================
+#define SPEECH_QUEUE_CAPACITY 6         // 待播报条数
+#define SPEECH_TEXT_MAX_LEN 48          // 单条播报最大长度（含结尾 '\0'）
+#define SPEECH_EVENT_CAPACITY 8         // 完成事件缓存条数
+#define SPEECH_MIN_INTERVAL 1500        // 非警告播报最小间隔 1.5秒
+#define SPEECH_DEFAULT_TTL 5000         // 播报默认有效期 5秒
+
+// ==================== 多模态反馈 ====================
+#define FEEDBACK_MAX_STEPS 16           // 单个反馈序列最多步数
+#define FEEDBACK_LOOKAHEAD_MS 50        // 提前预绘制下一帧表情、预装下一段舵机运动（应大于主循环周期）
+
+// ==================== 远程控制 ====================
+#define REMOTE_BATCH_MAX 8              // 单个指令包最多指令数（不超过 8，失败指令按位记录）
+#define REMOTE_JSON_TOKENS 64           // 单个指令包最多词元数（每条指令约 5~7 个）
+#define REMOTE_ID_MAX_LEN 24            // 指令包 ID 最大长度（含结尾 '\0'）
+#define REMOTE_ID_HISTORY 16            // 记住最近多少个已执行的 ID，重发时不再执行
+#define REMOTE_SERVO_MOVE_MS 600        // 指定角度的舵机指令运动时长
+
+// ==================== 设备影子 ====================
+#define SHADOW_JSON_TOKENS 32           // 单条影子消息最多词元数
+#define SHADOW_REPORT_INTERVAL 2000     // 实际状态增量的最小上报间隔（期间的变化合并为一条）
+#define SHADOW_SYNC_RETRY 5000          // 重连后握手未获应答时的重发间隔
+
+// ==================== 键值存储 ====================
+#define KV_FLASH_SECTOR 6               // 第一个扇区（6、7 两个扇区，0x08040000 起 256KB，固件须小于 256KB）
+#define KV_FLASH_ADDR 0x08040000UL
+#define KV_SECTOR_SIZE 0x20000UL
+#define KV_SECTOR_COUNT 2               // 扇区数（至少 2：一个写入，一个回收）
+#define KV_MAX_KEYS 32                  // 最多键数（RAM 索引大小）
+#define KV_VALUE_MAX 1024               // 单个值最大字节数
+#define KV_RECLAIM_WORDS 64             // 空闲时每次 update() 最多复制的字数（约 1ms）
+
+// ==================== 运行时配置 ====================
+// 以上阈值、周期与 MQTT 服务器为默认值，运行时以 g_config 为准（见 Config_Store.h）
+#define CONFIG_JSON_TOKENS 48           // 单条配置消息最多词元数
+
+// ==================== 编舞脚本 ====================
+#define CHOREO_SCRIPT_MAX 1024          // 单个脚本最大字节数（含头部与字符串表）
+#define CHOREO_STRING_MAX 8             // 单个脚本最多播报文本条数
+#define CHOREO_LOOP_DEPTH 4             // 循环最大嵌套层数
+#define CHOREO_EVENT_CAPACITY 8         // 已执行、等待到点的表情/播报事件数
+#define CHOREO_OPS_PER_TICK 32          // 每次 update() 最多执行的指令数
+#define CHOREO_MAX_DURATION_MS 120000UL // 脚本最长总时长（按全部分支累加估算）
+#define CHOREO_SLOT_COUNT 8             // 可下载的脚本槽位数
+#define CHOREO_CHUNK_MAX 192            // MQTT 单块数据最大字节数（PubSubClient 默认包长 256）
+
+// ==================== 延迟追踪 ====================
+#define LATENCY_TRACE_ENABLED 1         // 语音到动作延迟追踪开关
+#define LATENCY_HISTOGRAM_BUCKETS 96    // 直方图格数（覆盖约 0 ~ 16 秒）
+#define LATENCY_REPORT_INTERVAL 600000  // 延迟报告发布间隔 10分钟
+
+// ==================== 日志 ====================
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF   4
+
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG   // 低于该级别的日志在编译期移除
+#define LOG_DEFAULT_LEVEL LOG_LEVEL_INFO    // 上电时的运行时级别
+#define LOG_UART_BAUD 115200                // USART1（TX=PA9）
+#define LOG_BUFFER_SIZE 1024                // 日志环形缓冲区字节数（2 的幂）
+#define LOG_CONSOLE_BUFFER 64               // 控制台接收缓冲区（USART1 RX=PA10，DMA 循环接收）
+#define LOG_CONSOLE_LINE_MAX 96             // 控制台单行最大字节数
+
+// ==================== 输入录制 ====================
+// 经日志串口录制外部输入，供主机回放；默认关闭，由 env:native_replay 或 env:black_f407ve_record 打开
+#ifndef INPUT_RECORD_ENABLED
+#define INPUT_RECORD_ENABLED    0
+#endif
+#define INPUT_CHECKPOINT_MS     1000    // 输出摘要检查点间隔（毫秒）
+
+// ==================== 状态机 ====================
+#define FSM_TRACE_CAPACITY 32           // 转移记录环形缓冲区条数
+#define FSM_REFRESH_INTERVAL 2000       // 监测状态读数刷新周期（毫秒）
+#define FSM_TIMER_RETRY_MS 100          // 超时被守卫拒绝后重试间隔（毫秒）
+
 #endif
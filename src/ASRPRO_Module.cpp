@@ -1,80 +1,284 @@
 #include "ASRPRO_Module.h"
+#include "Latency_Trace.h"
+#include "Input_Trace.h"
 
-ASRPROModule::ASRPROModule() 
-    : inputBuffer(""), lastCommandTime(0), 
-      lastCommand(VoiceCommand::UNKNOWN) {
+// 串口按块读取，一块即一条输入录制记录
+static constexpr size_t ASRPRO_RX_CHUNK = INPUT_RECORD_MAX - 1;
+
+// ==================== 关键词表 ====================
+
+/**
+ * 语音关键词
+ * 同一行命中多个关键词时，priority 数值大的生效
+ */
+struct VoiceKeyword {
+    const char* text;
+    VoiceCommand command;
+    uint8_t priority;
+};
+
+static constexpr VoiceKeyword VOICE_KEYWORDS[] = {
+    {"happy",     VoiceCommand::HAPPY,         10},
+    {"开心",      VoiceCommand::HAPPY,         10},
+    {"sad",       VoiceCommand::SAD,           9},
+    {"伤心",      VoiceCommand::SAD,           9},
+    {"难过",      VoiceCommand::SAD,           9},
+    {"angry",     VoiceCommand::ANGRY,         8},
+    {"生气",      VoiceCommand::ANGRY,         8},
+    {"sleepy",    VoiceCommand::SLEEPY,        7},
+    {"困",        VoiceCommand::SLEEPY,        7},
+    {"睡眠",      VoiceCommand::SLEEPY,        7},
+    {"surprised", VoiceCommand::SURPRISED,     6},
+    {"惊讶",      VoiceCommand::SURPRISED,     6},
+    {"惊",        VoiceCommand::SURPRISED,     6},
+    {"shake",     VoiceCommand::SHAKE,         5},
+    {"摇头",      VoiceCommand::SHAKE,         5},
+    {"nod",       VoiceCommand::NOD,           4},
+    {"点头",      VoiceCommand::NOD,           4},
+    {"weather",   VoiceCommand::QUERY_WEATHER, 3},
+    {"天气",      VoiceCommand::QUERY_WEATHER, 3},
+    {"temp",      VoiceCommand::QUERY_TEMP,    2},
+    {"温度",      VoiceCommand::QUERY_TEMP,    2},
+    {"温",        VoiceCommand::QUERY_TEMP,    2},
+    {"help",      VoiceCommand::HELP,          1},
+    {"帮助",      VoiceCommand::HELP,          1},
+};
+
+static constexpr size_t VOICE_KEYWORD_COUNT = sizeof(VOICE_KEYWORDS) / sizeof(VOICE_KEYWORDS[0]);
+
+// ==================== 编译期自动机构建 ====================
+
+static constexpr uint8_t foldCase(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
 }
 
-void ASRPROModule::begin() {
-    UART_ASRPRO.begin(UART_BAUD_ASRPRO);
+static constexpr size_t keywordByteCount() {
+    size_t total = 0;
+    for (size_t i = 0; i < VOICE_KEYWORD_COUNT; i++) {
+        for (const char* p = VOICE_KEYWORDS[i].text; *p; p++) {
+            total++;
+        }
+    }
+    return total;
 }
 
-VoiceCommand ASRPROModule::parseCommand(const String& cmd) {
-    String lowerCmd = cmd;
-    lowerCmd.toLowerCase();
-    
-    // 去除空格和特殊字符
-    lowerCmd.trim();
-    
-    // 关键词识别
-    if (lowerCmd.indexOf("happy") != -1 || lowerCmd.indexOf("开心") != -1) {
-        return VoiceCommand::HAPPY;
+/**
+ * 字节分类表：只有关键词中出现过的字节拥有独立类别，其余字节归入 0 类
+ * 大写字母与对应小写字母同类，相当于匹配前转小写
+ */
+struct VoiceByteClasses {
+    uint8_t classOf[256];
+    uint8_t count;
+};
+
+static constexpr VoiceByteClasses buildByteClasses() {
+    VoiceByteClasses bc{};
+    bc.count = 1;
+    for (size_t i = 0; i < VOICE_KEYWORD_COUNT; i++) {
+        for (const char* p = VOICE_KEYWORDS[i].text; *p; p++) {
+            uint8_t b = foldCase((uint8_t)*p);
+            if (bc.classOf[b] == 0) {
+                bc.classOf[b] = bc.count++;
+            }
+        }
     }
-    else if (lowerCmd.indexOf("sad") != -1 || lowerCmd.indexOf("伤心") != -1 || 
-             lowerCmd.indexOf("难过") != -1) {
-        return VoiceCommand::SAD;
+    for (uint8_t c = 'A'; c <= 'Z'; c++) {
+        bc.classOf[c] = bc.classOf[foldCase(c)];
     }
-    else if (lowerCmd.indexOf("angry") != -1 || lowerCmd.indexOf("生气") != -1) {
-        return VoiceCommand::ANGRY;
+    return bc;
+}
+
+static constexpr VoiceByteClasses VOICE_BYTE_CLASSES = buildByteClasses();
+static constexpr size_t VOICE_CLASS_COUNT = VOICE_BYTE_CLASSES.count;
+
+/**
+ * 完整转移表形式的 Aho-Corasick 自动机
+ * next[s][c] 已经合并了失败指针，运行时无需回溯
+ */
+template <size_t STATES>
+struct VoiceAutomaton {
+    uint8_t next[STATES][VOICE_CLASS_COUNT];
+    uint8_t priority[STATES];           // 在该状态结束的最高优先级关键词，0 表示无
+    VoiceCommand command[STATES];
+    size_t stateCount;
+};
+
+template <size_t STATES>
+static constexpr VoiceAutomaton<STATES> buildAutomaton() {
+    VoiceAutomaton<STATES> a{};
+    a.stateCount = 1;
+
+    // 1. 构建字典树（根状态 0 不会成为子节点，因此 0 可表示"无边"）
+    for (size_t i = 0; i < VOICE_KEYWORD_COUNT; i++) {
+        size_t s = 0;
+        for (const char* p = VOICE_KEYWORDS[i].text; *p; p++) {
+            uint8_t c = VOICE_BYTE_CLASSES.classOf[foldCase((uint8_t)*p)];
+            if (a.next[s][c] == 0) {
+                if (a.stateCount >= STATES) {
+                    return a;  // 仅用于第一遍统计状态数
+                }
+                a.next[s][c] = (uint8_t)a.stateCount++;
+            }
+            s = a.next[s][c];
+        }
+        if (VOICE_KEYWORDS[i].priority > a.priority[s]) {
+            a.priority[s] = VOICE_KEYWORDS[i].priority;
+            a.command[s] = VOICE_KEYWORDS[i].command;
+        }
     }
-    else if (lowerCmd.indexOf("sleepy") != -1 || lowerCmd.indexOf("困") != -1 || 
-             lowerCmd.indexOf("睡眠") != -1) {
-        return VoiceCommand::SLEEPY;
+
+    // 2. 按层次遍历计算失败指针，并把缺失的边补全为失败转移
+    uint8_t fail[STATES] = {};
+    uint8_t queue[STATES] = {};
+    size_t head = 0, tail = 0;
+
+    for (size_t c = 0; c < VOICE_CLASS_COUNT; c++) {
+        if (a.next[0][c] != 0) {
+            queue[tail++] = a.next[0][c];
+        }
     }
-    else if (lowerCmd.indexOf("surprised") != -1 || lowerCmd.indexOf("惊讶") != -1 || 
-             lowerCmd.indexOf("惊") != -1) {
-        return VoiceCommand::SURPRISED;
+
+    while (head < tail) {
+        uint8_t s = queue[head++];
+
+        // 后缀上的关键词同样视为命中
+        if (a.priority[fail[s]] > a.priority[s]) {
+            a.priority[s] = a.priority[fail[s]];
+            a.command[s] = a.command[fail[s]];
+        }
+
+        for (size_t c = 0; c < VOICE_CLASS_COUNT; c++) {
+            uint8_t t = a.next[s][c];
+            if (t != 0) {
+                fail[t] = a.next[fail[s]][c];
+                queue[tail++] = t;
+            } else {
+                a.next[s][c] = a.next[fail[s]][c];
+            }
+        }
     }
-    else if (lowerCmd.indexOf("shake") != -1 || lowerCmd.indexOf("摇头") != -1) {
-        return VoiceCommand::SHAKE;
+
+    return a;
+}
+
+static constexpr size_t VOICE_MAX_STATES = keywordByteCount() + 1;
+static constexpr size_t VOICE_STATE_COUNT = buildAutomaton<VOICE_MAX_STATES>().stateCount;
+static_assert(VOICE_STATE_COUNT <= 256, "voice keyword automaton exceeds uint8_t states");
+
+static constexpr VoiceAutomaton<VOICE_STATE_COUNT> VOICE_AUTOMATON =
+    buildAutomaton<VOICE_STATE_COUNT>();
+
+// ==================== 运行时匹配 ====================
+
+VoiceCommand VoiceKeywordMatcher::feed(uint8_t c) {
+    state = VOICE_AUTOMATON.next[state][VOICE_BYTE_CLASSES.classOf[c]];
+
+    uint8_t p = VOICE_AUTOMATON.priority[state];
+    if (p > bestPriority) {
+        bestPriority = p;
+        return VOICE_AUTOMATON.command[state];
     }
-    else if (lowerCmd.indexOf("nod") != -1 || lowerCmd.indexOf("点头") != -1) {
-        return VoiceCommand::NOD;
+    return VoiceCommand::UNKNOWN;
+}
+
+ASRPROModule::ASRPROModule()
+    : decoder((uint8_t)VoiceCommand::HELP),
+      lastCommandTime(0), lastByteTime(0),
+      lineEntryId(0), binaryDetected(false),
+      lineStartCycles(0), frameStartCycles(0), lineStarted(false) {
+}
+
+void ASRPROModule::begin() {
+    UART_ASRPRO.begin(UART_BAUD_ASRPRO);
+}
+
+void ASRPROModule::handleTextByte(uint8_t c, uint32_t rxCycles) {
+#if ASRPRO_LINK_MODE != ASRPRO_LINK_BINARY
+    if (c == '\n' || c == '\r') {
+        // 命令结束
+        matcher.reset();
+        lineEntryId = 0;
+        lineStarted = false;
+        return;
     }
-    else if (lowerCmd.indexOf("weather") != -1 || lowerCmd.indexOf("天气") != -1) {
-        return VoiceCommand::QUERY_WEATHER;
+
+    if (!lineStarted) {
+        lineStartCycles = rxCycles;
+        lineStarted = true;
     }
-    else if (lowerCmd.indexOf("temp") != -1 || lowerCmd.indexOf("温度") != -1 || 
-             lowerCmd.indexOf("温") != -1) {
-        return VoiceCommand::QUERY_TEMP;
+
+    // 关键词一旦完整即入队；同一行后续出现更高优先级的关键词会替换尚未处理的条目
+    VoiceCommand cmd = matcher.feed(c);
+    if (cmd != VoiceCommand::UNKNOWN) {
+        lastCommandTime = millis();
+        uint32_t matchCycles = LatencyTracer::now();
+        if (lineEntryId != 0) {
+            lineEntryId = commandQueue.replace(lineEntryId, cmd, VoiceSource::TEXT,
+                                               VOICE_CONFIDENCE_TEXT, lastCommandTime,
+                                               lineStartCycles, matchCycles);
+        } else {
+            lineEntryId = commandQueue.push(cmd, VoiceSource::TEXT,
+                                            VOICE_CONFIDENCE_TEXT, lastCommandTime,
+                                            lineStartCycles, matchCycles);
+        }
     }
-    else if (lowerCmd.indexOf("help") != -1 || lowerCmd.indexOf("帮助") != -1) {
-        return VoiceCommand::HELP;
+#endif
+}
+
+void ASRPROModule::handleRxByte(uint8_t c) {
+    uint32_t rxCycles = LatencyTracer::now();
+    lastByteTime = millis();
+
+#if ASRPRO_LINK_MODE == ASRPRO_LINK_TEXT
+    handleTextByte(c, rxCycles);
+#else
+    if (!decoder.isPending()) {
+        frameStartCycles = rxCycles;
     }
-    
-    return VoiceCommand::UNKNOWN;
+
+    if (decoder.feed(c, lastByteTime)) {
+        lastCommandTime = lastByteTime;
+        binaryDetected = true;
+        commandQueue.push((VoiceCommand)decoder.getCommandId(), VoiceSource::BINARY,
+                          VOICE_CONFIDENCE_BINARY, lastCommandTime,
+                          frameStartCycles, LatencyTracer::now());
+    }
+
+    uint8_t t;
+    while (decoder.popTextByte(t)) {
+        handleTextByte(t, rxCycles);
+    }
+#endif
 }
 
 void ASRPROModule::update() {
-    // 从ASRPRO读取数据
-    while (UART_ASRPRO.available()) {
-        char c = UART_ASRPRO.read();
-        
-        if (c == '\n' || c == '\r') {
-            // 命令结束
-            if (inputBuffer.length() > 0) {
-                lastCommand = parseCommand(inputBuffer);
-                lastCommandTime = millis();
-                inputBuffer = "";  // 清空缓冲区
-            }
-        } else {
-            // 累积数据
-            inputBuffer += c;
-            
-            // 防止缓冲区溢出
-            if (inputBuffer.length() > 64) {
-                inputBuffer = inputBuffer.substring(inputBuffer.length() - 32);
-            }
+    // 从ASRPRO读取数据：录制时记下每块原始字节，回放时由录制内容代替
+    uint8_t chunk[ASRPRO_RX_CHUNK];
+    size_t n;
+    do {
+        n = 0;
+        while (n < sizeof(chunk) && UART_ASRPRO.available()) {
+            chunk[n++] = UART_ASRPRO.read();
+        }
+        n = g_inputTrace.traceVoice(chunk, n, sizeof(chunk));
+
+        for (size_t i = 0; i < n; i++) {
+            handleRxByte(chunk[i]);
+        }
+    } while (n > 0);
+
+#if ASRPRO_LINK_MODE != ASRPRO_LINK_TEXT
+    // 帧未收完且串口静默，视为丢字节或文本中的普通字节
+    if (decoder.isPending() && millis() - lastByteTime > ASRPRO_FRAME_TIMEOUT) {
+        decoder.flush();
+
+        uint8_t t;
+        while (decoder.popTextByte(t)) {
+            handleTextByte(t, frameStartCycles);
         }
     }
+#endif
+
+    // 推进语音播报发送
+    speechQueue.update(millis());
 }
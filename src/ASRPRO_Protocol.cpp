@@ -0,0 +1,115 @@
+#include "ASRPRO_Protocol.h"
+
+uint8_t asrproCrc8(const uint8_t* data, uint8_t length) {
+    uint8_t crc = 0x00;
+    for (uint8_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+ASRPROFrameDecoder::ASRPROFrameDecoder(uint8_t maxId)
+    : frameLength(0), releasedHead(0), releasedCount(0),
+      maxCommandId(maxId), commandId(0), sequence(0), hasSequence(false), sequenceTime(0) {
+    memset(frame, 0, sizeof(frame));
+    memset(released, 0, sizeof(released));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void ASRPROFrameDecoder::release(uint8_t b) {
+    if (releasedCount >= ASRPRO_FRAME_SIZE) {
+        // 调用方未及时取走，丢弃最旧的字节
+        releasedHead = (releasedHead + 1) % ASRPRO_FRAME_SIZE;
+        releasedCount--;
+    }
+    released[(releasedHead + releasedCount) % ASRPRO_FRAME_SIZE] = b;
+    releasedCount++;
+}
+
+bool ASRPROFrameDecoder::popTextByte(uint8_t& b) {
+    if (releasedCount == 0) {
+        return false;
+    }
+    b = released[releasedHead];
+    releasedHead = (releasedHead + 1) % ASRPRO_FRAME_SIZE;
+    releasedCount--;
+    return true;
+}
+
+void ASRPROFrameDecoder::resync() {
+    release(frame[0]);
+
+    uint8_t next = 1;
+    while (next < frameLength && frame[next] != ASRPRO_FRAME_SYNC) {
+        release(frame[next]);
+        next++;
+    }
+
+    uint8_t remaining = frameLength - next;
+    memmove(frame, frame + next, remaining);
+    frameLength = remaining;
+}
+
+bool ASRPROFrameDecoder::feed(uint8_t b, unsigned long now) {
+    if (frameLength == 0) {
+        if (b == ASRPRO_FRAME_SYNC) {
+            frame[frameLength++] = b;
+        } else {
+            release(b);
+        }
+        return false;
+    }
+
+    frame[frameLength++] = b;
+    if (frameLength < ASRPRO_FRAME_SIZE) {
+        return false;
+    }
+
+    // 收满一帧，检查指令范围与 CRC
+    uint8_t id = frame[1];
+    if (id == 0 || id > maxCommandId || asrproCrc8(frame + 1, 2) != frame[3]) {
+        stats.badFrames++;
+        resync();
+        return false;
+    }
+
+    uint8_t seq = frame[2];
+    frameLength = 0;
+
+    if (hasSequence && now - sequenceTime > ASRPRO_DUPLICATE_WINDOW) {
+        // 间隔太久，不再是重发：对端可能已复位，序号重新起算
+        hasSequence = false;
+        stats.sequenceResets++;
+    }
+
+    if (hasSequence) {
+        if (seq == sequence) {
+            stats.duplicates++;   // ASRPRO 重发，已处理过
+            sequenceTime = now;
+            return false;
+        }
+        stats.lostFrames += (uint8_t)(seq - sequence - 1);
+    }
+
+    hasSequence = true;
+    sequence = seq;
+    sequenceTime = now;
+    commandId = id;
+    stats.framesDecoded++;
+    return true;
+}
+
+void ASRPROFrameDecoder::flush() {
+    if (frameLength == 0) {
+        return;
+    }
+
+    stats.timeouts++;
+    for (uint8_t i = 0; i < frameLength; i++) {
+        release(frame[i]);
+    }
+    frameLength = 0;
+}
@@ -0,0 +1,485 @@
+#include "Choreography.h"
+#include "ASRPRO_Module.h"
+#include "DHT_Manager.h"
+#include "Deferred_Log.h"
+#include "Latency_Trace.h"
+
+#define EMOTION_STATE_COUNT ((uint8_t)EmotionState::HUMID_WARNING + 1)
+
+// 各操作码的指令长度（含操作码）
+static const uint8_t CHOREO_OP_SIZE[(uint8_t)ChoreoOp::COUNT] = {
+    1,  // END
+    5,  // MOVE
+    3,  // WAIT
+    2,  // EMOTION
+    2,  // SAY
+    2,  // LOOP
+    1,  // ENDLOOP
+    3,  // JUMP
+    7,  // BRANCH
+};
+
+static uint16_t getU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint16_t choreoCrc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// ==================== 校验 ====================
+
+/**
+ * 跳转目标与跳转指令是否在同一层循环内：
+ * 从下一条指令走到目标，途中不能离开当前循环，到达时也不能位于更深的循环中
+ */
+static bool sameLoop(const uint8_t* code, uint16_t from, uint16_t target) {
+    int8_t depth = 0;
+    for (uint16_t pc = from; pc < target; pc += CHOREO_OP_SIZE[code[pc]]) {
+        if (code[pc] == (uint8_t)ChoreoOp::LOOP) {
+            depth++;
+        } else if (code[pc] == (uint8_t)ChoreoOp::ENDLOOP) {
+            if (--depth < 0) {
+                return false;
+            }
+        }
+    }
+    return depth == 0;
+}
+
+ChoreoVerifyError choreoVerify(const uint8_t* script, size_t length, ChoreoScriptInfo& info) {
+    if (script == nullptr || length < CHOREO_HEADER_SIZE + 1 || length > CHOREO_SCRIPT_MAX ||
+        script[0] != CHOREO_MAGIC_0 || script[1] != CHOREO_MAGIC_1 || script[2] != CHOREO_VERSION) {
+        return ChoreoVerifyError::HEADER;
+    }
+
+    info.stringCount = script[3];
+    info.codeLength = getU16(script + 4);
+    if (getU16(script + 6) != length || info.codeLength == 0 ||
+        CHOREO_HEADER_SIZE + (size_t)info.codeLength > length) {
+        return ChoreoVerifyError::HEADER;
+    }
+    if (choreoCrc16(script + CHOREO_HEADER_SIZE, length - CHOREO_HEADER_SIZE) != getU16(script + 8)) {
+        return ChoreoVerifyError::CRC;
+    }
+
+    // 文本表：恰好 stringCount 条以 '\0' 结尾的文本，之后没有多余字节
+    if (info.stringCount > CHOREO_STRING_MAX) {
+        return ChoreoVerifyError::STRINGS;
+    }
+    size_t offset = CHOREO_HEADER_SIZE + info.codeLength;
+    for (uint8_t i = 0; i < info.stringCount; i++) {
+        const uint8_t* end = (const uint8_t*)memchr(script + offset, '\0', length - offset);
+        if (end == nullptr || (size_t)(end - (script + offset)) >= SPEECH_TEXT_MAX_LEN) {
+            return ChoreoVerifyError::STRINGS;
+        }
+        info.stringOffset[i] = (uint16_t)offset;
+        offset = end - script + 1;
+    }
+    if (offset != length) {
+        return ChoreoVerifyError::STRINGS;
+    }
+
+    // 第一遍：指令边界、操作数、循环配对与总时长
+    const uint8_t* code = script + CHOREO_HEADER_SIZE;
+    uint8_t starts[CHOREO_SCRIPT_MAX / 8] = {};
+    uint32_t duration[CHOREO_LOOP_DEPTH + 1] = {};  // 各层循环体的时长，[0] 为顶层
+    uint8_t counts[CHOREO_LOOP_DEPTH + 1];
+    uint8_t depth = 0;
+    uint16_t last = 0;
+    info.moves = false;
+
+    for (uint16_t pc = 0; pc < info.codeLength; pc += CHOREO_OP_SIZE[code[pc]]) {
+        uint8_t op = code[pc];
+        if (op >= (uint8_t)ChoreoOp::COUNT || pc + CHOREO_OP_SIZE[op] > info.codeLength) {
+            return ChoreoVerifyError::OPCODE;
+        }
+        starts[pc >> 3] |= 1 << (pc & 7);
+        last = pc;
+
+        const uint8_t* a = code + pc + 1;
+        switch ((ChoreoOp)op) {
+            case ChoreoOp::MOVE:
+                if ((a[0] > 180 && a[0] != CHOREO_ANGLE_HOLD) ||
+                    (a[1] > 180 && a[1] != CHOREO_ANGLE_HOLD) || getU16(a + 2) == 0) {
+                    return ChoreoVerifyError::OPERAND;
+                }
+                duration[depth] += getU16(a + 2);
+                info.moves = true;
+                break;
+
+            case ChoreoOp::WAIT:
+                if (getU16(a) == 0) {
+                    return ChoreoVerifyError::OPERAND;
+                }
+                duration[depth] += getU16(a);
+                break;
+
+            case ChoreoOp::EMOTION:
+                if (a[0] >= EMOTION_STATE_COUNT) {
+                    return ChoreoVerifyError::OPERAND;
+                }
+                break;
+
+            case ChoreoOp::SAY:
+                if (a[0] >= info.stringCount) {
+                    return ChoreoVerifyError::OPERAND;
+                }
+                break;
+
+            case ChoreoOp::LOOP:
+                if (a[0] == 0) {
+                    return ChoreoVerifyError::OPERAND;
+                }
+                if (depth == CHOREO_LOOP_DEPTH) {
+                    return ChoreoVerifyError::LOOP;
+                }
+                counts[++depth] = a[0];
+                duration[depth] = 0;
+                break;
+
+            case ChoreoOp::ENDLOOP:
+                if (depth == 0) {
+                    return ChoreoVerifyError::LOOP;
+                }
+                duration[depth - 1] += duration[depth] * counts[depth];
+                depth--;
+                break;
+
+            case ChoreoOp::BRANCH:
+                if (a[0] >= (uint8_t)ChoreoSensor::COUNT || a[1] >= (uint8_t)ChoreoCompare::COUNT) {
+                    return ChoreoVerifyError::OPERAND;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        // 逐条检查，避免多层循环相乘溢出
+        if (duration[depth] > CHOREO_MAX_DURATION_MS) {
+            return ChoreoVerifyError::DURATION;
+        }
+    }
+
+    if (depth != 0) {
+        return ChoreoVerifyError::LOOP;
+    }
+    if (code[last] != (uint8_t)ChoreoOp::END) {
+        return ChoreoVerifyError::NO_END;
+    }
+    info.maxDuration = duration[0];
+
+    // 第二遍：跳转目标只能是同层循环内、位于本条之后的指令起点
+    for (uint16_t pc = 0; pc < info.codeLength; pc += CHOREO_OP_SIZE[code[pc]]) {
+        uint16_t target;
+        if (code[pc] == (uint8_t)ChoreoOp::JUMP) {
+            target = getU16(code + pc + 1);
+        } else if (code[pc] == (uint8_t)ChoreoOp::BRANCH) {
+            target = getU16(code + pc + 5);
+        } else {
+            continue;
+        }
+
+        uint16_t next = pc + CHOREO_OP_SIZE[code[pc]];
+        if (target < next || target >= info.codeLength ||
+            !(starts[target >> 3] & (1 << (target & 7))) || !sameLoop(code, next, target)) {
+            return ChoreoVerifyError::TARGET;
+        }
+    }
+
+    return ChoreoVerifyError::NONE;
+}
+
+const char* choreoVerifyErrorText(ChoreoVerifyError error) {
+    switch (error) {
+        case ChoreoVerifyError::NONE:     return "ok";
+        case ChoreoVerifyError::HEADER:   return "header";
+        case ChoreoVerifyError::CRC:      return "crc";
+        case ChoreoVerifyError::OPCODE:   return "opcode";
+        case ChoreoVerifyError::OPERAND:  return "operand";
+        case ChoreoVerifyError::TARGET:   return "target";
+        case ChoreoVerifyError::LOOP:     return "loop";
+        case ChoreoVerifyError::STRINGS:  return "strings";
+        case ChoreoVerifyError::DURATION: return "duration";
+        case ChoreoVerifyError::NO_END:   return "no_end";
+    }
+    return "unknown";
+}
+
+// ==================== 解释器 ====================
+
+ChoreographyPlayer::ChoreographyPlayer()
+    : display(nullptr), motion(nullptr), voice(nullptr), sensors(nullptr),
+      script(nullptr), info{}, pc(0), scriptTime(0), startTime(0), servoLead(0),
+      running(false), playing(false), loops{}, loopDepth(0),
+      events{}, eventHead(0), eventCount(0), pendingEmotions(0), lastEmotion(EmotionState::NORMAL), hasEmotion(false),
+      headEnabled(false), nodEnabled(false), servoClaimed(false), stats{} {
+}
+
+void ChoreographyPlayer::begin(OLEDDisplay* disp, MotionArbiter* arbiter, ASRPROModule* asr,
+                               const DHTManager* dht) {
+    display = disp;
+    motion = arbiter;
+    voice = asr;
+    sensors = dht;
+}
+
+ChoreoVerifyError ChoreographyPlayer::play(const uint8_t* data, size_t length) {
+    ChoreoScriptInfo checked;
+    ChoreoVerifyError error = choreoVerify(data, length, checked);
+    if (error != ChoreoVerifyError::NONE) {
+        LOG_WARN("[Choreo] Script rejected: %s", choreoVerifyErrorText(error));
+        return error;
+    }
+
+    script = data;
+    info = checked;
+    pc = 0;
+    scriptTime = 0;
+    loopDepth = 0;
+    eventHead = 0;
+    eventCount = 0;
+    pendingEmotions = 0;
+    hasEmotion = false;
+    headEnabled = nodEnabled = (motion != nullptr);
+    servoClaimed = false;
+
+    // 时间线起点取舵机实际开始输出的时刻（与 MultimodalFeedbackSystem 相同），
+    // 舵机段提前同样时长装入，第一段在 play() 中立即提交
+    startTime = millis();
+    servoLead = 0;
+    if (info.moves && motion != nullptr) {
+        servoLead = motion->wakeDelay() + SERVO_OUTPUT_LATENCY_MS;
+        startTime += servoLead;
+    }
+    running = true;
+    playing = true;
+
+    LOG_INFO("[Choreo] Playing script: %u bytes, up to %lu ms", (unsigned)length, info.maxDuration);
+
+    update();
+    return ChoreoVerifyError::NONE;
+}
+
+void ChoreographyPlayer::stop() {
+    if (!playing) {
+        return;
+    }
+    running = false;
+    playing = false;
+    if (servoClaimed) {
+        motion->submit(ServoAction::RESET, MotionSource::AMBIENT);
+    }
+    LOG_DEBUG("[Choreo] Stopped");
+}
+
+bool ChoreographyPlayer::readSensor(ChoreoSensor sensor, int16_t& value) const {
+    if (sensors == nullptr || !sensors->getIsValid()) {
+        return false;
+    }
+    float reading = (sensor == ChoreoSensor::TEMPERATURE) ? sensors->getTemperature()
+                                                          : sensors->getHumidity();
+    value = (int16_t)lroundf(reading * 10.0f);
+    return true;
+}
+
+bool ChoreographyPlayer::pushEvent(ChoreoOp op, uint8_t arg) {
+    if (eventCount == CHOREO_EVENT_CAPACITY) {
+        return false;
+    }
+    events[(eventHead + eventCount) % CHOREO_EVENT_CAPACITY] = {scriptTime, op, arg};
+    eventCount++;
+    return true;
+}
+
+void ChoreographyPlayer::submitServo(int16_t head, int16_t nod, uint16_t duration, long elapsed) {
+    if (motion == nullptr) {
+        return;
+    }
+
+    // 上一段已经算完才装入：舵机时间线出现空档
+    if (servoClaimed && elapsed + SERVO_OUTPUT_LATENCY_MS > (long)scriptTime) {
+        stats.lateArms++;
+    }
+
+    // 第一段打断本来源之前残留的段，之后按时长首尾衔接
+    MotionQueuePolicy own = servoClaimed ? MotionQueuePolicy::ENQUEUE : MotionQueuePolicy::FLUSH;
+    if (headEnabled && !motion->submitSegment(ServoAxis::HEAD, head, duration, MotionSource::AMBIENT, own)) {
+        stats.rejectedSegments++;
+        headEnabled = false;
+    }
+    if (nodEnabled && !motion->submitSegment(ServoAxis::NOD, nod, duration, MotionSource::AMBIENT, own)) {
+        stats.rejectedSegments++;
+        nodEnabled = false;
+    }
+    servoClaimed = true;
+}
+
+bool ChoreographyPlayer::step(long elapsed) {
+    const uint8_t* code = script + CHOREO_HEADER_SIZE;
+    const uint8_t* a = code + pc + 1;
+    ChoreoOp op = (ChoreoOp)code[pc];
+    uint16_t next = pc + CHOREO_OP_SIZE[code[pc]];
+
+    switch (op) {
+        case ChoreoOp::END:
+            running = false;
+            return true;
+
+        case ChoreoOp::MOVE: {
+            int16_t head = (a[0] == CHOREO_ANGLE_HOLD) ? MOTION_AXIS_HOLD : a[0];
+            int16_t nod = (a[1] == CHOREO_ANGLE_HOLD) ? MOTION_AXIS_HOLD : a[1];
+            submitServo(head, nod, getU16(a + 2), elapsed);
+            scriptTime += getU16(a + 2);
+            break;
+        }
+
+        case ChoreoOp::WAIT:
+            // 舵机已在本脚本控制下时装入保持段，后续运动段才能按时长衔接
+            if (servoClaimed) {
+                submitServo(MOTION_AXIS_HOLD, MOTION_AXIS_HOLD, getU16(a), elapsed);
+            }
+            scriptTime += getU16(a);
+            break;
+
+        case ChoreoOp::EMOTION: {
+            EmotionState emotion = (EmotionState)a[0];
+            if (display != nullptr && !(hasEmotion && emotion == lastEmotion)) {
+                if (!pushEvent(op, a[0])) {
+                    return false;
+                }
+                // 前面没有待显示的表情时立即预绘制，否则等前一帧发送后再画
+                if (pendingEmotions++ == 0) {
+                    display->prepareEmotion(emotion);
+                }
+                lastEmotion = emotion;
+                hasEmotion = true;
+            }
+            break;
+        }
+
+        case ChoreoOp::SAY:
+            if (voice != nullptr && !pushEvent(op, a[0])) {
+                return false;
+            }
+            break;
+
+        case ChoreoOp::LOOP:
+            loops[loopDepth++] = {next, a[0]};
+            break;
+
+        case ChoreoOp::ENDLOOP: {
+            LoopFrame& frame = loops[loopDepth - 1];
+            if (--frame.remaining > 0) {
+                next = frame.body;
+            } else {
+                loopDepth--;
+            }
+            break;
+        }
+
+        case ChoreoOp::JUMP:
+            next = getU16(a);
+            break;
+
+        case ChoreoOp::BRANCH: {
+            int16_t value;
+            int16_t operand = (int16_t)getU16(a + 2);
+            bool taken = false;
+            if (readSensor((ChoreoSensor)a[0], value)) {
+                switch ((ChoreoCompare)a[1]) {
+                    case ChoreoCompare::LESS:      taken = value < operand; break;
+                    case ChoreoCompare::GREATER:   taken = value > operand; break;
+                    case ChoreoCompare::EQUAL:     taken = value == operand; break;
+                    case ChoreoCompare::NOT_EQUAL: taken = value != operand; break;
+                    default: break;
+                }
+            }
+            if (taken) {
+                next = getU16(a + 4);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    pc = next;
+    return true;
+}
+
+void ChoreographyPlayer::fireEvent(const Event& e, long elapsed) {
+    uint32_t lateness = (uint32_t)(elapsed - (long)e.time);
+    if (lateness > stats.maxLateness) {
+        stats.maxLateness = lateness;
+    }
+
+    if (e.op == ChoreoOp::EMOTION) {
+        display->presentEmotion((EmotionState)e.arg);
+    } else {
+        voice->speak((const char*)script + info.stringOffset[e.arg], SpeechPriority::CHATTER);
+    }
+}
+
+void ChoreographyPlayer::update() {
+    if (!playing) {
+        return;
+    }
+    uint32_t begin = LatencyTracer::now();
+
+    long elapsed = (long)(millis() - startTime);
+    long lead = FEEDBACK_LOOKAHEAD_MS + servoLead;
+
+    // 提前执行到 elapsed + lead，表情与播报进入事件队列等到点
+    uint8_t ops = 0;
+    while (running && elapsed + lead >= (long)scriptTime) {
+        if (ops == CHOREO_OPS_PER_TICK) {
+            stats.budgetStalls++;
+            break;
+        }
+        if (!step(elapsed)) {
+            break;
+        }
+        ops++;
+    }
+    stats.ops += ops;
+
+    // 到点的事件；发送表情后预绘制队列中的下一帧
+    while (eventCount > 0 && elapsed >= (long)events[eventHead].time) {
+        Event e = events[eventHead];
+        eventHead = (eventHead + 1) % CHOREO_EVENT_CAPACITY;
+        eventCount--;
+        fireEvent(e, elapsed);
+
+        if (e.op == ChoreoOp::EMOTION && --pendingEmotions > 0) {
+            for (uint8_t i = 0; i < eventCount; i++) {
+                const Event& pending = events[(eventHead + i) % CHOREO_EVENT_CAPACITY];
+                if (pending.op == ChoreoOp::EMOTION) {
+                    display->prepareEmotion((EmotionState)pending.arg);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!running && eventCount == 0 && elapsed >= (long)scriptTime) {
+        playing = false;
+        LOG_DEBUG("[Choreo] Script complete");
+    }
+
+    uint32_t cycles = LatencyTracer::now() - begin;
+    stats.ticks++;
+    stats.totalCycles += cycles;
+    if (cycles > stats.maxTickCycles) {
+        stats.maxTickCycles = cycles;
+    }
+}
@@ -0,0 +1,206 @@
+#include "Choreography_Store.h"
+#include "Deferred_Log.h"
+#include "Kv_Store.h"
+
+static_assert(CHOREO_SCRIPT_MAX <= KV_VALUE_MAX, "CHOREO_SCRIPT_MAX exceeds KV_VALUE_MAX");
+
+static uint16_t getU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+ChoreographyStore::ChoreographyStore()
+    : player(nullptr), buffer{}, downloadSlot(0), downloadTotal(0),
+      received(0), downloading(false), pendingSlot(0), pendingLength(0), storePending(false),
+      lastError(ChoreoVerifyError::NONE) {
+}
+
+void ChoreographyStore::begin(ChoreographyPlayer* target) {
+    player = target;
+    uint8_t stored = 0;
+    for (uint8_t slot = 0; slot < CHOREO_SLOT_COUNT; slot++) {
+        size_t length;
+        if (find(slot, length) != nullptr) {
+            stored++;
+        }
+    }
+    LOG_INFO("[Choreo] Store: %d of %d slots used", stored, CHOREO_SLOT_COUNT);
+}
+
+const uint8_t* ChoreographyStore::find(uint8_t slot, size_t& length) const {
+    size_t stored = 0;
+    const uint8_t* script = g_kvStore.find(KV_KEY_CHOREO + slot, stored);
+    ChoreoScriptInfo info;
+    if (script == nullptr || choreoVerify(script, stored, info) != ChoreoVerifyError::NONE) {
+        return nullptr;
+    }
+    length = stored;
+    return script;
+}
+
+ChoreoStoreResult ChoreographyStore::write(uint8_t slot, const uint8_t* script, size_t length) {
+    if (slot >= CHOREO_SLOT_COUNT) {
+        return ChoreoStoreResult::BAD_MESSAGE;
+    }
+    ChoreoScriptInfo info;
+    lastError = choreoVerify(script, length, info);
+    if (lastError != ChoreoVerifyError::NONE) {
+        return ChoreoStoreResult::INVALID;
+    }
+
+    if (storePending) {
+        return ChoreoStoreResult::BUSY;
+    }
+
+    KvResult result = g_kvStore.put(KV_KEY_CHOREO + slot, script, length);
+    if (result == KvResult::BUSY) {
+        // 存储在回收：脚本留在缓冲区，update() 中写入
+        if (length > sizeof(buffer)) {
+            return ChoreoStoreResult::TOO_LARGE;
+        }
+        if (script != buffer) {
+            memcpy(buffer, script, length);
+        }
+        pendingSlot = slot;
+        pendingLength = (uint16_t)length;
+        storePending = true;
+        return ChoreoStoreResult::PENDING;
+    }
+    if (result != KvResult::OK) {
+        LOG_ERROR("[Choreo] Slot %d store failed: %s", slot, KvStore::resultText(result));
+        return ChoreoStoreResult::FLASH_ERROR;
+    }
+
+    LOG_INFO("[Choreo] Slot %d stored: %u bytes", slot, (unsigned)length);
+    return ChoreoStoreResult::STORED;
+}
+
+void ChoreographyStore::update() {
+    if (!storePending) {
+        return;
+    }
+    KvResult result = g_kvStore.put(KV_KEY_CHOREO + pendingSlot, buffer, pendingLength);
+    if (result == KvResult::BUSY) {
+        return;
+    }
+    storePending = false;
+    if (result == KvResult::OK) {
+        LOG_INFO("[Choreo] Slot %d stored: %u bytes (deferred)", pendingSlot, pendingLength);
+    } else {
+        LOG_ERROR("[Choreo] Slot %d deferred store failed: %s", pendingSlot, KvStore::resultText(result));
+    }
+}
+
+ChoreoStoreResult ChoreographyStore::play(uint8_t slot) {
+    size_t length = 0;
+    const uint8_t* script = find(slot, length);
+    if (script == nullptr || player == nullptr) {
+        return ChoreoStoreResult::NOT_FOUND;
+    }
+    lastError = player->play(script, length);
+    return lastError == ChoreoVerifyError::NONE ? ChoreoStoreResult::PLAYING : ChoreoStoreResult::INVALID;
+}
+
+ChoreoStoreResult ChoreographyStore::handleChunk(const uint8_t* payload, unsigned int length) {
+    if (length < CHOREO_CHUNK_HEADER || payload[1] >= CHOREO_SLOT_COUNT) {
+        return ChoreoStoreResult::BAD_MESSAGE;
+    }
+    uint8_t slot = payload[1];
+    uint16_t offset = getU16(payload + 2);
+    uint16_t total = getU16(payload + 4);
+    const uint8_t* data = payload + CHOREO_CHUNK_HEADER;
+    uint16_t count = (uint16_t)(length - CHOREO_CHUNK_HEADER);
+
+    if (total == 0 || total > CHOREO_SCRIPT_MAX) {
+        return ChoreoStoreResult::TOO_LARGE;
+    }
+
+    // 缓冲区中的脚本还在等待写入
+    if (storePending) {
+        return ChoreoStoreResult::BUSY;
+    }
+
+    // 偏移 0 开始新的下载；其余分块必须接在已收到的字节之后
+    if (offset == 0) {
+        downloading = true;
+        downloadSlot = slot;
+        downloadTotal = total;
+        received = 0;
+    } else if (!downloading || slot != downloadSlot || total != downloadTotal || offset != received) {
+        return ChoreoStoreResult::OUT_OF_ORDER;
+    }
+    if (offset + count > total) {
+        downloading = false;
+        return ChoreoStoreResult::BAD_MESSAGE;
+    }
+
+    memcpy(buffer + offset, data, count);
+    received = offset + count;
+    if (received < total) {
+        return ChoreoStoreResult::ACCEPTED;
+    }
+
+    downloading = false;
+    return write(slot, buffer, total);
+}
+
+ChoreoStoreResult ChoreographyStore::handleMessage(const uint8_t* payload, unsigned int length,
+                                                   char* reply, size_t replySize) {
+    ChoreoStoreResult result = ChoreoStoreResult::BAD_MESSAGE;
+    uint8_t type = length >= 1 ? payload[0] : 0;
+    uint8_t slot = length >= 2 ? payload[1] : 0;
+    lastError = ChoreoVerifyError::NONE;
+
+    if (length >= 1) {
+        switch ((ChoreoMessage)type) {
+            case ChoreoMessage::CHUNK:
+                result = handleChunk(payload, length);
+                break;
+
+            case ChoreoMessage::PLAY:
+                if (length >= 2) {
+                    result = play(slot);
+                }
+                break;
+
+            case ChoreoMessage::STOP:
+                if (player) {
+                    player->stop();
+                }
+                result = ChoreoStoreResult::STOPPED;
+                break;
+        }
+    }
+
+    if (result != ChoreoStoreResult::ACCEPTED) {
+        LOG_INFO("[Choreo] Message %d slot %d: %s", type, slot, resultText(result));
+    }
+
+    if (reply != nullptr) {
+        // 校验失败时回复具体原因；不在下载中时 received 为 0，发送端从头重发
+        bool complete = result == ChoreoStoreResult::STORED || result == ChoreoStoreResult::PENDING;
+        uint16_t resume = (downloading || complete) ? received : 0;
+        const char* text = (result == ChoreoStoreResult::INVALID) ? choreoVerifyErrorText(lastError)
+                                                                   : resultText(result);
+        snprintf(reply, replySize, "{\"choreo\":{\"slot\":%u,\"received\":%u,\"result\":\"%s\"}}",
+                 slot, resume, text);
+    }
+    return result;
+}
+
+const char* ChoreographyStore::resultText(ChoreoStoreResult result) {
+    switch (result) {
+        case ChoreoStoreResult::ACCEPTED:     return "accepted";
+        case ChoreoStoreResult::STORED:       return "stored";
+        case ChoreoStoreResult::PLAYING:      return "playing";
+        case ChoreoStoreResult::STOPPED:      return "stopped";
+        case ChoreoStoreResult::OUT_OF_ORDER: return "out_of_order";
+        case ChoreoStoreResult::TOO_LARGE:    return "too_large";
+        case ChoreoStoreResult::BAD_MESSAGE:  return "bad_message";
+        case ChoreoStoreResult::INVALID:      return "invalid";
+        case ChoreoStoreResult::FLASH_ERROR:  return "flash_error";
+        case ChoreoStoreResult::NOT_FOUND:    return "not_found";
+        case ChoreoStoreResult::PENDING:      return "pending";
+        case ChoreoStoreResult::BUSY:         return "busy";
+    }
+    return "unknown";
+}
@@ -0,0 +1,658 @@
+#include "Config_Store.h"
+#include "Deferred_Log.h"
+#include "Input_Trace.h"
+#include "Json_Tokenizer.h"
+#include "Json_Writer.h"
+#include "Kv_Store.h"
+#include <stddef.h>
+
+// ==================== 配置模式 ====================
+
+/**
+ * 字段取值类型
+ */
+enum class ConfigType : uint8_t {
+    DECIMAL,              // float，一位小数（范围以 0.1 为单位）
+    UNSIGNED,             // 无符号整数，1/2/4 字节
+    TEXT                  // '\0' 结尾的字符串（范围为长度）
+};
+
+struct ConfigField {
+    uint8_t id;           // 记录中的字段 ID，发布后不再改变
+    const char* name;     // MQTT 与控制台中的名称
+    ConfigType type;
+    uint8_t offset;       // 在 RuntimeConfig 中的位置
+    uint8_t size;
+    int32_t min;
+    int32_t max;
+};
+
+#define CONFIG_MEMBER(member) (uint8_t)offsetof(RuntimeConfig, member), (uint8_t)sizeof(RuntimeConfig::member)
+
+static constexpr ConfigField CONFIG_SCHEMA[] = {
+    {1,  "temp_high",          ConfigType::DECIMAL,  CONFIG_MEMBER(tempHigh),              -200, 600},
+    {2,  "temp_low",           ConfigType::DECIMAL,  CONFIG_MEMBER(tempLow),               -200, 600},
+    {3,  "humid_high",         ConfigType::DECIMAL,  CONFIG_MEMBER(humidHigh),             0, 1000},
+    {4,  "humid_low",          ConfigType::DECIMAL,  CONFIG_MEMBER(humidLow),              0, 1000},
+    {5,  "sensor_interval",    ConfigType::UNSIGNED, CONFIG_MEMBER(sensorReadInterval),    1000, 60000},
+    {6,  "heartbeat_interval", ConfigType::UNSIGNED, CONFIG_MEMBER(mqttHeartbeatInterval), 5000, 3600000},
+    {7,  "weather_interval",   ConfigType::UNSIGNED, CONFIG_MEMBER(weatherUpdateInterval), 60000, 86400000},
+    {8,  "mqtt_broker",        ConfigType::TEXT,     CONFIG_MEMBER(mqttBroker),            1, CONFIG_TEXT_MAX - 1},
+    {9,  "mqtt_port",          ConfigType::UNSIGNED, CONFIG_MEMBER(mqttPort),              1, 65535},
+    {10, "log_level",          ConfigType::UNSIGNED, CONFIG_MEMBER(logLevel),              LOG_LEVEL_DEBUG, LOG_LEVEL_OFF},
+};
+
+#define CONFIG_FIELD_COUNT (sizeof(CONFIG_SCHEMA) / sizeof(CONFIG_SCHEMA[0]))
+
+static constexpr RuntimeConfig CONFIG_DEFAULTS = {
+    TEMP_HIGH_THRESHOLD, TEMP_LOW_THRESHOLD, HUMID_HIGH_THRESHOLD, HUMID_LOW_THRESHOLD,
+    SENSOR_READ_INTERVAL, MQTT_HEARTBEAT_INTERVAL, WEATHER_UPDATE_INTERVAL,
+    MQTT_BROKER, MQTT_PORT, LOG_DEFAULT_LEVEL
+};
+
+RuntimeConfig g_config = CONFIG_DEFAULTS;
+
+// 编译期检查模式表：ID 唯一且非 0、全部字段都改过时记录仍放得下、默认值在范围内
+static constexpr bool schemaIdsUnique() {
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (CONFIG_SCHEMA[i].id == 0) {
+            return false;
+        }
+        for (size_t j = i + 1; j < CONFIG_FIELD_COUNT; j++) {
+            if (CONFIG_SCHEMA[i].id == CONFIG_SCHEMA[j].id) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static constexpr size_t schemaMaxValue() {
+    size_t size = CONFIG_VALUE_HEADER;
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        size += 2 + CONFIG_SCHEMA[i].size;
+    }
+    return size;
+}
+
+static_assert(schemaIdsUnique(), "config field IDs must be unique and non-zero");
+static_assert(schemaMaxValue() <= CONFIG_VALUE_MAX, "CONFIG_VALUE_MAX too small for schema");
+static_assert(CONFIG_VALUE_MAX <= KV_VALUE_MAX, "CONFIG_VALUE_MAX exceeds KV_VALUE_MAX");
+static_assert(CONFIG_DEFAULTS.tempHigh * 10 <= 600 && CONFIG_DEFAULTS.tempLow * 10 >= -200 &&
+              CONFIG_DEFAULTS.tempLow < CONFIG_DEFAULTS.tempHigh &&
+              CONFIG_DEFAULTS.humidLow < CONFIG_DEFAULTS.humidHigh,
+              "default thresholds out of range");
+static_assert(sizeof(MQTT_BROKER) <= CONFIG_TEXT_MAX, "MQTT_BROKER longer than CONFIG_TEXT_MAX");
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void putU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (i * 8));
+    }
+}
+
+// ==================== 字段访问 ====================
+
+static const ConfigField* findField(uint8_t id) {
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (CONFIG_SCHEMA[i].id == id) {
+            return &CONFIG_SCHEMA[i];
+        }
+    }
+    return nullptr;
+}
+
+static int8_t findField(const char* name, size_t length) {
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (strncmp(CONFIG_SCHEMA[i].name, name, length) == 0 && CONFIG_SCHEMA[i].name[length] == '\0') {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+static uint8_t* member(RuntimeConfig& config, const ConfigField& field) {
+    return (uint8_t*)&config + field.offset;
+}
+
+static const uint8_t* member(const RuntimeConfig& config, const ConfigField& field) {
+    return (const uint8_t*)&config + field.offset;
+}
+
+static uint32_t getUnsigned(const RuntimeConfig& config, const ConfigField& field) {
+    uint32_t value = 0;
+    memcpy(&value, member(config, field), field.size);      // 小端
+    return value;
+}
+
+static float getDecimal(const RuntimeConfig& config, const ConfigField& field) {
+    float value;
+    memcpy(&value, member(config, field), sizeof(value));
+    return value;
+}
+
+/**
+ * 字段当前值是否在范围内
+ */
+static bool fieldValid(const RuntimeConfig& config, const ConfigField& field) {
+    switch (field.type) {
+        case ConfigType::DECIMAL: {
+            float decimal = getDecimal(config, field);
+            if (decimal != decimal) {
+                return false;       // NaN
+            }
+            int32_t fixed = jsonFixedFromFloat(decimal, 1);
+            return fixed >= field.min && fixed <= field.max;
+        }
+        case ConfigType::UNSIGNED: {
+            uint32_t value = getUnsigned(config, field);
+            return value >= (uint32_t)field.min && value <= (uint32_t)field.max;
+        }
+        case ConfigType::TEXT: {
+            size_t length = strnlen((const char*)member(config, field), field.size);
+            return length >= (size_t)field.min && length <= (size_t)field.max;
+        }
+    }
+    return false;
+}
+
+static bool configConsistent(const RuntimeConfig& config) {
+    return config.tempLow < config.tempHigh && config.humidLow < config.humidHigh;
+}
+
+/**
+ * 逐字段比较（结构体中的填充字节不确定，不能整体 memcmp；文本只比较到 '\0'）
+ */
+static bool configEqual(const RuntimeConfig& a, const RuntimeConfig& b) {
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        const ConfigField& field = CONFIG_SCHEMA[i];
+        bool same = field.type == ConfigType::TEXT
+            ? strncmp((const char*)member(a, field), (const char*)member(b, field), field.size) == 0
+            : memcmp(member(a, field), member(b, field), field.size) == 0;
+        if (!same) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * 文本值只接受可打印 ASCII，且不含引号与反斜杠（写出 JSON 时无需转义）
+ */
+static bool textValid(const char* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] < 0x21 || text[i] > 0x7E || text[i] == '"' || text[i] == '\\') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * 把一个值写入 config 中的字段
+ */
+static ConfigResult parseField(const ConfigField& field, const char* value, size_t length,
+                               RuntimeConfig& config) {
+    // 数值借用 JSON 的数字解析，整段文本当作一个词元
+    JsonToken token = {JsonType::PRIMITIVE, 0, (uint16_t)length, 0, 1};
+    if (length == 0 || length > 0xFFFF) {
+        return ConfigResult::BAD_VALUE;
+    }
+
+    switch (field.type) {
+        case ConfigType::DECIMAL: {
+            int32_t fixed;
+            if (!jsonToFixed(value, token, 1, fixed)) {
+                return ConfigResult::BAD_VALUE;
+            }
+            if (fixed < field.min || fixed > field.max) {
+                return ConfigResult::OUT_OF_RANGE;
+            }
+            float decimal = fixed / 10.0f;
+            memcpy(member(config, field), &decimal, sizeof(decimal));
+            return ConfigResult::OK;
+        }
+        case ConfigType::UNSIGNED: {
+            int32_t integer;
+            if (!jsonToInt(value, token, integer)) {
+                return ConfigResult::BAD_VALUE;
+            }
+            if (integer < field.min || integer > field.max) {
+                return ConfigResult::OUT_OF_RANGE;
+            }
+            memcpy(member(config, field), &integer, field.size);     // 小端：取低位字节
+            return ConfigResult::OK;
+        }
+        case ConfigType::TEXT: {
+            if (!textValid(value, length)) {
+                return ConfigResult::BAD_VALUE;
+            }
+            if (length < (size_t)field.min || length > (size_t)field.max) {
+                return ConfigResult::OUT_OF_RANGE;
+            }
+            char* text = (char*)member(config, field);
+            memset(text, 0, field.size);
+            memcpy(text, value, length);
+            return ConfigResult::OK;
+        }
+    }
+    return ConfigResult::BAD_VALUE;
+}
+
+/**
+ * 按字段类型输出值（JSON 与控制台共用：数字不加引号，文本由调用方决定是否加引号）
+ */
+static void printValue(Print& out, const RuntimeConfig& config, const ConfigField& field) {
+    switch (field.type) {
+        case ConfigType::DECIMAL: {
+            char number[JSON_NUMBER_MAX];
+            size_t length = jsonFormatFixed(jsonFixedFromFloat(getDecimal(config, field), 1), 1, number);
+            out.write((const uint8_t*)number, length);
+            break;
+        }
+        case ConfigType::UNSIGNED:
+            out.print((unsigned long)getUnsigned(config, field));
+            break;
+        case ConfigType::TEXT:
+            out.print((const char*)member(config, field));
+            break;
+    }
+}
+
+// ==================== ConfigStore ====================
+
+ConfigStore::ConfigStore()
+    : seq(0), staging(CONFIG_DEFAULTS), listener(nullptr), lastField(-1), unsaved(false) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void ConfigStore::begin() {
+    // 录制/回放：记录存储中的值，回放时替换为录制的内容
+    uint8_t value[CONFIG_VALUE_MAX];
+    size_t valueLength = 0;
+    const uint8_t* stored = g_kvStore.find(KV_KEY_CONFIG, valueLength);
+    if (stored == nullptr || valueLength > sizeof(value)) {
+        valueLength = 0;
+    } else {
+        memcpy(value, stored, valueLength);
+    }
+    valueLength = g_inputTrace.traceConfig(value, valueLength, sizeof(value));
+
+    RuntimeConfig loaded = CONFIG_DEFAULTS;
+    uint16_t fieldsLength = 0;
+    seq = 0;
+    if (valueLength >= CONFIG_VALUE_HEADER) {
+        seq = getU32(value);
+        fieldsLength = (uint16_t)(valueLength - CONFIG_VALUE_HEADER);
+        if (!load(value + CONFIG_VALUE_HEADER, fieldsLength, loaded)) {
+            LOG_WARN("[Config] Record %lu partly invalid, using defaults for those fields",
+                     (unsigned long)seq);
+        }
+    }
+    g_config = loaded;
+    stats.loadedSeq = seq;
+    stats.loadedLength = fieldsLength;
+
+    LOG_INFO("[Config] Loaded record %lu (%u bytes of fields)", (unsigned long)seq, fieldsLength);
+    if (listener != nullptr) {
+        listener(g_config);
+    }
+}
+
+/**
+ * 解码字段到 out（out 事先为默认值）
+ * @return false 有字段取值无效（该字段保持默认值）
+ */
+bool ConfigStore::load(const uint8_t* fields, uint16_t length, RuntimeConfig& out) const {
+    bool valid = true;
+    uint16_t i = 0;
+    while (i + 2 <= length) {
+        uint8_t id = fields[i];
+        uint8_t size = fields[i + 1];
+        const uint8_t* value = fields + i + 2;
+        i += 2 + size;
+        if (i > length) {
+            return false;
+        }
+
+        const ConfigField* field = findField(id);
+        if (field == nullptr) {
+            continue;       // 新版本固件写入的字段
+        }
+
+        RuntimeConfig next = out;
+        uint8_t* target = member(next, *field);
+        if (field->type == ConfigType::TEXT) {
+            if (size >= field->size) {
+                valid = false;
+                continue;
+            }
+            memset(target, 0, field->size);
+            memcpy(target, value, size);
+        } else {
+            if (size != field->size) {
+                valid = false;
+                continue;
+            }
+            memcpy(target, value, size);
+        }
+        if (fieldValid(next, *field)) {
+            out = next;
+        } else {
+            valid = false;
+        }
+    }
+
+    if (!configConsistent(out)) {
+        out.tempHigh = CONFIG_DEFAULTS.tempHigh;
+        out.tempLow = CONFIG_DEFAULTS.tempLow;
+        out.humidHigh = CONFIG_DEFAULTS.humidHigh;
+        out.humidLow = CONFIG_DEFAULTS.humidLow;
+        valid = false;
+    }
+    return valid;
+}
+
+/**
+ * 编码与默认值不同的字段
+ * @return 字段字节数
+ */
+uint16_t ConfigStore::encode(const RuntimeConfig& config, uint8_t* fields) const {
+    uint16_t length = 0;
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        const ConfigField& field = CONFIG_SCHEMA[i];
+        const uint8_t* value = member(config, field);
+        if (memcmp(value, member(CONFIG_DEFAULTS, field), field.size) == 0) {
+            continue;
+        }
+        uint8_t size = field.type == ConfigType::TEXT ? (uint8_t)strnlen((const char*)value, field.size)
+                                                      : field.size;
+        fields[length] = field.id;
+        fields[length + 1] = size;
+        memcpy(fields + length + 2, value, size);
+        length += 2 + size;
+    }
+    return length;
+}
+
+ConfigResult ConfigStore::write(const RuntimeConfig& config) {
+    uint8_t value[CONFIG_VALUE_MAX];
+    putU32(value, seq + 1);
+    putU16(value + 4, CONFIG_SCHEMA_VERSION);
+    uint16_t length = CONFIG_VALUE_HEADER + encode(config, value + CONFIG_VALUE_HEADER);
+
+    KvResult result = g_kvStore.put(KV_KEY_CONFIG, value, length);
+    if (result == KvResult::BUSY) {
+        return ConfigResult::PENDING;
+    }
+    if (result != KvResult::OK) {
+        LOG_ERROR("[Config] Store failed: %s", KvStore::resultText(result));
+        return ConfigResult::FLASH_ERROR;
+    }
+
+    seq++;
+    stats.commits++;
+    unsaved = false;
+    return ConfigResult::OK;
+}
+
+void ConfigStore::beginUpdate() {
+    staging = g_config;
+    lastField = -1;
+}
+
+ConfigResult ConfigStore::stage(const char* name, size_t nameLength, const char* value, size_t valueLength) {
+    int8_t index = findField(name, nameLength);
+    if (index < 0) {
+        lastField = -1;
+        return ConfigResult::UNKNOWN_FIELD;
+    }
+    lastField = index;
+    return parseField(CONFIG_SCHEMA[index], value, valueLength, staging);
+}
+
+ConfigResult ConfigStore::commit() {
+    if (!configConsistent(staging)) {
+        lastField = -1;
+        return ConfigResult::INCONSISTENT;
+    }
+    lastField = -1;
+    if (configEqual(staging, g_config)) {
+        return ConfigResult::OK;        // 没有变化，不写 Flash
+    }
+
+    ConfigResult result = write(staging);
+    if (result == ConfigResult::PENDING) {
+        // 存储忙：先生效，update() 中写入
+        unsaved = true;
+        stats.deferred++;
+        LOG_INFO("[Config] Applied, store busy: saving when idle");
+    } else if (result != ConfigResult::OK) {
+        return result;
+    } else {
+        LOG_INFO("[Config] Committed record %lu", (unsigned long)seq);
+    }
+    g_config = staging;
+    if (listener != nullptr) {
+        listener(g_config);
+    }
+    return result;
+}
+
+void ConfigStore::update() {
+    if (!unsaved) {
+        return;
+    }
+    ConfigResult result = write(g_config);
+    if (result == ConfigResult::OK) {
+        LOG_INFO("[Config] Saved deferred record %lu", (unsigned long)seq);
+    } else if (result != ConfigResult::PENDING) {
+        // 存储已满或 Flash 错误：不再重试，重启后恢复上一次写入的配置
+        unsaved = false;
+    }
+}
+
+ConfigResult ConfigStore::reset() {
+    beginUpdate();
+    staging = CONFIG_DEFAULTS;
+    return commit();
+}
+
+ConfigResult ConfigStore::handleMessage(const uint8_t* payload, unsigned int length,
+                                        char* reply, size_t replySize, bool& publishAll) {
+    const char* json = (const char*)payload;
+    JsonToken tokens[CONFIG_JSON_TOKENS];
+    uint16_t count = 0;
+    publishAll = false;
+    lastField = -1;
+
+    JsonError error = jsonTokenize(json, length, tokens, CONFIG_JSON_TOKENS, count);
+    ConfigResult result = ConfigResult::OK;
+    if (error != JsonError::NONE || tokens[0].type != JsonType::OBJECT) {
+        LOG_WARN("[Config] Rejected message: %s",
+                 error != JsonError::NONE ? jsonErrorText(error) : "not an object");
+        result = ConfigResult::PARSE_ERROR;
+    } else {
+        int16_t setToken = jsonFind(json, tokens, 0, "set");
+        int16_t resetToken = jsonFind(json, tokens, 0, "reset");
+        int16_t getToken = jsonFind(json, tokens, 0, "get");
+
+        if (setToken >= 0) {
+            if (tokens[setToken].type != JsonType::OBJECT) {
+                result = ConfigResult::PARSE_ERROR;
+            } else {
+                // 整条消息一次提交：任一字段无效则全部不生效
+                beginUpdate();
+                uint16_t k = setToken + 1;
+                for (uint16_t n = 0; n < tokens[setToken].size && result == ConfigResult::OK; n++) {
+                    const JsonToken& value = tokens[k + 1];
+                    if (value.type == JsonType::OBJECT || value.type == JsonType::ARRAY) {
+                        lastField = findField(json + tokens[k].start, tokens[k].length);
+                        result = ConfigResult::BAD_VALUE;
+                    } else {
+                        result = stage(json + tokens[k].start, tokens[k].length,
+                                       json + value.start, value.length);
+                    }
+                    k = value.next;
+                }
+                if (result == ConfigResult::OK) {
+                    result = commit();
+                }
+            }
+        } else if (resetToken >= 0) {
+            result = reset();
+        } else if (getToken < 0) {
+            result = ConfigResult::PARSE_ERROR;
+        }
+        publishAll = getToken >= 0 && result == ConfigResult::OK;
+    }
+
+    if (result != ConfigResult::OK && result != ConfigResult::PENDING) {
+        LOG_WARN("[Config] Update failed: %s", resultText(result));
+    }
+    writeReply(reply, replySize, result);
+    return result;
+}
+
+void ConfigStore::writeReply(char* reply, size_t replySize, ConfigResult result) const {
+    if (lastField >= 0 && result != ConfigResult::OK) {
+        snprintf(reply, replySize, "{\"config\":{\"result\":\"%s\",\"field\":\"%s\",\"seq\":%lu}}",
+                 resultText(result), CONFIG_SCHEMA[lastField].name, (unsigned long)seq);
+    } else {
+        snprintf(reply, replySize, "{\"config\":{\"result\":\"%s\",\"seq\":%lu}}",
+                 resultText(result), (unsigned long)seq);
+    }
+}
+
+/**
+ * 取下一个以空格分隔的单词
+ */
+static bool nextWord(const char* line, size_t length, size_t& pos, const char*& word, size_t& wordLength) {
+    while (pos < length && line[pos] == ' ') {
+        pos++;
+    }
+    if (pos >= length) {
+        return false;
+    }
+    word = line + pos;
+    while (pos < length && line[pos] != ' ') {
+        pos++;
+    }
+    wordLength = (size_t)(line + pos - word);
+    return true;
+}
+
+bool ConfigStore::handleConsole(const char* line, size_t length, Print& out) {
+    size_t pos = 0;
+    const char* word;
+    size_t wordLength;
+    if (!nextWord(line, length, pos, word, wordLength) || wordLength != 6 || memcmp(word, "config", 6) != 0) {
+        return false;
+    }
+
+    ConfigResult result;
+    if (!nextWord(line, length, pos, word, wordLength)) {
+        out.print("config seq=");
+        out.println((unsigned long)seq);
+        for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+            out.print(CONFIG_SCHEMA[i].name);
+            out.print('=');
+            printValue(out, g_config, CONFIG_SCHEMA[i]);
+            out.println();
+        }
+        return true;
+    } else if (wordLength == 3 && memcmp(word, "set", 3) == 0) {
+        beginUpdate();
+        result = ConfigResult::PARSE_ERROR;       // 至少要有一项
+        while (nextWord(line, length, pos, word, wordLength)) {
+            const char* equals = (const char*)memchr(word, '=', wordLength);
+            if (equals == nullptr) {
+                result = ConfigResult::PARSE_ERROR;
+                break;
+            }
+            result = stage(word, (size_t)(equals - word), equals + 1, (size_t)(word + wordLength - equals - 1));
+            if (result != ConfigResult::OK) {
+                break;
+            }
+        }
+        if (result == ConfigResult::OK) {
+            result = commit();
+        }
+    } else if (wordLength == 5 && memcmp(word, "reset", 5) == 0) {
+        result = reset();
+    } else {
+        out.println("usage: config [set k=v ... | reset]");
+        return true;
+    }
+
+    out.print("config: ");
+    out.print(resultText(result));
+    if (result != ConfigResult::OK && lastField >= 0) {
+        out.print(' ');
+        out.print(CONFIG_SCHEMA[lastField].name);
+    }
+    out.print(" seq=");
+    out.println((unsigned long)seq);
+    return true;
+}
+
+size_t ConfigStore::writeJSON(Print& out) const {
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("config");
+    json.beginObject();
+    json.key("seq");
+    json.unsignedInteger(seq);
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        const ConfigField& field = CONFIG_SCHEMA[i];
+        json.key(field.name);
+        switch (field.type) {
+            case ConfigType::DECIMAL:
+                json.fixed(jsonFixedFromFloat(getDecimal(g_config, field), 1), 1);
+                break;
+            case ConfigType::UNSIGNED:
+                json.unsignedInteger(getUnsigned(g_config, field));
+                break;
+            case ConfigType::TEXT:
+                json.string((const char*)member(g_config, field));
+                break;
+        }
+    }
+    json.endObject();
+    json.endObject();
+    return json.size();
+}
+
+bool ConfigStore::publish(MQTTManager& mqtt) const {
+    PrintCounter counter;
+    writeJSON(counter);
+
+    Print* packet = mqtt.beginPublish(MQTT_TOPIC_STATUS, counter.getCount());
+    if (packet == nullptr) {
+        return false;
+    }
+    writeJSON(*packet);
+    return mqtt.endPublish();
+}
+
+const char* ConfigStore::resultText(ConfigResult result) {
+    switch (result) {
+        case ConfigResult::OK:            return "ok";
+        case ConfigResult::UNKNOWN_FIELD: return "unknown_field";
+        case ConfigResult::BAD_VALUE:     return "bad_value";
+        case ConfigResult::OUT_OF_RANGE:  return "out_of_range";
+        case ConfigResult::INCONSISTENT:  return "inconsistent";
+        case ConfigResult::PARSE_ERROR:   return "parse_error";
+        case ConfigResult::FLASH_ERROR:   return "flash_error";
+        case ConfigResult::PENDING:       return "pending";
+    }
+    return "unknown";
+}
@@ -0,0 +1,267 @@
+#include "Connectivity_Supervisor.h"
+#include "Deferred_Log.h"
+
+static_assert(CONN_BACKOFF_BASE > 0, "CONN_BACKOFF_BASE must be positive");
+
+/**
+ * 依赖的下层，COUNT 表示没有
+ */
+static ConnLayer parentOf(ConnLayer id) {
+    switch (id) {
+        case ConnLayer::BROKER:
+        case ConnLayer::WEATHER:
+            return ConnLayer::LINK;
+        default:
+            return ConnLayer::COUNT;
+    }
+}
+
+/**
+ * 设备唯一的随机数种子
+ */
+static uint32_t deviceSeed() {
+#if defined(ARDUINO_ARCH_STM32)
+    return HAL_GetUIDw0() ^ (HAL_GetUIDw1() * 2654435761UL) ^ (HAL_GetUIDw2() * 40503UL);
+#else
+    return 1;
+#endif
+}
+
+ConnectivitySupervisor::ConnectivitySupervisor()
+    : wifi(nullptr), mqtt(nullptr) {
+    for (uint8_t i = 0; i < (uint8_t)ConnLayer::COUNT; i++) {
+        Layer& l = layers[i];
+        l.state = ConnState::SUSPENDED;
+        l.failures = 0;
+        l.delay = CONN_BACKOFF_BASE;
+        l.wait = 0;
+        l.waitFrom = 0;
+        l.since = 0;
+        memset(&l.stats, 0, sizeof(l.stats));
+    }
+    layer(ConnLayer::LINK).state = ConnState::BACKOFF;
+    setSeed(1);
+}
+
+void ConnectivitySupervisor::begin(WiFiManager* wifiManager, MQTTManager* mqttManager) {
+    wifi = wifiManager;
+    mqtt = mqttManager;
+    setSeed(deviceSeed());
+
+    // 链路在第一次 update() 时立即尝试
+    Layer& link = layer(ConnLayer::LINK);
+    link.state = ConnState::BACKOFF;
+    link.wait = 0;
+    link.waitFrom = millis();
+    link.since = millis();
+}
+
+void ConnectivitySupervisor::setSeed(uint32_t seed) {
+    for (uint8_t i = 0; i < (uint8_t)ConnLayer::COUNT; i++) {
+        uint32_t state = seed ^ ((i + 1) * 0x9E3779B9UL);
+        layers[i].rng = state != 0 ? state : 1;
+    }
+}
+
+// xorshift32
+uint32_t ConnectivitySupervisor::randomBelow(Layer& l, uint32_t bound) {
+    l.rng ^= l.rng << 13;
+    l.rng ^= l.rng >> 17;
+    l.rng ^= l.rng << 5;
+    return bound == 0 ? 0 : l.rng % bound;
+}
+
+uint32_t ConnectivitySupervisor::backoffCap(ConnLayer id) {
+    switch (id) {
+        case ConnLayer::LINK:    return CONN_LINK_BACKOFF_MAX;
+        case ConnLayer::BROKER:  return CONN_BROKER_BACKOFF_MAX;
+        default:                 return CONN_SERVICE_BACKOFF_MAX;
+    }
+}
+
+const char* ConnectivitySupervisor::layerName(ConnLayer id) {
+    switch (id) {
+        case ConnLayer::LINK:    return "link";
+        case ConnLayer::BROKER:  return "broker";
+        case ConnLayer::WEATHER: return "weather";
+        default:                 return "?";
+    }
+}
+
+bool ConnectivitySupervisor::parentUp(ConnLayer id) const {
+    ConnLayer parent = parentOf(id);
+    return parent == ConnLayer::COUNT || layer(parent).state == ConnState::UP;
+}
+
+void ConnectivitySupervisor::markUp(ConnLayer id, unsigned long now) {
+    Layer& l = layer(id);
+    if (l.state != ConnState::UP) {
+        uint32_t outage = now - l.since;
+        if (outage > l.stats.longestOutage) {
+            l.stats.longestOutage = outage;
+        }
+        l.stats.ups++;
+        if (id != ConnLayer::WEATHER) {
+            LOG_INFO("[Conn] %s up after %lu ms (%u failed attempts)", layerName(id),
+                     (unsigned long)outage, l.failures);
+        }
+        l.state = ConnState::UP;
+        l.since = now;
+    }
+    resumeAbove(id, now);
+}
+
+/**
+ * 尝试失败或连接断开：按去相关抖动排下一次尝试，并挂起上层
+ */
+void ConnectivitySupervisor::markDown(ConnLayer id, unsigned long now, bool failed) {
+    Layer& l = layer(id);
+    if (l.state == ConnState::UP) {
+        l.stats.losses++;
+        // 稳定连接过一段时间才从最短间隔重新开始
+        if (now - l.since >= CONN_STABLE_TIME) {
+            l.failures = 0;
+            l.delay = CONN_BACKOFF_BASE;
+        }
+        l.since = now;
+        LOG_WARN("[Conn] %s lost", layerName(id));
+    }
+    if (failed) {
+        l.stats.failures++;
+    }
+    if (l.failures < 0xFF) {
+        l.failures++;
+    }
+
+    uint32_t cap = backoffCap(id);
+    uint32_t ceiling = l.delay * 3 > cap ? cap : l.delay * 3;
+    l.delay = CONN_BACKOFF_BASE + randomBelow(l, ceiling > CONN_BACKOFF_BASE ? ceiling - CONN_BACKOFF_BASE : 0);
+    l.state = ConnState::BACKOFF;
+    l.wait = l.delay;
+    l.waitFrom = now;
+    LOG_INFO("[Conn] %s retry %u in %lu ms", layerName(id), l.failures, (unsigned long)l.wait);
+
+    suspendAbove(id, now);
+}
+
+void ConnectivitySupervisor::suspendAbove(ConnLayer id, unsigned long now) {
+    for (uint8_t i = 0; i < (uint8_t)ConnLayer::COUNT; i++) {
+        ConnLayer above = (ConnLayer)i;
+        Layer& l = layer(above);
+        if (parentOf(above) != id || l.state == ConnState::SUSPENDED) {
+            continue;
+        }
+        if (l.state == ConnState::UP) {
+            l.stats.losses++;
+            l.since = now;
+            if (above == ConnLayer::BROKER && mqtt != nullptr) {
+                mqtt->disconnect();
+            }
+        }
+        // 由下层引起的失败不计入本层
+        l.state = ConnState::SUSPENDED;
+        l.failures = 0;
+        l.delay = CONN_BACKOFF_BASE;
+        suspendAbove(above, now);
+    }
+}
+
+/**
+ * 下层恢复：上层随机错开后首次尝试
+ */
+void ConnectivitySupervisor::resumeAbove(ConnLayer id, unsigned long now) {
+    for (uint8_t i = 0; i < (uint8_t)ConnLayer::COUNT; i++) {
+        ConnLayer above = (ConnLayer)i;
+        Layer& l = layer(above);
+        if (parentOf(above) != id || l.state != ConnState::SUSPENDED) {
+            continue;
+        }
+        l.state = ConnState::BACKOFF;
+        l.wait = randomBelow(l, CONN_RESUME_JITTER);
+        l.waitFrom = now;
+    }
+}
+
+void ConnectivitySupervisor::update() {
+    if (wifi == nullptr) {
+        return;
+    }
+    unsigned long now = millis();
+
+    // 链路：WiFi.begin() 是异步的，发起后等待连上或超时
+    Layer& link = layer(ConnLayer::LINK);
+    if (wifi->isConnected()) {
+        if (link.state != ConnState::UP) {
+            LOG_INFO("[WiFi] Connected! IP: %s, RSSI: %d", wifi->getLocalIP().c_str(), wifi->getSignalStrength());
+            markUp(ConnLayer::LINK, now);
+        }
+    } else if (link.state == ConnState::UP) {
+        markDown(ConnLayer::LINK, now, false);
+    } else if (link.state == ConnState::CONNECTING) {
+        if (now - link.waitFrom >= CONN_LINK_TIMEOUT) {
+            markDown(ConnLayer::LINK, now, true);
+        }
+    } else if (now - link.waitFrom >= link.wait) {
+        link.stats.attempts++;
+        wifi->connect();
+        link.state = ConnState::CONNECTING;
+        link.waitFrom = now;
+    }
+
+    // MQTT：只在链路连上时尝试（connect() 阻塞直到成功或超时）
+    if (mqtt == nullptr || link.state != ConnState::UP) {
+        return;
+    }
+    Layer& broker = layer(ConnLayer::BROKER);
+    bool connected = mqtt->isConnectedToMQTT();
+    if (connected && broker.state != ConnState::UP) {
+        markUp(ConnLayer::BROKER, now);
+    } else if (!connected && broker.state == ConnState::UP) {
+        markDown(ConnLayer::BROKER, now, false);
+    } else if (broker.state == ConnState::BACKOFF && now - broker.waitFrom >= broker.wait) {
+        broker.stats.attempts++;
+        bool ok = mqtt->connect();
+        now = millis();
+        if (ok) {
+            markUp(ConnLayer::BROKER, now);
+        } else {
+            markDown(ConnLayer::BROKER, now, true);
+        }
+    }
+}
+
+bool ConnectivitySupervisor::isReady(ConnLayer id) const {
+    const Layer& l = layer(id);
+    if (!parentUp(id)) {
+        return false;
+    }
+    return l.state == ConnState::UP ||
+           (l.state == ConnState::BACKOFF && millis() - l.waitFrom >= l.wait);
+}
+
+void ConnectivitySupervisor::report(ConnLayer id, bool succeeded) {
+    Layer& l = layer(id);
+    unsigned long now = millis();
+    l.stats.attempts++;
+    if (succeeded) {
+        l.failures = 0;
+        l.delay = CONN_BACKOFF_BASE;
+        markUp(id, now);
+    } else {
+        // 服务请求失败不是断开：只进入退避
+        if (l.state == ConnState::UP) {
+            l.state = ConnState::BACKOFF;
+            l.since = now;
+        }
+        markDown(id, now, true);
+    }
+}
+
+unsigned long ConnectivitySupervisor::getRetryIn(ConnLayer id) const {
+    const Layer& l = layer(id);
+    if (l.state != ConnState::BACKOFF) {
+        return 0;
+    }
+    unsigned long elapsed = millis() - l.waitFrom;
+    return elapsed >= l.wait ? 0 : l.wait - elapsed;
+}
@@ -1,8 +1,11 @@
 #include "DHT_Manager.h"
+#include "Input_Trace.h"
 
 DHTManager::DHTManager() 
     : dht(DHT_PIN, DHT_TYPE), lastTemp(0), lastHumidity(0), 
-      lastReadTime(0), isValid(false) {
+      lastReadTime(0), isValid(false),
+      tempHigh(TEMP_HIGH_THRESHOLD), tempLow(TEMP_LOW_THRESHOLD),
+      humidHigh(HUMID_HIGH_THRESHOLD), humidLow(HUMID_LOW_THRESHOLD) {
 }
 
 void DHTManager::begin() {
@@ -21,6 +24,8 @@ bool DHTManager::read() {
     float humidity = dht.readHumidity();
     // 读取温度（摄氏度）
     float temperature = dht.readTemperature();
+    // 录制时记下读数，回放时替换为录制的读数
+    g_inputTrace.traceDht(temperature, humidity);
     
     // 检查是否读取失败
     if (isnan(humidity) || isnan(temperature)) {
@@ -34,3 +39,14 @@ bool DHTManager::read() {
     
     return true;
 }
+
+bool DHTManager::setThresholds(float tHigh, float tLow, float hHigh, float hLow) {
+    if (!(tLow < tHigh) || !(hLow < hHigh)) {
+        return false;
+    }
+    tempHigh = tHigh;
+    tempLow = tLow;
+    humidHigh = hHigh;
+    humidLow = hLow;
+    return true;
+}
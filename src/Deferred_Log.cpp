@@ -0,0 +1,386 @@
+#include "Deferred_Log.h"
+#include <atomic>
+
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "LOG_BUFFER_SIZE must be a power of two");
+static_assert(LOG_BUFFER_SIZE <= 32768, "LOG_BUFFER_SIZE must fit 16-bit free-running indexes");
+
+#define LOG_RING_MASK (LOG_BUFFER_SIZE - 1)
+
+#if defined(ARDUINO_ARCH_STM32)
+
+typedef USART_TypeDef LogUartRegs;
+typedef DMA_Stream_TypeDef LogDmaStreamRegs;
+
+#define LOG_UART        USART1
+#define LOG_DMA_STREAM  DMA2_Stream7        // USART1_TX：DMA2 数据流 7 通道 4
+#define LOG_RX_STREAM   DMA2_Stream5        // USART1_RX：DMA2 数据流 5 通道 4
+#define LOG_DMA         DMA2
+#define LOG_GPIO        GPIOA
+
+#else
+
+// ==================== 主机寄存器模型 ====================
+
+typedef LogUartModel LogUartRegs;
+typedef LogDmaStreamModel LogDmaStreamRegs;
+
+static LogUartModel hostUartRegs;
+static LogDmaStreamModel hostStream;
+static LogDmaStreamModel hostRxStream;
+static LogDmaModel hostDma;
+static LogGpioModel hostGpio;
+
+#define LOG_UART        (&hostUartRegs)
+#define LOG_DMA_STREAM  (&hostStream)
+#define LOG_RX_STREAM   (&hostRxStream)
+#define LOG_DMA         (&hostDma)
+#define LOG_GPIO        (&hostGpio)
+
+// 主机没有 CMSIS 头文件，按参考手册补齐用到的位定义
+#define USART_CR1_RE            (1UL << 2)
+#define USART_CR1_TE            (1UL << 3)
+#define USART_CR1_UE            (1UL << 13)
+#define USART_CR3_DMAR          (1UL << 6)
+#define USART_CR3_DMAT          (1UL << 7)
+#define DMA_SxCR_EN             (1UL << 0)
+#define DMA_SxCR_TEIE           (1UL << 2)
+#define DMA_SxCR_TCIE           (1UL << 4)
+#define DMA_SxCR_DIR_0          (1UL << 6)
+#define DMA_SxCR_CIRC           (1UL << 8)
+#define DMA_SxCR_MINC           (1UL << 10)
+#define DMA_SxCR_CHSEL_Pos      25
+#define DMA_HISR_TEIF7          (1UL << 25)
+#define DMA_HISR_TCIF7          (1UL << 27)
+
+#endif
+
+#define LOG_TX_PIN        9     // PA9 -> USART1_TX
+#define LOG_RX_PIN        10    // PA10 -> USART1_RX
+#define LOG_PIN_ALTERNATE 7     // AF7：USART1
+#define LOG_DMA_CHANNEL   4
+
+static const uint32_t LOG_DMA_FLAGS = DMA_HISR_TEIF7 | DMA_HISR_TCIF7;
+
+DeferredLog g_log;
+DeferredLog* DeferredLog::instance = nullptr;
+
+// ==================== 帧编码 ====================
+
+void LogFrame::put(const void* src, uint8_t n) {
+    if (n > LOG_FRAME_MAX - length) {
+        n = LOG_FRAME_MAX - length;
+    }
+    memcpy(data + length, src, n);
+    length += n;
+}
+
+void LogFrame::putU32(uint32_t v) {
+    uint8_t bytes[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+    put(bytes, 4);
+}
+
+void LogFrame::putString(const uint8_t* s, size_t n) {
+    if (length >= LOG_FRAME_MAX) {
+        return;
+    }
+    // 长度字节与实际写入的内容一致，截断后解码端仍能对齐后续参数
+    size_t room = LOG_FRAME_MAX - length - 1;
+    if (n > LOG_STRING_MAX) n = LOG_STRING_MAX;
+    if (n > room) n = room;
+    data[length++] = (uint8_t)n;
+    put(s, (uint8_t)n);
+}
+
+/**
+ * COBS 编码：输出不含 0x00，长度最多增加 1 + n / 254
+ * @return 编码后的字节数（不含分隔符）
+ */
+static uint8_t cobsEncode(const uint8_t* src, uint8_t length, uint8_t* dst) {
+    uint8_t codeIndex = 0;
+    uint8_t code = 1;
+    uint8_t out = 1;
+
+    for (uint8_t i = 0; i < length; i++) {
+        if (src[i] == 0) {
+            dst[codeIndex] = code;
+            codeIndex = out++;
+            code = 1;
+        } else {
+            dst[out++] = src[i];
+            if (++code == 0xFF) {
+                dst[codeIndex] = code;
+                codeIndex = out++;
+                code = 1;
+            }
+        }
+    }
+    dst[codeIndex] = code;
+    return out;
+}
+
+// ==================== 缓冲区 ====================
+
+DeferredLog::DeferredLog()
+    : head(0), tail(0), inFlight(0), level(LOG_DEFAULT_LEVEL), pendingDrops(0),
+      textLength(0), consoleTail(0), stats() {
+}
+
+void DeferredLog::beginFrame(LogFrame& f, uint8_t frameLevel, uint32_t id) {
+    f.length = 0;
+    f.data[f.length++] = frameLevel;
+    f.putU32(id);
+    f.putU32(millis());
+}
+
+bool DeferredLog::store(const LogFrame& f) {
+    uint8_t encoded[LOG_FRAME_MAX + 2];
+    uint8_t n = cobsEncode(f.data, f.length, encoded);
+    encoded[n++] = 0;
+
+    uint16_t h = head;
+    uint16_t used = (uint16_t)(h - tail);
+    if (LOG_BUFFER_SIZE - used < n) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+        ring[(uint16_t)(h + i) & LOG_RING_MASK] = encoded[i];
+    }
+    // 内容先于写索引可见，DMA 中断读到新 head 时数据已就绪
+    std::atomic_signal_fence(std::memory_order_release);
+    head = (uint16_t)(h + n);
+
+    used += n;
+    if (used > stats.highWater) {
+        stats.highWater = used;
+    }
+    stats.frames++;
+    stats.bytes += n;
+    return true;
+}
+
+bool DeferredLog::commit(const LogFrame& f) {
+    // 先补报之前丢弃的帧数，保证解码端看到的顺序与丢失位置一致
+    if (pendingDrops > 0) {
+        LogFrame drop;
+        beginFrame(drop, LOG_LEVEL_WARN, LOG_ID_DROPPED);
+        drop.putU32(pendingDrops);
+        if (store(drop)) {
+            pendingDrops = 0;
+        }
+    }
+
+    if (pendingDrops > 0 || !store(f)) {
+        pendingDrops++;
+        stats.dropped++;
+        return false;
+    }
+    return true;
+}
+
+// ==================== Print 接口 ====================
+
+void DeferredLog::flushText() {
+    LogFrame f;
+    beginFrame(f, LOG_LEVEL_INFO, LOG_ID_TEXT);
+    f.put(text, textLength);
+    textLength = 0;
+    commit(f);
+}
+
+bool DeferredLog::record(const uint8_t* data, uint8_t length) {
+    LogFrame f;
+    beginFrame(f, LOG_LEVEL_OFF, LOG_ID_INPUT);
+    f.put(data, length);
+    return commit(f);
+}
+
+size_t DeferredLog::write(uint8_t c) {
+    if (c == '\n') {
+        flushText();
+    } else if (c != '\r') {
+        text[textLength++] = c;
+        if (textLength >= LOG_TEXT_MAX) {
+            flushText();
+        }
+    }
+    return 1;
+}
+
+size_t DeferredLog::write(const uint8_t* buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+    }
+    return size;
+}
+
+// ==================== USART + DMA ====================
+
+void DeferredLog::begin(uint32_t baud) {
+    instance = this;
+
+#if defined(ARDUINO_ARCH_STM32)
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_USART1_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    uint32_t uartClock = HAL_RCC_GetPCLK2Freq();       // USART1 位于 APB2
+#else
+    uint32_t uartClock = 84000000UL;
+#endif
+
+    // GPIO：PA9、PA10 复用功能
+    const uint8_t pins[2] = {LOG_TX_PIN, LOG_RX_PIN};
+    for (uint8_t pin : pins) {
+        uint32_t shift2 = pin * 2;
+        uint32_t shift4 = (pin & 7) * 4;
+        LOG_GPIO->MODER = (LOG_GPIO->MODER & ~(3UL << shift2)) | (2UL << shift2);
+        LOG_GPIO->OSPEEDR = (LOG_GPIO->OSPEEDR & ~(3UL << shift2)) | (2UL << shift2);
+        LOG_GPIO->AFR[pin >> 3] = (LOG_GPIO->AFR[pin >> 3] & ~(0xFUL << shift4))
+                                  | ((uint32_t)LOG_PIN_ALTERNATE << shift4);
+    }
+
+    // USART：8N1，16 倍过采样时 BRR 即分频比；收发都走 DMA
+    LOG_UART->CR1 = 0;
+    LOG_UART->BRR = (uartClock + baud / 2) / baud;
+    LOG_UART->CR3 = USART_CR3_DMAT | USART_CR3_DMAR;
+    LOG_UART->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE;
+
+    // 接收 DMA：DR -> 内存，循环模式，不开中断，readConsole() 按 NDTR 取新字节
+    LOG_RX_STREAM->CR = 0;
+    while (LOG_RX_STREAM->CR & DMA_SxCR_EN) {}
+    LOG_RX_STREAM->PAR = (uintptr_t)&LOG_UART->DR;
+    LOG_RX_STREAM->M0AR = (uintptr_t)console;
+    LOG_RX_STREAM->NDTR = LOG_CONSOLE_BUFFER;
+    LOG_RX_STREAM->FCR = 0;
+    consoleTail = 0;
+    LOG_RX_STREAM->CR = ((uint32_t)LOG_DMA_CHANNEL << DMA_SxCR_CHSEL_Pos)
+                      | DMA_SxCR_MINC | DMA_SxCR_CIRC | DMA_SxCR_EN;
+
+    // DMA：内存 -> DR，8 位，单次传输，每段发送完成后由中断接续
+    LOG_DMA_STREAM->CR = 0;
+    while (LOG_DMA_STREAM->CR & DMA_SxCR_EN) {}
+    LOG_DMA_STREAM->PAR = (uintptr_t)&LOG_UART->DR;
+    LOG_DMA_STREAM->FCR = 0;
+    LOG_DMA_STREAM->CR = ((uint32_t)LOG_DMA_CHANNEL << DMA_SxCR_CHSEL_Pos)
+                       | DMA_SxCR_MINC | DMA_SxCR_DIR_0 | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    LOG_DMA->HIFCR = LOG_DMA_FLAGS;
+
+#if defined(ARDUINO_ARCH_STM32)
+    // 日志优先级最低，不能推迟舵机 DMA 中断
+    HAL_NVIC_SetPriority(DMA2_Stream7_IRQn, 15, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+#endif
+}
+
+size_t DeferredLog::readConsole(uint8_t* out, size_t capacity) {
+    // DMA 下一个写入位置；NDTR 从 LOG_CONSOLE_BUFFER 递减到 1 后回绕
+    uint16_t head = (uint16_t)(LOG_CONSOLE_BUFFER - LOG_RX_STREAM->NDTR) % LOG_CONSOLE_BUFFER;
+    size_t count = 0;
+    while (consoleTail != head && count < capacity) {
+        out[count++] = console[consoleTail];
+        consoleTail = (uint16_t)((consoleTail + 1) % LOG_CONSOLE_BUFFER);
+    }
+    return count;
+}
+
+void DeferredLog::startTransfer() {
+    uint16_t start = tail & LOG_RING_MASK;
+    uint16_t count = (uint16_t)(head - tail);
+    if (start + count > LOG_BUFFER_SIZE) {
+        count = LOG_BUFFER_SIZE - start;    // 先发到缓冲区末尾，回绕部分下一次发送
+    }
+    inFlight = count;
+
+    LOG_DMA_STREAM->M0AR = (uintptr_t)&ring[start];
+    LOG_DMA_STREAM->NDTR = count;
+    LOG_DMA_STREAM->CR |= DMA_SxCR_EN;
+}
+
+void DeferredLog::update() {
+    if (textLength > 0 && inFlight == 0 && head == tail) {
+        flushText();        // 不以换行结尾的文本在空闲时发出
+    }
+
+    // DMA 空闲时中断不会到来，这里启动发送不会与中断竞争
+    if (inFlight == 0 && head != tail) {
+        startTransfer();
+    }
+}
+
+void DeferredLog::handleDmaInterrupt() {
+    uint32_t flags = LOG_DMA->HISR & LOG_DMA_FLAGS;
+    LOG_DMA->HIFCR = flags;
+
+    // 传输错误时同样跳过这一段，避免日志卡死
+    tail = (uint16_t)(tail + inFlight);
+    inFlight = 0;
+
+    if (head != tail) {
+        startTransfer();
+    }
+}
+
+#if defined(ARDUINO_ARCH_STM32)
+
+extern "C" void DMA2_Stream7_IRQHandler(void) {
+    DeferredLog* log = DeferredLog::getInstance();
+    if (log) {
+        log->handleDmaInterrupt();
+    }
+}
+
+#else
+
+size_t DeferredLog::hostTransmit(uint8_t* out, size_t capacity) {
+    // HIFCR 写 1 清除对应标志
+    hostDma.HISR &= ~hostDma.HIFCR;
+    hostDma.HIFCR = 0;
+
+    if (!(hostStream.CR & DMA_SxCR_EN) || !(hostUartRegs.CR3 & USART_CR3_DMAT)) {
+        return 0;
+    }
+
+    const uint8_t* memory = (const uint8_t*)hostStream.M0AR;
+    size_t count = hostStream.NDTR;
+    for (size_t i = 0; i < count; i++) {
+        hostUartRegs.DR = memory[i];
+        if (i < capacity) {
+            out[i] = memory[i];
+        }
+    }
+
+    // 单次传输结束：NDTR 归零、数据流自动关闭、置传输完成标志
+    hostStream.NDTR = 0;
+    hostStream.CR &= ~DMA_SxCR_EN;
+    hostDma.HISR |= DMA_HISR_TCIF7;
+
+    if ((hostStream.CR & DMA_SxCR_TCIE) && instance) {
+        instance->handleDmaInterrupt();
+    }
+    return count < capacity ? count : capacity;
+}
+
+const LogUartModel& DeferredLog::hostUart() {
+    return hostUartRegs;
+}
+
+const LogDmaStreamModel& DeferredLog::hostDmaStream() {
+    return hostStream;
+}
+
+void DeferredLog::hostReceive(const uint8_t* data, size_t length) {
+    if (!(hostRxStream.CR & DMA_SxCR_EN) || !(hostUartRegs.CR3 & USART_CR3_DMAR)) {
+        return;
+    }
+    uint8_t* memory = (uint8_t*)hostRxStream.M0AR;
+    for (size_t i = 0; i < length; i++) {
+        hostUartRegs.DR = data[i];
+        memory[LOG_CONSOLE_BUFFER - hostRxStream.NDTR] = data[i];
+        // 循环模式：计数到 0 时自动重装
+        if (--hostRxStream.NDTR == 0) {
+            hostRxStream.NDTR = LOG_CONSOLE_BUFFER;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,351 @@
+#include "Device_Shadow.h"
+#include "Deferred_Log.h"
+#include "Json_Tokenizer.h"
+#include "Json_Writer.h"
+#include "Remote_Control.h"
+
+/**
+ * 字段取值类型
+ */
+enum class ShadowKind : uint8_t {
+    EMOTION,              // 表情名称
+    MODE,                 // 工作模式名称
+    DECIMAL               // 一位小数
+};
+
+struct ShadowFieldInfo {
+    const char* name;
+    ShadowKind kind;
+    int16_t min;          // DECIMAL 的取值范围（0.1 单位）
+    int16_t max;
+};
+
+// 顺序与 ShadowField 一致
+static const ShadowFieldInfo SHADOW_FIELDS[] = {
+    {"emotion",    ShadowKind::EMOTION, 0, 0},
+    {"mode",       ShadowKind::MODE,    0, 0},
+    {"temp_high",  ShadowKind::DECIMAL, -200, 600},
+    {"temp_low",   ShadowKind::DECIMAL, -200, 600},
+    {"humid_high", ShadowKind::DECIMAL, 0, 1000},
+    {"humid_low",  ShadowKind::DECIMAL, 0, 1000},
+};
+static_assert(sizeof(SHADOW_FIELDS) / sizeof(SHADOW_FIELDS[0]) == (uint8_t)ShadowField::COUNT,
+              "SHADOW_FIELDS must match ShadowField");
+static_assert((uint8_t)ShadowField::COUNT <= 8, "changed mask is 8 bits");
+
+#define SHADOW_FIELD_COUNT ((uint8_t)ShadowField::COUNT)
+
+/**
+ * 解析一个字段值
+ */
+static bool parseField(const ShadowFieldInfo& info, const char* json, const JsonToken& token,
+                       int16_t& value) {
+    switch (info.kind) {
+        case ShadowKind::EMOTION: {
+            EmotionState emotion;
+            if (token.type != JsonType::STRING ||
+                !remoteEmotionFromName(json + token.start, token.length, emotion)) {
+                return false;
+            }
+            value = (int16_t)emotion;
+            return true;
+        }
+        case ShadowKind::MODE: {
+            RemoteMode mode;
+            if (token.type != JsonType::STRING ||
+                !remoteModeFromName(json + token.start, token.length, mode)) {
+                return false;
+            }
+            value = (int16_t)mode;
+            return true;
+        }
+        case ShadowKind::DECIMAL: {
+            int32_t fixed;
+            if (!jsonToFixed(json, token, 1, fixed) || fixed < info.min || fixed > info.max) {
+                return false;
+            }
+            value = (int16_t)fixed;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 读取非负整数版本号
+ */
+static bool parseVersion(const char* json, const JsonToken* tokens, int16_t token, uint32_t& version) {
+    int32_t value;
+    if (token < 0 || !jsonToInt(json, tokens[token], value) || value < 0) {
+        return false;
+    }
+    version = (uint32_t)value;
+    return true;
+}
+
+DeviceShadow::DeviceShadow()
+    : reportedVersion(0), backendVersion(0), desiredMask(0), desiredVersion(0),
+      online(false), synced(false), fresh(true), replyDue(false), helloDue(false),
+      pending(Pending::NONE), lastHello(0), lastReport(0), handler(nullptr) {
+    memset(&reported, 0, sizeof(reported));
+    memset(&desired, 0, sizeof(desired));
+    memset(fieldVersion, 0, sizeof(fieldVersion));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void DeviceShadow::begin(const ShadowState& actual) {
+    reported = actual;
+    desired = actual;
+    desiredMask = 0;
+    desiredVersion = 0;
+    // 启动时的全部字段都算作版本 1 的变化，首次握手后全量上报
+    reportedVersion = 1;
+    backendVersion = 0;
+    for (uint8_t i = 0; i < SHADOW_FIELD_COUNT; i++) {
+        fieldVersion[i] = reportedVersion;
+    }
+    fresh = true;
+    synced = false;
+    replyDue = false;
+    pending = Pending::NONE;
+    LOG_INFO("[Shadow] Initialized");
+}
+
+void DeviceShadow::update(const ShadowState& actual, bool connected, unsigned long now) {
+    if (!connected) {
+        online = false;
+        synced = false;
+    } else if (!online) {
+        // 重新连上：先握手对齐版本
+        online = true;
+        synced = false;
+        helloDue = true;
+    }
+
+    // 断线期间的变化照样记版本，握手后一并上报
+    bool changed = false;
+    for (uint8_t i = 0; i < SHADOW_FIELD_COUNT; i++) {
+        if (actual.value[i] != reported.value[i]) {
+            if (!changed) {
+                reportedVersion++;
+                changed = true;
+            }
+            fieldVersion[i] = reportedVersion;
+        }
+    }
+    if (changed) {
+        reported = actual;
+    }
+
+    if (!online) {
+        pending = Pending::NONE;
+    } else if (!synced) {
+        pending = (helloDue || now - lastHello >= SHADOW_SYNC_RETRY) ? Pending::HELLO : Pending::NONE;
+    } else if (replyDue) {
+        pending = Pending::DELTA;      // 握手应答与期望状态的确认不等上报间隔
+    } else if (reportedVersion != backendVersion && now - lastReport >= SHADOW_REPORT_INTERVAL) {
+        pending = Pending::DELTA;
+    } else {
+        pending = Pending::NONE;
+    }
+}
+
+bool DeviceShadow::handleMessage(const uint8_t* payload, unsigned int length) {
+    const char* json = (const char*)payload;
+    JsonToken tokens[SHADOW_JSON_TOKENS];
+    uint16_t count = 0;
+    stats.messagesReceived++;
+    stats.bytesReceived += length;
+
+    JsonError error = jsonTokenize(json, length, tokens, SHADOW_JSON_TOKENS, count);
+    uint32_t d = 0;
+    if (error != JsonError::NONE || tokens[0].type != JsonType::OBJECT ||
+        !parseVersion(json, tokens, jsonFind(json, tokens, 0, "d"), d)) {
+        LOG_WARN("[Shadow] Rejected message: %s",
+                 error != JsonError::NONE ? jsonErrorText(error) : "missing d");
+        stats.rejected++;
+        return false;
+    }
+
+    int16_t rToken = jsonFind(json, tokens, 0, "r");
+    int16_t baseToken = jsonFind(json, tokens, 0, "base");
+    int16_t setToken = jsonFind(json, tokens, 0, "set");
+    uint32_t r = 0;
+    uint32_t base = 0;
+    bool valid = (rToken < 0 || parseVersion(json, tokens, rToken, r)) &&
+                 (baseToken < 0 || parseVersion(json, tokens, baseToken, base)) &&
+                 (setToken < 0 || tokens[setToken].type == JsonType::OBJECT);
+
+    // 先校验整条消息，暂存到副本，全部有效才应用
+    ShadowState next = desired;
+    uint8_t setMask = 0;
+    if (valid && setToken >= 0) {
+        uint16_t k = setToken + 1;
+        for (uint16_t n = 0; n < tokens[setToken].size && valid; n++) {
+            const JsonToken& value = tokens[k + 1];
+            valid = false;
+            for (uint8_t i = 0; i < SHADOW_FIELD_COUNT; i++) {
+                if (jsonEquals(json, tokens[k], SHADOW_FIELDS[i].name)) {
+                    valid = parseField(SHADOW_FIELDS[i], json, value, next.value[i]);
+                    setMask |= (uint8_t)(1u << i);
+                    break;
+                }
+            }
+            k = value.next;
+        }
+    }
+    if (!valid) {
+        LOG_WARN("[Shadow] Rejected message: invalid field");
+        stats.rejected++;
+        return false;
+    }
+
+    // 带 r 的消息是握手应答（或后端要求重发）
+    // 报告版本：后端的版本比本机新（设备重启过），或这是启动后的首次握手，全量上报
+    if (rToken >= 0) {
+        if (!synced) {
+            stats.syncs++;
+        }
+        synced = true;
+        if (fresh || r > reportedVersion) {
+            reportedVersion = (r > reportedVersion ? r : reportedVersion) + 1;
+            for (uint8_t i = 0; i < SHADOW_FIELD_COUNT; i++) {
+                fieldVersion[i] = reportedVersion;
+            }
+        }
+        fresh = false;
+        backendVersion = r;
+        replyDue = replyDue || backendVersion != reportedVersion;
+    }
+
+    // 期望版本：没有 set 时表示没有变化，相当于 base = d
+    if (setToken < 0) {
+        base = d;
+    }
+    if (base > desiredVersion) {
+        // 中间的增量丢了，重新握手取 desiredVersion 之后的全部变化
+        LOG_WARN("[Shadow] Desired version gap: have %lu, delta from %lu",
+                 (unsigned long)desiredVersion, (unsigned long)base);
+        synced = false;
+        helloDue = true;
+        return true;
+    }
+    if (d == desiredVersion) {
+        return true;
+    }
+    if (d < desiredVersion) {
+        // 后端的版本回退（后端重置）：以后端为准，已应用的值不变
+        desiredVersion = d;
+        replyDue = true;
+        return true;
+    }
+
+    uint8_t changed = 0;
+    for (uint8_t i = 0; i < SHADOW_FIELD_COUNT; i++) {
+        if ((setMask & (1u << i)) && (next.value[i] != desired.value[i] || !(desiredMask & (1u << i)))) {
+            changed |= (uint8_t)(1u << i);
+        }
+    }
+    desired = next;
+    desiredMask |= setMask;
+    desiredVersion = d;
+    replyDue = true;
+    LOG_INFO("[Shadow] Desired version %lu, changed mask %d", (unsigned long)d, changed);
+
+    if (changed != 0 && handler != nullptr) {
+        handler(desired, changed);
+    }
+    return true;
+}
+
+void DeviceShadow::writeFields(JsonWriter& json, uint32_t since) const {
+    json.beginObject();
+    for (uint8_t i = 0; i < SHADOW_FIELD_COUNT; i++) {
+        if (fieldVersion[i] <= since) {
+            continue;
+        }
+        json.key(SHADOW_FIELDS[i].name);
+        switch (SHADOW_FIELDS[i].kind) {
+            case ShadowKind::EMOTION:
+                json.string(remoteEmotionName((EmotionState)reported.value[i]));
+                break;
+            case ShadowKind::MODE:
+                json.string(remoteModeName((RemoteMode)reported.value[i]));
+                break;
+            case ShadowKind::DECIMAL:
+                json.fixed(reported.value[i], 1);
+                break;
+        }
+    }
+    json.endObject();
+}
+
+size_t DeviceShadow::writePending(Print& out) const {
+    if (pending == Pending::NONE) {
+        return 0;
+    }
+
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("d");
+    json.unsignedInteger(desiredVersion);
+    json.key("r");
+    json.unsignedInteger(reportedVersion);
+    if (pending == Pending::DELTA) {
+        json.key("base");
+        json.unsignedInteger(backendVersion);
+
+        bool any = false;
+        for (uint8_t i = 0; i < SHADOW_FIELD_COUNT; i++) {
+            any = any || fieldVersion[i] > backendVersion;
+        }
+        if (any) {
+            json.key("set");
+            writeFields(json, backendVersion);
+        }
+    }
+    json.endObject();
+    return json.size();
+}
+
+void DeviceShadow::markSent(unsigned long now, size_t bytes) {
+    stats.messagesSent++;
+    stats.bytesSent += bytes;
+    if (pending == Pending::HELLO) {
+        lastHello = now;
+        helloDue = false;
+    } else if (pending == Pending::DELTA) {
+        // 不等确认：丢失时后端按 base 对不上来要求重发
+        backendVersion = reportedVersion;
+        replyDue = false;
+        lastReport = now;
+    }
+    pending = Pending::NONE;
+}
+
+bool DeviceShadow::publish(MQTTManager& mqtt, unsigned long now) {
+    if (pending == Pending::NONE) {
+        return false;
+    }
+
+    PrintCounter counter;
+    writePending(counter);
+
+    Print* packet = mqtt.beginPublish(MQTT_TOPIC_SHADOW_REPORTED, counter.getCount());
+    if (packet == nullptr) {
+        return false;
+    }
+    writePending(*packet);
+    if (!mqtt.endPublish()) {
+        return false;
+    }
+    markSent(now, counter.getCount());
+    return true;
+}
+
+const char* DeviceShadow::fieldName(ShadowField field) {
+    if ((uint8_t)field >= SHADOW_FIELD_COUNT) {
+        return "unknown";
+    }
+    return SHADOW_FIELDS[(uint8_t)field].name;
+}
@@ -0,0 +1,112 @@
+#include "Feedback_Phrases.h"
+
+// 按 Phrase 顺序排列，下标即短语
+static const char PHRASE_TABLE[(uint8_t)Phrase::COUNT][PHRASE_MAX_LEN] PROGMEM = {
+    "Too hot! Stay cool!",      // TOO_HOT
+    "So cold! Keep warm!",      // SO_COLD
+    "Feeling warm today",       // FEELING_WARM
+    "It's chilly outside",      // CHILLY
+    "Temperature is perfect",   // TEMP_PERFECT
+    "Humidity is high",         // HUMIDITY_HIGH
+    "Air is dry",               // AIR_DRY
+    "Hot! Stay cool",           // ADVICE_HOT
+    "Cold! Keep warm",          // ADVICE_COLD
+    "Humid, bring umbrella",    // ADVICE_HUMID
+    "Comfortable weather",      // ADVICE_COMFORTABLE
+    "Bring an umbrella",        // ADVICE_RAINY
+    "Snowy, dress warmly",      // ADVICE_SNOWY
+    "Storm! Stay indoors",      // ADVICE_STORMY
+    "Poor air, wear a mask",    // ADVICE_FOGGY
+    "Windy, hold your hat"      // ADVICE_WINDY
+};
+
+// 温度档位 -> 播报短语（按 ThermalLevel 顺序）
+static const Phrase THERMAL_PHRASE[] = {
+    Phrase::TOO_HOT,            // HOT
+    Phrase::FEELING_WARM,       // WARM
+    Phrase::TEMP_PERFECT,       // COMFORTABLE
+    Phrase::CHILLY,             // CHILLY
+    Phrase::SO_COLD             // COLD
+};
+
+// 天气类型 -> 温度适宜时的建议（按 WeatherType 顺序）
+static const Phrase WEATHER_ADVICE[WEATHER_TYPE_COUNT] = {
+    Phrase::ADVICE_COMFORTABLE, // SUNNY
+    Phrase::ADVICE_COMFORTABLE, // CLOUDY
+    Phrase::ADVICE_RAINY,       // RAINY
+    Phrase::ADVICE_SNOWY,       // SNOWY
+    Phrase::ADVICE_STORMY,      // STORMY
+    Phrase::ADVICE_FOGGY,       // FOGGY
+    Phrase::ADVICE_WINDY,       // WINDY
+    Phrase::ADVICE_COMFORTABLE  // UNKNOWN
+};
+
+ThermalLevel thermalLevel(float temp) {
+    if (temp > 32.0f) {
+        return ThermalLevel::HOT;
+    } else if (temp < 10.0f) {
+        return ThermalLevel::COLD;
+    } else if (temp > 28.0f) {
+        return ThermalLevel::WARM;
+    } else if (temp < 15.0f) {
+        return ThermalLevel::CHILLY;
+    }
+    return ThermalLevel::COMFORTABLE;
+}
+
+PhraseList thermalPhrases(float temp, float humidity) {
+    PhraseList list;
+    list.items[0] = THERMAL_PHRASE[(uint8_t)thermalLevel(temp)];
+    list.count = 1;
+
+    // 湿度反馈
+    if (humidity > 70.0f) {
+        list.items[list.count++] = Phrase::HUMIDITY_HIGH;
+    } else if (humidity < 30.0f) {
+        list.items[list.count++] = Phrase::AIR_DRY;
+    }
+    return list;
+}
+
+Phrase weatherAdvicePhrase(WeatherType type, float temp, float humidity) {
+    if (temp > 30.0f) {
+        return Phrase::ADVICE_HOT;
+    } else if (temp < 10.0f) {
+        return Phrase::ADVICE_COLD;
+    } else if (humidity > 70.0f) {
+        return Phrase::ADVICE_HUMID;
+    }
+
+    if ((uint8_t)type >= WEATHER_TYPE_COUNT) {
+        return Phrase::ADVICE_COMFORTABLE;
+    }
+    return WEATHER_ADVICE[(uint8_t)type];
+}
+
+const char* phraseText(Phrase phrase) {
+    if ((uint8_t)phrase >= (uint8_t)Phrase::COUNT) {
+        return "";
+    }
+    return PHRASE_TABLE[(uint8_t)phrase];
+}
+
+size_t composePhrases(const PhraseList& list, char* buffer, size_t size) {
+    if (buffer == nullptr || size == 0) {
+        return 0;
+    }
+
+    size_t length = 0;
+    for (uint8_t i = 0; i < list.count && i < PHRASE_LIST_MAX; i++) {
+        if (i > 0) {
+            if (length + 2 >= size) {
+                break;  // 放不下下一条的首字符时不留尾随空格
+            }
+            buffer[length++] = ' ';
+        }
+        for (const char* p = phraseText(list.items[i]); *p != '\0' && length + 1 < size; p++) {
+            buffer[length++] = *p;
+        }
+    }
+    buffer[length] = '\0';
+    return length;
+}
@@ -0,0 +1,53 @@
+#include "Hardware_Crc.h"
+
+static uint32_t loadWord(const uint8_t* p, size_t n) {
+    uint8_t word[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+    memcpy(word, p, n < 4 ? n : 4);
+    return (uint32_t)word[0] | ((uint32_t)word[1] << 8) | ((uint32_t)word[2] << 16) | ((uint32_t)word[3] << 24);
+}
+
+#if defined(ARDUINO_ARCH_STM32)
+
+uint32_t hwCrc32(const uint8_t* data, size_t length) {
+    static bool clockEnabled = false;
+    if (!clockEnabled) {
+        __HAL_RCC_CRC_CLK_ENABLE();
+        clockEnabled = true;
+    }
+
+    CRC->CR = CRC_CR_RESET;
+    return hwCrc32Append(data, length);
+}
+
+uint32_t hwCrc32Append(const uint8_t* data, size_t length) {
+    // 每个字 4 个 AHB 周期；CRC 单元不被中断使用，无需关中断
+    for (size_t i = 0; i < length; i += 4) {
+        CRC->DR = loadWord(data + i, length - i);
+    }
+    return CRC->DR;
+}
+
+#else
+
+// ==================== 主机 CRC 模型 ====================
+
+static uint32_t hostCrcRegister = 0xFFFFFFFFUL;     // 对应 CRC->DR
+
+uint32_t hwCrc32(const uint8_t* data, size_t length) {
+    hostCrcRegister = 0xFFFFFFFFUL;
+    return hwCrc32Append(data, length);
+}
+
+uint32_t hwCrc32Append(const uint8_t* data, size_t length) {
+    uint32_t crc = hostCrcRegister;
+    for (size_t i = 0; i < length; i += 4) {
+        crc ^= loadWord(data + i, length - i);
+        for (uint8_t bit = 0; bit < 32; bit++) {
+            crc = (crc & 0x80000000UL) ? (crc << 1) ^ 0x04C11DB7UL : crc << 1;
+        }
+    }
+    hostCrcRegister = crc;
+    return crc;
+}
+
+#endif
@@ -0,0 +1,443 @@
+#include "Input_Trace.h"
+
+#if !defined(ARDUINO_ARCH_STM32)
+#include <chrono>
+#endif
+
+InputTrace g_inputTrace;
+
+// 日志帧头：[级别][ID u32][millis u32]，其后是 [记录类型][内容]
+static constexpr uint8_t FRAME_HEADER = 9;
+
+static void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void putFloat(uint8_t* p, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    putU32(p, bits);
+}
+
+static float getFloat(const uint8_t* p) {
+    uint32_t bits = getU32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+/**
+ * 回放耗时计时（主机上 millis() 由回放驱动，不能用来计时）
+ */
+static uint32_t wallMicros() {
+#if defined(ARDUINO_ARCH_STM32)
+    return micros();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+InputTrace::InputTrace()
+    : mode(InputTraceMode::OFF), digest(nullptr), linkState(false),
+      loopLength(0), lastLoopTime(0), lastClock(0), lastCheckpoint(0),
+      trace(nullptr), traceLength(0), cursor(0),
+      loopDeltas(nullptr), loopPending(0), loopTime(0), firstLoopTime(0),
+      replayStartUs(0), setClock(nullptr), stats{} {
+}
+
+// ==================== 录制 ====================
+
+void InputTrace::beginRecording() {
+    mode = InputTraceMode::RECORD;
+    linkState = false;
+    loopLength = 0;
+    lastClock = millis();
+    lastCheckpoint = lastClock;
+}
+
+void InputTrace::record(InputRecordKind kind, const void* data, uint8_t length) {
+    // 输入记录必须跟在所属 loop() 的 LOOP 记录之后
+    flushLoops();
+
+    uint8_t buffer[INPUT_RECORD_MAX];
+    if (length > INPUT_RECORD_MAX - 1) {
+        length = INPUT_RECORD_MAX - 1;
+    }
+    buffer[0] = (uint8_t)kind;
+    memcpy(buffer + 1, data, length);
+    g_log.record(buffer, length + 1);
+}
+
+void InputTrace::flushLoops() {
+    if (loopLength > 0) {
+        g_log.record(loopRecord, loopLength);
+        loopLength = 0;
+    }
+}
+
+// ==================== 回放 ====================
+
+void InputTrace::beginReplay(const uint8_t* data, size_t length, InputClockSetter clock) {
+    mode = InputTraceMode::REPLAY;
+    trace = data;
+    traceLength = length;
+    cursor = 0;
+    loopPending = 0;
+    linkState = false;
+    setClock = clock;
+    stats = InputReplayStats{};
+    replayStartUs = wallMicros();
+
+    // setup() 阶段的时间取第一条记录的时刻
+    if (traceLength > FRAME_HEADER && trace[0] > FRAME_HEADER && setClock) {
+        setClock(getU32(trace + 1 + 5));
+    }
+}
+
+bool InputTrace::nextRecord(InputRecordKind& kind, const uint8_t*& payload, uint8_t& length) {
+    if (cursor >= traceLength) {
+        return false;
+    }
+
+    uint8_t frameLength = trace[cursor];
+    if (frameLength <= FRAME_HEADER || cursor + 1 + frameLength > traceLength) {
+        cursor = traceLength;  // 截断的尾部
+        return false;
+    }
+
+    const uint8_t* frame = trace + cursor + 1;
+    kind = (InputRecordKind)frame[FRAME_HEADER];
+    payload = frame + FRAME_HEADER + 1;
+    length = frameLength - FRAME_HEADER - 1;
+    return true;
+}
+
+bool InputTrace::peek(InputRecordKind kind, const uint8_t*& payload, uint8_t& length) {
+    if (mode != InputTraceMode::REPLAY || loopPending != 0) {
+        return false;
+    }
+
+    InputRecordKind next;
+    return nextRecord(next, payload, length) && next == kind;
+}
+
+void InputTrace::consume() {
+    cursor += 1 + trace[cursor];
+    stats.records++;
+}
+
+void InputTrace::finishReplay() {
+    if (!stats.finished) {
+        stats.finished = true;
+        stats.wallUs = wallMicros() - replayStartUs;
+    }
+}
+
+// ==================== 每次 loop() ====================
+
+bool InputTrace::beginLoop() {
+    if (mode == InputTraceMode::RECORD) {
+        uint32_t now = millis();
+        uint32_t delta = now - lastLoopTime;
+
+        if (loopLength > 0 && (delta > 0xFF || loopLength >= INPUT_RECORD_MAX)) {
+            flushLoops();
+        }
+        if (loopLength == 0) {
+            loopRecord[0] = (uint8_t)InputRecordKind::LOOP;
+            putU32(loopRecord + 1, now);
+            loopLength = 5;
+        } else {
+            loopRecord[loopLength++] = (uint8_t)delta;
+        }
+        lastLoopTime = now;
+        lastClock = now;
+
+        if (digest && now - lastCheckpoint >= INPUT_CHECKPOINT_MS) {
+            lastCheckpoint = now;
+            uint8_t value[4];
+            putU32(value, digest());
+            record(InputRecordKind::CHECKPOINT, value, sizeof(value));
+        }
+        return true;
+    }
+
+    if (mode != InputTraceMode::REPLAY) {
+        return true;
+    }
+    if (stats.finished) {
+        return false;
+    }
+
+    InputRecordKind kind;
+    const uint8_t* payload;
+    uint8_t length;
+
+    if (loopPending == 0) {
+        // 上一次 loop() 中没有被任何调用处取走的记录
+        while (nextRecord(kind, payload, length) && kind != InputRecordKind::LOOP) {
+            stats.skipped++;
+            cursor += 1 + trace[cursor];
+        }
+        if (cursor >= traceLength || length < 4) {
+            finishReplay();
+            return false;
+        }
+
+        if (stats.loops == 0) {
+            firstLoopTime = getU32(payload);
+        }
+        loopTime = getU32(payload);
+        loopDeltas = payload + 4;
+        loopPending = length - 4 + 1;
+        consume();
+    } else {
+        loopTime += *loopDeltas++;
+    }
+    loopPending--;
+
+    if (setClock) {
+        setClock(loopTime);
+    }
+    stats.loops++;
+    stats.simulatedMs = loopTime - firstLoopTime;
+
+    if (peek(InputRecordKind::CHECKPOINT, payload, length)) {
+        uint32_t expected = getU32(payload);
+        consume();
+        if (digest) {
+            stats.checkpoints++;
+            if (digest() != expected) {
+                if (stats.checkpointFailures == 0) {
+                    stats.firstFailureTime = loopTime;
+                }
+                stats.checkpointFailures++;
+            }
+        }
+    }
+    return true;
+}
+
+void InputTrace::syncClock() {
+    if (mode == InputTraceMode::RECORD) {
+        uint32_t now = millis();
+        if (now != lastClock) {
+            lastClock = now;
+            uint8_t value[4];
+            putU32(value, now);
+            record(InputRecordKind::CLOCK, value, sizeof(value));
+        }
+        return;
+    }
+
+    const uint8_t* payload;
+    uint8_t length;
+    if (peek(InputRecordKind::CLOCK, payload, length)) {
+        if (setClock) {
+            setClock(getU32(payload));
+        }
+        consume();
+    }
+}
+
+// ==================== 各输入点 ====================
+
+void InputTrace::traceDht(float& temperature, float& humidity) {
+    if (mode == InputTraceMode::RECORD) {
+        uint8_t value[8];
+        putFloat(value, temperature);
+        putFloat(value + 4, humidity);
+        record(InputRecordKind::DHT, value, sizeof(value));
+        return;
+    }
+    if (mode != InputTraceMode::REPLAY) {
+        return;
+    }
+
+    const uint8_t* payload;
+    uint8_t length;
+    if (peek(InputRecordKind::DHT, payload, length) && length >= 8) {
+        temperature = getFloat(payload);
+        humidity = getFloat(payload + 4);
+        consume();
+    } else {
+        // 录制中没有这次读取：按读取失败处理
+        stats.mismatches++;
+        temperature = NAN;
+        humidity = NAN;
+    }
+}
+
+size_t InputTrace::traceBytes(InputRecordKind kind, uint8_t* buffer, size_t length, size_t capacity) {
+    if (mode == InputTraceMode::RECORD) {
+        if (length > 0) {
+            record(kind, buffer, (uint8_t)length);
+        }
+        return length;
+    }
+    if (mode != InputTraceMode::REPLAY) {
+        return length;
+    }
+
+    const uint8_t* payload;
+    uint8_t recorded;
+    if (!peek(kind, payload, recorded)) {
+        return 0;
+    }
+    if (recorded > capacity) {
+        recorded = (uint8_t)capacity;
+    }
+    memcpy(buffer, payload, recorded);
+    consume();
+    return recorded;
+}
+
+size_t InputTrace::traceVoice(uint8_t* buffer, size_t length, size_t capacity) {
+    return traceBytes(InputRecordKind::VOICE, buffer, length, capacity);
+}
+
+size_t InputTrace::traceConsole(uint8_t* buffer, size_t length, size_t capacity) {
+    return traceBytes(InputRecordKind::CONSOLE, buffer, length, capacity);
+}
+
+size_t InputTrace::traceConfig(uint8_t* buffer, size_t length, size_t capacity) {
+    const uint8_t chunk = INPUT_RECORD_MAX - 1;
+    if (mode == InputTraceMode::RECORD) {
+        for (size_t offset = 0; offset < length; offset += chunk) {
+            size_t n = length - offset;
+            record(InputRecordKind::CONFIG, buffer + offset, (uint8_t)(n < chunk ? n : chunk));
+        }
+        record(InputRecordKind::CONFIG, nullptr, 0);
+        return length;
+    }
+    if (mode != InputTraceMode::REPLAY) {
+        return length;
+    }
+
+    const uint8_t* payload;
+    uint8_t n;
+    length = 0;
+    while (peek(InputRecordKind::CONFIG, payload, n)) {
+        consume();
+        if (n == 0) {
+            return length;
+        }
+        size_t copy = length + n <= capacity ? n : capacity - length;
+        memcpy(buffer + length, payload, copy);
+        length += copy;
+    }
+    stats.mismatches++;
+    return length;
+}
+
+bool InputTrace::traceLink(bool connected) {
+    if (mode == InputTraceMode::RECORD) {
+        // 只记录状态变化
+        if (connected != linkState) {
+            linkState = connected;
+            uint8_t value = connected ? 1 : 0;
+            record(InputRecordKind::LINK, &value, 1);
+        }
+        return connected;
+    }
+    if (mode != InputTraceMode::REPLAY) {
+        return connected;
+    }
+
+    const uint8_t* payload;
+    uint8_t length;
+    if (peek(InputRecordKind::LINK, payload, length) && length >= 1) {
+        linkState = payload[0] != 0;
+        consume();
+    }
+    return linkState;
+}
+
+void InputTrace::recordMessage(const char* topic, const uint8_t* payload, unsigned int length) {
+    if (mode != InputTraceMode::RECORD) {
+        return;
+    }
+
+    record(InputRecordKind::MQTT_TOPIC, topic, (uint8_t)strnlen(topic, INPUT_RECORD_MAX - 1));
+
+    const uint8_t chunk = INPUT_RECORD_MAX - 1;
+    for (unsigned int offset = 0; offset < length; offset += chunk) {
+        unsigned int n = length - offset;
+        record(InputRecordKind::MQTT_DATA, payload + offset, (uint8_t)(n < chunk ? n : chunk));
+    }
+    record(InputRecordKind::MQTT_END, nullptr, 0);
+}
+
+bool InputTrace::replayMessage(char* topic, size_t topicCapacity,
+                               uint8_t* payload, size_t payloadCapacity, unsigned int& length) {
+    const uint8_t* data;
+    uint8_t n;
+    if (!peek(InputRecordKind::MQTT_TOPIC, data, n)) {
+        return false;
+    }
+
+    size_t topicLength = n < topicCapacity - 1 ? n : topicCapacity - 1;
+    memcpy(topic, data, topicLength);
+    topic[topicLength] = '\0';
+    consume();
+
+    length = 0;
+    while (peek(InputRecordKind::MQTT_DATA, data, n)) {
+        size_t copy = length + n <= payloadCapacity ? n : payloadCapacity - length;
+        memcpy(payload + length, data, copy);
+        length += copy;
+        consume();
+    }
+
+    if (peek(InputRecordKind::MQTT_END, data, n)) {
+        consume();
+    } else {
+        stats.mismatches++;
+    }
+    return true;
+}
+
+bool InputTrace::traceWeather(bool updated, WeatherData& weather) {
+    // [是否更新][code][type][temperature][tempMax][tempMin][updateTime u32][isValid]
+    if (mode == InputTraceMode::RECORD) {
+        uint8_t value[11];
+        value[0] = updated ? 1 : 0;
+        value[1] = weather.code;
+        value[2] = (uint8_t)weather.type;
+        value[3] = (uint8_t)weather.temperature;
+        value[4] = (uint8_t)weather.tempMax;
+        value[5] = (uint8_t)weather.tempMin;
+        putU32(value + 6, weather.updateTime);
+        value[10] = weather.isValid ? 1 : 0;
+        record(InputRecordKind::WEATHER, value, sizeof(value));
+        return updated;
+    }
+    if (mode != InputTraceMode::REPLAY) {
+        return updated;
+    }
+
+    const uint8_t* payload;
+    uint8_t length;
+    if (!peek(InputRecordKind::WEATHER, payload, length) || length < 11) {
+        stats.mismatches++;
+        return false;
+    }
+
+    weather.code = payload[1];
+    weather.type = (WeatherType)payload[2];
+    weather.temperature = (int8_t)payload[3];
+    weather.tempMax = (int8_t)payload[4];
+    weather.tempMin = (int8_t)payload[5];
+    weather.updateTime = getU32(payload + 6);
+    weather.isValid = payload[10] != 0;
+    consume();
+    return payload[0] != 0;
+}
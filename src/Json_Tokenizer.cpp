@@ -0,0 +1,357 @@
+#include "Json_Tokenizer.h"
+
+/**
+ * 分词器状态：下一个非空白字符应当是什么
+ */
+enum class JsonExpect : uint8_t {
+    VALUE,
+    VALUE_OR_END,       // 数组刚开始：值或 ']'
+    KEY,
+    KEY_OR_END,         // 对象刚开始：键或 '}'
+    COLON,
+    COMMA_OR_END,
+    DONE                // 顶层值已结束，只允许空白
+};
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool isHex(char c) {
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool isDelimiter(char c) {
+    return isSpace(c) || c == ',' || c == ']' || c == '}';
+}
+
+/**
+ * 扫描字符串（pos 指向开头的引号），成功时 pos 指向结尾的引号
+ */
+static JsonError scanString(const char* json, size_t length, size_t& pos) {
+    for (size_t i = pos + 1; i < length; i++) {
+        char c = json[i];
+        if (c == '"') {
+            pos = i;
+            return JsonError::NONE;
+        }
+        if ((uint8_t)c < 0x20) {
+            return JsonError::INVALID;
+        }
+        if (c == '\\') {
+            if (++i >= length) {
+                return JsonError::PARTIAL;
+            }
+            switch (json[i]) {
+                case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                    break;
+                case 'u':
+                    for (uint8_t k = 0; k < 4; k++) {
+                        if (++i >= length) {
+                            return JsonError::PARTIAL;
+                        }
+                        if (!isHex(json[i])) {
+                            return JsonError::INVALID;
+                        }
+                    }
+                    break;
+                default:
+                    return JsonError::INVALID;
+            }
+        }
+    }
+    return JsonError::PARTIAL;
+}
+
+/**
+ * 检查 true/false/null 或数字 -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+ */
+static bool validPrimitive(const char* p, size_t n) {
+    if (p[0] == 't') return n == 4 && memcmp(p, "true", 4) == 0;
+    if (p[0] == 'f') return n == 5 && memcmp(p, "false", 5) == 0;
+    if (p[0] == 'n') return n == 4 && memcmp(p, "null", 4) == 0;
+
+    size_t i = 0;
+    if (p[i] == '-') i++;
+    if (i >= n || !isDigit(p[i])) return false;
+    if (p[i] == '0') {
+        i++;
+    } else {
+        while (i < n && isDigit(p[i])) i++;
+    }
+    if (i < n && p[i] == '.') {
+        i++;
+        if (i >= n || !isDigit(p[i])) return false;
+        while (i < n && isDigit(p[i])) i++;
+    }
+    if (i < n && (p[i] == 'e' || p[i] == 'E')) {
+        i++;
+        if (i < n && (p[i] == '+' || p[i] == '-')) i++;
+        if (i >= n || !isDigit(p[i])) return false;
+        while (i < n && isDigit(p[i])) i++;
+    }
+    return i == n;
+}
+
+JsonError jsonTokenize(const char* json, size_t length, JsonToken* tokens, uint16_t capacity,
+                       uint16_t& count) {
+    uint16_t stack[JSON_MAX_DEPTH];     // 尚未闭合的对象/数组
+    uint8_t depth = 0;
+    JsonExpect expect = JsonExpect::VALUE;
+    count = 0;
+
+    if (length > 0xFFFF) {
+        return JsonError::INVALID;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        char c = json[i];
+        if (isSpace(c)) {
+            continue;
+        }
+
+        JsonToken* parent = depth > 0 ? &tokens[stack[depth - 1]] : nullptr;
+        bool valueDone = false;
+
+        switch (expect) {
+            case JsonExpect::DONE:
+                return JsonError::INVALID;
+
+            case JsonExpect::COLON:
+                if (c != ':') {
+                    return JsonError::INVALID;
+                }
+                expect = JsonExpect::VALUE;
+                continue;
+
+            case JsonExpect::COMMA_OR_END:
+                if (c == ',') {
+                    expect = parent->type == JsonType::OBJECT ? JsonExpect::KEY : JsonExpect::VALUE;
+                    continue;
+                }
+                break;  // 闭合括号在下面统一处理
+
+            case JsonExpect::KEY:
+            case JsonExpect::KEY_OR_END:
+                if (c == '"') {
+                    if (count >= capacity) {
+                        return JsonError::NO_MEMORY;
+                    }
+                    size_t end = i;
+                    JsonError error = scanString(json, length, end);
+                    if (error != JsonError::NONE) {
+                        return error;
+                    }
+                    tokens[count] = {JsonType::STRING, (uint16_t)(i + 1), (uint16_t)(end - i - 1), 0,
+                                     (uint16_t)(count + 1)};
+                    count++;
+                    parent->size++;
+                    i = end;
+                    expect = JsonExpect::COLON;
+                    continue;
+                }
+                if (expect == JsonExpect::KEY) {
+                    return JsonError::INVALID;
+                }
+                break;
+
+            case JsonExpect::VALUE:
+            case JsonExpect::VALUE_OR_END:
+                if (c == ']' || c == '}') {
+                    if (expect == JsonExpect::VALUE) {
+                        return JsonError::INVALID;
+                    }
+                    break;
+                }
+                if (c == ':' || c == ',') {
+                    return JsonError::INVALID;
+                }
+                if (count >= capacity) {
+                    return JsonError::NO_MEMORY;
+                }
+                if (parent != nullptr && parent->type == JsonType::ARRAY) {
+                    parent->size++;
+                }
+
+                if (c == '{' || c == '[') {
+                    if (depth >= JSON_MAX_DEPTH) {
+                        return JsonError::TOO_DEEP;
+                    }
+                    tokens[count] = {c == '{' ? JsonType::OBJECT : JsonType::ARRAY, (uint16_t)i, 0, 0, 0};
+                    stack[depth++] = count++;
+                    expect = c == '{' ? JsonExpect::KEY_OR_END : JsonExpect::VALUE_OR_END;
+                    continue;
+                }
+
+                if (c == '"') {
+                    size_t end = i;
+                    JsonError error = scanString(json, length, end);
+                    if (error != JsonError::NONE) {
+                        return error;
+                    }
+                    tokens[count] = {JsonType::STRING, (uint16_t)(i + 1), (uint16_t)(end - i - 1), 0,
+                                     (uint16_t)(count + 1)};
+                    i = end;
+                } else {
+                    size_t end = i;
+                    while (end < length && !isDelimiter(json[end])) {
+                        end++;
+                    }
+                    if (end == length && depth > 0) {
+                        return JsonError::PARTIAL;
+                    }
+                    if (!validPrimitive(json + i, end - i)) {
+                        return JsonError::INVALID;
+                    }
+                    tokens[count] = {JsonType::PRIMITIVE, (uint16_t)i, (uint16_t)(end - i), 0,
+                                     (uint16_t)(count + 1)};
+                    i = end - 1;
+                }
+                count++;
+                valueDone = true;
+                break;
+        }
+
+        if (!valueDone) {
+            // 闭合括号：必须与最内层容器匹配
+            if (parent == nullptr ||
+                (c == '}' && parent->type != JsonType::OBJECT) ||
+                (c == ']' && parent->type != JsonType::ARRAY) ||
+                (c != '}' && c != ']')) {
+                return JsonError::INVALID;
+            }
+            parent->length = (uint16_t)(i + 1 - parent->start);
+            parent->next = count;
+            depth--;
+        }
+        expect = depth > 0 ? JsonExpect::COMMA_OR_END : JsonExpect::DONE;
+    }
+
+    if (expect != JsonExpect::DONE) {
+        return count == 0 && depth == 0 ? JsonError::INVALID : JsonError::PARTIAL;
+    }
+    return JsonError::NONE;
+}
+
+int16_t jsonFind(const char* json, const JsonToken* tokens, uint16_t object, const char* key) {
+    if (tokens[object].type != JsonType::OBJECT) {
+        return -1;
+    }
+    uint16_t k = object + 1;
+    for (uint16_t n = 0; n < tokens[object].size; n++) {
+        if (jsonEquals(json, tokens[k], key)) {
+            return (int16_t)(k + 1);
+        }
+        k = tokens[k + 1].next;
+    }
+    return -1;
+}
+
+bool jsonEquals(const char* json, const JsonToken& token, const char* text) {
+    return token.type == JsonType::STRING &&
+           strncmp(json + token.start, text, token.length) == 0 && text[token.length] == '\0';
+}
+
+bool jsonToInt(const char* json, const JsonToken& token, int32_t& value) {
+    if (token.type != JsonType::PRIMITIVE) {
+        return false;
+    }
+    const char* p = json + token.start;
+    uint16_t i = (p[0] == '-') ? 1 : 0;
+    if (i >= token.length) {
+        return false;
+    }
+
+    int64_t v = 0;
+    for (; i < token.length; i++) {
+        if (!isDigit(p[i])) {
+            return false;
+        }
+        v = v * 10 + (p[i] - '0');
+        if (v > 0x80000000LL) {
+            return false;
+        }
+    }
+    if (p[0] == '-') {
+        v = -v;
+    }
+    if (v > INT32_MAX) {
+        return false;
+    }
+    value = (int32_t)v;
+    return true;
+}
+
+bool jsonToFixed(const char* json, const JsonToken& token, uint8_t decimals, int32_t& value) {
+    if (token.type != JsonType::PRIMITIVE) {
+        return false;
+    }
+    const char* p = json + token.start;
+    uint16_t i = (p[0] == '-') ? 1 : 0;
+    if (i >= token.length || !isDigit(p[i])) {
+        return false;
+    }
+
+    int64_t v = 0;
+    for (; i < token.length && isDigit(p[i]); i++) {
+        v = v * 10 + (p[i] - '0');
+        if (v > 0x80000000LL) {
+            return false;
+        }
+    }
+
+    uint8_t fraction = 0;
+    bool roundUp = false;
+    if (i < token.length && p[i] == '.') {
+        for (i++; i < token.length && isDigit(p[i]); i++) {
+            if (fraction < decimals) {
+                v = v * 10 + (p[i] - '0');
+                fraction++;
+                if (v > 0x80000000LL) {
+                    return false;
+                }
+            } else if (fraction == decimals) {
+                roundUp = p[i] >= '5';      // 只看第一位多余的小数
+                fraction++;
+            }
+        }
+    }
+    if (i != token.length) {
+        return false;       // 指数或 true/false/null
+    }
+    for (; fraction < decimals; fraction++) {
+        v *= 10;
+        if (v > 0x80000000LL) {
+            return false;
+        }
+    }
+    if (roundUp) {
+        v++;
+    }
+    if (v > 0x80000000LL) {
+        return false;
+    }
+    if (p[0] == '-') {
+        v = -v;
+    }
+    if (v > INT32_MAX) {
+        return false;
+    }
+    value = (int32_t)v;
+    return true;
+}
+
+const char* jsonErrorText(JsonError error) {
+    switch (error) {
+        case JsonError::NONE:      return "ok";
+        case JsonError::NO_MEMORY: return "too_many_tokens";
+        case JsonError::INVALID:   return "invalid";
+        case JsonError::PARTIAL:   return "partial";
+        case JsonError::TOO_DEEP:  return "too_deep";
+    }
+    return "unknown";
+}
@@ -0,0 +1,229 @@
+#include "Json_Writer.h"
+
+int32_t jsonFixedFromFloat(float value, uint8_t decimals) {
+    // 用 double 放大：float 乘 10 的舍入会把 99.95f（实为 99.9499969）进位成 100.0
+    double scaled = value;
+    for (uint8_t i = 0; i < decimals; i++) {
+        scaled *= 10.0;
+    }
+    // 超出 int32 范围时饱和，避免未定义的转换
+    if (scaled >= 2147483647.0) {
+        return INT32_MAX;
+    }
+    if (scaled <= -2147483647.0) {
+        return -INT32_MAX;
+    }
+    return (int32_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+}
+
+/**
+ * 十进制文本：magnitude 为绝对值，末 decimals 位为小数
+ */
+static size_t formatDecimal(uint32_t magnitude, bool negative, uint8_t decimals, char* out) {
+    char digits[JSON_NUMBER_MAX];
+    uint8_t n = 0;
+    if (decimals > 9) {
+        decimals = 9;
+    }
+
+    // 低位在前；至少输出到个位
+    do {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0 || n <= decimals);
+
+    size_t length = 0;
+    if (negative) {
+        out[length++] = '-';
+    }
+    while (n > 0) {
+        out[length++] = digits[--n];
+        if (n == decimals && n > 0) {
+            out[length++] = '.';
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+size_t jsonFormatFixed(int32_t value, uint8_t decimals, char* out) {
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    return formatDecimal(magnitude, value < 0, decimals, out);
+}
+
+JsonWriter::JsonWriter(Print& target)
+    : out(target), written(0), depth(0), hasMember(0), overflow(0), afterKey(false),
+      truncatedOutput(false) {
+}
+
+void JsonWriter::raw(const char* text, size_t length) {
+    if (length > 0 && overflow == 0) {
+        written += out.write((const uint8_t*)text, length);
+    }
+}
+
+void JsonWriter::separator() {
+    if (overflow > 0) {
+        return;
+    }
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (depth > 0) {
+        uint8_t bit = (uint8_t)(1u << (depth - 1));
+        if (hasMember & bit) {
+            raw(",", 1);
+        }
+        hasMember |= bit;
+    }
+}
+
+void JsonWriter::quoted(const char* text) {
+    raw("\"", 1);
+
+    const char* p = text;
+    while (true) {
+        // 不需要转义的连续字符一次写出
+        const char* run = p;
+        while (*p != '\0' && *p != '"' && *p != '\\' && (uint8_t)*p >= 0x20) {
+            p++;
+        }
+        raw(run, p - run);
+        if (*p == '\0') {
+            break;
+        }
+
+        uint8_t c = (uint8_t)*p++;
+        char escape[6] = {'\\', (char)c};
+        size_t length = 2;
+        if (c == '\n') {
+            escape[1] = 'n';
+        } else if (c == '\r') {
+            escape[1] = 'r';
+        } else if (c == '\t') {
+            escape[1] = 't';
+        } else if (c < 0x20) {
+            static const char HEX_DIGITS[] = "0123456789abcdef";
+            escape[1] = 'u';
+            escape[2] = '0';
+            escape[3] = '0';
+            escape[4] = HEX_DIGITS[c >> 4];
+            escape[5] = HEX_DIGITS[c & 0x0F];
+            length = 6;
+        }
+        raw(escape, length);
+    }
+
+    raw("\"", 1);
+}
+
+/**
+ * 进入一层对象/数组；超过 JSON_MAX_NESTING 时写一个 null 占位，
+ * 并丢弃到对应 end 为止的全部内容，输出仍是合法 JSON
+ */
+void JsonWriter::beginNested(char bracket) {
+    separator();
+    if (overflow > 0 || depth >= JSON_MAX_NESTING) {
+        raw("null", 4);
+        overflow++;
+        truncatedOutput = true;
+        return;
+    }
+    raw(&bracket, 1);
+    depth++;
+    hasMember &= (uint8_t)~(1u << (depth - 1));
+}
+
+/**
+ * 离开一层；返回 false 表示这一层是被丢弃的
+ */
+bool JsonWriter::endNested() {
+    if (overflow > 0) {
+        overflow--;
+        return false;
+    }
+    if (depth == 0) {
+        return false;
+    }
+    depth--;
+    return true;
+}
+
+void JsonWriter::beginObject() {
+    beginNested('{');
+}
+
+void JsonWriter::endObject() {
+    if (endNested()) {
+        raw("}", 1);
+    }
+}
+
+void JsonWriter::beginArray() {
+    beginNested('[');
+}
+
+void JsonWriter::endArray() {
+    if (endNested()) {
+        raw("]", 1);
+    }
+}
+
+void JsonWriter::key(const char* name) {
+    if (overflow > 0) {
+        return;
+    }
+    afterKey = false;
+    separator();
+    quoted(name);
+    raw(":", 1);
+    afterKey = true;
+}
+
+void JsonWriter::string(const char* text) {
+    separator();
+    if (text == nullptr) {
+        raw("null", 4);
+        return;
+    }
+    quoted(text);
+}
+
+void JsonWriter::integer(int32_t value) {
+    fixed(value, 0);
+}
+
+void JsonWriter::unsignedInteger(uint32_t value) {
+    separator();
+    char text[JSON_NUMBER_MAX];
+    raw(text, formatDecimal(value, false, 0, text));
+}
+
+void JsonWriter::fixed(int32_t value, uint8_t decimals) {
+    separator();
+    char text[JSON_NUMBER_MAX];
+    raw(text, jsonFormatFixed(value, decimals, text));
+}
+
+void JsonWriter::number(float value, uint8_t decimals) {
+    if (isnan(value) || isinf(value)) {
+        null();
+        return;
+    }
+    fixed(jsonFixedFromFloat(value, decimals), decimals);
+}
+
+void JsonWriter::boolean(bool value) {
+    separator();
+    if (value) {
+        raw("true", 4);
+    } else {
+        raw("false", 5);
+    }
+}
+
+void JsonWriter::null() {
+    separator();
+    raw("null", 4);
+}
@@ -0,0 +1,690 @@
+#include "Kv_Store.h"
+#include "Deferred_Log.h"
+#include "Hardware_Crc.h"
+
+KvStore g_kvStore;
+
+#define KV_REGION_SIZE ((uint32_t)KV_SECTOR_SIZE * KV_SECTOR_COUNT)
+
+static_assert(KV_SECTOR_COUNT >= 2, "KV store needs a spare sector for reclaim");
+static_assert(KV_MAX_KEYS <= 255, "entryCount is 8 bits");
+static_assert(KV_VALUE_MAX < KV_LENGTH_DELETED, "KV_VALUE_MAX collides with KV_LENGTH_DELETED");
+
+// ==================== Flash ====================
+
+#if defined(ARDUINO_ARCH_STM32)
+
+#define KV_FLASH ((const uint8_t*)KV_FLASH_ADDR)
+
+static bool flashErase(uint8_t sector) {
+    FLASH_EraseInitTypeDef erase = {};
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Sector = KV_FLASH_SECTOR + sector;
+    erase.NbSectors = 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+    uint32_t badSector = 0;
+
+    HAL_FLASH_Unlock();
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &badSector);
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
+
+static bool flashProgram(uint32_t offset, uint32_t word) {
+    HAL_FLASH_Unlock();
+    HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, KV_FLASH_ADDR + offset, word);
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
+
+static uint32_t flashClock() {
+    return micros();
+}
+
+#else
+
+// ==================== 主机 Flash 模型 ====================
+
+// STM32F407 数据手册典型值（x32 编程并行度）
+#define KV_HOST_PROGRAM_US  16
+#define KV_HOST_ERASE_US    1000000UL   // 128KB 扇区
+
+static uint8_t hostFlash[KV_REGION_SIZE];
+static bool hostFlashReady = false;
+
+static uint32_t hostMicros = 0;         // 模型累计耗时
+static uint32_t hostCarry = 0;          // 尚未计入 millis() 的微秒数
+static uint32_t hostCutAfter = 0;       // 还剩几次操作断电，0 表示不断电
+static bool hostCut = false;
+static uint32_t hostSeed = 1;
+
+#define KV_FLASH ((const uint8_t*)hostFlash)
+
+static uint32_t hostRandom() {
+    hostSeed = hostSeed * 1103515245UL + 12345UL;
+    return (hostSeed >> 16) | (hostSeed << 16);
+}
+
+/**
+ * 计时：耗时同样推迟主机上的 millis()，擦除停顿在仿真中可见
+ */
+static void hostElapse(uint32_t us) {
+    hostMicros += us;
+    hostCarry += us;
+    if (hostCarry >= 1000) {
+        delay(hostCarry / 1000);
+        hostCarry %= 1000;
+    }
+}
+
+/**
+ * 这次操作进行中断电
+ */
+static bool hostTearing() {
+    if (hostCutAfter == 0 || --hostCutAfter != 0) {
+        return false;
+    }
+    hostCut = true;
+    return true;
+}
+
+static bool flashErase(uint8_t sector) {
+    if (hostCut) {
+        return false;
+    }
+    uint8_t* base = hostFlash + (uint32_t)sector * KV_SECTOR_SIZE;
+    if (hostTearing()) {
+        // 擦除未完成：一部分字节已擦除
+        for (uint32_t i = 0; i < KV_SECTOR_SIZE; i++) {
+            if (hostRandom() & 1) {
+                base[i] = 0xFF;
+            }
+        }
+        return false;
+    }
+    memset(base, 0xFF, KV_SECTOR_SIZE);
+    hostElapse(KV_HOST_ERASE_US);
+    return true;
+}
+
+static bool flashProgram(uint32_t offset, uint32_t word) {
+    if (hostCut) {
+        return false;
+    }
+    if (hostTearing()) {
+        word |= hostRandom();       // 编程未完成：一部分应写 0 的位仍为 1
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        hostFlash[offset + i] &= (uint8_t)(word >> (i * 8));
+    }
+    hostElapse(KV_HOST_PROGRAM_US);
+    return !hostCut;
+}
+
+static uint32_t flashClock() {
+    return hostMicros;
+}
+
+void KvStore::hostPowerCut(uint32_t operations, uint32_t seed) {
+    hostCutAfter = operations;
+    hostSeed = seed | 1;
+}
+
+void KvStore::hostPowerOn() {
+    hostCutAfter = 0;
+    hostCut = false;
+}
+
+bool KvStore::hostPoweredOff() {
+    return hostCut;
+}
+
+void KvStore::hostFormat() {
+    memset(hostFlash, 0xFF, sizeof(hostFlash));
+    hostFlashReady = true;
+}
+
+#endif
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t recordSize(uint16_t length) {
+    return KV_RECORD_HEADER + (length == KV_LENGTH_DELETED ? 0 : ((length + 3u) & ~3u));
+}
+
+// 有效数据上限：回收时最旧扇区的有效数据连同一条新记录必须放得进刚打开的扇区
+#define KV_CAPACITY (KV_SECTOR_SIZE - KV_SECTOR_HEADER - recordSize(KV_VALUE_MAX))
+
+static const uint8_t* sectorBase(uint8_t sector) {
+    return KV_FLASH + (uint32_t)sector * KV_SECTOR_SIZE;
+}
+
+static bool headerValid(const uint8_t* base, uint32_t& seq) {
+    seq = getU32(base + 4);
+    return getU32(base) == KV_SECTOR_MAGIC && getU32(base + 8) == ~seq && seq != 0 && seq != 0xFFFFFFFFUL;
+}
+
+static bool sectorBlank(const uint8_t* base) {
+    for (uint32_t i = 0; i < KV_SECTOR_SIZE; i += 4) {
+        if (getU32(base + i) != 0xFFFFFFFFUL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * 记录头部是否可信（长度在范围内且不越过扇区）
+ */
+static bool recordPlausible(const uint8_t* base, uint32_t offset) {
+    uint32_t word = getU32(base + offset);
+    uint16_t key = (uint16_t)word;
+    uint16_t length = (uint16_t)(word >> 16);
+    return key != KV_KEY_NONE && (length <= KV_VALUE_MAX || length == KV_LENGTH_DELETED) &&
+           offset + recordSize(length) <= KV_SECTOR_SIZE;
+}
+
+static bool recordCrcValid(const uint8_t* record) {
+    uint16_t length = (uint16_t)(getU32(record) >> 16);
+    uint32_t crc = hwCrc32(record, 4);
+    if (length != KV_LENGTH_DELETED && length > 0) {
+        crc = hwCrc32Append(record + KV_RECORD_HEADER, length);
+    }
+    return crc == getU32(record + 4);
+}
+
+KvStore::KvStore()
+    : entryCount(0), head(0), writeOffset(0), reclaimSector(-1), reclaimOffset(0), liveBytes(0),
+      eraseHandler(nullptr) {
+    memset(entries, 0, sizeof(entries));
+    memset(sectorSeq, 0, sizeof(sectorSeq));
+    memset(sectorDirty, 0, sizeof(sectorDirty));
+    memset(&stats, 0, sizeof(stats));
+}
+
+// ==================== 启动扫描 ====================
+
+void KvStore::begin() {
+#if !defined(ARDUINO_ARCH_STM32)
+    if (!hostFlashReady) {
+        hostFormat();
+    }
+#endif
+    unsigned long start = micros();
+    entryCount = 0;
+    liveBytes = 0;
+    reclaimSector = -1;
+    memset(&stats, 0, sizeof(stats));
+
+    uint8_t order[KV_SECTOR_COUNT];
+    uint8_t used = 0;
+    for (uint8_t i = 0; i < KV_SECTOR_COUNT; i++) {
+        uint32_t seq;
+        if (headerValid(sectorBase(i), seq)) {
+            sectorSeq[i] = seq;
+            sectorDirty[i] = false;
+            // 按序号插入
+            uint8_t k = used++;
+            while (k > 0 && sectorSeq[order[k - 1]] > seq) {
+                order[k] = order[k - 1];
+                k--;
+            }
+            order[k] = i;
+        } else {
+            // 没有有效扇区头：空扇区，或擦除/打开中途断电
+            sectorSeq[i] = 0;
+            sectorDirty[i] = !sectorBlank(sectorBase(i));
+        }
+    }
+
+    // 按扇区先后重放全部记录，最后一个扇区是当前扇区
+    for (uint8_t n = 0; n < used; n++) {
+        scanSector(order[n]);
+    }
+    if (used > 0) {
+        head = order[used - 1];
+        stats.headSeq = sectorSeq[head];
+    } else {
+        writeOffset = KV_SECTOR_SIZE;
+    }
+
+    // 没有空扇区：继续上次未完成的回收
+    if (used == KV_SECTOR_COUNT) {
+        reclaimSector = (int8_t)order[0];
+        reclaimOffset = KV_SECTOR_HEADER;
+    }
+
+    stats.bootMicros = micros() - start;
+    LOG_INFO("[KV] %d keys, %lu bytes live, sector %d seq %lu, %u corrupt records skipped",
+             entryCount, (unsigned long)liveBytes, head, (unsigned long)stats.headSeq, stats.corruptRecords);
+}
+
+/**
+ * 从 offset 起找下一条 CRC 正确的记录
+ * @param offset 输入为起点；找到时为该记录的偏移，否则为日志末尾（第一个可写入的位置）
+ * @return false 已到日志末尾
+ */
+bool KvStore::nextRecord(uint8_t sector, uint32_t& offset, bool countCorrupt) {
+    const uint8_t* base = sectorBase(sector);
+    while (offset + KV_RECORD_HEADER <= KV_SECTOR_SIZE) {
+        uint32_t word = getU32(base + offset);
+        if (word == 0xFFFFFFFFUL) {
+            return false;
+        }
+        bool plausible = recordPlausible(base, offset);
+        if (plausible && recordCrcValid(base + offset)) {
+            return true;
+        }
+        if (countCorrupt) {
+            stats.corruptRecords++;
+        }
+        if (plausible) {
+            // 写到一半断电的记录：按长度跳过
+            offset += recordSize((uint16_t)(word >> 16));
+            continue;
+        }
+
+        // 长度本身损坏：逐字向后找下一条有效记录；找不到时从最后一个非空字之后接着写
+        uint32_t last = offset;
+        for (uint32_t o = offset + 4; o + KV_RECORD_HEADER <= KV_SECTOR_SIZE; o += 4) {
+            if (getU32(base + o) == 0xFFFFFFFFUL) {
+                continue;
+            }
+            if (recordPlausible(base, o) && recordCrcValid(base + o)) {
+                offset = o;
+                return true;
+            }
+            last = o;
+        }
+        offset = last + 4;
+        return false;
+    }
+    offset = KV_SECTOR_SIZE;
+    return false;
+}
+
+void KvStore::scanSector(uint8_t sector) {
+    const uint8_t* base = sectorBase(sector);
+    uint32_t offset = KV_SECTOR_HEADER;
+    while (nextRecord(sector, offset, true)) {
+        uint32_t word = getU32(base + offset);
+        applyRecord((uint16_t)word, (uint16_t)(word >> 16), (uint32_t)sector * KV_SECTOR_SIZE + offset);
+        stats.recordsScanned++;
+        offset += recordSize((uint16_t)(word >> 16));
+    }
+    writeOffset = offset;
+}
+
+void KvStore::applyRecord(uint16_t key, uint16_t length, uint32_t offset) {
+    Entry* entry = findEntry(key);
+    if (entry != nullptr) {
+        liveBytes -= recordSize(entry->length);
+    }
+    if (length == KV_LENGTH_DELETED) {
+        if (entry != nullptr) {
+            *entry = entries[--entryCount];
+        }
+        return;
+    }
+    if (entry == nullptr) {
+        if (entryCount >= KV_MAX_KEYS) {
+            LOG_ERROR("[KV] Index full, key %u dropped", key);
+            return;
+        }
+        entry = &entries[entryCount++];
+        entry->key = key;
+    }
+    entry->length = length;
+    entry->offset = offset;
+    liveBytes += recordSize(length);
+}
+
+KvStore::Entry* KvStore::findEntry(uint16_t key) {
+    for (uint8_t i = 0; i < entryCount; i++) {
+        if (entries[i].key == key) {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+const KvStore::Entry* KvStore::findEntry(uint16_t key) const {
+    for (uint8_t i = 0; i < entryCount; i++) {
+        if (entries[i].key == key) {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+// ==================== 写入 ====================
+
+bool KvStore::eraseSector(uint8_t sector) {
+    if (eraseHandler != nullptr) {
+        eraseHandler(sectorBase(sector), sectorBase(sector) + KV_SECTOR_SIZE);
+    }
+    LOG_INFO("[KV] Erasing sector %d", sector);
+    // 先作废扇区头：擦除中途断电时，残留的旧记录不会随扇区头一起被当作有效数据读出
+    if (sectorSeq[sector] != 0 && !programWord((uint32_t)sector * KV_SECTOR_SIZE, 0)) {
+        LOG_ERROR("[KV] Invalidate of sector %d failed", sector);
+        return false;
+    }
+    uint32_t start = flashClock();
+    bool ok = flashErase(sector);
+    stats.flashMicros += flashClock() - start;
+    if (!ok) {
+        LOG_ERROR("[KV] Erase of sector %d failed", sector);
+        sectorDirty[sector] = true;
+        return false;
+    }
+    stats.erases++;
+    sectorSeq[sector] = 0;
+    sectorDirty[sector] = false;
+    return true;
+}
+
+bool KvStore::programWord(uint32_t offset, uint32_t word) {
+    uint32_t start = flashClock();
+    bool ok = flashProgram(offset, word);
+    stats.flashMicros += flashClock() - start;
+    stats.wordsProgrammed++;
+    return ok;
+}
+
+/**
+ * 打开当前扇区之后的第一个空扇区；打开后没有空扇区时开始回收最旧的扇区
+ */
+bool KvStore::openSector() {
+    int8_t target = -1;
+    for (uint8_t n = 1; n <= KV_SECTOR_COUNT; n++) {
+        uint8_t sector = (uint8_t)((head + n) % KV_SECTOR_COUNT);
+        if (sectorSeq[sector] == 0) {
+            target = (int8_t)sector;
+            break;
+        }
+    }
+    if (target < 0) {
+        return false;
+    }
+    if (sectorDirty[target] && !eraseSector((uint8_t)target)) {
+        return false;
+    }
+
+    uint32_t seq = stats.headSeq + 1;
+    uint32_t offset = (uint32_t)target * KV_SECTOR_SIZE;
+    // 启动时按完整的扇区头判断，打开中途断电的扇区会被重新擦除
+    if (!programWord(offset, KV_SECTOR_MAGIC) || !programWord(offset + 4, seq) ||
+        !programWord(offset + 8, ~seq)) {
+        sectorDirty[target] = true;
+        return false;
+    }
+    sectorSeq[target] = seq;
+    head = (uint8_t)target;
+    writeOffset = KV_SECTOR_HEADER;
+    stats.headSeq = seq;
+
+    bool spare = false;
+    int8_t oldest = -1;
+    for (uint8_t i = 0; i < KV_SECTOR_COUNT; i++) {
+        if (sectorSeq[i] == 0) {
+            spare = true;
+        } else if (i != head && (oldest < 0 || sectorSeq[i] < sectorSeq[oldest])) {
+            oldest = (int8_t)i;
+        }
+    }
+    if (!spare && oldest >= 0 && reclaimSector < 0) {
+        reclaimSector = oldest;
+        reclaimOffset = KV_SECTOR_HEADER;
+        LOG_INFO("[KV] Reclaiming sector %d (%lu bytes to copy)", oldest, (unsigned long)pendingCopyBytes());
+    }
+    return true;
+}
+
+/**
+ * 回收中的扇区里仍是最新的记录（尚待复制）的字节数
+ */
+uint32_t KvStore::pendingCopyBytes() const {
+    if (reclaimSector < 0) {
+        return 0;
+    }
+    uint32_t begin = (uint32_t)reclaimSector * KV_SECTOR_SIZE;
+    uint32_t bytes = 0;
+    for (uint8_t i = 0; i < entryCount; i++) {
+        if (entries[i].offset >= begin && entries[i].offset < begin + KV_SECTOR_SIZE) {
+            bytes += recordSize(entries[i].length);
+        }
+    }
+    return bytes;
+}
+
+/**
+ * 复制回收扇区中的有效记录，最多 budget 字
+ * @return false Flash 错误
+ */
+bool KvStore::reclaimStep(uint32_t budget) {
+    uint8_t sector = (uint8_t)reclaimSector;
+    const uint8_t* base = sectorBase(sector);
+    uint32_t copied = 0;
+    while (copied < budget) {
+        if (!nextRecord(sector, reclaimOffset, false)) {
+            reclaimOffset = KV_SECTOR_SIZE;     // 复制完，等待擦除
+            break;
+        }
+        uint32_t word = getU32(base + reclaimOffset);
+        uint16_t length = (uint16_t)(word >> 16);
+        uint32_t size = recordSize(length);
+        uint32_t from = (uint32_t)sector * KV_SECTOR_SIZE + reclaimOffset;
+        Entry* entry = findEntry((uint16_t)word);
+        reclaimOffset += size;
+
+        // 被覆盖的旧值与删除标记都不再需要（回收的是最旧的扇区，之前没有别的记录）
+        if (entry == nullptr || entry->offset != from) {
+            continue;
+        }
+        // 原样复制（键、长度、值都相同，CRC 也相同）
+        // 失败时退回到这条记录：entry 仍指向被回收的扇区，下次重新复制，复制完之前不擦除；
+        // 写了一半的副本留在原处（启动扫描按 CRC 跳过），写入位置不回退
+        if (writeOffset + size > KV_SECTOR_SIZE) {
+            LOG_ERROR("[KV] No room to copy key %u", entry->key);
+            reclaimOffset -= size;
+            return false;
+        }
+        uint32_t to = (uint32_t)head * KV_SECTOR_SIZE + writeOffset;
+        writeOffset += size;
+        for (uint32_t i = 0; i < size; i += 4) {
+            if (!programWord(to + i, getU32(base + reclaimOffset - size + i))) {
+                LOG_ERROR("[KV] Copy failed at %lu", (unsigned long)(to + i));
+                reclaimOffset -= size;
+                return false;
+            }
+        }
+        if (memcmp(KV_FLASH + to, base + reclaimOffset - size, size) != 0) {
+            LOG_ERROR("[KV] Copy verify failed at %lu", (unsigned long)to);
+            reclaimOffset -= size;
+            return false;
+        }
+        entry->offset = to;
+        stats.wordsCopied += size / 4;
+        copied += size / 4;
+    }
+    return true;
+}
+
+/**
+ * 确保当前扇区能再写入 size 字节，且不占用回收复制需要的空间
+ * 只打开已擦除的空扇区；回收的复制或擦除没完成时返回 BUSY，留给 update(true)
+ */
+KvResult KvStore::makeRoom(uint32_t size) {
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+        uint32_t free = KV_SECTOR_SIZE - writeOffset;
+        // 回收进行中另留一条最大记录的余量：复制失败时写了一半的副本不回收，重试要用新的空间
+        uint32_t reserved = pendingCopyBytes();
+        if (reserved > 0) {
+            reserved += recordSize(KV_VALUE_MAX);
+        }
+        if (free >= size + reserved) {
+            return KvResult::OK;
+        }
+        if (reclaimSector >= 0) {
+            return KvResult::BUSY;
+        }
+        for (uint8_t i = 0; i < KV_SECTOR_COUNT; i++) {
+            if (sectorDirty[i]) {
+                return KvResult::BUSY;
+            }
+        }
+        if (!openSector()) {
+            return KvResult::FLASH_ERROR;
+        }
+    }
+    return KvResult::BUSY;
+}
+
+/**
+ * 追加一条记录
+ * @param offset 成功时为记录在区域中的偏移
+ */
+KvResult KvStore::append(uint16_t key, const uint8_t* value, uint16_t length, uint32_t& offset) {
+    uint32_t size = recordSize(length);
+    KvResult room = makeRoom(size);
+    if (room != KvResult::OK) {
+        return room;
+    }
+
+    uint32_t header = (uint32_t)key | ((uint32_t)length << 16);
+    uint8_t headerBytes[4] = {(uint8_t)header, (uint8_t)(header >> 8), (uint8_t)(header >> 16),
+                              (uint8_t)(header >> 24)};
+    uint32_t crc = hwCrc32(headerBytes, 4);
+    uint16_t valueLength = length == KV_LENGTH_DELETED ? 0 : length;
+    if (valueLength > 0) {
+        crc = hwCrc32Append(value, valueLength);
+    }
+
+    offset = (uint32_t)head * KV_SECTOR_SIZE + writeOffset;
+    // 按地址顺序编程；失败时这段空间也不再使用，启动时按长度跳过
+    writeOffset += size;
+    if (!programWord(offset, header) || !programWord(offset + 4, crc)) {
+        return KvResult::FLASH_ERROR;
+    }
+    for (uint16_t i = 0; i < valueLength; i += 4) {
+        uint8_t word[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+        memcpy(word, value + i, valueLength - i < 4 ? valueLength - i : 4);
+        if (!programWord(offset + KV_RECORD_HEADER + i, getU32(word))) {
+            return KvResult::FLASH_ERROR;
+        }
+    }
+    bool verified = getU32(KV_FLASH + offset) == header && getU32(KV_FLASH + offset + 4) == crc &&
+                    (valueLength == 0 || memcmp(KV_FLASH + offset + KV_RECORD_HEADER, value, valueLength) == 0);
+    return verified ? KvResult::OK : KvResult::FLASH_ERROR;
+}
+
+void KvStore::finishStall(uint32_t start) {
+    uint32_t stall = flashClock() - start;
+    if (stall > stats.maxStallMicros) {
+        stats.maxStallMicros = stall;
+    }
+}
+
+void KvStore::reportFailure(uint16_t key, KvResult result) {
+    if (result == KvResult::BUSY) {
+        stats.busy++;
+        LOG_DEBUG("[KV] Key %u deferred: reclaim pending", key);
+    } else {
+        LOG_ERROR("[KV] Write of key %u failed: %s", key, resultText(result));
+    }
+}
+
+const uint8_t* KvStore::find(uint16_t key, size_t& length) const {
+    const Entry* entry = findEntry(key);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    length = entry->length;
+    return KV_FLASH + entry->offset + KV_RECORD_HEADER;
+}
+
+KvResult KvStore::put(uint16_t key, const void* value, size_t length) {
+    if (length > KV_VALUE_MAX) {
+        return KvResult::TOO_LARGE;
+    }
+    Entry* entry = findEntry(key);
+    if (entry != nullptr && entry->length == length && length > 0 &&
+        memcmp(KV_FLASH + entry->offset + KV_RECORD_HEADER, value, length) == 0) {
+        return KvResult::OK;
+    }
+    uint32_t live = liveBytes - (entry != nullptr ? recordSize(entry->length) : 0) + recordSize((uint16_t)length);
+    if (live > KV_CAPACITY || (entry == nullptr && entryCount >= KV_MAX_KEYS) || key == KV_KEY_NONE) {
+        return KvResult::FULL;
+    }
+
+    uint32_t start = flashClock();
+    uint32_t offset;
+    KvResult result = append(key, (const uint8_t*)value, (uint16_t)length, offset);
+    finishStall(start);
+    if (result != KvResult::OK) {
+        reportFailure(key, result);
+        return result;
+    }
+    applyRecord(key, (uint16_t)length, offset);
+    return KvResult::OK;
+}
+
+KvResult KvStore::remove(uint16_t key) {
+    if (findEntry(key) == nullptr) {
+        return KvResult::NOT_FOUND;
+    }
+    uint32_t start = flashClock();
+    uint32_t offset;
+    KvResult result = append(key, nullptr, KV_LENGTH_DELETED, offset);
+    finishStall(start);
+    if (result != KvResult::OK) {
+        reportFailure(key, result);
+        return result;
+    }
+    applyRecord(key, KV_LENGTH_DELETED, offset);
+    return KvResult::OK;
+}
+
+// ==================== 后台回收 ====================
+
+void KvStore::update(bool idle) {
+    if (!idle) {
+        return;
+    }
+    if (reclaimSector >= 0) {
+        if (reclaimOffset < KV_SECTOR_SIZE) {
+            if (!reclaimStep(KV_RECLAIM_WORDS)) {
+                stats.copyFailures++;
+            }
+        } else if (pendingCopyBytes() > 0) {
+            // 仍有键指向这个扇区：不擦除，从头再扫一遍复制
+            LOG_ERROR("[KV] Sector %d still holds live records, rescanning", reclaimSector);
+            reclaimOffset = KV_SECTOR_HEADER;
+        } else if (eraseSector((uint8_t)reclaimSector)) {
+            reclaimSector = -1;
+            stats.reclaims++;
+        }
+        return;
+    }
+    // 断电留下的未擦完的扇区
+    for (uint8_t i = 0; i < KV_SECTOR_COUNT; i++) {
+        if (sectorDirty[i]) {
+            eraseSector(i);
+            return;
+        }
+    }
+}
+
+const char* KvStore::resultText(KvResult result) {
+    switch (result) {
+        case KvResult::OK:          return "ok";
+        case KvResult::NOT_FOUND:   return "not_found";
+        case KvResult::TOO_LARGE:   return "too_large";
+        case KvResult::FULL:        return "full";
+        case KvResult::BUSY:        return "busy";
+        case KvResult::FLASH_ERROR: return "flash_error";
+    }
+    return "unknown";
+}
@@ -0,0 +1,195 @@
+#include "Latency_Trace.h"
+
+LatencyTracer g_latencyTracer;
+
+// 按 VoiceCommand 顺序
+static const char* const TRACE_COMMAND_NAMES[TRACE_COMMAND_COUNT] = {
+    "unknown", "happy", "sad", "angry", "sleepy", "surprised",
+    "shake", "nod", "weather", "temp", "help"
+};
+
+// 按 TraceHop 顺序
+static const char* const TRACE_HOP_NAMES[TRACE_HOP_COUNT] = {
+    "uart_rx", "match", "fsm", "servo", "oled"
+};
+
+static uint8_t bucketOf(uint32_t us) {
+    if (us < 4) {
+        return (uint8_t)us;
+    }
+    uint8_t msb = 31 - __builtin_clz(us);
+    uint8_t sub = (us >> (msb - 2)) & 3;
+    uint16_t bucket = (msb - 1) * 4 + sub;
+    return bucket < LATENCY_HISTOGRAM_BUCKETS ? bucket : LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+static uint32_t bucketUpperBound(uint8_t bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    uint8_t msb = bucket / 4 + 1;
+    uint8_t sub = bucket % 4;
+    return ((uint32_t)(5 + sub) << (msb - 2)) - 1;
+}
+
+void LatencyHistogram::record(uint32_t us) {
+    uint8_t b = bucketOf(us);
+    if (buckets[b] < 0xFFFF) {
+        buckets[b]++;
+    }
+    count++;
+    if (us > maxUs) {
+        maxUs = us;
+    }
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t p) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    uint32_t target = (count * p + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < LATENCY_HISTOGRAM_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= target) {
+            uint32_t upper = bucketUpperBound(b);
+            return upper < maxUs ? upper : maxUs;
+        }
+    }
+    return maxUs;
+}
+
+LatencyTracer::LatencyTracer()
+    : stampedMask(0), activeCommand(VoiceCommand::UNKNOWN), active(false),
+      cyclesPerMicro(1) {
+    reset();
+}
+
+void LatencyTracer::begin() {
+#if defined(ARDUINO_ARCH_STM32)
+    // 使能 DWT 周期计数器
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    cyclesPerMicro = SystemCoreClock / 1000000;
+#else
+    cyclesPerMicro = 1;
+#endif
+}
+
+uint32_t LatencyTracer::now() {
+#if defined(ARDUINO_ARCH_STM32)
+    return DWT->CYCCNT;
+#else
+    return micros();
+#endif
+}
+
+void LatencyTracer::reset() {
+    memset(commandHistograms, 0, sizeof(commandHistograms));
+    memset(hopHistograms, 0, sizeof(hopHistograms));
+    memset(stamps, 0, sizeof(stamps));
+    stampedMask = 0;
+    active = false;
+}
+
+void LatencyTracer::beginTrace(VoiceCommand cmd, uint32_t rxCycles, uint32_t matchCycles) {
+    noInterrupts();
+    finish();
+
+    activeCommand = cmd;
+    active = true;
+    stampedMask = 0;
+    stamps[(uint8_t)TraceHop::UART_RX] = rxCycles;
+    stamps[(uint8_t)TraceHop::KEYWORD_MATCH] = matchCycles;
+    stampedMask = (1 << (uint8_t)TraceHop::UART_RX) | (1 << (uint8_t)TraceHop::KEYWORD_MATCH);
+    stamp(TraceHop::FSM_DISPATCH);
+    interrupts();
+}
+
+void LatencyTracer::endTrace() {
+    noInterrupts();
+    finish();
+    interrupts();
+}
+
+void LatencyTracer::finish() {
+    if (!active) {
+        return;
+    }
+    active = false;
+
+    uint32_t start = stamps[(uint8_t)TraceHop::UART_RX];
+    uint32_t total = 0;
+
+    for (uint8_t hop = 1; hop < TRACE_HOP_COUNT; hop++) {
+        if (!(stampedMask & (1 << hop))) continue;
+
+        uint32_t us = (stamps[hop] - start) / cyclesPerMicro;
+        hopHistograms[hop].record(us);
+        if (us > total) total = us;
+    }
+
+    uint8_t cmd = (uint8_t)activeCommand;
+    if (cmd < TRACE_COMMAND_COUNT) {
+        commandHistograms[cmd].record(total);
+    }
+}
+
+void LatencyTracer::printReport(Print& out) const {
+    out.println("[Latency] voice->action (us): name n p50 p99 max");
+
+    for (uint8_t i = 0; i < TRACE_COMMAND_COUNT; i++) {
+        const LatencyHistogram& h = commandHistograms[i];
+        if (h.count == 0) continue;
+
+        char line[64];
+        snprintf(line, sizeof(line), "  %-9s %lu %lu %lu %lu", TRACE_COMMAND_NAMES[i],
+                 (unsigned long)h.count, (unsigned long)h.percentile(50),
+                 (unsigned long)h.percentile(99), (unsigned long)h.maxUs);
+        out.println(line);
+    }
+
+    for (uint8_t i = 1; i < TRACE_HOP_COUNT; i++) {
+        const LatencyHistogram& h = hopHistograms[i];
+        if (h.count == 0) continue;
+
+        char line[64];
+        snprintf(line, sizeof(line), "  @%-8s %lu %lu %lu %lu", TRACE_HOP_NAMES[i],
+                 (unsigned long)h.count, (unsigned long)h.percentile(50),
+                 (unsigned long)h.percentile(99), (unsigned long)h.maxUs);
+        out.println(line);
+    }
+}
+
+size_t LatencyTracer::formatReportJSON(char* buffer, size_t size) const {
+    // {"latency":{"happy":[n,p50,p99],...,"@servo":[n,p50,p99]}}
+    size_t len = 0;
+    int written = snprintf(buffer, size, "{\"latency\":{");
+    if (written < 0 || (size_t)written >= size) return 0;
+    len = written;
+
+    bool first = true;
+    for (uint8_t i = 0; i < TRACE_COMMAND_COUNT + TRACE_HOP_COUNT; i++) {
+        bool isHop = i >= TRACE_COMMAND_COUNT;
+        uint8_t index = isHop ? i - TRACE_COMMAND_COUNT : i;
+        if (isHop && index == 0) continue;
+
+        const LatencyHistogram& h = isHop ? hopHistograms[index] : commandHistograms[index];
+        if (h.count == 0) continue;
+
+        written = snprintf(buffer + len, size - len, "%s\"%s%s\":[%lu,%lu,%lu]",
+                           first ? "" : ",", isHop ? "@" : "",
+                           isHop ? TRACE_HOP_NAMES[index] : TRACE_COMMAND_NAMES[index],
+                           (unsigned long)h.count, (unsigned long)h.percentile(50),
+                           (unsigned long)h.percentile(99));
+        if (written < 0 || (size_t)written >= size - len) return 0;
+        len += written;
+        first = false;
+    }
+
+    written = snprintf(buffer + len, size - len, "}}");
+    if (written < 0 || (size_t)written >= size - len) return 0;
+    return len + written;
+}
@@ -1,4 +1,7 @@
 #include "MQTT_Manager.h"
+#include "Config_Store.h"
+#include "Deferred_Log.h"
+#include "Input_Trace.h"
 #include <WiFi.h>
 
 // 全局指针用于回调
@@ -6,20 +9,18 @@ MQTTManager* g_mqttManagerPtr = nullptr;
 
 // 静态消息回调
 void MQTTManager::onMessageReceived(char* topic, byte* payload, unsigned int length) {
-    // 可以在这里处理来自OneNet的命令
-    Serial.print("Message arrived [");
-    Serial.print(topic);
-    Serial.print("]: ");
-    
-    for (unsigned int i = 0; i < length; i++) {
-        Serial.print((char)payload[i]);
+    g_inputTrace.recordMessage(topic, payload, length);
+
+    LOG_DEBUG("[MQTT] Message arrived [%s]: %s", topic, logBytes(payload, length));
+
+    if (g_mqttManagerPtr != nullptr && g_mqttManagerPtr->messageHandler != nullptr) {
+        g_mqttManagerPtr->messageHandler(topic, payload, length);
     }
-    Serial.println();
 }
 
 MQTTManager::MQTTManager(WiFiClient& client) 
     : mqttClient(client), wifiClient(&client), 
-      lastHeartbeat(0), isConnected(false) {
+      lastHeartbeat(0), isConnected(false), messageHandler(nullptr) {
     g_mqttManagerPtr = this;
     mqttClient.setCallback(onMessageReceived);
 }
@@ -32,27 +33,32 @@ bool MQTTManager::connect() {
     if (isConnected) {
         return true;
     }
+    if (g_inputTrace.isReplaying()) {
+        return false;
+    }
     
     // 使用 OneNet 的连接格式：username=device_id&password=api_key
     String username = MQTT_USERNAME;
     String password = MQTT_PASSWORD;
     
-    Serial.println("[MQTT] Attempting to connect...");
+    LOG_INFO("[MQTT] Attempting to connect...");
     
     if (mqttClient.connect(MQTT_CLIENT_ID, 
                           username.c_str(), 
                           password.c_str())) {
-        Serial.println("[MQTT] Connected successfully!");
+        LOG_INFO("[MQTT] Connected successfully!");
         isConnected = true;
         lastHeartbeat = millis();
         
         // 订阅控制主题
         subscribe(MQTT_TOPIC_CONTROL);
+        subscribe(MQTT_TOPIC_CHOREO);
+        subscribe(MQTT_TOPIC_SHADOW_DESIRED);
+        subscribe(MQTT_TOPIC_CONFIG);
         
         return true;
     } else {
-        Serial.print("[MQTT] Connection failed, rc=");
-        Serial.println(mqttClient.state());
+        LOG_WARN("[MQTT] Connection failed, rc=%d", mqttClient.state());
         isConnected = false;
         return false;
     }
@@ -66,25 +72,32 @@ void MQTTManager::disconnect() {
 }
 
 void MQTTManager::update() {
-    // 检查连接状态
-    if (!isConnected) {
-        // 尝试重新连接
-        if (millis() - lastHeartbeat > 5000) {  // 5秒重试一次
-            connect();
-            lastHeartbeat = millis();
-        }
-    } else {
-        // 保持连接活跃
-        if (!mqttClient.loop()) {
-            isConnected = false;
-            Serial.println("[MQTT] Connection lost, attempting to reconnect...");
-        }
-        
-        // 定期发送心跳
-        if (millis() - lastHeartbeat > MQTT_HEARTBEAT_INTERVAL) {
-            lastHeartbeat = millis();
-            publishStatus("online");
+    // 回放：在录制时收到消息的位置投递录制的消息，不访问网络
+    if (g_inputTrace.isReplaying()) {
+        char topic[INPUT_TOPIC_MAX];
+        uint8_t payload[INPUT_MESSAGE_MAX];
+        unsigned int length;
+        while (g_inputTrace.replayMessage(topic, sizeof(topic), payload, sizeof(payload), length)) {
+            onMessageReceived(topic, payload, length);
         }
+        return;
+    }
+
+    if (!isConnected) {
+        return;
+    }
+    
+    // 保持连接活跃
+    if (!mqttClient.loop()) {
+        isConnected = false;
+        LOG_WARN("[MQTT] Connection lost");
+        return;
+    }
+    
+    // 定期发送心跳
+    if (millis() - lastHeartbeat > g_config.mqttHeartbeatInterval) {
+        lastHeartbeat = millis();
+        publishStatus("online");
     }
 }
 
@@ -99,7 +112,7 @@ bool MQTTManager::publishTempHumidity(float temp, float humidity) {
     
     bool result = mqttClient.publish(MQTT_TOPIC_STATUS, payload);
     if (result) {
-        Serial.println("[MQTT] Temperature & Humidity published");
+        LOG_DEBUG("[MQTT] Temperature & Humidity published");
     }
     return result;
 }
@@ -115,7 +128,7 @@ bool MQTTManager::publishWeather(const char* weather, float tempMax, float tempM
     
     bool result = mqttClient.publish(MQTT_TOPIC_STATUS, payload);
     if (result) {
-        Serial.println("[MQTT] Weather data published");
+        LOG_DEBUG("[MQTT] Weather data published");
     }
     return result;
 }
@@ -131,6 +144,29 @@ bool MQTTManager::publishStatus(const char* status) {
     return mqttClient.publish(MQTT_TOPIC_STATUS, payload);
 }
 
+bool MQTTManager::publishJSON(const char* payload) {
+    if (!isConnected) {
+        return false;
+    }
+    
+    return mqttClient.publish(MQTT_TOPIC_STATUS, payload);
+}
+
+Print* MQTTManager::beginPublish(const char* topic, size_t length) {
+    if (!isConnected) {
+        return nullptr;
+    }
+    
+    if (!mqttClient.beginPublish(topic, length, false)) {
+        return nullptr;
+    }
+    return &mqttClient;
+}
+
+bool MQTTManager::endPublish() {
+    return mqttClient.endPublish() != 0;
+}
+
 bool MQTTManager::subscribe(const char* topic) {
     if (!isConnected) {
         return false;
@@ -138,8 +174,7 @@ bool MQTTManager::subscribe(const char* topic) {
     
     bool result = mqttClient.subscribe(topic);
     if (result) {
-        Serial.print("[MQTT] Subscribed to: ");
-        Serial.println(topic);
+        LOG_INFO("[MQTT] Subscribed to: %s", topic);
     }
     return result;
 }
@@ -0,0 +1,195 @@
+#include "Motion_Arbiter.h"
+
+uint8_t motionSourcePriority(MotionSource source) {
+    switch (source) {
+        case MotionSource::REMOTE:  return 4;
+        case MotionSource::VOICE:   return 3;
+        case MotionSource::WARNING: return 2;
+        case MotionSource::AMBIENT: return 1;
+        default:                    return 0;
+    }
+}
+
+MotionArbiter::MotionArbiter()
+    : servo(nullptr), pendingCount(0), hasOwner(false),
+      owner(MotionSource::AMBIENT), ownerPriority(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void MotionArbiter::begin(ServoController* srv) {
+    servo = srv;
+}
+
+bool MotionArbiter::start(ServoAction action, MotionSource source, uint8_t priority,
+                          MotionQueuePolicy policy) {
+    if (!servo->performAction(action, policy)) {
+        return false;
+    }
+    hasOwner = true;
+    owner = source;
+    ownerPriority = priority;
+    stats.started++;
+    return true;
+}
+
+void MotionArbiter::removePending(uint8_t index) {
+    for (uint8_t i = index; i + 1 < pendingCount; i++) {
+        pending[i] = pending[i + 1];
+    }
+    pendingCount--;
+}
+
+bool MotionArbiter::submit(ServoAction action, MotionSource source,
+                           MotionPreempt preempt, uint16_t ttl) {
+    return submit(action, source, preempt, ttl, motionSourcePriority(source));
+}
+
+bool MotionArbiter::submit(ServoAction action, MotionSource source, MotionPreempt preempt,
+                           uint16_t ttl, uint8_t priority) {
+    if (!servo) return false;
+    stats.submitted++;
+
+    if (!servo->isPerforming()) {
+        hasOwner = false;
+
+        // 空闲：排队中没有更高优先级的请求则立即执行
+        bool outranked = false;
+        for (uint8_t i = 0; i < pendingCount; i++) {
+            if (pending[i].priority > priority) {
+                outranked = true;
+                break;
+            }
+        }
+        if (!outranked && start(action, source, priority, MotionQueuePolicy::ENQUEUE)) {
+            return true;
+        }
+    } else if (preempt != MotionPreempt::NONE && 
+               priority > (hasOwner ? ownerPriority : 0)) {
+        // 抢占：不是仲裁器发起的动作视为最低优先级
+        MotionQueuePolicy policy = (preempt == MotionPreempt::CUT)
+                                   ? MotionQueuePolicy::FLUSH : MotionQueuePolicy::REPLACE;
+        if (start(action, source, priority, policy)) {
+            stats.preemptions++;
+            return true;
+        }
+    }
+
+    if (ttl == 0) {
+        stats.dropped++;
+        return false;
+    }
+
+    Request request = {action, source, priority, ttl, millis()};
+
+    // 同一来源只保留最新的请求
+    for (uint8_t i = 0; i < pendingCount; i++) {
+        if (pending[i].source == source) {
+            pending[i] = request;
+            stats.superseded++;
+            return true;
+        }
+    }
+
+    if (pendingCount >= MOTION_ARBITER_CAPACITY) {
+        // 队列满：挤掉优先级最低（同级取最早）的请求，新请求更低则丢弃自身
+        uint8_t lowest = 0;
+        for (uint8_t i = 1; i < pendingCount; i++) {
+            if (pending[i].priority < pending[lowest].priority) {
+                lowest = i;
+            }
+        }
+        stats.dropped++;
+        if (pending[lowest].priority >= priority) {
+            return false;
+        }
+        removePending(lowest);
+    }
+
+    pending[pendingCount++] = request;
+    return true;
+}
+
+bool MotionArbiter::submitSegment(ServoAxis axis, int16_t angle, uint16_t duration,
+                                  MotionSource source, MotionQueuePolicy ownPolicy) {
+    if (!servo) return false;
+    stats.submitted++;
+
+    uint8_t priority = motionSourcePriority(source);
+    MotionQueuePolicy policy = MotionQueuePolicy::ENQUEUE;
+    bool takeover = true;
+
+    if (servo->isPerforming()) {
+        if (hasOwner && owner == source) {
+            policy = ownPolicy;
+            takeover = false;
+        } else if (priority > (hasOwner ? ownerPriority : 0)) {
+            policy = MotionQueuePolicy::REPLACE;
+        } else {
+            stats.dropped++;
+            return false;
+        }
+    }
+
+    MotionProfile easing = servo->getMotionProfile();
+    int16_t target = servo->reachableAngle(axis, angle, duration, easing);
+    if (!servo->enqueueAxis(axis, target, duration, easing, policy)) {
+        stats.dropped++;
+        return false;
+    }
+
+    if (takeover) {
+        if (policy == MotionQueuePolicy::REPLACE) {
+            stats.preemptions++;
+        }
+        hasOwner = true;
+        owner = source;
+        ownerPriority = priority;
+        stats.started++;
+    }
+    return true;
+}
+
+void MotionArbiter::update() {
+    if (!servo) return;
+
+    unsigned long now = millis();
+
+    // 清理过期请求
+    for (uint8_t i = 0; i < pendingCount; ) {
+        if (now - pending[i].submitTime > pending[i].ttl) {
+            removePending(i);
+            stats.expired++;
+        } else {
+            i++;
+        }
+    }
+
+    if (servo->isPerforming()) {
+        return;
+    }
+    hasOwner = false;
+
+    // 舵机空闲：开始优先级最高（同级取最早）的请求
+    if (pendingCount > 0) {
+        uint8_t best = 0;
+        for (uint8_t i = 1; i < pendingCount; i++) {
+            if (pending[i].priority > pending[best].priority) {
+                best = i;
+            }
+        }
+        Request request = pending[best];
+        removePending(best);
+        if (!start(request.action, request.source, request.priority, 
+                   MotionQueuePolicy::ENQUEUE)) {
+            stats.dropped++;
+        }
+    }
+}
+
+bool MotionArbiter::getOwner(MotionSource& source) const {
+    if (!hasOwner || !servo || !servo->isPerforming()) {
+        return false;
+    }
+    source = owner;
+    return true;
+}
@@ -0,0 +1,66 @@
+#include "Motion_Queue.h"
+
+MotionTimeline::MotionTimeline()
+    : head(0), count(0) {
+    limits.maxVelocity = 0;
+    limits.maxAcceleration = 0;
+}
+
+void MotionTimeline::reset(float pos) {
+    trajectory.reset(pos);
+    count = 0;
+}
+
+bool MotionTimeline::push(const MotionSegment& segment) {
+    if (count >= MOTION_QUEUE_CAPACITY) {
+        return false;
+    }
+    segments[(head + count) % MOTION_QUEUE_CAPACITY] = segment;
+    count++;
+    return true;
+}
+
+float MotionTimeline::tailPosition() const {
+    for (uint8_t i = count; i > 0; i--) {
+        const MotionSegment& segment = segments[(head + i - 1) % MOTION_QUEUE_CAPACITY];
+        if (segment.target != MOTION_AXIS_HOLD) {
+            return segment.target;
+        }
+    }
+    return trajectory.getTarget();
+}
+
+uint16_t MotionTimeline::minimumDuration(int16_t target, MotionProfile easing) const {
+    if (target == MOTION_AXIS_HOLD) {
+        return 0;
+    }
+    float seconds = ServoTrajectory::minimumDuration(target - tailPosition(), easing, limits);
+    return (uint16_t)ceilf(seconds * 1000.0f);
+}
+
+void MotionTimeline::startNext(uint32_t nowTick) {
+    const MotionSegment& segment = segments[head];
+    head = (head + 1) % MOTION_QUEUE_CAPACITY;
+    count--;
+
+    // 保持段规划到当前位置，退化为原地等待 duration
+    float target = (segment.target == MOTION_AXIS_HOLD)
+                   ? trajectory.getPosition() : (float)segment.target;
+    trajectory.plan(target, segment.easing, limits, 
+                    segment.duration / 1000.0f, nowTick);
+}
+
+bool MotionTimeline::tick(uint32_t nowTick, float& angle) {
+    if (!trajectory.isMoving() && count == 0) {
+        return false;
+    }
+
+    angle = trajectory.sample(nowTick);
+
+    // 当前段在本节拍结束（或刚入队）：下一段从同一节拍开始，避免空等一个周期
+    while (!trajectory.isMoving() && count > 0) {
+        startNext(nowTick);
+        angle = trajectory.sample(nowTick);
+    }
+    return true;
+}
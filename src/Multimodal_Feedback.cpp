@@ -1,16 +1,19 @@
 #include "Multimodal_Feedback.h"
 #include "ASRPRO_Module.h"
+#include "Deferred_Log.h"
+#include "Latency_Trace.h"
 
 MultimodalFeedbackSystem::MultimodalFeedbackSystem() 
-    : display(nullptr), servo(nullptr),
-      sequenceStartTime(0), currentMotionIndex(0),
+    : display(nullptr), motion(nullptr), voice(nullptr),
+      sequence{nullptr, 0, 0}, stepStart{}, sequenceStartTime(0), servoLead(0),
       isSequencePlaying(false), currentScenario(FeedbackScenario::EXCITED),
-      danceSequence(nullptr), excitedSequence(nullptr), tiredSequence(nullptr) {
+      tracks{}, timingStats{} {
 }
 
-void MultimodalFeedbackSystem::begin(OLEDDisplay* disp, ServoController* srv) {
+void MultimodalFeedbackSystem::begin(OLEDDisplay* disp, MotionArbiter* arbiter, ASRPROModule* asr) {
     display = disp;
-    servo = srv;
+    motion = arbiter;
+    voice = asr;
 }
 
 void MultimodalFeedbackSystem::executeFeedbackScenario(
@@ -18,179 +21,242 @@ void MultimodalFeedbackSystem::executeFeedbackScenario(
     FeedbackAction actionType) {
     
     currentScenario = scenario;
-    isSequencePlaying = true;
-    sequenceStartTime = millis();
-    currentMotionIndex = 0;
     
-    Serial.print("[Feedback] Executing scenario: ");
-    Serial.println((int)scenario);
+    LOG_INFO("[Feedback] Executing scenario: %d", scenario);
     
     switch (scenario) {
         case FeedbackScenario::DANCE:
-            executeCustomSequence(DANCE_MOTIONS, sizeof(DANCE_MOTIONS) / sizeof(DANCE_MOTIONS[0]));
+            executeCustomSequence(DANCE_MOTIONS, sizeof(DANCE_MOTIONS) / sizeof(DANCE_MOTIONS[0]), actionType);
             break;
             
         case FeedbackScenario::EXCITED:
-            executeCustomSequence(EXCITED_MOTIONS, sizeof(EXCITED_MOTIONS) / sizeof(EXCITED_MOTIONS[0]));
+            executeCustomSequence(EXCITED_MOTIONS, sizeof(EXCITED_MOTIONS) / sizeof(EXCITED_MOTIONS[0]), actionType);
             break;
             
         case FeedbackScenario::TIRED:
-            executeCustomSequence(TIRED_MOTIONS, sizeof(TIRED_MOTIONS) / sizeof(TIRED_MOTIONS[0]));
+            executeCustomSequence(TIRED_MOTIONS, sizeof(TIRED_MOTIONS) / sizeof(TIRED_MOTIONS[0]), actionType);
             break;
             
         case FeedbackScenario::HOT:
-            executeCustomSequence(HOT_MOTIONS, sizeof(HOT_MOTIONS) / sizeof(HOT_MOTIONS[0]));
+            executeCustomSequence(HOT_MOTIONS, sizeof(HOT_MOTIONS) / sizeof(HOT_MOTIONS[0]), actionType);
             break;
             
         case FeedbackScenario::COLD:
-            // 寒冷反馈：哆嗦
-            applyEmotionFeedback(EmotionState::COLD_WARNING);
-            servo->performAction(ServoAction::SHAKE_LEFT);
+            executeCustomSequence(COLD_MOTIONS, sizeof(COLD_MOTIONS) / sizeof(COLD_MOTIONS[0]), actionType);
             break;
             
         case FeedbackScenario::CONFUSED:
-            // 困惑反馈
-            applyEmotionFeedback(EmotionState::CONFUSED);
-            servo->performAction(ServoAction::TILT_LEFT);
+            executeCustomSequence(CONFUSED_MOTIONS, sizeof(CONFUSED_MOTIONS) / sizeof(CONFUSED_MOTIONS[0]), actionType);
             break;
             
         case FeedbackScenario::CELEBRATE:
-            // 庆祝反馈
-            applyEmotionFeedback(EmotionState::HAPPY);
-            servo->performAction(ServoAction::NOD_UP);
+            executeCustomSequence(CELEBRATE_MOTIONS, sizeof(CELEBRATE_MOTIONS) / sizeof(CELEBRATE_MOTIONS[0]), actionType);
             break;
             
         case FeedbackScenario::ALERT:
-            // 警告反馈
-            applyEmotionFeedback(EmotionState::ALERT);
-            servo->performAction(ServoAction::SHAKE_LEFT);
+            executeCustomSequence(ALERT_MOTIONS, sizeof(ALERT_MOTIONS) / sizeof(ALERT_MOTIONS[0]), actionType);
             break;
     }
 }
 
 void MultimodalFeedbackSystem::executeCustomSequence(
     const FeedbackMotion* motions, 
-    uint8_t count) {
+    uint8_t count,
+    FeedbackAction actionType) {
     
     if (motions == nullptr || count == 0) return;
+    if (count > FEEDBACK_MAX_STEPS) count = FEEDBACK_MAX_STEPS;
     
-    isSequencePlaying = true;
+    // 各步起始时刻由前面各步的 duration 累加
+    uint32_t offset = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        stepStart[i] = offset;
+        offset += motions[i].duration;
+    }
+    stepStart[count] = offset;
+    sequence = {motions, count, (uint16_t)offset};
+    
+    bool visual = (actionType != FeedbackAction::MOTION_ONLY);
+    bool moving = (actionType != FeedbackAction::VISUAL_ONLY);
+    bool speaking = (actionType == FeedbackAction::FULL_FEEDBACK);
+    
+    track(FeedbackTrack::EMOTION) = {0, 0, visual && display != nullptr};
+    track(FeedbackTrack::HEAD) = {0, 0, moving && motion != nullptr};
+    track(FeedbackTrack::NOD) = {0, 0, moving && motion != nullptr};
+    track(FeedbackTrack::VOICE) = {0, 0, speaking && voice != nullptr};
+    
+    // 时间线起点取舵机实际开始输出的时刻：PWM 关闭时先保持 SERVO_WAKE_LEAD_MS，
+    // 输出还要经过 SERVO_OUTPUT_LATENCY_MS，表情与语音随之推迟，各轨道对齐；
+    // 舵机段提前同样时长装入，第 0 步在本次调用中立即提交
     sequenceStartTime = millis();
-    currentMotionIndex = 0;
+    servoLead = 0;
+    if (moving && motion != nullptr) {
+        servoLead = motion->wakeDelay() + SERVO_OUTPUT_LATENCY_MS;
+        sequenceStartTime += servoLead;
+    }
+    isSequencePlaying = true;
     
-    Serial.print("[Feedback] Starting custom sequence with ");
-    Serial.print(count);
-    Serial.println(" motions");
+    LOG_DEBUG("[Feedback] Starting sequence: %d steps, %u ms", count, offset);
+    
+    // 第 0 步立即预装
+    update();
 }
 
-void MultimodalFeedbackSystem::update() {
-    if (!isSequencePlaying || display == nullptr || servo == nullptr) {
-        return;
+int16_t MultimodalFeedbackSystem::axisTarget(ServoAction action, ServoAxis axis) {
+    // 角度与 ServoController::performAction 一致
+    switch (action) {
+        case ServoAction::SHAKE_LEFT:  return axis == ServoAxis::HEAD ? 45 : MOTION_AXIS_HOLD;
+        case ServoAction::SHAKE_RIGHT: return axis == ServoAxis::HEAD ? 135 : MOTION_AXIS_HOLD;
+        case ServoAction::NOD_UP:      return axis == ServoAxis::NOD ? 30 : MOTION_AXIS_HOLD;
+        case ServoAction::NOD_DOWN:    return axis == ServoAxis::NOD ? 150 : MOTION_AXIS_HOLD;
+        case ServoAction::RESET:       return 90;
+        default:                       return MOTION_AXIS_HOLD;
     }
+}
+
+void MultimodalFeedbackSystem::armStep(FeedbackTrack t, uint8_t step, long elapsed) {
+    const FeedbackMotion& m = sequence.motions[step];
     
-    // 这里添加实际的序列播放逻辑
-    // 根据时间和当前动作索引来控制舵机和表情显示
-    // 这是一个简化版本，实际应该处理多个动作的时序
-    
-    unsigned long elapsedTime = millis() - sequenceStartTime;
-    
-    // 演示：更新当前动作
-    if (currentMotionIndex < 3) {  // 假设最多3个动作
-        // 根据时间推进到下一个动作
-        if (elapsedTime > 500) {  // 每500ms切换一个动作
-            currentMotionIndex++;
-            sequenceStartTime = millis();
+    switch (t) {
+        case FeedbackTrack::EMOTION:
+            // 与上一步相同的表情不重绘
+            if (step == 0 || m.emotion != sequence.motions[step - 1].emotion) {
+                display->prepareEmotion(m.emotion);
+            }
+            break;
             
-            if (currentMotionIndex >= 3) {
-                isSequencePlaying = false;
+        case FeedbackTrack::HEAD:
+        case FeedbackTrack::NOD: {
+            // 不动的轴装入保持段，两轴时间线都按步长首尾相接
+            ServoAxis axis = (t == FeedbackTrack::HEAD) ? ServoAxis::HEAD : ServoAxis::NOD;
+            
+            // 上一段已经算完才装入：时间线出现空档，本段会推迟
+            if (step > 0 && elapsed + SERVO_OUTPUT_LATENCY_MS > (long)stepStart[step]) {
+                timingStats.lateArms++;
+            }
+            
+            // 第 0 步打断本来源之前序列残留的段，从当前位置开始
+            MotionQueuePolicy own = (step == 0) ? MotionQueuePolicy::FLUSH : MotionQueuePolicy::ENQUEUE;
+            if (!motion->submitSegment(axis, axisTarget(m.servoAction, axis), m.duration,
+                                       MotionSource::AMBIENT, own)) {
+                // 舵机被更高优先级动作占用：本序列的该轴轨道静音，其余轨道照常
+                timingStats.rejectedSegments++;
+                track(t).enabled = false;
             }
+            break;
         }
+        
+        default:
+            break;
     }
 }
 
-void MultimodalFeedbackSystem::stopSequence() {
-    isSequencePlaying = false;
-    currentMotionIndex = 0;
-    if (servo != nullptr) {
-        servo->performAction(ServoAction::RESET);
+void MultimodalFeedbackSystem::fireStep(FeedbackTrack t, uint8_t step, long elapsed) {
+    const FeedbackMotion& m = sequence.motions[step];
+    
+    uint32_t lateness = (uint32_t)(elapsed - (long)stepStart[step]);
+    timingStats.events++;
+    if (lateness > timingStats.maxLateness) {
+        timingStats.maxLateness = lateness;
+    }
+    
+    switch (t) {
+        case FeedbackTrack::EMOTION:
+            if (step == 0 || m.emotion != sequence.motions[step - 1].emotion) {
+                display->presentEmotion(m.emotion);
+            }
+            break;
+            
+        case FeedbackTrack::VOICE:
+            if (m.hasVoice && m.voiceText != nullptr) {
+                voice->speak(m.voiceText);
+            }
+            break;
+            
+        default:
+            // 舵机轨道在预装时已交给时间线，到点由中断执行
+            break;
     }
-    Serial.println("[Feedback] Sequence stopped");
 }
 
-String MultimodalFeedbackSystem::generateThermalFeedback(float temp, float humidity) {
-    String feedback = "";
-    
-    if (temp > 32.0) {
-        feedback = "Too hot! Stay cool!";
-        executeFeedbackScenario(FeedbackScenario::HOT);
-    } else if (temp < 10.0) {
-        feedback = "So cold! Keep warm!";
-        executeFeedbackScenario(FeedbackScenario::COLD);
-    } else if (temp > 28.0) {
-        feedback = "Feeling warm today";
-    } else if (temp < 15.0) {
-        feedback = "It's chilly outside";
-    } else {
-        feedback = "Temperature is perfect";
+void MultimodalFeedbackSystem::update() {
+    if (!isSequencePlaying) {
+        return;
     }
+    uint32_t begin = LatencyTracer::now();
     
-    // 湿度反馈
-    if (humidity > 70.0) {
-        feedback += " Humidity is high";
-    } else if (humidity < 30.0) {
-        feedback += " Air is dry";
+    long elapsed = (long)(millis() - sequenceStartTime);
+    uint8_t count = sequence.motionCount;
+    bool finished = true;
+    
+    for (uint8_t i = 0; i < (uint8_t)FeedbackTrack::COUNT; i++) {
+        FeedbackTrack t = (FeedbackTrack)i;
+        FeedbackTrackState& s = tracks[i];
+        
+        // 预装：步起点前 FEEDBACK_LOOKAHEAD_MS；舵机段在中断里提前算出，再提前唤醒与输出延迟
+        long lead = FEEDBACK_LOOKAHEAD_MS;
+        if (t == FeedbackTrack::HEAD || t == FeedbackTrack::NOD) {
+            lead += servoLead;
+        }
+        while (s.enabled && s.armed < count && elapsed + lead >= (long)stepStart[s.armed]) {
+            armStep(t, s.armed, elapsed);
+            s.armed++;
+        }
+        if (!s.enabled) {
+            continue;
+        }
+        
+        // 到点执行
+        while (s.fired < s.armed && elapsed >= (long)stepStart[s.fired]) {
+            fireStep(t, s.fired, elapsed);
+            s.fired++;
+        }
+        if (s.fired < count) {
+            finished = false;
+        }
+    }
+    
+    if (finished && elapsed >= (long)stepStart[count]) {
+        isSequencePlaying = false;
+        LOG_DEBUG("[Feedback] Sequence complete");
     }
     
-    return feedback;
+    uint32_t cycles = LatencyTracer::now() - begin;
+    timingStats.updates++;
+    timingStats.totalCycles += cycles;
+    if (cycles > timingStats.maxUpdateCycles) {
+        timingStats.maxUpdateCycles = cycles;
+    }
+}
+
+uint8_t MultimodalFeedbackSystem::getCurrentStep() const {
+    uint8_t step = sequence.motionCount;
+    for (uint8_t i = 0; i < (uint8_t)FeedbackTrack::COUNT; i++) {
+        if (tracks[i].enabled && tracks[i].fired < step) {
+            step = tracks[i].fired;
+        }
+    }
+    return isSequencePlaying ? step : 0;
+}
+
+void MultimodalFeedbackSystem::stopSequence() {
+    isSequencePlaying = false;
+    if (motion != nullptr) {
+        motion->submit(ServoAction::RESET, MotionSource::AMBIENT);
+    }
+    LOG_DEBUG("[Feedback] Sequence stopped");
+}
+
+size_t MultimodalFeedbackSystem::generateThermalFeedback(float temp, float humidity,
+                                                        char* buffer, size_t size) const {
+    return composePhrases(thermalPhrases(temp, humidity), buffer, size);
 }
 
 void MultimodalFeedbackSystem::applyEmotionFeedback(EmotionState emotion) {
     if (display == nullptr) return;
     
-    // 显示对应的表情
-    // 这里调用OLED_Display的表情显示方法
-    
-    switch (emotion) {
-        case EmotionState::HAPPY:
-            Serial.println("[Feedback] Showing HAPPY emotion");
-            // display->drawEmotion(HAPPY_BITMAP);
-            break;
-            
-        case EmotionState::SAD:
-            Serial.println("[Feedback] Showing SAD emotion");
-            // display->drawEmotion(SAD_BITMAP);
-            break;
-            
-        case EmotionState::ANGRY:
-            Serial.println("[Feedback] Showing ANGRY emotion");
-            // display->drawEmotion(ANGRY_BITMAP);
-            break;
-            
-        case EmotionState::CONFUSED:
-            Serial.println("[Feedback] Showing CONFUSED emotion");
-            // display->drawEmotion(CONFUSED_BITMAP);
-            break;
-            
-        case EmotionState::HOT_WARNING:
-            Serial.println("[Feedback] Showing HOT emotion with sweat");
-            // display->drawEmotion(HOT_SWEAT_BITMAP);
-            break;
-            
-        case EmotionState::COLD_WARNING:
-            Serial.println("[Feedback] Showing COLD emotion with shiver");
-            // display->drawEmotion(COLD_SHIVER_BITMAP);
-            break;
-            
-        case EmotionState::SLEEPY:
-            Serial.println("[Feedback] Showing SLEEPY emotion");
-            // display->drawEmotion(SLEEPY_BITMAP);
-            break;
-            
-        case EmotionState::ALERT:
-            Serial.println("[Feedback] Showing ALERT emotion");
-            // display->drawEmotion(ALERT_BITMAP);
-            break;
-    }
+    LOG_DEBUG("[Feedback] Showing emotion %d", emotion);
+    display->setEmotion(emotion);
 }
 
 /**
@@ -201,7 +267,7 @@ void MultimodalFeedbackSystem::applyEmotionFeedback(EmotionState emotion) {
  * MultimodalFeedbackSystem multimodalFeedback;
  * 
  * // 在setup中初始化
- * multimodalFeedback.begin(&oledDisplay, &servoController);
+ * multimodalFeedback.begin(&oledDisplay, &motionArbiter, &asrModule);
  * 
  * // 在loop中调用update以支持非阻塞反馈
  * multimodalFeedback.update();
@@ -214,10 +280,11 @@ void MultimodalFeedbackSystem::applyEmotionFeedback(EmotionState emotion) {
  *     );
  * }
  * 
- * // 响应温度阈值
- * if (temperature > 32.0) {
- *     String feedback = multimodalFeedback.generateThermalFeedback(temperature, humidity);
- *     asrproModule.speak(feedback.c_str());
- *     multimodalFeedback.applyEmotionFeedback(EmotionState::HOT_WARNING);
+ * // 响应温度阈值（文本生成不触发反馈，场景由调用方决定）
+ * if (thermalLevel(temperature) == ThermalLevel::HOT) {
+ *     char feedback[PHRASE_BUFFER_SIZE];
+ *     multimodalFeedback.generateThermalFeedback(temperature, humidity, feedback, sizeof(feedback));
+ *     multimodalFeedback.executeFeedbackScenario(FeedbackScenario::HOT);
+ *     asrproModule.speak(feedback);
  * }
  */
@@ -1,8 +1,10 @@
 #include "OLED_Display.h"
+#include "Latency_Trace.h"
 
 OLEDDisplay::OLEDDisplay() 
     : u8g2(U8G2_R0, OLED_SCL, OLED_SDA), 
-      currentEmotion(EmotionState::NORMAL) {
+      currentEmotion(EmotionState::NORMAL),
+      preparedEmotion(EmotionState::NORMAL), hasPrepared(false) {
 }
 
 void OLEDDisplay::begin() {
@@ -12,9 +14,15 @@ void OLEDDisplay::begin() {
     clear();
 }
 
+void OLEDDisplay::sendBuffer() {
+    u8g2.sendBuffer();
+    hasPrepared = false;
+    LATENCY_TRACE(TraceHop::OLED_FLUSH);
+}
+
 void OLEDDisplay::clear() {
     u8g2.clearBuffer();
-    u8g2.sendBuffer();
+    sendBuffer();
 }
 
 void OLEDDisplay::drawHappy() {
@@ -30,7 +38,6 @@ void OLEDDisplay::drawHappy() {
     // 开心的嘴（弧线）
     u8g2.drawCircle(64, 35, 10);
     u8g2.drawLine(55, 35, 73, 35);
-    u8g2.sendBuffer();
 }
 
 void OLEDDisplay::drawSad() {
@@ -46,7 +53,6 @@ void OLEDDisplay::drawSad() {
     // 伤心的嘴
     u8g2.drawCircle(64, 42, 8);
     u8g2.drawLine(55, 42, 73, 42);
-    u8g2.sendBuffer();
 }
 
 void OLEDDisplay::drawAngry() {
@@ -63,7 +69,6 @@ void OLEDDisplay::drawAngry() {
     u8g2.drawDisc(78, 26, 2);
     // 生气的嘴
     u8g2.drawLine(55, 40, 73, 40);
-    u8g2.sendBuffer();
 }
 
 void OLEDDisplay::drawSleepy() {
@@ -75,7 +80,6 @@ void OLEDDisplay::drawSleepy() {
     u8g2.drawLine(73, 26, 83, 26);
     // 嘴（平线）
     u8g2.drawLine(55, 40, 73, 40);
-    u8g2.sendBuffer();
 }
 
 void OLEDDisplay::drawSurprised() {
@@ -90,7 +94,6 @@ void OLEDDisplay::drawSurprised() {
     u8g2.drawDisc(78, 26, 2);
     // 惊讶的嘴（圆形）
     u8g2.drawCircle(64, 42, 6);
-    u8g2.sendBuffer();
 }
 
 void OLEDDisplay::drawNormal() {
@@ -105,7 +108,6 @@ void OLEDDisplay::drawNormal() {
     u8g2.drawDisc(78, 26, 2);
     // 普通的嘴
     u8g2.drawLine(55, 40, 73, 40);
-    u8g2.sendBuffer();
 }
 
 void OLEDDisplay::drawHotWarning() {
@@ -115,7 +117,6 @@ void OLEDDisplay::drawHotWarning() {
     u8g2.drawStr(10, 40, "Cool Down!");
     u8g2.drawStr(10, 60, "T > 30C");
     u8g2.setFont(u8g2_font_ncenB08_tr);
-    u8g2.sendBuffer();
 }
 
 void OLEDDisplay::drawColdWarning() {
@@ -125,7 +126,6 @@ void OLEDDisplay::drawColdWarning() {
     u8g2.drawStr(10, 40, "Keep Warm!");
     u8g2.drawStr(10, 60, "T < 15C");
     u8g2.setFont(u8g2_font_ncenB08_tr);
-    u8g2.sendBuffer();
 }
 
 void OLEDDisplay::drawHumidityWarning() {
@@ -135,12 +135,29 @@ void OLEDDisplay::drawHumidityWarning() {
     u8g2.drawStr(10, 40, "Abnormal RH");
     u8g2.drawStr(10, 60, "Check Env!");
     u8g2.setFont(u8g2_font_ncenB08_tr);
-    u8g2.sendBuffer();
 }
 
 void OLEDDisplay::setEmotion(EmotionState emotion) {
     currentEmotion = emotion;
-    
+    renderEmotion(emotion);
+    sendBuffer();
+}
+
+void OLEDDisplay::prepareEmotion(EmotionState emotion) {
+    renderEmotion(emotion);
+    preparedEmotion = emotion;
+    hasPrepared = true;
+}
+
+void OLEDDisplay::presentEmotion(EmotionState emotion) {
+    if (!hasPrepared || preparedEmotion != emotion) {
+        renderEmotion(emotion);
+    }
+    currentEmotion = emotion;
+    sendBuffer();
+}
+
+void OLEDDisplay::renderEmotion(EmotionState emotion) {
     switch (emotion) {
         case EmotionState::HAPPY:
             drawHappy();
@@ -185,7 +202,7 @@ void OLEDDisplay::displayTempHumidity(float temp, float humidity) {
     u8g2.drawStr(5, 25, tempStr);
     u8g2.drawStr(5, 50, humidStr);
     u8g2.setFont(u8g2_font_ncenB08_tr);
-    u8g2.sendBuffer();
+    sendBuffer();
 }
 
 void OLEDDisplay::displayWeather(const char* weather, float tempMax, float tempMin) {
@@ -201,7 +218,7 @@ void OLEDDisplay::displayWeather(const char* weather, float tempMax, float tempM
     u8g2.drawStr(10, 35, weather);
     u8g2.drawStr(10, 50, maxStr);
     u8g2.drawStr(10, 60, minStr);
-    u8g2.sendBuffer();
+    sendBuffer();
 }
 
 void OLEDDisplay::displayIP(const char* ip) {
@@ -209,7 +226,7 @@ void OLEDDisplay::displayIP(const char* ip) {
     u8g2.setFont(u8g2_font_ncenB08_tr);
     u8g2.drawStr(10, 20, "IP:");
     u8g2.drawStr(10, 35, ip);
-    u8g2.sendBuffer();
+    sendBuffer();
 }
 
 void OLEDDisplay::displayMQTTStatus(bool connected) {
@@ -222,5 +239,24 @@ void OLEDDisplay::displayMQTTStatus(bool connected) {
         u8g2.drawStr(10, 35, "MQTT Failed");
     }
     u8g2.setFont(u8g2_font_ncenB08_tr);
-    u8g2.sendBuffer();
+    sendBuffer();
+}
+
+void OLEDDisplay::beginPage() {
+    u8g2.clearBuffer();
+    hasPrepared = false;
+}
+
+void OLEDDisplay::drawText(uint8_t x, uint8_t y, const char* text, const uint8_t* font) {
+    u8g2.setFont(font);
+    u8g2.drawStr(x, y, text);
+}
+
+void OLEDDisplay::drawLine(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
+    u8g2.drawLine(x0, y0, x1, y1);
+}
+
+void OLEDDisplay::endPage() {
+    u8g2.setFont(u8g2_font_ncenB08_tr);
+    sendBuffer();
 }
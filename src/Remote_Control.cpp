@@ -1,103 +1,479 @@
 #include "Remote_Control.h"
+#include "Deferred_Log.h"
+#include "Json_Writer.h"
+#include "MQTT_Manager.h"
+
+// ==================== 名称表 ====================
+
+/**
+ * 名称 -> 枚举值
+ */
+struct RemoteName {
+    const char* text;
+    uint8_t value;
+};
+
+static constexpr RemoteName COMMAND_NAMES[] = {
+    {"emotion",     (uint8_t)RemoteCommand::SET_EMOTION},
+    {"servo",       (uint8_t)RemoteCommand::MOVE_SERVO},
+    {"status",      (uint8_t)RemoteCommand::QUERY_STATUS},
+    {"mode",        (uint8_t)RemoteCommand::SET_MODE},
+    {"calibrate",   (uint8_t)RemoteCommand::CALIBRATE},
+};
+
+static constexpr RemoteName EMOTION_NAMES[] = {
+    {"happy",       (uint8_t)EmotionState::HAPPY},
+    {"sad",         (uint8_t)EmotionState::SAD},
+    {"angry",       (uint8_t)EmotionState::ANGRY},
+    {"sleepy",      (uint8_t)EmotionState::SLEEPY},
+    {"surprised",   (uint8_t)EmotionState::SURPRISED},
+    {"normal",      (uint8_t)EmotionState::NORMAL},
+    {"hot",         (uint8_t)EmotionState::HOT_WARNING},
+    {"cold",        (uint8_t)EmotionState::COLD_WARNING},
+    {"humid",       (uint8_t)EmotionState::HUMID_WARNING},
+};
+
+static constexpr RemoteName ACTION_NAMES[] = {
+    {"shake_left",  (uint8_t)ServoAction::SHAKE_LEFT},
+    {"shake_right", (uint8_t)ServoAction::SHAKE_RIGHT},
+    {"nod_up",      (uint8_t)ServoAction::NOD_UP},
+    {"nod_down",    (uint8_t)ServoAction::NOD_DOWN},
+    {"reset",       (uint8_t)ServoAction::RESET},
+};
+
+static constexpr RemoteName MODE_NAMES[] = {
+    {"auto",        (uint8_t)RemoteMode::AUTO},
+    {"monitor",     (uint8_t)RemoteMode::MONITOR},
+    {"weather",     (uint8_t)RemoteMode::WEATHER},
+    {"quiet",       (uint8_t)RemoteMode::QUIET},
+};
+
+// ==================== 编译期完美哈希 ====================
+
+static constexpr uint8_t foldCase(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+static constexpr size_t nameLength(const char* s) {
+    size_t n = 0;
+    while (s[n]) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * 带种子的 FNV-1a（先转小写）
+ */
+static constexpr uint32_t nameHash(uint32_t seed, const char* s, size_t n) {
+    uint32_t hash = 2166136261UL ^ seed;
+    for (size_t i = 0; i < n; i++) {
+        hash = (hash ^ foldCase((uint8_t)s[i])) * 16777619UL;
+    }
+    return hash;
+}
+
+/**
+ * 不小于 2n 的 2 的幂：装载率不超过一半，很快能找到无冲突的种子
+ */
+static constexpr size_t hashTableSize(size_t n) {
+    size_t size = 1;
+    while (size < 2 * n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+/**
+ * 完美哈希表：在 seed 下每个名称落在不同的槽位
+ */
+template <size_t SIZE>
+struct NameHashTable {
+    uint32_t seed;
+    uint8_t slot[SIZE];      // 名称表下标 + 1，0 表示空槽
+    bool found;
+};
+
+template <size_t SIZE, size_t N>
+static constexpr NameHashTable<SIZE> buildNameHash(const RemoteName (&names)[N]) {
+    NameHashTable<SIZE> table{};
+    for (uint32_t seed = 1; seed < 4096; seed++) {
+        bool collision = false;
+        for (size_t i = 0; i < SIZE; i++) {
+            table.slot[i] = 0;
+        }
+        for (size_t i = 0; i < N && !collision; i++) {
+            size_t s = nameHash(seed, names[i].text, nameLength(names[i].text)) & (SIZE - 1);
+            if (table.slot[s] != 0) {
+                collision = true;
+            } else {
+                table.slot[s] = (uint8_t)(i + 1);
+            }
+        }
+        if (!collision) {
+            table.seed = seed;
+            table.found = true;
+            return table;
+        }
+    }
+    return table;
+}
+
+#define NAME_HASH(names) \
+    buildNameHash<hashTableSize(sizeof(names) / sizeof(names[0]))>(names)
+
+static constexpr auto COMMAND_HASH = NAME_HASH(COMMAND_NAMES);
+static constexpr auto EMOTION_HASH = NAME_HASH(EMOTION_NAMES);
+static constexpr auto ACTION_HASH = NAME_HASH(ACTION_NAMES);
+static constexpr auto MODE_HASH = NAME_HASH(MODE_NAMES);
+static_assert(COMMAND_HASH.found && EMOTION_HASH.found && ACTION_HASH.found && MODE_HASH.found,
+              "no collision-free seed for remote command names");
+
+/**
+ * 查找名称：一次哈希定位槽位，再比较一次名称
+ */
+template <size_t SIZE, size_t N>
+static bool lookupText(const NameHashTable<SIZE>& table, const RemoteName (&names)[N],
+                       const char* s, size_t n, uint8_t& value) {
+    uint8_t slot = table.slot[nameHash(table.seed, s, n) & (SIZE - 1)];
+    if (slot == 0) {
+        return false;
+    }
+
+    const char* text = names[slot - 1].text;
+    for (size_t i = 0; i < n; i++) {
+        if (text[i] == '\0' || foldCase((uint8_t)s[i]) != (uint8_t)text[i]) {
+            return false;
+        }
+    }
+    if (text[n] != '\0') {
+        return false;
+    }
+    value = names[slot - 1].value;
+    return true;
+}
+
+/**
+ * 查找字符串词元
+ */
+template <size_t SIZE, size_t N>
+static bool lookupName(const NameHashTable<SIZE>& table, const RemoteName (&names)[N],
+                       const char* json, int16_t token, const JsonToken* tokens, uint8_t& value) {
+    if (token < 0 || tokens[token].type != JsonType::STRING) {
+        return false;
+    }
+    return lookupText(table, names, json + tokens[token].start, tokens[token].length, value);
+}
+
+/**
+ * 枚举值 -> 名称（反查名称表）
+ */
+template <size_t N>
+static const char* nameOf(const RemoteName (&names)[N], uint8_t value) {
+    for (size_t i = 0; i < N; i++) {
+        if (names[i].value == value) {
+            return names[i].text;
+        }
+    }
+    return "unknown";
+}
+
+const char* remoteEmotionName(EmotionState emotion) {
+    return nameOf(EMOTION_NAMES, (uint8_t)emotion);
+}
+
+const char* remoteModeName(RemoteMode mode) {
+    return nameOf(MODE_NAMES, (uint8_t)mode);
+}
+
+bool remoteEmotionFromName(const char* text, size_t length, EmotionState& emotion) {
+    uint8_t value;
+    if (!lookupText(EMOTION_HASH, EMOTION_NAMES, text, length, value)) {
+        return false;
+    }
+    emotion = (EmotionState)value;
+    return true;
+}
+
+bool remoteModeFromName(const char* text, size_t length, RemoteMode& mode) {
+    uint8_t value;
+    if (!lookupText(MODE_HASH, MODE_NAMES, text, length, value)) {
+        return false;
+    }
+    mode = (RemoteMode)value;
+    return true;
+}
+
+/**
+ * 指令包 ID：1~REMOTE_ID_MAX_LEN-1 个 [0-9A-Za-z_.:-] 字符的字符串，或非负整数
+ * 字符受限，回复中可以原样写出而无需转义
+ */
+static bool copyEnvelopeId(const char* json, const JsonToken& token, char* id) {
+    if (token.length == 0 || token.length >= REMOTE_ID_MAX_LEN) {
+        return false;
+    }
+    const char* s = json + token.start;
+    for (uint16_t i = 0; i < token.length; i++) {
+        char c = s[i];
+        bool digit = c >= '0' && c <= '9';
+        bool allowed = digit || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                       c == '_' || c == '.' || c == ':' || c == '-';
+        if ((token.type == JsonType::STRING && !allowed) ||
+            (token.type == JsonType::PRIMITIVE && !digit) ||
+            (token.type != JsonType::STRING && token.type != JsonType::PRIMITIVE)) {
+            return false;
+        }
+    }
+    memcpy(id, s, token.length);
+    id[token.length] = '\0';
+    return true;
+}
 
 RemoteControlModule::RemoteControlModule() 
-    : lastCommandTime(0), commandCount(0) {
+    : lastCommandTime(0), commandCount(0), handler(nullptr),
+      history{}, historyHead(0), historyCount(0) {
     lastCommand.isValid = false;
 }
 
 void RemoteControlModule::begin() {
-    Serial.println("[RemoteControl] Module initialized");
+    LOG_INFO("[RemoteControl] Module initialized");
 }
 
-RemoteControlData RemoteControlModule::parseRemoteCommand(const char* jsonStr) {
-    RemoteControlData result;
+RemoteControlData RemoteControlModule::parseRemoteCommand(const char* json, const JsonToken* tokens,
+                                                          uint16_t object) {
+    RemoteControlData result = {};
     result.isValid = false;
     result.command = RemoteCommand::INVALID;
+    result.servoAngle = REMOTE_ANGLE_NONE;
     
-    DynamicJsonDocument doc(512);
-    DeserializationError error = deserializeJson(doc, jsonStr);
-    
-    if (error) {
-        Serial.print("[RemoteControl] JSON parse error: ");
-        Serial.println(error.c_str());
+    // 解析指令类型
+    uint8_t value = 0;
+    if (!lookupName(COMMAND_HASH, COMMAND_NAMES, json, jsonFind(json, tokens, object, "cmd"), tokens, value)) {
         return result;
     }
+    result.command = (RemoteCommand)value;
     
-    // 解析指令类型
-    const char* cmdType = doc["cmd"];
-    if (!cmdType) {
-        return result;
+    switch (result.command) {
+        case RemoteCommand::SET_EMOTION:
+            if (lookupName(EMOTION_HASH, EMOTION_NAMES, json, jsonFind(json, tokens, object, "emotion"), tokens, value)) {
+                result.emotion = (EmotionState)value;
+                result.isValid = true;
+            }
+            break;
+            
+        case RemoteCommand::MOVE_SERVO: {
+            if (lookupName(ACTION_HASH, ACTION_NAMES, json, jsonFind(json, tokens, object, "action"), tokens, value)) {
+                result.servoAction = (ServoAction)value;
+                result.isValid = true;
+            }
+            int16_t angle = jsonFind(json, tokens, object, "angle");
+            int32_t degrees = 0;
+            if (angle >= 0) {
+                if (jsonToInt(json, tokens[angle], degrees) && degrees >= 0 && degrees <= 180) {
+                    result.servoAngle = (uint16_t)degrees;
+                } else {
+                    result.isValid = false;
+                }
+            }
+            break;
+        }
+            
+        case RemoteCommand::SET_MODE:
+            if (lookupName(MODE_HASH, MODE_NAMES, json, jsonFind(json, tokens, object, "mode"), tokens, value)) {
+                result.mode = (RemoteMode)value;
+                result.isValid = true;
+            }
+            break;
+            
+        default:
+            result.isValid = true;
+            break;
+    }
+    
+    return result;
+}
+
+const RemoteEnvelopeRecord* RemoteControlModule::findEnvelope(const char* id) const {
+    for (uint8_t i = 0; i < historyCount; i++) {
+        if (strcmp(history[i].id, id) == 0) {
+            return &history[i];
+        }
     }
+    return nullptr;
+}
+
+RemoteResult RemoteControlModule::handleMQTTMessage(const uint8_t* payload, unsigned int length,
+                                                   char* reply, size_t replySize) {
+    LOG_DEBUG("[RemoteControl] Received: %s", logBytes(payload, (uint16_t)length));
     
-    String cmd(cmdType);
-    cmd.toLowerCase();
+    // 直接在接收缓冲区中解析，不复制
+    const char* json = (const char*)payload;
+    JsonToken tokens[REMOTE_JSON_TOKENS];
+    uint16_t tokenCount = 0;
+    RemoteControlData commands[REMOTE_BATCH_MAX];
+    uint8_t count = 0;
+    uint8_t failed = 0;
+    uint8_t index = 0;
+    char id[REMOTE_ID_MAX_LEN] = "";
+    bool hasId = false;
+    RemoteResult result = RemoteResult::OK;
     
-    if (cmd == "emotion") {
-        result.command = RemoteCommand::SET_EMOTION;
-        result.emotionName = String((const char*)doc["emotion"]);
-        result.isValid = true;
+    JsonError error = jsonTokenize(json, length, tokens, REMOTE_JSON_TOKENS, tokenCount);
+    if (error != JsonError::NONE || tokens[0].type != JsonType::OBJECT) {
+        LOG_WARN("[RemoteControl] JSON parse error: %s", jsonErrorText(error));
+        result = RemoteResult::PARSE_ERROR;
     }
-    else if (cmd == "servo") {
-        result.command = RemoteCommand::MOVE_SERVO;
-        result.servoAction = String((const char*)doc["action"]);
-        if (doc.containsKey("angle")) {
-            result.servoAngle = doc["angle"].as<uint16_t>();
+    
+    if (result == RemoteResult::OK) {
+        int16_t idToken = jsonFind(json, tokens, 0, "id");
+        if (idToken >= 0) {
+            hasId = copyEnvelopeId(json, tokens[idToken], id);
+            if (!hasId) {
+                result = RemoteResult::BAD_ID;
+            }
         }
-        result.isValid = true;
     }
-    else if (cmd == "status") {
-        result.command = RemoteCommand::QUERY_STATUS;
-        result.isValid = true;
+    
+    // 重发的指令包：不再执行，按首次结果回复
+    const RemoteEnvelopeRecord* previous = hasId ? findEnvelope(id) : nullptr;
+    if (previous != nullptr) {
+        LOG_INFO("[RemoteControl] Duplicate envelope %s", id);
+        formatReply(reply, replySize, id, RemoteResult::DUPLICATE, previous->count, previous->failed, 0);
+        return RemoteResult::DUPLICATE;
     }
-    else if (cmd == "mode") {
-        result.command = RemoteCommand::SET_MODE;
-        result.mode = String((const char*)doc["mode"]);
-        result.isValid = true;
+    
+    // 整包校验：先解析出全部指令
+    if (result == RemoteResult::OK) {
+        int16_t list = jsonFind(json, tokens, 0, "cmds");
+        if (list < 0) {
+            commands[count++] = parseRemoteCommand(json, tokens, 0);
+        } else if (tokens[list].type != JsonType::ARRAY) {
+            result = RemoteResult::INVALID;
+        } else if (tokens[list].size > REMOTE_BATCH_MAX) {
+            result = RemoteResult::TOO_MANY;
+        } else {
+            uint16_t element = list + 1;
+            for (uint16_t i = 0; i < tokens[list].size; i++) {
+                commands[count++] = parseRemoteCommand(json, tokens, element);
+                element = tokens[element].next;
+            }
+        }
+        
+        for (uint8_t i = 0; i < count && result == RemoteResult::OK; i++) {
+            if (!commands[i].isValid) {
+                result = RemoteResult::INVALID;
+                index = i;
+            }
+        }
+    }
+    
+    if (result != RemoteResult::OK) {
+        LOG_WARN("[RemoteControl] Envelope rejected: %s (command %d)", resultText(result), index);
+        formatReply(reply, replySize, hasId ? id : nullptr, result, 0, 0, index);
+        return result;
     }
-    else if (cmd == "calibrate") {
-        result.command = RemoteCommand::CALIBRATE;
-        result.isValid = true;
+    
+    // 同一次调用中依次执行，期间不会插入其他主循环任务
+    for (uint8_t i = 0; i < count; i++) {
+        if (handler != nullptr && !handler(commands[i])) {
+            failed |= (uint8_t)(1u << i);
+        }
+        lastCommand = commands[i];
+        commandCount++;
     }
+    lastCommandTime = millis();
+    LOG_INFO("[RemoteControl] Executed %d commands, failed mask %d", count, failed);
     
+    if (hasId) {
+        RemoteEnvelopeRecord& record = history[historyHead];
+        memcpy(record.id, id, sizeof(record.id));
+        record.count = count;
+        record.failed = failed;
+        historyHead = (uint8_t)((historyHead + 1) % REMOTE_ID_HISTORY);
+        if (historyCount < REMOTE_ID_HISTORY) {
+            historyCount++;
+        }
+        formatReply(reply, replySize, id, result, count, failed, 0);
+    } else if (reply != nullptr && replySize > 0) {
+        reply[0] = '\0';
+    }
     return result;
 }
 
-void RemoteControlModule::handleMQTTMessage(const char* topic, 
-                                           const char* payload, 
-                                           unsigned int length) {
-    // 创建空终止的字符串
-    char buffer[512];
-    unsigned int copyLen = (length < sizeof(buffer) - 1) ? length : sizeof(buffer) - 1;
-    strncpy(buffer, (const char*)payload, copyLen);
-    buffer[copyLen] = '\0';
+void RemoteControlModule::formatReply(char* reply, size_t replySize, const char* id, RemoteResult result,
+                                      uint8_t count, uint8_t failed, uint8_t index) {
+    if (reply == nullptr || replySize == 0) {
+        return;
+    }
     
-    Serial.print("[RemoteControl] Received: ");
-    Serial.println(buffer);
+    // ID 只含安全字符，可直接写入
+    char ack[REMOTE_ID_MAX_LEN + 2] = "null";
+    if (id != nullptr) {
+        snprintf(ack, sizeof(ack), "\"%s\"", id);
+    }
     
-    RemoteControlData cmd = parseRemoteCommand(buffer);
-    if (cmd.isValid) {
-        lastCommand = cmd;
-        lastCommandTime = millis();
-        commandCount++;
-        
-        Serial.print("[RemoteControl] Valid command received: ");
-        Serial.println((int)cmd.command);
+    switch (result) {
+        case RemoteResult::OK:
+        case RemoteResult::DUPLICATE:
+            snprintf(reply, replySize, "{\"ack\":%s,\"result\":\"%s\",\"count\":%u,\"failed\":%u}",
+                     ack, resultText(result), count, failed);
+            break;
+        case RemoteResult::INVALID:
+            snprintf(reply, replySize, "{\"ack\":%s,\"result\":\"%s\",\"index\":%u}",
+                     ack, resultText(result), index);
+            break;
+        default:
+            snprintf(reply, replySize, "{\"ack\":%s,\"result\":\"%s\"}", ack, resultText(result));
+            break;
+    }
+}
+
+const char* RemoteControlModule::resultText(RemoteResult result) {
+    switch (result) {
+        case RemoteResult::OK:          return "ok";
+        case RemoteResult::DUPLICATE:   return "duplicate";
+        case RemoteResult::PARSE_ERROR: return "parse_error";
+        case RemoteResult::INVALID:     return "invalid";
+        case RemoteResult::TOO_MANY:    return "too_many";
+        case RemoteResult::BAD_ID:      return "bad_id";
     }
+    return "unknown";
 }
 
-String RemoteControlModule::generateStatusJSON(const char* emotion, 
-                                              float temp, float humidity, 
-                                              const char* weather) {
-    DynamicJsonDocument doc(512);
+size_t RemoteControlModule::writeStatusJSON(Print& out, const RemoteStatus& status) {
+    JsonWriter json(out);
     
-    doc["emotion"] = emotion;
-    doc["temperature"] = serialized(String(temp, 1));
-    doc["humidity"] = serialized(String(humidity, 1));
-    doc["weather"] = weather;
-    doc["timestamp"] = millis();
-    doc["commands_received"] = commandCount;
+    json.beginObject();
+    json.key("emotion");
+    json.string(status.emotion);
+    json.key("temperature");
+    json.number(status.temperature, 1);
+    json.key("humidity");
+    json.number(status.humidity, 1);
+    json.key("weather");
+    json.string(status.weather);
+    json.key("timestamp");
+    json.unsignedInteger(status.timestamp);
+    json.key("commands_received");
+    json.unsignedInteger(status.commandsReceived);
+    json.endObject();
     
-    String output;
-    serializeJson(doc, output);
-    return output;
+    return json.size();
+}
+
+bool RemoteControlModule::publishStatus(MQTTManager& mqtt, const char* emotion, 
+                                        float temp, float humidity, 
+                                        const char* weather) {
+    RemoteStatus status = {emotion, temp, humidity, weather, (uint32_t)millis(), commandCount};
+    
+    // 第一遍只计数，得到报文头需要的长度
+    PrintCounter counter;
+    writeStatusJSON(counter, status);
+    
+    Print* packet = mqtt.beginPublish(MQTT_TOPIC_STATUS, counter.getCount());
+    if (packet == nullptr) {
+        return false;
+    }
+    writeStatusJSON(*packet, status);
+    return mqtt.endPublish();
 }
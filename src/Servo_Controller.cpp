@@ -1,78 +1,416 @@
 #include "Servo_Controller.h"
+#include "Latency_Trace.h"
+#include "Deferred_Log.h"
+
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+// 每个 PWM 周期推进的时间线节拍数
+static const uint8_t SERVO_TICKS_PER_FRAME = SERVO_UPDATE_RATE_HZ / SERVO_PWM_FRAME_HZ;
+static_assert(SERVO_UPDATE_RATE_HZ % SERVO_PWM_FRAME_HZ == 0,
+              "SERVO_UPDATE_RATE_HZ must be a multiple of SERVO_PWM_FRAME_HZ");
+#else
+ServoController* ServoController::instance = nullptr;
+#endif
 
 ServoController::ServoController() 
-    : headPos(90), nodPos(90), actionStartTime(0), 
-      currentAction(ServoAction::IDLE), isActing(false) {
+    : motionProfile(MotionProfile::MINIMUM_JERK), tickCount(0), tracePending(false),
+      headPulse(0), nodPulse(0), attached(false), wasBusy(false),
+      lastUpdateTime(0), lastBusyTime(0), actionStartTime(0),
+      actionEnergy(0), actionPeakCurrent(0),
+      lastHeadAngle(90), lastNodAngle(90), lastHeadVelocity(0), lastNodVelocity(0) {
+    memset(&powerStats, 0, sizeof(powerStats));
+    AxisLimits headLimits = {SERVO_HEAD_MAX_VELOCITY, SERVO_HEAD_MAX_ACCEL};
+    AxisLimits nodLimits = {SERVO_NOD_MAX_VELOCITY, SERVO_NOD_MAX_ACCEL};
+    headTimeline.setLimits(headLimits);
+    nodTimeline.setLimits(nodLimits);
+    headTimeline.reset(90);
+    nodTimeline.reset(90);
+    headPulse = nodPulse = angleToMicros(90);
+#if SERVO_BACKEND == SERVO_BACKEND_ARDUINO && defined(ARDUINO_ARCH_STM32)
+    trajectoryTimer = nullptr;
+#endif
 }
 
 void ServoController::begin() {
-    headServo.attach(SERVO_HEAD_PIN, 500, 2500);  // SG90 脉宽范围
-    nodServo.attach(SERVO_NOD_PIN, 500, 2500);
-    
     // 复位到中点
-    setHeadPosition(90);
-    setNodPosition(90);
+    headTimeline.reset(90);
+    nodTimeline.reset(90);
+    headPulse = nodPulse = angleToMicros(90);
+    
+    attached = true;
+    lastUpdateTime = lastBusyTime = millis();
+    
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+    pwm.begin(headPulse, nodPulse, fillFrames, this);
+#else
+    headServo.attach(SERVO_HEAD_PIN, SERVO_PULSE_MIN, SERVO_PULSE_MAX);  // SG90 脉宽范围
+    nodServo.attach(SERVO_NOD_PIN, SERVO_PULSE_MIN, SERVO_PULSE_MAX);
+    headServo.writeMicroseconds(headPulse);
+    nodServo.writeMicroseconds(nodPulse);
+    
+    // 启动轨迹更新定时器
+    instance = this;
+#if defined(ARDUINO_ARCH_STM32)
+    trajectoryTimer = new HardwareTimer(SERVO_TRAJECTORY_TIMER);
+    trajectoryTimer->setOverflow(SERVO_UPDATE_RATE_HZ, HERTZ_FORMAT);
+    trajectoryTimer->attachInterrupt(onTimerInterrupt);
+    trajectoryTimer->resume();
+#endif
+#endif
     delay(500);
 }
 
-void ServoController::setHeadPosition(uint16_t angle) {
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+void ServoController::fillFrames(void* context, uint32_t* head, uint32_t* nod, uint8_t count) {
+    ServoController* self = (ServoController*)context;
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t k = 0; k < SERVO_TICKS_PER_FRAME; k++) {
+            self->tick();
+        }
+        head[i] = self->headPulse;
+        nod[i] = self->nodPulse;
+    }
+    
+    // 入队后第一次填充半缓冲区：运动从这里起进入 DMA 输出
+    if (self->tracePending) {
+        self->tracePending = false;
+        LATENCY_TRACE_COMMIT(TraceHop::SERVO_WRITE);
+    }
+}
+#else
+void ServoController::onTimerInterrupt() {
+    if (instance) {
+        instance->tick();
+        
+        // 入队后第一个节拍：运动从这里起写入舵机
+        if (instance->tracePending) {
+            instance->tracePending = false;
+            LATENCY_TRACE_COMMIT(TraceHop::SERVO_WRITE);
+        }
+    }
+}
+#endif
+
+uint16_t ServoController::angleToMicros(float angle) {
+    if (angle < 0) angle = 0;
+    if (angle > 180) angle = 180;
+    return (uint16_t)(SERVO_PULSE_MIN + angle * (SERVO_PULSE_MAX - SERVO_PULSE_MIN) / 180.0f + 0.5f);
+}
+
+void ServoController::tick() {
+    uint32_t now = ++tickCount;
+    float angle;
+    
+    if (headTimeline.tick(now, angle)) {
+        headPulse = angleToMicros(angle);
+#if SERVO_BACKEND == SERVO_BACKEND_ARDUINO
+        headServo.writeMicroseconds(headPulse);
+#endif
+    }
+    if (nodTimeline.tick(now, angle)) {
+        nodPulse = angleToMicros(angle);
+#if SERVO_BACKEND == SERVO_BACKEND_ARDUINO
+        nodServo.writeMicroseconds(nodPulse);
+#endif
+    }
+    
+    if (attached) {
+        accumulatePower();
+    }
+}
+
+void ServoController::accumulatePower() {
+    // 电流模型：保持电流 + 与角速度、角加速度成正比的部分
+    float headAngle = headTimeline.getPosition();
+    float nodAngle = nodTimeline.getPosition();
+    float headVelocity = (headAngle - lastHeadAngle) * SERVO_UPDATE_RATE_HZ;
+    float nodVelocity = (nodAngle - lastNodAngle) * SERVO_UPDATE_RATE_HZ;
+    float headAccel = (headVelocity - lastHeadVelocity) * SERVO_UPDATE_RATE_HZ;
+    float nodAccel = (nodVelocity - lastNodVelocity) * SERVO_UPDATE_RATE_HZ;
+    
+    float current = 2 * SERVO_HOLD_CURRENT_MA
+                  + SERVO_VELOCITY_CURRENT * (fabsf(headVelocity) + fabsf(nodVelocity))
+                  + SERVO_ACCEL_CURRENT * (fabsf(headAccel) + fabsf(nodAccel));
+    float energy = current * SERVO_SUPPLY_VOLTAGE / SERVO_UPDATE_RATE_HZ;   // mA·V·s = mJ
+    
+    actionEnergy += energy;
+    powerStats.totalEnergy += energy;
+    if (current > actionPeakCurrent) {
+        actionPeakCurrent = current;
+    }
+    
+    lastHeadAngle = headAngle;
+    lastNodAngle = nodAngle;
+    lastHeadVelocity = headVelocity;
+    lastNodVelocity = nodVelocity;
+}
+
+void ServoController::setPowered(bool on) {
+    // 调用方已屏蔽中断
+    if (on == attached) return;
+    
+    if (on) {
+        // 速度状态从静止重新开始，避免把断开期间的位置变化算作加速度
+        lastHeadAngle = headTimeline.getPosition();
+        lastNodAngle = nodTimeline.getPosition();
+        lastHeadVelocity = 0;
+        lastNodVelocity = 0;
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+        pwm.start(headPulse, nodPulse);
+#else
+        headServo.attach(SERVO_HEAD_PIN, SERVO_PULSE_MIN, SERVO_PULSE_MAX);
+        nodServo.attach(SERVO_NOD_PIN, SERVO_PULSE_MIN, SERVO_PULSE_MAX);
+        headServo.writeMicroseconds(headPulse);
+        nodServo.writeMicroseconds(nodPulse);
+#if defined(ARDUINO_ARCH_STM32)
+        trajectoryTimer->resume();
+#endif
+#endif
+        attached = true;
+    } else {
+        attached = false;
+        tracePending = false;
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+        pwm.stop();
+#else
+#if defined(ARDUINO_ARCH_STM32)
+        trajectoryTimer->pause();
+#endif
+        headServo.detach();
+        nodServo.detach();
+#endif
+        powerStats.detachCount++;
+    }
+}
+
+void ServoController::beginMotion() {
+    // 调用方已屏蔽中断
+    if (!isPerforming()) {
+        actionStartTime = millis();
+        actionEnergy = 0;
+        actionPeakCurrent = 0;
+    }
+    
+    if (!attached) {
+        setPowered(true);
+        
+        // 输出先保持当前角度 SERVO_WAKE_LEAD_MS，舵机稳定后再开始运动
+        MotionSegment lead = {MOTION_AXIS_HOLD, SERVO_WAKE_LEAD_MS, motionProfile};
+        headTimeline.push(lead);
+        nodTimeline.push(lead);
+    }
+}
+
+void ServoController::applyPolicy(MotionTimeline& timeline, MotionQueuePolicy policy,
+                                  bool resting) {
+    switch (policy) {
+        case MotionQueuePolicy::FLUSH:
+            timeline.interrupt();
+            timeline.clear();
+            break;
+        case MotionQueuePolicy::REPLACE:
+            // 静止时正在执行的只是保持段，可以直接结束而不产生速度突变
+            if (resting) {
+                timeline.interrupt();
+            }
+            timeline.clear();
+            break;
+        default:
+            break;
+    }
+}
+
+bool ServoController::enqueueKeyframes(const MotionKeyframe* frames, uint8_t count,
+                                       MotionQueuePolicy policy) {
+    if (frames == nullptr || count == 0) return false;
+    
+    // 最坏情况：每帧都错峰（点头轴多一段保持），另加一段唤醒保持
+    uint8_t needed = count * (SERVO_STAGGER_MS > 0 ? 2 : 1) + 1;
+    if (needed > MOTION_QUEUE_CAPACITY) return false;
+    
+    noInterrupts();
+    
+    // 替换策略下旧关键帧会被丢弃，只需检查追加时的剩余空间
+    if (policy == MotionQueuePolicy::ENQUEUE &&
+        (headTimeline.space() < needed || nodTimeline.space() < needed)) {
+        interrupts();
+        return false;
+    }
+    
+    bool resting = !headTimeline.isInMotion() && !nodTimeline.isInMotion();
+    applyPolicy(headTimeline, policy, resting);
+    applyPolicy(nodTimeline, policy, resting);
+    beginMotion();
+    
+    for (uint8_t i = 0; i < count; i++) {
+        int16_t headTarget = frames[i].headAngle;
+        int16_t nodTarget = frames[i].nodAngle;
+        if (headTarget != MOTION_AXIS_HOLD) headTarget = constrain(headTarget, 0, 180);
+        if (nodTarget != MOTION_AXIS_HOLD) nodTarget = constrain(nodTarget, 0, 180);
+        
+        uint16_t headNeeded = headTimeline.minimumDuration(headTarget, frames[i].easing);
+        uint16_t nodNeeded = nodTimeline.minimumDuration(nodTarget, frames[i].easing);
+        
+        // 两轴同时运动时点头轴推迟 SERVO_STAGGER_MS 起步，错开加速段的电流峰值
+        uint16_t stagger = (headNeeded > 0 && nodNeeded > 0) ? SERVO_STAGGER_MS : 0;
+        
+        // 两轴取同一时长（较慢一轴所需），使关键帧在两轴上同时开始、同时结束
+        uint16_t duration = frames[i].duration;
+        if (headNeeded > duration) duration = headNeeded;
+        if (nodNeeded + stagger > duration) duration = nodNeeded + stagger;
+        
+        MotionSegment head = {headTarget, duration, frames[i].easing};
+        headTimeline.push(head);
+        
+        if (stagger > 0) {
+            MotionSegment wait = {MOTION_AXIS_HOLD, stagger, frames[i].easing};
+            nodTimeline.push(wait);
+        }
+        MotionSegment nod = {nodTarget, (uint16_t)(duration - stagger), frames[i].easing};
+        nodTimeline.push(nod);
+    }
+    
+    tracePending = true;
+    interrupts();
+    return true;
+}
+
+bool ServoController::enqueueAxis(ServoAxis axis, int16_t angle, uint16_t duration,
+                                  MotionProfile easing, MotionQueuePolicy policy) {
+    MotionTimeline& timeline = (axis == ServoAxis::HEAD) ? headTimeline : nodTimeline;
+    if (angle != MOTION_AXIS_HOLD) angle = constrain(angle, 0, 180);
+    MotionSegment segment = {angle, duration, easing};
+    
+    noInterrupts();
+    applyPolicy(timeline, policy, !timeline.isInMotion());
+    bool ok = timeline.space() >= 2;     // 留出唤醒保持段
+    if (ok) {
+        beginMotion();
+        timeline.push(segment);
+        tracePending = true;
+    }
+    interrupts();
+    return ok;
+}
+
+int16_t ServoController::reachableAngle(ServoAxis axis, int16_t angle, uint16_t duration,
+                                       MotionProfile easing) const {
+    if (angle == MOTION_AXIS_HOLD) {
+        return angle;
+    }
     angle = constrain(angle, 0, 180);
-    headPos = angle;
-    headServo.write(angle);
+    
+    const MotionTimeline& timeline = (axis == ServoAxis::HEAD) ? headTimeline : nodTimeline;
+    
+    noInterrupts();
+    int16_t reachable = (int16_t)(timeline.tailPosition() + 0.5f);
+    if (timeline.minimumDuration(angle, easing) <= duration) {
+        reachable = angle;
+    } else {
+        // 二分查找：reachable 可达，unreachable 不可达
+        int16_t unreachable = angle;
+        while (abs(unreachable - reachable) > 1) {
+            int16_t mid = (reachable + unreachable) / 2;
+            if (timeline.minimumDuration(mid, easing) <= duration) {
+                reachable = mid;
+            } else {
+                unreachable = mid;
+            }
+        }
+    }
+    interrupts();
+    
+    return reachable;
+}
+
+void ServoController::setHeadPosition(uint16_t angle) {
+    enqueueAxis(ServoAxis::HEAD, angle, 0, motionProfile, MotionQueuePolicy::FLUSH);
 }
 
 void ServoController::setNodPosition(uint16_t angle) {
-    angle = constrain(angle, 0, 180);
-    nodPos = angle;
-    nodServo.write(angle);
+    enqueueAxis(ServoAxis::NOD, angle, 0, motionProfile, MotionQueuePolicy::FLUSH);
+}
+
+void ServoController::setAxisLimits(const AxisLimits& head, const AxisLimits& nod) {
+    noInterrupts();
+    headTimeline.setLimits(head);
+    nodTimeline.setLimits(nod);
+    interrupts();
 }
 
-void ServoController::performAction(ServoAction action) {
-    if (isActing) return;  // 已在执行动作
+bool ServoController::performAction(ServoAction action, MotionQueuePolicy policy) {
+    const int16_t H = MOTION_AXIS_HOLD;
+    MotionProfile p = motionProfile;
     
-    currentAction = action;
-    actionStartTime = millis();
-    isActing = true;
+    // 到位 -> 保持 -> 回到中点
+    MotionKeyframe frames[3] = {
+        {H, H, 0, p},
+        {H, H, SERVO_ACTION_DURATION, p},
+        {90, 90, 0, p},
+    };
     
     switch (action) {
         case ServoAction::SHAKE_LEFT:
-            setHeadPosition(45);  // 摇到左边
+            frames[0].headAngle = 45;   // 摇到左边
             break;
         case ServoAction::SHAKE_RIGHT:
-            setHeadPosition(135); // 摇到右边
+            frames[0].headAngle = 135;  // 摇到右边
             break;
         case ServoAction::NOD_UP:
-            setNodPosition(30);   // 点头抬起
+            frames[0].nodAngle = 30;    // 点头抬起
             break;
         case ServoAction::NOD_DOWN:
-            setNodPosition(150);  // 点头低下
+            frames[0].nodAngle = 150;   // 点头低下
             break;
         case ServoAction::RESET:
-            setHeadPosition(90);
-            setNodPosition(90);
-            break;
+            return enqueueKeyframes(&frames[2], 1, policy);
         default:
-            isActing = false;
-            break;
+            return false;
     }
+    
+    return enqueueKeyframes(frames, 3, policy);
+}
+
+uint8_t ServoController::getQueuedFrames() const {
+    uint8_t head = headTimeline.pending();
+    uint8_t nod = nodTimeline.pending();
+    return head > nod ? head : nod;
 }
 
 void ServoController::update() {
-    if (!isActing) return;
+    // 轨迹与关键帧均在定时器或 DMA 中断中推进，这里只做功耗管理
+    unsigned long now = millis();
+    bool busy = isPerforming();
+    
+    if (attached) {
+        powerStats.activeTime += now - lastUpdateTime;
+    }
+    lastUpdateTime = now;
+    
+    if (busy) {
+        lastBusyTime = now;
+    } else if (wasBusy) {
+        // 动作结束：记录本次能耗
+        noInterrupts();
+        powerStats.lastActionEnergy = actionEnergy;
+        powerStats.lastActionPeakCurrent = actionPeakCurrent;
+        interrupts();
+        powerStats.lastActionTime = now - actionStartTime;
+        
+        LOG_DEBUG("[Servo] Action done: %lums, %.1fmJ, peak %.0fmA", powerStats.lastActionTime,
+                  powerStats.lastActionEnergy, powerStats.lastActionPeakCurrent);
+    }
+    wasBusy = busy;
     
-    // 检查动作是否完成（超时）
-    if (millis() - actionStartTime >= SERVO_ACTION_DURATION) {
-        // 恢复到中点
-        setHeadPosition(90);
-        setNodPosition(90);
-        isActing = false;
-        currentAction = ServoAction::IDLE;
+    // 空闲超时后关闭 PWM 输出，下一次入队动作时自动恢复
+    if (attached && !busy && now - lastBusyTime >= SERVO_IDLE_DETACH_MS) {
+        noInterrupts();
+        setPowered(false);
+        interrupts();
+        LOG_DEBUG("[Servo] Idle, PWM gated");
     }
 }
 
 void ServoController::stop() {
-    isActing = false;
-    currentAction = ServoAction::IDLE;
-    setHeadPosition(90);
-    setNodPosition(90);
+    MotionKeyframe home = {90, 90, 0, motionProfile};
+    enqueueKeyframes(&home, 1, MotionQueuePolicy::FLUSH);
 }
@@ -0,0 +1,283 @@
+#include "Servo_PWM.h"
+
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+
+#define SERVO_AXIS_HEAD 0
+#define SERVO_AXIS_NOD  1
+
+#if defined(ARDUINO_ARCH_STM32)
+
+typedef TIM_TypeDef ServoTimerRegs;
+typedef DMA_Stream_TypeDef ServoDmaStreamRegs;
+
+#define SERVO_HEAD_TIM         TIM5
+#define SERVO_NOD_TIM          TIM2
+#define SERVO_HEAD_DMA_STREAM  DMA1_Stream0     // TIM5_UP：DMA1 数据流 0 通道 6
+#define SERVO_NOD_DMA_STREAM   DMA1_Stream1     // TIM2_UP：DMA1 数据流 1 通道 3
+#define SERVO_DMA              DMA1
+#define SERVO_GPIO             GPIOA
+
+#else
+
+// ==================== 主机寄存器模型 ====================
+
+typedef ServoTimerModel ServoTimerRegs;
+typedef ServoDmaStreamModel ServoDmaStreamRegs;
+
+static ServoTimerModel hostTimers[2];
+static ServoDmaStreamModel hostStreams[2];
+static ServoDmaModel hostDma;
+static ServoGpioModel hostGpio;
+static uint32_t hostActive[2];
+
+#define SERVO_HEAD_TIM         (&hostTimers[SERVO_AXIS_HEAD])
+#define SERVO_NOD_TIM          (&hostTimers[SERVO_AXIS_NOD])
+#define SERVO_HEAD_DMA_STREAM  (&hostStreams[SERVO_AXIS_HEAD])
+#define SERVO_NOD_DMA_STREAM   (&hostStreams[SERVO_AXIS_NOD])
+#define SERVO_DMA              (&hostDma)
+#define SERVO_GPIO             (&hostGpio)
+
+// 主机没有 CMSIS 头文件，按参考手册补齐用到的位定义
+#define TIM_CR1_CEN            (1UL << 0)
+#define TIM_CR1_ARPE           (1UL << 7)
+#define TIM_DIER_UDE           (1UL << 8)
+#define TIM_EGR_UG             (1UL << 0)
+#define TIM_CCMR1_OC1PE        (1UL << 3)
+#define TIM_CCMR1_OC1M_1       (1UL << 5)
+#define TIM_CCMR1_OC1M_2       (1UL << 6)
+#define TIM_CCER_CC1E          (1UL << 0)
+#define DMA_SxCR_EN            (1UL << 0)
+#define DMA_SxCR_TEIE          (1UL << 2)
+#define DMA_SxCR_HTIE          (1UL << 3)
+#define DMA_SxCR_TCIE          (1UL << 4)
+#define DMA_SxCR_DIR_0         (1UL << 6)
+#define DMA_SxCR_CIRC          (1UL << 8)
+#define DMA_SxCR_MINC          (1UL << 10)
+#define DMA_SxCR_PSIZE_1       (1UL << 12)
+#define DMA_SxCR_MSIZE_1       (1UL << 14)
+#define DMA_SxCR_PL_1          (1UL << 17)
+#define DMA_SxCR_CHSEL_Pos     25
+#define DMA_LISR_TEIF0         (1UL << 3)
+#define DMA_LISR_HTIF0         (1UL << 4)
+#define DMA_LISR_TCIF0         (1UL << 5)
+
+#endif
+
+/**
+ * 单路 PWM 的硬件资源
+ */
+struct ServoPWMChannel {
+    ServoTimerRegs* timer;
+    ServoDmaStreamRegs* stream;
+    uint8_t dmaChannel;     // DMA 请求通道
+    uint8_t pin;            // GPIOA 引脚号
+    uint8_t alternate;      // 复用功能号
+};
+
+static const ServoPWMChannel SERVO_PWM_CHANNELS[2] = {
+    {SERVO_HEAD_TIM, SERVO_HEAD_DMA_STREAM, 6, 0, 2},   // PA0 -> TIM5_CH1
+    {SERVO_NOD_TIM,  SERVO_NOD_DMA_STREAM,  3, 5, 1},   // PA5 -> TIM2_CH1
+};
+
+// 摇头数据流的中断标志（数据流 0 位于 LISR 低位）
+static const uint32_t SERVO_DMA_FLAGS = DMA_LISR_TEIF0 | DMA_LISR_HTIF0 | DMA_LISR_TCIF0;
+
+ServoPWMBackend* ServoPWMBackend::instance = nullptr;
+
+ServoPWMBackend::ServoPWMBackend()
+    : frameCallback(nullptr), callbackContext(nullptr), refills(0), dmaErrors(0),
+      running(false) {
+}
+
+void ServoPWMBackend::setupChannel(uint8_t axis, uint32_t timerClock) {
+    const ServoPWMChannel& ch = SERVO_PWM_CHANNELS[axis];
+    uint32_t* frames = (axis == SERVO_AXIS_HEAD) ? headFrames : nodFrames;
+    ServoTimerRegs* tim = ch.timer;
+    ServoDmaStreamRegs* stream = ch.stream;
+
+    // GPIO：复用功能、高速
+    uint32_t shift2 = ch.pin * 2;
+    uint32_t shift4 = (ch.pin & 7) * 4;
+    SERVO_GPIO->MODER = (SERVO_GPIO->MODER & ~(3UL << shift2)) | (2UL << shift2);
+    SERVO_GPIO->OSPEEDR = (SERVO_GPIO->OSPEEDR & ~(3UL << shift2)) | (2UL << shift2);
+    SERVO_GPIO->AFR[ch.pin >> 3] = (SERVO_GPIO->AFR[ch.pin >> 3] & ~(0xFUL << shift4)) 
+                                   | ((uint32_t)ch.alternate << shift4);
+
+    // 定时器：1MHz 计数，PWM 模式 1，比较值预装载
+    tim->CR1 = 0;
+    tim->PSC = timerClock / 1000000UL - 1;
+    tim->ARR = 1000000UL / SERVO_PWM_FRAME_HZ - 1;
+    tim->CCR1 = frames[0];
+    tim->CCMR1 = (tim->CCMR1 & ~0xFFUL) | TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1PE;
+    tim->CCER |= TIM_CCER_CC1E;
+    tim->EGR = TIM_EGR_UG;      // 立即装载 PSC/ARR/CCR1
+
+    // DMA：内存 -> CCR1，32 位，循环模式；只有摇头数据流开中断
+    stream->CR = 0;
+    while (stream->CR & DMA_SxCR_EN) {}
+    stream->PAR = (uintptr_t)&tim->CCR1;
+    stream->M0AR = (uintptr_t)frames;
+    stream->NDTR = SERVO_DMA_BUFFER_FRAMES;
+    stream->FCR = 0;            // 直接模式
+    uint32_t cr = ((uint32_t)ch.dmaChannel << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_PL_1
+                | DMA_SxCR_MSIZE_1 | DMA_SxCR_PSIZE_1 | DMA_SxCR_MINC 
+                | DMA_SxCR_CIRC | DMA_SxCR_DIR_0;
+    if (axis == SERVO_AXIS_HEAD) {
+        cr |= DMA_SxCR_TEIE | DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+    }
+    stream->CR = cr;
+    stream->CR |= DMA_SxCR_EN;
+
+    tim->DIER |= TIM_DIER_UDE;  // 每个更新事件请求一次 DMA
+    tim->CR1 = TIM_CR1_ARPE;
+}
+
+void ServoPWMBackend::begin(uint16_t headPulse, uint16_t nodPulse,
+                            ServoFrameCallback callback, void* context) {
+    frameCallback = callback;
+    callbackContext = context;
+    instance = this;
+
+#if defined(ARDUINO_ARCH_STM32)
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    __HAL_RCC_TIM5_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+#endif
+
+    start(headPulse, nodPulse);
+}
+
+void ServoPWMBackend::start(uint16_t headPulse, uint16_t nodPulse) {
+    for (uint8_t i = 0; i < SERVO_DMA_BUFFER_FRAMES; i++) {
+        headFrames[i] = headPulse;
+        nodFrames[i] = nodPulse;
+    }
+
+#if defined(ARDUINO_ARCH_STM32)
+    uint32_t timerClock = getTimerClkFreq(TIM5);   // TIM2 与 TIM5 同在 APB1
+#else
+    uint32_t timerClock = 84000000UL;
+#endif
+
+    setupChannel(SERVO_AXIS_HEAD, timerClock);
+    setupChannel(SERVO_AXIS_NOD, timerClock);
+    SERVO_DMA->LIFCR = SERVO_DMA_FLAGS;
+
+    // 点头定时器先启动，其更新事件总略早于摇头定时器；
+    // 摇头数据流中断到来时，两路都已搬运完对应的半区，可以安全改写
+    SERVO_NOD_TIM->CR1 |= TIM_CR1_CEN;
+    SERVO_HEAD_TIM->CR1 |= TIM_CR1_CEN;
+    running = true;
+}
+
+void ServoPWMBackend::stop() {
+    for (uint8_t axis = 0; axis < 2; axis++) {
+        const ServoPWMChannel& ch = SERVO_PWM_CHANNELS[axis];
+        ch.timer->CR1 &= ~TIM_CR1_CEN;
+        ch.timer->DIER &= ~TIM_DIER_UDE;
+        ch.timer->CCER &= ~TIM_CCER_CC1E;    // 关闭输出，引脚保持低电平
+        ch.stream->CR &= ~DMA_SxCR_EN;
+    }
+    SERVO_DMA->LIFCR = SERVO_DMA_FLAGS;
+    running = false;
+}
+
+void ServoPWMBackend::handleDmaInterrupt() {
+    uint32_t flags = SERVO_DMA->LISR & SERVO_DMA_FLAGS;
+    SERVO_DMA->LIFCR = flags;
+
+    if (flags & DMA_LISR_TEIF0) {
+        dmaErrors++;
+    }
+    if (frameCallback == nullptr) {
+        return;
+    }
+
+    // 前半区播放完 -> 填充前半区；后半区同理。两者同时置位说明中断被延误，按先后顺序补齐
+    if (flags & DMA_LISR_HTIF0) {
+        frameCallback(callbackContext, headFrames, nodFrames, SERVO_DMA_HALF_FRAMES);
+        refills++;
+    }
+    if (flags & DMA_LISR_TCIF0) {
+        frameCallback(callbackContext, headFrames + SERVO_DMA_HALF_FRAMES, 
+                      nodFrames + SERVO_DMA_HALF_FRAMES, SERVO_DMA_HALF_FRAMES);
+        refills++;
+    }
+}
+
+#if defined(ARDUINO_ARCH_STM32)
+
+extern "C" void DMA1_Stream0_IRQHandler(void) {
+    ServoPWMBackend* backend = ServoPWMBackend::getInstance();
+    if (backend) {
+        backend->handleDmaInterrupt();
+    }
+}
+
+#else
+
+void ServoPWMBackend::hostUpdateEvent() {
+    // 与硬件启动顺序一致：点头定时器的更新事件先发生
+    const uint8_t order[2] = {SERVO_AXIS_NOD, SERVO_AXIS_HEAD};
+
+    // LIFCR 写 1 清除对应标志
+    hostDma.LISR &= ~hostDma.LIFCR;
+    hostDma.LIFCR = 0;
+
+    for (uint8_t k = 0; k < 2; k++) {
+        uint8_t axis = order[k];
+        ServoTimerModel& tim = hostTimers[axis];
+        ServoDmaStreamModel& stream = hostStreams[axis];
+        if (!(tim.CR1 & TIM_CR1_CEN)) {
+            hostActive[axis] = 0;       // 定时器停止，无脉冲
+            continue;
+        }
+
+        // 预装载的比较值在更新事件生效，决定本周期输出的脉宽
+        hostActive[axis] = tim.CCR1;
+
+        if ((tim.DIER & TIM_DIER_UDE) && (stream.CR & DMA_SxCR_EN)) {
+            const uint32_t* memory = (const uint32_t*)stream.M0AR;
+            tim.CCR1 = memory[SERVO_DMA_BUFFER_FRAMES - stream.NDTR];
+            stream.NDTR--;
+
+            if (axis == SERVO_AXIS_HEAD && stream.NDTR == SERVO_DMA_HALF_FRAMES) {
+                hostDma.LISR |= DMA_LISR_HTIF0;
+            }
+            if (stream.NDTR == 0) {
+                stream.NDTR = SERVO_DMA_BUFFER_FRAMES;     // 循环模式自动重装
+                if (axis == SERVO_AXIS_HEAD) {
+                    hostDma.LISR |= DMA_LISR_TCIF0;
+                }
+            }
+        }
+    }
+
+    uint32_t enabled = 0;
+    if (hostStreams[SERVO_AXIS_HEAD].CR & DMA_SxCR_HTIE) enabled |= DMA_LISR_HTIF0;
+    if (hostStreams[SERVO_AXIS_HEAD].CR & DMA_SxCR_TCIE) enabled |= DMA_LISR_TCIF0;
+    if ((hostDma.LISR & enabled) && instance) {
+        instance->handleDmaInterrupt();
+        hostDma.LISR &= ~hostDma.LIFCR;
+        hostDma.LIFCR = 0;
+    }
+}
+
+uint32_t ServoPWMBackend::hostActivePulse(uint8_t axis) {
+    return hostActive[axis];
+}
+
+const ServoTimerModel& ServoPWMBackend::hostTimer(uint8_t axis) {
+    return hostTimers[axis];
+}
+
+const ServoDmaStreamModel& ServoPWMBackend::hostDmaStream(uint8_t axis) {
+    return hostStreams[axis];
+}
+
+#endif
+
+#endif
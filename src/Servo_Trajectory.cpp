@@ -0,0 +1,116 @@
+#include "Servo_Trajectory.h"
+
+// 最小加加速度曲线的峰值速度、峰值加速度系数（相对 d/T 与 d/T²）
+static const float MIN_JERK_PEAK_VELOCITY = 1.875f;
+static const float MIN_JERK_PEAK_ACCEL = 5.7735f;
+
+ServoTrajectory::ServoTrajectory()
+    : startPos(90), distance(0), duration(0), accelTime(0), cruiseVelocity(0),
+      position(90), startTick(0), profile(MotionProfile::MINIMUM_JERK), moving(false) {
+}
+
+void ServoTrajectory::reset(float pos) {
+    startPos = pos;
+    distance = 0;
+    duration = 0;
+    position = pos;
+    moving = false;
+}
+
+float ServoTrajectory::plan(float target, MotionProfile type, const AxisLimits& limits,
+                            float minDuration, uint32_t nowTick) {
+    startPos = position;
+    distance = target - position;
+    profile = type;
+    startTick = nowTick;
+
+    float d = fabsf(distance);
+    float v = limits.maxVelocity;
+    float a = limits.maxAcceleration;
+
+    if (d < 0.01f) {
+        // 原地保持 minDuration
+        distance = 0;
+        duration = minDuration;
+        moving = duration > 0;
+        return duration;
+    }
+
+    float fastest = minimumDuration(d, type, limits);
+    duration = (minDuration > fastest) ? minDuration : fastest;
+
+    if (type == MotionProfile::TRAPEZOIDAL) {
+        if (d * a < v * v) {
+            cruiseVelocity = sqrtf(d * a);
+        } else {
+            cruiseVelocity = v;
+        }
+
+        if (duration > fastest) {
+            // 指定时长更长：保持加速度，降低匀速段速度 v² - aTv + ad = 0
+            float disc = a * a * duration * duration - 4.0f * a * d;
+            cruiseVelocity = (a * duration - sqrtf(disc)) * 0.5f;
+        }
+        accelTime = cruiseVelocity / a;
+    }
+
+    moving = true;
+    return duration;
+}
+
+float ServoTrajectory::minimumDuration(float distance, MotionProfile type, 
+                                       const AxisLimits& limits) {
+    float d = fabsf(distance);
+    float v = limits.maxVelocity;
+    float a = limits.maxAcceleration;
+
+    if (type == MotionProfile::TRAPEZOIDAL) {
+        // 距离不足以加速到最大速度时为三角形曲线
+        if (d * a < v * v) {
+            return 2.0f * sqrtf(d / a);
+        }
+        return d / v + v / a;
+    }
+
+    float byVelocity = MIN_JERK_PEAK_VELOCITY * d / v;
+    float byAccel = sqrtf(MIN_JERK_PEAK_ACCEL * d / a);
+    return (byAccel > byVelocity) ? byAccel : byVelocity;
+}
+
+float ServoTrajectory::sample(uint32_t nowTick) {
+    if (!moving) {
+        return position;
+    }
+
+    float t = (float)(nowTick - startTick) / SERVO_UPDATE_RATE_HZ;
+    if (t >= duration) {
+        position = startPos + distance;
+        moving = false;
+        return position;
+    }
+
+    float s;  // 已走过的比例 0~1
+    if (distance == 0) {
+        s = 0;
+    } else if (profile == MotionProfile::TRAPEZOIDAL) {
+        float d = fabsf(distance);
+        float a = cruiseVelocity / accelTime;
+        float travelled;
+        if (t < accelTime) {
+            travelled = 0.5f * a * t * t;
+        } else if (t < duration - accelTime) {
+            travelled = 0.5f * a * accelTime * accelTime + cruiseVelocity * (t - accelTime);
+        } else {
+            float remain = duration - t;
+            travelled = d - 0.5f * a * remain * remain;
+        }
+        s = travelled / d;
+    } else {
+        float tau = t / duration;
+        float tau3 = tau * tau * tau;
+        s = tau3 * (10.0f + tau * (-15.0f + 6.0f * tau));
+    }
+
+    position = startPos + distance * s;
+    return position;
+}
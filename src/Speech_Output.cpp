@@ -0,0 +1,167 @@
+#include "Speech_Output.h"
+
+SpeechOutputQueue::SpeechOutputQueue()
+    : current(-1), sentBytes(0), nextId(0), lastStartTime(0),
+      eventHead(0), eventCount(0) {
+    memset(slots, 0, sizeof(slots));
+    memset(events, 0, sizeof(events));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void SpeechOutputQueue::postEvent(uint16_t id, SpeechStatus status) {
+    if (eventCount >= SPEECH_EVENT_CAPACITY) {
+        // 无人读取事件时覆盖最旧的
+        eventHead = (eventHead + 1) % SPEECH_EVENT_CAPACITY;
+        eventCount--;
+    }
+    SpeechEvent& e = events[(eventHead + eventCount) % SPEECH_EVENT_CAPACITY];
+    e.id = id;
+    e.status = status;
+    eventCount++;
+}
+
+bool SpeechOutputQueue::pollEvent(SpeechEvent& event) {
+    if (eventCount == 0) {
+        return false;
+    }
+    event = events[eventHead];
+    eventHead = (eventHead + 1) % SPEECH_EVENT_CAPACITY;
+    eventCount--;
+    return true;
+}
+
+bool SpeechOutputQueue::isBusy() const {
+    if (current >= 0) {
+        return true;
+    }
+    for (uint8_t i = 0; i < SPEECH_QUEUE_CAPACITY; i++) {
+        if (slots[i].used) return true;
+    }
+    return false;
+}
+
+uint16_t SpeechOutputQueue::speak(const char* text, SpeechPriority priority, 
+                                  unsigned long now, unsigned long ttl) {
+    if (text == nullptr || text[0] == '\0') {
+        return 0;
+    }
+
+    // 找空槽位；没有则挤掉优先级最低的最早一条（正在发送的除外）
+    int8_t slot = -1;
+    int8_t victim = -1;
+    for (int8_t i = 0; i < SPEECH_QUEUE_CAPACITY; i++) {
+        if (!slots[i].used) {
+            slot = i;
+            break;
+        }
+        if (i == current) continue;
+        if (victim < 0 ||
+            slots[i].priority < slots[victim].priority ||
+            (slots[i].priority == slots[victim].priority &&
+             (int16_t)(slots[i].id - slots[victim].id) < 0)) {
+            victim = i;
+        }
+    }
+
+    if (slot < 0) {
+        stats.dropped++;
+        if (victim < 0 || priority < slots[victim].priority) {
+            return 0;
+        }
+        postEvent(slots[victim].id, SpeechStatus::DROPPED);
+        slot = victim;
+    }
+
+    Utterance& u = slots[slot];
+    uint8_t len = 0;
+    while (text[len] != '\0' && len < SPEECH_TEXT_MAX_LEN - 1) {
+        // 换行是 ASRPRO 的行结束符，文本内的换行改为空格
+        char c = text[len];
+        u.text[len] = (c == '\n' || c == '\r') ? ' ' : c;
+        len++;
+    }
+    // 截断时不拆开多字节 UTF-8 字符（中文），退回到被截字符的首字节之前
+    if (text[len] != '\0') {
+        while (len > 0 && ((uint8_t)text[len] & 0xC0) == 0x80) {
+            len--;
+        }
+    }
+    u.text[len] = '\0';
+    u.length = len;
+    u.priority = priority;
+    if (++nextId == 0) nextId = 1;
+    u.id = nextId;
+    u.queuedTime = now;
+    u.deadline = now + ttl;
+    u.used = true;
+
+    stats.queued++;
+    return u.id;
+}
+
+int8_t SpeechOutputQueue::selectNext(unsigned long now) {
+    int8_t best = -1;
+
+    for (int8_t i = 0; i < SPEECH_QUEUE_CAPACITY; i++) {
+        Utterance& u = slots[i];
+        if (!u.used) continue;
+
+        // 过期的播报直接取消
+        if ((long)(now - u.deadline) > 0) {
+            u.used = false;
+            stats.cancelled++;
+            postEvent(u.id, SpeechStatus::CANCELLED);
+            continue;
+        }
+
+        if (best < 0 ||
+            u.priority > slots[best].priority ||
+            (u.priority == slots[best].priority &&
+             (int16_t)(u.id - slots[best].id) < 0)) {
+            best = i;
+        }
+    }
+
+    // 非警告播报限流
+    if (best >= 0 && slots[best].priority != SpeechPriority::ALERT &&
+        now - lastStartTime < SPEECH_MIN_INTERVAL) {
+        return -1;
+    }
+
+    return best;
+}
+
+void SpeechOutputQueue::update(unsigned long now) {
+    if (current < 0) {
+        current = selectNext(now);
+        if (current < 0) {
+            return;
+        }
+        sentBytes = 0;
+        lastStartTime = now;
+    }
+
+    Utterance& u = slots[current];
+    int room = UART_ASRPRO.availableForWrite();
+
+    // 先写文本，再写结尾换行，每次最多写满串口发送缓冲区
+    if (room > 0 && sentBytes < u.length) {
+        uint8_t chunk = u.length - sentBytes;
+        if (chunk > room) chunk = room;
+        UART_ASRPRO.write((const uint8_t*)u.text + sentBytes, chunk);
+        sentBytes += chunk;
+        room -= chunk;
+    }
+
+    if (room > 0 && sentBytes == u.length) {
+        UART_ASRPRO.write((uint8_t)'\n');
+        sentBytes++;
+    }
+
+    if (sentBytes > u.length) {
+        u.used = false;
+        stats.completed++;
+        postEvent(u.id, SpeechStatus::COMPLETED);
+        current = -1;
+    }
+}
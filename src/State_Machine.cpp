@@ -1,224 +1,518 @@
 #include "State_Machine.h"
+#include "Latency_Trace.h"
+
+// ==================== 状态图 ====================
+
+typedef SystemState S;
+typedef FsmEvent E;
+
+static constexpr uint8_t FSM_STATE_COUNT = (uint8_t)SystemState::COUNT;
+static constexpr uint8_t FSM_EVENT_COUNT = (uint8_t)FsmEvent::COUNT;
+static constexpr uint8_t FSM_NO_TRANSITION = 0xFF;
+static constexpr uint8_t FSM_MAX_DEPTH = 4;
+static constexpr int16_t FSM_READING_NONE = INT16_MIN;
+
+struct FsmDispatchTable {
+    uint8_t row[FSM_STATE_COUNT][FSM_EVENT_COUNT];
+};
+
+struct StateChart {
+    typedef StateMachine SM;
+
+    /**
+     * 状态描述
+     */
+    struct StateInfo {
+        SystemState parent;           // 根状态的父状态为自身
+        uint16_t timeout;             // 进入后装载状态定时器（毫秒），0 表示无
+        SM::Action entry;
+        SM::Action exit;
+    };
+
+    /**
+     * 转移：源状态可以是复合状态，子状态未定义同一事件时继承
+     */
+    struct Transition {
+        SystemState source;
+        FsmEvent event;
+        SM::Guard guard;
+        SM::Action action;
+        SystemState target;           // 必须是叶子状态；与源状态相同表示内部转移
+    };
+
+    // 按 SystemState 顺序排列
+    static constexpr StateInfo STATES[FSM_STATE_COUNT] = {
+        // 父状态      超时    进入     退出
+        {S::TOP,      3000,   nullptr, nullptr},   // IDLE：3秒后自动进入监测
+        {S::TOP,      0,      &SM::actStartRefresh, &SM::actStopRefresh},  // MONITORING：运行读数刷新定时器
+        {S::TOP,      2000,   nullptr, nullptr},   // VOICE_TRIGGERED：动作完成后等2秒
+        {S::WARNING,  5000,   nullptr, nullptr},   // TEMP_WARNING：持续5秒后舵机提醒
+        {S::WARNING,  5000,   nullptr, nullptr},   // HUMID_WARNING
+        {S::TOP,      3000,   nullptr, nullptr},   // WEATHER_DISPLAY：3秒后回到监测
+        {S::TOP,      0,      nullptr, nullptr},   // WARNING
+        {S::TOP,      0,      nullptr, nullptr},   // TOP
+    };
+
+    static constexpr Transition TRANSITIONS[] = {
+        // 源状态             事件               守卫                  动作                     目标
+        {S::TOP,             E::VOICE,          nullptr,              &SM::actVoiceCommand,    S::VOICE_TRIGGERED},
+        {S::IDLE,            E::TIMEOUT,        nullptr,              nullptr,                 S::MONITORING},
+        {S::MONITORING,      E::TEMP_HIGH,      nullptr,              &SM::actShowHot,         S::TEMP_WARNING},
+        {S::MONITORING,      E::TEMP_LOW,       nullptr,              &SM::actShowCold,        S::TEMP_WARNING},
+        {S::MONITORING,      E::HUMID_ABNORMAL, nullptr,              &SM::actShowHumid,       S::HUMID_WARNING},
+        {S::MONITORING,      E::REFRESH,        &SM::guardReadingsChanged, &SM::actRefreshReadings, S::MONITORING},
+        {S::VOICE_TRIGGERED, E::TIMEOUT,        &SM::guardMotionIdle, nullptr,                 S::MONITORING},
+        {S::WARNING,         E::TEMP_HIGH,      nullptr,              &SM::actShowHot,         S::TEMP_WARNING},
+        {S::WARNING,         E::TEMP_LOW,       nullptr,              &SM::actShowCold,        S::TEMP_WARNING},
+        {S::WARNING,         E::HUMID_ABNORMAL, nullptr,              &SM::actShowHumid,       S::HUMID_WARNING},
+        {S::WARNING,         E::ENV_NORMAL,     nullptr,              &SM::actShowNormal,      S::MONITORING},
+        {S::TEMP_WARNING,    E::TIMEOUT,        &SM::guardMotionIdle, &SM::actWarnShakeLeft,   S::TEMP_WARNING},
+        {S::HUMID_WARNING,   E::TIMEOUT,        &SM::guardMotionIdle, &SM::actWarnShakeRight,  S::HUMID_WARNING},
+        {S::WEATHER_DISPLAY, E::TIMEOUT,        nullptr,              nullptr,                 S::MONITORING},
+    };
+
+    static constexpr uint8_t TRANSITION_COUNT = sizeof(TRANSITIONS) / sizeof(TRANSITIONS[0]);
+
+    static constexpr SystemState parentOf(SystemState s) {
+        return STATES[(uint8_t)s].parent;
+    }
+
+    static constexpr bool isLeaf(SystemState s) {
+        for (uint8_t i = 0; i < FSM_STATE_COUNT; i++) {
+            if ((uint8_t)STATES[i].parent != i && STATES[i].parent == s) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr uint8_t depthOf(SystemState s) {
+        uint8_t depth = 0;
+        while (parentOf(s) != s && depth <= FSM_MAX_DEPTH) {
+            s = parentOf(s);
+            depth++;
+        }
+        return depth;
+    }
+
+    /**
+     * 状态图合法性：层次有限、转移目标均为叶子、同一状态同一事件只有一条转移
+     */
+    static constexpr bool isValid() {
+        for (uint8_t i = 0; i < FSM_STATE_COUNT; i++) {
+            if (depthOf((SystemState)i) >= FSM_MAX_DEPTH) return false;
+        }
+        for (uint8_t i = 0; i < TRANSITION_COUNT; i++) {
+            if (!isLeaf(TRANSITIONS[i].target)) return false;
+            for (uint8_t j = i + 1; j < TRANSITION_COUNT; j++) {
+                if (TRANSITIONS[i].source == TRANSITIONS[j].source &&
+                    TRANSITIONS[i].event == TRANSITIONS[j].event) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * 展开继承：每个 [状态][事件] 直接指向生效的转移
+     */
+    static constexpr FsmDispatchTable buildDispatch() {
+        FsmDispatchTable table{};
+        for (uint8_t s = 0; s < FSM_STATE_COUNT; s++) {
+            for (uint8_t e = 0; e < FSM_EVENT_COUNT; e++) {
+                table.row[s][e] = FSM_NO_TRANSITION;
+                SystemState state = (SystemState)s;
+                for (uint8_t level = 0; level < FSM_MAX_DEPTH; level++) {
+                    for (uint8_t t = 0; t < TRANSITION_COUNT; t++) {
+                        if (TRANSITIONS[t].source == state && (uint8_t)TRANSITIONS[t].event == e) {
+                            table.row[s][e] = t;
+                            break;
+                        }
+                    }
+                    if (table.row[s][e] != FSM_NO_TRANSITION || parentOf(state) == state) {
+                        break;
+                    }
+                    state = parentOf(state);
+                }
+            }
+        }
+        return table;
+    }
+
+    /**
+     * a 是否为 b 本身或 b 的祖先
+     */
+    static bool isSelfOrAncestor(SystemState a, SystemState b) {
+        for (uint8_t level = 0; level < FSM_MAX_DEPTH; level++) {
+            if (a == b) return true;
+            if (parentOf(b) == b) break;
+            b = parentOf(b);
+        }
+        return false;
+    }
+};
+
+constexpr StateChart::StateInfo StateChart::STATES[];
+constexpr StateChart::Transition StateChart::TRANSITIONS[];
+
+static_assert(StateChart::isValid(), "invalid state chart");
+static_assert(StateChart::TRANSITION_COUNT < FSM_NO_TRANSITION, "too many transitions");
+
+// 编译期展开的分派表，运行时按 [状态][事件] 一次查表
+static constexpr FsmDispatchTable FSM_DISPATCH = StateChart::buildDispatch();
+
+// ==================== 状态机 ====================
 
 StateMachine::StateMachine() 
     : currentState(SystemState::IDLE), previousState(SystemState::IDLE),
-      stateChangeTime(0), lastActionTime(0),
-      display(nullptr), servo(nullptr), dhtManager(nullptr), asrModule(nullptr) {
+      stateChangeTime(0),
+      emotionShown(false), shownTemp(FSM_READING_NONE), shownHumidity(FSM_READING_NONE),
+      redrawCount(0),
+      display(nullptr), servo(nullptr), dhtManager(nullptr), asrModule(nullptr),
+      motion(nullptr), traceHead(0), traceCount(0) {
+    for (uint8_t i = 0; i < (uint8_t)FsmTimerId::COUNT; i++) {
+        timers[i].armed = false;
+    }
 }
 
 void StateMachine::begin(OLEDDisplay* disp, ServoController* srv,
-                         DHTManager* dht, ASRPROModule* asr) {
+                         DHTManager* dht, ASRPROModule* asr, MotionArbiter* arbiter) {
     display = disp;
     servo = srv;
     dhtManager = dht;
     asrModule = asr;
+    motion = arbiter;
     
     currentState = SystemState::IDLE;
     stateChangeTime = millis();
+    cancelTimer(FsmTimerId::REFRESH);
+    armStateTimer();
 }
 
-void StateMachine::transitionTo(SystemState newState) {
-    if (newState != currentState) {
-        previousState = currentState;
-        currentState = newState;
-        stateChangeTime = millis();
-        lastActionTime = millis();
-        
-        Serial.print("[FSM] State transition: ");
-        Serial.print((int)previousState);
-        Serial.print(" -> ");
-        Serial.println((int)newState);
+bool StateMachine::dispatch(FsmEvent event, uint8_t arg) {
+    uint8_t index = FSM_DISPATCH.row[(uint8_t)currentState][(uint8_t)event];
+    if (index == FSM_NO_TRANSITION) {
+        return false;
+    }
+    
+    const StateChart::Transition& t = StateChart::TRANSITIONS[index];
+    if (t.guard && !(this->*t.guard)(arg)) {
+        return false;
+    }
+    
+    // 内部转移：环境事件每个周期都会触发，警告提醒每 5 秒一次，全部记录会在一次持续的警告中
+    // 挤掉全部状态变化；只记录语音指令与改变了屏幕表情的环境事件，读数刷新不记录
+    if (StateChart::isSelfOrAncestor(t.target, currentState)) {
+        uint32_t redraws = redrawCount;
+        if (t.action) (this->*t.action)(arg);
+        bool changed = redrawCount != redraws && event != FsmEvent::REFRESH;
+        if (changed || event == FsmEvent::VOICE) {
+            recordTrace(currentState, currentState, event, arg);
+        }
+        return true;
+    }
+    
+    // 外部转移：从当前状态退出到公共祖先，执行转移动作，再逐层进入目标
+    SystemState from = currentState;
+    SystemState s = from;
+    while (!StateChart::isSelfOrAncestor(s, t.target)) {
+        const StateChart::StateInfo& info = StateChart::STATES[(uint8_t)s];
+        if (info.exit) (this->*info.exit)(arg);
+        s = info.parent;
     }
+    
+    if (t.action) (this->*t.action)(arg);
+    
+    SystemState path[FSM_MAX_DEPTH];
+    uint8_t depth = 0;
+    for (SystemState e = t.target; e != s && depth < FSM_MAX_DEPTH; e = StateChart::parentOf(e)) {
+        path[depth++] = e;
+    }
+    while (depth > 0) {
+        const StateChart::StateInfo& info = StateChart::STATES[(uint8_t)path[--depth]];
+        if (info.entry) (this->*info.entry)(arg);
+    }
+    
+    previousState = from;
+    currentState = t.target;
+    stateChangeTime = millis();
+    armStateTimer();
+    recordTrace(from, currentState, event, arg);
+    return true;
+}
+
+// ==================== 定时器 ====================
+
+void StateMachine::armTimer(FsmTimerId id, uint16_t delay, uint16_t period) {
+    FsmTimer& timer = timers[(uint8_t)id];
+    timer.deadline = millis() + delay;
+    timer.period = period;
+    timer.armed = true;
 }
 
-void StateMachine::processVoiceCommand(VoiceCommand cmd) {
-    if (!servo || !display) return;
+void StateMachine::cancelTimer(FsmTimerId id) {
+    timers[(uint8_t)id].armed = false;
+}
+
+void StateMachine::armStateTimer() {
+    uint16_t timeout = StateChart::STATES[(uint8_t)currentState].timeout;
+    if (timeout > 0) {
+        armTimer(FsmTimerId::STATE, timeout, 0);
+    } else {
+        cancelTimer(FsmTimerId::STATE);
+    }
+}
+
+bool StateMachine::timerExpired(FsmTimerId id, unsigned long now) {
+    FsmTimer& timer = timers[(uint8_t)id];
+    if (!timer.armed || (long)(now - timer.deadline) < 0) {
+        return false;
+    }
     
-    Serial.print("[FSM] Processing voice command: ");
-    Serial.println((int)cmd);
+    if (timer.period == 0) {
+        timer.armed = false;
+    } else {
+        // 按固定节拍装载下一周期；落后超过一个周期时从当前时刻重新对齐
+        timer.deadline += timer.period;
+        if ((long)(now - timer.deadline) >= 0) {
+            timer.deadline = now + timer.period;
+        }
+    }
+    return true;
+}
+
+// ==================== 屏幕 ====================
+
+/**
+ * 读数换算为屏幕显示精度（0.1）
+ */
+static int16_t toDisplayTenths(float value) {
+    if (isnan(value)) {
+        return FSM_READING_NONE;
+    }
+    return (int16_t)lroundf(value * 10.0f);
+}
+
+void StateMachine::showEmotion(EmotionState emotion) {
+    if (emotionShown && display->getEmotion() == emotion) {
+        return;
+    }
+    display->setEmotion(emotion);
+    emotionShown = true;
+    shownTemp = FSM_READING_NONE;
+    shownHumidity = FSM_READING_NONE;
+    redrawCount++;
+}
+
+void StateMachine::showReadings() {
+    float temp = dhtManager->getTemperature();
+    float humidity = dhtManager->getHumidity();
+    display->displayTempHumidity(temp, humidity);
+    emotionShown = false;
+    shownTemp = toDisplayTenths(temp);
+    shownHumidity = toDisplayTenths(humidity);
+    redrawCount++;
+}
+
+void StateMachine::recordTrace(SystemState from, SystemState to, FsmEvent event, uint8_t arg) {
+    FsmTraceEntry& entry = trace[(traceHead + traceCount) % FSM_TRACE_CAPACITY];
+    entry.time = millis();
+    entry.from = from;
+    entry.to = to;
+    entry.event = event;
+    entry.arg = arg;
     
-    switch (cmd) {
+    if (traceCount < FSM_TRACE_CAPACITY) {
+        traceCount++;
+    } else {
+        traceHead = (traceHead + 1) % FSM_TRACE_CAPACITY;
+    }
+}
+
+bool StateMachine::getTrace(uint8_t index, FsmTraceEntry& entry) const {
+    if (index >= traceCount) {
+        return false;
+    }
+    entry = trace[(traceHead + index) % FSM_TRACE_CAPACITY];
+    return true;
+}
+
+void StateMachine::printTrace(Print& out) const {
+    out.println("[FSM] Transition trace:");
+    FsmTraceEntry entry;
+    for (uint8_t i = 0; getTrace(i, entry); i++) {
+        out.print("  ");
+        out.print(entry.time);
+        out.print("ms ");
+        out.print((int)entry.from);
+        out.print(" -> ");
+        out.print((int)entry.to);
+        out.print(" event=");
+        out.print((int)entry.event);
+        out.print(" arg=");
+        out.println(entry.arg);
+    }
+}
+
+// ==================== 守卫 ====================
+
+bool StateMachine::guardMotionIdle(uint8_t) {
+    return motion->isIdle();
+}
+
+bool StateMachine::guardReadingsChanged(uint8_t) {
+    // 屏幕上显示的是表情，或读数按显示精度有变化
+    return emotionShown || shownTemp == FSM_READING_NONE ||
+           toDisplayTenths(dhtManager->getTemperature()) != shownTemp ||
+           toDisplayTenths(dhtManager->getHumidity()) != shownHumidity;
+}
+
+// ==================== 动作 ====================
+
+void StateMachine::actVoiceCommand(uint8_t arg) {
+    switch ((VoiceCommand)arg) {
         case VoiceCommand::HAPPY:
-            display->setEmotion(EmotionState::HAPPY);
-            servo->performAction(ServoAction::NOD_UP);
+            showEmotion(EmotionState::HAPPY);
+            motion->submit(ServoAction::NOD_UP, MotionSource::VOICE);
             break;
             
         case VoiceCommand::SAD:
-            display->setEmotion(EmotionState::SAD);
-            servo->performAction(ServoAction::NOD_DOWN);
+            showEmotion(EmotionState::SAD);
+            motion->submit(ServoAction::NOD_DOWN, MotionSource::VOICE);
             break;
             
         case VoiceCommand::ANGRY:
-            display->setEmotion(EmotionState::ANGRY);
-            servo->performAction(ServoAction::SHAKE_LEFT);
+            showEmotion(EmotionState::ANGRY);
+            motion->submit(ServoAction::SHAKE_LEFT, MotionSource::VOICE);
             break;
             
         case VoiceCommand::SLEEPY:
-            display->setEmotion(EmotionState::SLEEPY);
-            servo->performAction(ServoAction::RESET);
+            showEmotion(EmotionState::SLEEPY);
+            motion->submit(ServoAction::RESET, MotionSource::VOICE);
             break;
             
         case VoiceCommand::SURPRISED:
-            display->setEmotion(EmotionState::SURPRISED);
-            servo->performAction(ServoAction::NOD_UP);
+            showEmotion(EmotionState::SURPRISED);
+            motion->submit(ServoAction::NOD_UP, MotionSource::VOICE);
             break;
             
         case VoiceCommand::SHAKE:
-            servo->performAction(ServoAction::SHAKE_RIGHT);
+            motion->submit(ServoAction::SHAKE_RIGHT, MotionSource::VOICE);
             break;
             
         case VoiceCommand::NOD:
-            servo->performAction(ServoAction::NOD_UP);
+            motion->submit(ServoAction::NOD_UP, MotionSource::VOICE);
             break;
             
         case VoiceCommand::QUERY_TEMP:
             // 显示温湿度信息
-            if (dhtManager) {
-                display->displayTempHumidity(
-                    dhtManager->getTemperature(),
-                    dhtManager->getHumidity()
-                );
+            if (guardReadingsChanged(arg)) {
+                showReadings();
             }
             break;
             
         default:
             break;
     }
-    
-    transitionTo(SystemState::VOICE_TRIGGERED);
 }
 
-void StateMachine::checkEnvironmentalThresholds() {
-    if (!dhtManager || !display) return;
-    
-    if (!dhtManager->getIsValid()) {
-        Serial.println("[FSM] DHT sensor reading invalid");
-        return;
-    }
-    
-    if (dhtManager->isTempHigh()) {
-        display->setEmotion(EmotionState::HOT_WARNING);
-        transitionTo(SystemState::TEMP_WARNING);
-    } 
-    else if (dhtManager->isTempLow()) {
-        display->setEmotion(EmotionState::COLD_WARNING);
-        transitionTo(SystemState::TEMP_WARNING);
-    }
-    else if (dhtManager->isHumidityHigh() || dhtManager->isHumidityLow()) {
-        display->setEmotion(EmotionState::HUMID_WARNING);
-        transitionTo(SystemState::HUMID_WARNING);
-    }
-    else {
-        // 环境正常
-        if (currentState == SystemState::TEMP_WARNING || 
-            currentState == SystemState::HUMID_WARNING) {
-            transitionTo(SystemState::MONITORING);
-            display->setEmotion(EmotionState::NORMAL);
-        }
-    }
+void StateMachine::actShowHot(uint8_t) {
+    showEmotion(EmotionState::HOT_WARNING);
 }
 
-void StateMachine::handleIdleState() {
-    // 空闲状态：等待触发事件或转移到监测状态
-    if (getStateElapsedTime() > 3000) {  // 3秒后自动进入监测状态
-        transitionTo(SystemState::MONITORING);
-    }
+void StateMachine::actShowCold(uint8_t) {
+    showEmotion(EmotionState::COLD_WARNING);
 }
 
-void StateMachine::handleMonitoringState() {
-    // 监测状态：定期读取传感器数据，检查阈值
-    checkEnvironmentalThresholds();
-    
-    // 定期更新显示
-    if (getStateElapsedTime() % 2000 < 100) {
-        if (dhtManager && display) {
-            display->displayTempHumidity(
-                dhtManager->getTemperature(),
-                dhtManager->getHumidity()
-            );
-        }
-    }
+void StateMachine::actShowHumid(uint8_t) {
+    showEmotion(EmotionState::HUMID_WARNING);
 }
 
-void StateMachine::handleVoiceTriggeredState() {
-    // 语音触发状态：执行完动作后回到监测状态
-    if (servo && !servo->isPerforming()) {
-        if (getStateElapsedTime() > 2000) {  // 动作完成后等2秒
-            transitionTo(SystemState::MONITORING);
-        }
-    }
+void StateMachine::actShowNormal(uint8_t) {
+    showEmotion(EmotionState::NORMAL);
 }
 
-void StateMachine::handleTempWarningState() {
-    // 温度警告状态：等待条件恢复
-    checkEnvironmentalThresholds();
-    
-    // 如果警告持续超过10秒，可以触发舵机动作
-    if (getStateElapsedTime() > 5000 && 
-        servo && !servo->isPerforming()) {
-        // 执行一个警告动作（如摇头）
-        servo->performAction(ServoAction::SHAKE_LEFT);
-    }
+void StateMachine::actRefreshReadings(uint8_t) {
+    showReadings();
 }
 
-void StateMachine::handleHumidWarningState() {
-    // 湿度警告状态
-    checkEnvironmentalThresholds();
-    
-    if (getStateElapsedTime() > 5000 && 
-        servo && !servo->isPerforming()) {
-        servo->performAction(ServoAction::SHAKE_RIGHT);
-    }
+void StateMachine::actStartRefresh(uint8_t) {
+    // 进入监测时立即显示一次读数，之后按周期检查
+    armTimer(FsmTimerId::REFRESH, 0, FSM_REFRESH_INTERVAL);
 }
 
-void StateMachine::handleWeatherDisplayState() {
-    // 天气显示状态：3秒后回到监测状态
-    if (getStateElapsedTime() > 3000) {
-        transitionTo(SystemState::MONITORING);
+void StateMachine::actStopRefresh(uint8_t) {
+    cancelTimer(FsmTimerId::REFRESH);
+}
+
+void StateMachine::actWarnShakeLeft(uint8_t) {
+    // 警告动作不抢占、不排队，只在舵机空闲时执行，不会挤掉语音或云端动作
+    motion->submit(ServoAction::SHAKE_LEFT, MotionSource::WARNING, MotionPreempt::NONE, 0);
+}
+
+void StateMachine::actWarnShakeRight(uint8_t) {
+    motion->submit(ServoAction::SHAKE_RIGHT, MotionSource::WARNING, MotionPreempt::NONE, 0);
+}
+
+// ==================== 主流程 ====================
+
+bool StateMachine::evaluateEnvironment(FsmEvent& event) {
+    if (!dhtManager->getIsValid()) {
+        return false;
+    }
+    
+    if (dhtManager->isTempHigh()) {
+        event = FsmEvent::TEMP_HIGH;
+    } else if (dhtManager->isTempLow()) {
+        event = FsmEvent::TEMP_LOW;
+    } else if (dhtManager->isHumidityHigh() || dhtManager->isHumidityLow()) {
+        event = FsmEvent::HUMID_ABNORMAL;
+    } else {
+        event = FsmEvent::ENV_NORMAL;
     }
+    return true;
 }
 
 void StateMachine::update() {
-    if (!display || !servo || !dhtManager || !asrModule) {
+    if (!display || !servo || !dhtManager || !asrModule || !motion) {
         return;
     }
     
     // 更新舵机状态
     servo->update();
     
-    // 读取语音指令
-    VoiceCommand voiceCmd = asrModule->getLastCommand();
-    if (voiceCmd != VoiceCommand::UNKNOWN) {
-        processVoiceCommand(voiceCmd);
+    // 读取语音指令：每次只处理队列中优先级最高的一条，其余留到后续周期
+    VoiceCommandEntry voiceEntry;
+    if (asrModule->nextCommand(voiceEntry)) {
+        g_latencyTracer.beginTrace(voiceEntry.command, 
+                                   voiceEntry.rxCycles, voiceEntry.matchCycles);
+        dispatch(FsmEvent::VOICE, (uint8_t)voiceEntry.command);
+        // 有运动入队时由舵机 PWM 中断在提交输出时结束追踪
+        if (!servo->isTracePending()) {
+            g_latencyTracer.endTrace();
+        }
     }
     
-    // 根据当前状态执行相应的处理逻辑
-    switch (currentState) {
-        case SystemState::IDLE:
-            handleIdleState();
-            break;
-            
-        case SystemState::MONITORING:
-            handleMonitoringState();
-            break;
-            
-        case SystemState::VOICE_TRIGGERED:
-            handleVoiceTriggeredState();
-            break;
-            
-        case SystemState::TEMP_WARNING:
-            handleTempWarningState();
-            break;
-            
-        case SystemState::HUMID_WARNING:
-            handleHumidWarningState();
-            break;
-            
-        case SystemState::WEATHER_DISPLAY:
-            handleWeatherDisplayState();
-            break;
-            
-        default:
-            break;
+    // 环境事件：只有监测与警告状态处理
+    FsmEvent envEvent;
+    if (evaluateEnvironment(envEvent)) {
+        dispatch(envEvent);
+    }
+    
+    // 定时器：到期时各投递一次事件
+    unsigned long now = millis();
+    if (timerExpired(FsmTimerId::STATE, now)) {
+        SystemState before = currentState;
+        dispatch(FsmEvent::TIMEOUT);
+        
+        // 超时未引起状态变化（守卫拒绝或内部转移），稍后再投递
+        if (currentState == before) {
+            armTimer(FsmTimerId::STATE, FSM_TIMER_RETRY_MS, 0);
+        }
+    }
+    
+    if (timerExpired(FsmTimerId::REFRESH, now)) {
+        dispatch(FsmEvent::REFRESH);
     }
 }
@@ -0,0 +1,143 @@
+#include "Voice_Command_Queue.h"
+
+// 按 VoiceCommand 顺序：查询类用户在等回答，优先处理；表情次之；单纯动作最后
+static const uint8_t VOICE_COMMAND_PRIORITY[] = {
+    0,  // UNKNOWN
+    5,  // HAPPY
+    5,  // SAD
+    5,  // ANGRY
+    5,  // SLEEPY
+    5,  // SURPRISED
+    3,  // SHAKE
+    3,  // NOD
+    8,  // QUERY_WEATHER
+    8,  // QUERY_TEMP
+    9   // HELP
+};
+
+uint8_t voiceCommandPriority(VoiceCommand cmd) {
+    uint8_t index = (uint8_t)cmd;
+    if (index >= sizeof(VOICE_COMMAND_PRIORITY)) {
+        return 0;
+    }
+    return VOICE_COMMAND_PRIORITY[index];
+}
+
+VoiceCommandQueue::VoiceCommandQueue()
+    : count(0), nextId(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void VoiceCommandQueue::removeAt(uint8_t index) {
+    for (uint8_t i = index; i + 1 < count; i++) {
+        entries[i] = entries[i + 1];
+    }
+    count--;
+}
+
+void VoiceCommandQueue::expire(unsigned long now) {
+    uint8_t i = 0;
+    while (i < count) {
+        // 按首次到达计龄：反复重说不会让指令一直留在队列里
+        if (now - entries[i].timestamp > VOICE_COMMAND_MAX_AGE) {
+            removeAt(i);
+            stats.expired++;
+        } else {
+            i++;
+        }
+    }
+}
+
+uint16_t VoiceCommandQueue::push(VoiceCommand cmd, VoiceSource source, 
+                                 uint8_t confidence, unsigned long now,
+                                 uint32_t rxCycles, uint32_t matchCycles) {
+    if (cmd == VoiceCommand::UNKNOWN) {
+        return 0;
+    }
+
+    expire(now);
+
+    // 合并窗口内的相同指令
+    for (uint8_t i = count; i-- > 0; ) {
+        VoiceCommandEntry& e = entries[i];
+        if (e.command == cmd && now - e.lastSeen <= VOICE_COALESCE_WINDOW) {
+            if (e.repeats < 255) e.repeats++;
+            if (confidence > e.confidence) e.confidence = confidence;
+            e.lastSeen = now;
+            stats.coalesced++;
+            return e.id;
+        }
+    }
+
+    // 队列已满：挤掉优先级最低的最早一条，新指令优先级更低时丢弃新指令
+    if (count >= VOICE_QUEUE_CAPACITY) {
+        uint8_t victim = 0;
+        for (uint8_t i = 1; i < count; i++) {
+            if (voiceCommandPriority(entries[i].command) < 
+                voiceCommandPriority(entries[victim].command)) {
+                victim = i;
+            }
+        }
+
+        stats.dropped++;
+        if (voiceCommandPriority(cmd) < voiceCommandPriority(entries[victim].command)) {
+            return 0;
+        }
+        removeAt(victim);
+    }
+
+    if (++nextId == 0) nextId = 1;
+
+    VoiceCommandEntry& e = entries[count++];
+    e.command = cmd;
+    e.source = source;
+    e.confidence = confidence;
+    e.repeats = 0;
+    e.id = nextId;
+    e.timestamp = now;
+    e.lastSeen = now;
+    e.rxCycles = rxCycles;
+    e.matchCycles = matchCycles;
+    stats.enqueued++;
+    return e.id;
+}
+
+uint16_t VoiceCommandQueue::replace(uint16_t id, VoiceCommand cmd, VoiceSource source, 
+                                    uint8_t confidence, unsigned long now,
+                                    uint32_t rxCycles, uint32_t matchCycles) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (entries[i].id != id) continue;
+
+        if (entries[i].repeats > 0) {
+            // 条目合并过更早的同名指令，只撤销本次这一份
+            entries[i].repeats--;
+            stats.coalesced--;
+        } else {
+            removeAt(i);
+            stats.enqueued--;
+        }
+        break;
+    }
+
+    return push(cmd, source, confidence, now, rxCycles, matchCycles);
+}
+
+bool VoiceCommandQueue::pop(VoiceCommandEntry& out, unsigned long now) {
+    expire(now);
+
+    if (count == 0) {
+        return false;
+    }
+
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < count; i++) {
+        if (voiceCommandPriority(entries[i].command) > 
+            voiceCommandPriority(entries[best].command)) {
+            best = i;
+        }
+    }
+
+    out = entries[best];
+    removeAt(best);
+    return true;
+}
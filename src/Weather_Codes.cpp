@@ -0,0 +1,66 @@
+#include "Weather_Codes.h"
+
+/**
+ * 单个天气代码条目
+ */
+struct WeatherCodeEntry {
+    char text[WEATHER_TEXT_MAX_LEN];
+    WeatherType type;
+};
+
+// 按心知天气代码 0~38 顺序排列，下标即代码
+static const WeatherCodeEntry WEATHER_CODE_TABLE[WEATHER_CODE_MAX + 1] PROGMEM = {
+    {"Sunny",          WeatherType::SUNNY},   // 0  晴（白天）
+    {"Clear",          WeatherType::SUNNY},   // 1  晴（夜晚）
+    {"Fair",           WeatherType::SUNNY},   // 2  晴（白天）
+    {"Fair",           WeatherType::SUNNY},   // 3  晴（夜晚）
+    {"Cloudy",         WeatherType::CLOUDY},  // 4  多云
+    {"Partly Cloudy",  WeatherType::CLOUDY},  // 5  晴间多云
+    {"Partly Cloudy",  WeatherType::CLOUDY},  // 6  晴间多云
+    {"Mostly Cloudy",  WeatherType::CLOUDY},  // 7  大部多云
+    {"Mostly Cloudy",  WeatherType::CLOUDY},  // 8  大部多云
+    {"Overcast",       WeatherType::CLOUDY},  // 9  阴
+    {"Shower",         WeatherType::RAINY},   // 10 阵雨
+    {"Thundershower",  WeatherType::STORMY},  // 11 雷阵雨
+    {"T-storm Hail",   WeatherType::STORMY},  // 12 雷阵雨伴有冰雹
+    {"Light Rain",     WeatherType::RAINY},   // 13 小雨
+    {"Moderate Rain",  WeatherType::RAINY},   // 14 中雨
+    {"Heavy Rain",     WeatherType::RAINY},   // 15 大雨
+    {"Rain Storm",     WeatherType::RAINY},   // 16 暴雨
+    {"Heavy Storm",    WeatherType::RAINY},   // 17 大暴雨
+    {"Severe Storm",   WeatherType::RAINY},   // 18 特大暴雨
+    {"Ice Rain",       WeatherType::RAINY},   // 19 冻雨
+    {"Sleet",          WeatherType::SNOWY},   // 20 雨夹雪
+    {"Snow Flurry",    WeatherType::SNOWY},   // 21 阵雪
+    {"Light Snow",     WeatherType::SNOWY},   // 22 小雪
+    {"Moderate Snow",  WeatherType::SNOWY},   // 23 中雪
+    {"Heavy Snow",     WeatherType::SNOWY},   // 24 大雪
+    {"Snowstorm",      WeatherType::SNOWY},   // 25 暴雪
+    {"Dust",           WeatherType::FOGGY},   // 26 浮尘
+    {"Sand",           WeatherType::FOGGY},   // 27 扬沙
+    {"Duststorm",      WeatherType::FOGGY},   // 28 沙尘暴
+    {"Sandstorm",      WeatherType::FOGGY},   // 29 强沙尘暴
+    {"Foggy",          WeatherType::FOGGY},   // 30 雾
+    {"Haze",           WeatherType::FOGGY},   // 31 霾
+    {"Windy",          WeatherType::WINDY},   // 32 风
+    {"Blustery",       WeatherType::WINDY},   // 33 大风
+    {"Hurricane",      WeatherType::STORMY},  // 34 飓风
+    {"Tropical Storm", WeatherType::STORMY},  // 35 热带风暴
+    {"Tornado",        WeatherType::STORMY},  // 36 龙卷风
+    {"Cold",           WeatherType::UNKNOWN}, // 37 冷
+    {"Hot",            WeatherType::UNKNOWN}, // 38 热
+};
+
+WeatherType weatherTypeFromCode(uint8_t code) {
+    if (code > WEATHER_CODE_MAX) {
+        return WeatherType::UNKNOWN;
+    }
+    return WEATHER_CODE_TABLE[code].type;
+}
+
+const char* weatherConditionText(uint8_t code) {
+    if (code > WEATHER_CODE_MAX) {
+        return "Unknown";
+    }
+    return WEATHER_CODE_TABLE[code].text;
+}
@@ -1,14 +1,151 @@
 #include "Weather_Service.h"
+#include "Deferred_Log.h"
+#include "Input_Trace.h"
 #include <WiFi.h>
 #include <WiFiClient.h>
 
-WeatherService::WeatherService() 
+// HTTP 请求在编译期拼接为单个常量字符串
+static const char WEATHER_HTTP_REQUEST[] =
+    "GET " WEATHER_API_PATH " HTTP/1.1\r\n"
+    "Host: " WEATHER_API_URL "\r\n"
+    "Connection: close\r\n\r\n";
+
+// 响应体缓冲区（静态分配，避免每次更新申请堆内存）
+static char responseBuffer[WEATHER_RESPONSE_BUFFER_SIZE];
+
+/**
+ * 查找 JSON 键对应值的起始位置
+ * @param key 带引号的键名，如 "\"code\""
+ * @return 指向值首字符的指针，未找到返回 nullptr
+ */
+static const char* findJsonValue(const char* json, const char* key) {
+    const char* p = json;
+    while ((p = strstr(p, key)) != nullptr) {
+        p += strlen(key);
+        while (*p == ' ') p++;
+        if (*p == ':') {
+            p++;
+            while (*p == ' ') p++;
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * 读取整数值（兼容 "25" 与 25 两种写法）
+ * 与 jsonToInt() 相同按 64 位累加，超出 int32 范围的值视为无效
+ */
+static bool readJsonInt(const char* json, const char* key, int32_t& out) {
+    const char* p = findJsonValue(json, key);
+    if (!p) return false;
+    bool quoted = (*p == '"');
+    if (quoted) p++;
+
+    bool negative = (*p == '-');
+    if (negative) p++;
+    if (*p < '0' || *p > '9') return false;
+
+    int64_t value = 0;
+    while (*p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        if (value > 0x80000000LL) {
+            return false;
+        }
+        p++;
+    }
+    // 数字后必须有结束引号或后续内容，截断在数字中间的响应不能读成一个较小的值
+    if (quoted ? *p != '"' : *p == '\0') {
+        return false;
+    }
+    if (negative) {
+        value = -value;
+    }
+    if (value > INT32_MAX) {
+        return false;
+    }
+    out = (int32_t)value;
+    return true;
+}
+
+/**
+ * 解析固定位数的十进制数字
+ */
+static int32_t parseDigits(const char* p, uint8_t count) {
+    int32_t value = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (p[i] < '0' || p[i] > '9') return -1;
+        value = value * 10 + (p[i] - '0');
+    }
+    return value;
+}
+
+/**
+ * 公历日期转 1970-01-01 起的天数
+ */
+static int32_t daysFromCivil(int32_t y, int32_t m, int32_t d) {
+    y -= (m <= 2);
+    const int32_t era = (y >= 0 ? y : y - 399) / 400;
+    const int32_t yoe = y - era * 400;
+    const int32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// "YYYY-MM-DDTHH:MM:SS" 与带时区的 "YYYY-MM-DDTHH:MM:SS+HH:MM" 的长度
+static const uint8_t ISO8601_LENGTH = 19;
+static const uint8_t ISO8601_TZ_LENGTH = 25;
+
+/**
+ * 解析 ISO8601 时间（如 "2015-09-25T22:45:00+08:00"）为 UTC 时间戳
+ * @param p 以引号或字符串结束符结尾；比固定格式短时返回 0
+ */
+static uint32_t parseIso8601(const char* p) {
+    // 先确认长度再按固定偏移取字段，截断的响应不会越过字符串末尾
+    uint8_t length = 0;
+    while (length < ISO8601_TZ_LENGTH && p[length] != '\0' && p[length] != '"') {
+        length++;
+    }
+    if (length < ISO8601_LENGTH) {
+        return 0;
+    }
+
+    int32_t year = parseDigits(p, 4);
+    int32_t month = parseDigits(p + 5, 2);
+    int32_t day = parseDigits(p + 8, 2);
+    int32_t hour = parseDigits(p + 11, 2);
+    int32_t minute = parseDigits(p + 14, 2);
+    int32_t second = parseDigits(p + 17, 2);
+    if (year < 1970 || month < 1 || day < 1 || hour < 0 || minute < 0 || second < 0) {
+        return 0;
+    }
+
+    int32_t epoch = daysFromCivil(year, month, day) * 86400L
+                  + hour * 3600L + minute * 60L + second;
+
+    // 时区偏移
+    char sign = p[ISO8601_LENGTH];
+    if (length == ISO8601_TZ_LENGTH && (sign == '+' || sign == '-')) {
+        int32_t tzHour = parseDigits(p + 20, 2);
+        int32_t tzMinute = parseDigits(p + 23, 2);
+        if (tzHour >= 0 && tzMinute >= 0) {
+            int32_t offset = tzHour * 3600L + tzMinute * 60L;
+            epoch += (sign == '+') ? -offset : offset;
+        }
+    }
+
+    return (uint32_t)epoch;
+}
+
+WeatherService::WeatherService()
     : lastUpdateTime(0) {
     currentWeather.isValid = false;
-    currentWeather.weather = "Unknown";
+    currentWeather.code = WEATHER_CODE_UNKNOWN;
+    currentWeather.type = WeatherType::UNKNOWN;
     currentWeather.temperature = 0;
     currentWeather.tempMax = 0;
     currentWeather.tempMin = 0;
+    currentWeather.updateTime = 0;
 }
 
 void WeatherService::begin() {
@@ -20,102 +157,109 @@ bool WeatherService::updateWeather() {
     if (!needsUpdate()) {
         return currentWeather.isValid;
     }
-    
-    Serial.println("[Weather] Fetching weather data...");
-    
+
+    // 录制时记下获取结果，回放时不访问网络，直接取录制的结果
+    bool updated = g_inputTrace.isReplaying() ? false : fetchWeather();
+    updated = g_inputTrace.traceWeather(updated, currentWeather);
+    g_inputTrace.syncClock();  // 网络请求耗时
+    if (updated) {
+        lastUpdateTime = millis();
+    }
+    return updated;
+}
+
+bool WeatherService::fetchWeather() {
+    LOG_DEBUG("[Weather] Fetching weather data...");
+
     WiFiClient client;
-    
+
     // 连接到心知天气服务器
     if (!client.connect(WEATHER_API_URL, 80)) {
-        Serial.println("[Weather] Failed to connect to API server");
+        LOG_WARN("[Weather] Failed to connect to API server");
         return false;
     }
-    
+
     // 发送HTTP请求
-    String request = String("GET ") + WEATHER_API_PATH + " HTTP/1.1\r\n";
-    request += "Host: " + String(WEATHER_API_URL) + "\r\n";
-    request += "Connection: close\r\n\r\n";
-    
-    client.print(request);
-    
-    // 等待响应
-    String response = "";
+    client.print(WEATHER_HTTP_REQUEST);
+
+    // 等待响应：跳过HTTP头，响应体直接写入静态缓冲区
+    size_t bodyLength = 0;
+    uint8_t headerMatch = 0;     // 已匹配的 "\r\n\r\n" 字节数
     bool bodyStarted = false;
     unsigned long timeout = millis() + 5000;  // 5秒超时
-    
+
     while (client.connected() || client.available()) {
         if (millis() > timeout) {
-            Serial.println("[Weather] Request timeout");
+            LOG_WARN("[Weather] Request timeout");
             break;
         }
-        
+
         if (client.available()) {
-            String line = client.readStringUntil('\n');
-            
+            char c = client.read();
+
             if (!bodyStarted) {
-                if (line == "\r") {
-                    bodyStarted = true;
+                if (c == ((headerMatch & 1) ? '\n' : '\r')) {
+                    headerMatch++;
+                } else {
+                    headerMatch = (c == '\r') ? 1 : 0;
                 }
-            } else {
-                response += line;
+                bodyStarted = (headerMatch == 4);
+            } else if (bodyLength < sizeof(responseBuffer) - 1) {
+                responseBuffer[bodyLength++] = c;
             }
         }
     }
-    
+
     client.stop();
-    
-    if (response.length() > 0) {
-        return parseWeatherJSON(response.c_str());
+    responseBuffer[bodyLength] = '\0';
+
+    if (bodyLength > 0) {
+        return parseWeatherJSON(responseBuffer);
     }
-    
+
     return false;
 }
 
 bool WeatherService::parseWeatherJSON(const char* jsonStr) {
-    // 使用ArduinoJson解析JSON
-    // 注意：心知天气API的响应格式
-    
-    DynamicJsonDocument doc(2048);
-    DeserializationError error = deserializeJson(doc, jsonStr);
-    
-    if (error) {
-        Serial.print("[Weather] JSON parse error: ");
-        Serial.println(error.c_str());
+    // 心知天气出错时返回 {"status":"...","status_code":"AP010001"}
+    if (findJsonValue(jsonStr, "\"status_code\"") != nullptr) {
+        LOG_WARN("[Weather] API returned error status");
         return false;
     }
-    
-    // 检查响应状态
-    if (doc["status"] != "ok") {
-        Serial.println("[Weather] API returned non-ok status");
+
+    const char* results = strstr(jsonStr, "\"results\"");
+    if (!results) {
+        LOG_WARN("[Weather] Failed to extract data from JSON");
         return false;
     }
-    
+
     // 提取数据
-    try {
-        JsonObject results = doc["results"][0];
-        JsonObject now = results["now"];
-        JsonObject last_update = results["last_update"];
-        
-        currentWeather.weather = String((const char*)now["text"]);
-        currentWeather.temperature = now["temperature"].as<float>();
-        currentWeather.tempMax = results["daily"][0]["high"].as<float>();
-        currentWeather.tempMin = results["daily"][0]["low"].as<float>();
-        currentWeather.updateTime = String((const char*)last_update["datetime"]);
-        currentWeather.isValid = true;
-        
-        lastUpdateTime = millis();
-        
-        Serial.print("[Weather] Updated: ");
-        Serial.print(currentWeather.weather);
-        Serial.print(" T=");
-        Serial.print(currentWeather.temperature);
-        Serial.println("C");
-        
-        return true;
-        
-    } catch (...) {
-        Serial.println("[Weather] Failed to extract data from JSON");
+    int32_t code, temperature;
+    if (!readJsonInt(results, "\"code\"", code) ||
+        !readJsonInt(results, "\"temperature\"", temperature)) {
+        LOG_WARN("[Weather] Failed to extract data from JSON");
         currentWeather.isValid = false;
         return false;
     }
+
+    int32_t high = temperature;
+    int32_t low = temperature;
+    readJsonInt(results, "\"high\"", high);
+    readJsonInt(results, "\"low\"", low);
+
+    const char* updated = findJsonValue(results, "\"last_update\"");
+
+    currentWeather.code = (code >= 0 && code <= WEATHER_CODE_MAX)
+                          ? (uint8_t)code : WEATHER_CODE_UNKNOWN;
+    currentWeather.type = weatherTypeFromCode(currentWeather.code);
+    currentWeather.temperature = (int8_t)constrain(temperature, -128, 127);
+    currentWeather.tempMax = (int8_t)constrain(high, -128, 127);
+    currentWeather.tempMin = (int8_t)constrain(low, -128, 127);
+    currentWeather.updateTime = (updated && *updated == '"') ? parseIso8601(updated + 1) : 0;
+    currentWeather.isValid = true;
+
+    LOG_INFO("[Weather] Updated: %s T=%dC", weatherConditionText(currentWeather.code),
+             currentWeather.temperature);
+
+    return true;
 }
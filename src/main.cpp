@@ -8,49 +8,270 @@
 #include "MQTT_Manager.h"
 #include "Weather_Service.h"
 #include "State_Machine.h"
+#include "Motion_Arbiter.h"
+#include "Latency_Trace.h"
+#include "Deferred_Log.h"
+#include "Input_Trace.h"
+#include "Choreography.h"
+#include "Choreography_Store.h"
+#include "Remote_Control.h"
+#include "Device_Shadow.h"
+#include "Config_Store.h"
+#include "Kv_Store.h"
+#include "Connectivity_Supervisor.h"
 
 // ==================== 全局对象 ====================
 DHTManager dhtManager;
 OLEDDisplay oledDisplay;
 ServoController servoController;
+MotionArbiter motionArbiter;
 ASRPROModule asrModule;
 WiFiManager wifiManager;
 WeatherService weatherService;
 StateMachine fsm;
+ChoreographyPlayer choreoPlayer;
+ChoreographyStore choreoStore;
+RemoteControlModule remoteControl;
+RemoteMode remoteMode = RemoteMode::AUTO;
+DeviceShadow deviceShadow;
+ConfigStore configStore;
 
 // WiFi客户端用于MQTT
 WiFiClient wifiClient;
 MQTTManager mqttManager(wifiClient);
+ConnectivitySupervisor connectivity;
 
 // ==================== 时间管理 ====================
 unsigned long lastSensorRead = 0;
 unsigned long lastMQTTPublish = 0;
 unsigned long lastWeatherUpdate = 0;
+unsigned long lastLatencyReport = 0;
+
+// ==================== 串口控制台 ====================
+char consoleLine[LOG_CONSOLE_LINE_MAX];
+size_t consoleLength = 0;
+bool consoleOverflow = false;       // 当前行超长，丢弃到行尾
+
+// ==================== 输入录制 ====================
+
+/**
+ * 输出摘要：录制与回放在同一 loop() 比较，不一致说明行为出现偏差
+ * 只取由 millis() 与外部输入决定的状态，不含舵机 PWM 实际脉宽（取决于中断相位）
+ */
+uint32_t computeOutputDigest() {
+    const MotionArbiterStats& arbiter = motionArbiter.getStats();
+    uint32_t values[] = {
+        (uint32_t)fsm.getCurrentState(),
+        fsm.getRedrawCount(),
+        fsm.getTraceCount(),
+        arbiter.started,
+        arbiter.preemptions,
+        arbiter.dropped,
+        servoController.getHeadPosition(),
+        servoController.getNodPosition(),
+        (uint32_t)weatherService.getWeather().code,
+    };
+
+    uint32_t hash = 2166136261UL;
+    for (uint32_t v : values) {
+        for (uint8_t i = 0; i < 4; i++) {
+            hash = (hash ^ (uint8_t)(v >> (i * 8))) * 16777619UL;
+        }
+    }
+    return hash;
+}
+
+// ==================== 云端消息 ====================
+
+/**
+ * 执行一条云端指令（同一指令包中的指令在同一次调用中依次执行）
+ * @return false 指令被拒绝
+ */
+bool executeRemoteCommand(const RemoteControlData& cmd) {
+    switch (cmd.command) {
+        case RemoteCommand::SET_EMOTION:
+            oledDisplay.setEmotion(cmd.emotion);
+            return true;
+            
+        case RemoteCommand::MOVE_SERVO:
+            if (cmd.servoAngle != REMOTE_ANGLE_NONE && cmd.servoAction != ServoAction::RESET) {
+                // 指定角度：按动作所在的轴运动到该角度
+                ServoAxis axis = (cmd.servoAction == ServoAction::NOD_UP || cmd.servoAction == ServoAction::NOD_DOWN)
+                                     ? ServoAxis::NOD : ServoAxis::HEAD;
+                return motionArbiter.submitSegment(axis, cmd.servoAngle, REMOTE_SERVO_MOVE_MS, MotionSource::REMOTE);
+            }
+            return motionArbiter.submit(cmd.servoAction, MotionSource::REMOTE);
+            
+        case RemoteCommand::QUERY_STATUS:
+            return remoteControl.publishStatus(mqttManager, remoteEmotionName(oledDisplay.getEmotion()),
+                                               dhtManager.getTemperature(), dhtManager.getHumidity(),
+                                               weatherConditionText(weatherService.getWeather().code));
+            
+        case RemoteCommand::SET_MODE:
+            remoteMode = cmd.mode;
+            LOG_INFO("[Remote] Mode: %s", remoteModeName(cmd.mode));
+            return true;
+            
+        case RemoteCommand::CALIBRATE:
+            // 舵机回中，作为机械校准的参考位置
+            return motionArbiter.submit(ServoAction::RESET, MotionSource::REMOTE);
+            
+        default:
+            return false;
+    }
+}
+
+/**
+ * 采集设备影子的实际状态
+ */
+ShadowState captureShadowState() {
+    ShadowState state;
+    state.set(ShadowField::EMOTION, (int16_t)oledDisplay.getEmotion());
+    state.set(ShadowField::MODE, (int16_t)remoteMode);
+    state.set(ShadowField::TEMP_HIGH, (int16_t)jsonFixedFromFloat(dhtManager.getTempHigh(), 1));
+    state.set(ShadowField::TEMP_LOW, (int16_t)jsonFixedFromFloat(dhtManager.getTempLow(), 1));
+    state.set(ShadowField::HUMID_HIGH, (int16_t)jsonFixedFromFloat(dhtManager.getHumidHigh(), 1));
+    state.set(ShadowField::HUMID_LOW, (int16_t)jsonFixedFromFloat(dhtManager.getHumidLow(), 1));
+    return state;
+}
+
+/**
+ * 应用设备影子的期望状态（结果经下一次采集回报给后端）
+ */
+void applyShadowDesired(const ShadowState& desired, uint8_t changed) {
+    if (changed & (1u << (uint8_t)ShadowField::EMOTION)) {
+        oledDisplay.setEmotion((EmotionState)desired.get(ShadowField::EMOTION));
+    }
+    if (changed & (1u << (uint8_t)ShadowField::MODE)) {
+        remoteMode = (RemoteMode)desired.get(ShadowField::MODE);
+        LOG_INFO("[Shadow] Mode: %s", remoteModeName(remoteMode));
+    }
+    uint8_t thresholds = (1u << (uint8_t)ShadowField::TEMP_HIGH) | (1u << (uint8_t)ShadowField::TEMP_LOW) |
+                         (1u << (uint8_t)ShadowField::HUMID_HIGH) | (1u << (uint8_t)ShadowField::HUMID_LOW);
+    if (changed & thresholds) {
+        // 阈值经运行时配置修改，写入 Flash 后由 applyConfig() 生效
+        static const struct {
+            ShadowField field;
+            const char* name;
+        } THRESHOLD_FIELDS[] = {
+            {ShadowField::TEMP_HIGH, "temp_high"}, {ShadowField::TEMP_LOW, "temp_low"},
+            {ShadowField::HUMID_HIGH, "humid_high"}, {ShadowField::HUMID_LOW, "humid_low"},
+        };
+        configStore.beginUpdate();
+        ConfigResult result = ConfigResult::OK;
+        for (const auto& threshold : THRESHOLD_FIELDS) {
+            char value[JSON_NUMBER_MAX];
+            size_t length = jsonFormatFixed(desired.get(threshold.field), 1, value);
+            result = configStore.stage(threshold.name, strlen(threshold.name), value, length);
+            if (result != ConfigResult::OK) {
+                break;
+            }
+        }
+        if (result == ConfigResult::OK) {
+            result = configStore.commit();
+        }
+        if (result != ConfigResult::OK && result != ConfigResult::PENDING) {
+            LOG_WARN("[Shadow] Thresholds rejected: %s", ConfigStore::resultText(result));
+        }
+    }
+}
+
+/**
+ * 应用运行时配置（启动载入与每次修改后）
+ */
+void applyConfig(const RuntimeConfig& config) {
+    dhtManager.setThresholds(config.tempHigh, config.tempLow, config.humidHigh, config.humidLow);
+    g_log.setLevel(config.logLevel);
+    
+    // 服务器变化时断开，下次重连使用新地址
+    static uint16_t appliedPort = 0;
+    static char appliedBroker[CONFIG_TEXT_MAX] = "";
+    if (config.mqttPort != appliedPort || strcmp(config.mqttBroker, appliedBroker) != 0) {
+        bool reconnect = appliedPort != 0;
+        appliedPort = config.mqttPort;
+        strcpy(appliedBroker, config.mqttBroker);
+        mqttManager.begin(g_config.mqttBroker, g_config.mqttPort);
+        if (reconnect) {
+            LOG_INFO("[Config] MQTT broker changed to %s:%u", config.mqttBroker, config.mqttPort);
+            mqttManager.disconnect();
+        }
+    }
+}
+
+void onMQTTMessage(const char* topic, const uint8_t* payload, unsigned int length) {
+    if (strcmp(topic, MQTT_TOPIC_CHOREO) == 0) {
+        // 每条编舞消息都回复，发送端据此续传
+        char reply[96];
+        choreoStore.handleMessage(payload, length, reply, sizeof(reply));
+        mqttManager.publishJSON(reply);
+    } else if (strcmp(topic, MQTT_TOPIC_CONTROL) == 0) {
+        // 带 ID 的指令包回复执行结果，发送端据此判断是否重发
+        char reply[96];
+        remoteControl.handleMQTTMessage(payload, length, reply, sizeof(reply));
+        if (reply[0] != '\0') {
+            mqttManager.publishJSON(reply);
+        }
+    } else if (strcmp(topic, MQTT_TOPIC_SHADOW_DESIRED) == 0) {
+        // 应答在 loop() 中由 deviceShadow.publish() 发出
+        deviceShadow.handleMessage(payload, length);
+    } else if (strcmp(topic, MQTT_TOPIC_CONFIG) == 0) {
+        char reply[128];
+        bool publishAll = false;
+        configStore.handleMessage(payload, length, reply, sizeof(reply), publishAll);
+        mqttManager.publishJSON(reply);
+        if (publishAll) {
+            configStore.publish(mqttManager);
+        }
+    }
+}
 
 // ==================== 初始化函数 ====================
 void setupSerialCommunication() {
-    Serial.begin(115200);
-    delay(500);
+    // 调试串口（USART1）由延迟日志独占，输出用 tools/log_decoder.py 解码
+    g_log.begin();
     
-    Serial.println("\n\n");
-    Serial.println("================================");
-    Serial.println("Smart Desk Pet System Starting!");
-    Serial.println("STM32F407VET6 + Arduino Framework");
-    Serial.println("================================\n");
+    // 回放由主机程序在 setup() 之前开启
+    g_inputTrace.setDigest(computeOutputDigest);
+#if INPUT_RECORD_ENABLED
+    if (!g_inputTrace.isReplaying()) {
+        g_inputTrace.beginRecording();
+    }
+#endif
+    
+    LOG_INFO("Smart Desk Pet System Starting!");
+    LOG_INFO("STM32F407VET6 + Arduino Framework");
     
     // 初始化各个UART接口
     UART_ASRPRO.begin(UART_BAUD_ASRPRO);
     UART_ESP8266.begin(UART_BAUD_ESP8266);
     
     delay(500);
-    Serial.println("[Init] UART initialized");
+    LOG_INFO("[Init] UART initialized");
+}
+
+/**
+ * 键值存储擦除扇区前调用：正在就地执行该扇区中的脚本时先停止
+ */
+void onKvErase(const uint8_t* begin, const uint8_t* end) {
+    if (choreoPlayer.isPlayingFrom(begin, end)) {
+        LOG_WARN("[Choreo] Script storage being erased, stopping playback");
+        choreoPlayer.stop();
+    }
+}
+
+void setupConfig() {
+    // 在其他模块之前载入，阈值、周期与 MQTT 服务器都取自 g_config
+    g_kvStore.setEraseHandler(onKvErase);
+    g_kvStore.begin();
+    configStore.setListener(applyConfig);
+    configStore.begin();
 }
 
 void setupDisplay() {
     oledDisplay.begin();
     oledDisplay.clear();
     oledDisplay.setEmotion(EmotionState::NORMAL);
-    Serial.println("[Init] OLED Display initialized");
+    LOG_INFO("[Init] OLED Display initialized");
 }
 
 void setupSensorsAndActuators() {
@@ -59,58 +280,74 @@ void setupSensorsAndActuators() {
     
     // 初始化舵机
     servoController.begin();
+    motionArbiter.begin(&servoController);
     
     // 初始化语音模块
     asrModule.begin();
     
-    Serial.println("[Init] Sensors and actuators initialized");
+    // 编舞解释器与脚本存储
+    choreoPlayer.begin(&oledDisplay, &motionArbiter, &asrModule, &dhtManager);
+    choreoStore.begin(&choreoPlayer);
+    
+    LOG_INFO("[Init] Sensors and actuators initialized");
 }
 
 void setupWiFiAndCloud() {
-    Serial.println("[Init] Starting WiFi...");
+    LOG_INFO("[Init] Starting WiFi...");
     
     // 初始化WiFi
     wifiManager.begin(WIFI_SSID, WIFI_PASSWORD);
-    wifiManager.connect();
+    connectivity.begin(&wifiManager, &mqttManager);
     
-    // 初始化MQTT
-    mqttManager.begin(MQTT_BROKER, MQTT_PORT);
+    // 初始化MQTT与云端指令
+    remoteControl.begin();
+    remoteControl.setCommandHandler(executeRemoteCommand);
+    deviceShadow.begin(captureShadowState());
+    deviceShadow.setDesiredHandler(applyShadowDesired);
+    mqttManager.setMessageHandler(onMQTTMessage);
     
     // 初始化天气服务
     weatherService.begin();
     
-    Serial.println("[Init] WiFi and Cloud services initialized");
+    LOG_INFO("[Init] WiFi and Cloud services initialized");
 }
 
 void setupStateMachine() {
-    fsm.begin(&oledDisplay, &servoController, &dhtManager, &asrModule);
-    Serial.println("[Init] State Machine initialized");
+    g_latencyTracer.begin();
+    fsm.begin(&oledDisplay, &servoController, &dhtManager, &asrModule, &motionArbiter);
+    LOG_INFO("[Init] State Machine initialized");
 }
 
 // ==================== 主设置函数 ====================
 void setup() {
     setupSerialCommunication();
+    setupConfig();
     delay(500);
+    g_inputTrace.syncClock();
     
     setupDisplay();
     delay(500);
+    g_inputTrace.syncClock();
     
     setupSensorsAndActuators();
     delay(500);
+    g_inputTrace.syncClock();
     
     setupWiFiAndCloud();
     delay(500);
+    g_inputTrace.syncClock();
     
     setupStateMachine();
     delay(500);
+    g_inputTrace.syncClock();
     
-    Serial.println("[Init] All systems ready!");
+    LOG_INFO("[Init] All systems ready!");
     oledDisplay.displayIP("Connecting...");
 }
 
 // ==================== 传感器数据读取 ====================
 void readSensors() {
-    if (millis() - lastSensorRead < SENSOR_READ_INTERVAL) {
+    if (millis() - lastSensorRead < g_config.sensorReadInterval) {
         return;
     }
     
@@ -118,21 +355,18 @@ void readSensors() {
     
     // 读取DHT11
     if (dhtManager.read()) {
-        Serial.print("[Sensor] T=");
-        Serial.print(dhtManager.getTemperature());
-        Serial.print("C, H=");
-        Serial.print(dhtManager.getHumidity());
-        Serial.println("%");
+        LOG_DEBUG("[Sensor] T=%.2fC, H=%.2f%%", dhtManager.getTemperature(), dhtManager.getHumidity());
     } else {
-        Serial.println("[Sensor] DHT11 read failed!");
+        LOG_WARN("[Sensor] DHT11 read failed!");
     }
 }
 
 // ==================== 通信与数据上传 ====================
 void updateWiFiConnection() {
-    wifiManager.update();
+    // WiFi 与 MQTT 的重连时机由连接监管统一决定
+    connectivity.update();
     
-    if (wifiManager.isConnected()) {
+    if (connectivity.isUp(ConnLayer::LINK)) {
         oledDisplay.displayIP(wifiManager.getLocalIP().c_str());
     }
 }
@@ -140,8 +374,12 @@ void updateWiFiConnection() {
 void updateMQTTConnection() {
     mqttManager.update();
     
+    // 设备影子：重连握手、期望状态确认、实际状态增量
+    deviceShadow.update(captureShadowState(), mqttManager.isConnectedToMQTT(), millis());
+    deviceShadow.publish(mqttManager, millis());
+    
     // 定期发布数据
-    if (millis() - lastMQTTPublish > MQTT_HEARTBEAT_INTERVAL) {
+    if (millis() - lastMQTTPublish > g_config.mqttHeartbeatInterval) {
         lastMQTTPublish = millis();
         
         if (mqttManager.isConnectedToMQTT() && dhtManager.getIsValid()) {
@@ -154,16 +392,19 @@ void updateMQTTConnection() {
 }
 
 void updateWeatherData() {
-    if (weatherService.needsUpdate() && wifiManager.isConnected()) {
-        if (weatherService.updateWeather()) {
-            WeatherData weather = weatherService.getWeather();
-            Serial.print("[Weather] ");
-            Serial.println(weather.weather);
+    // 请求失败后按退避重试，链路断开时不请求
+    if (weatherService.needsUpdate() && connectivity.isReady(ConnLayer::WEATHER)) {
+        bool updated = weatherService.updateWeather();
+        connectivity.report(ConnLayer::WEATHER, updated);
+        if (updated) {
+            const WeatherData& weather = weatherService.getWeather();
+            const char* weatherText = weatherConditionText(weather.code);
+            LOG_INFO("[Weather] %s", weatherText);
             
             // 发布到MQTT
             if (mqttManager.isConnectedToMQTT()) {
                 mqttManager.publishWeather(
-                    weather.weather.c_str(),
+                    weatherText,
                     weather.tempMax,
                     weather.tempMin
                 );
@@ -172,28 +413,110 @@ void updateWeatherData() {
     }
 }
 
+// ==================== 延迟报告 ====================
+void reportLatency() {
+#if LATENCY_TRACE_ENABLED
+    if (millis() - lastLatencyReport < LATENCY_REPORT_INTERVAL) {
+        return;
+    }
+    lastLatencyReport = millis();
+    
+    g_latencyTracer.printReport(g_log);
+    
+    if (mqttManager.isConnectedToMQTT()) {
+        char payload[256];
+        if (g_latencyTracer.formatReportJSON(payload, sizeof(payload)) > 0) {
+            mqttManager.publishJSON(payload);
+        }
+    }
+#endif
+}
+
+// ==================== 串口控制台 ====================
+// 控制台按块读取，一块即一条输入录制记录
+static constexpr size_t CONSOLE_RX_CHUNK = INPUT_RECORD_MAX - 1;
+
+/**
+ * 处理 USART1 收到的控制台输入，一行一条命令
+ */
+void pollConsole() {
+    uint8_t chunk[CONSOLE_RX_CHUNK];
+    size_t n;
+    do {
+        n = g_log.readConsole(chunk, sizeof(chunk));
+        n = g_inputTrace.traceConsole(chunk, n, sizeof(chunk));
+        
+        for (size_t i = 0; i < n; i++) {
+            char c = (char)chunk[i];
+            if (c != '\r' && c != '\n') {
+                if (consoleLength < sizeof(consoleLine)) {
+                    consoleLine[consoleLength++] = c;
+                } else {
+                    consoleOverflow = true;
+                }
+                continue;
+            }
+            if (consoleOverflow) {
+                LOG_WARN("[Console] Line too long, discarded");
+            } else if (consoleLength > 0 && !configStore.handleConsole(consoleLine, consoleLength, g_log)) {
+                LOG_WARN("[Console] Unknown command: %s", logBytes(consoleLine, consoleLength));
+            }
+            consoleLength = 0;
+            consoleOverflow = false;
+        }
+    } while (n > 0);
+}
+
 // ==================== 主循环函数 ====================
 void loop() {
-    // 1. 读取传感器数据
+    // 0. 输入录制：记下本次 loop() 的时刻（回放时设置时刻）
+    if (!g_inputTrace.beginLoop()) {
+        return;
+    }
+    
+    // 1. 读取传感器数据（DHT11 读取耗时数十毫秒）
     readSensors();
+    g_inputTrace.syncClock();
     
     // 2. 处理语音指令
     asrModule.update();
     
-    // 3. 更新状态机
+    // 3. 更新状态机，推进编舞脚本
     fsm.update();
+    choreoPlayer.update();
     
-    // 4. 更新舵机状态
+    // 4. 更新舵机状态（先仲裁排队中的动作请求）
+    motionArbiter.update();
     servoController.update();
     
-    // 5. 处理WiFi连接
+    // 5. 处理网络连接（WiFi、MQTT 按依赖与退避重连）
     updateWiFiConnection();
+    g_inputTrace.syncClock();
     
-    // 6. 处理MQTT连接和数据上传
+    // 6. 处理MQTT消息和数据上传
     updateMQTTConnection();
+    g_inputTrace.syncClock();
     
     // 7. 更新天气数据
     updateWeatherData();
+    g_inputTrace.syncClock();
+    
+    // 8. 发布语音响应延迟统计
+    reportLatency();
+    
+    // 9. 串口控制台
+    pollConsole();
+    
+    // 10. 键值存储：没有动作与脚本、串口没有待读的数据时推进回收（擦除会停顿 1~2 秒，
+    //     期间串口接收中断被推迟），然后写入因回收而推迟的配置与脚本
+    g_kvStore.update(motionArbiter.isIdle() && !choreoPlayer.isPlaying() &&
+                     UART_ASRPRO.available() == 0 && UART_ESP8266.available() == 0);
+    configStore.update();
+    choreoStore.update();
+    g_inputTrace.syncClock();
+    
+    // 11. 启动日志 DMA 发送（本周期产生的日志在后台发出）
+    g_log.update();
     
     // 防止看门狗超时
     delay(10);
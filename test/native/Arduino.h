@@ -0,0 +1,118 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/**
+ * 主机测试用的 Arduino 核心替身（pio test -e native）
+ * 只提供固件用到的部分；时钟由测试推进，串口收发落在内存缓冲区
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+
+#define PROGMEM
+
+enum {
+    PA0, PA1, PA2, PA3, PA5, PA9, PA10, PB6, PB7, PB10, PB11
+};
+
+typedef uint8_t byte;
+
+// ==================== 时钟 ====================
+
+// 主机时钟（微秒），只由测试推进
+inline unsigned long long g_hostMicros = 0;
+
+inline unsigned long millis() { return (unsigned long)(g_hostMicros / 1000); }
+inline unsigned long micros() { return (unsigned long)g_hostMicros; }
+inline void delay(unsigned long ms) { g_hostMicros += ms * 1000ULL; }
+inline void delayMicroseconds(unsigned int us) { g_hostMicros += us; }
+
+inline void hostSetMillis(unsigned long ms) { g_hostMicros = ms * 1000ULL; }
+inline void hostAdvanceMillis(unsigned long ms) { g_hostMicros += ms * 1000ULL; }
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+template <class T, class L, class H>
+inline T constrain(T x, L low, H high) {
+    return x < low ? low : (x > high ? high : x);
+}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// ==================== 字符串 ====================
+
+class String {
+private:
+    std::string s;
+
+public:
+    String() {}
+    String(const char* c) : s(c ? c : "") {}
+    String(float v, int decimals) {
+        char b[32];
+        snprintf(b, sizeof(b), "%.*f", decimals, v);
+        s = b;
+    }
+    const char* c_str() const { return s.c_str(); }
+    unsigned length() const { return (unsigned)s.size(); }
+    String& operator+=(const char* c) { s += c; return *this; }
+    bool operator==(const char* c) const { return s == c; }
+};
+
+// ==================== 串口 ====================
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        for (size_t i = 0; i < size; i++) write(buffer[i]);
+        return size;
+    }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long v) { char b[24]; snprintf(b, sizeof(b), "%ld", v); return write(b); }
+    size_t print(int v) { return print((long)v); }
+    size_t print(unsigned long v) { char b[24]; snprintf(b, sizeof(b), "%lu", v); return write(b); }
+    size_t print(unsigned v) { return print((unsigned long)v); }
+    size_t print(double v, int decimals = 2) { char b[32]; snprintf(b, sizeof(b), "%.*f", decimals, v); return write(b); }
+    template <class T> size_t println(T v) { size_t n = print(v); return n + write((uint8_t)'\n'); }
+    size_t println() { return write((uint8_t)'\n'); }
+};
+
+/**
+ * 串口：rx 由测试写入，tx 收集固件发出的字节
+ */
+class HardwareSerial : public Print {
+public:
+    std::string rx;
+    std::string tx;
+
+    void begin(unsigned long) {}
+    int available() { return (int)rx.size(); }
+    int read() {
+        if (rx.empty()) return -1;
+        int c = (uint8_t)rx[0];
+        rx.erase(0, 1);
+        return c;
+    }
+    int availableForWrite() { return 64; }
+    size_t write(uint8_t c) override { tx.push_back((char)c); return 1; }
+    using Print::write;
+    void flush() {}
+};
+
+inline HardwareSerial Serial;
+inline HardwareSerial Serial2;
+inline HardwareSerial Serial3;
+
+#endif
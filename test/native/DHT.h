@@ -0,0 +1,22 @@
+#ifndef HOST_DHT_H
+#define HOST_DHT_H
+
+#include "Arduino.h"
+
+#define DHT11 11
+
+/**
+ * DHT 传感器替身：读数由测试设置
+ */
+class DHT {
+public:
+    static inline float temperature = 24.0f;
+    static inline float humidity = 50.0f;
+
+    DHT(uint8_t, uint8_t) {}
+    void begin() {}
+    float readTemperature() { return temperature; }
+    float readHumidity() { return humidity; }
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef HOST_ALLOC_COUNTER_H
+#define HOST_ALLOC_COUNTER_H
+
+/**
+ * 主机测试用的堆分配计数：替换全局 operator new/delete，每次分配累加 g_hostAllocations
+ * 替换函数不能是 inline，每个测试程序只能由一个源文件包含本头文件
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <new>
+
+static size_t g_hostAllocations = 0;
+
+// 不内联：否则 GCC 会把 malloc()/free() 与 new/delete 配对，误报 -Wmismatched-new-delete
+__attribute__((noinline)) void* operator new(size_t size) {
+    g_hostAllocations++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+#endif
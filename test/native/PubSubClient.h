@@ -0,0 +1,79 @@
+#ifndef HOST_PUBSUBCLIENT_H
+#define HOST_PUBSUBCLIENT_H
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+#include <vector>
+
+typedef void (*MQTT_CALLBACK_SIGNATURE)(char*, uint8_t*, unsigned int);
+
+/**
+ * MQTT 客户端替身（测试中的服务器）：
+ * inbox 在 loop() 中投递给回调，sent 收集发布的消息
+ */
+class PubSubClient : public Print {
+public:
+    struct Message {
+        std::string topic;
+        std::string payload;
+    };
+
+    // 最近构造的实例（固件中只有 MQTTManager 一个）
+    static inline PubSubClient* instance = nullptr;
+    // 挂接 CONNECT 的受理，未挂接时按 online
+    static inline bool (*onConnect)() = nullptr;
+
+    bool online = false;
+    std::vector<Message> inbox;
+    std::vector<Message> sent;
+
+    explicit PubSubClient(WiFiClient&) { instance = this; }
+
+    void setCallback(MQTT_CALLBACK_SIGNATURE cb) { callback = cb; }
+    void setServer(const char*, uint16_t) {}
+    bool connect(const char*, const char*, const char*) {
+        connected = onConnect ? onConnect() : online;
+        return connected;
+    }
+    void disconnect() { connected = false; }
+    int state() { return connected ? 0 : -2; }
+    bool loop() {
+        if (!connected) return false;
+        std::vector<Message> batch;
+        batch.swap(inbox);
+        for (Message& m : batch) {
+            if (callback) callback(&m.topic[0], (uint8_t*)&m.payload[0], (unsigned)m.payload.size());
+        }
+        return connected;
+    }
+    bool publish(const char* topic, const char* payload) {
+        if (!connected) return false;
+        sent.push_back({topic, payload});
+        return true;
+    }
+    bool subscribe(const char*) { return connected; }
+
+    bool beginPublish(const char* topic, unsigned int length, bool) {
+        if (!connected) return false;
+        streaming = {topic, std::string()};
+        streamLength = length;
+        return true;
+    }
+    size_t write(uint8_t c) override { streaming.payload.push_back((char)c); return 1; }
+    using Print::write;
+    int endPublish() {
+        bool ok = streaming.payload.size() == streamLength;
+        if (ok) sent.push_back(streaming);
+        return ok ? 1 : 0;
+    }
+
+    bool isConnected() const { return connected; }
+
+private:
+    MQTT_CALLBACK_SIGNATURE callback = nullptr;
+    bool connected = false;
+    Message streaming;
+    size_t streamLength = 0;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HOST_SERVO_H
+#define HOST_SERVO_H
+
+#include "Arduino.h"
+
+/**
+ * Servo 库替身：记录最后写入的脉宽
+ */
+class Servo {
+public:
+    int pulseMicros = 1500;
+    bool isAttached = false;
+
+    uint8_t attach(int, int, int) { isAttached = true; return 0; }
+    void detach() { isAttached = false; }
+    bool attached() { return isAttached; }
+    void write(int angle) { pulseMicros = 500 + angle * 2000 / 180; }
+    void writeMicroseconds(int us) { pulseMicros = us; }
+};
+
+#endif
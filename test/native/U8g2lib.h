@@ -0,0 +1,39 @@
+#ifndef HOST_U8G2LIB_H
+#define HOST_U8G2LIB_H
+
+#include "Arduino.h"
+
+#define U8G2_R0 0
+
+inline const uint8_t u8g2_font_ncenB08_tr[1] = {0};
+inline const uint8_t u8g2_font_ncenB10_tr[1] = {0};
+inline const uint8_t u8g2_font_ncenB12_tr[1] = {0};
+
+/**
+ * U8g2 替身：不绘制，只统计发送到屏幕的次数
+ */
+class U8G2 {
+public:
+    uint32_t sends = 0;
+
+    void begin() {}
+    void enableUTF8Print() {}
+    void setFont(const uint8_t*) {}
+    void setDrawColor(uint8_t) {}
+    void clearBuffer() {}
+    void sendBuffer() { sends++; }
+    void drawCircle(int, int, int) {}
+    void drawDisc(int, int, int) {}
+    void drawLine(int, int, int, int) {}
+    void drawBox(int, int, int, int) {}
+    void drawStr(int, int, const char*) {}
+    void drawBitmap(int, int, int, int, const uint8_t*) {}
+    void drawBitmap(int, int, const uint8_t*, int, int, int) {}
+};
+
+class U8G2_SSD1315_128X64_1_HW_I2C : public U8G2 {
+public:
+    U8G2_SSD1315_128X64_1_HW_I2C(int, int, int) {}
+};
+
+#endif
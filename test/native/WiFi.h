@@ -0,0 +1,40 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+#define WL_DISCONNECTED 6
+#define WL_CONNECTED 3
+#define WIFI_STA 1
+
+struct IPAddress {
+    String toString() const { return String("192.168.1.100"); }
+};
+
+/**
+ * WiFi 替身：链路状态由测试设置，begin() 可挂接关联过程的模型
+ */
+class WiFiClass {
+public:
+    int linkStatus = WL_DISCONNECTED;
+    bool autoReconnect = false;
+    uint32_t begins = 0;
+    static inline void (*onBegin)() = nullptr;
+
+    int status() { return linkStatus; }
+    void mode(int) {}
+    void setAutoConnect(bool) {}
+    void setAutoReconnect(bool enable) { autoReconnect = enable; }
+    void begin(const char*, const char*) {
+        begins++;
+        if (onBegin) onBegin();
+    }
+    void disconnect(bool) { linkStatus = WL_DISCONNECTED; }
+    IPAddress localIP() { return IPAddress(); }
+    int8_t RSSI() { return -50; }
+};
+
+inline WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef HOST_WIFI_CLIENT_H
+#define HOST_WIFI_CLIENT_H
+
+#include "Arduino.h"
+
+/**
+ * TCP 客户端替身：connect() 成功时把 response 作为对端发来的数据
+ */
+class WiFiClient {
+private:
+    size_t position = 0;        // 已读到 response 的位置；直接读共享的 response，不复制、不分配
+    bool open = false;
+
+public:
+    static inline bool reachable = false;
+    static inline std::string response;
+    static inline uint32_t connects = 0;
+
+    bool connect(const char*, int) {
+        connects++;
+        if (!reachable) return false;
+        position = 0;
+        open = true;
+        return true;
+    }
+    void print(const char*) {}
+    bool connected() { return open && position < response.size(); }
+    int available() { return open ? (int)(response.size() - position) : 0; }
+    int read() {
+        if (!available()) return -1;
+        return (uint8_t)response[position++];
+    }
+    void stop() { open = false; }
+};
+
+#endif
@@ -0,0 +1,319 @@
+#include <unity.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "ASRPRO_Protocol.h"
+#include "ASRPRO_Module.h"
+
+/**
+ * ASRPRO 二进制帧：CRC-8、往返、损坏/丢字节后的重新同步、重发判定，
+ * 含 0xA5 字节的 UTF-8 文本原样通过，以及每帧解码耗时
+ */
+
+static const uint8_t MAX_ID = 10;
+
+// 固定种子下的期望值：噪声测试中损坏的帧数、垃圾测试中碰巧通过校验的假帧数
+static const int DAMAGED_WITH_SEED_28 = 1031;
+static const int SPURIOUS_WITH_SEED_29 = 1;
+
+static std::vector<uint8_t> makeFrame(uint8_t id, uint8_t seq) {
+    uint8_t body[2] = {id, seq};
+    return {ASRPRO_FRAME_SYNC, id, seq, asrproCrc8(body, 2)};
+}
+
+struct FeedResult {
+    std::vector<uint8_t> ids;
+    std::string text;
+};
+
+static FeedResult feedAll(ASRPROFrameDecoder& decoder, const std::vector<uint8_t>& bytes,
+                          unsigned long now = 0) {
+    FeedResult r;
+    for (uint8_t b : bytes) {
+        if (decoder.feed(b, now)) r.ids.push_back(decoder.getCommandId());
+        uint8_t t;
+        while (decoder.popTextByte(t)) r.text.push_back((char)t);
+    }
+    return r;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_crc8_known_vectors() {
+    // CRC-8/SMBUS（多项式 0x07，初值 0）："123456789" 的校验值为 0xF4
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_ASSERT_EQUAL_HEX8(0xF4, asrproCrc8(check, sizeof(check)));
+    TEST_ASSERT_EQUAL_HEX8(0x00, asrproCrc8(check, 0));
+}
+
+void test_crc8_detects_every_single_bit_error() {
+    for (int id = 1; id <= MAX_ID; id++) {
+        for (int seq = 0; seq < 256; seq++) {
+            uint8_t body[2] = {(uint8_t)id, (uint8_t)seq};
+            uint8_t crc = asrproCrc8(body, 2);
+            for (int bit = 0; bit < 16; bit++) {
+                uint8_t bad[2] = {body[0], body[1]};
+                bad[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+                TEST_ASSERT_NOT_EQUAL(crc, asrproCrc8(bad, 2));
+            }
+        }
+    }
+}
+
+void test_round_trip_all_ids_and_sequences() {
+    ASRPROFrameDecoder decoder(MAX_ID);
+    uint8_t seq = 0;
+    for (int n = 0; n < 600; n++) {
+        uint8_t id = (uint8_t)(1 + n % MAX_ID);
+        FeedResult r = feedAll(decoder, makeFrame(id, seq++));
+        TEST_ASSERT_EQUAL(1, r.ids.size());
+        TEST_ASSERT_EQUAL(id, r.ids[0]);
+        TEST_ASSERT_EQUAL(0, r.text.size());
+    }
+    TEST_ASSERT_EQUAL_UINT32(600, decoder.getStats().framesDecoded);
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.getStats().lostFrames);
+}
+
+void test_text_passes_through() {
+    ASRPROFrameDecoder decoder(MAX_ID);
+    std::string line = "点头 nod\n";
+    FeedResult r = feedAll(decoder, std::vector<uint8_t>(line.begin(), line.end()));
+    TEST_ASSERT_EQUAL(0, r.ids.size());
+    TEST_ASSERT_EQUAL_STRING(line.c_str(), r.text.c_str());
+}
+
+void test_utf8_with_sync_byte_passes_through() {
+    // "好" = E5 A5 BD、"奥" = E5 A5 A5、"挥" = E6 8C A5、"祥" 以 A5 A5 结尾且后随换行
+    ASRPROFrameDecoder decoder(MAX_ID);
+    std::string text = "你好，奥运挥手\n祥\n点头\n";
+    FeedResult r = feedAll(decoder, std::vector<uint8_t>(text.begin(), text.end()));
+    decoder.flush();
+    uint8_t t;
+    while (decoder.popTextByte(t)) r.text.push_back((char)t);
+    TEST_ASSERT_EQUAL(0, r.ids.size());
+    TEST_ASSERT_EQUAL_STRING(text.c_str(), r.text.c_str());
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.getStats().framesDecoded);
+}
+
+void test_utf8_with_sync_byte_reaches_keywords_in_auto_mode() {
+    TEST_ASSERT_EQUAL(ASRPRO_LINK_AUTO, ASRPRO_LINK_MODE);
+    hostSetMillis(1000);
+    ASRPROModule asr;
+    asr.begin();
+
+    // 关键词前后都有含 0xA5 的字符，二进制帧也照常解出
+    UART_ASRPRO.rx = "你好奥温度祥\n";
+    std::vector<uint8_t> frame = makeFrame((uint8_t)VoiceCommand::NOD, 1);
+    UART_ASRPRO.rx.append(frame.begin(), frame.end());
+    UART_ASRPRO.rx += "挥手帮助\n";
+    asr.update();
+    hostAdvanceMillis(ASRPRO_FRAME_TIMEOUT + 1);
+    asr.update();
+
+    const VoiceCommand expected[] = {VoiceCommand::HELP, VoiceCommand::QUERY_TEMP, VoiceCommand::NOD};
+    VoiceCommandEntry e;
+    for (VoiceCommand cmd : expected) {
+        TEST_ASSERT_TRUE(asr.nextCommand(e));
+        TEST_ASSERT_EQUAL((int)cmd, (int)e.command);
+    }
+    TEST_ASSERT_FALSE(asr.nextCommand(e));
+    TEST_ASSERT_EQUAL_UINT32(1, asr.getLinkStats().framesDecoded);
+}
+
+void test_corrupted_frame_is_rejected_and_bytes_returned() {
+    ASRPROFrameDecoder decoder(MAX_ID);
+    std::vector<uint8_t> bad = makeFrame(3, 7);
+    bad[3] ^= 0x01;
+    FeedResult r = feedAll(decoder, bad);
+    TEST_ASSERT_EQUAL(0, r.ids.size());
+    TEST_ASSERT_EQUAL(4, r.text.size());
+    TEST_ASSERT_EQUAL_UINT32(1, decoder.getStats().badFrames);
+
+    // 下一帧正常解码
+    r = feedAll(decoder, makeFrame(4, 8));
+    TEST_ASSERT_EQUAL(1, r.ids.size());
+    TEST_ASSERT_EQUAL(4, r.ids[0]);
+}
+
+void test_resync_after_dropped_byte() {
+    // 第一帧丢了 CRC 字节，下一帧的同步字节落在候选帧内部
+    ASRPROFrameDecoder decoder(MAX_ID);
+    std::vector<uint8_t> stream = makeFrame(1, 0);
+    std::vector<uint8_t> first = makeFrame(2, 1);
+    first.pop_back();
+    stream.insert(stream.end(), first.begin(), first.end());
+    std::vector<uint8_t> second = makeFrame(5, 2);
+    stream.insert(stream.end(), second.begin(), second.end());
+    FeedResult r = feedAll(decoder, stream);
+    TEST_ASSERT_EQUAL(2, r.ids.size());
+    TEST_ASSERT_EQUAL(5, r.ids[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, decoder.getStats().lostFrames);
+}
+
+void test_random_noise_loses_at_most_affected_frames() {
+    std::mt19937 rng(28);
+    ASRPROFrameDecoder decoder(MAX_ID);
+    int sent = 0, damaged = 0, received = 0;
+    uint8_t seq = 0;
+    for (int n = 0; n < 5000; n++) {
+        std::vector<uint8_t> f = makeFrame((uint8_t)(1 + rng() % MAX_ID), seq++);
+        sent++;
+        int kind = rng() % 10;
+        if (kind == 0) {
+            f[1 + rng() % 3] ^= (uint8_t)(1 << (rng() % 8));   // 翻转一位
+            damaged++;
+        } else if (kind == 1) {
+            f.erase(f.begin() + rng() % 4);                     // 丢一个字节
+            damaged++;
+        }
+        // 帧间夹杂不含同步字节的文本
+        if (rng() % 4 == 0) f.push_back('x');
+        received += (int)feedAll(decoder, f).ids.size();
+    }
+    decoder.flush();
+    TEST_ASSERT_GREATER_OR_EQUAL(sent - 2 * damaged, received);
+    TEST_ASSERT_LESS_OR_EQUAL(sent, received);
+    // 固定种子：每个损坏的帧恰好只损失它自己
+    TEST_ASSERT_EQUAL(5000, sent);
+    TEST_ASSERT_EQUAL(DAMAGED_WITH_SEED_28, damaged);
+    TEST_ASSERT_EQUAL(sent - damaged, received);
+}
+
+void test_garbage_between_frames_recovers_every_frame() {
+    // 帧间插入随机垃圾（约一半含同步字节），每一帧完好的帧都必须恢复；
+    // 垃圾以 CRC-8 的概率偶尔解出假帧，但不能吞掉后面的真实帧
+    std::mt19937 rng(29);
+    ASRPROFrameDecoder decoder(MAX_ID);
+    std::vector<uint8_t> stream;
+    size_t garbageBytes = 0;
+    const int FRAMES = 2000;
+    for (int n = 0; n < FRAMES; n++) {
+        size_t garbage = rng() % 8;
+        for (size_t i = 0; i < garbage; i++) {
+            stream.push_back((uint8_t)rng());
+        }
+        if (garbage > 0 && rng() % 2 == 0) {
+            stream[stream.size() - 1 - rng() % garbage] = ASRPRO_FRAME_SYNC;
+        }
+        garbageBytes += garbage;
+        std::vector<uint8_t> f = makeFrame((uint8_t)(1 + n % MAX_ID), (uint8_t)n);
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+
+    // 按顺序匹配真实帧（指令 + 序号），其余为垃圾碰巧通过 CRC-8 的假帧
+    int matched = 0, spurious = 0;
+    size_t text = 0;
+    uint8_t t;
+    for (size_t i = 0; i < stream.size(); i++) {
+        bool decoded = decoder.feed(stream[i], 0);
+        while (decoder.popTextByte(t)) text++;
+        if (!decoded) continue;
+        if (matched < FRAMES && decoder.getCommandId() == 1 + matched % MAX_ID &&
+            decoder.getSequence() == (uint8_t)matched) {
+            matched++;
+        } else {
+            spurious++;
+        }
+    }
+    decoder.flush();
+    while (decoder.popTextByte(t)) text++;
+
+    TEST_ASSERT_EQUAL(FRAMES, matched);
+    TEST_ASSERT_EQUAL(SPURIOUS_WITH_SEED_29, spurious);
+    TEST_ASSERT_EQUAL_UINT32(FRAMES + spurious, decoder.getStats().framesDecoded);
+    // 假帧只由垃圾组成；其余垃圾字节全部交还给文本通道
+    TEST_ASSERT_EQUAL_size_t(garbageBytes - spurious * ASRPRO_FRAME_SIZE, text);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%d frames after %lu garbage bytes: %d recovered, %d spurious",
+             FRAMES, (unsigned long)garbageBytes, matched, spurious);
+    TEST_MESSAGE(line);
+}
+
+void test_retransmission_is_dropped_within_window() {
+    ASRPROFrameDecoder decoder(MAX_ID);
+    TEST_ASSERT_EQUAL(1, feedAll(decoder, makeFrame(3, 9), 1000).ids.size());
+    TEST_ASSERT_EQUAL(0, feedAll(decoder, makeFrame(3, 9), 1100).ids.size());
+    // 重发间隔从最近一次收到算起
+    TEST_ASSERT_EQUAL(0, feedAll(decoder, makeFrame(3, 9), 1100 + ASRPRO_DUPLICATE_WINDOW).ids.size());
+    TEST_ASSERT_EQUAL_UINT32(2, decoder.getStats().duplicates);
+}
+
+void test_reused_sequence_after_gap_is_accepted() {
+    // 对端复位后从同一序号重新开始
+    ASRPROFrameDecoder decoder(MAX_ID);
+    TEST_ASSERT_EQUAL(1, feedAll(decoder, makeFrame(3, 0), 1000).ids.size());
+    FeedResult r = feedAll(decoder, makeFrame(6, 0), 1001 + ASRPRO_DUPLICATE_WINDOW);
+    TEST_ASSERT_EQUAL(1, r.ids.size());
+    TEST_ASSERT_EQUAL(6, r.ids[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.getStats().duplicates);
+    TEST_ASSERT_EQUAL_UINT32(1, decoder.getStats().sequenceResets);
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.getStats().lostFrames);
+}
+
+void test_flush_returns_partial_frame() {
+    ASRPROFrameDecoder decoder(MAX_ID);
+    std::vector<uint8_t> f = makeFrame(2, 0);
+    f.pop_back();
+    feedAll(decoder, f);
+    TEST_ASSERT_TRUE(decoder.isPending());
+    decoder.flush();
+    TEST_ASSERT_FALSE(decoder.isPending());
+    uint8_t t;
+    int count = 0;
+    while (decoder.popTextByte(t)) count++;
+    TEST_ASSERT_EQUAL(3, count);
+    TEST_ASSERT_EQUAL_UINT32(1, decoder.getStats().timeouts);
+}
+
+/**
+ * 每帧解码耗时（逐字节 feed + 取空交还字节），与串口传输一帧的时间对照
+ */
+void test_decode_latency() {
+    using Clock = std::chrono::steady_clock;
+    const int FRAMES = 200000;
+    std::vector<uint8_t> stream;
+    stream.reserve(FRAMES * ASRPRO_FRAME_SIZE);
+    for (int n = 0; n < FRAMES; n++) {
+        std::vector<uint8_t> f = makeFrame((uint8_t)(1 + n % MAX_ID), (uint8_t)n);
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+
+    ASRPROFrameDecoder decoder(MAX_ID);
+    uint32_t decoded = 0;
+    Clock::time_point t0 = Clock::now();
+    for (size_t i = 0; i < stream.size(); i++) {
+        decoded += decoder.feed(stream[i], i / 64) ? 1 : 0;
+        uint8_t t;
+        while (decoder.popTextByte(t)) {}
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / FRAMES;
+    TEST_ASSERT_EQUAL_UINT32(FRAMES, decoded);
+
+    double wireMicros = ASRPRO_FRAME_SIZE * 10 * 1e6 / UART_BAUD_ASRPRO;
+    char line[128];
+    snprintf(line, sizeof(line), "decode: %.1f ns/frame on host; frame on the wire at %d baud: %.0f us",
+             ns, UART_BAUD_ASRPRO, wireMicros);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc8_known_vectors);
+    RUN_TEST(test_crc8_detects_every_single_bit_error);
+    RUN_TEST(test_round_trip_all_ids_and_sequences);
+    RUN_TEST(test_text_passes_through);
+    RUN_TEST(test_utf8_with_sync_byte_passes_through);
+    RUN_TEST(test_utf8_with_sync_byte_reaches_keywords_in_auto_mode);
+    RUN_TEST(test_corrupted_frame_is_rejected_and_bytes_returned);
+    RUN_TEST(test_resync_after_dropped_byte);
+    RUN_TEST(test_random_noise_loses_at_most_affected_frames);
+    RUN_TEST(test_garbage_between_frames_recovers_every_frame);
+    RUN_TEST(test_retransmission_is_dropped_within_window);
+    RUN_TEST(test_reused_sequence_after_gap_is_accepted);
+    RUN_TEST(test_flush_returns_partial_frame);
+    RUN_TEST(test_decode_latency);
+    return UNITY_END();
+}
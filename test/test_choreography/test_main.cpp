@@ -0,0 +1,350 @@
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Choreography.h"
+#include "Choreography_Builtin.h"
+#include "ASRPRO_Module.h"
+#include "DHT_Manager.h"
+
+/**
+ * 编舞字节码：校验器拒绝各类非法脚本、解释器的循环/分支/时长、每次 update() 的指令上限，
+ * 以及随机脚本通过校验后一定在有限时间内播放完毕
+ */
+
+static const uint32_t TICK_MS = 1000 / SERVO_UPDATE_RATE_HZ;
+
+// ==================== 脚本构造 ====================
+
+/**
+ * 测试用的小汇编器：指令区 + 文本表，build() 补上头部与 CRC
+ */
+struct Script {
+    std::vector<uint8_t> code;
+    std::vector<std::string> strings;
+
+    Script& op(ChoreoOp o) { code.push_back((uint8_t)o); return *this; }
+    Script& u8(uint8_t v) { code.push_back(v); return *this; }
+    Script& u16(uint16_t v) { code.push_back((uint8_t)v); code.push_back((uint8_t)(v >> 8)); return *this; }
+
+    Script& move(uint8_t head, uint8_t nod, uint16_t ms) { return op(ChoreoOp::MOVE).u8(head).u8(nod).u16(ms); }
+    Script& wait(uint16_t ms) { return op(ChoreoOp::WAIT).u16(ms); }
+    Script& emotion(EmotionState e) { return op(ChoreoOp::EMOTION).u8((uint8_t)e); }
+    Script& say(uint8_t index) { return op(ChoreoOp::SAY).u8(index); }
+    Script& loop(uint8_t count) { return op(ChoreoOp::LOOP).u8(count); }
+    Script& endLoop() { return op(ChoreoOp::ENDLOOP); }
+    Script& jump(uint16_t target) { return op(ChoreoOp::JUMP).u16(target); }
+    Script& branch(ChoreoSensor s, ChoreoCompare c, int16_t value, uint16_t target) {
+        return op(ChoreoOp::BRANCH).u8((uint8_t)s).u8((uint8_t)c).u16((uint16_t)value).u16(target);
+    }
+    Script& end() { return op(ChoreoOp::END); }
+    uint16_t here() const { return (uint16_t)code.size(); }
+
+    std::vector<uint8_t> build() const {
+        std::vector<uint8_t> s = {CHOREO_MAGIC_0, CHOREO_MAGIC_1, CHOREO_VERSION, (uint8_t)strings.size(),
+                                  0, 0, 0, 0, 0, 0};
+        s.insert(s.end(), code.begin(), code.end());
+        for (const std::string& text : strings) {
+            s.insert(s.end(), text.begin(), text.end());
+            s.push_back(0);
+        }
+        s[4] = (uint8_t)code.size();
+        s[5] = (uint8_t)(code.size() >> 8);
+        s[6] = (uint8_t)s.size();
+        s[7] = (uint8_t)(s.size() >> 8);
+        uint16_t crc = choreoCrc16(s.data() + CHOREO_HEADER_SIZE, s.size() - CHOREO_HEADER_SIZE);
+        s[8] = (uint8_t)crc;
+        s[9] = (uint8_t)(crc >> 8);
+        return s;
+    }
+};
+
+static ChoreoVerifyError verify(const std::vector<uint8_t>& s) {
+    ChoreoScriptInfo info;
+    return choreoVerify(s.data(), s.size(), info);
+}
+
+static void assertRejected(ChoreoVerifyError expected, const Script& script) {
+    TEST_ASSERT_EQUAL((int)expected, (int)verify(script.build()));
+}
+
+// ==================== 播放 ====================
+
+struct Rig {
+    OLEDDisplay display;
+    ServoController servo;
+    MotionArbiter motion;
+    ASRPROModule asr;
+    DHTManager dht;
+    ChoreographyPlayer player;
+
+    void begin() {
+        DHT::temperature = 24.0f;
+        DHT::humidity = 50.0f;
+        display.begin();
+        servo.begin();
+        motion.begin(&servo);
+        asr.begin();
+        dht.begin();
+        dht.read();
+        player.begin(&display, &motion, &asr, &dht);
+        UART_ASRPRO.tx.clear();
+    }
+
+    void run(uint32_t ms) {
+        for (uint32_t t = 0; t < ms; t += TICK_MS) {
+            servo.tick();
+            hostAdvanceMillis(TICK_MS);
+            player.update();
+            motion.update();
+            servo.update();
+            asr.update();
+        }
+    }
+
+    // 播放到结束，返回用时（毫秒）
+    uint32_t playToEnd(uint32_t limit = 200000) {
+        uint32_t elapsed = 0;
+        while (player.isPlaying() && elapsed < limit) {
+            run(TICK_MS);
+            elapsed += TICK_MS;
+        }
+        return elapsed;
+    }
+};
+
+static Rig* rig;
+
+void setUp() {
+    rig = new Rig();
+    rig->begin();
+}
+
+void tearDown() {
+    delete rig;
+}
+
+// ==================== 校验 ====================
+
+void test_builtin_scripts_verify() {
+    ChoreoScriptInfo info;
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::NONE, (int)choreoVerify(CHOREO_DANCE, sizeof(CHOREO_DANCE), info));
+    TEST_ASSERT_EQUAL(1, info.stringCount);
+    TEST_ASSERT_TRUE(info.moves);
+    // 与 DANCE_MOTIONS 相同的总时长
+    TEST_ASSERT_EQUAL_UINT32(5 * 300 + 200, info.maxDuration);
+
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::NONE,
+                      (int)choreoVerify(CHOREO_WEATHER_REACTION, sizeof(CHOREO_WEATHER_REACTION), info));
+    TEST_ASSERT_EQUAL(2, info.stringCount);
+}
+
+void test_header_and_crc_are_checked() {
+    std::vector<uint8_t> good = Script().move(45, 90, 300).end().build();
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::NONE, (int)verify(good));
+
+    std::vector<uint8_t> s = good;
+    s[0] = 'X';
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::HEADER, (int)verify(s));
+    s = good;
+    s[2] = CHOREO_VERSION + 1;
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::HEADER, (int)verify(s));
+    s = good;
+    s.push_back(0);                                  // 总长度与头部不符
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::HEADER, (int)verify(s));
+    s = good;
+    s[CHOREO_HEADER_SIZE + 1] = 46;                  // 改动内容但不更新 CRC
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::CRC, (int)verify(s));
+
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::HEADER, (int)verify(std::vector<uint8_t>(good.begin(), good.begin() + 8)));
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::HEADER,
+                      (int)verify(std::vector<uint8_t>(CHOREO_SCRIPT_MAX + 1, 0)));
+}
+
+void test_operands_are_checked() {
+    assertRejected(ChoreoVerifyError::OPERAND, Script().move(181, 90, 100).end());
+    assertRejected(ChoreoVerifyError::OPERAND, Script().move(90, 90, 0).end());
+    assertRejected(ChoreoVerifyError::OPERAND, Script().wait(0).end());
+    assertRejected(ChoreoVerifyError::OPERAND, Script().u8((uint8_t)ChoreoOp::EMOTION).u8(200).end());
+    assertRejected(ChoreoVerifyError::OPERAND, Script().say(0).end());        // 没有文本
+    assertRejected(ChoreoVerifyError::OPERAND, Script().loop(0).wait(10).endLoop().end());
+    assertRejected(ChoreoVerifyError::OPERAND,
+                   Script().op(ChoreoOp::BRANCH).u8(9).u8(0).u16(0).u16(7).end());
+    assertRejected(ChoreoVerifyError::OPCODE, Script().u8(0xEE).end());
+    assertRejected(ChoreoVerifyError::OPCODE, Script().op(ChoreoOp::MOVE).u8(90));   // 指令被截断
+
+    Script text;
+    text.strings = {std::string(SPEECH_TEXT_MAX_LEN, 'x')};
+    text.say(0).end();
+    assertRejected(ChoreoVerifyError::STRINGS, text);
+}
+
+void test_control_flow_is_checked() {
+    // 向后跳转
+    assertRejected(ChoreoVerifyError::TARGET, Script().wait(10).jump(0).end());
+    // 跳到指令中间
+    assertRejected(ChoreoVerifyError::TARGET, Script().jump(4).wait(10).end());
+    // 跳出循环
+    assertRejected(ChoreoVerifyError::TARGET, Script().loop(2).jump(8).endLoop().wait(10).end());
+    // 跳进循环
+    assertRejected(ChoreoVerifyError::TARGET, Script().jump(5).loop(2).wait(10).endLoop().end());
+    // 循环不配对、嵌套过深
+    assertRejected(ChoreoVerifyError::LOOP, Script().endLoop().end());
+    assertRejected(ChoreoVerifyError::LOOP, Script().loop(2).wait(10).end());
+    Script deep;
+    for (int i = 0; i <= CHOREO_LOOP_DEPTH; i++) deep.loop(2);
+    deep.wait(10);
+    for (int i = 0; i <= CHOREO_LOOP_DEPTH; i++) deep.endLoop();
+    assertRejected(ChoreoVerifyError::LOOP, deep.end());
+    // 不以 END 结束
+    assertRejected(ChoreoVerifyError::NO_END, Script().wait(10));
+    // 嵌套循环累计的时长超过上限
+    assertRejected(ChoreoVerifyError::DURATION,
+                   Script().loop(255).loop(255).wait(60000).endLoop().endLoop().end());
+
+    // 同层向前跳转是允许的
+    Script ok;
+    ok.loop(2).branch(ChoreoSensor::TEMPERATURE, ChoreoCompare::GREATER, 300, 12).wait(10).endLoop().end();
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::NONE, (int)verify(ok.build()));
+}
+
+// ==================== 解释 ====================
+
+void test_loops_repeat_body_and_time_adds_up() {
+    Script s;
+    s.loop(3).move(60, CHOREO_ANGLE_HOLD, 200).move(120, CHOREO_ANGLE_HOLD, 200).endLoop().end();
+    std::vector<uint8_t> bytes = s.build();
+    uint32_t lead = rig->motion.wakeDelay() + SERVO_OUTPUT_LATENCY_MS;
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::NONE, (int)rig->player.play(bytes.data(), bytes.size()));
+
+    // 脚本时间从舵机开始输出算起
+    TEST_ASSERT_UINT32_WITHIN(TICK_MS, 3 * 400 + lead, rig->playToEnd());
+    const ChoreoPlayerStats& stats = rig->player.getStats();
+    TEST_ASSERT_EQUAL_UINT32(1 + 3 * 3 + 1, stats.ops);    // LOOP、3 ×（MOVE MOVE ENDLOOP）、END
+    TEST_ASSERT_EQUAL_UINT32(0, stats.lateArms);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.budgetStalls);
+}
+
+void test_branch_follows_sensor_reading() {
+    // 温度 > 30.0 时显示热警告，否则显示开心
+    Script s;
+    s.branch(ChoreoSensor::TEMPERATURE, ChoreoCompare::GREATER, 300, 12)
+     .emotion(EmotionState::HAPPY).jump(14)
+     .emotion(EmotionState::HOT_WARNING)
+     .wait(100).end();
+    std::vector<uint8_t> bytes = s.build();
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::NONE, (int)verify(bytes));
+
+    rig->player.play(bytes.data(), bytes.size());
+    rig->playToEnd();
+    TEST_ASSERT_EQUAL((int)EmotionState::HAPPY, (int)rig->display.getEmotion());
+
+    DHT::temperature = 35.0f;
+    hostAdvanceMillis(SENSOR_READ_INTERVAL);
+    rig->dht.read();
+    rig->player.play(bytes.data(), bytes.size());
+    rig->playToEnd();
+    TEST_ASSERT_EQUAL((int)EmotionState::HOT_WARNING, (int)rig->display.getEmotion());
+}
+
+void test_say_is_sent_at_script_time() {
+    Script s;
+    s.strings = {"Hello"};
+    s.wait(300).say(0).wait(100).end();
+    std::vector<uint8_t> bytes = s.build();
+    rig->player.play(bytes.data(), bytes.size());
+    rig->run(300 - 2 * TICK_MS);
+    TEST_ASSERT_TRUE(UART_ASRPRO.tx.empty());
+    rig->playToEnd();
+    TEST_ASSERT_EQUAL_STRING("Hello\n", UART_ASRPRO.tx.c_str());
+}
+
+void test_ops_per_update_are_bounded() {
+    // 不耗时的指令：一次 update() 放不下，分摊到后续 update()
+    Script s;
+    s.loop(200).emotion(EmotionState::HAPPY).endLoop().wait(50).end();
+    std::vector<uint8_t> bytes = s.build();
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point t0 = Clock::now();
+    rig->player.play(bytes.data(), bytes.size());
+    uint32_t maxOps = rig->player.getStats().ops;
+    while (rig->player.isPlaying()) {
+        uint32_t before = rig->player.getStats().ops;
+        hostAdvanceMillis(TICK_MS);
+        rig->player.update();
+        uint32_t ops = rig->player.getStats().ops - before;
+        if (ops > maxOps) maxOps = ops;
+    }
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+
+    const ChoreoPlayerStats& stats = rig->player.getStats();
+    TEST_ASSERT_EQUAL_UINT32(1 + 200 * 2 + 2, stats.ops);
+    TEST_ASSERT_EQUAL_UINT32(CHOREO_OPS_PER_TICK, maxOps);
+    TEST_ASSERT_TRUE(stats.budgetStalls >= stats.ops / CHOREO_OPS_PER_TICK - 1);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%lu ops in %lu updates, %.0f ns/op",
+             (unsigned long)stats.ops, (unsigned long)stats.ticks, ns / stats.ops);
+    TEST_MESSAGE(line);
+}
+
+/**
+ * 随机脚本：通过校验的都能在 maxDuration（加舵机提前量）内播放完毕
+ */
+void test_random_verified_scripts_terminate() {
+    uint32_t seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1664525UL + 1013904223UL;
+        return seed >> 8;
+    };
+
+    uint32_t accepted = 0;
+    for (int n = 0; n < 3000; n++) {
+        Script s;
+        s.strings = {"a", "b"};
+        int count = 1 + next() % 12;
+        for (int i = 0; i < count; i++) {
+            switch (next() % 9) {
+                case 0: s.move((uint8_t)(next() % 200), (uint8_t)(next() % 200), (uint16_t)(next() % 400)); break;
+                case 1: s.wait((uint16_t)(next() % 300)); break;
+                case 2: s.u8((uint8_t)ChoreoOp::EMOTION).u8((uint8_t)(next() % 10)); break;
+                case 3: s.say((uint8_t)(next() % 3)); break;
+                case 4: s.loop((uint8_t)(next() % 4)); break;
+                case 5: s.endLoop(); break;
+                case 6: s.jump((uint16_t)(s.here() + next() % 12)); break;
+                case 7: s.branch((ChoreoSensor)(next() % 2), (ChoreoCompare)(next() % 4),
+                                 (int16_t)(next() % 600), (uint16_t)(s.here() + next() % 16)); break;
+                default: s.end(); break;
+            }
+        }
+        s.end();
+        std::vector<uint8_t> bytes = s.build();
+        ChoreoScriptInfo info;
+        if (choreoVerify(bytes.data(), bytes.size(), info) != ChoreoVerifyError::NONE) {
+            continue;
+        }
+        accepted++;
+
+        rig->player.play(bytes.data(), bytes.size());
+        uint32_t limit = info.maxDuration + SERVO_WAKE_LEAD_MS + SERVO_OUTPUT_LATENCY_MS + 10 * TICK_MS;
+        uint32_t took = rig->playToEnd(limit + TICK_MS);
+        TEST_ASSERT_FALSE(rig->player.isPlaying());
+        TEST_ASSERT_TRUE(took <= limit);
+    }
+    TEST_ASSERT_TRUE(accepted > 100);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_builtin_scripts_verify);
+    RUN_TEST(test_header_and_crc_are_checked);
+    RUN_TEST(test_operands_are_checked);
+    RUN_TEST(test_control_flow_is_checked);
+    RUN_TEST(test_loops_repeat_body_and_time_adds_up);
+    RUN_TEST(test_branch_follows_sensor_reading);
+    RUN_TEST(test_say_is_sent_at_script_time);
+    RUN_TEST(test_ops_per_update_are_bounded);
+    RUN_TEST(test_random_verified_scripts_terminate);
+    return UNITY_END();
+}
@@ -0,0 +1,306 @@
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include "Config_Store.h"
+#include "Kv_Store.h"
+
+/**
+ * 运行时配置：记录 CRC 损坏时退回上一条或默认值，修改整体校验（范围与高低阈值一致性）
+ * 任一项不通过则全部不生效，存储回收中写入返回 PENDING、由 update() 补写，
+ * 没有变化的提交不编程 Flash，并报告载入耗时与每次提交写入的字数
+ */
+
+// g_config 在任何 begin() 之前即为默认值
+static const RuntimeConfig DEFAULTS = g_config;
+
+static ConfigStore* config = nullptr;
+static int notifications = 0;
+
+static void onConfig(const RuntimeConfig&) {
+    notifications++;
+}
+
+void setUp() {
+    KvStore::hostPowerOn();
+    KvStore::hostFormat();
+    g_kvStore.begin();
+    g_config = DEFAULTS;
+    notifications = 0;
+    config = new ConfigStore();
+    config->setListener(onConfig);
+    config->begin();
+}
+
+void tearDown() {
+    delete config;
+    config = nullptr;
+    g_config = DEFAULTS;
+}
+
+// ==================== 工具 ====================
+
+static bool sameConfig(const RuntimeConfig& a, const RuntimeConfig& b) {
+    return a.tempHigh == b.tempHigh && a.tempLow == b.tempLow &&
+           a.humidHigh == b.humidHigh && a.humidLow == b.humidLow &&
+           a.sensorReadInterval == b.sensorReadInterval &&
+           a.mqttHeartbeatInterval == b.mqttHeartbeatInterval &&
+           a.weatherUpdateInterval == b.weatherUpdateInterval &&
+           strcmp(a.mqttBroker, b.mqttBroker) == 0 &&
+           a.mqttPort == b.mqttPort && a.logLevel == b.logLevel;
+}
+
+static ConfigResult set(const char* json, std::string* replyText = nullptr) {
+    char reply[128];
+    bool publishAll = false;
+    ConfigResult result = config->handleMessage((const uint8_t*)json, strlen(json),
+                                                reply, sizeof(reply), publishAll);
+    if (replyText != nullptr) {
+        *replyText = reply;
+    }
+    return result;
+}
+
+/**
+ * 模拟重启：重新扫描存储并载入配置
+ */
+static void reboot() {
+    g_config = DEFAULTS;
+    g_kvStore.begin();
+    delete config;
+    config = new ConfigStore();
+    config->begin();
+}
+
+/**
+ * 清掉已写入配置值中的一位（NOR Flash 只会 1 -> 0），记录 CRC 随之不符
+ */
+static void corruptStoredConfig() {
+    size_t length;
+    const uint8_t* value = g_kvStore.find(KV_KEY_CONFIG, length);
+    TEST_ASSERT_NOT_NULL(value);
+    uint8_t* flash = const_cast<uint8_t*>(value);     // 主机 Flash 是普通内存
+    for (size_t i = CONFIG_VALUE_HEADER; i < length; i++) {
+        if (flash[i] != 0) {
+            flash[i] &= (uint8_t)(flash[i] - 1);
+            return;
+        }
+    }
+    TEST_FAIL_MESSAGE("no set bit to clear");
+}
+
+/**
+ * 写满存储直到进入回收、写入返回 BUSY
+ */
+static void fillUntilBusy(uint16_t key) {
+    size_t length = KV_VALUE_MAX;
+    for (uint32_t i = 0; i < 100000 && length >= 4; i++) {
+        std::string value(length, '\0');
+        memcpy(&value[0], &i, 4);
+        if (g_kvStore.put(key, value.data(), value.size()) == KvResult::BUSY) {
+            length /= 2;
+        }
+    }
+    TEST_ASSERT_TRUE_MESSAGE(length < 4, "store never became busy");
+}
+
+// ==================== CRC ====================
+
+void test_bad_crc_falls_back_to_defaults() {
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)set("{\"set\":{\"temp_high\":31.5,\"mqtt_port\":1884}}"));
+    reboot();
+    TEST_ASSERT_EQUAL_FLOAT(31.5f, g_config.tempHigh);
+    TEST_ASSERT_EQUAL_UINT16(1884, g_config.mqttPort);
+
+    // 唯一一条记录损坏：全部字段回到默认值
+    corruptStoredConfig();
+    reboot();
+    TEST_ASSERT_TRUE(sameConfig(DEFAULTS, g_config));
+    TEST_ASSERT_EQUAL_UINT32(0, config->getSeq());
+    TEST_ASSERT_EQUAL(0, config->getStats().loadedLength);
+    TEST_ASSERT_EQUAL(1, g_kvStore.getStats().corruptRecords);
+}
+
+void test_bad_crc_falls_back_to_previous_record() {
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)set("{\"set\":{\"sensor_interval\":5000}}"));
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)set("{\"set\":{\"sensor_interval\":7000}}"));
+    TEST_ASSERT_EQUAL_UINT32(2, config->getSeq());
+
+    corruptStoredConfig();
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(5000, g_config.sensorReadInterval);
+    TEST_ASSERT_EQUAL_UINT32(1, config->getSeq());
+}
+
+// ==================== 原子修改 ====================
+
+void test_rejected_update_changes_nothing() {
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)set("{\"set\":{\"temp_high\":31.5}}"));
+    const RuntimeConfig before = g_config;
+    const uint32_t words = g_kvStore.getStats().wordsProgrammed;
+    const int notified = notifications;
+
+    // 前一项有效、后一项超出范围：前一项也不生效
+    std::string reply;
+    TEST_ASSERT_EQUAL((int)ConfigResult::OUT_OF_RANGE,
+                      (int)set("{\"set\":{\"temp_low\":5.0,\"sensor_interval\":999999}}", &reply));
+    TEST_ASSERT_TRUE(reply.find("\"field\":\"sensor_interval\"") != std::string::npos);
+
+    // 每项都在范围内，但低阈值不小于高阈值
+    TEST_ASSERT_EQUAL((int)ConfigResult::INCONSISTENT,
+                      (int)set("{\"set\":{\"sensor_interval\":3000,\"temp_low\":32.0}}"));
+    TEST_ASSERT_EQUAL((int)ConfigResult::INCONSISTENT,
+                      (int)set("{\"set\":{\"humid_high\":20,\"humid_low\":25}}"));
+
+    TEST_ASSERT_EQUAL((int)ConfigResult::UNKNOWN_FIELD,
+                      (int)set("{\"set\":{\"temp_low\":5.0,\"no_such_field\":1}}"));
+    TEST_ASSERT_EQUAL((int)ConfigResult::BAD_VALUE,
+                      (int)set("{\"set\":{\"temp_low\":5.0,\"mqtt_broker\":\"a b\"}}"));
+
+    // 直接调用 stage()/commit() 同样整体拒绝
+    config->beginUpdate();
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)config->stage("temp_low", 8, "35", 2));
+    TEST_ASSERT_EQUAL((int)ConfigResult::INCONSISTENT, (int)config->commit());
+
+    TEST_ASSERT_TRUE(sameConfig(before, g_config));
+    TEST_ASSERT_EQUAL_UINT32(1, config->getSeq());
+    TEST_ASSERT_EQUAL_UINT32(words, g_kvStore.getStats().wordsProgrammed);
+    TEST_ASSERT_EQUAL(notified, notifications);
+
+    // 同一消息里先调高高阈值、再调高低阈值是一致的，一次提交
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)set("{\"set\":{\"temp_high\":40,\"temp_low\":32.0}}"));
+    TEST_ASSERT_EQUAL_UINT32(2, config->getSeq());
+    reboot();
+    TEST_ASSERT_EQUAL_FLOAT(40.0f, g_config.tempHigh);
+    TEST_ASSERT_EQUAL_FLOAT(32.0f, g_config.tempLow);
+}
+
+// ==================== 存储忙 ====================
+
+void test_busy_store_defers_write_until_update() {
+    fillUntilBusy(0x0200);
+    const uint32_t words = g_kvStore.getStats().wordsProgrammed;
+
+    std::string reply;
+    TEST_ASSERT_EQUAL((int)ConfigResult::PENDING, (int)set("{\"set\":{\"mqtt_port\":8883}}", &reply));
+    TEST_ASSERT_TRUE(reply.find("\"result\":\"pending\",\"seq\":0") != std::string::npos);
+
+    // 已生效、已通知，尚未写入
+    TEST_ASSERT_EQUAL_UINT16(8883, g_config.mqttPort);
+    TEST_ASSERT_TRUE(config->isUnsaved());
+    TEST_ASSERT_EQUAL(1, config->getStats().deferred);
+    TEST_ASSERT_EQUAL(2, notifications);            // begin() 一次 + 提交一次
+    TEST_ASSERT_EQUAL_UINT32(words, g_kvStore.getStats().wordsProgrammed);
+
+    // 回收完成前 update() 不写入
+    config->update();
+    TEST_ASSERT_TRUE(config->isUnsaved());
+
+    int idleCalls = 0;
+    while (config->isUnsaved() && idleCalls < 10000) {
+        g_kvStore.update(true);
+        config->update();
+        idleCalls++;
+    }
+    TEST_ASSERT_FALSE(config->isUnsaved());
+    TEST_ASSERT_EQUAL_UINT32(1, config->getSeq());
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT16(8883, g_config.mqttPort);
+    TEST_ASSERT_EQUAL_UINT32(1, config->getSeq());
+
+    char line[96];
+    snprintf(line, sizeof(line), "deferred config saved after %d idle update() calls", idleCalls);
+    TEST_MESSAGE(line);
+}
+
+void test_power_loss_before_deferred_write_keeps_previous() {
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)set("{\"set\":{\"mqtt_port\":1884}}"));
+    fillUntilBusy(0x0200);
+    TEST_ASSERT_EQUAL((int)ConfigResult::PENDING, (int)set("{\"set\":{\"mqtt_port\":8883}}"));
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT16(1884, g_config.mqttPort);
+    TEST_ASSERT_FALSE(config->isUnsaved());
+}
+
+// ==================== 写入量 ====================
+
+void test_unchanged_config_programs_no_flash() {
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)set("{\"set\":{\"temp_high\":31.5}}"));
+    const uint32_t words = g_kvStore.getStats().wordsProgrammed;
+    const uint32_t seq = config->getSeq();
+
+    // 与当前值相同（包括写法不同的同一数值）
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)set("{\"set\":{\"temp_high\":31.5}}"));
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)set("{\"set\":{\"temp_high\":31.50,\"mqtt_port\":1883}}"));
+    config->beginUpdate();
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)config->commit());
+    config->update();
+
+    TEST_ASSERT_EQUAL_UINT32(words, g_kvStore.getStats().wordsProgrammed);
+    TEST_ASSERT_EQUAL_UINT32(seq, config->getSeq());
+
+    // 已是默认值时恢复默认也不写
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)config->reset());
+    const uint32_t afterReset = g_kvStore.getStats().wordsProgrammed;
+    TEST_ASSERT_TRUE(afterReset > words);
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)config->reset());
+    TEST_ASSERT_EQUAL_UINT32(afterReset, g_kvStore.getStats().wordsProgrammed);
+}
+
+void test_load_time_and_write_counts() {
+    using Clock = std::chrono::steady_clock;
+    const int COMMITS = 500;
+
+    // 交替修改两个字段，日志中累积大量旧记录
+    uint32_t wordsBefore = g_kvStore.getStats().wordsProgrammed;
+    int busy = 0;
+    char json[96];
+    for (int i = 0; i < COMMITS; i++) {
+        snprintf(json, sizeof(json), "{\"set\":{\"sensor_interval\":%d,\"temp_high\":%d.5}}",
+                 1000 + i, 30 + i % 10);
+        ConfigResult result = set(json);
+        if (result == ConfigResult::PENDING) {
+            busy++;
+        } else {
+            TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)result);
+        }
+        g_kvStore.update(true);
+        config->update();
+    }
+    while (config->isUnsaved()) {
+        g_kvStore.update(true);
+        config->update();
+    }
+    const KvStats& kv = g_kvStore.getStats();
+    uint32_t words = kv.wordsProgrammed - wordsBefore;
+
+    Clock::time_point t0 = Clock::now();
+    reboot();
+    double loadMicros = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+
+    TEST_ASSERT_EQUAL_UINT32(1000 + COMMITS - 1, g_config.sensorReadInterval);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)COMMITS, config->getSeq());
+
+    char line[160];
+    snprintf(line, sizeof(line), "%d commits (%d deferred): %lu words programmed, %.1f words/commit "
+             "(%lu copied by reclaim), %u erases",
+             COMMITS, busy, (unsigned long)words, (double)words / COMMITS,
+             (unsigned long)kv.wordsCopied, (unsigned)kv.erases);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "load after %d commits: %u records scanned, %.0f us (store scan + config)",
+             COMMITS, (unsigned)g_kvStore.getStats().recordsScanned, loadMicros);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bad_crc_falls_back_to_defaults);
+    RUN_TEST(test_bad_crc_falls_back_to_previous_record);
+    RUN_TEST(test_rejected_update_changes_nothing);
+    RUN_TEST(test_busy_store_defers_write_until_update);
+    RUN_TEST(test_power_loss_before_deferred_write_keeps_previous);
+    RUN_TEST(test_unchanged_config_programs_no_flash);
+    RUN_TEST(test_load_time_and_write_counts);
+    return UNITY_END();
+}
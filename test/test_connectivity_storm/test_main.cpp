@@ -0,0 +1,381 @@
+#include <unity.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <PubSubClient.h>
+#include "Connectivity_Supervisor.h"
+
+/**
+ * 100 台设备的重连风暴：真实的 ConnectivitySupervisor / WiFiManager / MQTTManager，
+ * 路由器、MQTT 服务器（每秒受理的 CONNECT 有上限）与天气 API 为模型
+ *
+ * 与旧逻辑（WiFi 指数退避不抖动、10 次后放弃，MQTT 每 5 秒重试，天气失败后每个循环重试）
+ * 以及所有设备同一种子的监管对照：故障恢复后每秒的重连峰值、被拒绝的 CONNECT、
+ * 天气请求总数，以及全部设备重新连上 MQTT 的时间
+ */
+
+static const int DEVICES = 100;
+static const unsigned long MINUTE = 60000;
+
+// ==================== 网络模型 ====================
+
+/**
+ * 一台设备看到的网络
+ */
+struct Net {
+    bool link = false;
+    bool associating = false;
+    unsigned long associateAt = 0;
+};
+
+static Net* current = nullptr;              // 正在运行的设备
+static bool routerUp = true, brokerUp = true, weatherUp = true;
+static const int BROKER_CAPACITY = 10;      // 每秒最多受理的 CONNECT
+static std::mt19937 environment(42);
+
+/**
+ * 每秒计数
+ */
+struct Counter {
+    std::vector<int> perSecond;
+    long total = 0;
+
+    void add() {
+        size_t second = millis() / 1000;
+        if (perSecond.size() <= second) {
+            perSecond.resize(second + 1);
+        }
+        perSecond[second]++;
+        total++;
+    }
+    int peak(size_t from = 0) const {
+        int p = 0;
+        for (size_t i = from; i < perSecond.size(); i++) {
+            p = std::max(p, perSecond[i]);
+        }
+        return p;
+    }
+};
+
+static Counter wifiBegins, brokerAttempts, brokerRejects, weatherRequests;
+static int acceptedSecond = -1, acceptedCount = 0;
+
+// WiFi.begin()：关联需要 2~6 秒，路由器不在时不会连上
+static void onWiFiBegin() {
+    wifiBegins.add();
+    current->associating = routerUp;
+    current->associateAt = millis() + 2000 + environment() % 4000;
+}
+
+// MQTT CONNECT：服务器每秒只受理 BROKER_CAPACITY 个
+static bool onBrokerConnect() {
+    if (!current->link) {
+        return false;
+    }
+    brokerAttempts.add();
+    if (!brokerUp) {
+        return false;
+    }
+    int second = (int)(millis() / 1000);
+    if (second != acceptedSecond) {
+        acceptedSecond = second;
+        acceptedCount = 0;
+    }
+    if (acceptedCount >= BROKER_CAPACITY) {
+        brokerRejects.add();
+        return false;
+    }
+    acceptedCount++;
+    return true;
+}
+
+// ==================== 设备 ====================
+
+enum class Policy { LEGACY, SUPERVISOR_SAME_SEED, SUPERVISOR };
+
+struct Device {
+    Net net;
+    WiFiClient client;
+    WiFiManager wifi;
+    MQTTManager mqtt;
+    PubSubClient* broker;                   // mqtt 内部的客户端替身
+    ConnectivitySupervisor supervisor;
+    bool weatherValid = false;
+    unsigned long lastWeather = 0;
+
+    // 旧逻辑
+    uint16_t wifiAttempts = 0;
+    unsigned long lastWifiAttempt = 0;
+    unsigned long lastMqttAttempt = 0;
+
+    Device() : mqtt(client), broker(PubSubClient::instance) {}
+};
+
+static void tickNet(Device& d) {
+    unsigned long now = millis();
+    if (!routerUp) {
+        d.net.link = false;
+        d.net.associating = false;
+    }
+    if (d.net.associating && now >= d.net.associateAt) {
+        d.net.associating = false;
+        d.net.link = routerUp;
+    }
+    if ((!brokerUp || !d.net.link) && d.broker->isConnected()) {
+        d.broker->disconnect();
+    }
+    d.broker->sent.clear();
+    WiFi.linkStatus = d.net.link ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+static void step(Device& d, Policy policy) {
+    current = &d.net;
+    tickNet(d);
+    unsigned long now = millis();
+    bool needWeather = !d.weatherValid || now - d.lastWeather > WEATHER_UPDATE_INTERVAL;
+
+    if (policy != Policy::LEGACY) {
+        d.supervisor.update();
+        d.mqtt.update();
+        if (needWeather && d.supervisor.isReady(ConnLayer::WEATHER)) {
+            weatherRequests.add();
+            bool ok = weatherUp && d.net.link;
+            d.supervisor.report(ConnLayer::WEATHER, ok);
+            if (ok) {
+                d.weatherValid = true;
+                d.lastWeather = now;
+            }
+        }
+        return;
+    }
+
+    if (d.net.link) {
+        d.wifiAttempts = 0;
+    } else {
+        unsigned long wait = std::min(1000UL << std::min<uint16_t>(d.wifiAttempts, 16), 60000UL);
+        if (now - d.lastWifiAttempt >= wait) {
+            d.lastWifiAttempt = now;
+            if (d.wifiAttempts < 10) {
+                d.wifi.connect();
+                d.wifiAttempts++;
+            }
+        }
+    }
+    d.mqtt.update();
+    if (!d.mqtt.isConnectedToMQTT() && now - d.lastMqttAttempt > 5000) {
+        d.lastMqttAttempt = now;
+        d.mqtt.connect();
+    }
+    if (needWeather && d.net.link) {
+        weatherRequests.add();
+        if (weatherUp) {
+            d.weatherValid = true;
+            d.lastWeather = now;
+        }
+    }
+}
+
+// ==================== 场景 ====================
+
+struct Outage {
+    unsigned long from, to;
+
+    bool covers(unsigned long t) const { return t >= from && t < to; }
+};
+
+static const Outage NO_OUTAGE = {0, 0};
+
+struct Result {
+    int wifiPeak, brokerPeak, weatherPeak;      // 故障结束后每秒的峰值（天气为全程）
+    long wifiTotal, brokerTotal, rejects, weatherTotal;
+    double p50, p100;                           // 故障结束后设备连上 MQTT 的时间（秒）
+    int stranded;                               // 到结束仍未连上的设备数
+};
+
+static Result run(Policy policy, unsigned long duration, unsigned long stepMs, Outage router, Outage brokerDown,
+                  Outage weather = NO_OUTAGE, bool coldBoot = false) {
+    wifiBegins = brokerAttempts = brokerRejects = weatherRequests = Counter();
+    acceptedSecond = -1;
+    environment.seed(42);
+    hostSetMillis(0);
+    routerUp = !coldBoot;
+    brokerUp = weatherUp = true;
+
+    std::vector<std::unique_ptr<Device>> devices;
+    std::mt19937 uid(7);
+    for (int i = 0; i < DEVICES; i++) {
+        devices.emplace_back(new Device());
+        Device& d = *devices.back();
+        current = &d.net;
+        d.wifi.begin("ssid", "pw");
+        d.mqtt.begin("broker", 1883);
+        d.supervisor.begin(&d.wifi, &d.mqtt);
+        d.supervisor.setSeed(policy == Policy::SUPERVISOR_SAME_SEED ? 1 : uid());
+        d.net.link = !coldBoot;
+    }
+    unsigned long faultEnd = std::max(router.to, brokerDown.to);
+    std::vector<double> recovered(DEVICES, -1);
+
+    for (unsigned long now = 0; now < duration; now += stepMs) {
+        hostSetMillis(now);
+        routerUp = !router.covers(now);
+        brokerUp = !brokerDown.covers(now);
+        weatherUp = !weather.covers(now);
+        for (int i = 0; i < DEVICES; i++) {
+            step(*devices[i], policy);
+            if (now >= faultEnd && recovered[i] < 0 && devices[i]->broker->isConnected()) {
+                recovered[i] = (now - faultEnd) / 1000.0;
+            }
+        }
+    }
+
+    Result r;
+    size_t from = faultEnd / 1000;
+    r.wifiPeak = wifiBegins.peak(from);
+    r.brokerPeak = brokerAttempts.peak(from);
+    r.weatherPeak = weatherRequests.peak();
+    r.wifiTotal = wifiBegins.total;
+    r.brokerTotal = brokerAttempts.total;
+    r.rejects = brokerRejects.total;
+    r.weatherTotal = weatherRequests.total;
+    std::vector<double> online;
+    for (double t : recovered) {
+        if (t >= 0) {
+            online.push_back(t);
+        }
+    }
+    std::sort(online.begin(), online.end());
+    r.stranded = DEVICES - (int)online.size();
+    r.p50 = online.empty() ? -1 : online[online.size() / 2];
+    r.p100 = online.empty() ? -1 : online.back();
+    return r;
+}
+
+static const char* policyName(Policy p) {
+    switch (p) {
+        case Policy::LEGACY:               return "legacy";
+        case Policy::SUPERVISOR_SAME_SEED: return "supervisor, same seed";
+        case Policy::SUPERVISOR:           return "supervisor";
+    }
+    return "";
+}
+
+static void report(Policy p, const Result& r) {
+    char line[256];
+    snprintf(line, sizeof(line),
+             "%-21s wifi peak %3d/s total %5ld | broker peak %3d/s total %5ld rejected %4ld | "
+             "weather total %8ld peak %5d/s | online p50 %5.1fs all %5.1fs stranded %d",
+             policyName(p), r.wifiPeak, r.wifiTotal, r.brokerPeak, r.brokerTotal, r.rejects,
+             r.weatherTotal, r.weatherPeak, r.p50, r.p100, r.stranded);
+    TEST_MESSAGE(line);
+}
+
+/**
+ * 三种策略各跑一遍，依次为 LEGACY、SUPERVISOR_SAME_SEED、SUPERVISOR
+ */
+struct Comparison {
+    Result legacy, sameSeed, supervisor;
+};
+
+template <typename Scenario>
+static Comparison compare(Scenario scenario) {
+    Comparison c;
+    c.legacy = scenario(Policy::LEGACY);
+    c.sameSeed = scenario(Policy::SUPERVISOR_SAME_SEED);
+    c.supervisor = scenario(Policy::SUPERVISOR);
+    report(Policy::LEGACY, c.legacy);
+    report(Policy::SUPERVISOR_SAME_SEED, c.sameSeed);
+    report(Policy::SUPERVISOR, c.supervisor);
+    return c;
+}
+
+void setUp() {
+    WiFi.onBegin = onWiFiBegin;
+    PubSubClient::onConnect = onBrokerConnect;
+}
+
+void tearDown() {
+    WiFi.onBegin = nullptr;
+    PubSubClient::onConnect = nullptr;
+    current = nullptr;
+}
+
+// ==================== 测试 ====================
+
+void test_wifi_reconnect_is_left_to_supervisor() {
+    // 模块自带的自动重连不退避，会绕过监管的错开
+    WiFiManager wifi;
+    WiFi.autoReconnect = true;
+    wifi.begin("ssid", "pw");
+    TEST_ASSERT_FALSE(WiFi.autoReconnect);
+}
+
+void test_cold_boot_router_late() {
+    Comparison c = compare([](Policy p) {
+        return run(p, 15 * MINUTE, 10, {0, 45000}, NO_OUTAGE, NO_OUTAGE, true);
+    });
+    TEST_ASSERT_EQUAL_INT(0, c.supervisor.stranded);
+    TEST_ASSERT_TRUE(c.supervisor.wifiPeak * 4 <= c.legacy.wifiPeak);
+    TEST_ASSERT_TRUE(c.supervisor.brokerPeak * 4 <= c.legacy.brokerPeak);
+    TEST_ASSERT_TRUE(c.supervisor.rejects * 20 <= c.legacy.rejects);
+}
+
+void test_router_down_ten_minutes() {
+    Comparison c = compare([](Policy p) {
+        return run(p, 30 * MINUTE, 10, {1 * MINUTE, 11 * MINUTE}, NO_OUTAGE);
+    });
+    // 旧逻辑 10 次后放弃，路由器恢复后一台也连不上
+    TEST_ASSERT_EQUAL_INT(DEVICES, c.legacy.stranded);
+    TEST_ASSERT_EQUAL_INT(0, c.supervisor.stranded);
+    TEST_ASSERT_EQUAL_INT(0, c.sameSeed.stranded);
+    // 同一种子时全部设备在同一刻重试
+    TEST_ASSERT_EQUAL_INT(DEVICES, c.sameSeed.wifiPeak);
+    TEST_ASSERT_TRUE(c.supervisor.wifiPeak * 5 <= c.sameSeed.wifiPeak);
+    TEST_ASSERT_TRUE(c.supervisor.brokerPeak <= BROKER_CAPACITY);
+}
+
+void test_broker_down_ten_minutes() {
+    Comparison c = compare([](Policy p) {
+        return run(p, 30 * MINUTE, 10, NO_OUTAGE, {1 * MINUTE, 11 * MINUTE});
+    });
+    TEST_ASSERT_EQUAL_INT(0, c.supervisor.stranded);
+    TEST_ASSERT_EQUAL_INT(0, c.supervisor.wifiTotal);     // 服务器故障不影响链路
+    TEST_ASSERT_TRUE(c.supervisor.brokerPeak * 5 <= c.legacy.brokerPeak);
+    TEST_ASSERT_TRUE(c.supervisor.brokerTotal * 4 <= c.legacy.brokerTotal);
+    TEST_ASSERT_TRUE(c.supervisor.rejects * 4 <= c.legacy.rejects);
+}
+
+void test_weather_api_down_thirty_minutes() {
+    Comparison c = compare([](Policy p) {
+        return run(p, 40 * MINUTE, 10, NO_OUTAGE, NO_OUTAGE, {5 * MINUTE, 35 * MINUTE});
+    });
+    TEST_ASSERT_EQUAL_INT(0, c.supervisor.stranded);
+    // 旧逻辑每个循环重试
+    TEST_ASSERT_TRUE(c.supervisor.weatherTotal * 1000 <= c.legacy.weatherTotal);
+    TEST_ASSERT_TRUE(c.supervisor.weatherPeak * 100 <= c.legacy.weatherPeak);
+}
+
+void test_router_down_six_hours() {
+    Comparison c = compare([](Policy p) {
+        return run(p, 7 * 60 * MINUTE, 100, {1 * MINUTE, 361 * MINUTE}, NO_OUTAGE);
+    });
+    TEST_ASSERT_EQUAL_INT(DEVICES, c.legacy.stranded);
+    TEST_ASSERT_EQUAL_INT(0, c.supervisor.stranded);
+    // 退避到上限后仍错开
+    TEST_ASSERT_TRUE(c.supervisor.wifiPeak * 10 <= c.sameSeed.wifiPeak);
+    TEST_ASSERT_TRUE(c.supervisor.brokerPeak <= BROKER_CAPACITY);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_wifi_reconnect_is_left_to_supervisor);
+    RUN_TEST(test_cold_boot_router_late);
+    RUN_TEST(test_router_down_ten_minutes);
+    RUN_TEST(test_broker_down_ten_minutes);
+    RUN_TEST(test_weather_api_down_thirty_minutes);
+    RUN_TEST(test_router_down_six_hours);
+    return UNITY_END();
+}
@@ -0,0 +1,285 @@
+#include <unity.h>
+#include <vector>
+#include "Deferred_Log.h"
+
+/**
+ * 延迟二进制日志：帧经主机 DMA 模型发出后按 COBS 解码，检查参数编码、字符串截断、
+ * 缓冲区满时的丢帧标记、运行时与编译期级别过滤，以及格式串 ID 与 tools/log_decoder.py 一致
+ */
+
+// 编译期级别提高到 INFO：本文件中的 LOG_DEBUG 整条移除，参数不求值
+#undef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+
+typedef std::vector<uint8_t> Bytes;
+
+static int evaluations = 0;
+
+static int counted(int v) {
+    evaluations++;
+    return v;
+}
+
+/**
+ * 启动 DMA 并完成所有传输，返回线上的原始字节
+ */
+static Bytes transmitAll() {
+    Bytes wire;
+    uint8_t chunk[LOG_BUFFER_SIZE];
+    g_log.update();
+    size_t n;
+    while ((n = DeferredLog::hostTransmit(chunk, sizeof(chunk))) > 0) {
+        wire.insert(wire.end(), chunk, chunk + n);
+    }
+    return wire;
+}
+
+/**
+ * COBS 解码，与 tools/log_decoder.py 的 cobs_decode() 相同
+ */
+static bool cobsDecode(const Bytes& in, Bytes& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < in.size()) {
+        uint8_t code = in[i];
+        if (code == 0 || i + code > in.size() + 1) {
+            return false;
+        }
+        out.insert(out.end(), in.begin() + i + 1, in.begin() + i + code);
+        i += code;
+        if (code < 0xFF && i < in.size()) {
+            out.push_back(0);
+        }
+    }
+    return true;
+}
+
+/**
+ * 按 0x00 切分并解码全部帧
+ */
+static std::vector<Bytes> decodeFrames(const Bytes& wire) {
+    std::vector<Bytes> frames;
+    Bytes encoded, frame;
+    for (uint8_t b : wire) {
+        if (b != 0) {
+            encoded.push_back(b);
+            continue;
+        }
+        TEST_ASSERT_TRUE(cobsDecode(encoded, frame));
+        frames.push_back(frame);
+        encoded.clear();
+    }
+    TEST_ASSERT_EQUAL(0, (int)encoded.size());      // 最后一帧也以分隔符结尾
+    return frames;
+}
+
+static uint32_t u32At(const Bytes& f, size_t offset) {
+    return (uint32_t)f[offset] | ((uint32_t)f[offset + 1] << 8)
+         | ((uint32_t)f[offset + 2] << 16) | ((uint32_t)f[offset + 3] << 24);
+}
+
+static uint32_t frameId(const Bytes& f) { return u32At(f, 1); }
+
+static std::vector<Bytes> logged() {
+    return decodeFrames(transmitAll());
+}
+
+void setUp() {
+    g_log.begin();
+    transmitAll();
+    g_log.setLevel(LOG_LEVEL_DEBUG);
+    evaluations = 0;
+}
+
+void tearDown() {}
+
+// ==================== 格式串 ID ====================
+
+void test_format_ids_match_decoder() {
+    // 期望值由 tools/log_decoder.py 的 format_id(unescape(...)) 算出
+    TEST_ASSERT_EQUAL_HEX32(0x91ecac53UL, logFormatId("[Test] int %d float %.2f str %s"));
+    TEST_ASSERT_EQUAL_HEX32(0xa4cd4d78UL, logFormatId("[Test] 温度 %.1f°C 湿度 %d%%"));
+    TEST_ASSERT_EQUAL_HEX32(0x7586f663UL, logFormatId("[Test] tab\there"));
+    TEST_ASSERT_EQUAL_HEX32(0x58145fe7UL, logFormatId("[Test] " "concat %u"));
+    TEST_ASSERT_EQUAL_HEX32(0xb4c60555UL, logFormatId("[Test] two strings %s %s"));
+    TEST_ASSERT_EQUAL_HEX32(0x24134b34UL, logFormatId("[Test] level %d"));
+
+    // 宏在编译期换算出同一个 ID
+    LOG_INFO("[Test] " "concat %u", 7u);
+    std::vector<Bytes> frames = logged();
+    TEST_ASSERT_EQUAL(1, (int)frames.size());
+    TEST_ASSERT_EQUAL_HEX32(0x58145fe7UL, frameId(frames[0]));
+
+    // 真实格式串不会落入保留 ID
+    TEST_ASSERT_TRUE(logFormatId("") >= LOG_ID_RESERVED);
+}
+
+// ==================== 参数编码 ====================
+
+void test_int_float_and_string_args() {
+    hostSetMillis(123456);
+    LOG_WARN("[Test] int %d float %.2f str %s", -7, 3.25, "abc");
+
+    std::vector<Bytes> frames = logged();
+    TEST_ASSERT_EQUAL(1, (int)frames.size());
+    const Bytes& f = frames[0];
+    TEST_ASSERT_EQUAL(9 + 4 + 4 + 1 + 3, (int)f.size());
+    TEST_ASSERT_EQUAL(LOG_LEVEL_WARN, f[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x91ecac53UL, frameId(f));
+    TEST_ASSERT_EQUAL_UINT32(123456, u32At(f, 5));
+    TEST_ASSERT_EQUAL_INT32(-7, (int32_t)u32At(f, 9));
+
+    float x;
+    uint32_t raw = u32At(f, 13);
+    memcpy(&x, &raw, sizeof(x));
+    TEST_ASSERT_EQUAL_FLOAT(3.25f, x);
+
+    TEST_ASSERT_EQUAL(3, f[17]);
+    TEST_ASSERT_EQUAL_MEMORY("abc", &f[18], 3);
+}
+
+void test_zero_bytes_survive_cobs() {
+    // 参数里的 0x00 经 COBS 编码后不会出现在线上，解码后原样恢复
+    LOG_INFO("[Test] level %d", 0);
+    LOG_INFO("[Test] level %d", 0x00FF0000);
+
+    Bytes wire = transmitAll();
+    size_t zeros = 0;
+    for (uint8_t b : wire) zeros += (b == 0);
+    TEST_ASSERT_EQUAL(2, (int)zeros);
+
+    std::vector<Bytes> frames = decodeFrames(wire);
+    TEST_ASSERT_EQUAL(2, (int)frames.size());
+    TEST_ASSERT_EQUAL_UINT32(0, u32At(frames[0], 9));
+    TEST_ASSERT_EQUAL_UINT32(0x00FF0000UL, u32At(frames[1], 9));
+}
+
+void test_strings_are_truncated() {
+    char longText[61];
+    memset(longText, 'x', 60);
+    longText[60] = 0;
+
+    // 单个字符串不超过 LOG_STRING_MAX；整帧不超过 LOG_FRAME_MAX，长度字节与内容一致
+    LOG_INFO("[Test] two strings %s %s", longText, longText);
+
+    std::vector<Bytes> frames = logged();
+    TEST_ASSERT_EQUAL(1, (int)frames.size());
+    const Bytes& f = frames[0];
+    TEST_ASSERT_EQUAL(LOG_FRAME_MAX, (int)f.size());
+    TEST_ASSERT_EQUAL(LOG_STRING_MAX, f[9]);
+    size_t second = 9 + 1 + LOG_STRING_MAX;
+    TEST_ASSERT_EQUAL(LOG_FRAME_MAX - second - 1, f[second]);
+    TEST_ASSERT_EQUAL('x', f.back());
+
+    // 字节串参数同样带长度前缀
+    const uint8_t payload[3] = {1, 0, 2};
+    LOG_INFO("[Test] int %d float %.2f str %s", 1, 1.0f, logBytes(payload, 3));
+    frames = logged();
+    TEST_ASSERT_EQUAL(3, frames[0][17]);
+    TEST_ASSERT_EQUAL_MEMORY(payload, &frames[0][18], 3);
+}
+
+void test_print_lines_become_text_frames() {
+    g_log.print("hello ");
+    g_log.println(42);
+
+    std::vector<Bytes> frames = logged();
+    TEST_ASSERT_EQUAL(1, (int)frames.size());
+    TEST_ASSERT_EQUAL_UINT32(LOG_ID_TEXT, frameId(frames[0]));
+    TEST_ASSERT_EQUAL(9 + 8, (int)frames[0].size());
+    TEST_ASSERT_EQUAL_MEMORY("hello 42", &frames[0][9], 8);
+}
+
+// ==================== 丢帧标记 ====================
+
+void test_overflow_reports_dropped_frames() {
+    LogStats before = g_log.getStats();
+
+    // DMA 不发送，环形缓冲区写满后整帧丢弃
+    const int attempts = 100;
+    for (int i = 0; i < attempts; i++) {
+        LOG_INFO("[Test] level %d", i);
+    }
+    uint32_t stored = g_log.getStats().frames - before.frames;
+    uint32_t dropped = g_log.getStats().dropped - before.dropped;
+    TEST_ASSERT_TRUE(stored > 0);
+    TEST_ASSERT_TRUE(dropped > 0);
+    TEST_ASSERT_EQUAL(attempts, (int)(stored + dropped));
+    TEST_ASSERT_TRUE(g_log.getStats().highWater <= LOG_BUFFER_SIZE);
+
+    // 缓冲区排空后的下一帧之前先补报丢帧数
+    std::vector<Bytes> frames = logged();
+    TEST_ASSERT_EQUAL((int)stored, (int)frames.size());
+    TEST_ASSERT_EQUAL_INT32((int32_t)stored - 1, (int32_t)u32At(frames.back(), 9));
+
+    LOG_INFO("[Test] level %d", 1000);
+    frames = logged();
+    TEST_ASSERT_EQUAL(2, (int)frames.size());
+    TEST_ASSERT_EQUAL_UINT32(LOG_ID_DROPPED, frameId(frames[0]));
+    TEST_ASSERT_EQUAL(LOG_LEVEL_WARN, frames[0][0]);
+    TEST_ASSERT_EQUAL_UINT32(dropped, u32At(frames[0], 9));
+    TEST_ASSERT_EQUAL_INT32(1000, (int32_t)u32At(frames[1], 9));
+
+    char line[128];
+    snprintf(line, sizeof(line), "%d frames attempted with DMA stalled: %lu stored, %lu dropped, high water %u B",
+             attempts, (unsigned long)stored, (unsigned long)dropped,
+             (unsigned)g_log.getStats().highWater);
+    TEST_MESSAGE(line);
+}
+
+// ==================== 级别过滤 ====================
+
+void test_runtime_level_filters_frames() {
+    g_log.setLevel(LOG_LEVEL_WARN);
+    LOG_INFO("[Test] level %d", counted(1));
+    LOG_WARN("[Test] level %d", counted(2));
+    LOG_ERROR("[Test] level %d", counted(3));
+
+    // 级别关闭时参数不求值
+    TEST_ASSERT_EQUAL(2, evaluations);
+    std::vector<Bytes> frames = logged();
+    TEST_ASSERT_EQUAL(2, (int)frames.size());
+    TEST_ASSERT_EQUAL(LOG_LEVEL_WARN, frames[0][0]);
+    TEST_ASSERT_EQUAL(LOG_LEVEL_ERROR, frames[1][0]);
+
+    // 输入录制不受运行时级别影响
+    g_log.setLevel(LOG_LEVEL_OFF);
+    LOG_ERROR("[Test] level %d", counted(4));
+    const uint8_t input[2] = {3, 9};
+    TEST_ASSERT_TRUE(g_log.record(input, sizeof(input)));
+    frames = logged();
+    TEST_ASSERT_EQUAL(1, (int)frames.size());
+    TEST_ASSERT_EQUAL_UINT32(LOG_ID_INPUT, frameId(frames[0]));
+    TEST_ASSERT_EQUAL(2, evaluations);
+}
+
+void test_compile_level_removes_debug_calls() {
+    // 运行时级别放到最低，LOG_DEBUG 仍被 LOG_COMPILE_LEVEL 在编译期移除
+    TEST_ASSERT_TRUE(g_log.enabled(LOG_LEVEL_DEBUG));
+    LOG_DEBUG("[Test] level %d", counted(1));
+    LOG_INFO("[Test] level %d", counted(2));
+
+    TEST_ASSERT_EQUAL(1, evaluations);
+    std::vector<Bytes> frames = logged();
+    TEST_ASSERT_EQUAL(1, (int)frames.size());
+    TEST_ASSERT_EQUAL(LOG_LEVEL_INFO, frames[0][0]);
+
+    // 直接调用 emit() 只受运行时级别约束
+    g_log.emit(LOG_LEVEL_DEBUG, logFormatId("[Test] level %d"), 5);
+    frames = logged();
+    TEST_ASSERT_EQUAL(1, (int)frames.size());
+    TEST_ASSERT_EQUAL(LOG_LEVEL_DEBUG, frames[0][0]);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_format_ids_match_decoder);
+    RUN_TEST(test_int_float_and_string_args);
+    RUN_TEST(test_zero_bytes_survive_cobs);
+    RUN_TEST(test_strings_are_truncated);
+    RUN_TEST(test_print_lines_become_text_frames);
+    RUN_TEST(test_overflow_reports_dropped_frames);
+    RUN_TEST(test_runtime_level_filters_frames);
+    RUN_TEST(test_compile_level_removes_debug_calls);
+    return UNITY_END();
+}
@@ -0,0 +1,418 @@
+#include <unity.h>
+#include <algorithm>
+#include <string>
+#include <WiFiClient.h>
+#include <PubSubClient.h>
+#include "Device_Shadow.h"
+#include "Json_Tokenizer.h"
+#include "Remote_Control.h"
+
+/**
+ * 设备影子经替身服务器与一个按协议实现的后端往返：
+ * 重连握手只交换版本号与变化的字段，丢消息后按 base 重发，
+ * 并统计一小时的流量（对照后端每 30 秒 QUERY_STATUS 轮询全量状态）与重连同步耗时
+ */
+
+static const uint32_t TICK_MS = 50;
+static const uint8_t FIELDS = (uint8_t)ShadowField::COUNT;
+
+// ==================== 后端 ====================
+
+/**
+ * 后端：字段值按 JSON 文本保存（字符串带引号）
+ */
+struct Backend {
+    std::string desired[FIELDS];
+    uint32_t desiredField[FIELDS] = {};       // 各期望字段最后修改时的期望版本
+    uint32_t d = 0;
+    std::string reported[FIELDS];
+    uint32_t r = 0;
+    uint32_t deviceD = 0;                    // 设备确认已应用的期望版本
+    uint32_t resends = 0;
+    uint32_t dropNextUplink = 0;             // 丢弃接下来的若干条上行消息
+    size_t bytesUp = 0;
+    size_t bytesDown = 0;
+
+    void send(const std::string& payload) {
+        bytesDown += payload.size();
+        PubSubClient::instance->inbox.push_back({MQTT_TOPIC_SHADOW_DESIRED, payload});
+    }
+
+    std::string fieldsSince(uint32_t since) const {
+        std::string set;
+        for (uint8_t i = 0; i < FIELDS; i++) {
+            if (desiredField[i] > since) {
+                set += std::string(set.empty() ? "" : ",") + "\"" +
+                       DeviceShadow::fieldName((ShadowField)i) + "\":" + desired[i];
+            }
+        }
+        return set;
+    }
+
+    /**
+     * 后端修改期望字段并推送增量
+     */
+    void setDesired(ShadowField field, const std::string& value, bool online) {
+        d++;
+        desired[(uint8_t)field] = value;
+        desiredField[(uint8_t)field] = d;
+        if (online) {
+            send("{\"d\":" + std::to_string(d) + ",\"base\":" + std::to_string(d - 1) +
+                 ",\"set\":{" + fieldsSince(d - 1) + "}}");
+        }
+    }
+
+    void receive(const std::string& payload) {
+        bytesUp += payload.size();
+        if (dropNextUplink > 0) {
+            dropNextUplink--;
+            return;
+        }
+        JsonToken tokens[32];
+        uint16_t count = 0;
+        TEST_ASSERT_EQUAL((int)JsonError::NONE,
+                          (int)jsonTokenize(payload.data(), payload.size(), tokens, 32, count));
+        const char* json = payload.data();
+        int32_t deviceDesired = 0, deviceReported = 0, base = 0;
+        TEST_ASSERT_TRUE(jsonToInt(json, tokens[jsonFind(json, tokens, 0, "d")], deviceDesired));
+        TEST_ASSERT_TRUE(jsonToInt(json, tokens[jsonFind(json, tokens, 0, "r")], deviceReported));
+        deviceD = (uint32_t)deviceDesired;
+        int16_t baseToken = jsonFind(json, tokens, 0, "base");
+
+        if (baseToken < 0) {
+            // 握手：回复设备版本之后的期望字段与后端已有的报告版本
+            std::string reply = "{\"d\":" + std::to_string(d) + ",\"base\":" + std::to_string(deviceD) +
+                                ",\"r\":" + std::to_string(r);
+            std::string set = fieldsSince(deviceD);
+            send(reply + (set.empty() ? "}" : ",\"set\":{" + set + "}}"));
+            return;
+        }
+
+        TEST_ASSERT_TRUE(jsonToInt(json, tokens[baseToken], base));
+        if ((uint32_t)base != r) {
+            // 中间丢了增量：要求从后端已有的版本起重发
+            resends++;
+            send("{\"d\":" + std::to_string(d) + ",\"r\":" + std::to_string(r) + "}");
+            return;
+        }
+        int16_t set = jsonFind(json, tokens, 0, "set");
+        if (set >= 0) {
+            uint16_t k = set + 1;
+            for (uint16_t n = 0; n < tokens[set].size; n++) {
+                const JsonToken& value = tokens[k + 1];
+                for (uint8_t i = 0; i < FIELDS; i++) {
+                    if (jsonEquals(json, tokens[k], DeviceShadow::fieldName((ShadowField)i))) {
+                        bool quoted = value.type == JsonType::STRING;
+                        reported[i] = payload.substr(value.start - quoted, value.length + 2 * quoted);
+                    }
+                }
+                k = value.next;
+            }
+        }
+        r = (uint32_t)deviceReported;
+    }
+};
+
+// ==================== 设备 ====================
+
+struct Rig {
+    WiFiClient client;
+    MQTTManager mqtt;
+    DeviceShadow shadow;
+    Backend backend;
+    ShadowState actual;
+    bool link = true;
+
+    Rig() : mqtt(client) {}
+};
+
+static Rig* rig;
+
+static void onMessage(const char* topic, const uint8_t* payload, unsigned int length) {
+    if (strcmp(topic, MQTT_TOPIC_SHADOW_DESIRED) == 0) {
+        rig->shadow.handleMessage(payload, length);
+    }
+}
+
+// 期望状态直接生效（阈值、模式、表情）
+static void applyDesired(const ShadowState& desired, uint8_t changed) {
+    for (uint8_t i = 0; i < FIELDS; i++) {
+        if (changed & (1u << i)) {
+            rig->actual.value[i] = desired.value[i];
+        }
+    }
+}
+
+static std::string fieldText(ShadowField field, int16_t value) {
+    switch (field) {
+        case ShadowField::EMOTION: return std::string("\"") + remoteEmotionName((EmotionState)value) + "\"";
+        case ShadowField::MODE: return std::string("\"") + remoteModeName((RemoteMode)value) + "\"";
+        default: {
+            char text[JSON_NUMBER_MAX];
+            jsonFormatFixed(value, 1, text);
+            return text;
+        }
+    }
+}
+
+static void setLink(bool up) {
+    rig->link = up;
+    PubSubClient::instance->online = up;
+    if (up) {
+        rig->mqtt.connect();
+    } else {
+        rig->mqtt.disconnect();
+        PubSubClient::instance->inbox.clear();
+    }
+}
+
+/**
+ * 主循环的一拍：收消息、比较状态、发布，后端处理上行消息
+ */
+static void step() {
+    hostAdvanceMillis(TICK_MS);
+    rig->mqtt.update();
+    rig->shadow.update(rig->actual, rig->mqtt.isConnectedToMQTT(), millis());
+    rig->shadow.publish(rig->mqtt, millis());
+
+    std::vector<PubSubClient::Message>& sent = PubSubClient::instance->sent;
+    std::vector<PubSubClient::Message> batch;
+    batch.swap(sent);
+    for (const PubSubClient::Message& m : batch) {
+        if (m.topic == MQTT_TOPIC_SHADOW_REPORTED) {
+            rig->backend.receive(m.payload);
+        }
+    }
+}
+
+static void run(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += TICK_MS) {
+        step();
+    }
+}
+
+/**
+ * 两边一致：后端的报告值等于设备实际状态，设备已应用后端的全部期望字段
+ */
+static bool consistent() {
+    const Backend& b = rig->backend;
+    for (uint8_t i = 0; i < FIELDS; i++) {
+        if (b.reported[i] != fieldText((ShadowField)i, rig->actual.value[i])) return false;
+        if (b.desiredField[i] > 0 && b.desired[i] != fieldText((ShadowField)i, rig->shadow.getDesired().value[i])) {
+            return false;
+        }
+    }
+    return b.r == rig->shadow.getReportedVersion() && rig->shadow.getDesiredVersion() == b.d && b.deviceD == b.d;
+}
+
+void setUp() {
+    hostSetMillis(1000);
+    rig = new Rig();
+    rig->actual.set(ShadowField::EMOTION, (int16_t)EmotionState::NORMAL);
+    rig->actual.set(ShadowField::MODE, (int16_t)RemoteMode::AUTO);
+    rig->actual.set(ShadowField::TEMP_HIGH, 300);
+    rig->actual.set(ShadowField::TEMP_LOW, 150);
+    rig->actual.set(ShadowField::HUMID_HIGH, 700);
+    rig->actual.set(ShadowField::HUMID_LOW, 300);
+    rig->mqtt.begin("broker", 1883);
+    rig->mqtt.setMessageHandler(onMessage);
+    rig->shadow.setDesiredHandler(applyDesired);
+    rig->shadow.begin(rig->actual);
+    setLink(true);
+}
+
+void tearDown() {
+    delete rig;
+}
+
+// ==================== 测试 ====================
+
+void test_first_sync_reports_every_field() {
+    run(500);
+    TEST_ASSERT_TRUE(rig->shadow.isSynced());
+    TEST_ASSERT_TRUE(consistent());
+    TEST_ASSERT_EQUAL_STRING("\"normal\"", rig->backend.reported[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("30.0", rig->backend.reported[2].c_str());
+
+    // 稳定后不再发任何消息
+    uint16_t sent = rig->shadow.getStats().messagesSent;
+    run(60000);
+    TEST_ASSERT_EQUAL_UINT16(sent, rig->shadow.getStats().messagesSent);
+}
+
+void test_changes_are_coalesced_into_one_delta() {
+    run(500);
+    size_t before = rig->backend.bytesUp;
+    uint16_t sent = rig->shadow.getStats().messagesSent;
+
+    // 上报间隔内的三次变化合并为一条，只含变化的字段
+    rig->actual.set(ShadowField::EMOTION, (int16_t)EmotionState::HAPPY);
+    step();
+    rig->actual.set(ShadowField::EMOTION, (int16_t)EmotionState::SAD);
+    step();
+    rig->actual.set(ShadowField::TEMP_HIGH, 315);
+    run(SHADOW_REPORT_INTERVAL + 500);
+
+    TEST_ASSERT_TRUE(consistent());
+    TEST_ASSERT_TRUE(rig->shadow.getStats().messagesSent - sent <= 2);
+    TEST_ASSERT_EQUAL_STRING("\"sad\"", rig->backend.reported[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("31.5", rig->backend.reported[2].c_str());
+    TEST_ASSERT_TRUE(rig->backend.bytesUp - before < 100);
+}
+
+void test_desired_delta_is_applied_and_acknowledged() {
+    run(500);
+    rig->backend.setDesired(ShadowField::MODE, "\"quiet\"", true);
+    run(200);
+    TEST_ASSERT_EQUAL((int)RemoteMode::QUIET, rig->actual.get(ShadowField::MODE));
+    run(SHADOW_REPORT_INTERVAL);
+    TEST_ASSERT_TRUE(consistent());
+
+    // 版本空洞：设备重新握手补齐
+    rig->backend.d++;
+    rig->backend.desired[(uint8_t)ShadowField::TEMP_LOW] = "12.5";
+    rig->backend.desiredField[(uint8_t)ShadowField::TEMP_LOW] = rig->backend.d;
+    rig->backend.setDesired(ShadowField::HUMID_HIGH, "80.0", true);
+    run(SHADOW_REPORT_INTERVAL);
+    TEST_ASSERT_EQUAL_INT16(125, rig->actual.get(ShadowField::TEMP_LOW));
+    TEST_ASSERT_EQUAL_INT16(800, rig->actual.get(ShadowField::HUMID_HIGH));
+    TEST_ASSERT_TRUE(consistent());
+
+    // 无效取值整条拒绝
+    uint16_t rejected = rig->shadow.getStats().rejected;
+    rig->backend.setDesired(ShadowField::TEMP_HIGH, "99.0", true);
+    run(200);
+    TEST_ASSERT_EQUAL_UINT16(rejected + 1, rig->shadow.getStats().rejected);
+    TEST_ASSERT_EQUAL_INT16(300, rig->actual.get(ShadowField::TEMP_HIGH));
+}
+
+void test_lost_delta_is_resent_from_base() {
+    run(500);
+    rig->backend.dropNextUplink = 1;
+    rig->actual.set(ShadowField::HUMID_LOW, 250);
+    run(SHADOW_REPORT_INTERVAL + 200);
+    TEST_ASSERT_FALSE(consistent());
+
+    rig->actual.set(ShadowField::EMOTION, (int16_t)EmotionState::ANGRY);
+    run(2 * SHADOW_REPORT_INTERVAL + 200);
+    TEST_ASSERT_EQUAL_UINT32(1, rig->backend.resends);
+    TEST_ASSERT_TRUE(consistent());
+    TEST_ASSERT_EQUAL_STRING("25.0", rig->backend.reported[(uint8_t)ShadowField::HUMID_LOW].c_str());
+}
+
+/**
+ * 重连后握手到两边一致的耗时与流量：断线期间没有变化时只交换版本号
+ */
+void test_reconnect_sync_exchanges_versions_only() {
+    run(500);
+    setLink(false);
+    run(30000);
+    size_t up = rig->backend.bytesUp, down = rig->backend.bytesDown;
+    unsigned long start = millis();
+    setLink(true);
+    while (!(rig->shadow.isSynced() && consistent()) && millis() - start < 10000) {
+        step();
+    }
+    unsigned long quiet = millis() - start;
+    size_t quietBytes = rig->backend.bytesUp - up + rig->backend.bytesDown - down;
+    TEST_ASSERT_TRUE(consistent());
+    TEST_ASSERT_TRUE(quietBytes < 40);
+    TEST_ASSERT_TRUE(quiet <= 3 * TICK_MS);
+
+    // 断线期间两边都有变化：握手后各传变化的字段
+    setLink(false);
+    rig->actual.set(ShadowField::EMOTION, (int16_t)EmotionState::SLEEPY);
+    rig->backend.setDesired(ShadowField::MODE, "\"monitor\"", false);
+    run(30000);
+    up = rig->backend.bytesUp;
+    down = rig->backend.bytesDown;
+    start = millis();
+    setLink(true);
+    while (!(rig->shadow.isSynced() && consistent()) && millis() - start < 10000) {
+        step();
+    }
+    unsigned long changed = millis() - start;
+    size_t changedBytes = rig->backend.bytesUp - up + rig->backend.bytesDown - down;
+    TEST_ASSERT_TRUE(consistent());
+    TEST_ASSERT_EQUAL((int)RemoteMode::MONITOR, rig->actual.get(ShadowField::MODE));
+    TEST_ASSERT_TRUE(changed <= SHADOW_REPORT_INTERVAL);
+
+    char line[128];
+    snprintf(line, sizeof(line), "reconnect sync: unchanged %lu ms / %lu bytes, changed %lu ms / %lu bytes",
+             quiet, (unsigned long)quietBytes, changed, (unsigned long)changedBytes);
+    TEST_MESSAGE(line);
+}
+
+/**
+ * 一小时：表情每几分钟变化、后端每 15 分钟改一次模式、每 20 分钟断线 30 秒
+ * 对照：后端每 30 秒发一条 QUERY_STATUS，设备回复全量状态
+ */
+void test_bytes_per_hour() {
+    const uint32_t HOUR = 3600000;
+    static const EmotionState MOODS[] = {EmotionState::HAPPY, EmotionState::NORMAL, EmotionState::SLEEPY,
+                                         EmotionState::SURPRISED};
+    static const char* const MODES[] = {"\"monitor\"", "\"auto\"", "\"weather\"", "\"quiet\""};
+    uint32_t seed = 3;
+    uint32_t reconnects = 0;
+    unsigned long worstSync = 0;
+    unsigned long start = millis();
+    unsigned long linkDown = 0, linkUp = 0;
+
+    for (uint32_t t = 0; t < HOUR; t += TICK_MS) {
+        seed = seed * 1664525UL + 1013904223UL;
+        if ((seed >> 8) % 3600 == 0) {          // 平均每 3 分钟一次
+            rig->actual.set(ShadowField::EMOTION, (int16_t)MOODS[(seed >> 20) % 4]);
+        }
+        if (t % 900000 == 450000) {
+            rig->backend.setDesired(ShadowField::MODE, MODES[(t / 900000) % 4], rig->link);
+        }
+        if (t % 1200000 == 600000) {
+            setLink(false);
+            linkDown = millis();
+        }
+        if (!rig->link && millis() - linkDown >= 30000) {
+            setLink(true);
+            linkUp = millis();
+            reconnects++;
+        }
+        step();
+        if (linkUp && rig->shadow.isSynced() && consistent()) {
+            worstSync = std::max(worstSync, millis() - linkUp);
+            linkUp = 0;
+        }
+    }
+    run(SHADOW_REPORT_INTERVAL);
+    TEST_ASSERT_TRUE(consistent());
+    TEST_ASSERT_EQUAL_UINT32(3, reconnects);
+    TEST_ASSERT_EQUAL_UINT32(HOUR + SHADOW_REPORT_INTERVAL, millis() - start);
+
+    const ShadowStats& s = rig->shadow.getStats();
+    TEST_ASSERT_EQUAL_UINT32(rig->backend.bytesUp, s.bytesSent);
+    TEST_ASSERT_EQUAL_UINT32(rig->backend.bytesDown, s.bytesReceived);
+    size_t shadowBytes = s.bytesSent + s.bytesReceived;
+
+    RemoteStatus status = {"happy", 23.5f, 55.0f, "Sunny", 123456789u, 42};
+    PrintCounter counter;
+    size_t reply = RemoteControlModule::writeStatusJSON(counter, status);
+    size_t query = strlen("{\"cmd\":\"status\"}");
+    size_t pollBytes = (HOUR / 30000) * (query + reply);
+    TEST_ASSERT_TRUE(shadowBytes * 5 < pollBytes);
+
+    char line[160];
+    snprintf(line, sizeof(line),
+             "shadow: %lu B/h (%u up, %u down msgs, %u syncs, worst sync %lu ms); polling every 30 s: %lu B/h",
+             (unsigned long)shadowBytes, s.messagesSent, s.messagesReceived, s.syncs, worstSync,
+             (unsigned long)pollBytes);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_sync_reports_every_field);
+    RUN_TEST(test_changes_are_coalesced_into_one_delta);
+    RUN_TEST(test_desired_delta_is_applied_and_acknowledged);
+    RUN_TEST(test_lost_delta_is_resent_from_base);
+    RUN_TEST(test_reconnect_sync_exchanges_versions_only);
+    RUN_TEST(test_bytes_per_hour);
+    return UNITY_END();
+}
@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <Host_Alloc_Counter.h>
+#include <chrono>
+#include "Feedback_Phrases.h"
+#include "Multimodal_Feedback.h"
+#include "Weather_Display.h"
+
+/**
+ * 反馈短语：温度档位与湿度附加、天气建议的优先级、拼接截断，
+ * 以及整个选词与拼接过程不分配堆内存
+ */
+
+void setUp() {}
+void tearDown() {}
+
+static const char* thermalText(float temp, float humidity) {
+    static char buffer[PHRASE_BUFFER_SIZE];
+    composePhrases(thermalPhrases(temp, humidity), buffer, sizeof(buffer));
+    return buffer;
+}
+
+// ==================== 选词 ====================
+
+void test_thermal_levels_follow_thresholds() {
+    TEST_ASSERT_EQUAL((int)ThermalLevel::HOT, (int)thermalLevel(32.5f));
+    TEST_ASSERT_EQUAL((int)ThermalLevel::WARM, (int)thermalLevel(32.0f));
+    TEST_ASSERT_EQUAL((int)ThermalLevel::WARM, (int)thermalLevel(28.5f));
+    TEST_ASSERT_EQUAL((int)ThermalLevel::COMFORTABLE, (int)thermalLevel(28.0f));
+    TEST_ASSERT_EQUAL((int)ThermalLevel::COMFORTABLE, (int)thermalLevel(15.0f));
+    TEST_ASSERT_EQUAL((int)ThermalLevel::CHILLY, (int)thermalLevel(14.5f));
+    TEST_ASSERT_EQUAL((int)ThermalLevel::CHILLY, (int)thermalLevel(10.0f));
+    TEST_ASSERT_EQUAL((int)ThermalLevel::COLD, (int)thermalLevel(9.5f));
+}
+
+void test_thermal_phrases_add_humidity_remark() {
+    TEST_ASSERT_EQUAL_STRING("Temperature is perfect", thermalText(22, 50));
+    TEST_ASSERT_EQUAL_STRING("Too hot! Stay cool! Humidity is high", thermalText(35, 80));
+    TEST_ASSERT_EQUAL_STRING("So cold! Keep warm! Air is dry", thermalText(5, 20));
+    TEST_ASSERT_EQUAL_STRING("It's chilly outside", thermalText(12, 70));
+
+    PhraseList list = thermalPhrases(30, 30);
+    TEST_ASSERT_EQUAL(1, list.count);
+    TEST_ASSERT_EQUAL((int)Phrase::FEELING_WARM, (int)list.items[0]);
+}
+
+void test_weather_advice_prefers_extremes() {
+    TEST_ASSERT_EQUAL((int)Phrase::ADVICE_HOT, (int)weatherAdvicePhrase(WeatherType::RAINY, 31, 90));
+    TEST_ASSERT_EQUAL((int)Phrase::ADVICE_COLD, (int)weatherAdvicePhrase(WeatherType::SNOWY, 5, 90));
+    TEST_ASSERT_EQUAL((int)Phrase::ADVICE_HUMID, (int)weatherAdvicePhrase(WeatherType::SUNNY, 20, 75));
+    TEST_ASSERT_EQUAL((int)Phrase::ADVICE_RAINY, (int)weatherAdvicePhrase(WeatherType::RAINY, 20, 50));
+    TEST_ASSERT_EQUAL((int)Phrase::ADVICE_WINDY, (int)weatherAdvicePhrase(WeatherType::WINDY, 20, 50));
+    TEST_ASSERT_EQUAL((int)Phrase::ADVICE_COMFORTABLE, (int)weatherAdvicePhrase(WeatherType::UNKNOWN, 20, 50));
+    TEST_ASSERT_EQUAL((int)Phrase::ADVICE_COMFORTABLE, (int)weatherAdvicePhrase((WeatherType)200, 20, 50));
+
+    WeatherDisplay weather;
+    TEST_ASSERT_EQUAL_STRING("Storm! Stay indoors", weather.generateWeatherAdvice(WeatherType::STORMY, 20, 50));
+}
+
+// ==================== 拼接 ====================
+
+void test_every_phrase_fits_table_and_buffer() {
+    size_t longest = 0;
+    for (uint8_t i = 0; i < (uint8_t)Phrase::COUNT; i++) {
+        size_t length = strlen(phraseText((Phrase)i));
+        TEST_ASSERT_TRUE(length > 0);
+        TEST_ASSERT_TRUE(length < PHRASE_MAX_LEN);
+        if (length > longest) longest = length;
+    }
+    TEST_ASSERT_TRUE(PHRASE_LIST_MAX * (longest + 1) <= PHRASE_BUFFER_SIZE);
+    TEST_ASSERT_EQUAL_STRING("", phraseText(Phrase::COUNT));
+}
+
+void test_compose_truncates_and_terminates() {
+    PhraseList list = {{Phrase::TOO_HOT, Phrase::HUMIDITY_HIGH}, 2};
+    char buffer[PHRASE_BUFFER_SIZE];
+
+    // 恰好放下第一条：不留尾随空格
+    size_t first = strlen(phraseText(Phrase::TOO_HOT));
+    memset(buffer, 'x', sizeof(buffer));
+    TEST_ASSERT_EQUAL_size_t(first, composePhrases(list, buffer, first + 2));
+    TEST_ASSERT_EQUAL_STRING("Too hot! Stay cool!", buffer);
+
+    memset(buffer, 'x', sizeof(buffer));
+    TEST_ASSERT_EQUAL_size_t(5, composePhrases(list, buffer, 6));
+    TEST_ASSERT_EQUAL_STRING("Too h", buffer);
+
+    memset(buffer, 'x', sizeof(buffer));
+    TEST_ASSERT_EQUAL_size_t(0, composePhrases(list, buffer, 1));
+    TEST_ASSERT_EQUAL('\0', buffer[0]);
+
+    TEST_ASSERT_EQUAL_size_t(0, composePhrases(list, buffer, 0));
+    TEST_ASSERT_EQUAL_size_t(0, composePhrases(list, nullptr, 10));
+
+    // 条数超出上限时只取前 PHRASE_LIST_MAX 条
+    list.count = 200;
+    composePhrases(list, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING("Too hot! Stay cool! Humidity is high", buffer);
+}
+
+// ==================== 开销 ====================
+
+void test_generation_is_allocation_free() {
+    MultimodalFeedbackSystem feedback;
+    WeatherDisplay weather;
+    char buffer[PHRASE_BUFFER_SIZE];
+    size_t total = 0;
+    uint32_t calls = 0;
+
+    // 计数器确实接管了 operator new
+    size_t before = g_hostAllocations;
+    delete new int(0);
+    TEST_ASSERT_EQUAL_size_t(before + 1, g_hostAllocations);
+
+    using Clock = std::chrono::steady_clock;
+    before = g_hostAllocations;
+    Clock::time_point t0 = Clock::now();
+    for (int t = -100; t <= 450; t++) {
+        for (int h = 0; h <= 100; h += 5) {
+            float temp = t / 10.0f, humidity = (float)h;
+            total += feedback.generateThermalFeedback(temp, humidity, buffer, sizeof(buffer));
+            for (uint8_t w = 0; w < WEATHER_TYPE_COUNT; w++) {
+                total += strlen(weather.generateWeatherAdvice((WeatherType)w, temp, humidity));
+            }
+            calls++;
+        }
+    }
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+
+    TEST_ASSERT_EQUAL_size_t(0, g_hostAllocations - before);
+    TEST_ASSERT_TRUE(total > 0);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%lu thermal + %lu advice calls, %.0f ns per thermal phrase",
+             (unsigned long)calls, (unsigned long)calls * WEATHER_TYPE_COUNT, ns / calls);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_thermal_levels_follow_thresholds);
+    RUN_TEST(test_thermal_phrases_add_humidity_remark);
+    RUN_TEST(test_weather_advice_prefers_extremes);
+    RUN_TEST(test_every_phrase_fits_table_and_buffer);
+    RUN_TEST(test_compose_truncates_and_terminates);
+    RUN_TEST(test_generation_is_allocation_free);
+    return UNITY_END();
+}
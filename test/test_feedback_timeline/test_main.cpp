@@ -0,0 +1,211 @@
+#include <unity.h>
+#include <chrono>
+#include "Multimodal_Feedback.h"
+#include "ASRPRO_Module.h"
+#include "Choreography.h"
+#include "Choreography_Builtin.h"
+
+/**
+ * 反馈时间线：各轨道按步长到点执行、提前预装、舵机被占用时只静音运动轨道，
+ * 以及与同一段舞蹈的字节码版本比较 update() 开销
+ */
+
+static const uint32_t TICK_MS = 1000 / SERVO_UPDATE_RATE_HZ;
+
+struct Rig {
+    OLEDDisplay display;
+    ServoController servo;
+    MotionArbiter motion;
+    ASRPROModule asr;
+    MultimodalFeedbackSystem feedback;
+    ChoreographyPlayer player;
+
+    void begin() {
+        display.begin();
+        servo.begin();
+        motion.begin(&servo);
+        asr.begin();
+        feedback.begin(&display, &motion, &asr);
+        player.begin(&display, &motion, &asr);
+        UART_ASRPRO.tx.clear();
+    }
+
+    // 按舵机节拍推进主循环
+    void run(uint32_t ms) {
+        for (uint32_t t = 0; t < ms; t += TICK_MS) {
+            servo.tick();
+            hostAdvanceMillis(TICK_MS);
+            feedback.update();
+            player.update();
+            motion.update();
+            servo.update();
+            asr.update();
+        }
+    }
+};
+
+static Rig* rig;
+
+void setUp() {
+    rig = new Rig();
+    rig->begin();
+}
+
+void tearDown() {
+    delete rig;
+}
+
+// 序列起点：舵机唤醒保持与输出延迟之后
+static unsigned long sequenceOrigin() {
+    return millis() + rig->motion.wakeDelay() + SERVO_OUTPUT_LATENCY_MS;
+}
+
+void test_emotion_changes_on_step_boundary() {
+    // CONFUSED：SURPRISED 400ms、SURPRISED 400ms、NORMAL 300ms
+    unsigned long origin = sequenceOrigin();
+    rig->feedback.executeFeedbackScenario(FeedbackScenario::CONFUSED);
+
+    unsigned long surprisedAt = 0, normalAt = 0;
+    while (!rig->feedback.isSequenceComplete() && millis() < origin + 5000) {
+        rig->run(TICK_MS);
+        EmotionState e = rig->display.getEmotion();
+        if (!surprisedAt && e == EmotionState::SURPRISED) surprisedAt = millis();
+        if (!normalAt && surprisedAt && e == EmotionState::NORMAL) normalAt = millis();
+    }
+    TEST_ASSERT_TRUE(rig->feedback.isSequenceComplete());
+    TEST_ASSERT_UINT32_WITHIN(TICK_MS, origin, surprisedAt);
+    TEST_ASSERT_UINT32_WITHIN(TICK_MS, origin + 800, normalAt);
+
+    const FeedbackTimingStats& stats = rig->feedback.getTimingStats();
+    TEST_ASSERT_EQUAL_UINT32(4 * 3, stats.events);      // 四个轨道各三步
+    TEST_ASSERT_TRUE(stats.maxLateness <= TICK_MS);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.lateArms);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.rejectedSegments);
+}
+
+void test_servo_segments_are_armed_ahead_and_chain() {
+    // DANCE：先向左摇，再向右摇；目标按步长截短，两段首尾相接
+    unsigned long origin = sequenceOrigin();
+    rig->feedback.executeFeedbackScenario(FeedbackScenario::DANCE, FeedbackAction::MOTION_ONLY);
+    TEST_ASSERT_TRUE(rig->servo.isPerforming());        // 第 0 步在调用中立即装入
+
+    // 轨迹比可见输出早 SERVO_OUTPUT_LATENCY_MS
+    unsigned long shift = origin - SERVO_OUTPUT_LATENCY_MS;
+    unsigned long movedAt = 0;
+    uint16_t endOfLeft = 0;
+    while (millis() < shift + 600) {
+        rig->run(TICK_MS);
+        uint16_t head = rig->servo.getHeadPosition();
+        if (!movedAt && head != 90) movedAt = millis();
+        if (millis() == shift + 300) endOfLeft = head;
+    }
+    // 唤醒保持期间不动；最小加加速度曲线起步很缓，几拍之后才超过 0.5 度
+    TEST_ASSERT_TRUE(movedAt > shift && movedAt <= shift + 8 * TICK_MS);
+    TEST_ASSERT_TRUE(endOfLeft < 80);
+    TEST_ASSERT_TRUE(rig->servo.getHeadPosition() > endOfLeft + 10);
+    TEST_ASSERT_EQUAL_UINT32(0, rig->feedback.getTimingStats().lateArms);
+
+    rig->run(2000);
+    TEST_ASSERT_TRUE(rig->feedback.isSequenceComplete());
+    TEST_ASSERT_FALSE(rig->servo.isPerforming());
+}
+
+void test_voice_is_queued_on_time() {
+    unsigned long origin = sequenceOrigin();
+    rig->feedback.executeFeedbackScenario(FeedbackScenario::HOT);
+    // 唤醒与输出延迟期间还未播报
+    while (millis() + TICK_MS < origin) {
+        rig->run(TICK_MS);
+        TEST_ASSERT_TRUE(UART_ASRPRO.tx.empty());
+    }
+    rig->run(2 * TICK_MS);
+    TEST_ASSERT_EQUAL_STRING("Too hot!\n", UART_ASRPRO.tx.c_str());
+}
+
+void test_busy_servo_mutes_only_motion_tracks() {
+    TEST_ASSERT_TRUE(rig->motion.submit(ServoAction::NOD_DOWN, MotionSource::VOICE));
+    rig->feedback.executeFeedbackScenario(FeedbackScenario::ALERT);
+    rig->run(3000);
+
+    const FeedbackTimingStats& stats = rig->feedback.getTimingStats();
+    TEST_ASSERT_TRUE(rig->feedback.isSequenceComplete());
+    TEST_ASSERT_EQUAL_UINT32(2, stats.rejectedSegments);   // 两轴第 0 步被拒绝后静音
+    TEST_ASSERT_EQUAL((int)EmotionState::ANGRY, (int)rig->display.getEmotion());
+}
+
+void test_visual_only_leaves_servo_idle() {
+    rig->feedback.executeFeedbackScenario(FeedbackScenario::CELEBRATE, FeedbackAction::VISUAL_ONLY);
+    TEST_ASSERT_FALSE(rig->servo.isPerforming());
+    // 没有舵机轨道时不加唤醒延迟，第 0 步表情立即显示
+    TEST_ASSERT_EQUAL((int)EmotionState::HAPPY, (int)rig->display.getEmotion());
+    rig->run(1200);
+    TEST_ASSERT_TRUE(rig->feedback.isSequenceComplete());
+    TEST_ASSERT_TRUE(UART_ASRPRO.tx.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, rig->motion.getStats().started);
+}
+
+/**
+ * 同一段舞蹈分别用原生 FeedbackMotion 序列与字节码播放，比较每次 update() 的实际耗时
+ * （主机上 millis()/micros() 由测试推进，另用墙钟计时）
+ */
+void test_update_cost_native_vs_bytecode() {
+    using Clock = std::chrono::steady_clock;
+    Clock::duration nativeTime{}, scriptTime{};
+    uint32_t nativeUpdates = 0, scriptUpdates = 0;
+
+    unsigned long start = millis();
+    rig->feedback.executeFeedbackScenario(FeedbackScenario::DANCE);
+    while (!rig->feedback.isSequenceComplete() || !rig->motion.isIdle()) {
+        rig->servo.tick();
+        hostAdvanceMillis(TICK_MS);
+        Clock::time_point t0 = Clock::now();
+        rig->feedback.update();
+        nativeTime += Clock::now() - t0;
+        nativeUpdates++;
+        rig->motion.update();
+        rig->servo.update();
+        rig->asr.update();
+    }
+    unsigned long nativeDuration = millis() - start;
+
+    start = millis();
+    TEST_ASSERT_EQUAL((int)ChoreoVerifyError::NONE, (int)rig->player.play(CHOREO_DANCE, sizeof(CHOREO_DANCE)));
+    while (rig->player.isPlaying() || !rig->motion.isIdle()) {
+        rig->servo.tick();
+        hostAdvanceMillis(TICK_MS);
+        Clock::time_point t0 = Clock::now();
+        rig->player.update();
+        scriptTime += Clock::now() - t0;
+        scriptUpdates++;
+        rig->motion.update();
+        rig->servo.update();
+        rig->asr.update();
+    }
+    unsigned long scriptDuration = millis() - start;
+
+    // 两种形式的时间线一致
+    TEST_ASSERT_UINT32_WITHIN(2 * TICK_MS, nativeDuration, scriptDuration);
+    TEST_ASSERT_EQUAL_UINT32(0, rig->player.getStats().lateArms);
+    TEST_ASSERT_TRUE(sizeof(CHOREO_DANCE) < sizeof(DANCE_MOTIONS));
+
+    auto ns = [](Clock::duration d, uint32_t n) {
+        return (unsigned long)(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / (n ? n : 1));
+    };
+    char line[160];
+    snprintf(line, sizeof(line), "native: %lu updates, avg %lu ns, %u bytes; bytecode: %lu updates, avg %lu ns, %u bytes, %lu ops",
+             (unsigned long)nativeUpdates, ns(nativeTime, nativeUpdates), (unsigned)sizeof(DANCE_MOTIONS),
+             (unsigned long)scriptUpdates, ns(scriptTime, scriptUpdates), (unsigned)sizeof(CHOREO_DANCE),
+             (unsigned long)rig->player.getStats().ops);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_emotion_changes_on_step_boundary);
+    RUN_TEST(test_servo_segments_are_armed_ahead_and_chain);
+    RUN_TEST(test_voice_is_queued_on_time);
+    RUN_TEST(test_busy_servo_mutes_only_motion_tracks);
+    RUN_TEST(test_visual_only_leaves_servo_idle);
+    RUN_TEST(test_update_cost_native_vs_bytecode);
+    return UNITY_END();
+}
@@ -0,0 +1,360 @@
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "Json_Tokenizer.h"
+#include "Remote_Control.h"
+
+/**
+ * 就地 JSON 分词器与远程指令解析：词元结构、错误分类、名称的完美哈希查找，
+ * 随机变异负载的模糊测试（负载放在保护页之前，越界读立即崩溃），以及每秒可解析的报文数
+ */
+
+static const uint16_t TOKENS = 64;
+
+void setUp() {}
+void tearDown() {}
+
+/**
+ * 负载紧贴在一个不可访问页之前：分词器读过 length 就会触发 SIGSEGV
+ */
+struct GuardedBuffer {
+    uint8_t* base;
+    size_t page;
+
+    GuardedBuffer() : page((size_t)sysconf(_SC_PAGESIZE)) {
+        base = (uint8_t*)mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        mprotect(base + page, page, PROT_NONE);
+    }
+
+    ~GuardedBuffer() {
+        munmap(base, 2 * page);
+    }
+
+    const char* place(const void* data, size_t length) {
+        uint8_t* p = base + page - length;
+        memcpy(p, data, length);
+        return (const char*)p;
+    }
+};
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+    rngState = rngState * 1664525UL + 1013904223UL;
+    return rngState >> 8;
+}
+
+static JsonError tokenize(const std::string& text, JsonToken* tokens, uint16_t& count,
+                          uint16_t capacity = TOKENS) {
+    return jsonTokenize(text.data(), text.size(), tokens, capacity, count);
+}
+
+/**
+ * 成功分词后的结构不变量：词元在负载之内，next 单调且不越界，子树大小与 size 一致
+ */
+static void checkTokens(const char* json, size_t length, const JsonToken* tokens, uint16_t count) {
+    TEST_ASSERT_TRUE(count > 0);
+    TEST_ASSERT_EQUAL_UINT16(count, tokens[0].next);
+    for (uint16_t i = 0; i < count; i++) {
+        const JsonToken& t = tokens[i];
+        TEST_ASSERT_TRUE((size_t)t.start + t.length <= length);
+        TEST_ASSERT_TRUE(t.next > i && t.next <= count);
+        if (t.type == JsonType::STRING) {
+            TEST_ASSERT_TRUE(t.start > 0);
+            TEST_ASSERT_EQUAL('"', json[t.start - 1]);
+            TEST_ASSERT_EQUAL('"', json[t.start + t.length]);
+        }
+        if (t.type == JsonType::OBJECT || t.type == JsonType::ARRAY) {
+            uint16_t children = 0;
+            for (uint16_t c = i + 1; c < t.next; c = tokens[c].next) {
+                if (t.type == JsonType::OBJECT && children % 2 == 0) {
+                    TEST_ASSERT_EQUAL((int)JsonType::STRING, (int)tokens[c].type);
+                }
+                children++;
+            }
+            TEST_ASSERT_EQUAL_UINT16(t.type == JsonType::OBJECT ? 2 * t.size : t.size, children);
+        }
+    }
+}
+
+// ==================== 分词 ====================
+
+void test_tokens_describe_nested_document() {
+    std::string text = " {\"a\": [1, {\"b\": null}, \"x\\\"y\"], \"c\": -2.5e3, \"d\": {}} ";
+    JsonToken tokens[TOKENS];
+    uint16_t count = 0;
+    TEST_ASSERT_EQUAL((int)JsonError::NONE, (int)tokenize(text, tokens, count));
+    checkTokens(text.data(), text.size(), tokens, count);
+    TEST_ASSERT_EQUAL_UINT16(12, count);
+
+    TEST_ASSERT_EQUAL((int)JsonType::OBJECT, (int)tokens[0].type);
+    TEST_ASSERT_EQUAL_UINT16(3, tokens[0].size);
+
+    int16_t a = jsonFind(text.data(), tokens, 0, "a");
+    TEST_ASSERT_EQUAL_INT16(2, a);
+    TEST_ASSERT_EQUAL((int)JsonType::ARRAY, (int)tokens[a].type);
+    TEST_ASSERT_EQUAL_UINT16(3, tokens[a].size);
+    TEST_ASSERT_EQUAL_UINT16(8, tokens[a].next);            // 跳过整个数组
+    TEST_ASSERT_TRUE(jsonEquals(text.data(), tokens[7], "x\\\"y"));   // 转义不解码
+
+    int16_t c = jsonFind(text.data(), tokens, 0, "c");
+    int32_t value = 0;
+    TEST_ASSERT_FALSE(jsonToInt(text.data(), tokens[c], value));
+    TEST_ASSERT_FALSE(jsonToFixed(text.data(), tokens[c], 1, value));   // 带指数
+
+    int16_t d = jsonFind(text.data(), tokens, 0, "d");
+    TEST_ASSERT_EQUAL((int)JsonType::OBJECT, (int)tokens[d].type);
+    TEST_ASSERT_EQUAL_UINT16(0, tokens[d].size);
+    TEST_ASSERT_EQUAL_INT16(-1, jsonFind(text.data(), tokens, 0, "b"));   // 只查本层
+    TEST_ASSERT_EQUAL_INT16(-1, jsonFind(text.data(), tokens, 0, "A"));
+}
+
+void test_number_conversion() {
+    const char* cases[] = {"0", "-17", "2147483647", "-2147483648", "2147483648", "1.5", "abc", "12.345", "-0.05"};
+    std::string text = "[";
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        text += (i ? "," : "");
+        text += cases[i][0] == 'a' ? std::string("\"abc\"") : std::string(cases[i]);
+    }
+    text += "]";
+    JsonToken tokens[TOKENS];
+    uint16_t count = 0;
+    TEST_ASSERT_EQUAL((int)JsonError::NONE, (int)tokenize(text, tokens, count));
+
+    int32_t v = 0;
+    TEST_ASSERT_TRUE(jsonToInt(text.data(), tokens[1], v));  TEST_ASSERT_EQUAL_INT32(0, v);
+    TEST_ASSERT_TRUE(jsonToInt(text.data(), tokens[2], v));  TEST_ASSERT_EQUAL_INT32(-17, v);
+    TEST_ASSERT_TRUE(jsonToInt(text.data(), tokens[3], v));  TEST_ASSERT_EQUAL_INT32(2147483647, v);
+    TEST_ASSERT_TRUE(jsonToInt(text.data(), tokens[4], v));  TEST_ASSERT_EQUAL_INT32(INT32_MIN, v);
+    TEST_ASSERT_FALSE(jsonToInt(text.data(), tokens[5], v));
+    TEST_ASSERT_FALSE(jsonToInt(text.data(), tokens[6], v));
+    TEST_ASSERT_FALSE(jsonToInt(text.data(), tokens[7], v));
+
+    TEST_ASSERT_TRUE(jsonToFixed(text.data(), tokens[6], 1, v));  TEST_ASSERT_EQUAL_INT32(15, v);
+    TEST_ASSERT_TRUE(jsonToFixed(text.data(), tokens[8], 2, v));  TEST_ASSERT_EQUAL_INT32(1235, v);
+    TEST_ASSERT_TRUE(jsonToFixed(text.data(), tokens[9], 1, v));  TEST_ASSERT_EQUAL_INT32(-1, v);
+}
+
+void test_errors_are_classified() {
+    JsonToken tokens[TOKENS];
+    uint16_t count = 0;
+
+    TEST_ASSERT_EQUAL((int)JsonError::INVALID, (int)tokenize("{\"a\" 1}", tokens, count));
+    TEST_ASSERT_EQUAL((int)JsonError::INVALID, (int)tokenize("[1,]", tokens, count));
+    TEST_ASSERT_EQUAL((int)JsonError::INVALID, (int)tokenize("{1:2}", tokens, count));
+    TEST_ASSERT_EQUAL((int)JsonError::INVALID, (int)tokenize("[1] 2", tokens, count));
+    TEST_ASSERT_EQUAL((int)JsonError::INVALID, (int)tokenize("]", tokens, count));
+
+    // 合法文档的每个真前缀都不能被当作完整文档
+    std::string doc = "{\"id\":\"r1\",\"cmds\":[{\"cmd\":\"servo\",\"angle\":45}]}";
+    for (size_t n = 0; n < doc.size(); n++) {
+        JsonError e = tokenize(doc.substr(0, n), tokens, count);
+        TEST_ASSERT_TRUE(e == JsonError::PARTIAL || e == JsonError::INVALID);
+    }
+    TEST_ASSERT_EQUAL((int)JsonError::PARTIAL, (int)tokenize("{\"a\":\"bc", tokens, count));
+
+    std::string deep(JSON_MAX_DEPTH, '[');
+    deep += std::string(JSON_MAX_DEPTH, ']');
+    TEST_ASSERT_EQUAL((int)JsonError::NONE, (int)tokenize(deep, tokens, count));
+    deep = "[" + deep + "]";
+    TEST_ASSERT_EQUAL((int)JsonError::TOO_DEEP, (int)tokenize(deep, tokens, count));
+
+    TEST_ASSERT_EQUAL((int)JsonError::NO_MEMORY, (int)tokenize("[1,2,3]", tokens, count, 3));
+    TEST_ASSERT_EQUAL((int)JsonError::NONE, (int)tokenize("[1,2,3]", tokens, count, 4));
+}
+
+// ==================== 名称查找 ====================
+
+void test_names_resolve_by_perfect_hash() {
+    static const char* const EMOTIONS[] = {"happy", "sad", "angry", "sleepy", "surprised",
+                                           "normal", "hot", "cold", "humid"};
+    for (const char* name : EMOTIONS) {
+        EmotionState e;
+        TEST_ASSERT_TRUE(remoteEmotionFromName(name, strlen(name), e));
+        TEST_ASSERT_EQUAL_STRING(name, remoteEmotionName(e));
+
+        // 不区分大小写；前缀或多一个字符都不匹配
+        std::string upper(name);
+        for (char& ch : upper) ch = (char)toupper(ch);
+        EmotionState u;
+        TEST_ASSERT_TRUE(remoteEmotionFromName(upper.data(), upper.size(), u));
+        TEST_ASSERT_EQUAL((int)e, (int)u);
+        TEST_ASSERT_FALSE(remoteEmotionFromName(name, strlen(name) - 1, u));
+        std::string longer = std::string(name) + "s";
+        TEST_ASSERT_FALSE(remoteEmotionFromName(longer.data(), longer.size(), u));
+    }
+
+    static const char* const MODES[] = {"auto", "monitor", "weather", "quiet"};
+    for (const char* name : MODES) {
+        RemoteMode m;
+        TEST_ASSERT_TRUE(remoteModeFromName(name, strlen(name), m));
+        TEST_ASSERT_EQUAL_STRING(name, remoteModeName(m));
+    }
+
+    RemoteMode m;
+    EmotionState e;
+    TEST_ASSERT_FALSE(remoteModeFromName("", 0, m));
+    TEST_ASSERT_FALSE(remoteModeFromName("happy", 5, m));
+    TEST_ASSERT_FALSE(remoteEmotionFromName("auto", 4, e));
+    TEST_ASSERT_FALSE(remoteEmotionFromName("hap\0y", 5, e));
+}
+
+// ==================== 模糊测试 ====================
+
+static const char* const SEEDS[] = {
+    "{\"cmd\":\"emotion\",\"emotion\":\"happy\"}",
+    "{\"cmd\":\"servo\",\"action\":\"nod_up\",\"angle\":120}",
+    "{\"id\":\"r42\",\"cmds\":[{\"cmd\":\"mode\",\"mode\":\"quiet\"},{\"cmd\":\"status\"}]}",
+    "{\"id\":7,\"cmds\":[{\"cmd\":\"calibrate\"},{\"cmd\":\"servo\",\"action\":\"reset\"}]}",
+    "[true, false, null, -1.25e-2, \"\\u00e9\\n\", {\"k\": [[], {}]}]",
+};
+
+static const char ALPHABET[] = "{}[]:,\"\\ 0123456789-+.eEtrufalsn\x01\xff";
+
+/**
+ * 对种子负载做随机变异：改字节、插入、删除、截断、拼接另一个种子
+ */
+static std::string mutate(const std::string& seed) {
+    std::string s = seed;
+    uint32_t edits = 1 + nextRandom() % 4;
+    for (uint32_t k = 0; k < edits; k++) {
+        size_t at = s.empty() ? 0 : nextRandom() % s.size();
+        char c = ALPHABET[nextRandom() % (sizeof(ALPHABET) - 1)];
+        switch (nextRandom() % 5) {
+            case 0: if (!s.empty()) s[at] = c; break;
+            case 1: s.insert(s.begin() + at, c); break;
+            case 2: if (!s.empty()) s.erase(at, 1 + nextRandom() % 3); break;
+            case 3: s.resize(at); break;
+            default: s.insert(at, SEEDS[nextRandom() % 5]); break;
+        }
+    }
+    return s.substr(0, 900);
+}
+
+void test_fuzz_tokenizer_stays_in_bounds() {
+    GuardedBuffer guard;
+    JsonToken tokens[TOKENS];
+    uint32_t outcomes[(uint8_t)JsonError::TOO_DEEP + 1] = {};
+    rngState = 12345;
+
+    for (uint32_t i = 0; i < 200000; i++) {
+        std::string text;
+        if (i % 4 == 0) {
+            size_t n = nextRandom() % 64;
+            for (size_t k = 0; k < n; k++) text += ALPHABET[nextRandom() % (sizeof(ALPHABET) - 1)];
+        } else {
+            text = mutate(SEEDS[nextRandom() % 5]);
+        }
+        const char* json = guard.place(text.data(), text.size());
+        uint16_t capacity = (uint16_t)(1 + nextRandom() % TOKENS);
+        uint16_t count = 0xFFFF;
+        JsonError e = jsonTokenize(json, text.size(), tokens, capacity, count);
+        TEST_ASSERT_TRUE((uint8_t)e <= (uint8_t)JsonError::TOO_DEEP);
+        outcomes[(uint8_t)e]++;
+        if (e == JsonError::NONE) {
+            TEST_ASSERT_TRUE(count <= capacity);
+            checkTokens(json, text.size(), tokens, count);
+        }
+    }
+    // 变异覆盖了每种结果
+    for (uint32_t n : outcomes) {
+        TEST_ASSERT_TRUE(n > 0);
+    }
+
+    char line[128];
+    snprintf(line, sizeof(line), "ok %lu, no_memory %lu, invalid %lu, partial %lu, too_deep %lu",
+             (unsigned long)outcomes[0], (unsigned long)outcomes[1], (unsigned long)outcomes[2],
+             (unsigned long)outcomes[3], (unsigned long)outcomes[4]);
+    TEST_MESSAGE(line);
+}
+
+static uint32_t handled = 0;
+
+static bool countCommand(const RemoteControlData& cmd) {
+    TEST_ASSERT_TRUE(cmd.isValid);
+    handled++;
+    return true;
+}
+
+void test_fuzz_envelopes_never_misbehave() {
+    GuardedBuffer guard;
+    RemoteControlModule remote;
+    remote.setCommandHandler(countCommand);
+    rngState = 777;
+
+    for (uint32_t i = 0; i < 50000; i++) {
+        std::string text = mutate(SEEDS[nextRandom() % 4]);
+        const uint8_t* payload = (const uint8_t*)guard.place(text.data(), text.size());
+        char reply[96];
+        memset(reply, 'x', sizeof(reply));
+        uint32_t before = handled;
+        RemoteResult r = remote.handleMQTTMessage(payload, (unsigned int)text.size(), reply, sizeof(reply));
+        TEST_ASSERT_TRUE((uint8_t)r <= (uint8_t)RemoteResult::BAD_ID);
+        TEST_ASSERT_TRUE(memchr(reply, '\0', sizeof(reply)) != nullptr);
+        // 整包校验：被拒绝的包一条也不执行
+        if (r != RemoteResult::OK) {
+            TEST_ASSERT_EQUAL_UINT32(before, handled);
+        } else {
+            TEST_ASSERT_TRUE(handled > before && handled - before <= REMOTE_BATCH_MAX);
+        }
+    }
+    TEST_ASSERT_TRUE(handled > 0);
+}
+
+// ==================== 吞吐 ====================
+
+void test_messages_per_second() {
+    static const char* const MESSAGES[] = {
+        "{\"cmd\":\"emotion\",\"emotion\":\"surprised\"}",
+        "{\"cmd\":\"servo\",\"action\":\"shake_left\",\"angle\":60}",
+        "{\"cmd\":\"mode\",\"mode\":\"weather\"}",
+    };
+    RemoteControlModule remote;
+    handled = 0;
+    remote.setCommandHandler(countCommand);
+
+    using Clock = std::chrono::steady_clock;
+    const uint32_t ROUNDS = 100000;
+    Clock::time_point t0 = Clock::now();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        const char* m = MESSAGES[i % 3];
+        remote.handleMQTTMessage((const uint8_t*)m, (unsigned int)strlen(m));
+    }
+    double single = std::chrono::duration<double>(Clock::now() - t0).count();
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS, handled);
+
+    // 带 ID 的批量包：ID 各不相同，每次都执行
+    char envelope[256];
+    char reply[96];
+    t0 = Clock::now();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        int n = snprintf(envelope, sizeof(envelope),
+                         "{\"id\":%lu,\"cmds\":[{\"cmd\":\"emotion\",\"emotion\":\"happy\"},"
+                         "{\"cmd\":\"servo\",\"action\":\"nod_up\"},{\"cmd\":\"status\"}]}",
+                         (unsigned long)i);
+        TEST_ASSERT_EQUAL((int)RemoteResult::OK,
+                          (int)remote.handleMQTTMessage((const uint8_t*)envelope, (unsigned int)n,
+                                                        reply, sizeof(reply)));
+    }
+    double batch = std::chrono::duration<double>(Clock::now() - t0).count();
+    TEST_ASSERT_EQUAL_UINT32(4 * ROUNDS, handled);
+
+    char line[128];
+    snprintf(line, sizeof(line), "single command: %.0f msg/s (%.0f ns); 3-command envelope: %.0f msg/s (%.0f ns)",
+             ROUNDS / single, single * 1e9 / ROUNDS, ROUNDS / batch, batch * 1e9 / ROUNDS);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_tokens_describe_nested_document);
+    RUN_TEST(test_number_conversion);
+    RUN_TEST(test_errors_are_classified);
+    RUN_TEST(test_names_resolve_by_perfect_hash);
+    RUN_TEST(test_fuzz_tokenizer_stays_in_bounds);
+    RUN_TEST(test_fuzz_envelopes_never_misbehave);
+    RUN_TEST(test_messages_per_second);
+    return UNITY_END();
+}
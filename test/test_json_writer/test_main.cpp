@@ -0,0 +1,239 @@
+#include <unity.h>
+#include <Host_Alloc_Counter.h>
+#include <chrono>
+#include <string>
+#include <WiFiClient.h>
+#include <PubSubClient.h>
+#include "Json_Writer.h"
+#include "Json_Tokenizer.h"
+#include "MQTT_Manager.h"
+#include "Remote_Control.h"
+
+/**
+ * 流式 JSON 写出：定点数格式化、转义、逗号与嵌套、超过 JSON_MAX_NESTING 时的截断，
+ * 计数与实际写出一致，状态报文经 beginPublish/write/endPublish 一次写出且不分配堆内存
+ */
+
+/**
+ * 写入 std::string 的 Print
+ */
+struct StringPrint : public Print {
+    std::string text;
+
+    size_t write(uint8_t c) override {
+        text.push_back((char)c);
+        return 1;
+    }
+    using Print::write;
+};
+
+void setUp() {}
+void tearDown() {}
+
+/**
+ * 输出必须能被分词器完整解析
+ */
+static void assertValidJson(const std::string& text) {
+    JsonToken tokens[64];
+    uint16_t count = 0;
+    TEST_ASSERT_EQUAL((int)JsonError::NONE, (int)jsonTokenize(text.data(), text.size(), tokens, 64, count));
+}
+
+// ==================== 数字 ====================
+
+void test_fixed_point_formatting() {
+    char text[JSON_NUMBER_MAX];
+    TEST_ASSERT_EQUAL_size_t(5, jsonFormatFixed(-235, 1, text));
+    TEST_ASSERT_EQUAL_STRING("-23.5", text);
+    jsonFormatFixed(5, 2, text);
+    TEST_ASSERT_EQUAL_STRING("0.05", text);
+    jsonFormatFixed(-5, 3, text);
+    TEST_ASSERT_EQUAL_STRING("-0.005", text);
+    jsonFormatFixed(0, 0, text);
+    TEST_ASSERT_EQUAL_STRING("0", text);
+    TEST_ASSERT_EQUAL_size_t(JSON_NUMBER_MAX - 1, jsonFormatFixed(INT32_MIN, 9, text));
+    TEST_ASSERT_EQUAL_STRING("-2.147483648", text);
+    jsonFormatFixed(INT32_MAX, 0, text);
+    TEST_ASSERT_EQUAL_STRING("2147483647", text);
+    jsonFormatFixed(7, 12, text);           // 小数位超过 9 时按 9 位
+    TEST_ASSERT_EQUAL_STRING("0.000000007", text);
+
+    // 99.95f 实为 99.9499969，不能因 float 乘法的舍入进位成 100.0
+    TEST_ASSERT_EQUAL_INT32(999, jsonFixedFromFloat(99.95f, 1));
+    TEST_ASSERT_EQUAL_INT32(-235, jsonFixedFromFloat(-23.55f, 1));
+    TEST_ASSERT_EQUAL_INT32(-24, jsonFixedFromFloat(-23.5f, 0));
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, jsonFixedFromFloat(1e12f, 2));
+    TEST_ASSERT_EQUAL_INT32(-INT32_MAX, jsonFixedFromFloat(-1e12f, 2));
+}
+
+// ==================== 结构 ====================
+
+void test_document_structure_and_escaping() {
+    StringPrint out;
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("s");
+    json.string("a\"b\\c\n\t\x01");
+    json.key("n");
+    json.number(21.25f, 1);
+    json.key("bad");
+    json.number(NAN, 1);
+    json.key("list");
+    json.beginArray();
+    json.integer(-3);
+    json.unsignedInteger(4000000000UL);
+    json.boolean(true);
+    json.null();
+    json.beginObject();
+    json.endObject();
+    json.string(nullptr);
+    json.endArray();
+    json.endObject();
+
+    TEST_ASSERT_EQUAL_STRING("{\"s\":\"a\\\"b\\\\c\\n\\t\\u0001\",\"n\":21.3,\"bad\":null,"
+                             "\"list\":[-3,4000000000,true,null,{},null]}",
+                             out.text.c_str());
+    TEST_ASSERT_EQUAL_size_t(out.text.size(), json.size());
+    TEST_ASSERT_FALSE(json.truncated());
+    assertValidJson(out.text);
+}
+
+void test_nesting_beyond_limit_is_truncated() {
+    StringPrint out;
+    JsonWriter json(out);
+    // 每层前后各一个元素：不截断时第 9 层起逗号位图会回绕
+    for (int i = 0; i < JSON_MAX_NESTING + 3; i++) {
+        json.beginArray();
+        json.integer(i);
+    }
+    for (int i = 0; i < JSON_MAX_NESTING + 3; i++) {
+        json.integer(100 + i);
+        json.endArray();
+    }
+    json.beginObject();     // 顶层之后的多余值不应破坏已写出的内容
+    json.endObject();
+
+    std::string expected;
+    for (int i = 0; i < JSON_MAX_NESTING; i++) {
+        expected += "[" + std::to_string(i) + ",";
+    }
+    expected += "null";
+    // 前 3 次 endArray() 属于被丢弃的层
+    for (int i = 3; i < JSON_MAX_NESTING + 3; i++) {
+        expected += "," + std::to_string(100 + i) + "]";
+    }
+    expected += "{}";
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), out.text.c_str());
+    TEST_ASSERT_TRUE(json.truncated());
+    assertValidJson(out.text.substr(0, out.text.size() - 2));
+
+    // 截断后计数与写出仍一致
+    PrintCounter counter;
+    JsonWriter counted(counter);
+    for (int i = 0; i < JSON_MAX_NESTING + 1; i++) counted.beginObject(), counted.key("k");
+    counted.string("deep");
+    for (int i = 0; i < JSON_MAX_NESTING + 1; i++) counted.endObject();
+    TEST_ASSERT_EQUAL_size_t(counter.getCount(), counted.size());
+}
+
+// ==================== 状态报文 ====================
+
+static RemoteStatus sampleStatus(uint32_t i) {
+    return {"happy", 23.45f + (float)(i % 50), 61.0f, "Sunny \"warm\"", 123456u + i, (uint16_t)i};
+}
+
+void test_status_counter_matches_output() {
+    for (uint32_t i = 0; i < 200; i++) {
+        RemoteStatus status = sampleStatus(i);
+        PrintCounter counter;
+        StringPrint out;
+        size_t counted = RemoteControlModule::writeStatusJSON(counter, status);
+        size_t written = RemoteControlModule::writeStatusJSON(out, status);
+        TEST_ASSERT_EQUAL_size_t(counter.getCount(), counted);
+        TEST_ASSERT_EQUAL_size_t(counted, written);
+        TEST_ASSERT_EQUAL_size_t(written, out.text.size());
+        assertValidJson(out.text);
+    }
+}
+
+void test_publish_status_streams_without_heap() {
+    WiFiClient client;
+    MQTTManager mqtt(client);
+    RemoteControlModule remote;
+    mqtt.begin("broker", 1883);
+    PubSubClient::instance->online = true;
+    TEST_ASSERT_TRUE(mqtt.connect());
+
+    hostSetMillis(5000);
+    TEST_ASSERT_TRUE(remote.publishStatus(mqtt, "sad", 18.04f, 45.5f, "Cloudy"));
+    const PubSubClient::Message& m = PubSubClient::instance->sent.back();
+    TEST_ASSERT_EQUAL_STRING(MQTT_TOPIC_STATUS, m.topic.c_str());
+    // 替身在 endPublish() 中核对了报文头长度与实际写入的字节数
+    TEST_ASSERT_EQUAL_STRING("{\"emotion\":\"sad\",\"temperature\":18.0,\"humidity\":45.5,"
+                             "\"weather\":\"Cloudy\",\"timestamp\":5000,\"commands_received\":0}",
+                             m.payload.c_str());
+
+    // 计数与写出都不分配（替身的报文流本身用 std::string，不计入）
+    PrintCounter counter;
+    size_t before = g_hostAllocations;
+    for (uint32_t i = 0; i < 1000; i++) {
+        RemoteControlModule::writeStatusJSON(counter, sampleStatus(i));
+    }
+    TEST_ASSERT_EQUAL_size_t(0, g_hostAllocations - before);
+    TEST_ASSERT_TRUE(counter.getCount() > 0);
+}
+
+/**
+ * 每份状态报文两遍写出（计数 + 报文）的耗时；与 snprintf 拼出同样内容作对照
+ */
+void test_status_cost() {
+    using Clock = std::chrono::steady_clock;
+    const uint32_t ROUNDS = 200000;
+    size_t bytes = 0;
+
+    Clock::time_point t0 = Clock::now();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        PrintCounter counter;
+        RemoteStatus status = sampleStatus(i);
+        RemoteControlModule::writeStatusJSON(counter, status);
+        bytes += RemoteControlModule::writeStatusJSON(counter, status);
+    }
+    double streamed = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / ROUNDS;
+
+    // 单独的计数遍：MQTT 报文头先于负载写出，长度只能靠多写一遍求得
+    t0 = Clock::now();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        PrintCounter counter;
+        bytes += RemoteControlModule::writeStatusJSON(counter, sampleStatus(i));
+    }
+    double counted = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / ROUNDS;
+
+    char buffer[256];
+    t0 = Clock::now();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        RemoteStatus s = sampleStatus(i);
+        bytes += (size_t)snprintf(buffer, sizeof(buffer),
+                                  "{\"emotion\":\"%s\",\"temperature\":%.1f,\"humidity\":%.1f,\"weather\":\"%s\","
+                                  "\"timestamp\":%lu,\"commands_received\":%u}",
+                                  s.emotion, s.temperature, s.humidity, s.weather,
+                                  (unsigned long)s.timestamp, (unsigned)s.commandsReceived);
+    }
+    double printed = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / ROUNDS;
+    TEST_ASSERT_TRUE(bytes > 0);
+
+    char line[160];
+    snprintf(line, sizeof(line), "streaming writer (count + write): %.0f ns/status, of which count pass %.0f ns; "
+             "snprintf into buffer: %.0f ns", streamed, counted, printed);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fixed_point_formatting);
+    RUN_TEST(test_document_structure_and_escaping);
+    RUN_TEST(test_nesting_beyond_limit_is_truncated);
+    RUN_TEST(test_status_counter_matches_output);
+    RUN_TEST(test_publish_status_streams_without_heap);
+    RUN_TEST(test_status_cost);
+    return UNITY_END();
+}
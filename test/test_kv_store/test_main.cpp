@@ -0,0 +1,552 @@
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "Kv_Store.h"
+#include "Config_Store.h"
+#include "Choreography_Store.h"
+#include "Choreography_Builtin.h"
+
+/**
+ * 键值存储：长时间写入下的回收、写放大与两扇区的磨损，
+ * 不空闲时 put() 从不擦除（返回 BUSY，停顿只有一条记录的编程时间），容量与键数上限，
+ * 启动扫描，任意一次编程/擦除中途断电后每个键为旧值或进行中的新值，
+ * 以及配置与脚本在存储忙时推迟、回收完成后写入
+ */
+
+typedef std::map<uint16_t, std::string> Model;
+
+static const std::string NONE("\x01<none>");
+
+static std::map<const uint8_t*, int> erasesAt;
+
+static void onErase(const uint8_t* begin, const uint8_t*) {
+    erasesAt[begin]++;
+}
+
+void setUp() {
+    KvStore::hostPowerOn();
+    KvStore::hostFormat();
+    erasesAt.clear();
+    g_kvStore.setEraseHandler(onErase);
+    g_kvStore.begin();
+}
+
+void tearDown() {}
+
+// ==================== 工具 ====================
+
+static std::string randomValue(std::mt19937& r, size_t maxLength) {
+    std::string s(r() % (maxLength + 1), '\0');
+    for (char& c : s) {
+        c = (char)r();
+    }
+    return s;
+}
+
+static std::string stored(uint16_t key) {
+    size_t length;
+    const uint8_t* value = g_kvStore.find(key, length);
+    return value != nullptr ? std::string((const char*)value, length) : NONE;
+}
+
+static void assertMatches(const Model& model) {
+    for (const auto& kv : model) {
+        TEST_ASSERT_TRUE_MESSAGE(stored(kv.first) == kv.second, "value differs from model");
+    }
+    TEST_ASSERT_EQUAL_size_t(model.size(), g_kvStore.getKeyCount());
+}
+
+/**
+ * 像主循环一样写入：BUSY 时空闲一次再重试
+ */
+static KvResult putWhenIdle(uint16_t key, const std::string& value, uint32_t* busy = nullptr) {
+    for (int attempt = 0; attempt < 10000; attempt++) {
+        KvResult result = g_kvStore.put(key, value.data(), value.size());
+        if (result != KvResult::BUSY) {
+            return result;
+        }
+        if (busy != nullptr) {
+            (*busy)++;
+        }
+        g_kvStore.update(true);
+    }
+    return KvResult::BUSY;
+}
+
+/**
+ * 不空闲地写入同一个键，直到连最短的记录也放不下
+ */
+static void fillUntilBusy(uint16_t key) {
+    size_t length = KV_VALUE_MAX;
+    for (uint32_t i = 0; i < 100000 && length >= 4; i++) {
+        std::string value(length, '\0');
+        memcpy(&value[0], &i, 4);
+        if (g_kvStore.put(key, value.data(), value.size()) == KvResult::BUSY) {
+            length /= 2;
+        }
+    }
+    TEST_ASSERT_TRUE_MESSAGE(length < 4, "store never became busy");
+    TEST_ASSERT_TRUE(g_kvStore.isReclaiming());
+}
+
+static void idleUntilReclaimed() {
+    for (int i = 0; i < 10000 && g_kvStore.isReclaiming(); i++) {
+        g_kvStore.update(true);
+    }
+    TEST_ASSERT_FALSE(g_kvStore.isReclaiming());
+}
+
+// ==================== 回收 ====================
+
+void test_churn_reclaims_and_survives_reboots() {
+    std::mt19937 r(7);
+    Model model;
+    uint32_t userBytes = 0, erases = 0, reclaims = 0, words = 0, copied = 0, maxStall = 0, busy = 0;
+    const int PUTS = 200000;
+
+    for (int i = 0; i < PUTS; i++) {
+        uint16_t key = (uint16_t)(1 + r() % 16);
+        std::string value = randomValue(r, key <= 2 ? 64 : KV_VALUE_MAX);
+        TEST_ASSERT_EQUAL((int)KvResult::OK, (int)putWhenIdle(key, value, &busy));
+        model[key] = value;
+        userBytes += value.size();
+        if (r() % 4 == 0) {
+            for (int u = 0; u < 8; u++) {
+                g_kvStore.update(true);
+            }
+        }
+        if (i % 20000 == 19999) {
+            const KvStats& stats = g_kvStore.getStats();
+            erases += stats.erases;
+            reclaims += stats.reclaims;
+            words += stats.wordsProgrammed;
+            copied += stats.wordsCopied;
+            maxStall = std::max(maxStall, stats.maxStallMicros);
+            g_kvStore.begin();
+            assertMatches(model);
+        }
+    }
+
+    // 两个扇区轮流擦除
+    TEST_ASSERT_EQUAL_size_t(KV_SECTOR_COUNT, erasesAt.size());
+    int fewest = erasesAt.begin()->second, most = fewest;
+    for (const auto& e : erasesAt) {
+        fewest = std::min(fewest, e.second);
+        most = std::max(most, e.second);
+    }
+    TEST_ASSERT_TRUE(most - fewest <= 1);
+    TEST_ASSERT_TRUE(reclaims > 0);
+    TEST_ASSERT_TRUE(maxStall < KV_SECTOR_SIZE / 4);        // 远小于一次擦除
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%d puts, %lu user bytes, %lu words programmed (%lu copied, amplification %.3f), "
+             "%lu erases, %lu reclaims, %lu busy retries, max stall %lu us",
+             PUTS, (unsigned long)userBytes, (unsigned long)words, (unsigned long)copied,
+             words * 4.0 / userBytes, (unsigned long)erases, (unsigned long)reclaims,
+             (unsigned long)busy, (unsigned long)maxStall);
+    TEST_MESSAGE(line);
+}
+
+/**
+ * 同样的负载，从不空闲：回收只能在 update(true) 中完成，put() 返回 BUSY 而不是擦除
+ */
+void test_put_never_erases_when_not_idle() {
+    std::mt19937 r(7);
+    Model model;
+    std::vector<uint32_t> stalls;
+    uint32_t busy = 0;
+
+    for (int i = 0; i < 50000; i++) {
+        uint16_t key = (uint16_t)(1 + r() % 16);
+        std::string value = randomValue(r, key <= 2 ? 64 : KV_VALUE_MAX);
+        uint32_t before = g_kvStore.getStats().flashMicros;
+        unsigned long start = millis();
+        KvResult result = g_kvStore.put(key, value.data(), value.size());
+        stalls.push_back(g_kvStore.getStats().flashMicros - before);
+        TEST_ASSERT_TRUE(millis() - start < 100);
+        if (result == KvResult::OK) {
+            model[key] = value;
+        } else {
+            TEST_ASSERT_EQUAL((int)KvResult::BUSY, (int)result);
+            busy++;
+        }
+    }
+    KvStats stats = g_kvStore.getStats();
+    TEST_ASSERT_EQUAL_UINT16(0, stats.erases);
+    TEST_ASSERT_EQUAL_UINT32(busy, stats.busy);
+    TEST_ASSERT_TRUE(busy > 0);
+    // 最长停顿为一条最大记录的编程（加上打开扇区的 3 个字）
+    TEST_ASSERT_TRUE(stats.maxStallMicros < 10000);
+    assertMatches(model);
+
+    // 空闲后回收完成，写入恢复
+    idleUntilReclaimed();
+    std::string value = randomValue(r, KV_VALUE_MAX);
+    TEST_ASSERT_EQUAL((int)KvResult::OK, (int)g_kvStore.put(3, value.data(), value.size()));
+    model[3] = value;
+    g_kvStore.begin();
+    assertMatches(model);
+
+    std::sort(stalls.begin(), stalls.end());
+    char line[128];
+    snprintf(line, sizeof(line), "never idle: %lu busy, max stall %lu us, p50 %lu us, p99 %lu us",
+             (unsigned long)busy, (unsigned long)stats.maxStallMicros, (unsigned long)stalls[stalls.size() / 2],
+             (unsigned long)stalls[stalls.size() * 99 / 100]);
+    TEST_MESSAGE(line);
+}
+
+// ==================== 容量 ====================
+
+void test_capacity_limits() {
+    std::mt19937 r(3);
+    Model model;
+    KvResult result = KvResult::OK;
+    uint16_t keys = 0;
+    for (uint16_t key = 1; key < 200; key++) {
+        std::string value(KV_VALUE_MAX, (char)key);
+        result = putWhenIdle(key, value);
+        if (result != KvResult::OK) {
+            break;
+        }
+        model[key] = value;
+        keys++;
+    }
+    TEST_ASSERT_EQUAL((int)KvResult::FULL, (int)result);
+    TEST_ASSERT_TRUE(g_kvStore.getLiveBytes() < KV_SECTOR_SIZE);
+
+    // 满时仍可覆盖已有键
+    for (int i = 0; i < 2000; i++) {
+        uint16_t key = (uint16_t)(1 + r() % keys);
+        std::string value(KV_VALUE_MAX, (char)r());
+        TEST_ASSERT_EQUAL((int)KvResult::OK, (int)putWhenIdle(key, value));
+        model[key] = value;
+    }
+    assertMatches(model);
+    g_kvStore.begin();
+    assertMatches(model);
+
+    std::string big(KV_VALUE_MAX + 1, 'x');
+    TEST_ASSERT_EQUAL((int)KvResult::TOO_LARGE, (int)g_kvStore.put(500, big.data(), big.size()));
+    TEST_ASSERT_EQUAL((int)KvResult::FULL, (int)g_kvStore.put(KV_KEY_NONE, "a", 1));
+
+    // 键数上限
+    KvStore::hostFormat();
+    g_kvStore.begin();
+    uint16_t count = 0;
+    for (uint16_t key = 1; key < 100 && g_kvStore.put(key, "a", 1) == KvResult::OK; key++) {
+        count++;
+    }
+    TEST_ASSERT_EQUAL_UINT16(KV_MAX_KEYS, count);
+
+    // 删除
+    size_t length;
+    TEST_ASSERT_EQUAL((int)KvResult::OK, (int)g_kvStore.remove(3));
+    TEST_ASSERT_NULL(g_kvStore.find(3, length));
+    TEST_ASSERT_EQUAL((int)KvResult::NOT_FOUND, (int)g_kvStore.remove(3));
+    g_kvStore.begin();
+    TEST_ASSERT_NULL(g_kvStore.find(3, length));
+    TEST_ASSERT_EQUAL_UINT8(KV_MAX_KEYS - 1, g_kvStore.getKeyCount());
+}
+
+void test_boot_scan() {
+    for (uint32_t i = 0; i < 5000; i++) {
+        TEST_ASSERT_EQUAL((int)KvResult::OK,
+                          (int)putWhenIdle((uint16_t)(1 + i % 8), std::string((const char*)&i, 4)));
+    }
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point t0 = Clock::now();
+    g_kvStore.begin();
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+
+    TEST_ASSERT_EQUAL_UINT8(8, g_kvStore.getKeyCount());
+    uint32_t last = 4999;
+    TEST_ASSERT_TRUE(stored((uint16_t)(1 + last % 8)) == std::string((const char*)&last, 4));
+    TEST_ASSERT_EQUAL_UINT16(0, g_kvStore.getStats().corruptRecords);
+
+    char line[96];
+    snprintf(line, sizeof(line), "boot scan: %lu records in %.0f us (host)",
+             (unsigned long)g_kvStore.getStats().recordsScanned, us);
+    TEST_MESSAGE(line);
+}
+
+// ==================== 断电 ====================
+
+struct Step {
+    enum Kind { PUT, REMOVE, IDLE } kind;
+    uint16_t key;
+    std::string value;
+};
+
+static std::vector<Step> scenario(uint32_t seed, int steps) {
+    std::mt19937 r(seed);
+    std::vector<Step> s;
+    for (int i = 0; i < steps; i++) {
+        uint32_t kind = r() % 10;
+        uint16_t key = (uint16_t)(1 + r() % 12);
+        if (kind < 6) {
+            s.push_back({Step::PUT, key, randomValue(r, (r() % 8 == 0) ? KV_VALUE_MAX : 300)});
+        } else if (kind < 7) {
+            s.push_back({Step::REMOVE, key, ""});
+        } else {
+            s.push_back({Step::IDLE, 0, ""});
+        }
+    }
+    return s;
+}
+
+static void applyStep(const Step& step, Model& model) {
+    if (step.kind == Step::PUT) {
+        if (g_kvStore.put(step.key, step.value.data(), step.value.size()) == KvResult::OK) {
+            model[step.key] = step.value;
+        }
+    } else if (step.kind == Step::REMOVE) {
+        if (g_kvStore.remove(step.key) == KvResult::OK) {
+            model.erase(step.key);
+        }
+    } else {
+        g_kvStore.update(true);
+    }
+}
+
+static uint32_t operations() {
+    const KvStats& stats = g_kvStore.getStats();
+    return stats.wordsProgrammed + stats.erases;
+}
+
+/**
+ * 在场景的每一个编程/擦除处断电（前 3000 个、擦除与打开扇区附近、以及随机位置），
+ * 重启后每个键为断电前的值，进行中那一步的键也可以是新值；之后继续写入并再次重启
+ */
+void test_power_cut_keeps_old_or_new_value() {
+    const uint32_t SEED = 11;
+    std::vector<Step> steps = scenario(SEED, 3000);
+
+    // 试运行：找出擦除与打开扇区前后的操作序号
+    Model model;
+    std::vector<uint32_t> cuts;
+    for (const Step& step : steps) {
+        const KvStats& stats = g_kvStore.getStats();
+        uint32_t erases = stats.erases, headSeq = stats.headSeq, before = operations();
+        applyStep(step, model);
+        if (stats.erases != erases || stats.headSeq != headSeq) {
+            for (uint32_t k = before; k <= operations() + 1; k++) {
+                cuts.push_back(k + 1);
+            }
+        }
+    }
+    uint32_t total = operations();
+    size_t nearErase = cuts.size();
+    TEST_ASSERT_TRUE(g_kvStore.getStats().erases > 0);
+    for (uint32_t k = 1; k <= 3000; k++) {
+        cuts.push_back(k);
+    }
+    std::mt19937 r(SEED);
+    for (int i = 0; i < 3000; i++) {
+        cuts.push_back(1 + r() % total);
+    }
+
+    uint32_t trials = 0, newer = 0, torn = 0;
+    for (uint32_t cut : cuts) {
+        KvStore::hostPowerOn();
+        KvStore::hostFormat();
+        g_kvStore.begin();
+        KvStore::hostPowerCut(cut, cut * 2654435761u);
+
+        Model before;
+        size_t i = 0;
+        for (; i < steps.size(); i++) {
+            Model after = before;
+            applyStep(steps[i], after);
+            if (KvStore::hostPoweredOff()) {
+                break;
+            }
+            before = after;
+        }
+        if (i == steps.size()) {
+            continue;
+        }
+        trials++;
+        const Step& inflight = steps[i];
+
+        KvStore::hostPowerOn();
+        g_kvStore.begin();
+        Model expect = before;
+        for (uint16_t key = 1; key <= 12; key++) {
+            std::string got = stored(key);
+            auto it = before.find(key);
+            std::string old = it != before.end() ? it->second : NONE;
+            if (got == old) {
+                continue;
+            }
+            TEST_ASSERT_EQUAL_UINT16_MESSAGE(inflight.key, key, "key changed by a step that had not started");
+            if (inflight.kind == Step::PUT) {
+                TEST_ASSERT_TRUE_MESSAGE(got == inflight.value, "torn value after power cut");
+                expect[key] = got;
+            } else {
+                TEST_ASSERT_TRUE_MESSAGE(got == NONE, "torn delete after power cut");
+                expect.erase(key);
+            }
+            newer++;
+        }
+        if (g_kvStore.getStats().corruptRecords > 0) {
+            torn++;
+        }
+
+        // 恢复后继续写入并再次重启
+        for (int u = 0; u < 3000 && g_kvStore.isReclaiming(); u++) {
+            g_kvStore.update(true);
+        }
+        for (size_t j = i + 1; j < steps.size() && j < i + 400; j++) {
+            applyStep(steps[j], expect);
+        }
+        g_kvStore.begin();
+        assertMatches(expect);
+    }
+    TEST_ASSERT_TRUE(trials > 3000);
+    TEST_ASSERT_TRUE(torn > 0);
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%lu ops in scenario, %lu cut points (%lu near erase/open): %lu trials, "
+             "%lu kept the new value, %lu boots skipped torn records",
+             (unsigned long)total, (unsigned long)cuts.size(), (unsigned long)nearErase,
+             (unsigned long)trials, (unsigned long)newer, (unsigned long)torn);
+    TEST_MESSAGE(line);
+}
+
+/**
+ * 回收复制中途编程失败（不重启，之后恢复正常）：失败的那条记录重新复制，
+ * 所有键复制完之前不擦除被回收的扇区
+ */
+void test_failed_reclaim_copy_is_retried_before_erase() {
+    uint32_t trials = 0, failures = 0;
+    for (uint32_t cut = 1; cut <= 1200; cut += 7) {
+        KvStore::hostPowerOn();
+        KvStore::hostFormat();
+        g_kvStore.begin();
+
+        Model model;
+        std::mt19937 r(cut);
+        for (uint16_t key = 1; key <= 10; key++) {
+            model[key] = randomValue(r, 500);
+            TEST_ASSERT_EQUAL((int)KvResult::OK, (int)putWhenIdle(key, model[key]));
+        }
+        fillUntilBusy(0x0200);
+        model[0x0200] = stored(0x0200);
+
+        KvStore::hostPowerCut(cut, cut * 2654435761u);
+        for (int i = 0; i < 1000 && !KvStore::hostPoweredOff(); i++) {
+            g_kvStore.update(true);
+        }
+        if (!KvStore::hostPoweredOff()) {
+            continue;
+        }
+        trials++;
+        KvStore::hostPowerOn();
+
+        idleUntilReclaimed();
+        assertMatches(model);
+        failures += g_kvStore.getStats().copyFailures;
+        g_kvStore.begin();
+        assertMatches(model);
+    }
+    TEST_ASSERT_TRUE(trials > 50);
+    TEST_ASSERT_TRUE(failures > 0);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%lu failures injected during reclaim, %lu failed copies retried",
+             (unsigned long)trials, (unsigned long)failures);
+    TEST_MESSAGE(line);
+}
+
+// ==================== 调用方 ====================
+
+void test_config_is_applied_and_saved_later_when_busy() {
+    const RuntimeConfig defaults = g_config;
+    ConfigStore config;
+    config.begin();
+    fillUntilBusy(0x0200);
+
+    config.beginUpdate();
+    TEST_ASSERT_EQUAL((int)ConfigResult::OK, (int)config.stage("temp_high", 9, "31.5", 4));
+    TEST_ASSERT_EQUAL((int)ConfigResult::PENDING, (int)config.commit());
+    TEST_ASSERT_EQUAL_FLOAT(31.5f, g_config.tempHigh);
+    TEST_ASSERT_TRUE(config.isUnsaved());
+    TEST_ASSERT_EQUAL_UINT32(0, config.getSeq());
+
+    // 不空闲时一直等待
+    config.update();
+    TEST_ASSERT_TRUE(config.isUnsaved());
+
+    for (int i = 0; i < 10000 && config.isUnsaved(); i++) {
+        g_kvStore.update(true);
+        config.update();
+    }
+    TEST_ASSERT_FALSE(config.isUnsaved());
+    TEST_ASSERT_EQUAL_UINT32(1, config.getSeq());
+
+    g_config = defaults;
+    g_kvStore.begin();
+    config.begin();
+    TEST_ASSERT_EQUAL_FLOAT(31.5f, g_config.tempHigh);
+    TEST_ASSERT_EQUAL_UINT32(1, config.getSeq());
+    g_config = defaults;
+}
+
+void test_choreography_is_stored_later_when_busy() {
+    ChoreographyStore choreo;
+    choreo.begin(nullptr);
+    fillUntilBusy(0x0200);
+
+    std::vector<uint8_t> chunk = {(uint8_t)ChoreoMessage::CHUNK, 2, 0, 0,
+                                  (uint8_t)sizeof(CHOREO_DANCE), (uint8_t)(sizeof(CHOREO_DANCE) >> 8)};
+    chunk.insert(chunk.end(), CHOREO_DANCE, CHOREO_DANCE + sizeof(CHOREO_DANCE));
+    char reply[96];
+    char expected[96];
+
+    TEST_ASSERT_EQUAL((int)ChoreoStoreResult::PENDING,
+                      (int)choreo.handleMessage(chunk.data(), chunk.size(), reply, sizeof(reply)));
+    snprintf(expected, sizeof(expected), "{\"choreo\":{\"slot\":2,\"received\":%u,\"result\":\"pending\"}}",
+             (unsigned)sizeof(CHOREO_DANCE));
+    TEST_ASSERT_EQUAL_STRING(expected, reply);
+
+    // 写入前新的下载被拒绝，发送端从头重发
+    chunk[1] = 3;
+    TEST_ASSERT_EQUAL((int)ChoreoStoreResult::BUSY,
+                      (int)choreo.handleMessage(chunk.data(), chunk.size(), reply, sizeof(reply)));
+    TEST_ASSERT_EQUAL_STRING("{\"choreo\":{\"slot\":3,\"received\":0,\"result\":\"busy\"}}", reply);
+
+    size_t length = 0;
+    TEST_ASSERT_NULL(choreo.find(2, length));
+    for (int i = 0; i < 10000 && choreo.isStorePending(); i++) {
+        g_kvStore.update(true);
+        choreo.update();
+    }
+    TEST_ASSERT_FALSE(choreo.isStorePending());
+    const uint8_t* script = choreo.find(2, length);
+    TEST_ASSERT_NOT_NULL(script);
+    TEST_ASSERT_EQUAL_size_t(sizeof(CHOREO_DANCE), length);
+    TEST_ASSERT_EQUAL_MEMORY(CHOREO_DANCE, script, length);
+
+    TEST_ASSERT_EQUAL((int)ChoreoStoreResult::STORED,
+                      (int)choreo.handleMessage(chunk.data(), chunk.size(), reply, sizeof(reply)));
+    TEST_ASSERT_NOT_NULL(choreo.find(3, length));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_churn_reclaims_and_survives_reboots);
+    RUN_TEST(test_put_never_erases_when_not_idle);
+    RUN_TEST(test_capacity_limits);
+    RUN_TEST(test_boot_scan);
+    RUN_TEST(test_power_cut_keeps_old_or_new_value);
+    RUN_TEST(test_failed_reclaim_copy_is_retried_before_erase);
+    RUN_TEST(test_config_is_applied_and_saved_later_when_busy);
+    RUN_TEST(test_choreography_is_stored_later_when_busy);
+    return UNITY_END();
+}
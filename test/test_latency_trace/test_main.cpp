@@ -0,0 +1,88 @@
+#include <unity.h>
+#include <string.h>
+#include "Latency_Trace.h"
+#include "Servo_Controller.h"
+
+/**
+ * 延迟追踪：舵机写入点在 DMA 半缓冲区填充时打点并结束追踪，而不是在入队时
+ */
+
+static ServoController servo;
+
+// 报告中某一项的计数与 p50（微秒），没有该项时计数为 0
+static uint32_t reportEntry(const char* name, uint32_t* p50 = nullptr) {
+    char json[512];
+    TEST_ASSERT_NOT_EQUAL(0, g_latencyTracer.formatReportJSON(json, sizeof(json)));
+    char key[24];
+    snprintf(key, sizeof(key), "\"%s\":[", name);
+    const char* at = strstr(json, key);
+    if (at == nullptr) return 0;
+    unsigned long n = 0, median = 0;
+    sscanf(at + strlen(key), "%lu,%lu", &n, &median);
+    if (p50) *p50 = (uint32_t)median;
+    return (uint32_t)n;
+}
+
+// 推进一个 PWM 周期
+static void pwmFrame() {
+    hostAdvanceMillis(1000 / SERVO_PWM_FRAME_HZ);
+    ServoPWMBackend::hostUpdateEvent();
+}
+
+void setUp() {
+    g_latencyTracer.reset();
+}
+
+void tearDown() {}
+
+void test_servo_hop_is_stamped_at_dma_refill() {
+    uint32_t rx = LatencyTracer::now();
+    g_latencyTracer.beginTrace(VoiceCommand::NOD, rx, rx);
+    TEST_ASSERT_TRUE(servo.performAction(ServoAction::NOD_DOWN));
+    TEST_ASSERT_TRUE(servo.isTracePending());
+
+    // 入队之后、DMA 取走新帧之前，追踪保持打开
+    TEST_ASSERT_EQUAL_UINT32(0, reportEntry("nod"));
+
+    int frames = 0;
+    while (servo.isTracePending() && frames < 2 * SERVO_DMA_BUFFER_FRAMES) {
+        pwmFrame();
+        frames++;
+    }
+    TEST_ASSERT_FALSE(servo.isTracePending());
+    TEST_ASSERT_GREATER_OR_EQUAL(1, frames);
+
+    // 由 PWM 中断结束，舵机延迟包含等待填充的 PWM 周期
+    uint32_t servoP50 = 0;
+    TEST_ASSERT_EQUAL_UINT32(1, reportEntry("nod"));
+    TEST_ASSERT_EQUAL_UINT32(1, reportEntry("@servo", &servoP50));
+    TEST_ASSERT_GREATER_OR_EQUAL(frames * 1000000UL / SERVO_PWM_FRAME_HZ * 3 / 4, servoP50);
+}
+
+void test_trace_without_motion_is_closed_by_caller() {
+    uint32_t rx = LatencyTracer::now();
+    g_latencyTracer.beginTrace(VoiceCommand::QUERY_TEMP, rx, rx);
+    TEST_ASSERT_FALSE(servo.isTracePending());
+    g_latencyTracer.endTrace();
+    TEST_ASSERT_EQUAL_UINT32(1, reportEntry("temp"));
+    TEST_ASSERT_EQUAL_UINT32(0, reportEntry("@servo"));
+
+    // 之后的 PWM 周期不会再写入
+    for (int i = 0; i < SERVO_DMA_BUFFER_FRAMES; i++) pwmFrame();
+    TEST_ASSERT_EQUAL_UINT32(1, reportEntry("temp"));
+}
+
+void test_commit_after_trace_ended_is_ignored() {
+    g_latencyTracer.commit(TraceHop::SERVO_WRITE);
+    TEST_ASSERT_EQUAL_UINT32(0, reportEntry("@servo"));
+    TEST_ASSERT_EQUAL_UINT32(0, reportEntry("unknown"));
+}
+
+int main(int, char**) {
+    servo.begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_servo_hop_is_stamped_at_dma_refill);
+    RUN_TEST(test_trace_without_motion_is_closed_by_caller);
+    RUN_TEST(test_commit_after_trace_ended_is_ignored);
+    return UNITY_END();
+}
@@ -0,0 +1,150 @@
+#include <unity.h>
+#include "Motion_Arbiter.h"
+
+/**
+ * 动作仲裁：空闲立即执行、按优先级抢占、排队替换与过期、单轴段的衔接
+ */
+
+static const uint32_t TICK_MS = 1000 / SERVO_UPDATE_RATE_HZ;
+
+static ServoController servo;
+static MotionArbiter arbiter;
+
+// 按节拍推进舵机与仲裁器
+static void step(uint32_t ticks) {
+    for (uint32_t i = 0; i < ticks; i++) {
+        servo.tick();
+        hostAdvanceMillis(TICK_MS);
+        servo.update();
+        arbiter.update();
+    }
+}
+
+static void settle() {
+    for (int i = 0; i < 10000 && !arbiter.isIdle(); i++) step(1);
+}
+
+static MotionSource ownerOf() {
+    MotionSource source = MotionSource::COUNT;
+    arbiter.getOwner(source);
+    return source;
+}
+
+void setUp() {
+    servo = ServoController();
+    servo.begin();
+    arbiter = MotionArbiter();
+    arbiter.begin(&servo);
+}
+
+void tearDown() {}
+
+void test_idle_request_starts_immediately() {
+    TEST_ASSERT_TRUE(arbiter.submit(ServoAction::NOD_DOWN, MotionSource::AMBIENT));
+    TEST_ASSERT_TRUE(servo.isPerforming());
+    TEST_ASSERT_EQUAL((int)MotionSource::AMBIENT, (int)ownerOf());
+    TEST_ASSERT_EQUAL_UINT32(1, arbiter.getStats().started);
+}
+
+void test_higher_priority_preempts_lower() {
+    arbiter.submit(ServoAction::NOD_DOWN, MotionSource::AMBIENT);
+    step(5);
+    TEST_ASSERT_TRUE(arbiter.submit(ServoAction::SHAKE_LEFT, MotionSource::VOICE, MotionPreempt::CUT));
+    TEST_ASSERT_EQUAL((int)MotionSource::VOICE, (int)ownerOf());
+    TEST_ASSERT_EQUAL_UINT32(1, arbiter.getStats().preemptions);
+    TEST_ASSERT_EQUAL(0, arbiter.getPendingCount());
+}
+
+void test_lower_priority_waits_then_runs() {
+    arbiter.submit(ServoAction::NOD_DOWN, MotionSource::REMOTE);
+    TEST_ASSERT_TRUE(arbiter.submit(ServoAction::SHAKE_LEFT, MotionSource::WARNING));
+    TEST_ASSERT_EQUAL(1, arbiter.getPendingCount());
+    TEST_ASSERT_EQUAL((int)MotionSource::REMOTE, (int)ownerOf());
+
+    for (int i = 0; i < 10000 && ownerOf() != MotionSource::WARNING; i++) step(1);
+    TEST_ASSERT_EQUAL((int)MotionSource::WARNING, (int)ownerOf());
+    TEST_ASSERT_EQUAL(0, arbiter.getPendingCount());
+    settle();
+    TEST_ASSERT_EQUAL_UINT32(2, arbiter.getStats().started);
+}
+
+void test_no_preempt_and_zero_ttl_drops() {
+    arbiter.submit(ServoAction::NOD_DOWN, MotionSource::AMBIENT);
+    TEST_ASSERT_FALSE(arbiter.submit(ServoAction::SHAKE_LEFT, MotionSource::REMOTE, MotionPreempt::NONE, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, arbiter.getStats().dropped);
+    TEST_ASSERT_EQUAL((int)MotionSource::AMBIENT, (int)ownerOf());
+}
+
+void test_same_source_keeps_only_latest() {
+    arbiter.submit(ServoAction::NOD_DOWN, MotionSource::REMOTE);
+    arbiter.submit(ServoAction::SHAKE_LEFT, MotionSource::VOICE);
+    arbiter.submit(ServoAction::SHAKE_RIGHT, MotionSource::VOICE);
+    TEST_ASSERT_EQUAL(1, arbiter.getPendingCount());
+    TEST_ASSERT_EQUAL_UINT32(1, arbiter.getStats().superseded);
+}
+
+void test_pending_request_expires() {
+    arbiter.submit(ServoAction::NOD_DOWN, MotionSource::REMOTE);
+    arbiter.submit(ServoAction::SHAKE_LEFT, MotionSource::AMBIENT, MotionPreempt::BLEND, 50);
+    step(50 / TICK_MS + 2);
+    TEST_ASSERT_EQUAL(0, arbiter.getPendingCount());
+    TEST_ASSERT_EQUAL_UINT32(1, arbiter.getStats().expired);
+    settle();
+    TEST_ASSERT_EQUAL_UINT32(1, arbiter.getStats().started);
+}
+
+void test_full_queue_evicts_lowest_priority() {
+    arbiter.submit(ServoAction::NOD_DOWN, MotionSource::REMOTE);
+    // 同一来源只保留一条，用显式优先级填满队列
+    const MotionSource sources[] = {
+        MotionSource::AMBIENT, MotionSource::WARNING, MotionSource::VOICE, MotionSource::REMOTE
+    };
+    for (uint8_t i = 0; i < MOTION_ARBITER_CAPACITY; i++) {
+        TEST_ASSERT_TRUE(arbiter.submit(ServoAction::SHAKE_LEFT, sources[i], MotionPreempt::NONE,
+                                        MOTION_REQUEST_TTL, (uint8_t)(i + 1)));
+    }
+    TEST_ASSERT_EQUAL(MOTION_ARBITER_CAPACITY, arbiter.getPendingCount());
+    // 比最低者还低：拒绝自身
+    TEST_ASSERT_FALSE(arbiter.submit(ServoAction::NOD_UP, MotionSource::COUNT, MotionPreempt::NONE,
+                                     MOTION_REQUEST_TTL, 0));
+    // 比最低者高：挤掉最低者
+    TEST_ASSERT_TRUE(arbiter.submit(ServoAction::NOD_UP, MotionSource::COUNT, MotionPreempt::NONE,
+                                    MOTION_REQUEST_TTL, 9));
+    TEST_ASSERT_EQUAL(MOTION_ARBITER_CAPACITY, arbiter.getPendingCount());
+    TEST_ASSERT_EQUAL_UINT32(2, arbiter.getStats().dropped);
+}
+
+void test_segments_from_owner_chain_and_others_are_refused() {
+    TEST_ASSERT_TRUE(arbiter.submitSegment(ServoAxis::HEAD, 150, 400, MotionSource::WARNING));
+    TEST_ASSERT_TRUE(arbiter.submitSegment(ServoAxis::HEAD, 30, 800, MotionSource::WARNING));
+    TEST_ASSERT_FALSE(arbiter.submitSegment(ServoAxis::NOD, 30, 400, MotionSource::AMBIENT));
+    TEST_ASSERT_TRUE(arbiter.submitSegment(ServoAxis::NOD, 30, 400, MotionSource::VOICE));
+    TEST_ASSERT_EQUAL((int)MotionSource::VOICE, (int)ownerOf());
+    TEST_ASSERT_EQUAL_UINT32(1, arbiter.getStats().preemptions);
+}
+
+void test_segment_target_is_clamped_to_reachable() {
+    // 100ms 内到不了 180 度：截短目标，段时长不被拉长
+    TEST_ASSERT_TRUE(arbiter.submitSegment(ServoAxis::HEAD, 180, 100, MotionSource::VOICE));
+    uint32_t ticks = 0;
+    while (servo.isPerforming() && ticks < 1000) {
+        step(1);
+        ticks++;
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, 100 / TICK_MS, ticks);
+    TEST_ASSERT_TRUE(servo.getHeadPosition() > 90 && servo.getHeadPosition() < 180);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_request_starts_immediately);
+    RUN_TEST(test_higher_priority_preempts_lower);
+    RUN_TEST(test_lower_priority_waits_then_runs);
+    RUN_TEST(test_no_preempt_and_zero_ttl_drops);
+    RUN_TEST(test_same_source_keeps_only_latest);
+    RUN_TEST(test_pending_request_expires);
+    RUN_TEST(test_full_queue_evicts_lowest_priority);
+    RUN_TEST(test_segments_from_owner_chain_and_others_are_refused);
+    RUN_TEST(test_segment_target_is_clamped_to_reachable);
+    return UNITY_END();
+}
@@ -0,0 +1,197 @@
+#include <unity.h>
+#include <vector>
+#include "Servo_Controller.h"
+
+/**
+ * 关键帧队列：段与段首尾相接、容量与入队策略、两轴同步
+ */
+
+static const AxisLimits LIMITS = {SERVO_HEAD_MAX_VELOCITY, SERVO_HEAD_MAX_ACCEL};
+
+// 逐节拍推进直到空闲，返回每个节拍的角度
+static std::vector<float> runTimeline(MotionTimeline& timeline, uint32_t& tick) {
+    std::vector<float> out;
+    float angle;
+    while (timeline.isBusy() && out.size() < 100000) {
+        if (timeline.tick(++tick, angle)) out.push_back(angle);
+    }
+    return out;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_segments_chain_on_the_same_tick() {
+    MotionTimeline timeline;
+    timeline.setLimits(LIMITS);
+    timeline.reset(90);
+    MotionSegment a = {120, 500, MotionProfile::MINIMUM_JERK};
+    MotionSegment b = {60, 800, MotionProfile::MINIMUM_JERK};
+    TEST_ASSERT_TRUE(timeline.push(a));
+    TEST_ASSERT_TRUE(timeline.push(b));
+
+    uint32_t tick = 0;
+    std::vector<float> s = runTimeline(timeline, tick);
+    // 500ms + 800ms，第一段结束的节拍即第二段起点，不多等一个周期
+    TEST_ASSERT_EQUAL(130 + 1, s.size());
+    TEST_ASSERT_EQUAL_FLOAT(120, s[50]);
+    TEST_ASSERT_TRUE(s[51] < 120);
+    TEST_ASSERT_EQUAL_FLOAT(60, s.back());
+}
+
+void test_hold_segment_keeps_position() {
+    MotionTimeline timeline;
+    timeline.setLimits(LIMITS);
+    timeline.reset(45);
+    MotionSegment hold = {MOTION_AXIS_HOLD, 200, MotionProfile::TRAPEZOIDAL};
+    timeline.push(hold);
+    TEST_ASSERT_FALSE(timeline.isInMotion());
+    uint32_t tick = 0;
+    for (float p : runTimeline(timeline, tick)) TEST_ASSERT_EQUAL_FLOAT(45, p);
+    // 入队后的第一个节拍开始，200ms 后结束
+    TEST_ASSERT_EQUAL_UINT32(1 + 20, tick);
+}
+
+void test_push_refuses_when_full() {
+    MotionTimeline timeline;
+    timeline.setLimits(LIMITS);
+    MotionSegment seg = {100, 100, MotionProfile::TRAPEZOIDAL};
+    for (int i = 0; i < MOTION_QUEUE_CAPACITY; i++) TEST_ASSERT_TRUE(timeline.push(seg));
+    TEST_ASSERT_EQUAL(0, timeline.space());
+    TEST_ASSERT_FALSE(timeline.push(seg));
+}
+
+void test_tail_position_and_minimum_duration() {
+    MotionTimeline timeline;
+    timeline.setLimits(LIMITS);
+    timeline.reset(90);
+    MotionSegment seg = {150, 0, MotionProfile::TRAPEZOIDAL};
+    MotionSegment hold = {MOTION_AXIS_HOLD, 100, MotionProfile::TRAPEZOIDAL};
+    timeline.push(seg);
+    timeline.push(hold);
+    TEST_ASSERT_EQUAL_FLOAT(150, timeline.tailPosition());
+    float seconds = ServoTrajectory::minimumDuration(30, MotionProfile::TRAPEZOIDAL, LIMITS);
+    TEST_ASSERT_EQUAL((uint16_t)ceilf(seconds * 1000), timeline.minimumDuration(180, MotionProfile::TRAPEZOIDAL));
+    TEST_ASSERT_EQUAL(0, timeline.minimumDuration(MOTION_AXIS_HOLD, MotionProfile::TRAPEZOIDAL));
+}
+
+void test_interrupt_stops_where_it_is() {
+    MotionTimeline timeline;
+    timeline.setLimits(LIMITS);
+    timeline.reset(0);
+    MotionSegment seg = {180, 0, MotionProfile::MINIMUM_JERK};
+    timeline.push(seg);
+    timeline.push(seg);
+    float angle = 0;
+    for (uint32_t t = 1; t <= 20; t++) timeline.tick(t, angle);
+    timeline.interrupt();
+    timeline.clear();
+    TEST_ASSERT_FALSE(timeline.isBusy());
+    TEST_ASSERT_EQUAL_FLOAT(angle, timeline.getPosition());
+    TEST_ASSERT_TRUE(angle > 0 && angle < 180);
+}
+
+// 控制器：逐节拍推进直到空闲
+static uint32_t runController(ServoController& servo, std::vector<uint16_t>* pulses = nullptr) {
+    uint32_t ticks = 0;
+    while (servo.isPerforming() && ticks < 100000) {
+        servo.tick();
+        ticks++;
+        if (pulses) {
+            pulses->push_back(servo.getHeadPulse());
+            pulses->push_back(servo.getNodPulse());
+        }
+    }
+    return ticks;
+}
+
+void test_actions_during_motion_are_queued_not_dropped() {
+    ServoController servo;
+    servo.begin();
+    TEST_ASSERT_TRUE(servo.performAction(ServoAction::NOD_DOWN));
+    servo.tick();
+    TEST_ASSERT_TRUE(servo.performAction(ServoAction::SHAKE_LEFT));
+    TEST_ASSERT_TRUE(servo.getQueuedFrames() > 0);
+
+    std::vector<uint16_t> pulses;
+    runController(servo, &pulses);
+    // 两个动作都执行过：点头轴离开过中点，摇头轴也离开过中点，最后都回到中点
+    bool nodMoved = false, headMoved = false;
+    uint16_t center = pulses[0];
+    for (size_t i = 0; i < pulses.size(); i += 2) {
+        headMoved |= pulses[i] != center;
+        nodMoved |= pulses[i + 1] != center;
+    }
+    TEST_ASSERT_TRUE(nodMoved);
+    TEST_ASSERT_TRUE(headMoved);
+    TEST_ASSERT_EQUAL(90, servo.getHeadPosition());
+    TEST_ASSERT_EQUAL(90, servo.getNodPosition());
+}
+
+void test_enqueue_refuses_batch_that_does_not_fit() {
+    ServoController servo;
+    servo.begin();
+    MotionKeyframe frames[MOTION_QUEUE_CAPACITY];
+    // 每帧两轴都运动，点头轴每帧多一段错峰等待
+    for (int i = 0; i < MOTION_QUEUE_CAPACITY; i++) {
+        int16_t a = (i % 2) ? 30 : 150;
+        frames[i] = {a, (int16_t)(180 - a), 100, MotionProfile::TRAPEZOIDAL};
+    }
+    TEST_ASSERT_FALSE(servo.enqueueKeyframes(frames, MOTION_QUEUE_CAPACITY));
+    TEST_ASSERT_FALSE(servo.isPerforming());
+
+    uint8_t fits = (MOTION_QUEUE_CAPACITY - 1) / (SERVO_STAGGER_MS > 0 ? 2 : 1);
+    TEST_ASSERT_TRUE(servo.enqueueKeyframes(frames, fits));
+    TEST_ASSERT_FALSE(servo.enqueueKeyframes(frames, 1));
+    // 替换策略丢弃排队中的关键帧，可以装入
+    TEST_ASSERT_TRUE(servo.enqueueKeyframes(frames, 1, MotionQueuePolicy::REPLACE));
+}
+
+void test_axes_finish_each_keyframe_together() {
+    ServoController servo;
+    servo.begin();
+    // 摇头轴位移远大于点头轴；各自最快时到位时刻相差约 40 个节拍
+    MotionKeyframe frame = {170, 100, 0, MotionProfile::MINIMUM_JERK};
+    servo.enqueueKeyframe(frame);
+    uint16_t head = servo.getHeadPulse(), nod = servo.getNodPulse();
+    uint32_t headLast = 0, nodLast = 0;
+    for (uint32_t t = 1; servo.isPerforming(); t++) {
+        servo.tick();
+        if (servo.getHeadPulse() != head) headLast = t;
+        if (servo.getNodPulse() != nod) nodLast = t;
+        head = servo.getHeadPulse();
+        nod = servo.getNodPulse();
+    }
+    TEST_ASSERT_EQUAL(170, servo.getHeadPosition());
+    TEST_ASSERT_EQUAL(100, servo.getNodPosition());
+    // 脉宽按微秒量化，末端最后几个节拍的变化可能小于 1us
+    TEST_ASSERT_UINT32_WITHIN(3, headLast, nodLast);
+}
+
+void test_same_sequence_is_repeatable() {
+    std::vector<uint16_t> runs[2];
+    for (std::vector<uint16_t>& pulses : runs) {
+        ServoController servo;
+        servo.begin();
+        servo.performAction(ServoAction::NOD_UP);
+        servo.performAction(ServoAction::NOD_DOWN);
+        servo.performAction(ServoAction::SHAKE_RIGHT);
+        runController(servo, &pulses);
+    }
+    TEST_ASSERT_EQUAL(runs[0].size(), runs[1].size());
+    TEST_ASSERT_TRUE(runs[0] == runs[1]);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_segments_chain_on_the_same_tick);
+    RUN_TEST(test_hold_segment_keeps_position);
+    RUN_TEST(test_push_refuses_when_full);
+    RUN_TEST(test_tail_position_and_minimum_duration);
+    RUN_TEST(test_interrupt_stops_where_it_is);
+    RUN_TEST(test_actions_during_motion_are_queued_not_dropped);
+    RUN_TEST(test_enqueue_refuses_batch_that_does_not_fit);
+    RUN_TEST(test_axes_finish_each_keyframe_together);
+    RUN_TEST(test_same_sequence_is_repeatable);
+    return UNITY_END();
+}
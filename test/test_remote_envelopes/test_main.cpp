@@ -0,0 +1,198 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <WiFiClient.h>
+#include <PubSubClient.h>
+#include "MQTT_Manager.h"
+#include "Remote_Control.h"
+
+/**
+ * 远程指令包经替身服务器往返：整包在一次 update() 中执行并回复 ack，
+ * 无效指令包一条也不执行，重发的 ID 不再执行而按首次结果回复，
+ * 以及回复丢失时发送端超时重发、每个指令包恰好执行一次
+ */
+
+struct Rig {
+    WiFiClient client;
+    MQTTManager mqtt;
+    RemoteControlModule remote;
+    std::vector<RemoteControlData> executed;
+    bool servoBusy = false;
+
+    Rig() : mqtt(client) {}
+};
+
+static Rig* rig;
+
+// 与 main.cpp 的 onMQTTMessage 相同的接线
+static void onMessage(const char* topic, const uint8_t* payload, unsigned int length) {
+    if (strcmp(topic, MQTT_TOPIC_CONTROL) == 0) {
+        char reply[96];
+        rig->remote.handleMQTTMessage(payload, length, reply, sizeof(reply));
+        if (reply[0] != '\0') {
+            rig->mqtt.publishJSON(reply);
+        }
+    }
+}
+
+// 舵机被占用时拒绝舵机指令，其余照常执行
+static bool execute(const RemoteControlData& cmd) {
+    rig->executed.push_back(cmd);
+    return !(rig->servoBusy && cmd.command == RemoteCommand::MOVE_SERVO);
+}
+
+void setUp() {
+    rig = new Rig();
+    rig->mqtt.begin("broker", 1883);
+    rig->mqtt.setMessageHandler(onMessage);
+    rig->remote.setCommandHandler(execute);
+    PubSubClient::instance->online = true;
+    TEST_ASSERT_TRUE(rig->mqtt.connect());
+}
+
+void tearDown() {
+    delete rig;
+}
+
+/**
+ * 服务器投递一条控制消息，设备处理一次，返回设备发出的 ack（没有时为空串）
+ */
+static std::string roundTrip(const std::string& payload) {
+    PubSubClient* broker = PubSubClient::instance;
+    broker->inbox.push_back({MQTT_TOPIC_CONTROL, payload});
+    broker->sent.clear();
+    rig->mqtt.update();
+    for (const PubSubClient::Message& m : broker->sent) {
+        if (m.payload.find("\"ack\"") != std::string::npos) {
+            return m.payload;
+        }
+    }
+    return std::string();
+}
+
+static const char* const BATCH =
+    "{\"id\":\"a17\",\"cmds\":[{\"cmd\":\"emotion\",\"emotion\":\"happy\"},"
+    "{\"cmd\":\"servo\",\"action\":\"nod_up\",\"angle\":120},{\"cmd\":\"mode\",\"mode\":\"quiet\"}]}";
+
+void test_batch_executes_in_one_update_and_acks() {
+    std::string ack = roundTrip(BATCH);
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":\"a17\",\"result\":\"ok\",\"count\":3,\"failed\":0}", ack.c_str());
+
+    TEST_ASSERT_EQUAL_size_t(3, rig->executed.size());
+    TEST_ASSERT_EQUAL((int)RemoteCommand::SET_EMOTION, (int)rig->executed[0].command);
+    TEST_ASSERT_EQUAL((int)EmotionState::HAPPY, (int)rig->executed[0].emotion);
+    TEST_ASSERT_EQUAL((int)ServoAction::NOD_UP, (int)rig->executed[1].servoAction);
+    TEST_ASSERT_EQUAL_UINT16(120, rig->executed[1].servoAngle);
+    TEST_ASSERT_EQUAL((int)RemoteMode::QUIET, (int)rig->executed[2].mode);
+    TEST_ASSERT_EQUAL_UINT16(3, rig->remote.getCommandCount());
+}
+
+void test_duplicate_id_replays_first_result() {
+    rig->servoBusy = true;
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":\"a17\",\"result\":\"ok\",\"count\":3,\"failed\":2}", roundTrip(BATCH).c_str());
+
+    // 重发时舵机已空闲，但不再执行，仍回复首次的 failed 位图
+    rig->servoBusy = false;
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":\"a17\",\"result\":\"duplicate\",\"count\":3,\"failed\":2}",
+                             roundTrip(BATCH).c_str());
+    TEST_ASSERT_EQUAL_size_t(3, rig->executed.size());
+
+    // 数字 ID 与字符串 ID 同样记录
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":\"42\",\"result\":\"ok\",\"count\":1,\"failed\":0}",
+                             roundTrip("{\"id\":42,\"cmds\":[{\"cmd\":\"status\"}]}").c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":\"42\",\"result\":\"duplicate\",\"count\":1,\"failed\":0}",
+                             roundTrip("{\"id\":42,\"cmds\":[{\"cmd\":\"status\"}]}").c_str());
+    TEST_ASSERT_EQUAL_size_t(4, rig->executed.size());
+}
+
+void test_invalid_envelope_executes_nothing() {
+    const char* bad = "{\"id\":\"b1\",\"cmds\":[{\"cmd\":\"emotion\",\"emotion\":\"happy\"},"
+                      "{\"cmd\":\"servo\",\"action\":\"nod_up\",\"angle\":200}]}";
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":\"b1\",\"result\":\"invalid\",\"index\":1}", roundTrip(bad).c_str());
+    TEST_ASSERT_EQUAL_size_t(0, rig->executed.size());
+
+    // 被拒绝的 ID 不记录：改正后用同一 ID 重发会执行
+    const char* fixed = "{\"id\":\"b1\",\"cmds\":[{\"cmd\":\"emotion\",\"emotion\":\"happy\"},"
+                        "{\"cmd\":\"servo\",\"action\":\"nod_up\",\"angle\":100}]}";
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":\"b1\",\"result\":\"ok\",\"count\":2,\"failed\":0}", roundTrip(fixed).c_str());
+    TEST_ASSERT_EQUAL_size_t(2, rig->executed.size());
+
+    std::string many = "{\"id\":\"b2\",\"cmds\":[";
+    for (int i = 0; i <= REMOTE_BATCH_MAX; i++) {
+        many += i ? ",{\"cmd\":\"status\"}" : "{\"cmd\":\"status\"}";
+    }
+    many += "]}";
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":\"b2\",\"result\":\"too_many\"}", roundTrip(many).c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":null,\"result\":\"bad_id\"}",
+                             roundTrip("{\"id\":\"a b\",\"cmd\":\"status\"}").c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":null,\"result\":\"parse_error\"}",
+                             roundTrip("{\"id\":\"b3\",\"cmds\":[").c_str());
+    TEST_ASSERT_EQUAL_size_t(2, rig->executed.size());
+}
+
+void test_single_command_without_id_sends_no_ack() {
+    TEST_ASSERT_EQUAL_STRING("", roundTrip("{\"cmd\":\"emotion\",\"emotion\":\"SAD\"}").c_str());
+    TEST_ASSERT_EQUAL_size_t(1, rig->executed.size());
+    TEST_ASSERT_EQUAL((int)EmotionState::SAD, (int)rig->executed[0].emotion);
+    // 没有 ID 的命令不去重
+    roundTrip("{\"cmd\":\"emotion\",\"emotion\":\"SAD\"}");
+    TEST_ASSERT_EQUAL_size_t(2, rig->executed.size());
+}
+
+void test_history_window_forgets_oldest_id() {
+    char envelope[96];
+    for (int i = 0; i <= REMOTE_ID_HISTORY; i++) {
+        snprintf(envelope, sizeof(envelope), "{\"id\":\"w%d\",\"cmd\":\"status\"}", i);
+        TEST_ASSERT_TRUE(roundTrip(envelope).find("\"ok\"") != std::string::npos);
+    }
+    // w0 已被挤出，w1 仍在窗口内
+    TEST_ASSERT_TRUE(roundTrip("{\"id\":\"w1\",\"cmd\":\"status\"}").find("\"duplicate\"") != std::string::npos);
+    TEST_ASSERT_TRUE(roundTrip("{\"id\":\"w0\",\"cmd\":\"status\"}").find("\"ok\"") != std::string::npos);
+    TEST_ASSERT_EQUAL_size_t(REMOTE_ID_HISTORY + 2, rig->executed.size());
+}
+
+/**
+ * 链路丢失 ack：发送端没收到回复就用同一 ID 重发，直到收到 ack；
+ * 每个指令包恰好执行一次
+ */
+void test_retry_until_ack_executes_once() {
+    uint32_t seed = 99;
+    auto lost = [&]() {
+        seed = seed * 1664525UL + 1013904223UL;
+        return (seed >> 24) % 3 != 0;       // 约三分之二的回复丢失
+    };
+
+    const int ENVELOPES = 40;
+    int sends = 0, duplicates = 0;
+    char envelope[160];
+    for (int i = 0; i < ENVELOPES; i++) {
+        snprintf(envelope, sizeof(envelope),
+                 "{\"id\":\"r%d\",\"cmds\":[{\"cmd\":\"emotion\",\"emotion\":\"angry\"},{\"cmd\":\"status\"}]}", i);
+        while (true) {
+            std::string ack = roundTrip(envelope);
+            sends++;
+            TEST_ASSERT_FALSE(ack.empty());
+            if (ack.find("\"duplicate\"") != std::string::npos) {
+                duplicates++;
+            }
+            if (!lost()) {
+                TEST_ASSERT_TRUE(ack.find("\"count\":2") != std::string::npos);
+                break;
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_size_t(2 * ENVELOPES, rig->executed.size());
+    TEST_ASSERT_EQUAL(sends - ENVELOPES, duplicates);
+    TEST_ASSERT_TRUE(duplicates > 0);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_executes_in_one_update_and_acks);
+    RUN_TEST(test_duplicate_id_replays_first_result);
+    RUN_TEST(test_invalid_envelope_executes_nothing);
+    RUN_TEST(test_single_command_without_id_sends_no_ack);
+    RUN_TEST(test_history_window_forgets_oldest_id);
+    RUN_TEST(test_retry_until_ack_executes_once);
+    return UNITY_END();
+}
@@ -0,0 +1,324 @@
+#include <unity.h>
+#include <DHT.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <vector>
+#include "Input_Trace.h"
+#include "Deferred_Log.h"
+
+/**
+ * 输入录制与回放：驱动整个固件（setup()/loop()），随机外部输入录制一段，
+ * 从日志流中提取输入记录，再在新进程中回放并比较检查点
+ *
+ * 固件的全局对象只能初始化一次，录制与回放各在一个子进程中运行，结果经管道传回
+ * 设置 REPLAY_TRACE=<回放文件> 时回放该文件并打印耗时报告（见 tools/replay_report.py）
+ */
+
+void setup();
+void loop();
+
+static const uint32_t RECORD_MS = 120000;
+static const uint32_t RECORD_SEED = 7;
+
+// ==================== 驱动 ====================
+
+/**
+ * 回放时设置 millis()
+ */
+static void setClock(uint32_t now) {
+    hostSetMillis(now);
+}
+
+/**
+ * 取走本次 loop() 产生的日志字节（模拟 DMA 传输完成）
+ */
+static void drainLog(std::vector<uint8_t>* capture) {
+    uint8_t chunk[512];
+    size_t n;
+    while ((n = DeferredLog::hostTransmit(chunk, sizeof(chunk))) > 0) {
+        if (capture) {
+            capture->insert(capture->end(), chunk, chunk + n);
+        }
+    }
+}
+
+/**
+ * 固定种子的外部世界：温湿度变化、语音、WiFi 掉线、云端指令
+ */
+struct World {
+    uint32_t state;
+
+    explicit World(uint32_t seed) : state(seed) {}
+
+    uint32_t next() {
+        state = state * 1664525UL + 1013904223UL;
+        return state >> 8;
+    }
+
+    void step() {
+        static const char* const WORDS[] = {"happy\n", "nod\n", "shake\n", "sad\n", "sleepy\n"};
+        if (next() % 2000 == 0) {
+            uint32_t r = next() % 4;
+            DHT::temperature = r == 0 ? 35.0f : r == 1 ? 5.0f : 24.0f + (float)(next() % 3);
+            DHT::humidity = next() % 4 == 0 ? 90.0f : 50.0f;
+        }
+        if (next() % 800 == 0) {
+            UART_ASRPRO.rx += WORDS[next() % 5];
+        }
+        if (next() % 5000 == 0) {
+            WiFi.linkStatus = WiFi.linkStatus == WL_CONNECTED ? WL_DISCONNECTED : WL_CONNECTED;
+        }
+        PubSubClient* broker = PubSubClient::instance;
+        broker->online = WiFi.linkStatus == WL_CONNECTED;
+        if (broker->online && next() % 3000 == 0) {
+            char message[160];
+            snprintf(message, sizeof(message),
+                     "{\"id\":\"r%lu\",\"cmds\":[{\"cmd\":\"emotion\",\"emotion\":\"happy\"},"
+                     "{\"cmd\":\"servo\",\"action\":\"nod_up\"},{\"cmd\":\"status\"}]}",
+                     (unsigned long)(next() % 100));
+            broker->inbox.push_back({MQTT_TOPIC_CONTROL, message});
+        }
+        hostAdvanceMillis(next() % 3);    // loop() 之间的抖动
+    }
+};
+
+// ==================== 子进程 ====================
+
+static bool writeAll(int fd, const void* data, size_t length) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (length > 0) {
+        ssize_t n = write(fd, p, length);
+        if (n <= 0) return false;
+        p += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * 在子进程中运行 body，返回其写入管道的全部字节
+ */
+template <class Body>
+static std::vector<uint8_t> runIsolated(Body body) {
+    int fds[2];
+    std::vector<uint8_t> result;
+    if (pipe(fds) != 0) return result;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        std::vector<uint8_t> out = body();
+        _exit(writeAll(fds[1], out.data(), out.size()) ? 0 : 1);
+    }
+    close(fds[1]);
+    uint8_t chunk[4096];
+    ssize_t n;
+    while ((n = read(fds[0], chunk, sizeof(chunk))) > 0) {
+        result.insert(result.end(), chunk, chunk + n);
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return result;
+}
+
+/**
+ * 录制：返回日志串口输出的原始字节
+ */
+static std::vector<uint8_t> record(uint32_t durationMs, uint32_t seed) {
+    return runIsolated([=]() {
+        std::vector<uint8_t> capture;
+        World world(seed);
+        hostSetMillis(12);
+        setup();
+        drainLog(&capture);
+        while (millis() < durationMs) {
+            world.step();
+            loop();
+            drainLog(&capture);
+        }
+        return capture;
+    });
+}
+
+/**
+ * 回放：返回 InputReplayStats
+ */
+static InputReplayStats replay(const std::vector<uint8_t>& trace) {
+    std::vector<uint8_t> out = runIsolated([&]() {
+        g_inputTrace.beginReplay(trace.data(), trace.size(), setClock);
+        hostSetMillis(0);
+        setup();
+        drainLog(nullptr);
+        while (!g_inputTrace.getReplayStats().finished) {
+            loop();
+            drainLog(nullptr);
+        }
+        const InputReplayStats& stats = g_inputTrace.getReplayStats();
+        const uint8_t* p = (const uint8_t*)&stats;
+        return std::vector<uint8_t>(p, p + sizeof(stats));
+    });
+    InputReplayStats stats{};
+    if (out.size() == sizeof(stats)) {
+        memcpy(&stats, out.data(), sizeof(stats));
+    }
+    return stats;
+}
+
+// ==================== 回放文件 ====================
+
+static bool cobsDecode(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < in.size()) {
+        uint8_t code = in[i];
+        if (code == 0 || i + code > in.size() + 1) return false;
+        out.insert(out.end(), in.begin() + i + 1, in.begin() + std::min(i + code, in.size()));
+        i += code;
+        if (code < 0xFF && i < in.size()) out.push_back(0);
+    }
+    return true;
+}
+
+/**
+ * 与 tools/log_decoder.py --extract-inputs 相同：按 0x00 切帧、COBS 解码，
+ * 输入帧写成 [长度][帧] 序列
+ */
+static std::vector<uint8_t> extractInputs(const std::vector<uint8_t>& capture) {
+    std::vector<uint8_t> trace;
+    std::vector<uint8_t> encoded, frame;
+    for (uint8_t b : capture) {
+        if (b != 0) {
+            encoded.push_back(b);
+            continue;
+        }
+        if (!encoded.empty() && cobsDecode(encoded, frame) && frame.size() >= 9 && frame.size() <= 0xFF) {
+            uint32_t fid = (uint32_t)frame[1] | ((uint32_t)frame[2] << 8) |
+                           ((uint32_t)frame[3] << 16) | ((uint32_t)frame[4] << 24);
+            if (fid == LOG_ID_INPUT) {
+                trace.push_back((uint8_t)frame.size());
+                trace.insert(trace.end(), frame.begin(), frame.end());
+            }
+        }
+        encoded.clear();
+    }
+    return trace;
+}
+
+/**
+ * 依次访问回放文件中的记录：kind 与内容（不含日志帧头）
+ */
+template <class Visit>
+static void forEachRecord(std::vector<uint8_t>& trace, Visit visit) {
+    for (size_t i = 0; i + 1 < trace.size(); i += 1 + trace[i]) {
+        uint8_t length = trace[i];
+        if (length > 9) {
+            visit((InputRecordKind)trace[i + 10], &trace[i + 11], (size_t)(length - 10));
+        }
+    }
+}
+
+static std::vector<uint8_t> loadFile(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* f = fopen(path, "rb");
+    if (!f) return data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(f);
+    return data;
+}
+
+/**
+ * 耗时报告，tools/replay_report.py 按此格式解析
+ */
+static void report(const InputReplayStats& s) {
+    char line[256];
+    snprintf(line, sizeof(line),
+             "[Replay] loops=%lu records=%lu mismatches=%lu skipped=%lu checkpoints=%lu failures=%lu "
+             "first=%lu sim=%lums wall=%luus speedup=%.0fx",
+             (unsigned long)s.loops, (unsigned long)s.records, (unsigned long)s.mismatches,
+             (unsigned long)s.skipped, (unsigned long)s.checkpoints, (unsigned long)s.checkpointFailures,
+             (unsigned long)s.firstFailureTime, (unsigned long)s.simulatedMs, (unsigned long)s.wallUs,
+             s.wallUs ? s.simulatedMs * 1000.0 / s.wallUs : 0.0);
+    TEST_MESSAGE(line);
+}
+
+// ==================== 测试 ====================
+
+static std::vector<uint8_t> recorded;   // 各测试共用一次录制
+
+void setUp() {
+    if (recorded.empty()) {
+        recorded = extractInputs(record(RECORD_MS, RECORD_SEED));
+    }
+}
+
+void tearDown() {}
+
+void test_recording_contains_inputs() {
+    uint32_t counts[(uint8_t)InputRecordKind::CONFIG + 1] = {};
+    forEachRecord(recorded, [&](InputRecordKind kind, uint8_t*, size_t) {
+        if ((uint8_t)kind <= (uint8_t)InputRecordKind::CONFIG) counts[(uint8_t)kind]++;
+    });
+    TEST_ASSERT_TRUE(counts[(uint8_t)InputRecordKind::LOOP] > 0);
+    TEST_ASSERT_TRUE(counts[(uint8_t)InputRecordKind::DHT] > 0);
+    TEST_ASSERT_TRUE(counts[(uint8_t)InputRecordKind::CHECKPOINT] > 0);
+    TEST_ASSERT_TRUE(counts[(uint8_t)InputRecordKind::CONFIG] > 0);
+}
+
+void test_replay_reproduces_outputs() {
+    InputReplayStats s = replay(recorded);
+    report(s);
+    TEST_ASSERT_TRUE(s.finished);
+    TEST_ASSERT_TRUE(s.loops > 0);
+    TEST_ASSERT_TRUE(s.checkpoints > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, s.mismatches);
+    TEST_ASSERT_EQUAL_UINT32(0, s.skipped);
+    TEST_ASSERT_EQUAL_UINT32(0, s.checkpointFailures);
+    // 从 setup() 之后的第一次 loop() 算起
+    TEST_ASSERT_TRUE(s.simulatedMs > RECORD_MS - 5000 && s.simulatedMs <= RECORD_MS);
+}
+
+void test_tampered_input_is_detected() {
+    // 把所有温度读数改成高温：状态机进入警告，输出摘要与录制不一致
+    std::vector<uint8_t> tampered = recorded;
+    forEachRecord(tampered, [](InputRecordKind kind, uint8_t* payload, size_t length) {
+        if (kind == InputRecordKind::DHT && length >= 4) {
+            float hot = TEMP_HIGH_THRESHOLD + 10;
+            memcpy(payload, &hot, sizeof(hot));
+        }
+    });
+    InputReplayStats s = replay(tampered);
+    TEST_ASSERT_TRUE(s.finished);
+    TEST_ASSERT_TRUE(s.checkpointFailures > 0);
+    TEST_ASSERT_TRUE(s.firstFailureTime > 0);
+}
+
+void test_replay_external_trace() {
+    const char* path = getenv("REPLAY_TRACE");
+    if (!path) {
+        TEST_IGNORE_MESSAGE("REPLAY_TRACE not set");
+    }
+    std::vector<uint8_t> trace = loadFile(path);
+    TEST_ASSERT_TRUE_MESSAGE(!trace.empty(), "cannot read REPLAY_TRACE");
+    InputReplayStats s = replay(trace);
+    report(s);
+    TEST_ASSERT_TRUE(s.finished);
+    TEST_ASSERT_EQUAL_UINT32(0, s.checkpointFailures);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_recording_contains_inputs);
+    RUN_TEST(test_replay_reproduces_outputs);
+    RUN_TEST(test_tampered_input_is_detected);
+    RUN_TEST(test_replay_external_trace);
+    return UNITY_END();
+}
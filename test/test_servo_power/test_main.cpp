@@ -0,0 +1,166 @@
+#include <unity.h>
+#include <random>
+#include "Servo_Controller.h"
+
+/**
+ * 舵机功耗管理：空闲关闭 PWM、唤醒保持、两轴错峰与能耗统计，
+ * 以及典型使用下每天 PWM 输出时长（与常开对照）
+ */
+
+static const uint32_t TICK_MS = 1000 / SERVO_UPDATE_RATE_HZ;
+
+// 按节拍推进时间线与主循环
+static void step(ServoController& servo, uint32_t ticks) {
+    for (uint32_t i = 0; i < ticks; i++) {
+        servo.tick();
+        hostAdvanceMillis(TICK_MS);
+        servo.update();
+    }
+}
+
+// 推进到动作结束
+static uint32_t finish(ServoController& servo) {
+    uint32_t ticks = 0;
+    while (servo.isPerforming() && ticks < 100000) {
+        step(servo, 1);
+        ticks++;
+    }
+    step(servo, 1);
+    return ticks;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_pwm_gated_after_idle_timeout() {
+    ServoController servo;
+    servo.begin();
+    servo.performAction(ServoAction::NOD_DOWN);
+    finish(servo);
+    TEST_ASSERT_TRUE(servo.isPowered());
+
+    // finish() 比最后一个忙碌节拍多走了两拍
+    step(servo, SERVO_IDLE_DETACH_MS / TICK_MS - 3);
+    TEST_ASSERT_TRUE(servo.isPowered());
+    step(servo, 1);
+    TEST_ASSERT_FALSE(servo.isPowered());
+    TEST_ASSERT_EQUAL_UINT32(1, servo.getPowerStats().detachCount);
+
+    // 关闭后硬件不再输出脉冲，输出时长不再累计
+    ServoPWMBackend::hostUpdateEvent();
+    TEST_ASSERT_EQUAL_UINT32(0, ServoPWMBackend::hostActivePulse(0));
+    uint32_t active = servo.getPowerStats().activeTime;
+    step(servo, 100);
+    TEST_ASSERT_EQUAL_UINT32(active, servo.getPowerStats().activeTime);
+}
+
+void test_wake_holds_position_before_moving() {
+    ServoController servo;
+    servo.begin();
+    step(servo, SERVO_IDLE_DETACH_MS / TICK_MS + 1);
+    TEST_ASSERT_FALSE(servo.isPowered());
+
+    uint16_t rest = servo.getHeadPulse();
+    TEST_ASSERT_TRUE(servo.performAction(ServoAction::SHAKE_LEFT));
+    TEST_ASSERT_TRUE(servo.isPowered());
+    // 唤醒保持段内保持原脉宽，之后才开始运动
+    for (uint32_t t = 0; t < SERVO_WAKE_LEAD_MS / TICK_MS; t++) {
+        step(servo, 1);
+        TEST_ASSERT_EQUAL(rest, servo.getHeadPulse());
+    }
+    // 最小加加速度曲线起步很缓，多走几拍才超过 1us
+    step(servo, 5);
+    TEST_ASSERT_NOT_EQUAL(rest, servo.getHeadPulse());
+}
+
+void test_two_axis_moves_are_staggered() {
+    ServoController servo;
+    servo.begin();
+    uint16_t head0 = servo.getHeadPulse(), nod0 = servo.getNodPulse();
+    MotionKeyframe frame = {150, 40, 0, MotionProfile::MINIMUM_JERK};
+    servo.enqueueKeyframe(frame);
+
+    uint32_t headStart = 0, nodStart = 0;
+    for (uint32_t t = 1; servo.isPerforming() && t < 1000; t++) {
+        step(servo, 1);
+        if (!headStart && servo.getHeadPulse() != head0) headStart = t;
+        if (!nodStart && servo.getNodPulse() != nod0) nodStart = t;
+    }
+    TEST_ASSERT_NOT_EQUAL(0, headStart);
+    TEST_ASSERT_UINT32_WITHIN(1, headStart + SERVO_STAGGER_MS / TICK_MS, nodStart);
+
+    // 单轴运动不错峰
+    servo.enqueueKeyframe({MOTION_AXIS_HOLD, 120, 0, MotionProfile::MINIMUM_JERK});
+    uint16_t nod1 = servo.getNodPulse();
+    step(servo, 5);
+    TEST_ASSERT_NOT_EQUAL(nod1, servo.getNodPulse());
+}
+
+void test_stagger_lowers_peak_current() {
+    // 同一动作拆成两轴同时起步（两条单轴指令）与错峰关键帧比较
+    ServoController together;
+    together.begin();
+    together.enqueueAxis(ServoAxis::HEAD, 170, 0, MotionProfile::MINIMUM_JERK);
+    together.enqueueAxis(ServoAxis::NOD, 10, 0, MotionProfile::MINIMUM_JERK);
+    finish(together);
+
+    ServoController staggered;
+    staggered.begin();
+    staggered.enqueueKeyframe({170, 10, 0, MotionProfile::MINIMUM_JERK});
+    finish(staggered);
+
+    const ServoPowerStats& a = together.getPowerStats();
+    const ServoPowerStats& b = staggered.getPowerStats();
+    TEST_ASSERT_TRUE(a.lastActionPeakCurrent > 0);
+    TEST_ASSERT_TRUE(b.lastActionPeakCurrent < a.lastActionPeakCurrent);
+    TEST_ASSERT_TRUE(b.lastActionEnergy > 0);
+    TEST_ASSERT_TRUE(b.lastActionTime > 0);
+}
+
+/**
+ * 按平均每 2 分钟一个动作模拟一小时，换算为每天 PWM 输出时长与保持电荷
+ * 关闭前的实现 PWM 始终输出，每天 24 小时
+ */
+void test_pwm_active_time_per_day_report() {
+    ServoController servo;
+    servo.begin();
+    std::mt19937 rng(35);
+    const ServoAction ACTIONS[] = {
+        ServoAction::NOD_UP, ServoAction::NOD_DOWN, ServoAction::SHAKE_LEFT, ServoAction::SHAKE_RIGHT
+    };
+    const uint32_t HOUR_TICKS = 3600000UL / TICK_MS;
+    uint32_t actions = 0;
+    for (uint32_t t = 0; t < HOUR_TICKS; t++) {
+        if (rng() % (120000 / TICK_MS) == 0 && !servo.isPerforming()) {
+            servo.performAction(ACTIONS[rng() % 4]);
+            actions++;
+        }
+        step(servo, 1);
+    }
+
+    const ServoPowerStats& stats = servo.getPowerStats();
+    double activeHoursPerDay = stats.activeTime * 24.0 / 3600000.0;
+    TEST_ASSERT_TRUE(actions > 10);
+    TEST_ASSERT_TRUE(stats.activeTime > 0);
+    TEST_ASSERT_TRUE(activeHoursPerDay < 24.0 / 10);
+    TEST_ASSERT_TRUE(stats.detachCount >= actions / 2);
+
+    // 两轴保持电流按 PWM 输出时长计
+    double alwaysOnCharge = 2 * SERVO_HOLD_CURRENT_MA * 24.0;
+    double gatedCharge = 2 * SERVO_HOLD_CURRENT_MA * activeHoursPerDay;
+    char line[160];
+    snprintf(line, sizeof(line), "PWM active per day (%lu actions/h): always on 24.00 h -> gated %.2f h; "
+             "hold charge %.0f -> %.1f mAh/day",
+             (unsigned long)actions, activeHoursPerDay, alwaysOnCharge, gatedCharge);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pwm_gated_after_idle_timeout);
+    RUN_TEST(test_wake_holds_position_before_moving);
+    RUN_TEST(test_two_axis_moves_are_staggered);
+    RUN_TEST(test_stagger_lowers_peak_current);
+    RUN_TEST(test_pwm_active_time_per_day_report);
+    return UNITY_END();
+}
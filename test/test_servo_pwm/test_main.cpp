@@ -0,0 +1,132 @@
+#include <unity.h>
+#include <vector>
+#include "Servo_PWM.h"
+
+/**
+ * 定时器 + DMA 舵机后端：在主机寄存器模型上检查配置、半缓冲区回调与输出延迟
+ */
+
+static uint32_t eventIndex = 0;        // 已模拟的更新事件数
+
+struct Recorder {
+    std::vector<uint32_t> headQueue;    // 回调依次填入的摇头比较值
+    std::vector<uint32_t> filledAt;     // 各帧填充时的事件序号
+    uint32_t nextNod = 1500;
+    uint32_t calls = 0;
+};
+
+static void fill(void* context, uint32_t* head, uint32_t* nod, uint8_t count) {
+    Recorder* r = (Recorder*)context;
+    r->calls++;
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t value = 1000 + (uint32_t)r->headQueue.size();
+        r->headQueue.push_back(value);
+        r->filledAt.push_back(eventIndex);
+        head[i] = value;
+        nod[i] = r->nextNod;
+    }
+}
+
+static ServoPWMBackend backend;
+static Recorder recorder;
+
+void setUp() {
+    recorder = Recorder();
+    backend.begin(1500, 1600, fill, &recorder);
+}
+
+void tearDown() {
+    backend.stop();
+}
+
+void test_timers_are_configured_for_1mhz_frames() {
+    for (uint8_t axis = 0; axis < 2; axis++) {
+        const ServoTimerModel& tim = ServoPWMBackend::hostTimer(axis);
+        TEST_ASSERT_EQUAL_UINT32(84 - 1, tim.PSC);          // 84MHz 主机模型时钟 -> 1MHz
+        TEST_ASSERT_EQUAL_UINT32(1000000UL / SERVO_PWM_FRAME_HZ - 1, tim.ARR);
+        TEST_ASSERT_TRUE(tim.CR1 & 1);                      // CEN
+        TEST_ASSERT_TRUE(tim.CCER & 1);                     // CC1E
+        TEST_ASSERT_EQUAL_UINT32(0x68, tim.CCMR1 & 0xFF);   // PWM 模式 1 + OC1PE
+
+        const ServoDmaStreamModel& stream = ServoPWMBackend::hostDmaStream(axis);
+        TEST_ASSERT_EQUAL_PTR(&tim.CCR1, (void*)stream.PAR);
+        TEST_ASSERT_EQUAL_UINT32(SERVO_DMA_BUFFER_FRAMES, stream.NDTR);
+        TEST_ASSERT_TRUE(stream.CR & 1);                    // EN
+        TEST_ASSERT_TRUE(stream.CR & (1UL << 8));           // CIRC
+    }
+    // 只有摇头数据流开中断
+    TEST_ASSERT_TRUE(ServoPWMBackend::hostDmaStream(0).CR & (1UL << 3));
+    TEST_ASSERT_FALSE(ServoPWMBackend::hostDmaStream(1).CR & (1UL << 3));
+}
+
+void test_initial_pulse_is_output_until_first_refill() {
+    for (uint8_t i = 0; i < SERVO_DMA_HALF_FRAMES; i++) {
+        ServoPWMBackend::hostUpdateEvent();
+        TEST_ASSERT_EQUAL_UINT32(1500, ServoPWMBackend::hostActivePulse(0));
+        TEST_ASSERT_EQUAL_UINT32(1600, ServoPWMBackend::hostActivePulse(1));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, recorder.calls);
+}
+
+void test_every_filled_frame_is_output_once_in_order() {
+    std::vector<uint32_t> output;
+    std::vector<uint32_t> outputAt;
+    uint32_t refills = backend.getRefillCount();     // 计数跨 begin() 累计
+    for (int i = 0; i < 20 * SERVO_DMA_BUFFER_FRAMES; i++) {
+        eventIndex++;
+        ServoPWMBackend::hostUpdateEvent();
+        uint32_t pulse = ServoPWMBackend::hostActivePulse(0);
+        if (pulse != 1500) {
+            output.push_back(pulse);
+            outputAt.push_back(eventIndex);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(40, backend.getRefillCount() - refills);
+    TEST_ASSERT_EQUAL_UINT32(0, backend.getDmaErrorCount());
+    TEST_ASSERT_TRUE(output.size() > 0);
+    for (size_t i = 0; i < output.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(recorder.headQueue[i], output[i]);
+        // 填充到输出：先播完另一半区，再加一帧预装载
+        uint32_t delay = outputAt[i] - recorder.filledAt[i];
+        TEST_ASSERT_TRUE(delay >= SERVO_DMA_HALF_FRAMES + 1);
+        TEST_ASSERT_TRUE(delay <= SERVO_DMA_BUFFER_FRAMES + 1);
+    }
+    TEST_ASSERT_TRUE(recorder.headQueue.size() - output.size() <= SERVO_DMA_BUFFER_FRAMES + 1);
+}
+
+void test_nod_axis_follows_same_frames() {
+    recorder.nextNod = 1234;
+    for (int i = 0; i < 3 * SERVO_DMA_BUFFER_FRAMES; i++) {
+        ServoPWMBackend::hostUpdateEvent();
+    }
+    TEST_ASSERT_EQUAL_UINT32(1234, ServoPWMBackend::hostActivePulse(1));
+}
+
+void test_stop_silences_output_and_callbacks() {
+    ServoPWMBackend::hostUpdateEvent();
+    backend.stop();
+    TEST_ASSERT_FALSE(backend.isRunning());
+    uint32_t calls = recorder.calls;
+    for (int i = 0; i < 2 * SERVO_DMA_BUFFER_FRAMES; i++) {
+        ServoPWMBackend::hostUpdateEvent();
+        TEST_ASSERT_EQUAL_UINT32(0, ServoPWMBackend::hostActivePulse(0));
+        TEST_ASSERT_EQUAL_UINT32(0, ServoPWMBackend::hostActivePulse(1));
+    }
+    TEST_ASSERT_EQUAL_UINT32(calls, recorder.calls);
+
+    // 恢复后立即以给定脉宽输出
+    backend.start(1700, 1800);
+    ServoPWMBackend::hostUpdateEvent();
+    TEST_ASSERT_EQUAL_UINT32(1700, ServoPWMBackend::hostActivePulse(0));
+    TEST_ASSERT_EQUAL_UINT32(1800, ServoPWMBackend::hostActivePulse(1));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_timers_are_configured_for_1mhz_frames);
+    RUN_TEST(test_initial_pulse_is_output_until_first_refill);
+    RUN_TEST(test_every_filled_frame_is_output_once_in_order);
+    RUN_TEST(test_nod_axis_follows_same_frames);
+    RUN_TEST(test_stop_silences_output_and_callbacks);
+    return UNITY_END();
+}
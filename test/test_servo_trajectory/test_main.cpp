@@ -0,0 +1,188 @@
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "Servo_Trajectory.h"
+#include "Servo_Controller.h"
+
+/**
+ * 轨迹规划：按 SERVO_UPDATE_RATE_HZ 采样，检查到位时刻、单调性与速度/加速度限制，
+ * 以及 DMA 半缓冲区中断里 fillFrames() 每帧的耗时
+ */
+
+static const AxisLimits HEAD_LIMITS = {SERVO_HEAD_MAX_VELOCITY, SERVO_HEAD_MAX_ACCEL};
+static const AxisLimits NOD_LIMITS = {SERVO_NOD_MAX_VELOCITY, SERVO_NOD_MAX_ACCEL};
+static const MotionProfile PROFILES[] = {MotionProfile::TRAPEZOIDAL, MotionProfile::MINIMUM_JERK};
+
+// 从 from 规划到 to，逐节拍采样直到停止（第 0 个元素为起点）
+static std::vector<float> run(ServoTrajectory& trajectory, float from, float to,
+                              MotionProfile profile, const AxisLimits& limits,
+                              float minDuration, float* duration = nullptr) {
+    trajectory.reset(from);
+    float planned = trajectory.plan(to, profile, limits, minDuration, 1000);
+    if (duration) *duration = planned;
+    std::vector<float> samples;
+    for (uint32_t tick = 1000; trajectory.isMoving() || samples.empty(); tick++) {
+        samples.push_back(trajectory.sample(tick));
+        if (samples.size() > 10 * SERVO_UPDATE_RATE_HZ) break;
+    }
+    return samples;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_reaches_target_at_planned_duration() {
+    ServoTrajectory trajectory;
+    for (MotionProfile profile : PROFILES) {
+        for (float to : {0.0f, 45.0f, 91.0f, 180.0f}) {
+            float duration = 0;
+            std::vector<float> s = run(trajectory, 90, to, profile, HEAD_LIMITS, 0, &duration);
+            TEST_ASSERT_EQUAL_FLOAT(to, s.back());
+            TEST_ASSERT_EQUAL_FLOAT(to, trajectory.getPosition());
+            // 第一个大于等于 duration 的节拍到位
+            size_t ticks = (size_t)ceilf(duration * SERVO_UPDATE_RATE_HZ - 1e-3f);
+            TEST_ASSERT_EQUAL(ticks + 1, s.size());
+        }
+    }
+}
+
+void test_motion_is_monotonic_without_overshoot() {
+    ServoTrajectory trajectory;
+    for (MotionProfile profile : PROFILES) {
+        for (float to : {10.0f, 170.0f}) {
+            std::vector<float> s = run(trajectory, 90, to, profile, NOD_LIMITS, 0);
+            float sign = to > 90 ? 1.0f : -1.0f;
+            for (size_t i = 1; i < s.size(); i++) {
+                TEST_ASSERT_TRUE(sign * (s[i] - s[i - 1]) >= -1e-4f);
+                TEST_ASSERT_TRUE(sign * (s[i] - to) <= 1e-4f);
+            }
+        }
+    }
+}
+
+void test_velocity_and_acceleration_stay_within_limits() {
+    const float dt = 1.0f / SERVO_UPDATE_RATE_HZ;
+    ServoTrajectory trajectory;
+    for (const AxisLimits* limits : {&HEAD_LIMITS, &NOD_LIMITS}) {
+        for (MotionProfile profile : PROFILES) {
+            for (int distance = 1; distance <= 180; distance += 7) {
+                std::vector<float> s = run(trajectory, 0, (float)distance, profile, *limits, 0);
+                float peakV = 0, peakA = 0;
+                for (size_t i = 1; i < s.size(); i++) {
+                    peakV = fmaxf(peakV, fabsf(s[i] - s[i - 1]) / dt);
+                    if (i >= 2) {
+                        peakA = fmaxf(peakA, fabsf(s[i] - 2 * s[i - 1] + s[i - 2]) / (dt * dt));
+                    }
+                }
+                // 差分把相邻两段平均，留 5% 余量
+                TEST_ASSERT_TRUE(peakV <= limits->maxVelocity * 1.05f);
+                TEST_ASSERT_TRUE(peakA <= limits->maxAcceleration * 1.05f);
+            }
+        }
+    }
+}
+
+void test_requested_duration_stretches_but_never_shortens() {
+    ServoTrajectory trajectory;
+    for (MotionProfile profile : PROFILES) {
+        float fastest = ServoTrajectory::minimumDuration(60, profile, HEAD_LIMITS);
+        float duration = 0;
+
+        std::vector<float> s = run(trajectory, 90, 150, profile, HEAD_LIMITS, 1.0f, &duration);
+        TEST_ASSERT_EQUAL_FLOAT(1.0f, duration);
+        TEST_ASSERT_EQUAL(SERVO_UPDATE_RATE_HZ + 1, s.size());
+
+        run(trajectory, 90, 150, profile, HEAD_LIMITS, fastest / 2, &duration);
+        TEST_ASSERT_EQUAL_FLOAT(fastest, duration);
+    }
+}
+
+void test_trapezoid_switches_to_triangle_for_short_moves() {
+    // 距离不足以加速到最大速度：T = 2·sqrt(d/a)
+    float d = 0.5f * SERVO_HEAD_MAX_VELOCITY * SERVO_HEAD_MAX_VELOCITY / SERVO_HEAD_MAX_ACCEL;
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.0f * sqrtf(d / SERVO_HEAD_MAX_ACCEL),
+                             ServoTrajectory::minimumDuration(d, MotionProfile::TRAPEZOIDAL, HEAD_LIMITS));
+    // 足够长时：T = d/v + v/a
+    float far = 180;
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, far / SERVO_HEAD_MAX_VELOCITY + SERVO_HEAD_MAX_VELOCITY / SERVO_HEAD_MAX_ACCEL,
+                             ServoTrajectory::minimumDuration(far, MotionProfile::TRAPEZOIDAL, HEAD_LIMITS));
+}
+
+void test_hold_keeps_position_for_duration() {
+    ServoTrajectory trajectory;
+    float duration = 0;
+    std::vector<float> s = run(trajectory, 42, 42, MotionProfile::MINIMUM_JERK, HEAD_LIMITS, 0.3f, &duration);
+    TEST_ASSERT_EQUAL_FLOAT(0.3f, duration);
+    TEST_ASSERT_EQUAL(31, s.size());
+    for (float p : s) TEST_ASSERT_EQUAL_FLOAT(42, p);
+
+    // 不指定时长的原地规划不产生运动
+    trajectory.reset(42);
+    trajectory.plan(42, MotionProfile::TRAPEZOIDAL, HEAD_LIMITS, 0, 0);
+    TEST_ASSERT_FALSE(trajectory.isMoving());
+}
+
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+static void emptyFill(void*, uint32_t*, uint32_t*, uint8_t) {}
+
+// 推进 frames 个 PWM 周期，返回耗时（纳秒）
+static double timeFrames(uint32_t frames) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < frames; i++) {
+        ServoPWMBackend::hostUpdateEvent();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+void test_fill_frames_cost() {
+    // 两轴都在做最长的最小加加速度运动，每个半缓冲区都由 fillFrames() 采样轨迹
+    const uint16_t MOVE_MS = 60000;
+    const uint32_t MOVE_FRAMES = (uint32_t)MOVE_MS * SERVO_PWM_FRAME_HZ / 1000;
+    const uint32_t FRAMES = MOVE_FRAMES - MOVE_FRAMES % SERVO_DMA_HALF_FRAMES;
+    const int ROUNDS = 20;
+
+    // 对照：空回调下只有寄存器模型与 DMA 中断分发的开销
+    ServoPWMBackend baseline;
+    baseline.begin(SERVO_PULSE_MIN, SERVO_PULSE_MIN, emptyFill, nullptr);
+    double baselineNs = 0;
+    for (int r = 0; r < ROUNDS; r++) baselineNs += timeFrames(FRAMES);
+    baseline.stop();
+
+    ServoController servo;
+    servo.begin();
+    double totalNs = 0;
+    uint32_t refills = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        int16_t to = (r % 2) ? 0 : 180;
+        TEST_ASSERT_TRUE(servo.enqueueAxis(ServoAxis::HEAD, to, MOVE_MS, MotionProfile::MINIMUM_JERK));
+        TEST_ASSERT_TRUE(servo.enqueueAxis(ServoAxis::NOD, to, MOVE_MS, MotionProfile::MINIMUM_JERK));
+        uint32_t before = ServoPWMBackend::getInstance()->getRefillCount();
+        totalNs += timeFrames(FRAMES);
+        refills += ServoPWMBackend::getInstance()->getRefillCount() - before;
+        TEST_ASSERT_TRUE(servo.isPerforming());
+    }
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS * FRAMES / SERVO_DMA_HALF_FRAMES, refills);
+
+    double frames = (double)ROUNDS * FRAMES;
+    double fillNs = (totalNs - baselineNs) / frames;
+    char line[160];
+    snprintf(line, sizeof(line),
+             "fillFrames: %.1f ns/frame, %.1f ns per %d-frame half buffer (model overhead %.1f ns/frame excluded)",
+             fillNs, fillNs * SERVO_DMA_HALF_FRAMES, SERVO_DMA_HALF_FRAMES, baselineNs / frames);
+    TEST_MESSAGE(line);
+}
+#endif
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_reaches_target_at_planned_duration);
+    RUN_TEST(test_motion_is_monotonic_without_overshoot);
+    RUN_TEST(test_velocity_and_acceleration_stay_within_limits);
+    RUN_TEST(test_requested_duration_stretches_but_never_shortens);
+    RUN_TEST(test_trapezoid_switches_to_triangle_for_short_moves);
+    RUN_TEST(test_hold_keeps_position_for_duration);
+#if SERVO_BACKEND == SERVO_BACKEND_TIMER_DMA
+    RUN_TEST(test_fill_frames_cost);
+#endif
+    return UNITY_END();
+}
@@ -0,0 +1,136 @@
+#include <unity.h>
+#include <string>
+#include "Speech_Output.h"
+
+/**
+ * 语音播报队列：非阻塞发送、优先级、限流、过期与 UTF-8 截断
+ */
+
+static std::string drain(SpeechOutputQueue& queue, unsigned long now) {
+    for (int i = 0; i < 16 && queue.isBusy(); i++) {
+        queue.update(now);
+    }
+    std::string out = UART_ASRPRO.tx;
+    UART_ASRPRO.tx.clear();
+    return out;
+}
+
+// 合法 UTF-8：每个多字节序列都完整
+static bool isValidUtf8(const std::string& s) {
+    size_t i = 0;
+    while (i < s.size()) {
+        uint8_t b = (uint8_t)s[i];
+        size_t n = b < 0x80 ? 1 : (b & 0xE0) == 0xC0 ? 2 : (b & 0xF0) == 0xE0 ? 3 : (b & 0xF8) == 0xF0 ? 4 : 0;
+        if (n == 0 || i + n > s.size()) return false;
+        for (size_t k = 1; k < n; k++) {
+            if (((uint8_t)s[i + k] & 0xC0) != 0x80) return false;
+        }
+        i += n;
+    }
+    return true;
+}
+
+void setUp() {
+    UART_ASRPRO.tx.clear();
+}
+
+void tearDown() {}
+
+void test_sends_text_with_line_end() {
+    SpeechOutputQueue queue;
+    const unsigned long now = SPEECH_MIN_INTERVAL;
+    uint16_t id = queue.speak("今天天气晴", SpeechPriority::NORMAL, now, 5000);
+    TEST_ASSERT_NOT_EQUAL(0, id);
+    TEST_ASSERT_EQUAL_STRING("今天天气晴\n", drain(queue, now).c_str());
+
+    SpeechEvent e;
+    TEST_ASSERT_TRUE(queue.pollEvent(e));
+    TEST_ASSERT_EQUAL(id, e.id);
+    TEST_ASSERT_EQUAL((int)SpeechStatus::COMPLETED, (int)e.status);
+}
+
+void test_newlines_inside_text_become_spaces() {
+    SpeechOutputQueue queue;
+    queue.speak("a\nb\rc", SpeechPriority::ALERT, 0, 5000);
+    TEST_ASSERT_EQUAL_STRING("a b c\n", drain(queue, 0).c_str());
+}
+
+void test_truncation_keeps_utf8_characters_whole() {
+    // 每种前缀长度都让截断点落在不同的字节位置
+    for (int prefix = 0; prefix < 4; prefix++) {
+        std::string text(prefix, 'x');
+        while (text.size() < 2 * SPEECH_TEXT_MAX_LEN) text += "温度";
+        SpeechOutputQueue queue;
+        queue.speak(text.c_str(), SpeechPriority::ALERT, 0, 5000);
+        std::string sent = drain(queue, 0);
+        TEST_ASSERT_EQUAL('\n', sent.back());
+        sent.pop_back();
+        TEST_ASSERT_TRUE(isValidUtf8(sent));
+        TEST_ASSERT_LESS_OR_EQUAL(SPEECH_TEXT_MAX_LEN - 1, sent.size());
+        TEST_ASSERT_GREATER_THAN(SPEECH_TEXT_MAX_LEN - 1 - 3, sent.size());
+        TEST_ASSERT_EQUAL_STRING_LEN(text.c_str(), sent.c_str(), sent.size());
+    }
+}
+
+void test_alert_goes_first_and_bypasses_rate_limit() {
+    SpeechOutputQueue queue;
+    queue.speak("one", SpeechPriority::NORMAL, 0, 5000);
+    queue.speak("two", SpeechPriority::NORMAL, 0, 5000);
+    queue.speak("hot", SpeechPriority::ALERT, 0, 5000);
+    TEST_ASSERT_EQUAL_STRING("hot\n", drain(queue, 0).c_str());
+    // 第二条普通播报受限流约束，要等 SPEECH_MIN_INTERVAL
+    queue.update(SPEECH_MIN_INTERVAL - 1);
+    TEST_ASSERT_EQUAL_STRING("", UART_ASRPRO.tx.c_str());
+    queue.update(SPEECH_MIN_INTERVAL);
+    TEST_ASSERT_EQUAL_STRING("one\n", drain(queue, SPEECH_MIN_INTERVAL).c_str());
+    TEST_ASSERT_EQUAL_STRING("two\n", drain(queue, 2 * SPEECH_MIN_INTERVAL).c_str());
+}
+
+void test_expired_utterance_is_cancelled() {
+    SpeechOutputQueue queue;
+    queue.speak("first", SpeechPriority::ALERT, 0, 5000);
+    uint16_t stale = queue.speak("stale", SpeechPriority::CHATTER, 0, 100);
+    drain(queue, 0);
+    SpeechEvent e;
+    queue.pollEvent(e);
+
+    queue.update(SPEECH_MIN_INTERVAL);
+    TEST_ASSERT_FALSE(queue.isBusy());
+    TEST_ASSERT_TRUE(queue.pollEvent(e));
+    TEST_ASSERT_EQUAL(stale, e.id);
+    TEST_ASSERT_EQUAL((int)SpeechStatus::CANCELLED, (int)e.status);
+    TEST_ASSERT_EQUAL_STRING("", UART_ASRPRO.tx.c_str());
+}
+
+void test_full_queue_drops_oldest_lowest_priority() {
+    SpeechOutputQueue queue;
+    uint16_t chatter = queue.speak("c", SpeechPriority::CHATTER, 0, 5000);
+    for (int i = 1; i < SPEECH_QUEUE_CAPACITY; i++) {
+        queue.speak("n", SpeechPriority::NORMAL, 0, 5000);
+    }
+    // 同优先级挤掉更早的一条
+    uint16_t newer = queue.speak("newer chatter", SpeechPriority::CHATTER, 0, 5000);
+    TEST_ASSERT_NOT_EQUAL(0, newer);
+    SpeechEvent e;
+    TEST_ASSERT_TRUE(queue.pollEvent(e));
+    TEST_ASSERT_EQUAL(chatter, e.id);
+    TEST_ASSERT_EQUAL((int)SpeechStatus::DROPPED, (int)e.status);
+
+    // 高优先级挤掉闲聊；之后队列全是普通播报，闲聊被拒绝
+    TEST_ASSERT_NOT_EQUAL(0, queue.speak("alert", SpeechPriority::ALERT, 0, 5000));
+    TEST_ASSERT_TRUE(queue.pollEvent(e));
+    TEST_ASSERT_EQUAL(newer, e.id);
+    TEST_ASSERT_EQUAL(0, queue.speak("late chatter", SpeechPriority::CHATTER, 0, 5000));
+    TEST_ASSERT_EQUAL_UINT32(3, queue.getStats().dropped);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sends_text_with_line_end);
+    RUN_TEST(test_newlines_inside_text_become_spaces);
+    RUN_TEST(test_truncation_keeps_utf8_characters_whole);
+    RUN_TEST(test_alert_goes_first_and_bypasses_rate_limit);
+    RUN_TEST(test_expired_utterance_is_cancelled);
+    RUN_TEST(test_full_queue_drops_oldest_lowest_priority);
+    return UNITY_END();
+}
@@ -0,0 +1,269 @@
+#include <unity.h>
+#include <random>
+#include "State_Machine.h"
+
+/**
+ * 状态机：表驱动转移（含父状态继承与内部转移）、单次/周期定时器、按需重绘与转移记录，
+ * 以及随机环境与语音输入下每小时的重绘次数（与旧的逐周期重绘对照）
+ */
+
+static const uint32_t TICK_MS = 1000 / SERVO_UPDATE_RATE_HZ;
+
+struct Rig {
+    OLEDDisplay display;
+    ServoController servo;
+    DHTManager dht;
+    ASRPROModule asr;
+    MotionArbiter motion;
+    StateMachine fsm;
+
+    void begin() {
+        DHT::temperature = 24.0f;
+        DHT::humidity = 50.0f;
+        display.begin();
+        servo.begin();
+        dht.begin();
+        dht.read();
+        motion.begin(&servo);
+        fsm.begin(&display, &servo, &dht, &asr, &motion);
+    }
+
+    // 按舵机节拍推进主循环
+    void run(uint32_t ms) {
+        for (uint32_t t = 0; t < ms; t += TICK_MS) {
+            servo.tick();
+            hostAdvanceMillis(TICK_MS);
+            dht.read();
+            motion.update();
+            fsm.update();
+        }
+    }
+
+    // 推进到状态变化，返回用时（毫秒）
+    uint32_t runUntilLeaves(SystemState state, uint32_t limit = 60000) {
+        uint32_t elapsed = 0;
+        while (fsm.getCurrentState() == state && elapsed < limit) {
+            run(TICK_MS);
+            elapsed += TICK_MS;
+        }
+        return elapsed;
+    }
+};
+
+static Rig* rig;
+
+static SystemState state() {
+    return rig->fsm.getCurrentState();
+}
+
+void setUp() {
+    rig = new Rig();
+    rig->begin();
+}
+
+void tearDown() {
+    delete rig;
+}
+
+void test_idle_times_out_into_monitoring() {
+    TEST_ASSERT_EQUAL((int)SystemState::IDLE, (int)state());
+    TEST_ASSERT_UINT32_WITHIN(TICK_MS, 3000, rig->runUntilLeaves(SystemState::IDLE));
+    TEST_ASSERT_EQUAL((int)SystemState::MONITORING, (int)state());
+    TEST_ASSERT_EQUAL((int)SystemState::IDLE, (int)rig->fsm.getPreviousState());
+}
+
+void test_unhandled_event_is_ignored() {
+    TEST_ASSERT_FALSE(rig->fsm.dispatch(FsmEvent::ENV_NORMAL));
+    TEST_ASSERT_FALSE(rig->fsm.dispatch(FsmEvent::REFRESH));
+    TEST_ASSERT_EQUAL((int)SystemState::IDLE, (int)state());
+    TEST_ASSERT_EQUAL(0, rig->fsm.getTraceCount());
+}
+
+void test_monitoring_redraws_only_on_change() {
+    rig->runUntilLeaves(SystemState::IDLE);
+    rig->run(TICK_MS);
+    uint32_t redraws = rig->fsm.getRedrawCount();
+    TEST_ASSERT_EQUAL_UINT32(1, redraws);     // 进入时立即显示一次读数
+
+    // 读数不变：刷新定时器照常到期，但不重绘
+    rig->run(5 * FSM_REFRESH_INTERVAL);
+    TEST_ASSERT_EQUAL_UINT32(redraws, rig->fsm.getRedrawCount());
+
+    // 显示精度以下的变化也不重绘
+    DHT::temperature = 24.01f;
+    rig->run(2 * FSM_REFRESH_INTERVAL);
+    TEST_ASSERT_EQUAL_UINT32(redraws, rig->fsm.getRedrawCount());
+
+    DHT::temperature = 25.0f;
+    rig->run(FSM_REFRESH_INTERVAL + 1000);
+    TEST_ASSERT_EQUAL_UINT32(redraws + 1, rig->fsm.getRedrawCount());
+    // 刷新是内部转移，不写转移记录
+    TEST_ASSERT_EQUAL(1, rig->fsm.getTraceCount());
+}
+
+void test_warning_inherits_parent_transitions() {
+    rig->runUntilLeaves(SystemState::IDLE);
+    DHT::temperature = TEMP_HIGH_THRESHOLD + 5;
+    rig->run(1000 + TICK_MS);
+    TEST_ASSERT_EQUAL((int)SystemState::TEMP_WARNING, (int)state());
+
+    // TEMP_WARNING 没有定义湿度事件，由父状态 WARNING 处理
+    DHT::temperature = 24.0f;
+    DHT::humidity = HUMID_HIGH_THRESHOLD + 10;
+    rig->run(1000 + TICK_MS);
+    TEST_ASSERT_EQUAL((int)SystemState::HUMID_WARNING, (int)state());
+
+    DHT::humidity = 50.0f;
+    rig->run(1000 + TICK_MS);
+    TEST_ASSERT_EQUAL((int)SystemState::MONITORING, (int)state());
+}
+
+void test_warning_timeout_shakes_and_stays() {
+    rig->runUntilLeaves(SystemState::IDLE);
+    DHT::temperature = TEMP_HIGH_THRESHOLD + 5;
+    rig->run(1000 + TICK_MS);
+    TEST_ASSERT_EQUAL((int)SystemState::TEMP_WARNING, (int)state());
+    uint32_t started = rig->motion.getStats().started;
+
+    rig->run(5000 - 2 * TICK_MS);
+    TEST_ASSERT_EQUAL_UINT32(started, rig->motion.getStats().started);
+    rig->run(4 * TICK_MS);
+    TEST_ASSERT_EQUAL_UINT32(started + 1, rig->motion.getStats().started);
+    TEST_ASSERT_EQUAL((int)SystemState::TEMP_WARNING, (int)state());
+}
+
+void test_voice_from_any_state_and_return_waits_for_motion() {
+    rig->runUntilLeaves(SystemState::IDLE);
+    TEST_ASSERT_TRUE(rig->fsm.dispatch(FsmEvent::VOICE, (uint8_t)VoiceCommand::NOD));
+    TEST_ASSERT_EQUAL((int)SystemState::VOICE_TRIGGERED, (int)state());
+    TEST_ASSERT_TRUE(rig->servo.isPerforming());
+
+    // 动作结束前超时被守卫拒绝，按重试间隔再投递
+    uint32_t stay = rig->runUntilLeaves(SystemState::VOICE_TRIGGERED);
+    TEST_ASSERT_EQUAL((int)SystemState::MONITORING, (int)state());
+    TEST_ASSERT_TRUE(stay >= 2000);
+    TEST_ASSERT_FALSE(rig->servo.isPerforming());
+
+    // 警告状态同样响应语音（继承自根状态）
+    DHT::temperature = TEMP_LOW_THRESHOLD - 5;
+    rig->run(1000 + TICK_MS);
+    TEST_ASSERT_EQUAL((int)SystemState::TEMP_WARNING, (int)state());
+    TEST_ASSERT_TRUE(rig->fsm.dispatch(FsmEvent::VOICE, (uint8_t)VoiceCommand::HAPPY));
+    TEST_ASSERT_EQUAL((int)SystemState::VOICE_TRIGGERED, (int)state());
+}
+
+/**
+ * 持续的警告中环境事件每个周期都触发内部转移；没有变化的不写记录，
+ * IDLE -> MONITORING -> TEMP_WARNING 的经过保留下来
+ */
+void test_trace_keeps_history_through_long_warning() {
+    rig->runUntilLeaves(SystemState::IDLE);
+    DHT::temperature = TEMP_HIGH_THRESHOLD + 5;
+    rig->run(1000 + TICK_MS);
+    TEST_ASSERT_EQUAL((int)SystemState::TEMP_WARNING, (int)state());
+    TEST_ASSERT_EQUAL(2, rig->fsm.getTraceCount());
+
+    // 十分钟：每个周期的 TEMP_HIGH 与每 5 秒的摇头提醒都不写记录
+    uint32_t started = rig->motion.getStats().started;
+    rig->run(10 * 60000UL);
+    TEST_ASSERT_EQUAL((int)SystemState::TEMP_WARNING, (int)state());
+    TEST_ASSERT_TRUE(rig->motion.getStats().started - started >= 100);
+    TEST_ASSERT_EQUAL(2, rig->fsm.getTraceCount());
+
+    FsmTraceEntry entry;
+    TEST_ASSERT_TRUE(rig->fsm.getTrace(0, entry));
+    TEST_ASSERT_EQUAL((int)SystemState::IDLE, (int)entry.from);
+    TEST_ASSERT_EQUAL((int)SystemState::MONITORING, (int)entry.to);
+    TEST_ASSERT_TRUE(rig->fsm.getTrace(1, entry));
+    TEST_ASSERT_EQUAL((int)SystemState::MONITORING, (int)entry.from);
+    TEST_ASSERT_EQUAL((int)SystemState::TEMP_WARNING, (int)entry.to);
+
+    // 由热转冷改变了屏幕表情，记录下来
+    DHT::temperature = TEMP_LOW_THRESHOLD - 5;
+    rig->run(1000 + TICK_MS);
+    TEST_ASSERT_EQUAL(3, rig->fsm.getTraceCount());
+    TEST_ASSERT_TRUE(rig->fsm.getTrace(2, entry));
+    TEST_ASSERT_EQUAL((int)FsmEvent::TEMP_LOW, (int)entry.event);
+}
+
+void test_trace_records_transitions_and_wraps() {
+    rig->runUntilLeaves(SystemState::IDLE);
+    for (int i = 0; i < FSM_TRACE_CAPACITY + 5; i++) {
+        rig->fsm.dispatch(FsmEvent::VOICE, (uint8_t)VoiceCommand::QUERY_TEMP);
+    }
+    TEST_ASSERT_EQUAL(FSM_TRACE_CAPACITY, rig->fsm.getTraceCount());
+
+    FsmTraceEntry first, last;
+    TEST_ASSERT_TRUE(rig->fsm.getTrace(0, first));
+    TEST_ASSERT_TRUE(rig->fsm.getTrace(FSM_TRACE_CAPACITY - 1, last));
+    TEST_ASSERT_FALSE(rig->fsm.getTrace(FSM_TRACE_CAPACITY, last));
+    // 最早的 IDLE -> MONITORING 已被挤出；之后在 VOICE_TRIGGERED 内是内部转移
+    TEST_ASSERT_EQUAL((int)SystemState::VOICE_TRIGGERED, (int)first.from);
+    TEST_ASSERT_EQUAL((int)SystemState::VOICE_TRIGGERED, (int)last.to);
+    TEST_ASSERT_EQUAL((int)FsmEvent::VOICE, (int)last.event);
+    TEST_ASSERT_EQUAL((int)VoiceCommand::QUERY_TEMP, last.arg);
+}
+
+/**
+ * 一小时随机环境与语音输入，统计每小时重绘次数
+ * 旧实现按同一次运行逐周期重放：监测状态在每 2 秒的前 100 毫秒内每个周期重绘读数，
+ * 警告状态每个周期的环境事件都重绘表情，语音指令的表情/读数各画一次
+ */
+void test_redraws_per_hour_report() {
+    std::mt19937 rng(38);
+    const uint32_t HOUR = 3600000UL;
+    const char* const LINES[] = {"开心\n", "伤心\n", "生气\n", "困\n", "惊讶\n", "摇头\n", "点头\n", "温度\n"};
+    const bool DRAWS[] = {true, true, true, true, true, false, false, true};
+
+    uint32_t legacyReadings = 0, legacyFaces = 0;
+    uint32_t start = rig->fsm.getRedrawCount();
+    for (uint32_t t = 0; t < HOUR; t += TICK_MS) {
+        // 每 30 秒换一次环境：多数时间正常，偶尔过热、过冷或潮湿
+        if (t % 30000 == 0) {
+            uint32_t pick = rng() % 20;
+            DHT::temperature = pick == 0 ? TEMP_HIGH_THRESHOLD + 3 : pick == 1 ? TEMP_LOW_THRESHOLD - 3
+                             : 20.0f + (float)(rng() % 60) / 10.0f;
+            DHT::humidity = pick == 2 ? HUMID_HIGH_THRESHOLD + 5 : 40.0f + (float)(rng() % 200) / 10.0f;
+        }
+        // 平均每 45 秒一句语音
+        if (rng() % (45000 / TICK_MS) == 0) {
+            size_t line = rng() % (sizeof(LINES) / sizeof(LINES[0]));
+            UART_ASRPRO.rx += LINES[line];
+            legacyFaces += DRAWS[line] ? 1 : 0;
+        }
+        rig->asr.update();
+        rig->run(TICK_MS);
+
+        SystemState s = state();
+        if (s == SystemState::MONITORING && rig->fsm.getStateElapsedTime() % 2000 < 100) {
+            legacyReadings++;
+        } else if (s == SystemState::TEMP_WARNING || s == SystemState::HUMID_WARNING) {
+            legacyFaces++;
+        }
+    }
+    uint32_t redraws = rig->fsm.getRedrawCount() - start;
+    uint32_t legacy = legacyReadings + legacyFaces;
+
+    TEST_ASSERT_TRUE(redraws > 0);
+    TEST_ASSERT_TRUE(redraws * 10 < legacy);
+
+    char line[128];
+    snprintf(line, sizeof(line), "redraws/hour: per-pass %lu (readings %lu, faces %lu) -> on change %lu",
+             (unsigned long)legacy, (unsigned long)legacyReadings, (unsigned long)legacyFaces,
+             (unsigned long)redraws);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_times_out_into_monitoring);
+    RUN_TEST(test_unhandled_event_is_ignored);
+    RUN_TEST(test_monitoring_redraws_only_on_change);
+    RUN_TEST(test_warning_inherits_parent_transitions);
+    RUN_TEST(test_warning_timeout_shakes_and_stays);
+    RUN_TEST(test_voice_from_any_state_and_return_waits_for_motion);
+    RUN_TEST(test_trace_keeps_history_through_long_warning);
+    RUN_TEST(test_trace_records_transitions_and_wraps);
+    RUN_TEST(test_redraws_per_hour_report);
+    return UNITY_END();
+}
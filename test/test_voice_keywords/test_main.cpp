@@ -0,0 +1,172 @@
+#include <unity.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "ASRPRO_Module.h"
+
+/**
+ * 关键词自动机：与原 parseCommand() 的 indexOf 顺序判断逐条对照，并给出主机上的单字节耗时
+ */
+
+// 原实现：整行转小写后按固定顺序查找
+static VoiceCommand referenceParse(std::string line) {
+    for (char& c : line) {
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    }
+    auto has = [&](const char* k) { return line.find(k) != std::string::npos; };
+    if (has("happy") || has("开心")) return VoiceCommand::HAPPY;
+    if (has("sad") || has("伤心") || has("难过")) return VoiceCommand::SAD;
+    if (has("angry") || has("生气")) return VoiceCommand::ANGRY;
+    if (has("sleepy") || has("困") || has("睡眠")) return VoiceCommand::SLEEPY;
+    if (has("surprised") || has("惊讶") || has("惊")) return VoiceCommand::SURPRISED;
+    if (has("shake") || has("摇头")) return VoiceCommand::SHAKE;
+    if (has("nod") || has("点头")) return VoiceCommand::NOD;
+    if (has("weather") || has("天气")) return VoiceCommand::QUERY_WEATHER;
+    if (has("temp") || has("温度") || has("温")) return VoiceCommand::QUERY_TEMP;
+    if (has("help") || has("帮助")) return VoiceCommand::HELP;
+    return VoiceCommand::UNKNOWN;
+}
+
+// 自动机：一行中最后一次输出即该行的结果
+static VoiceCommand matchLine(const std::string& line) {
+    VoiceKeywordMatcher matcher;
+    VoiceCommand result = VoiceCommand::UNKNOWN;
+    for (char c : line) {
+        VoiceCommand cmd = matcher.feed((uint8_t)c);
+        if (cmd != VoiceCommand::UNKNOWN) result = cmd;
+    }
+    return result;
+}
+
+static const char* const KEYWORDS[] = {
+    "happy", "开心", "sad", "伤心", "难过", "angry", "生气", "sleepy", "困", "睡眠",
+    "surprised", "惊讶", "惊", "shake", "摇头", "nod", "点头", "weather", "天气",
+    "temp", "温度", "温", "help", "帮助",
+};
+static const char* const FILLERS[] = {"", " ", "我", "please ", "x", "HAPPY", "Te", "请"};
+
+void setUp() {}
+void tearDown() {}
+
+void test_each_keyword_alone() {
+    for (const char* k : KEYWORDS) {
+        TEST_ASSERT_EQUAL_MESSAGE((int)referenceParse(k), (int)matchLine(k), k);
+    }
+}
+
+void test_keyword_pairs_with_fillers() {
+    // 两个关键词的所有有序组合，前后及中间加填充
+    for (const char* a : KEYWORDS) {
+        for (const char* b : KEYWORDS) {
+            for (const char* f : FILLERS) {
+                std::string line = std::string(f) + a + f + b + f;
+                TEST_ASSERT_EQUAL_MESSAGE((int)referenceParse(line), (int)matchLine(line), line.c_str());
+            }
+        }
+    }
+}
+
+void test_keyword_triples() {
+    for (const char* a : KEYWORDS) {
+        for (const char* b : KEYWORDS) {
+            for (const char* c : KEYWORDS) {
+                std::string line = std::string(a) + b + c;
+                TEST_ASSERT_EQUAL_MESSAGE((int)referenceParse(line), (int)matchLine(line), line.c_str());
+            }
+        }
+    }
+}
+
+void test_random_lines() {
+    // 关键词片段、大小写与 UTF-8 断字混合
+    std::mt19937 rng(27);
+    for (int i = 0; i < 100000; i++) {
+        std::string line;
+        int parts = 1 + rng() % 5;
+        for (int p = 0; p < parts; p++) {
+            std::string k = KEYWORDS[rng() % (sizeof(KEYWORDS) / sizeof(KEYWORDS[0]))];
+            if (rng() % 3 == 0) k = k.substr(0, rng() % (k.size() + 1));
+            if (rng() % 4 == 0) {
+                for (char& c : k) {
+                    if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
+                }
+            }
+            line += k;
+            if (rng() % 2) line += FILLERS[rng() % (sizeof(FILLERS) / sizeof(FILLERS[0]))];
+        }
+        TEST_ASSERT_EQUAL_MESSAGE((int)referenceParse(line), (int)matchLine(line), line.c_str());
+    }
+}
+
+void test_emits_when_keyword_completes() {
+    VoiceKeywordMatcher matcher;
+    const std::string line = "请点头";
+    for (size_t i = 0; i + 1 < line.size(); i++) {
+        TEST_ASSERT_EQUAL((int)VoiceCommand::UNKNOWN, (int)matcher.feed((uint8_t)line[i]));
+    }
+    TEST_ASSERT_EQUAL((int)VoiceCommand::NOD, (int)matcher.feed((uint8_t)line.back()));
+}
+
+void test_lower_priority_after_higher_is_ignored() {
+    VoiceKeywordMatcher matcher;
+    VoiceCommand last = VoiceCommand::UNKNOWN;
+    for (char c : std::string("happy nod")) {
+        VoiceCommand cmd = matcher.feed((uint8_t)c);
+        if (cmd != VoiceCommand::UNKNOWN) last = cmd;
+    }
+    TEST_ASSERT_EQUAL((int)VoiceCommand::HAPPY, (int)last);
+}
+
+void test_module_queues_command_from_uart() {
+    ASRPROModule module;
+    module.begin();
+    UART_ASRPRO.rx = "我想看你点头\n";
+    module.update();
+    VoiceCommandEntry entry;
+    TEST_ASSERT_TRUE(module.nextCommand(entry));
+    TEST_ASSERT_EQUAL((int)VoiceCommand::NOD, (int)entry.command);
+    TEST_ASSERT_FALSE(module.nextCommand(entry));
+}
+
+void test_benchmark_bytes_per_second() {
+    std::mt19937 rng(1);
+    std::vector<std::string> lines;
+    for (int i = 0; i < 2000; i++) {
+        lines.push_back(std::string(FILLERS[rng() % 8]) + KEYWORDS[rng() % 24] + FILLERS[rng() % 8]);
+    }
+    size_t bytes = 0;
+    for (const std::string& l : lines) bytes += l.size();
+
+    const int rounds = 50;
+    volatile int sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const std::string& l : lines) sink += (int)matchLine(l);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const std::string& l : lines) sink += (int)referenceParse(l);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double automaton = std::chrono::duration<double, std::nano>(t1 - t0).count() / (bytes * rounds);
+    double reference = std::chrono::duration<double, std::nano>(t2 - t1).count() / (bytes * rounds);
+    char msg[96];
+    snprintf(msg, sizeof(msg), "automaton %.2f ns/byte, indexOf chain %.2f ns/byte", automaton, reference);
+    TEST_MESSAGE(msg);
+    (void)sink;
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_each_keyword_alone);
+    RUN_TEST(test_keyword_pairs_with_fillers);
+    RUN_TEST(test_keyword_triples);
+    RUN_TEST(test_random_lines);
+    RUN_TEST(test_emits_when_keyword_completes);
+    RUN_TEST(test_lower_priority_after_higher_is_ignored);
+    RUN_TEST(test_module_queues_command_from_uart);
+    RUN_TEST(test_benchmark_bytes_per_second);
+    return UNITY_END();
+}
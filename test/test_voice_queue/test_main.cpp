@@ -0,0 +1,143 @@
+#include <unity.h>
+#include "Voice_Command_Queue.h"
+#include "ASRPRO_Module.h"
+
+/**
+ * 语音指令队列：合并、按首次到达计龄、优先级出队，
+ * 以及经 ASRPROModule 的突发输入下哪些指令被合并、挤出或丢弃
+ */
+
+void setUp() {}
+void tearDown() {}
+
+void test_repeats_within_window_are_coalesced() {
+    VoiceCommandQueue queue;
+    uint16_t id = queue.push(VoiceCommand::NOD, VoiceSource::TEXT, 80, 1000);
+    TEST_ASSERT_EQUAL(id, queue.push(VoiceCommand::NOD, VoiceSource::TEXT, 80, 1000 + VOICE_COALESCE_WINDOW));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.getStats().coalesced);
+
+    VoiceCommandEntry e;
+    TEST_ASSERT_TRUE(queue.pop(e, 2000));
+    TEST_ASSERT_EQUAL(1, e.repeats);
+    TEST_ASSERT_FALSE(queue.pop(e, 2000));
+}
+
+void test_age_counts_from_first_arrival() {
+    // 在合并窗口内不停重说，仍按第一次到达计龄
+    VoiceCommandQueue queue;
+    unsigned long t = 1000;
+    queue.push(VoiceCommand::SHAKE, VoiceSource::TEXT, 80, t);
+    while (t + VOICE_COALESCE_WINDOW / 2 <= 1000 + VOICE_COMMAND_MAX_AGE) {
+        t += VOICE_COALESCE_WINDOW / 2;
+        queue.push(VoiceCommand::SHAKE, VoiceSource::TEXT, 80, t);
+    }
+
+    VoiceCommandEntry e;
+    TEST_ASSERT_FALSE(queue.pop(e, 1001 + VOICE_COMMAND_MAX_AGE));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.getStats().expired);
+}
+
+void test_repeat_after_expiry_starts_new_entry() {
+    VoiceCommandQueue queue;
+    uint16_t first = queue.push(VoiceCommand::HAPPY, VoiceSource::TEXT, 80, 0);
+    unsigned long later = VOICE_COMMAND_MAX_AGE + 1;
+    uint16_t second = queue.push(VoiceCommand::HAPPY, VoiceSource::TEXT, 80, later);
+    TEST_ASSERT_NOT_EQUAL(first, second);
+
+    VoiceCommandEntry e;
+    TEST_ASSERT_TRUE(queue.pop(e, later));
+    TEST_ASSERT_EQUAL(later, e.timestamp);
+}
+
+void test_pop_by_priority_then_arrival() {
+    VoiceCommandQueue queue;
+    queue.push(VoiceCommand::NOD, VoiceSource::TEXT, 80, 0);
+    queue.push(VoiceCommand::HAPPY, VoiceSource::TEXT, 80, 1);
+    queue.push(VoiceCommand::QUERY_TEMP, VoiceSource::TEXT, 80, 2);
+    queue.push(VoiceCommand::SAD, VoiceSource::TEXT, 80, 3);
+
+    const VoiceCommand expected[] = {
+        VoiceCommand::QUERY_TEMP, VoiceCommand::HAPPY, VoiceCommand::SAD, VoiceCommand::NOD
+    };
+    VoiceCommandEntry e;
+    for (VoiceCommand cmd : expected) {
+        TEST_ASSERT_TRUE(queue.pop(e, 10));
+        TEST_ASSERT_EQUAL((int)cmd, (int)e.command);
+    }
+}
+
+// ==================== 经串口的突发输入 ====================
+
+static void receive(ASRPROModule& asr, const char* text) {
+    UART_ASRPRO.rx += text;
+    asr.update();
+}
+
+void test_burst_through_module_fills_queue() {
+    hostSetMillis(10000);
+    ASRPROModule asr;
+    asr.begin();
+
+    // 同一次 update() 内到达，全部在合并窗口内
+    receive(asr, "nod\nnod\nnod\nshake\nhelp\ntemp\nweather\nhappy\nsad\nangry\n");
+    TEST_ASSERT_EQUAL_UINT32(8, asr.getQueueStats().enqueued);
+    TEST_ASSERT_EQUAL_UINT32(2, asr.getQueueStats().coalesced);
+    TEST_ASSERT_EQUAL_UINT32(0, asr.getQueueStats().dropped);
+
+    // 队列已满：优先级更高的新指令依次挤掉最早的点头、摇头
+    receive(asr, "sleepy\nsurprised\n");
+    TEST_ASSERT_EQUAL_UINT32(2, asr.getQueueStats().dropped);
+
+    // 新的点头优先级低于队列中所有指令，本身被丢弃；重复的帮助仍然合并
+    receive(asr, "nod\nhelp\n");
+    TEST_ASSERT_EQUAL_UINT32(3, asr.getQueueStats().dropped);
+    TEST_ASSERT_EQUAL_UINT32(3, asr.getQueueStats().coalesced);
+    TEST_ASSERT_EQUAL_UINT32(10, asr.getQueueStats().enqueued);
+
+    const VoiceCommand expected[] = {
+        VoiceCommand::HELP, VoiceCommand::QUERY_TEMP, VoiceCommand::QUERY_WEATHER,
+        VoiceCommand::HAPPY, VoiceCommand::SAD, VoiceCommand::ANGRY,
+        VoiceCommand::SLEEPY, VoiceCommand::SURPRISED
+    };
+    VoiceCommandEntry e;
+    for (VoiceCommand cmd : expected) {
+        TEST_ASSERT_TRUE(asr.nextCommand(e));
+        TEST_ASSERT_EQUAL((int)cmd, (int)e.command);
+        TEST_ASSERT_EQUAL(cmd == VoiceCommand::HELP ? 1 : 0, e.repeats);
+    }
+    TEST_ASSERT_FALSE(asr.nextCommand(e));
+}
+
+void test_clear_buffer_starts_new_line() {
+    hostSetMillis(20000);
+    ASRPROModule asr;
+    asr.begin();
+
+    // 同一行中后出现的更高优先级关键词替换本行条目
+    receive(asr, "help me nod\n");
+    VoiceCommandEntry e;
+    TEST_ASSERT_TRUE(asr.nextCommand(e));
+    TEST_ASSERT_EQUAL((int)VoiceCommand::NOD, (int)e.command);
+    TEST_ASSERT_FALSE(asr.nextCommand(e));
+
+    // 清除后的关键词属于新的一行，不能替换清除前已入队的开心
+    receive(asr, "happy");
+    asr.clearBuffer();
+    receive(asr, "nod\n");
+    TEST_ASSERT_TRUE(asr.nextCommand(e));
+    TEST_ASSERT_EQUAL((int)VoiceCommand::HAPPY, (int)e.command);
+    TEST_ASSERT_TRUE(asr.nextCommand(e));
+    TEST_ASSERT_EQUAL((int)VoiceCommand::NOD, (int)e.command);
+    TEST_ASSERT_FALSE(asr.nextCommand(e));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_repeats_within_window_are_coalesced);
+    RUN_TEST(test_age_counts_from_first_arrival);
+    RUN_TEST(test_repeat_after_expiry_starts_new_entry);
+    RUN_TEST(test_pop_by_priority_then_arrival);
+    RUN_TEST(test_burst_through_module_fills_queue);
+    RUN_TEST(test_clear_buffer_starts_new_line);
+    return UNITY_END();
+}
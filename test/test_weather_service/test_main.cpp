@@ -0,0 +1,195 @@
+#include <unity.h>
+#include <Host_Alloc_Counter.h>
+#include <string>
+#include <WiFiClient.h>
+#include "Weather_Service.h"
+
+/**
+ * 天气解析：心知天气响应的字段提取、截断响应、超出 int32 的数值、
+ * ISO8601 时间与时区换算，以及每次天气更新不分配堆内存
+ */
+
+static const char NOW_JSON[] =
+    "{\"results\":[{\"location\":{\"id\":\"WX4FBXXFKE4F\",\"name\":\"北京\"},"
+    "\"now\":{\"text\":\"多云\",\"code\":\"4\",\"temperature\":\"25\"},"
+    "\"last_update\":\"2015-09-25T22:45:00+08:00\"}]}";
+
+static const char DAILY_JSON[] =
+    "{\"results\":[{\"now\":{\"code\":13,\"temperature\":-3},"
+    "\"daily\":[{\"high\":\"2\",\"low\":\"-8\"}],"
+    "\"last_update\":\"2024-02-29T23:00:00-06:30\"}]}";
+
+static WeatherService* weather = nullptr;
+
+void setUp() {
+    weather = new WeatherService();
+    weather->begin();
+}
+
+void tearDown() {
+    delete weather;
+    weather = nullptr;
+}
+
+static std::string withField(const char* field, const char* value) {
+    std::string json = "{\"results\":[{\"now\":{\"code\":\"4\",\"temperature\":\"25\"";
+    json += std::string(",\"") + field + "\":" + value;
+    json += "},\"last_update\":\"2015-09-25T22:45:00+08:00\"}]}";
+    return json;
+}
+
+// ==================== 有效响应 ====================
+
+void test_parses_now_payload() {
+    TEST_ASSERT_TRUE(weather->parseWeatherJSON(NOW_JSON));
+    const WeatherData& w = weather->getWeather();
+    TEST_ASSERT_TRUE(w.isValid);
+    TEST_ASSERT_EQUAL(4, w.code);
+    TEST_ASSERT_EQUAL((int)weatherTypeFromCode(4), (int)w.type);
+    TEST_ASSERT_EQUAL(25, w.temperature);
+    TEST_ASSERT_EQUAL(25, w.tempMax);           // 没有逐日预报时高低温取当前温度
+    TEST_ASSERT_EQUAL(25, w.tempMin);
+    TEST_ASSERT_EQUAL_UINT32(1443192300UL, w.updateTime);   // 2015-09-25T14:45:00Z
+}
+
+void test_parses_numeric_fields_and_daily_range() {
+    TEST_ASSERT_TRUE(weather->parseWeatherJSON(DAILY_JSON));
+    const WeatherData& w = weather->getWeather();
+    TEST_ASSERT_EQUAL(13, w.code);
+    TEST_ASSERT_EQUAL(-3, w.temperature);
+    TEST_ASSERT_EQUAL(2, w.tempMax);
+    TEST_ASSERT_EQUAL(-8, w.tempMin);
+    // 闰日 23:00 西六区半 = 3 月 1 日 05:30 UTC
+    TEST_ASSERT_EQUAL_UINT32(1709271000UL, w.updateTime);
+}
+
+void test_rejects_api_error() {
+    TEST_ASSERT_FALSE(weather->parseWeatherJSON(
+        "{\"status\":\"The API key is invalid.\",\"status_code\":\"AP010001\"}"));
+    TEST_ASSERT_FALSE(weather->parseWeatherJSON("{\"now\":{\"code\":\"4\"}}"));
+    TEST_ASSERT_FALSE(weather->getWeather().isValid);
+}
+
+// ==================== ISO8601 ====================
+
+static uint32_t updateTimeOf(const char* stamp) {
+    std::string json = std::string("{\"results\":[{\"now\":{\"code\":\"0\",\"temperature\":\"20\"},"
+                                   "\"last_update\":") + stamp + "}]}";
+    TEST_ASSERT_TRUE(weather->parseWeatherJSON(json.c_str()));
+    return weather->getWeather().updateTime;
+}
+
+void test_iso8601_variants() {
+    TEST_ASSERT_EQUAL_UINT32(1443221100UL, updateTimeOf("\"2015-09-25T22:45:00\""));        // 无时区按 UTC
+    TEST_ASSERT_EQUAL_UINT32(1443221100UL, updateTimeOf("\"2015-09-25T22:45:00Z\""));
+    TEST_ASSERT_EQUAL_UINT32(1443192300UL, updateTimeOf("\"2015-09-25T22:45:00+08:00\""));
+    TEST_ASSERT_EQUAL_UINT32(0, updateTimeOf("\"2015-09-25T22:45\""));                      // 过短
+    TEST_ASSERT_EQUAL_UINT32(0, updateTimeOf("\"2015-09-2xT22:45:00+08:00\""));             // 非数字
+    TEST_ASSERT_EQUAL_UINT32(0, updateTimeOf("\"1969-12-31T23:59:59\""));
+    TEST_ASSERT_EQUAL_UINT32(0, updateTimeOf("1443221100"));                               // 不是字符串
+    TEST_ASSERT_EQUAL_UINT32(0, updateTimeOf("\"\""));
+}
+
+// ==================== 截断响应 ====================
+
+void test_truncated_payloads_never_overrun() {
+    const size_t full = strlen(NOW_JSON);
+    const char* temperature = strstr(NOW_JSON, "\"25\"");
+    const char* stamp = strstr(NOW_JSON, "2015-");
+    size_t valueComplete = (size_t)(temperature - NOW_JSON) + 4;   // 读到 "25" 的结束引号
+    size_t stampComplete = (size_t)(stamp - NOW_JSON) + 19;
+
+    int accepted = 0;
+    for (size_t length = 0; length < full; length++) {
+        // 放在独立分配的缓冲区里，越界读取能被 ASan/valgrind 发现
+        char* cut = (char*)malloc(length + 1);
+        memcpy(cut, NOW_JSON, length);
+        cut[length] = '\0';
+
+        bool ok = weather->parseWeatherJSON(cut);
+        if (length < valueComplete) {
+            TEST_ASSERT_FALSE(ok);
+        } else {
+            TEST_ASSERT_TRUE(ok);
+            TEST_ASSERT_EQUAL(25, weather->getWeather().temperature);
+            // 时间不完整为 0，时区不完整时按 UTC，完整时换算时区
+            uint32_t expected = length < stampComplete ? 0
+                              : length < stampComplete + 6 ? 1443221100UL : 1443192300UL;
+            TEST_ASSERT_EQUAL_UINT32(expected, weather->getWeather().updateTime);
+            accepted++;
+        }
+        free(cut);
+    }
+    TEST_ASSERT_EQUAL((int)(full - valueComplete), accepted);
+
+    // 截断在数字中间：不带引号的值同样拒绝，不会读成较小的值
+    TEST_ASSERT_FALSE(weather->parseWeatherJSON("{\"results\":[{\"now\":{\"code\":4,\"temperature\":2"));
+    TEST_ASSERT_TRUE(weather->parseWeatherJSON("{\"results\":[{\"now\":{\"code\":4,\"temperature\":25}"));
+}
+
+// ==================== 数值溢出 ====================
+
+void test_overflowing_numbers_are_rejected() {
+    // 当前温度溢出：整份数据无效
+    TEST_ASSERT_FALSE(weather->parseWeatherJSON(
+        "{\"results\":[{\"now\":{\"code\":\"4\",\"temperature\":\"99999999999\"}}]}"));
+    TEST_ASSERT_FALSE(weather->getWeather().isValid);
+    TEST_ASSERT_FALSE(weather->parseWeatherJSON(
+        "{\"results\":[{\"now\":{\"code\":\"4\",\"temperature\":\"2147483648\"}}]}"));
+
+    // 代码溢出不能回绕成合法代码（4294967300 按 32 位回绕后为 4）
+    TEST_ASSERT_FALSE(weather->parseWeatherJSON(
+        "{\"results\":[{\"now\":{\"code\":\"4294967300\",\"temperature\":\"25\"}}]}"));
+
+    // int32 边界值本身有效，温度夹到 int8
+    TEST_ASSERT_TRUE(weather->parseWeatherJSON(
+        "{\"results\":[{\"now\":{\"code\":\"4\",\"temperature\":\"-2147483648\"}}]}"));
+    TEST_ASSERT_EQUAL(-128, weather->getWeather().temperature);
+    TEST_ASSERT_TRUE(weather->parseWeatherJSON(
+        "{\"results\":[{\"now\":{\"code\":\"2147483647\",\"temperature\":\"25\"}}]}"));
+    TEST_ASSERT_EQUAL(WEATHER_CODE_UNKNOWN, weather->getWeather().code);
+
+    // 可选的高低温溢出时忽略，退回当前温度
+    TEST_ASSERT_TRUE(weather->parseWeatherJSON(withField("high", "\"12345678901234567890\"").c_str()));
+    TEST_ASSERT_EQUAL(25, weather->getWeather().tempMax);
+    TEST_ASSERT_TRUE(weather->parseWeatherJSON(withField("low", "-4294967296").c_str()));
+    TEST_ASSERT_EQUAL(25, weather->getWeather().tempMin);
+}
+
+// ==================== 堆分配 ====================
+
+void test_weather_cycle_does_not_allocate() {
+    WiFiClient::reachable = true;
+    WiFiClient::response = std::string("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n") + NOW_JSON;
+
+    const int CYCLES = 50;
+    int updated = 0;
+    size_t before = g_hostAllocations;
+    for (int i = 0; i < CYCLES; i++) {
+        hostAdvanceMillis(g_config.weatherUpdateInterval + 1);
+        updated += weather->updateWeather() ? 1 : 0;
+    }
+    size_t allocated = g_hostAllocations - before;
+    WiFiClient::reachable = false;
+
+    TEST_ASSERT_EQUAL(CYCLES, updated);
+    TEST_ASSERT_EQUAL_size_t(0, allocated);
+    TEST_ASSERT_EQUAL_UINT32(1443192300UL, weather->getWeather().updateTime);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%d weather cycles: %lu heap allocations",
+             CYCLES, (unsigned long)allocated);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parses_now_payload);
+    RUN_TEST(test_parses_numeric_fields_and_daily_range);
+    RUN_TEST(test_rejects_api_error);
+    RUN_TEST(test_iso8601_variants);
+    RUN_TEST(test_truncated_payloads_never_overrun);
+    RUN_TEST(test_overflowing_numbers_are_rejected);
+    RUN_TEST(test_weather_cycle_does_not_allocate);
+    return UNITY_END();
+}
@@ -0,0 +1,467 @@
+#!/usr/bin/env python3
+"""
+编舞脚本编译器（字节码格式见 include/Choreography.h）
+
+把文本或 JSON 编舞编译成设备解释执行的字节码，可输出二进制文件、C 数组，
+或经 MQTT 分块下载到设备（见 include/Choreography_Store.h）。
+
+文本格式（每行一条，# 开头为注释）：
+    emotion HAPPY                 切换表情（名称取自 OLED_Display.h 的 EmotionState）
+    say "Dancing!"                播报
+    move head=45 nod=90 300       两轴运动段，省略的轴保持，时长毫秒
+    wait 200                      保持姿态
+    loop 3 ... endloop            循环
+    if temp > 30.5 goto hot       传感器分支（temp/humidity，比较 < > == !=，只能向前）
+    goto done                     跳转（只能向前）
+    hot:                          标号
+    end                           结束（末尾自动补上）
+
+JSON 格式为指令对象数组，循环与分支用嵌套结构表示：
+    [{"op": "emotion", "emotion": "HAPPY"},
+     {"op": "loop", "count": 2, "body": [{"op": "move", "head": 45, "ms": 300}]},
+     {"op": "if", "sensor": "temp", "cmp": ">", "value": 30,
+      "then": [{"op": "say", "text": "Too hot!"}], "else": []}]
+
+用法：
+    python3 tools/choreo_compiler.py tools/choreo/dance.txt -o dance.bin
+    python3 tools/choreo_compiler.py tools/choreo/dance.txt --c-array CHOREO_DANCE
+    python3 tools/choreo_compiler.py dance.bin --disassemble
+    python3 tools/choreo_compiler.py tools/choreo/dance.txt --publish broker.example.com \\
+        --topic smartdesk/your_device_id/choreo --ack-topic '$dp/post/your_device_id' --slot 0 --play
+"""
+
+import argparse
+import json
+import os
+import re
+import shlex
+import struct
+import sys
+import time
+
+MAGIC = b'CB'
+VERSION = 1
+HEADER_SIZE = 10
+ANGLE_HOLD = 255
+
+SCRIPT_MAX = 1024
+STRING_MAX = 8
+SPEECH_TEXT_MAX_LEN = 48
+LOOP_DEPTH = 4
+CHUNK_MAX = 192
+
+OPS = ['END', 'MOVE', 'WAIT', 'EMOTION', 'SAY', 'LOOP', 'ENDLOOP', 'JUMP', 'BRANCH']
+OP = {name: i for i, name in enumerate(OPS)}
+OP_SIZE = [1, 5, 3, 2, 2, 2, 1, 3, 7]
+
+SENSORS = {'temp': 0, 'temperature': 0, 'humidity': 1}
+SENSOR_NAMES = ['temp', 'humidity']
+COMPARES = {'<': 0, '>': 1, '==': 2, '!=': 3}
+COMPARE_NAMES = ['<', '>', '==', '!=']
+
+MSG_CHUNK = 1
+MSG_PLAY = 2
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+class CompileError(Exception):
+    pass
+
+
+def crc16(data):
+    """CRC-16/CCITT（多项式 0x1021，初值 0xFFFF），与固件 choreoCrc16() 一致"""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def load_emotions():
+    """从 OLED_Display.h 读取 EmotionState 枚举，保证名称与固件一致"""
+    path = os.path.join(ROOT, 'include', 'OLED_Display.h')
+    with open(path, encoding='utf-8') as f:
+        m = re.search(r'enum\s+class\s+EmotionState\s*\{(.*?)\}', f.read(), re.S)
+    body = re.sub(r'//[^\n]*', '', m.group(1))
+    names = [n.strip() for n in body.split(',') if n.strip()]
+    return {name: i for i, name in enumerate(names)}
+
+
+class Assembler:
+    """指令列表 -> 字节码，跳转目标以标号表示，最后统一回填"""
+
+    def __init__(self, emotions):
+        self.emotions = emotions
+        self.code = bytearray()
+        self.strings = []
+        self.labels = {}
+        self.fixups = []        # (偏移, 标号, 行号)
+        self.anon = 0
+
+    def new_label(self):
+        self.anon += 1
+        return '.L%d' % self.anon
+
+    def label(self, name, line=None):
+        if name in self.labels:
+            raise CompileError('line %s: duplicate label %r' % (line, name))
+        self.labels[name] = len(self.code)
+
+    def angle(self, value, line):
+        if value is None:
+            return ANGLE_HOLD
+        value = int(value)
+        if not 0 <= value <= 180:
+            raise CompileError('line %s: angle %d out of range 0..180' % (line, value))
+        return value
+
+    def duration(self, value, line):
+        ms = int(str(value).lower().rstrip('ms'))
+        if not 0 < ms <= 0xFFFF:
+            raise CompileError('line %s: duration %d out of range 1..65535' % (line, ms))
+        return ms
+
+    def move(self, head, nod, ms, line=None):
+        self.code += struct.pack('<BBBH', OP['MOVE'], self.angle(head, line), self.angle(nod, line),
+                                 self.duration(ms, line))
+
+    def wait(self, ms, line=None):
+        self.code += struct.pack('<BH', OP['WAIT'], self.duration(ms, line))
+
+    def emotion(self, name, line=None):
+        if name not in self.emotions:
+            raise CompileError('line %s: unknown emotion %r (known: %s)'
+                               % (line, name, ', '.join(self.emotions)))
+        self.code += bytes([OP['EMOTION'], self.emotions[name]])
+
+    def say(self, text, line=None):
+        data = text.encode('utf-8')
+        if len(data) >= SPEECH_TEXT_MAX_LEN or b'\0' in data:
+            raise CompileError('line %s: text longer than %d bytes' % (line, SPEECH_TEXT_MAX_LEN - 1))
+        if data not in self.strings:
+            if len(self.strings) == STRING_MAX:
+                raise CompileError('line %s: more than %d texts' % (line, STRING_MAX))
+            self.strings.append(data)
+        self.code += bytes([OP['SAY'], self.strings.index(data)])
+
+    def loop(self, count, line=None):
+        count = int(count)
+        if not 1 <= count <= 255:
+            raise CompileError('line %s: loop count %d out of range 1..255' % (line, count))
+        self.code += bytes([OP['LOOP'], count])
+
+    def endloop(self, line=None):
+        self.code.append(OP['ENDLOOP'])
+
+    def jump(self, target, line=None):
+        self.code.append(OP['JUMP'])
+        self.fixups.append((len(self.code), target, line))
+        self.code += b'\0\0'
+
+    def branch(self, sensor, cmp, value, target, line=None):
+        if sensor not in SENSORS:
+            raise CompileError('line %s: unknown sensor %r' % (line, sensor))
+        if cmp not in COMPARES:
+            raise CompileError('line %s: unknown comparison %r' % (line, cmp))
+        scaled = int(round(float(value) * 10))
+        self.code += struct.pack('<BBBh', OP['BRANCH'], SENSORS[sensor], COMPARES[cmp], scaled)
+        self.fixups.append((len(self.code), target, line))
+        self.code += b'\0\0'
+
+    def end(self, line=None):
+        self.code.append(OP['END'])
+
+    def finish(self):
+        # 末尾补 END；标号指向末尾时也需要一条 END 作为跳转目标
+        if not self.code or self._last_op() != OP['END'] or len(self.code) in self.labels.values():
+            self.end()
+        for offset, target, line in self.fixups:
+            if target not in self.labels:
+                raise CompileError('line %s: undefined label %r' % (line, target))
+            address = self.labels[target]
+            if address <= offset:
+                raise CompileError('line %s: jump to %r goes backwards (use loop)' % (line, target))
+            struct.pack_into('<H', self.code, offset, address)
+
+        strings = b''.join(s + b'\0' for s in self.strings)
+        total = HEADER_SIZE + len(self.code) + len(strings)
+        if total > SCRIPT_MAX:
+            raise CompileError('script is %d bytes, limit %d' % (total, SCRIPT_MAX))
+        body = bytes(self.code) + strings
+        header = MAGIC + struct.pack('<BBHHH', VERSION, len(self.strings), len(self.code), total, crc16(body))
+        return header + body
+
+    def _last_op(self):
+        pc = last = 0
+        while pc < len(self.code):
+            last = self.code[pc]
+            pc += OP_SIZE[last]
+        return last
+
+
+# ==================== 文本格式 ====================
+
+def compile_text(source, emotions):
+    asm = Assembler(emotions)
+    depth = 0
+    for number, raw in enumerate(source.splitlines(), 1):
+        try:
+            words = shlex.split(raw, comments=True)
+        except ValueError as e:
+            raise CompileError('line %d: %s' % (number, e))
+        if not words:
+            continue
+        if len(words) == 1 and re.fullmatch(r'[A-Za-z_][\w.]*:', words[0]):
+            asm.label(words[0][:-1], number)
+            continue
+        op, args = words[0].lower(), words[1:]
+        try:
+            if op == 'move':
+                axes = {'head': None, 'nod': None}
+                ms = None
+                for arg in args:
+                    if '=' in arg:
+                        key, value = arg.split('=', 1)
+                        if key not in axes:
+                            raise CompileError('line %d: unknown axis %r' % (number, key))
+                        axes[key] = value
+                    else:
+                        ms = arg
+                if ms is None:
+                    raise CompileError('line %d: move needs a duration' % number)
+                asm.move(axes['head'], axes['nod'], ms, number)
+            elif op == 'wait':
+                asm.wait(args[0], number)
+            elif op == 'emotion':
+                asm.emotion(args[0].upper(), number)
+            elif op == 'say':
+                asm.say(args[0], number)
+            elif op == 'loop':
+                depth += 1
+                if depth > LOOP_DEPTH:
+                    raise CompileError('line %d: loops nested deeper than %d' % (number, LOOP_DEPTH))
+                asm.loop(args[0], number)
+            elif op == 'endloop':
+                if depth == 0:
+                    raise CompileError('line %d: endloop without loop' % number)
+                depth -= 1
+                asm.endloop(number)
+            elif op == 'goto':
+                asm.jump(args[0], number)
+            elif op == 'if':
+                # if <sensor> <cmp> <value> goto <label>
+                if len(args) != 5 or args[3] != 'goto':
+                    raise CompileError('line %d: expected "if <sensor> <cmp> <value> goto <label>"' % number)
+                asm.branch(args[0].lower(), args[1], args[2], args[4], number)
+            elif op == 'end':
+                asm.end(number)
+            else:
+                raise CompileError('line %d: unknown instruction %r' % (number, op))
+        except (IndexError, ValueError):
+            raise CompileError('line %d: bad arguments: %s' % (number, raw.strip()))
+    if depth != 0:
+        raise CompileError('loop without endloop')
+    return asm.finish()
+
+
+# ==================== JSON 格式 ====================
+
+def compile_json(source, emotions):
+    asm = Assembler(emotions)
+
+    def emit(items, depth):
+        for item in items:
+            op = item.get('op')
+            if op == 'move':
+                asm.move(item.get('head'), item.get('nod'), item['ms'])
+            elif op == 'wait':
+                asm.wait(item['ms'])
+            elif op == 'emotion':
+                asm.emotion(item['emotion'].upper())
+            elif op == 'say':
+                asm.say(item['text'])
+            elif op == 'loop':
+                if depth == LOOP_DEPTH:
+                    raise CompileError('loops nested deeper than %d' % LOOP_DEPTH)
+                asm.loop(item['count'])
+                emit(item.get('body', []), depth + 1)
+                asm.endloop()
+            elif op == 'if':
+                # 条件成立跳到 then，否则顺序执行 else 后跳过 then
+                then_label, done_label = asm.new_label(), asm.new_label()
+                asm.branch(item['sensor'].lower(), item['cmp'], item['value'], then_label)
+                emit(item.get('else', []), depth)
+                asm.jump(done_label)
+                asm.label(then_label)
+                emit(item.get('then', []), depth)
+                asm.label(done_label)
+            elif op == 'end':
+                asm.end()
+            else:
+                raise CompileError('unknown op %r in %s' % (op, json.dumps(item)))
+
+    emit(json.loads(source), 0)
+    return asm.finish()
+
+
+# ==================== 反汇编 ====================
+
+def disassemble(script, emotions):
+    names = {v: k for k, v in emotions.items()}
+    count, code_length, total, crc = struct.unpack_from('<BHHH', script, 3)
+    code = script[HEADER_SIZE:HEADER_SIZE + code_length]
+    strings = script[HEADER_SIZE + code_length:].split(b'\0')[:count]
+    ok = script[:2] == MAGIC and total == len(script) and crc16(script[HEADER_SIZE:]) == crc
+    print('; %d bytes, %d code, %d texts, crc %s' % (len(script), code_length, count, 'ok' if ok else 'BAD'))
+
+    pc = 0
+    while pc < len(code):
+        op = code[pc]
+        if op >= len(OPS):
+            print('%04x  ??? 0x%02x' % (pc, op))
+            break
+        a = code[pc + 1:pc + OP_SIZE[op]]
+        name = OPS[op]
+        if name == 'MOVE':
+            head, nod, ms = struct.unpack('<BBH', a)
+            fmt = lambda v: 'hold' if v == ANGLE_HOLD else str(v)
+            text = 'head=%s nod=%s %dms' % (fmt(head), fmt(nod), ms)
+        elif name == 'WAIT':
+            text = '%dms' % struct.unpack('<H', a)
+        elif name == 'EMOTION':
+            text = names.get(a[0], str(a[0]))
+        elif name == 'SAY':
+            text = json.dumps(strings[a[0]].decode('utf-8')) if a[0] < len(strings) else '#%d' % a[0]
+        elif name == 'LOOP':
+            text = str(a[0])
+        elif name == 'JUMP':
+            text = '-> %04x' % struct.unpack('<H', a)
+        elif name == 'BRANCH':
+            sensor, cmp, value, target = struct.unpack('<BBhH', a)
+            text = '%s %s %.1f -> %04x' % (SENSOR_NAMES[sensor] if sensor < 2 else sensor,
+                                           COMPARE_NAMES[cmp] if cmp < 4 else cmp, value / 10, target)
+        else:
+            text = ''
+        print('%04x  %-8s %s' % (pc, name, text))
+        pc += OP_SIZE[op]
+
+
+# ==================== 输出 ====================
+
+def c_array(name, script, source):
+    lines = ['// 由 tools/choreo_compiler.py 从 %s 生成' % source,
+             'static const uint8_t %s[] = {' % name]
+    for i in range(0, len(script), 12):
+        lines.append('    ' + ' '.join('0x%02x,' % b for b in script[i:i + 12]))
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def publish(script, args):
+    """逐块发送，等待设备回复后再发下一块；超时重发，乱序时按设备回复的 received 续传"""
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit('--publish needs paho-mqtt (pip install paho-mqtt)')
+
+    replies = []
+    client = mqtt.Client()
+    if args.username:
+        client.username_pw_set(args.username, args.password)
+    client.on_message = lambda c, u, msg: replies.append(msg.payload)
+    client.connect(args.publish, args.port)
+    client.subscribe(args.ack_topic)
+    client.loop_start()
+
+    def send(payload):
+        del replies[:]
+        client.publish(args.topic, payload)
+        deadline = time.time() + args.timeout
+        while time.time() < deadline:
+            for raw in replies:
+                try:
+                    reply = json.loads(raw).get('choreo')
+                except (ValueError, AttributeError):
+                    continue
+                if reply and reply.get('slot') == args.slot:
+                    return reply
+            time.sleep(0.02)
+        return None
+
+    offset, retries = 0, 0
+    while offset < len(script):
+        payload = struct.pack('<BBHH', MSG_CHUNK, args.slot, offset, len(script)) + script[offset:offset + CHUNK_MAX]
+        reply = send(payload)
+        if reply is None:
+            retries += 1
+            if retries > args.retries:
+                sys.exit('no reply at offset %d' % offset)
+            continue
+        result = reply.get('result')
+        if result in ('accepted', 'stored'):
+            offset = min(offset + CHUNK_MAX, len(script))
+            retries = 0
+        elif result == 'out_of_order':
+            offset = reply.get('received', 0)
+        else:
+            sys.exit('device rejected script: %s' % result)
+        print('  %d/%d %s' % (offset, len(script), result))
+
+    if args.play:
+        reply = send(struct.pack('<BB', MSG_PLAY, args.slot))
+        print('play: %s' % (reply.get('result') if reply else 'no reply'))
+    client.loop_stop()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('source', help='文本 / JSON 编舞，或 --disassemble 时的字节码文件')
+    parser.add_argument('-o', '--output', help='输出字节码文件')
+    parser.add_argument('--c-array', metavar='NAME', help='输出 C 数组')
+    parser.add_argument('--disassemble', action='store_true', help='反汇编字节码文件')
+    parser.add_argument('--publish', metavar='HOST', help='经 MQTT 下载到设备')
+    parser.add_argument('--port', type=int, default=1883)
+    parser.add_argument('--username')
+    parser.add_argument('--password')
+    parser.add_argument('--topic', default='smartdesk/your_device_id/choreo', help='config.h: MQTT_TOPIC_CHOREO')
+    parser.add_argument('--ack-topic', default='$dp/post/your_device_id', help='config.h: MQTT_TOPIC_STATUS')
+    parser.add_argument('--slot', type=int, default=0)
+    parser.add_argument('--play', action='store_true', help='下载后立即播放')
+    parser.add_argument('--timeout', type=float, default=2.0)
+    parser.add_argument('--retries', type=int, default=5)
+    args = parser.parse_args()
+
+    emotions = load_emotions()
+
+    if args.disassemble:
+        with open(args.source, 'rb') as f:
+            disassemble(f.read(), emotions)
+        return
+
+    with open(args.source, encoding='utf-8') as f:
+        source = f.read()
+    try:
+        if source.lstrip().startswith('['):
+            script = compile_json(source, emotions)
+        else:
+            script = compile_text(source, emotions)
+    except CompileError as e:
+        sys.exit('%s: %s' % (args.source, e))
+
+    print('%s: %d bytes' % (args.source, len(script)), file=sys.stderr)
+    if args.output:
+        with open(args.output, 'wb') as f:
+            f.write(script)
+    if args.c_array:
+        print(c_array(args.c_array, script, os.path.relpath(args.source, ROOT)))
+    if args.publish:
+        publish(script, args)
+    if not (args.output or args.c_array or args.publish):
+        disassemble(script, emotions)
+
+
+if __name__ == '__main__':
+    main()
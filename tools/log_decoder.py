@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+"""
+延迟二进制日志解码器（对应 include/Deferred_Log.h）
+
+扫描源码中的 LOG_DEBUG/INFO/WARN/ERROR 调用，按与固件相同的 FNV-1a 算法
+重建 ID -> 格式串字典，再把 USART1 输出的 COBS 帧流还原为文本。
+
+用法：
+    python3 tools/log_decoder.py capture.bin
+    python3 tools/log_decoder.py --port /dev/ttyUSB0 --baud 115200
+    python3 tools/log_decoder.py --dump-dict            # 只打印字典并检查哈希冲突
+    python3 tools/log_decoder.py capture.bin --extract-inputs run.trace
+                                                        # 提取输入录制记录（见 Input_Trace.h）
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+LEVEL_NAMES = ["DEBUG", "INFO", "WARN", "ERROR"]
+
+LOG_ID_TEXT = 0
+LOG_ID_DROPPED = 1
+LOG_ID_INPUT = 2
+LOG_ID_RESERVED = 3
+
+INPUT_KINDS = ['LOOP', 'CLOCK', 'DHT', 'VOICE', 'LINK', 'MQTT_TOPIC', 'MQTT_DATA',
+               'MQTT_END', 'WEATHER', 'CHECKPOINT', 'CONSOLE', 'CONFIG']
+
+CALL_RE = re.compile(r'\bLOG_(DEBUG|INFO|WARN|ERROR)\s*\(\s*((?:"(?:[^"\\\n]|\\.)*"\s*)+)')
+LITERAL_RE = re.compile(r'"((?:[^"\\\n]|\\.)*)"')
+SPEC_RE = re.compile(r'%([-+ 0#]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z)?([diuxXcsfFeEgG%])')
+
+ESCAPES = {'n': b'\n', 't': b'\t', 'r': b'\r', '\\': b'\\', '"': b'"', "'": b"'", '0': b'\0'}
+
+
+def format_id(fmt):
+    """与固件 logFormatId() 相同的 FNV-1a 32 位哈希"""
+    h = 2166136261
+    for b in fmt:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h + LOG_ID_RESERVED if h < LOG_ID_RESERVED else h
+
+
+def unescape(body):
+    """C 字符串字面量内容 -> 字节（源文件按 UTF-8 读取）"""
+    out = bytearray()
+    i = 0
+    while i < len(body):
+        c = body[i]
+        if c != '\\':
+            out += c.encode('utf-8')
+            i += 1
+            continue
+        n = body[i + 1]
+        if n == 'x':
+            m = re.match(r'[0-9a-fA-F]+', body[i + 2:])
+            out.append(int(m.group(0), 16) & 0xFF)
+            i += 2 + len(m.group(0))
+        elif n in '01234567':
+            m = re.match(r'[0-7]{1,3}', body[i + 1:])
+            out.append(int(m.group(0), 8) & 0xFF)
+            i += 1 + len(m.group(0))
+        else:
+            out += ESCAPES.get(n, n.encode('utf-8'))
+            i += 2
+    return bytes(out)
+
+
+def build_dictionary(roots):
+    table = {}
+    for root in roots:
+        for dirpath, _, files in os.walk(root):
+            for name in sorted(files):
+                if not name.endswith(('.c', '.cpp', '.h', '.hpp', '.ino')):
+                    continue
+                path = os.path.join(dirpath, name)
+                with open(path, encoding='utf-8', errors='replace') as f:
+                    source = f.read()
+                for m in CALL_RE.finditer(source):
+                    fmt = b''.join(unescape(s) for s in LITERAL_RE.findall(m.group(2)))
+                    fid = format_id(fmt)
+                    where = '%s:%d' % (os.path.relpath(path), source.count('\n', 0, m.start()) + 1)
+                    if fid in table and table[fid][0] != fmt:
+                        sys.stderr.write('hash collision 0x%08x: %s vs %s\n' % (fid, table[fid][1], where))
+                    table.setdefault(fid, (fmt, where))
+    return table
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data) + 1:
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def render(fmt, args):
+    """按 printf 格式串依次取参数，整数/浮点 4 字节，字符串为长度前缀"""
+    text = fmt.decode('utf-8', errors='replace')
+    out = []
+    pos = 0
+    offset = 0
+    for m in SPEC_RE.finditer(text):
+        out.append(text[pos:m.start()])
+        pos = m.end()
+        flags, width, precision, _, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        spec = '%' + flags + width + ('.' + precision if precision is not None else '')
+        if conv == 's':
+            if offset >= len(args):
+                out.append('<missing>')
+                continue
+            n = args[offset]
+            value = args[offset + 1:offset + 1 + n].decode('utf-8', errors='replace')
+            offset += 1 + n
+            out.append((spec + 's') % value)
+            continue
+        if offset + 4 > len(args):
+            out.append('<missing>')
+            continue
+        raw = args[offset:offset + 4]
+        offset += 4
+        if conv in 'di':
+            out.append((spec + 'd') % struct.unpack('<i', raw)[0])
+        elif conv == 'u':
+            out.append((spec + 'd') % struct.unpack('<I', raw)[0])
+        elif conv in 'xX':
+            out.append((spec + conv) % struct.unpack('<I', raw)[0])
+        elif conv == 'c':
+            out.append(chr(struct.unpack('<I', raw)[0] & 0xFF))
+        else:
+            out.append((spec + conv) % struct.unpack('<f', raw)[0])
+    out.append(text[pos:])
+    return ''.join(out)
+
+
+def decode_frame(frame, table):
+    if len(frame) < 9:
+        return '<short frame %s>' % frame.hex()
+    level = frame[0]
+    fid, stamp = struct.unpack('<II', frame[1:9])
+    args = frame[9:]
+    level_name = LEVEL_NAMES[level] if level < len(LEVEL_NAMES) else str(level)
+
+    if fid == LOG_ID_INPUT:
+        kind = INPUT_KINDS[args[0]] if args and args[0] < len(INPUT_KINDS) else '?'
+        body = '[Input] %s %s' % (kind, args[1:].hex())
+        level_name = 'INPUT'
+    elif fid == LOG_ID_TEXT:
+        body = args.decode('utf-8', errors='replace')
+    elif fid == LOG_ID_DROPPED:
+        body = '[Log] %d frames dropped (buffer full)' % struct.unpack('<I', args[:4])[0]
+    elif fid in table:
+        body = render(table[fid][0], args)
+    else:
+        body = '<unknown id 0x%08x> %s' % (fid, args.hex())
+    return '%10.3f %-5s %s' % (stamp / 1000.0, level_name, body)
+
+
+def stream_frames(read_chunk, synced):
+    """按 0x00 切分帧；未同步时首个分隔符之前的字节可能是半帧，丢弃"""
+    pending = bytearray()
+    while True:
+        chunk = read_chunk()
+        if not chunk:
+            return
+        for b in chunk:
+            if b != 0:
+                pending.append(b)
+                continue
+            if synced and pending:
+                yield bytes(pending)
+            synced = True
+            pending.clear()
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    repo = os.path.dirname(here)
+    parser = argparse.ArgumentParser(description='Decode deferred binary log stream')
+    parser.add_argument('input', nargs='?', help='captured binary file (default: stdin)')
+    parser.add_argument('--port', help='serial port to read from (requires pyserial)')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--src', action='append',
+                        help='source directory to scan (default: src/ and include/)')
+    parser.add_argument('--level', default='DEBUG', choices=LEVEL_NAMES,
+                        help='hide frames below this level')
+    parser.add_argument('--dump-dict', action='store_true', help='print the format dictionary')
+    parser.add_argument('--show-inputs', action='store_true', help='print input recording frames')
+    parser.add_argument('--extract-inputs', metavar='FILE',
+                        help='write input recording frames as a replay trace ([len][frame]...)')
+    opts = parser.parse_args()
+
+    roots = opts.src or [os.path.join(repo, 'src'), os.path.join(repo, 'include')]
+    table = build_dictionary(roots)
+
+    if opts.dump_dict:
+        for fid, (fmt, where) in sorted(table.items(), key=lambda kv: kv[1][1]):
+            print('0x%08x  %-28s %s' % (fid, where, fmt.decode('utf-8', errors='replace')))
+        return
+
+    if opts.port:
+        import serial
+        port = serial.Serial(opts.port, opts.baud, timeout=1)
+
+        def read_chunk():
+            while True:
+                data = port.read(256)
+                if data:
+                    return data
+
+        # 串口可能在帧中间接入，等到第一个分隔符再开始解码
+        synced = False
+    else:
+        source = open(opts.input, 'rb') if opts.input else sys.stdin.buffer
+        read_chunk = lambda: source.read(4096)
+        synced = True
+
+    trace = open(opts.extract_inputs, 'wb') if opts.extract_inputs else None
+    inputs = 0
+    dropped = 0
+
+    min_level = LEVEL_NAMES.index(opts.level)
+    for encoded in stream_frames(read_chunk, synced):
+        frame = cobs_decode(encoded)
+        if frame is None:
+            print('<corrupt frame %s>' % encoded.hex())
+            continue
+        fid = struct.unpack('<I', frame[1:5])[0] if len(frame) >= 9 else None
+        if fid == LOG_ID_DROPPED:
+            dropped += struct.unpack('<I', frame[9:13])[0]
+        if fid == LOG_ID_INPUT:
+            inputs += 1
+            if trace:
+                trace.write(bytes([len(frame)]) + frame)
+            if not opts.show_inputs:
+                continue
+        elif frame and frame[0] < min_level:
+            continue
+        print(decode_frame(frame, table), flush=True)
+
+    if trace:
+        trace.close()
+        sys.stderr.write('%d input records written to %s\n' % (inputs, opts.extract_inputs))
+        if dropped:
+            # 丢帧可能丢掉了输入记录，回放会从丢失处开始偏离
+            sys.stderr.write('warning: %d frames were dropped; replay may diverge\n' % dropped)
+
+
+if __name__ == '__main__':
+    main()
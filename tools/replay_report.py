@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+输入回放耗时报告（录制格式见 include/Input_Trace.h）
+
+从日志抓包中提取输入记录（与 log_decoder.py --extract-inputs 相同），
+在主机上用完整固件回放（pio test -e native_replay，驱动见 test/test_replay），
+再汇总回放结果：检查点是否一致、第一次偏差的时刻、设备时间与实际耗时之比。
+
+用法：
+    python3 tools/replay_report.py capture.bin
+    python3 tools/replay_report.py --trace run.trace
+    pio test -e native_replay -v | python3 tools/replay_report.py --parse -
+"""
+
+import argparse
+import os
+import re
+import struct
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from log_decoder import LOG_ID_INPUT, cobs_decode, stream_frames  # noqa: E402
+
+REPORT_RE = re.compile(r'\[Replay\] loops=(\d+) records=(\d+) mismatches=(\d+) skipped=(\d+) '
+                       r'checkpoints=(\d+) failures=(\d+) first=(\d+) sim=(\d+)ms wall=(\d+)us')
+FIELDS = ['loops', 'records', 'mismatches', 'skipped', 'checkpoints', 'failures', 'first', 'sim', 'wall']
+
+
+def extract_inputs(capture_path, trace_path):
+    """日志抓包 -> 回放文件（[长度][帧] 序列），返回记录数"""
+    records = 0
+    with open(capture_path, 'rb') as source, open(trace_path, 'wb') as trace:
+        for encoded in stream_frames(lambda: source.read(4096), True):
+            frame = cobs_decode(encoded)
+            if frame is None or len(frame) < 9:
+                continue
+            if struct.unpack('<I', frame[1:5])[0] == LOG_ID_INPUT:
+                trace.write(bytes([len(frame)]) + frame)
+                records += 1
+    return records
+
+
+def run_replay(trace_path, repo):
+    env = dict(os.environ, REPLAY_TRACE=os.path.abspath(trace_path))
+    result = subprocess.run(['pio', 'test', '-e', 'native_replay', '-v'], cwd=repo, env=env,
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    return result.stdout
+
+
+def parse_reports(text):
+    return [dict(zip(FIELDS, map(int, m.groups()))) for m in REPORT_RE.finditer(text)]
+
+
+def print_report(r):
+    wall_ms = r['wall'] / 1000.0
+    print('loops         %d' % r['loops'])
+    print('records       %d (%d mismatched, %d skipped)' % (r['records'], r['mismatches'], r['skipped']))
+    print('checkpoints   %d (%d failed)' % (r['checkpoints'], r['failures']))
+    if r['failures']:
+        print('first failure %.3f s' % (r['first'] / 1000.0))
+    print('device time   %.3f s' % (r['sim'] / 1000.0))
+    print('replay time   %.3f ms (%.2f us/loop)' % (wall_ms, r['wall'] / max(r['loops'], 1)))
+    print('speedup       %.0fx' % (r['sim'] * 1000.0 / max(r['wall'], 1)))
+
+
+def main():
+    repo = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(description='Replay an input recording on the host and report timing')
+    parser.add_argument('capture', nargs='?', help='captured binary log (USART1 output)')
+    parser.add_argument('--trace', help='replay trace already extracted with log_decoder.py --extract-inputs')
+    parser.add_argument('--parse', metavar='FILE', help="only parse test output ('-' for stdin)")
+    opts = parser.parse_args()
+
+    if opts.parse:
+        text = sys.stdin.read() if opts.parse == '-' else open(opts.parse).read()
+    else:
+        if not opts.capture and not opts.trace:
+            parser.error('capture or --trace required')
+        trace = opts.trace
+        if not trace:
+            fd, trace = tempfile.mkstemp(suffix='.trace')
+            os.close(fd)
+            count = extract_inputs(opts.capture, trace)
+            sys.stderr.write('%d input records extracted\n' % count)
+        text = run_replay(trace, repo)
+        if not opts.trace:
+            os.unlink(trace)
+
+    reports = parse_reports(text)
+    if not reports:
+        sys.stderr.write(text)
+        sys.stderr.write('no replay report found\n')
+        sys.exit(1)
+    # 自带录制的回放在前，REPLAY_TRACE 的回放在最后
+    print_report(reports[-1])
+    sys.exit(1 if reports[-1]['failures'] or reports[-1]['mismatches'] else 0)
+
+
+if __name__ == '__main__':
+    main()